@@ -27,12 +27,12 @@
  * This will have an influence on read before write error detection.
  *
  */
-uint8_t  MCU_RAMCTL      [MAX_RAM_SIZE];
-uint32_t MCU_RAMCTL_ADDR;
+WSIM_TLS uint8_t  MCU_RAMCTL      [MAX_RAM_SIZE];
+WSIM_TLS uint32_t MCU_RAMCTL_ADDR;
 #endif
 
-struct atmega128_mcu_t mcu;
-struct atmega128_mcu_t mcu_backup;
+WSIM_TLS struct atmega128_mcu_t mcu;
+WSIM_TLS struct atmega128_mcu_t mcu_backup;
 
 /* ************************************************** */
 /* ************************************************** */
@@ -95,11 +95,18 @@ int mcu_options_add(void)
 /* ************************************************** */
 /* ************************************************** */
 
-int atmega128_mcu_create(int UNUSED xtal, int UNUSED xosc)
+int atmega128_mcu_create(int xtal, int UNUSED xosc)
 {
   HW_DMSG_ATM("== ATMEGA128 creation\n");
+  if (xtal <= 0)
+    {
+      ERROR("atmega:error: xtal frequency must be > 0 (%d Hz)\n", xtal);
+      return 1;
+    }
   MCU_INSN_CPT  = 0;
   MCU_CYCLE_CPT = 0;
+  MCU_ALU.clock_freq     = xtal;
+  MCU_ALU.clock_nano_rem = 0;
   atmega128_io_init();
   
   // MCU_CLOCK.xtal_freq = xtal;
@@ -125,19 +132,20 @@ void mcu_reset(void)
 /* ************************************************** */
 /* ************************************************** */
 
-void mcu_state_save(void)
+int mcu_state_save(void)
 {
   HW_DMSG_ATM("atmega128: == state save \n");
   HW_DMSG_ATM("atmega128: PC 0x%04x \n",mcu_get_pc());
   HW_DMSG_ATM("atmega128: == \n");
   memcpy(&mcu_backup,&mcu,sizeof(struct atmega128_mcu_t));
+  return sizeof(struct atmega128_mcu_t);
 }
 
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
 
-void mcu_state_restore(void)
+int mcu_state_restore(void)
 {
   unsigned int old_run_mode = RUNNING_MODE();
   HW_DMSG_ATM("atmega128: == state restore \n");
@@ -149,6 +157,31 @@ void mcu_state_restore(void)
     {
       mcu_signal_add( SIG_MCU_LPM_CHANGE );
     }
+  return sizeof(struct atmega128_mcu_t);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int mcu_state_size(void)
+{
+  return sizeof(struct atmega128_mcu_t);
+}
+
+void mcu_state_export(uint8_t *image)
+{
+  memcpy(image,&mcu,sizeof(struct atmega128_mcu_t));
+}
+
+void mcu_state_import(uint8_t *image)
+{
+  unsigned int old_run_mode = RUNNING_MODE();
+  memcpy(&mcu,image,sizeof(struct atmega128_mcu_t));
+  if (old_run_mode != RUNNING_MODE())
+    {
+      mcu_signal_add( SIG_MCU_LPM_CHANGE );
+    }
 }
 
 /* ************************************************** */
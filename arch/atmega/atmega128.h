@@ -42,22 +42,22 @@ struct atmega128_mcu_t {
 /* ************************************************** */
 /* ************************************************** */
 
-extern tracer_id_t ATMEGA_TRACER_ACLK;
-extern tracer_id_t ATMEGA_TRACER_MCLK;
-extern tracer_id_t ATMEGA_TRACER_SMCLK;
-extern tracer_id_t ATMEGA_TRACER_GIE;
-extern tracer_id_t ATMEGA_TRACER_PC;
-extern tracer_id_t ATMEGA_TRACER_SP;
-extern tracer_id_t ATMEGA_TRACER_INTR;
-extern tracer_id_t ATMEGA_TRACER_LPM;
-extern tracer_id_t ATMEGA_TRACER_PORT1;
-extern tracer_id_t ATMEGA_TRACER_PORT2;
-extern tracer_id_t ATMEGA_TRACER_PORT3;
-extern tracer_id_t ATMEGA_TRACER_PORT4;
-extern tracer_id_t ATMEGA_TRACER_PORT5;
-extern tracer_id_t ATMEGA_TRACER_PORT6;
-extern tracer_id_t ATMEGA_TRACER_USART0;
-extern tracer_id_t ATMEGA_TRACER_USART1;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_ACLK;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_MCLK;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_SMCLK;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_GIE;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_PC;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_SP;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_INTR;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_LPM;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_PORT1;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_PORT2;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_PORT3;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_PORT4;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_PORT5;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_PORT6;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_USART0;
+extern WSIM_TLS tracer_id_t ATMEGA_TRACER_USART1;
 
 #define TRACER_TRACE_PC(v)      tracer_event_record(ATMEGA_TRACER_PC,v)
 #define TRACER_TRACE_SP(v)      tracer_event_record(ATMEGA_TRACER_SP,v)
@@ -83,8 +83,8 @@ extern tracer_id_t ATMEGA_TRACER_USART1;
 /* ************************************************** */
 /* ************************************************** */
 
-extern struct atmega128_mcu_t mcu;
-extern struct atmega128_mcu_t mcu_backup;
+extern WSIM_TLS struct atmega128_mcu_t mcu;
+extern WSIM_TLS struct atmega128_mcu_t mcu_backup;
 
 #define MCU                mcu
 #define MCU_ALU            MCU.alu
@@ -14,6 +14,10 @@
 #include "arch/common/hardware.h"
 #include "atmega128.h"
 
+#if defined(WSIM_MULTINODE)
+#include <pthread.h>
+#endif
+
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
@@ -182,18 +186,6 @@
 /* ************************************************** */
 /* ************************************************** */
 
-#define RETURN(opcode,insn)                                  \
-  do {							     \
-    if (MCU_ALU.skip_execute == 0)			     \
-      return OPCODES[opcode].fun(opcode,insn);		     \
-    else						     \
-      return OPCODES[opcode].length;			     \
-  } while (0)
-
-/* ************************************************** */
-/* ************************************************** */
-/* ************************************************** */
-
 /* THIS IS WORK IN PROGRESS
  * +++++++++++++++++++++++++++++++++++++
  * Implemented 8-bit AVR Instruction Set
@@ -327,6 +319,7 @@
 
 	enum atmega_opcode {
 		#include "8bit_avr_instruction_set.def"
+		OP_MAX
 	};
 #	undef X
 #else
@@ -364,7 +357,83 @@ struct atmega_opcode_info_t {
 #	error "X macro is already defined, so might not be undefined previously"
 #endif
 
-#define SET_CYCLES(n) do { } while (0)
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * Decode table: instruction word -> OPCODES[] index, built once from the
+ * encodings of the .def file. The table does not depend on the node and
+ * is shared by all nodes of a multinode simulation.
+ **/
+
+#define OP_UNKNOWN 0xff
+
+/* fails to compile if opcodes do not fit in the decode table */
+typedef char atmega_decode_check_t[(OP_MAX < OP_UNKNOWN) ? 1 : -1];
+
+struct atmega_opcode_encoding_t {
+    uint8_t        opcode;
+    uint16_t       mask;
+    uint16_t       match;
+};
+
+#ifndef E
+#	define E(INST, MASK, MATCH) { .opcode = OP_##INST, .mask = MASK, .match = MATCH },
+
+	static const struct atmega_opcode_encoding_t ENCODINGS[] = {
+#		include "8bit_avr_instruction_set.def"
+	};
+#	undef E
+#else
+#	error "E macro is already defined, so might not be undefined previously"
+#endif
+
+static uint8_t atmega128_decode[0x10000];
+
+static void atmega128_decode_build(void)
+{
+    unsigned int i, bits;
+
+    memset(atmega128_decode, OP_UNKNOWN, sizeof(atmega128_decode));
+
+    /* least specific encodings first, more specific ones overwrite them */
+    for(bits = 0; bits <= 16; bits++)
+    {
+        for(i = 0; i < sizeof(ENCODINGS) / sizeof(ENCODINGS[0]); i++)
+        {
+            uint16_t operands, sub;
+
+            if ((unsigned int)__builtin_popcount(ENCODINGS[i].mask) != bits)
+                continue;
+
+            /* enumerate all values of the operand bits */
+            operands = ~ENCODINGS[i].mask;
+            sub      = 0;
+            do {
+                atmega128_decode[ ENCODINGS[i].match | sub ] = ENCODINGS[i].opcode;
+                sub = (sub - operands) & operands;
+            } while (sub != 0);
+        }
+    }
+}
+
+#if defined(WSIM_MULTINODE)
+static pthread_once_t atmega128_decode_once = PTHREAD_ONCE_INIT;
+#  define ATMEGA128_DECODE_INIT() pthread_once(&atmega128_decode_once, atmega128_decode_build)
+#else
+static int atmega128_decode_done = 0;
+#  define ATMEGA128_DECODE_INIT()			\
+  do {							\
+    if (atmega128_decode_done == 0)			\
+      {							\
+        atmega128_decode_build();			\
+        atmega128_decode_done = 1;			\
+      }							\
+  } while (0)
+#endif
+
+#define SET_CYCLES(n) do { MCU_ALU.cycles = (n); } while (0)
 #define ADD_TO_PC(k)							\
 	do {									    \
 		uint16_t next_pc;                       \
@@ -1884,7 +1953,7 @@ static int opcode_or(uint16_t opcode, uint16_t insn)
     WRITE_Z(R == 0);
 
     ADD_TO_PC(1); // PC is aligned on words
-    SET_CYCLES(2);
+    SET_CYCLES(1);
     return opcode;
 }
 
@@ -2355,6 +2424,9 @@ void atmega128_alu_reset(void)
     MCU_ALU.skip_execute = 0;
     MCU_ALU.interrupts   = 0;
     MCU_ALU.signal       = 0;
+    MCU_ALU.cycles       = 0;
+
+    ATMEGA128_DECODE_INIT();
 }
 
 /* ************************************************** */
@@ -2363,519 +2435,40 @@ void atmega128_alu_reset(void)
 
 static inline unsigned int extract_opcode(uint16_t insn)
 {
-    unsigned int tmp;
+    unsigned int opcode = atmega128_decode[insn];
 
-    tmp = (insn >> 12) & 0x0f; // 4 bits
     HW_DMSG_DIS("PC:0x%04x ins:0x%04x  ",(mcu_get_pc() & 0xffff) * 2,insn & 0xffff);
 
-    switch (tmp) {
-        /* ============================================================ */
-        /* == 0000 BCD ================================================ */
-        /* ============================================================ */
-    case 0x0:
-        switch ((insn >> 10 ) & 0x3) {
-        case 0x0: /* 0000 00xx CD */
-            switch ((insn >> 8) & 0x3) {
-            case 0x0: /* 0000 0000 CD */
-                if (insn == 0) RETURN(OP_NOP,insn);
-                break;
-            case 0x1: /* 0000 0001 CD */
-                RETURN(OP_MOVW,insn);
-            case 0x2: /* 0000 0010 CD */
-                RETURN(OP_MULS,insn);
-            case 0x3: /* 0000 0011 0xxx 1xxx */
-                if      ((((insn >> 7) & 1) == 0) && (((insn >> 3) & 1) == 0)) {
-                    RETURN(OP_MULSU,insn);
-                } else if ((((insn >> 7) & 1) == 0) && (((insn >> 3) & 1) == 1)) {
-                    RETURN(OP_FMUL,insn);
-                }     /* 0000 0011 1xxx 0xxx */
-                else if ((((insn >> 7) & 1) == 1) && (((insn >> 3) & 1) == 0)) {
-                    RETURN(OP_FMULS,insn);
-                }     /* 0000 0011 1xxx 1xxx */
-                else if ((((insn >> 7) & 1) == 1) && (((insn >> 3) & 1) == 1)) {
-                    RETURN(OP_FMULSU,insn);
-                } else {
-                    UNKNOWN_OPCODE(insn);
-                }
-                break;
-            default:
-                UNKNOWN_OPCODE(insn);
-                break;
-            }
-            break;
-        case 0x1: /* 0000 01xx CD */
-            RETURN(OP_CPC,insn);
-        case 0x2: /* 0000 10xx CD */
-            RETURN(OP_SBC,insn);
-        case 0x3: /* 0000 11xx CD */
-            RETURN(OP_ADD,insn); /* OP_LSL r=d */
-        default:
-            UNKNOWN_OPCODE(insn);
-            break;
-        }
-        break;
-
-        /* ============================================================ */
-        /* == 0001 BCD ================================================ */
-        /* ============================================================ */
-    case 0x1:
-        switch ((insn >> 10 ) & 0x3) {
-        case 0x0: /* 0001 00xx CD */
-            RETURN(OP_CPSE,insn);
-        case 0x1: /* 0001 01xx CD */
-            RETURN(OP_CP,insn);
-        case 0x2: /* 0001 10xx CD */
-            RETURN(OP_SUB,insn);
-        case 0x3: /* 0001 11xx CD */
-            RETURN(OP_ADC,insn); /* OP_ROL c=d */
-        default:
-            UNKNOWN_OPCODE(insn);
-            break;
-        }
-        break;
-
-        /* ============================================================ */
-        /* == 0010 BCD ================================================ */
-        /* ============================================================ */
-    case 0x2:
-        switch ((insn >> 10 ) & 0x3) {
-        case 0: /* 0010 00xx CD */
-            RETURN(OP_AND,insn); /* OP_TST if dst == src */
-        case 1: /* 0010 01xx CD */
-            RETURN(OP_EOR,insn); /* OP_CLR if dst == src */
-        case 2: /* 0010 10xx CD */
-            RETURN(OP_OR,insn);
-        case 3: /* 0010 11xx CD */
-            RETURN(OP_MOV,insn);
-        default:
-            UNKNOWN_OPCODE(insn);
-            break;
-        }
-        break;
-
-        /* ============================================================ */
-        /* == 0011 BCD ================================================ */
-        /* ============================================================ */
-    case 0x3:
-        RETURN(OP_CPI,insn);
-
-        /* ============================================================ */
-        /* == 0100 BCD ================================================ */
-        /* ============================================================ */
-    case 0x4:
-        RETURN(OP_SBCI,insn);
-
-        /* ============================================================ */
-        /* == 0101 BCD ================================================ */
-        /* ============================================================ */
-    case 0x5:
-        RETURN(OP_SUBI,insn);
-
-        /* ============================================================ */
-        /* == 0110 BCD ================================================ */
-        /* ============================================================ */
-    case 0x6:
-        RETURN(OP_ORI,insn);  /* OP_SBR */
-
-        /* ============================================================ */
-        /* == 0111 BCD ================================================ */
-        /* ============================================================ */
-    case 0x7:
-        RETURN(OP_ANDI,insn);
-
-        /* ============================================================ */
-        /* == 1000 BCD ================================================ */
-        /* ============================================================ */
-    case 0x8:
-        /* 1000 qqxr rrrr qqqq : STD if x is set, LDD otherwise */
-        if ((insn >> 9) & 0x1)
-            /* 1000 qq1r rrrr qqqq */
-        {
-            RETURN(OP_STD,insn);
-        } else
-            /* 1000 qq0r rrrr qqqq */
-        {
-            RETURN(OP_LDD,insn);
-        }
-        break;
-
-        /* ============================================================ */
-        /* == 1001 BCD ================================================ */
-        /* ============================================================ */
-    case 0x9:
-        switch ((insn >> 8) & 0xf) {
-        case 0x0: /* 1001 0000 CD */
-            switch (insn & 0xf) {
-            case 0x0: /* 1001 0000 C 0000 */
-                RETURN(OP_LDS,insn);  /* LDS         v0 */
-            case 0x1: /* 1001 0000 C 0001 */
-                RETURN(OP_LDD,insn);  /* LDD Z (ii)  v0 */
-            case 0x2: /* 1001 0000 C 0010 */
-                RETURN(OP_LDD,insn);  /* LDD Z (iii) v0 */
-            case 0x4: /* 1001 0000 C 0100 */
-                RETURN(OP_LPM,insn);  /* LPM   (ii)  v0 */
-            case 0x5: /* 1001 0000 C 0101 */
-                RETURN(OP_LPM,insn);  /* LPM   (iii) v0 */
-            case 0x6: /* 1001 0000 C 0110 */
-                RETURN(OP_ELPM,insn); /* ELPM  (ii)  v0 */
-            case 0x7: /* 1001 0000 C 0111 */
-                RETURN(OP_ELPM,insn); /* ELPM  (iii) v0 */
-            case 0x8: /* 1001 0000 C 1001 */
-                RETURN(OP_LDD,insn);  /* LDD Y (ii)  v0 */
-            case 0xa: /* 1001 0000 C 1010 */
-                RETURN(OP_LDD,insn);  /* LDD Y (iii) v0 */
-            case 0xc: /* 1001 0000 C 1100 */
-                RETURN(OP_LD,insn);   /* LD    (i)   v0 */
-            case 0xd: /* 1001 0000 C 1101 */
-                RETURN(OP_LD,insn);   /* LD    (ii)  v0 */
-            case 0xe: /* 1001 0000 C 1110 */
-                RETURN(OP_LD,insn);   /* LD    (iii) v0 */
-            case 0xf: /* 1001 0000 C 1111 */
-                RETURN(OP_POP,insn);  /* POP         v0 */
-            default:
-                UNKNOWN_OPCODE(insn);
-                break;
-            }
-            break;
-        case 0x1: /* 1001 0001 CD */
-            switch (insn & 0xf) {
-            case 0x0: /* 1001 0001 C 0000 */
-                RETURN(OP_LDS,insn);  /* LDS         v1 */
-            case 0x1: /* 1001 0001 C 0001 */
-                RETURN(OP_LDD,insn);  /* LDD Z (ii)  v1 */
-            case 0x2: /* 1001 0001 C 0010 */
-                RETURN(OP_LDD,insn);  /* LDD Z (iii) v1 */
-            case 0x4: /* 1001 0001 C 0100 */
-                RETURN(OP_LPM,insn);  /* LPM   (ii)  v1 */
-            case 0x5: /* 1001 0001 C 0101 */
-                RETURN(OP_LPM,insn);  /* LPM   (iii) v1 */
-            case 0x6: /* 1001 0001 C 0110 */
-                RETURN(OP_ELPM,insn); /* ELPM  (ii)  v1 */
-            case 0x7: /* 1001 0001 C 0111 */
-                RETURN(OP_ELPM,insn); /* ELPM  (iii) v1 */
-            case 0x8: /* 1001 0001 C 1001 */
-                RETURN(OP_LDD,insn);  /* LDD Y (ii)  v1 */
-            case 0xa: /* 1001 0001 C 1010 */
-                RETURN(OP_LDD,insn);  /* LDD Y (iii) v1 */
-            case 0xc: /* 1001 0001 C 1100 */
-                RETURN(OP_LD,insn);   /* LD    (i)   v1 */
-            case 0xd: /* 1001 0001 C 1101 */
-                RETURN(OP_LD,insn);   /* LD    (ii)  v1 */
-            case 0xe: /* 1001 0001 C 1110 */
-                RETURN(OP_LD,insn);   /* LD    (iii) v1 */
-            case 0xf: /* 1001 0001 C 1111 */
-                RETURN(OP_POP,insn);  /* POP         v1 */
-            default:
-                UNKNOWN_OPCODE(insn);
-                break;
-            }
-            break;
-        case 0x2: /* 1001 0010 CD */
-            switch (insn & 0xf) {
-            case 0x0: /* 1001 0010 C 0000 */
-                RETURN(OP_STS,insn);  /* v0 */
-            case 0x1: /* 1001 0010 C 0001 */
-                RETURN(OP_STD,insn);  /* STD Z */
-            case 0x2: /* 1001 0010 C 0010 */
-                RETURN(OP_STD,insn);  /* STD Z */
-            case 0x8: /* 1001 0010 C 1000 */
-                RETURN(OP_STD,insn);  /* STD Y */
-            case 0xa: /* 1001 0010 C 1010 */
-                RETURN(OP_STD,insn);  /* STD Y */
-            case 0xc: /* 1001 0010 C 1100 */
-                RETURN(OP_ST,insn);   /* v0 */
-            case 0xd: /* 1001 0010 C 1101 */
-                RETURN(OP_ST,insn);   /* v0 */
-            case 0xe: /* 1001 0010 C 1110 */
-                RETURN(OP_ST,insn);   /* v0 */
-            case 0xf: /* 1001 001C C 1111 */
-                RETURN(OP_PUSH,insn);
-            default:
-                UNKNOWN_OPCODE(insn);
-                break;
-            }
-            break;
-        case 0x3: /* 1001 0011 CD */
-            switch (insn & 0xf) {
-            case 0x0: /* 1001 0011 C 0000 */
-                RETURN(OP_STS,insn);  /* v1 */
-            case 0x1: /* 1001 0011 C 0001 */
-                RETURN(OP_STD,insn);  /* STD Z */
-            case 0x2: /* 1001 0011 C 0010 */
-                RETURN(OP_STD,insn);  /* STD Z */
-            case 0x8: /* 1001 0011 C 1000 */
-                RETURN(OP_STD,insn);  /* STD Y */
-            case 0xa: /* 1001 0011 C 1010 */
-                RETURN(OP_STD,insn);  /* STD Y */
-            case 0xc: /* 1001 0011 C 1100 */
-                RETURN(OP_ST,insn);   /* v1 */
-            case 0xd: /* 1001 0011 C 1101 */
-                RETURN(OP_ST,insn);   /* v1 */
-            case 0xe: /* 1001 0011 C 1110 */
-                RETURN(OP_ST,insn);   /* v1 */
-            case 0xf: /* 1001 001C C 1111 */
-                RETURN(OP_PUSH,insn);
-            default:
-                UNKNOWN_OPCODE(insn);
-                break;
-            }
-            break;
-        case 0x4: /* 1001 0100 CD */
-            switch (insn & 0xf) {
-            case 0x0: /* 1001 0100 C 0000 */
-                RETURN(OP_COM,insn);
-            case 0x1: /* 1001 0100 C 0001 */
-                RETURN(OP_NEG,insn);
-            case 0x2: /* 1001 0100 C 0010 */
-                RETURN(OP_SWAP,insn);
-            case 0x3: /* 1001 0100 C 0011 */
-                RETURN(OP_INC,insn);
-            case 0x5: /* 1001 0100 C 0101 */
-                RETURN(OP_ASR,insn);
-            case 0x6: /* 1001 0100 C 0110 */
-                RETURN(OP_LSR,insn);
-            case 0x7: /* 1001 0100 C 0111 */
-                RETURN(OP_ROR,insn);
-            case 0x8: /* 1001 0100 C 1000 */
-                switch ((insn >> 7) & 0x1) {
-                case 0x0:
-                    /* ** 0xxx return OP_BSET **
-                     * if xxx = 0 SEC
-                     * if xxx = 1 SEZ
-                     * if xxx = 2 SEN
-                     * if xxx = 3 SEV
-                     * if xxx = 4 SES
-                     * if xxx = 5 SEH
-                     * if xxx = 6 SET
-                     * if xxx = 7 SEI
-                     */
-                    RETURN(OP_BSET,insn);    /* 0000 fall */
-                case 0x1:
-                    /* ** 1xxx return OP_BCLR **
-                     * if xxx = 0 CLC
-                      				 * if xxx = 1 CLZ
-                      				 * if xxx = 2 CLN
-                      				 * if xxx = 3 CLV
-                      				 * if xxx = 4 CLS
-                      				 * if xxx = 5 CLH
-                      				 * if xxx = 6 CLT
-                      				 * if xxx = 7 CLI
-                      				 */
-                    RETURN(OP_BCLR,insn);    /* 0001 fall */
-                }
-                break;
-            case 0x9: /* 1001 0100 C 1001 */
-                switch ((insn >> 4) & 0xf) {
-                case 0x0:
-                    RETURN(OP_IJMP,insn);   /* 0000 */
-                case 0x1:
-                    RETURN(OP_EIJMP,insn);  /* 0001 */
-                default:
-                    UNKNOWN_OPCODE(insn);
-                    break;
-                }
-                break;
-            case 0xa: /* 1001 0100 C 1010 */
-                RETURN(OP_DEC,insn);
-            case 0xc: /* 1001 0100 C 1100 */ /* fall */
-            case 0xd: /* 1001 0100 C 1101 */
-                RETURN(OP_JMP,insn);
-            case 0xe: /* 1001 0100 C 1110 */ /* fall */
-            case 0xf: /* 1001 0100 C 1111 */
-                RETURN(OP_CALL,insn);
-            default:
-                UNKNOWN_OPCODE(insn);
-                break;
-            }
-            break;
-        case 0x5: /* 1001 0101 CD */
-            switch (insn & 0xf) {
-            case 0x0: /* 1001 0101 C 0000 */
-                RETURN(OP_COM,insn);
-            case 0x1: /* 1001 0100 C 0001 */
-                RETURN(OP_NEG,insn);
-            case 0x2: /* 1001 0100 C 0010 */
-                RETURN(OP_SWAP,insn);
-            case 0x3: /* 1001 0101 C 0011 */
-                RETURN(OP_INC,insn);
-            case 0x5: /* 1001 0101 C 0101 */
-                RETURN(OP_ASR,insn);
-            case 0x6: /* 1001 0101 C 0110 */
-                RETURN(OP_LSR,insn);
-            case 0x7: /* 1001 0101 C 0111 */
-                RETURN(OP_ROR,insn);
-            case 0x8: /* 1001 0101 C 1000 */
-                switch ((insn >> 4) & 0xf) {
-                case 0x0:
-                    RETURN(OP_RET,insn);    /* 0000 */
-                case 0x1:
-                    RETURN(OP_RETI,insn);   /* 0001 */
-                case 0x8:
-                    RETURN(OP_SLEEP,insn);  /* 1000 */
-                case 0x9:
-                    RETURN(OP_BREAK,insn);  /* 1001 */
-                case 0xa:
-                    RETURN(OP_WDR,insn);    /* 1010 */
-                case 0xc:
-                    RETURN(OP_LPM,insn);    /* 1100 */ /* LPM (i)  */
-                case 0xd:
-                    RETURN(OP_ELPM,insn);   /* 1101 */ /* ELPM (i) */
-                case 0xe:
-                    RETURN(OP_SPM,insn);    /* 1110 */
-                default :
-                    UNKNOWN_OPCODE(insn);
-                    break;
-                }
-                break;
-            case 0x9: /* 1001 0101 C 1001 */
-                switch ((insn >> 4) & 0xf) {
-                case 0x0:
-                    RETURN(OP_ICALL,insn);  /* 0000 */
-                case 0x1:
-                    RETURN(OP_EICALL,insn); /* 0001 */
-                default:
-                    UNKNOWN_OPCODE(insn);
-                    break;
-                }
-                break;
-            case 0xa: /* 1001 0101 C 1010 */
-                RETURN(OP_DEC,insn);
-            case 0xc: /* 1001 0101 C 1100 */ /* fall */
-            case 0xd: /* 1001 0101 C 1101 */
-                RETURN(OP_JMP,insn);
-            case 0xe: /* 1001 0101 C 1110 */ /* fall */
-            case 0xf: /* 1001 0101 C 1111 */
-                RETURN(OP_CALL,insn);
-            default:
-                UNKNOWN_OPCODE(insn);
-                break;
-            }
-            break;
-        case 0x6: /* 1001 0110 CD */
-            RETURN(OP_ADIW,insn);
-        case 0x7: /* 1001 0111 CD */
-            RETURN(OP_SBIW,insn);
-        case 0x8: /* 1001 1000 CD */
-            RETURN(OP_CBI,insn);
-        case 0x9: /* 1001 1001 CD */
-            RETURN(OP_SBIC,insn);
-        case 0xa: /* 1001 1010 CD */
-            RETURN(OP_SBI,insn);
-        case 0xb: /* 1001 1011 CD */
-            RETURN(OP_SBIS,insn);
-        case 0xc: /* 1001 1100 CD */ /* fall */
-        case 0xd: /* 1001 1101 CD */ /* fall */
-        case 0xe: /* 1001 1110 CD */ /* fall */
-        case 0xf: /* 1001 11xx CD */
-            RETURN(OP_MUL,insn);
-        default:
-            UNKNOWN_OPCODE(insn);
-            break;
-        }
-        break;
-
-        /* ============================================================ */
-        /* == 1010 BCD ================================================ */
-        /* ============================================================ */
-    case 0xa:
-        if (BIT(insn,9) == 0) {
-            if (BIT(insn,3) == 1)
-                RETURN(OP_LDD,insn);  /* LDD Y (iv)   v1  */
-            else
-                RETURN(OP_LDD,insn);  /* LDD Z (iv)   v1 */
-        } else {
-            if (BIT(insn,3) == 1)
-                RETURN(OP_STD,insn);  /* STD Y (iv)   v1 */
-            else
-                RETURN(OP_STD,insn);  /* STD Z (iv)   v1 */
-        }
-        break;
-
-        /* ============================================================ */
-        /* == 1011 BCD ================================================ */
-        /* ============================================================ */
-    case 0xb:
-        if (((insn >> 11) & 1) == 0) {
-            RETURN(OP_IN,insn);
-        } else {
-            RETURN(OP_OUT,insn);
-        }
-        break;
-
-        /* ============================================================ */
-        /* == 1100 BCD ================================================ */
-        /* ============================================================ */
-    case 0xc:
-        RETURN(OP_RJMP,insn);
-
-        /* ============================================================ */
-        /* == 1101 BCD ================================================ */
-        /* ============================================================ */
-    case 0xd:
-        RETURN(OP_RCALL,insn);
-
-        /* ============================================================ */
-        /* == 1110 BCD ================================================ */
-        /* ============================================================ */
-    case 0xe:
-        RETURN(OP_LDI,insn); /* = OP_SER */
-
-        /* ============================================================ */
-        /* == 1111 BCD ================================================ */
-        /* ============================================================ */
-    case 0xf:
-        if (((insn >> 11) & 1) == 0) {
-            if (((insn >> 10) & 1) == 0) {
-                RETURN(OP_BRBS,insn);
-            } else {
-                RETURN(OP_BRBC,insn);
-            }
-        } else {
-            switch ((insn >> 9) & 0x3) { /* 2b */
-            case 0x1: /* 1111 100x CD */
-                RETURN(OP_BLD,insn);
-            case 0x2: /* 1111 101x CD */
-                if (BIT(insn,3) == 0)
-                    RETURN(OP_BST,insn);
-                else
-                    UNKNOWN_OPCODE(insn);
-                break;
-            case 0x3: /* 1111 110x CD */
-                if (BIT(insn,3) == 0)
-                    RETURN(OP_SBRC,insn);
-                else
-                    UNKNOWN_OPCODE(insn);
-                break;
-            case 0x4: /* 1111 111x CD */
-                if (BIT(insn,3) == 0)
-                    RETURN(OP_SBRS,insn);
-                else
-                    UNKNOWN_OPCODE(insn);
-                break;
-            default:
-                UNKNOWN_OPCODE(insn);
-                break;
-            }
-        }
-        break;
-
-        /* ============================================================ */
-        /* ============================================================ */
-        /* ============================================================ */
-    default:
+    if (opcode == OP_UNKNOWN)
+    {
         UNKNOWN_OPCODE(insn);
-        break;
+        return 0;
     }
-    return 0;
+
+    /* skipped instructions only report their length */
+    if (MCU_ALU.skip_execute == 0)
+        return OPCODES[opcode].fun(opcode,insn);
+    else
+        return OPCODES[opcode].length;
 }
 
 /******************************************************************************************/
 /******************************************************************************************/
 /******************************************************************************************/
 
-void atmega128_mcu_update(unsigned int UNUSED cycles)
+#define NANO  (1000*1000*1000)
+
+void atmega128_mcu_update(unsigned int cycles)
 {
-    /* time update from cycles     */
+    uint64_t nano;
+
+    /* time update from cycles, the xtal is checked at creation */
+    if (MCU_ALU.clock_freq == 0)
+        return;
+    nano = (uint64_t)cycles * NANO + MCU_ALU.clock_nano_rem;
+    MCU_ALU.clock_nano_rem = nano % MCU_ALU.clock_freq;
+    MACHINE_TIME_SET_INCR(nano / MCU_ALU.clock_freq);
+
     /* internal devices update (1) */
     /* external devices update     */
     /* internal devices update (2) */
@@ -2912,8 +2505,11 @@ unsigned int atmega128_mcu_run_insn(void)
   
   MCU_ALU.pc = MCU_ALU.next_pc;
   insn = atmega128_flash_read_short(MCU_ALU.pc << 1);
+  MCU_ALU.cycles = 0;
   opcode = extract_opcode(insn);
+  cycles = MCU_ALU.cycles;
   MCU_INSN_CPT  += 1;
+  MCU_CYCLE_CPT += cycles;
 #if defined(ETRACE)
   /* eslot */
 #endif
@@ -62,6 +62,10 @@ struct atmega128_alu_t {
   uint16_t         interrupt_vector;
   uint64_t         insn_counter;
   uint64_t         cycle_counter;
+  uint32_t         cycles;          /* cycles of the current instruction */
+
+  uint32_t         clock_freq;      /* xtal, Hz                          */
+  uint32_t         clock_nano_rem;  /* cycles*NANO remainder, < freq     */
   uint32_t         signal;
 
   int              etracer_nseq_address;
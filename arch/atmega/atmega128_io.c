@@ -115,7 +115,7 @@ static int16_t atmega128_read16_sigbus(uint16_t addr)
 /* #if defined(DEBUG_IO) */
 /* addresses correspond to OUT opcode, do not use with ST */
 /* static */
-struct atmega128_io_addr_fptr_t atmega128_io_addr_fptr[MCU_IO_SIZE];
+WSIM_TLS struct atmega128_io_addr_fptr_t atmega128_io_addr_fptr[MCU_IO_SIZE];
 //= {
 /*
   { .read = atmega128_read8_sigbus, .write = atmega128_write8_sigbus, .name = "PINF"     },
@@ -64,7 +64,7 @@ void debug_write_binary(int UNUSED val, int size)
 
 char* unix_signal_to_str(int sig)
 {
-  static char sig_unknown[SIG_NAME_MAX]; 
+  static WSIM_TLS char sig_unknown[SIG_NAME_MAX]; 
 
   switch (sig)
     {
@@ -96,7 +96,7 @@ char* unix_signal_to_str(int sig)
 
 char* host_signal_str(int sig)
 {
-  static char buff[SIG_NAME_MAX];
+  static WSIM_TLS char buff[SIG_NAME_MAX];
 
 #if  0 /* defined(FUNC_STRSIGNAL_DEFINED) */
   strcpy(buff,strsignal(sig));
@@ -113,7 +113,7 @@ char* host_signal_str(int sig)
 
 static char* mcu_single_signal_str(uint32_t sig)
 {
-  static char sig_unknown[SIG_NAME_MAX]; 
+  static WSIM_TLS char sig_unknown[SIG_NAME_MAX]; 
   switch (sig)
     {
     case 0                  : return "";
@@ -172,7 +172,7 @@ char* mcu_signal_str(void)
   int i,first;
   uint32_t sig;
   char *s_sig;
-  static char buff[200];
+  static WSIM_TLS char buff[200];
 
   sig = mcu_signal_get();
   buff[0] = '\0';
@@ -16,6 +16,13 @@
 
 #define UNUSED __attribute__((unused))  
 
+/* node state, one copy per simulated node in multinode builds */
+#if defined(WSIM_MULTINODE)
+#define WSIM_TLS __thread
+#else
+#define WSIM_TLS
+#endif
+
 void     debug_write_binary  (int val, int size);
 void     debug_dump_section  (uint8_t* data, uint32_t addr, uint32_t size, int maxlines);
 
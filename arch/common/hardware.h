@@ -14,22 +14,28 @@
 
 typedef uint64_t wsimtime_t;
 
+/* event horizon: no state change is expected before this delay (ns) */
+#define WSIM_HORIZON_INF   ((wsimtime_t)-1)
+
 #define likely(x)       __builtin_expect((x),1)
 #define unlikely(x)     __builtin_expect((x),0)
 
 #include <inttypes.h>
 
+#include "arch/common/debug.h"
 #include "libtracer/tracer.h"
 #include "liblogger/logger.h"
 #include "liblogpkt/logpkt.h"
 #include "libselect/libselect.h"
 #include "libetrace/libetrace.h"
+#include "libetrace/energy.h"
 #include "libwsnet/libwsnet.h"
 #include "libgui/ui.h"
-#include "arch/common/debug.h"
 #include "arch/common/mcu.h"
 #include "devices/devices_fd.h"
 #include "machine/machine_fd.h"
+#include "machine/machine_prof.h"
+#include "machine/machine_fwprof.h"
 
 #define BIT(w,n)   ((w >> n) & 1)
 
@@ -135,8 +135,12 @@ void     mcu_signal_clr         (void);
 uint32_t mcu_signal_get         (void);
 char*    mcu_signal_str         (void);        /* debug.c */
 
-void     mcu_state_save         (void);
-void     mcu_state_restore      (void);
+int      mcu_state_save         (void);  /* returns bytes copied */
+int      mcu_state_restore      (void);
+
+int      mcu_state_size         (void);            /* checkpoint image size */
+void     mcu_state_export       (uint8_t *image);
+void     mcu_state_import       (uint8_t *image);
 
 void     mcu_dump_stats         (int64_t user_nanotime);
 
@@ -176,8 +180,8 @@ char*    mcu_ramctl_str         (int type);
  * This will have an influence on read before write error detection.
  *
  */
-extern uint8_t   MCU_RAMCTL [];
-extern uint32_t  MCU_RAMCTL_ADDR;
+extern WSIM_TLS uint8_t   MCU_RAMCTL [];
+extern WSIM_TLS uint32_t  MCU_RAMCTL_ADDR;
 #endif
 
 /* ************************************** */
@@ -21,8 +21,8 @@
  *
  */ 
 
-struct mcugen_mcu_t mcu;
-struct mcugen_mcu_t mcu_backup;
+WSIM_TLS struct mcugen_mcu_t mcu;
+WSIM_TLS struct mcugen_mcu_t mcu_backup;
 
 
 /* ************************************************** */
@@ -223,16 +223,17 @@ void mcu_dump_stats(int64_t UNUSED user_nanotime)
 }
 
 
-void mcu_state_save(void)
+int mcu_state_save(void)
 {
   memcpy(&mcu_backup,&mcu,sizeof(struct mcugen_mcu_t));
+  return sizeof(struct mcugen_mcu_t);
 }
 
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
 
-void mcu_state_restore(void)
+int mcu_state_restore(void)
 {
   int old_run_mode = mcugen_running_mode();
   memcpy(&mcu,&mcu_backup,sizeof(struct mcugen_mcu_t));
@@ -240,6 +241,31 @@ void mcu_state_restore(void)
     {
       mcu_signal_add( SIG_MCU_LPM_CHANGE );
     }
+  return sizeof(struct mcugen_mcu_t);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int mcu_state_size(void)
+{
+  return sizeof(struct mcugen_mcu_t);
+}
+
+void mcu_state_export(uint8_t *image)
+{
+  memcpy(image,&mcu,sizeof(struct mcugen_mcu_t));
+}
+
+void mcu_state_import(uint8_t *image)
+{
+  int old_run_mode = mcugen_running_mode();
+  memcpy(&mcu,image,sizeof(struct mcugen_mcu_t));
+  if (old_run_mode != mcugen_running_mode())
+    {
+      mcu_signal_add( SIG_MCU_LPM_CHANGE );
+    }
 }
 
 
@@ -26,8 +26,8 @@ struct mcugen_mcu_t {
 
 };
 
-extern struct mcugen_mcu_t mcu;
-extern struct mcugen_mcu_t mcu_backup;
+extern WSIM_TLS struct mcugen_mcu_t mcu;
+extern WSIM_TLS struct mcugen_mcu_t mcu_backup;
 
 #define MCU              mcu
 #define MCU_REGS         mcu.regs
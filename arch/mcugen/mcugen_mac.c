@@ -30,8 +30,8 @@
  * This will have an influence on read before write error detection.
  *
  */
-uint8_t  MCU_RAMCTL      [MAX_RAM_SIZE];
-uint32_t MCU_RAMCTL_ADDR;
+WSIM_TLS uint8_t  MCU_RAMCTL      [MAX_RAM_SIZE];
+WSIM_TLS uint32_t MCU_RAMCTL_ADDR;
 
 /* ************************************************** */
 /* ************************************************** */
@@ -7,6 +7,7 @@
  **/
 
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -25,29 +26,40 @@
  * This will have an influence on read before write error detection.
  *
  */
-uint8_t  MCU_RAMCTL     [MAX_RAM_SIZE];
-uint32_t MCU_RAMCTL_ADDR;
+WSIM_TLS uint8_t  MCU_RAMCTL     [MAX_RAM_SIZE];
+WSIM_TLS uint32_t MCU_RAMCTL_ADDR;
 #endif
 
-struct msp430_mcu_t mcu;
-struct msp430_mcu_t mcu_backup;
+WSIM_TLS struct msp430_mcu_t mcu;
+WSIM_TLS struct msp430_mcu_t mcu_backup;
 
-int msp430_trace_pc_switch;
-int msp430_trace_sp_switch;
+/* 
+ * RAM pages that differ between mcu and mcu_backup. The first save
+ * copies the whole RAM.
+ */
+WSIM_TLS uint8_t MCU_RAM_DIRTY[MCU_RAM_PAGES];
+static WSIM_TLS int mcu_backup_valid = 0;
+
+/* peripherals and registers stored after the RAM */
+#define MCU_STATE_REGS_OFFSET (offsetof(struct msp430_mcu_t, ram) + MAX_RAM_SIZE)
+#define MCU_STATE_REGS_SIZE   (sizeof(struct msp430_mcu_t) - MCU_STATE_REGS_OFFSET)
+
+WSIM_TLS int msp430_trace_pc_switch;
+WSIM_TLS int msp430_trace_sp_switch;
 
-tracer_id_t MSP430_TRACER_ACLK;
-tracer_id_t MSP430_TRACER_MCLK;
-tracer_id_t MSP430_TRACER_SMCLK;
-tracer_id_t MSP430_TRACER_GIE;
-tracer_id_t MSP430_TRACER_PC;
-tracer_id_t MSP430_TRACER_SP;
-tracer_id_t MSP430_TRACER_INTR;
-tracer_id_t MSP430_TRACER_LPM;
-tracer_id_t MSP430_TRACER_BKP;
-tracer_id_t MSP430_TRACER_USART0RX;
-tracer_id_t MSP430_TRACER_USART0TX;
-tracer_id_t MSP430_TRACER_USART1RX;
-tracer_id_t MSP430_TRACER_USART1TX;
+WSIM_TLS tracer_id_t MSP430_TRACER_ACLK;
+WSIM_TLS tracer_id_t MSP430_TRACER_MCLK;
+WSIM_TLS tracer_id_t MSP430_TRACER_SMCLK;
+WSIM_TLS tracer_id_t MSP430_TRACER_GIE;
+WSIM_TLS tracer_id_t MSP430_TRACER_PC;
+WSIM_TLS tracer_id_t MSP430_TRACER_SP;
+WSIM_TLS tracer_id_t MSP430_TRACER_INTR;
+WSIM_TLS tracer_id_t MSP430_TRACER_LPM;
+WSIM_TLS tracer_id_t MSP430_TRACER_BKP;
+WSIM_TLS tracer_id_t MSP430_TRACER_USART0RX;
+WSIM_TLS tracer_id_t MSP430_TRACER_USART0TX;
+WSIM_TLS tracer_id_t MSP430_TRACER_USART1RX;
+WSIM_TLS tracer_id_t MSP430_TRACER_USART1TX;
 
 /* ************************************************** */
 /* ************************************************** */
@@ -124,6 +136,8 @@ int mcu_options_add(void)
   options_add( &trace_pc_opt );
   options_add( &trace_sp_opt );
   msp430_adc_option_add();
+  msp430_tcache_option_add();
+  msp430_horizon_option_add();
   return 0;
 }
 
@@ -144,6 +158,24 @@ void msp430_infomem_init(void)
   }
 }
 
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/*
+ * energy accounting, msp430f1611 typical currents at 3V
+ *   active mode per MHz, the datasheet does not give it per instruction
+ *   low power modes indexed by RUNNING_MODE(), cpuoff bit set
+ */
+#define MSP430_ENERGY_ACTIVE_nA_MHz 500000
+
+static const uint32_t msp430_energy_mode_nA[ENERGY_MAX_STATES] = {
+  /* 0x0 */      0, /* LPM0 */  75000,      0,  75000,
+  /* 0x4 */      0, /* LPM1 */  75000,      0,  75000,
+  /* 0x8 */      0, /* LPM2 */  17000,      0,  17000,
+  /* 0xc */      0, /* LPM3 */   2600,      0, /* LPM4 */ 200
+};
+
 /* ************************************************** */
 /* ** MCU_CREATE ************************************ */
 /* ************************************************** */
@@ -167,6 +199,8 @@ int msp430_mcu_create(int xt1)
   MCU_INSN_CPT  = 0;
   MCU_CYCLE_CPT = 0;
 
+  msp430_tcache_create();
+  msp430_horizon_create();
   msp430_io_create();
   mcu_ramctl_init();
   msp430_infomem_init();
@@ -247,6 +281,8 @@ int msp430_mcu_create(int xt1)
   MSP430_TRACER_USART1RX = tracer_event_add_id(16, "Usart1_RX",  "msp430");
   MSP430_TRACER_USART1TX = tracer_event_add_id(16, "Usart1_TX",  "msp430");
 
+  energy_cpu_register("msp430", MSP430_ENERGY_ACTIVE_nA_MHz, msp430_energy_mode_nA);
+
   return ret;
 }
 
@@ -296,6 +332,9 @@ void mcu_reset()
   msp430_lcdb_reset();
   msp430_rtc_reset();
 
+  /* SR is cleared, back to active mode */
+  energy_cpu_mode(0);
+
 #if defined(SOFT_INTR)
   MCU.soft_intr         = 0;
   MCU.soft_intr_timeend = 0;
@@ -307,13 +346,16 @@ void mcu_reset()
 /* ************************************************** */
 /* ************************************************** */
 
-void msp430_devices_update(unsigned int cycles)
+void msp430_devices_update(unsigned int cycles, unsigned int slices)
 {
   int time;
   /*
    * clock must be first
    */
-  time = MCU_CLOCK_SYSTEM_UPDATE(cycles);
+  if (slices > 1)
+    time = MCU_CLOCK_SYSTEM_UPDATE_SLICES(cycles, slices);
+  else
+    time = MCU_CLOCK_SYSTEM_UPDATE(cycles);
   MACHINE_TIME_SET_INCR(time);
 
   msp430_sfr_update();
@@ -386,6 +428,7 @@ void mcu_update_done()
                   MACHINE_TIME_GET_NANO());
 
       TRACER_TRACE_LPM(curr_run_mode);
+      energy_cpu_mode((curr_run_mode & 1) ? curr_run_mode : 0);
       MCU_CLOCK_SYSTEM_SPEED_TRACER();
       mcu_signal_remove(SIG_MCU_LPM_CHANGE); 
        
@@ -408,6 +451,7 @@ void mcu_update_done()
 void mcu_run()
 {
   unsigned int cycles;
+  unsigned int slices = 1;
 
   MCU_ALU.curr_run_mode = RUNNING_MODE(); 
 
@@ -416,15 +460,17 @@ void mcu_run()
    */
   if ((MCU_ALU.curr_run_mode & 1) == 0)
     {
-      cycles = msp430_mcu_run_insn();
+      MACHINE_PROF(MPROF_MCU_ALU, cycles = msp430_mcu_run_insn());
     }
   else
     {
       /* VERBOSE(3,"msp430: run LPM mode\n"); */
       cycles = msp430_mcu_run_lpm();
+      /* merge LPM slices up to the next peripheral or device event */
+      slices = msp430_horizon_lpm_slices(cycles);
     }
 
-  msp430_devices_update(cycles);
+  MACHINE_PROF(MPROF_MCU_PERIPH, msp430_devices_update(cycles, slices));
 }
 
 /* ************************************************** */
@@ -451,30 +497,99 @@ msp430_reset_pin_assert()
 /* ************************************************** */
 /* ************************************************** */
 
-void mcu_state_save()
+/**
+ * copy registers, peripherals and dirty RAM pages from src to dst and
+ * clear the dirty pages. Returns the number of bytes copied.
+ **/
+
+static int msp430_state_copy(struct msp430_mcu_t *dst, struct msp430_mcu_t *src)
+{
+  int page;
+  int size = MCU_STATE_REGS_SIZE;
+
+  memcpy((uint8_t*)dst + MCU_STATE_REGS_OFFSET, 
+	 (uint8_t*)src + MCU_STATE_REGS_OFFSET, MCU_STATE_REGS_SIZE);
+
+  for(page = 0; page < MCU_RAM_PAGES; page++)
+    {
+      if (MCU_RAM_DIRTY[page])
+	{
+	  int offset = page << MCU_RAM_PAGE_SHIFT;
+	  memcpy(dst->ram + offset, src->ram + offset, MCU_RAM_PAGE_SIZE);
+	  MCU_RAM_DIRTY[page] = 0;
+	  size += MCU_RAM_PAGE_SIZE;
+	}
+    }
+  return size;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int mcu_state_save()
 {
+  int size;
   HW_DMSG_MSP("msp430: == state save \n");
   HW_DMSG_MSP("msp430: PC 0x%04x \n",mcu_get_pc());
   HW_DMSG_MSP("msp430: == \n");
-  memcpy(&mcu_backup,&mcu,sizeof(struct msp430_mcu_t));
+  if (mcu_backup_valid == 0)
+    {
+      memset(MCU_RAM_DIRTY, 1, MCU_RAM_PAGES);
+      mcu_backup_valid = 1;
+    }
+  size = msp430_state_copy(&mcu_backup, &mcu);
+  msp430_tcache_state_save();
+  return size;
 }
 
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
 
-void mcu_state_restore()
+int mcu_state_restore()
 {
+  int size;
   unsigned int old_run_mode = RUNNING_MODE();
   HW_DMSG_MSP("msp430: == state restore \n");
   HW_DMSG_MSP("msp430: OLD PC 0x%04x \n",mcu_get_pc());
-  memcpy(&mcu,&mcu_backup,sizeof(struct msp430_mcu_t));
+  /* pages written since the last save are the only ones that differ */
+  size = msp430_state_copy(&mcu, &mcu_backup);
+  msp430_tcache_state_restore();
   HW_DMSG_MSP("msp430: NEW PC 0x%04x \n",mcu_get_pc());
   HW_DMSG_MSP("msp430: == \n");
   if (old_run_mode != RUNNING_MODE())
     {
       mcu_signal_add( SIG_MCU_LPM_CHANGE );
     }
+  return size;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int mcu_state_size(void)
+{
+  return sizeof(struct msp430_mcu_t);
+}
+
+void mcu_state_export(uint8_t *image)
+{
+  memcpy(image,&mcu,sizeof(struct msp430_mcu_t));
+}
+
+void mcu_state_import(uint8_t *image)
+{
+  unsigned int old_run_mode = RUNNING_MODE();
+  memcpy(&mcu,image,sizeof(struct msp430_mcu_t));
+  /* mcu_backup and the translation cache no longer match */
+  memset(MCU_RAM_DIRTY, 1, MCU_RAM_PAGES);
+  msp430_tcache_flush();
+  if (old_run_mode != RUNNING_MODE())
+    {
+      mcu_signal_add( SIG_MCU_LPM_CHANGE );
+    }
 }
 
 /* ************************************************** */
@@ -512,6 +627,8 @@ void mcu_dump_stats(int64_t user_nanotime)
   OUTPUT_STATS("  mcu exit at PC                : 0x%04x\n",mcu_get_pc());
   OUTPUT_STATS("  mcu exit in LPM mode          : %s\n",msp430_lpm_names[RUNNING_MODE()]);
   OUTPUT_STATS("  mcu exit with IV              : 0x%08x\n",MCU_IV);
+  msp430_tcache_dump_stats();
+  msp430_horizon_dump_stats();
 }
 
 /* ************************************************** */
@@ -611,7 +728,9 @@ uint16_t  mcu_jtag_read_word(uint16_t addr)
 void mcu_jtag_write_byte(uint16_t addr, uint8_t val)
 {
   MCU_RAM[addr] = val;
+  MCU_RAM_DIRTY_SET(addr);
   mcu_ramctl_write(addr);
+  msp430_tcache_invalidate(addr, 1);
 }
 
 /* ************************************************** */
@@ -622,8 +741,11 @@ void mcu_jtag_write_word(uint16_t addr, uint16_t val)
 {
   MCU_RAM[addr    ] = (val & 0xff);
   MCU_RAM[addr + 1] = (val >> 8) & 0xff;
+  MCU_RAM_DIRTY_SET(addr);
+  MCU_RAM_DIRTY_SET(addr + 1);
   mcu_ramctl_write(addr);
   mcu_ramctl_write(addr+1);
+  msp430_tcache_invalidate(addr, 2);
 }
 
 /* ************************************************** */
@@ -647,10 +769,27 @@ int mcu_jtag_read_section(uint8_t *mem, uint16_t start, uint16_t size)
 /* ************************************************** */
 /* ************************************************** */
 
+static void mcu_ram_dirty_block(uint16_t start, uint16_t size)
+{
+  uint32_t addr;
+  uint32_t stop = (uint32_t)start + size;
+
+  for(addr = start & ~(MCU_RAM_PAGE_SIZE - 1); addr < stop; addr += MCU_RAM_PAGE_SIZE)
+    {
+      MCU_RAM_DIRTY_SET(addr);
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 void mcu_jtag_write_section(uint8_t *mem, uint16_t start, uint16_t size)
 {
   memcpy(MCU_RAM + start, mem, size);
+  mcu_ram_dirty_block(start,size);
   mcu_ramctl_write_block(start,size);
+  msp430_tcache_invalidate(start,size);
 }
 
 /* ************************************************** */
@@ -660,7 +799,9 @@ void mcu_jtag_write_section(uint8_t *mem, uint16_t start, uint16_t size)
 void mcu_jtag_write_zero(uint16_t start, uint16_t size)
 {
   memset(MCU_RAM + start, 0, size);
+  mcu_ram_dirty_block(start,size);
   mcu_ramctl_write_block(start,size);
+  msp430_tcache_invalidate(start,size);
 }
 
 /* ************************************************** */
@@ -18,11 +18,14 @@
 #include "msp430_debug.h"
 #include "msp430_sfr.h"
 #include "msp430_intr.h"
+#include "msp430_horizon.h"
+#include "msp430_clock.h"
 #include "msp430_fll_clock.h"
 #include "msp430_basic_clock.h"
 #include "msp430_basic_clock_plus.h"
 #include "msp430_alu.h"
 #include "msp430_io.h"
+#include "msp430_tcache.h"
 #include "msp430_hwmul.h"
 #include "msp430_digiIO.h"
 #include "msp430_uscia.h"
@@ -45,6 +48,7 @@
 #include "msp430_ucs.h"
 #include "msp430_portmap.h"
 #include "msp430_rtc.h"
+#include "msp430_devnet.h"
 
   /**
    * 0x0ffff
@@ -69,27 +73,36 @@
 
 #define MAX_RAM_SIZE   0x10000 /* 64KB */
 
+/**
+ * RAM pages written since the last state save. Only dirty pages are
+ * copied by mcu_state_save() and mcu_state_restore(). Every write to
+ * MCU_RAM must go through MCU_RAM_DIRTY_SET().
+ **/
+#define MCU_RAM_PAGE_SHIFT   8
+#define MCU_RAM_PAGE_SIZE    (1 << MCU_RAM_PAGE_SHIFT)
+#define MCU_RAM_PAGES        (MAX_RAM_SIZE >> MCU_RAM_PAGE_SHIFT)
+
 #define MCU_T msp430_mcu_t  
 
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
 
-extern int msp430_trace_pc_switch;
-extern int msp430_trace_sp_switch;
-extern tracer_id_t MSP430_TRACER_ACLK;
-extern tracer_id_t MSP430_TRACER_MCLK;
-extern tracer_id_t MSP430_TRACER_SMCLK;
-extern tracer_id_t MSP430_TRACER_GIE;
-extern tracer_id_t MSP430_TRACER_PC;
-extern tracer_id_t MSP430_TRACER_SP;
-extern tracer_id_t MSP430_TRACER_INTR;
-extern tracer_id_t MSP430_TRACER_LPM;
-extern tracer_id_t MSP430_TRACER_BKP;
-extern tracer_id_t MSP430_TRACER_USART0RX;
-extern tracer_id_t MSP430_TRACER_USART0TX;
-extern tracer_id_t MSP430_TRACER_USART1RX;
-extern tracer_id_t MSP430_TRACER_USART1TX;
+extern WSIM_TLS int msp430_trace_pc_switch;
+extern WSIM_TLS int msp430_trace_sp_switch;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_ACLK;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_MCLK;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_SMCLK;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_GIE;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_PC;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_SP;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_INTR;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_LPM;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_BKP;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_USART0RX;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_USART0TX;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_USART1RX;
+extern WSIM_TLS tracer_id_t MSP430_TRACER_USART1TX;
 //extern tracer_id_t MSP430_TRACER_USCIB0;
 
 #if defined(XCODE_DEBUG)
@@ -244,8 +257,8 @@ struct msp430_mcu_t {
 /* ************************************************** */
 /* ************************************************** */
 
-extern struct msp430_mcu_t mcu;
-extern struct msp430_mcu_t mcu_backup;
+extern WSIM_TLS struct msp430_mcu_t mcu;
+extern WSIM_TLS struct msp430_mcu_t mcu_backup;
 
 #define MCU                mcu
 #define MCU_ALU            MCU.alu
@@ -257,6 +270,10 @@ extern struct msp430_mcu_t mcu_backup;
 #define MCU_HWMUL          MCU.hwmul
 #define MCU_FLASH          MCU.flash
 #define MCU_RAM            MCU.ram
+
+extern WSIM_TLS uint8_t MCU_RAM_DIRTY[MCU_RAM_PAGES];
+#define MCU_RAM_DIRTY_SET(addr)        \
+  MCU_RAM_DIRTY[((addr) & 0xffffu) >> MCU_RAM_PAGE_SHIFT] = 1
 #define MCU_DMA            MCU.dma
 
 #if defined(__msp430_have_basic_clock)
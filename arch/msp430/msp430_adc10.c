@@ -46,8 +46,8 @@ enum adc10_addr_t {
   ADC10SA   = ADC10_BASE + 0x01BC  /* 16 */
 };
 
-tracer_id_t MSP430_TRACER_ADC10STATE;
-tracer_id_t MSP430_TRACER_ADC10INPUT[ADC10_CHANNELS];
+WSIM_TLS tracer_id_t MSP430_TRACER_ADC10STATE;
+WSIM_TLS tracer_id_t MSP430_TRACER_ADC10INPUT[ADC10_CHANNELS];
 
 #define ADC10_TRACER_STATE(v)   tracer_event_record(MSP430_TRACER_ADC10STATE, v)
 #define ADC10_TRACER_INPUT(i,v) tracer_event_record(MSP430_TRACER_ADC10INPUT[i], v)
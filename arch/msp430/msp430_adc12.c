@@ -89,8 +89,8 @@ enum adc12_addr_t {
 /* ************************************************** */
 /* ************************************************** */
 
-tracer_id_t MSP430_TRACER_ADC12STATE;
-tracer_id_t MSP430_TRACER_ADC12INPUT[ADC12_CHANNELS];
+WSIM_TLS tracer_id_t MSP430_TRACER_ADC12STATE;
+WSIM_TLS tracer_id_t MSP430_TRACER_ADC12INPUT[ADC12_CHANNELS];
 
 #define ADC12_TRACER_STATE(v)   tracer_event_record(MSP430_TRACER_ADC12STATE, v)
 #define ADC12_TRACER_INPUT(i,v) tracer_event_record(MSP430_TRACER_ADC12INPUT[i], v)
@@ -496,7 +496,7 @@ int16_t msp430_adc12_read16(uint16_t addr)
   int16_t ret = 0;
 
   /*
-  static int tinyos_read_this_too_many_times = 0;
+  static WSIM_TLS int tinyos_read_this_too_many_times = 0;
   if (tinyos_read_this_too_many_times == 0)
     {
       HW_DMSG_ADC12("msp430:adc12: read16 at [0x%04x] \n",addr);
@@ -572,7 +572,7 @@ int8_t msp430_adc12_read8(uint16_t addr)
   int8_t ret = 0;
 
   /*
-  static int tinyos_read_this_too_many_times = 0;
+  static WSIM_TLS int tinyos_read_this_too_many_times = 0;
   if (tinyos_read_this_too_many_times == 0)
     {
       HW_DMSG_ADC12("msp430:adc12: read8 at [0x%04x] \n",addr);
@@ -861,6 +861,16 @@ void msp430_adc12_write8(uint16_t addr, int8_t val)
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
+
+wsimtime_t msp430_adc12_horizon(void)
+{
+  return (MCU.adc12.ctl0.b.adc12on == 0) ? WSIM_HORIZON_INF : 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 /*
 ADC12IV                                           Interrupt
 Contents                                          Priority
@@ -215,6 +215,7 @@ int8_t  msp430_adc12_read8      (uint16_t addr);
 void    msp430_adc12_write8     (uint16_t addr, int8_t val);
 
 int     msp430_adc12_chkifg     (void);
+wsimtime_t msp430_adc12_horizon (void);
 
 /* ************************************************** */
 /* ************************************************** */
@@ -223,5 +224,6 @@ int     msp430_adc12_chkifg     (void);
 #define msp430_adc12_create()      do { } while (0)
 #define msp430_adc12_reset()       do { } while (0)
 #define msp430_adc12_update()      do { } while (0)
+#define msp430_adc12_horizon()     WSIM_HORIZON_INF
 #endif /* have_adc12 */
 #endif
@@ -23,8 +23,8 @@
 /**
  * global variables used in this file
  *
- * static struct msp430_op_type1 opt1;
- * static struct msp430_op_type2 opt2;
+ * static WSIM_TLS struct msp430_op_type1 opt1;
+ * static WSIM_TLS struct msp430_op_type2 opt2;
  *
  */ 
 
@@ -209,8 +209,13 @@ static inline unsigned int extract_opcode(uint16_t insn)
 #if ETRACE
 #define ETRACER_SET_JUMP_TYPE(x)  MCU_ALU.etracer_branch_type    = x
 #define ETRACER_BRANCH(x)         MCU_ALU.etracer_branch_type    = x
+#else
+#define ETRACER_SET_JUMP()       do { } while (0)
+#define ETRACER_SET_JUMP_TYPE(x) do { } while (0)
+#define ETRACER_BRANCH(x)        do { } while (0)
+#endif
 
-
+/* instruction class, given to the slot stream consumers */
 static inline int msp430_insn_class(int opcode)
 {
   switch (opcode)
@@ -262,13 +267,6 @@ static inline int msp430_insn_class(int opcode)
   return 0;
 }
 
-#else
-#define ETRACER_SET_JUMP()       do { } while (0)
-#define ETRACER_SET_JUMP_TYPE(x) do { } while (0)
-#define ETRACER_BRANCH(x)        do { } while (0)
-#define msp430_insn_class(x)     do { } while (0)
-#endif
-
 /******************************************************************************************/
 /** TYPE 1 DOUBLE OPERANDS ****************************************************************/
 /******************************************************************************************/
@@ -339,7 +337,7 @@ struct msp430_op_type1
 /**
  * global variable used for type1 operations
  **/
-static struct msp430_op_type1 opt1;
+static WSIM_TLS struct msp430_op_type1 opt1;
 
 #define READ_SRC(byte,offset) ((byte) ? msp430_read_byte( offset ) & 0xff : msp430_read_short( offset ))
 
@@ -572,7 +570,7 @@ struct msp430_op_type2
 /**
  * global variable used for type2 operations
  **/
-static struct msp430_op_type2 opt2;
+static WSIM_TLS struct msp430_op_type2 opt2;
 
 /** 
  * opt2 structure decode from instruction 
@@ -853,6 +851,474 @@ static int opt2_cycles_class2[5] = {  3, 4,  5,  4,  5 }; // OP_PUSH
 static int opt2_cycles_class3[5] = {  4, 4,  5,  5,  5 }; // OP_CALL 
 
 
+/******************************************************************************************/
+/** TRANSLATION CACHE *********************************************************************/
+/******************************************************************************************/
+
+/**
+ * Predecode an operand from the (as|ad, register) pair. The decode tree is
+ * the same as in msp430_type1_double_operands() and msp430_type2_single_operand().
+ * Extension words are read using JTAG access functions, memory side
+ * effects are replayed when the record is used.
+ **/
+
+static void msp430_predecode_operand(struct msp430_tcache_opd_t *opd, int as, int reg, int byte,
+				     int type2, uint16_t *decode_next_pc, uint8_t *mode, uint8_t *t_mode)
+{
+  uint16_t pc = *decode_next_pc;
+
+  opd->reg      = reg;
+  opd->ext      = 0;
+  opd->ext_addr = 0;
+  opd->k        = 0;
+
+  switch (as)
+    {
+    case 0x0: /* register */
+      switch (reg)
+	{
+	case PC_REG_IDX:
+	  opd->kind = TC_OPD_CONST;
+	  opd->k    = pc;
+	  *mode     = REG_MODE;
+	  break;
+	case CG2_REG_IDX:
+	  opd->kind = TC_OPD_CONST;
+	  opd->k    = 0x0000;
+	  *mode     = CST_MODE;
+	  break;
+	default:
+	  opd->kind = TC_OPD_REG;
+	  *mode     = REG_MODE;
+	  break;
+	}
+      *t_mode = SRC_TIMING_0;
+      break;
+
+    case 0x1: /* indexed, symbolic, absolute */
+      if (reg == CG2_REG_IDX)
+	{
+	  opd->kind = TC_OPD_CONST;
+	  opd->k    = 0x0001;
+	  *mode     = CST_MODE;
+	  *t_mode   = SRC_TIMING_0;
+	  break;
+	}
+      opd->ext      = 1;
+      opd->ext_addr = pc;
+      switch (reg)
+	{
+	case PC_REG_IDX:  /* symbolic : [ PC+2 ] + PC */
+	  opd->kind = TC_OPD_ADDR16;
+	  opd->k    = mcu_jtag_read_word(pc) + pc;
+	  break;
+	case CG1_REG_IDX: /* absolute */
+	  opd->kind = TC_OPD_ADDR;
+	  opd->k    = mcu_jtag_read_word(pc);
+	  break;
+	default:          /* index */
+	  opd->kind = TC_OPD_INDEX;
+	  opd->k    = mcu_jtag_read_word(pc);
+	  break;
+	}
+      *mode   = MEM_MODE;
+      *t_mode = type2 ? OPT2_TIMING_4 : SRC_TIMING_3;
+      *decode_next_pc += 2;
+      break;
+
+    case 0x2: /* indirect */
+      switch (reg)
+	{
+	case PC_REG_IDX:
+	  opd->kind = TC_OPD_ADDR;
+	  opd->k    = pc;
+	  *mode     = MEM_MODE;
+	  *t_mode   = SRC_TIMING_1;
+	  break;
+	case CG1_REG_IDX:
+	  opd->kind = TC_OPD_CONST;
+	  opd->k    = 0x0004;
+	  *mode     = CST_MODE;
+	  *t_mode   = SRC_TIMING_0;
+	  break;
+	case CG2_REG_IDX:
+	  opd->kind = TC_OPD_CONST;
+	  opd->k    = 0x0002;
+	  *mode     = CST_MODE;
+	  *t_mode   = SRC_TIMING_0;
+	  break;
+	default:
+	  opd->kind = TC_OPD_INDIR;
+	  *mode     = MEM_MODE;
+	  *t_mode   = SRC_TIMING_1;
+	  break;
+	}
+      break;
+
+    case 0x3: /* indirect autoincrement, immediate */
+      switch (reg)
+	{
+	case PC_REG_IDX:
+	  if (type2 || (byte == 0))
+	    {
+	      /* type 2 immediate is always read as a word */
+	      opd->kind     = TC_OPD_IMM;
+	      opd->ext      = 1;
+	      opd->ext_addr = pc;
+	      opd->k        = mcu_jtag_read_word(pc);
+	    }
+	  else
+	    {
+	      opd->kind     = TC_OPD_ADDR;
+	      opd->k        = pc;
+	    }
+	  *mode   = MEM_MODE;
+	  *t_mode = type2 ? OPT2_TIMING_3 : SRC_TIMING_2;
+	  *decode_next_pc += 2;
+	  break;
+	case CG1_REG_IDX:
+	  opd->kind = TC_OPD_CONST;
+	  opd->k    = 0x0008;
+	  *mode     = CST_MODE;
+	  *t_mode   = SRC_TIMING_0;
+	  break;
+	case CG2_REG_IDX:
+	  opd->kind = TC_OPD_CONST;
+	  opd->k    = 0xffff;
+	  *mode     = CST_MODE;
+	  *t_mode   = SRC_TIMING_0;
+	  break;
+	default:
+	  opd->kind = TC_OPD_INDINC;
+	  *mode     = MEM_MODE;
+	  *t_mode   = SRC_TIMING_2;
+	  break;
+	}
+      break;
+    }
+}
+
+/**
+ * fills a translation cache record from the instruction at pc
+ **/
+
+int msp430_alu_predecode(uint16_t pc, struct msp430_tcache_insn_t *tc)
+{
+  uint16_t insn;
+  uint16_t decode_next_pc;
+
+  memset(tc, 0, sizeof(struct msp430_tcache_insn_t));
+  insn           = mcu_jtag_read_word(pc);
+  decode_next_pc = pc + 2;
+
+  tc->insn   = insn;
+  tc->opcode = extract_opcode(insn);
+
+  switch (tc->opcode)
+    {
+    case OP_MOV:  case OP_ADD:  case OP_ADDC: case OP_SUBC:
+    case OP_SUB:  case OP_CMP:  case OP_DADD: case OP_BIT:
+    case OP_BIC:  case OP_BIS:  case OP_XOR:  case OP_AND:
+      {
+	int as     = (insn >> 4) & 0x3;
+	int ad     = (insn >> 7) & 0x1;
+	int sreg   = (insn >> 8) & 0xf;
+	int dreg   = (insn >> 0) & 0xf;
+	uint8_t unused;
+
+	tc->byte = (insn >> 6) & 0x1;
+	msp430_predecode_operand(&tc->src, as, sreg, tc->byte, 0, &decode_next_pc, &unused, &tc->src_t_mode);
+
+	tc->dst.reg = dreg;
+	if (ad == 0)
+	  {
+	    tc->dst.kind   = TC_OPD_REG;
+	    tc->mode       = REG_MODE;
+	    tc->dst_t_mode = (dreg == PC_REG_IDX) ? DST_TIMING_1+1 : DST_TIMING_1;
+	    /* CMP and BIT do not write their destination */
+	    if ((dreg == PC_REG_IDX) && (tc->opcode != OP_CMP) && (tc->opcode != OP_BIT))
+	      tc->eob = 1;
+	  }
+	else
+	  {
+	    tc->dst.ext      = 1;
+	    tc->dst.ext_addr = decode_next_pc;
+	    switch (dreg)
+	      {
+	      case PC_REG_IDX: /* symbolic */
+		tc->dst.kind = TC_OPD_ADDR;
+		tc->dst.k    = mcu_jtag_read_word(decode_next_pc) + decode_next_pc;
+		break;
+	      case SR_REG_IDX: /* absolute */
+		tc->dst.kind = TC_OPD_ADDR;
+		tc->dst.k    = mcu_jtag_read_word(decode_next_pc);
+		break;
+	      default:         /* index */
+		tc->dst.kind = TC_OPD_INDEX;
+		tc->dst.k    = mcu_jtag_read_word(decode_next_pc);
+		break;
+	      }
+	    tc->mode       = MEM_MODE;
+	    tc->dst_t_mode = DST_TIMING_2;
+	    decode_next_pc += 2;
+	  }
+	tc->cycles = opt1_cycles_class[tc->src_t_mode][tc->dst_t_mode];
+	/* software breakpoints and traps, mov rn,rn */
+	if ((tc->opcode == OP_MOV) && (sreg == dreg) && (as == 0) && (ad == 0))
+	  tc->eob = 1;
+      }
+      break;
+
+    case OP_RRC:  case OP_SWPB: case OP_RRA:  case OP_SXT:
+    case OP_PUSH: case OP_CALL:
+      {
+	int ad  = (insn >> 4) & 0x3;
+	int reg = (insn >> 0) & 0xf;
+
+	tc->byte = (insn >> 6) & 0x1;
+	msp430_predecode_operand(&tc->src, ad, reg, tc->byte, 1, &decode_next_pc, &tc->mode, &tc->src_t_mode);
+	switch (tc->opcode)
+	  {
+	  case OP_PUSH:
+	    tc->cycles = opt2_cycles_class2[tc->src_t_mode];
+	    break;
+	  case OP_CALL:
+	    tc->cycles = opt2_cycles_class3[tc->src_t_mode];
+	    tc->eob    = 1;
+	    break;
+	  default:
+	    tc->cycles = opt2_cycles_class1[tc->src_t_mode];
+	    if ((tc->mode == REG_MODE) && (reg == PC_REG_IDX))
+	      tc->eob  = 1;
+	    break;
+	  }
+      }
+      break;
+
+    case OP_RETI:
+      tc->cycles = 5;
+      tc->eob    = 1;
+      break;
+
+    case OP_JNZ:  case OP_JZ:   case OP_JNC:  case OP_JC:
+    case OP_JN:   case OP_JGE:  case OP_JL:   case OP_JMP:
+      tc->offset = insn & 0x3ff;
+      if (tc->offset & 0x200)
+	{
+	  tc->offset |= ~0x3ff;
+	}
+      tc->offset <<= 1;
+      tc->cycles   = 2;
+      tc->eob      = 1;
+      break;
+
+    default: /* traps and illegal instructions */
+      tc->cycles = 0;
+      tc->eob    = 1;
+      break;
+    }
+
+  /* extension words must stay within the flash */
+  tc->size  = (uint16_t)(decode_next_pc - pc);
+  if (((uint32_t)pc + tc->size - 1) > ADDR_FLASH_STOP)
+    {
+      tc->valid = 0;
+      return 1;
+    }
+
+  tc->valid = 1;
+  return 0;
+}
+
+/**
+ * operand value from a record, replays the memory accesses done by
+ * the interpreter
+ **/
+
+static inline int16_t msp430_tcache_operand(struct msp430_tcache_opd_t *opd, int byte, uint16_t *addr)
+{
+  int16_t val;
+
+  if (opd->ext)
+    {
+      msp430_read_short_access(opd->ext_addr);
+    }
+
+  switch (opd->kind)
+    {
+    case TC_OPD_REG:
+      return MCU_ALU.regs[opd->reg];
+    case TC_OPD_CONST:
+      return opd->k;
+    case TC_OPD_IMM:
+      *addr = opd->ext_addr;
+      return opd->k;
+    case TC_OPD_ADDR:
+      *addr = opd->k;
+      return READ_SRC(byte, *addr);
+    case TC_OPD_ADDR16:
+      *addr = opd->k;
+      return msp430_read_short(*addr);
+    case TC_OPD_INDEX:
+      *addr = opd->k + MCU_ALU.regs[opd->reg];
+      return READ_SRC(byte, *addr);
+    case TC_OPD_INDIR:
+      *addr = MCU_ALU.regs[opd->reg];
+      return READ_SRC(byte, *addr);
+    case TC_OPD_INDINC:
+      *addr = MCU_ALU.regs[opd->reg];
+      val   = READ_SRC(byte, *addr);
+      MCU_ALU.regs[opd->reg] += byte ? 1 : 2;
+      return val;
+    default:
+      return 0;
+    }
+}
+
+/**
+ * opt1 / opt2 / opt3 from a translation cache record
+ **/
+
+static void msp430_type1_tcache(struct msp430_tcache_insn_t *tc)
+{
+  uint16_t s_offset;
+  uint16_t decode_next_pc = mcu_get_pc() + tc->size;
+
+  opt1.src_reg    = tc->src.reg;
+  opt1.dst_reg    = tc->dst.reg;
+  opt1.byte       = tc->byte;
+  opt1.src_val    = msp430_tcache_operand(&tc->src, tc->byte, &s_offset);
+  opt1.src_t_mode = tc->src_t_mode;
+  opt1.dst_t_mode = tc->dst_t_mode;
+  opt1.dst_mode   = tc->mode;
+
+  if (tc->mode == MEM_MODE)
+    {
+      msp430_read_short_access(tc->dst.ext_addr);
+      opt1.dst_addr = tc->dst.k;
+      if (tc->dst.kind == TC_OPD_INDEX)
+	{
+	  opt1.dst_addr += MCU_ALU.regs[opt1.dst_reg];
+	}
+    }
+
+  mcu_set_pc_next(decode_next_pc);
+#if defined(ETRACE)
+  MCU_ALU.sequ_pc = decode_next_pc;
+#endif
+}
+
+static void msp430_type2_tcache(struct msp430_tcache_insn_t *tc)
+{
+  uint16_t decode_next_pc = mcu_get_pc() + tc->size;
+
+  opt2.reg    = tc->src.reg;
+  opt2.byte   = tc->byte;
+  opt2.mode   = tc->mode;
+  opt2.t_mode = tc->src_t_mode;
+  opt2.val    = msp430_tcache_operand(&tc->src, tc->byte, &opt2.addr);
+
+  mcu_set_pc_next(decode_next_pc);
+#if defined(ETRACE)
+  MCU_ALU.sequ_pc = decode_next_pc;
+#endif
+}
+
+static inline int16_t msp430_type3_tcache(struct msp430_tcache_insn_t *tc)
+{
+  uint16_t decode_next_pc = mcu_get_pc() + 2;
+  mcu_set_pc_next(decode_next_pc);
+#if defined(ETRACE)
+  MCU_ALU.sequ_pc = decode_next_pc;
+#endif
+  return tc->offset;
+}
+
+/**
+ * lockstep mode, decode results of the interpreter are checked
+ * against the record
+ **/
+
+#define TCACHE_CHECK(field,c,i)						\
+  do {									\
+    if ((c) != (i))							\
+      msp430_tcache_lockstep_error(MCU_ALU.curr_pc, field, c, i);	\
+  } while (0)
+
+static void msp430_type1_tcache_check(struct msp430_tcache_insn_t *tc)
+{
+  msp430_tcache.lockstep_checks ++;
+  TCACHE_CHECK("size",       tc->size,       mcu_get_pc_next() - mcu_get_pc());
+  TCACHE_CHECK("byte",       tc->byte,       opt1.byte);
+  TCACHE_CHECK("src_reg",    tc->src.reg,    opt1.src_reg);
+  TCACHE_CHECK("dst_reg",    tc->dst.reg,    opt1.dst_reg);
+  TCACHE_CHECK("src_t_mode", tc->src_t_mode, opt1.src_t_mode);
+  TCACHE_CHECK("dst_t_mode", tc->dst_t_mode, opt1.dst_t_mode);
+  TCACHE_CHECK("dst_mode",   tc->mode,       opt1.dst_mode);
+  if ((tc->src.kind == TC_OPD_CONST) || (tc->src.kind == TC_OPD_IMM))
+    TCACHE_CHECK("src_val",  tc->src.k,      (uint16_t)opt1.src_val);
+  if ((tc->mode == MEM_MODE) && (tc->dst.kind == TC_OPD_ADDR))
+    TCACHE_CHECK("dst_addr", tc->dst.k,      opt1.dst_addr);
+}
+
+static void msp430_type2_tcache_check(struct msp430_tcache_insn_t *tc)
+{
+  msp430_tcache.lockstep_checks ++;
+  TCACHE_CHECK("size",       tc->size,       mcu_get_pc_next() - mcu_get_pc());
+  TCACHE_CHECK("byte",       tc->byte,       opt2.byte);
+  TCACHE_CHECK("reg",        tc->src.reg,    opt2.reg);
+  TCACHE_CHECK("mode",       tc->mode,       opt2.mode);
+  TCACHE_CHECK("t_mode",     tc->src_t_mode, opt2.t_mode);
+  if ((tc->src.kind == TC_OPD_CONST) || (tc->src.kind == TC_OPD_IMM))
+    TCACHE_CHECK("val",      tc->src.k,      (uint16_t)opt2.val);
+  if ((tc->src.kind == TC_OPD_ADDR) || (tc->src.kind == TC_OPD_ADDR16))
+    TCACHE_CHECK("addr",     tc->src.k,      opt2.addr);
+  if (tc->src.kind == TC_OPD_IMM)
+    TCACHE_CHECK("addr",     tc->src.ext_addr, opt2.addr);
+}
+
+static int16_t msp430_type3_tcache_check(struct msp430_tcache_insn_t *tc, int16_t offset)
+{
+  msp430_tcache.lockstep_checks ++;
+  TCACHE_CHECK("size",       tc->size,       mcu_get_pc_next() - mcu_get_pc());
+  TCACHE_CHECK("offset",     tc->offset,     offset);
+  return offset;
+}
+
+/**
+ * operand decode selection, either from the record (tc) or from the
+ * interpreter (with optional lockstep check against tcl)
+ **/
+
+#define OPT1_DECODE(insn)				\
+  do {							\
+    if (tc != NULL)					\
+      msp430_type1_tcache(tc);				\
+    else						\
+      {							\
+	msp430_type1_double_operands(insn);		\
+	if (tcl != NULL)				\
+	  msp430_type1_tcache_check(tcl);		\
+      }							\
+  } while (0)
+
+#define OPT2_DECODE(insn)				\
+  do {							\
+    if (tc != NULL)					\
+      msp430_type2_tcache(tc);				\
+    else						\
+      {							\
+	msp430_type2_single_operand(insn);		\
+	if (tcl != NULL)				\
+	  msp430_type2_tcache_check(tcl);		\
+      }							\
+  } while (0)
+
+#define OPT3_DECODE(insn)						\
+  ((tc != NULL) ? msp430_type3_tcache(tc) :				\
+   ((tcl != NULL) ? msp430_type3_tcache_check(tcl, msp430_type3_offset(insn)) : \
+    msp430_type3_offset(insn)))
+
 /******************************************************************************************/
 /******************************************************************************************/
 /******************************************************************************************/
@@ -947,6 +1413,8 @@ unsigned int msp430_mcu_run_insn()
       uint16_t insn;
       unsigned int opcode;
       unsigned int msp430_instruction_cycles = 0; // used through SET_CYCLES(n)
+      struct msp430_tcache_insn_t *tc  = NULL; /* predecoded instruction     */
+      struct msp430_tcache_insn_t *tcl = NULL; /* lockstep check instruction */
 
 #if DEBUG_ME_HARDER != 0
       uint16_t debug_SR = SR;
@@ -969,17 +1437,47 @@ unsigned int msp430_mcu_run_insn()
 
       HW_DMSG_FD("msp430: -- Fetch start - 0x%04x ---------------------------------\n",MCU_ALU.curr_pc);
 
+      if (msp430_tcache_usable(MCU_ALU.curr_pc))
+	{
+	  if (msp430_tcache.mode == TCACHE_ON)
+	    tc  = msp430_tcache_get(MCU_ALU.curr_pc);
+	  else
+	    tcl = msp430_tcache_get(MCU_ALU.curr_pc);
+	}
+
       /* fetch */
-      insn = msp430_fetch_short(MCU_ALU.curr_pc);
+      if (tc != NULL)
+	{
+	  msp430_fetch_short_access(MCU_ALU.curr_pc);
+	  insn = tc->insn;
+	}
+      else
+	{
+	  insn = msp430_fetch_short(MCU_ALU.curr_pc);
+	}
       TRACER_TRACE_PC(MCU_ALU.curr_pc);
       if ((mcu_signal_get() & SIG_MAC) != 0)
 	{
 	  insn = 0x0000; /* extract_opcode will return 0; */
+	  tc   = NULL;
+	  tcl  = NULL;
 	  HW_DMSG_FD("msp430:alu:  Memory Access Control on fetch at 0x%04x\n",MCU_ALU.curr_pc);
 	}
 
       /* decode */
-      opcode = extract_opcode(insn);
+      if (tc != NULL)
+	{
+	  opcode = tc->opcode;
+	}
+      else
+	{
+	  opcode = extract_opcode(insn);
+	  if (tcl != NULL)
+	    {
+	      TCACHE_CHECK("insn",   tcl->insn,   insn);
+	      TCACHE_CHECK("opcode", tcl->opcode, opcode);
+	    }
+	}
       if ((mcu_signal_get() & SIG_MAC) != 0)
 	{
 	  HW_DMSG_FD("msp430:alu:  Memory Access Control on operand at 0x%04x\n",MCU_ALU.curr_pc);
@@ -1019,7 +1517,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_RRA: 
 	  {
 	    int16_t result;
-	    msp430_type2_single_operand( insn );
+	    OPT2_DECODE( insn );
 	    result = opt2.val;
 	    result = (result & BIT_MSB_MASK(opt2.byte)) | ((result>>1) & (opt2.byte ? 0x7f : 0x7fff) );
 	    WRITE_OPT2;
@@ -1037,7 +1535,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_RRC:
 	  {
 	    int16_t result;
-	    msp430_type2_single_operand( insn );
+	    OPT2_DECODE( insn );
 	    if (opt2.byte) /* 8 bits */
 	      {
 		result  = (((uint8_t)opt2.val) >> 1) | (READ_C << 7);
@@ -1061,7 +1559,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_SWPB:
 	  {
 	    int16_t result;
-	    msp430_type2_single_operand( insn );
+	    OPT2_DECODE( insn );
 	    result = ((opt2.val << 8) & 0xff00) | ((opt2.val >> 8) & 0x00ff);
 	    WRITE_OPT2;
 	    /* flags : ---- */
@@ -1074,7 +1572,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_SXT: 
 	  {
 	    int16_t result;
-	    msp430_type2_single_operand( insn );
+	    OPT2_DECODE( insn );
 	    result = opt2.val & 0xff;
 	    if (result & 0x80) 
 	      result |= 0xff00;
@@ -1094,7 +1592,7 @@ unsigned int msp430_mcu_run_insn()
 	  {
 	    int16_t result;
 	    SP -= 2;
-	    msp430_type2_single_operand( insn );
+	    OPT2_DECODE( insn );
 	    result = opt2.val;
 	    msp430_write_short(SP,result);
 	    /* flags : ---- */
@@ -1109,10 +1607,11 @@ unsigned int msp430_mcu_run_insn()
 	  {
 	    uint16_t next_pc;
 	    SP -= 2;
-	    msp430_type2_single_operand( insn );
+	    OPT2_DECODE( insn );
 	    msp430_write_short(SP,mcu_get_pc_next());
 	    next_pc = opt2.val;
 	    mcu_set_pc_next(next_pc);
+	    MACHINE_FWPROF_CALL(MCU_ALU.curr_pc, next_pc, SP);
 	    /* flags : ---- */
 	    /* modes : ---  */
 	    /* cycles       */
@@ -1141,6 +1640,7 @@ unsigned int msp430_mcu_run_insn()
 	    next_pc = msp430_read_short(SP);
 	    mcu_set_pc_next(next_pc);
 	    SP += 2;
+	    MACHINE_FWPROF_RET(SP);
 	    HW_DMSG_INTR("msp430:intr: return from interrupt at pc = 0x%04x new pc is 0x%04x [%"PRIu64"]\n",
 			 MCU_ALU.curr_pc,next_pc, MACHINE_TIME_GET_NANO());
 	    TRACER_TRACE_INTR(0);
@@ -1168,7 +1668,7 @@ unsigned int msp430_mcu_run_insn()
 	  {
 	    int i, c, src, dst, b;
 	    int16_t result;
-	    msp430_type1_double_operands( insn );
+	    OPT1_DECODE( insn );
 
 	    b = opt1.byte ? 2 : 4;
 	    c = READ_C;
@@ -1210,13 +1710,17 @@ unsigned int msp430_mcu_run_insn()
 	case OP_MOV: 
 	  {
 	    int16_t result;
-	    msp430_type1_double_operands( insn );
+	    OPT1_DECODE( insn );
 	    result = opt1.src_val;
 	    WRITE_OPT1;
 	    /* flags : ---- */
 	    /* modes : ---  */
 	    /* cycles       */
 	    SET_CYCLES(opt1_cycles_class[opt1.src_t_mode][opt1.dst_t_mode]);
+	    if (insn == 0x4130) /* ret = mov @sp+,pc */
+	      {
+		MACHINE_FWPROF_RET(SP);
+	      }
 	    if (opt1.src_reg == opt1.dst_reg)
 	      {
 		switch (insn)
@@ -1265,7 +1769,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_ADDC:
 	  {
 	    int mask,msb,src,dst,result,C,addc,t1,t2;
-	    msp430_type1_double_operands( insn );
+	    OPT1_DECODE( insn );
 	    mask = BIT_MASK(opt1.byte);
 	    addc = ((opcode==OP_ADDC) ? READ_C : 0);
 	    src  = opt1.src_val    & mask;
@@ -1297,7 +1801,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_SUBC:
 	  {
 	    int mask,msb,src,dst,result,C,subc,t1,t2;
-	    msp430_type1_double_operands( insn );
+	    OPT1_DECODE( insn );
 	    mask = BIT_MASK(opt1.byte);
 	    subc = ((opcode==OP_SUBC) ? READ_C : 1);
 	    src  = opt1.src_val    & mask;
@@ -1328,7 +1832,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_CMP: /* OP_CMP is the same as SUB except for result storage */
 	  {
 	    int mask,msb,src,dst,result,C,t1,t2;
-	    msp430_type1_double_operands( insn );
+	    OPT1_DECODE( insn );
 	    mask = BIT_MASK(opt1.byte);
 	    src  = opt1.src_val    & mask;
 	    dst  = READ_OPT1_DST() & mask;
@@ -1356,7 +1860,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_BIC:
 	  {
 	    int mask,src,dst,result;
-	    msp430_type1_double_operands( insn );
+	    OPT1_DECODE( insn );
 	    mask = BIT_MASK(opt1.byte);
 	    src  = opt1.src_val    & mask;
 	    dst  = READ_OPT1_DST() & mask;
@@ -1374,7 +1878,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_BIS:
 	  {
 	    int mask,src,dst,result;
-	    msp430_type1_double_operands( insn );
+	    OPT1_DECODE( insn );
 	    mask = BIT_MASK(opt1.byte);
 	    src  = opt1.src_val    & mask;
 	    dst  = READ_OPT1_DST() & mask;
@@ -1392,7 +1896,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_BIT:
 	  { 
 	    int mask,msb,src,dst,result;
-	    msp430_type1_double_operands( insn );
+	    OPT1_DECODE( insn );
 	    mask = BIT_MASK(opt1.byte);
 	    src  = opt1.src_val    & mask;
 	    dst  = READ_OPT1_DST() & mask;
@@ -1414,7 +1918,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_XOR:
 	  {
 	    int mask,msb,src,dst,result;
-	    msp430_type1_double_operands( insn );
+	    OPT1_DECODE( insn );
 	    mask = BIT_MASK(opt1.byte);
 	    src  = opt1.src_val    & mask;
 	    dst  = READ_OPT1_DST() & mask;
@@ -1437,7 +1941,7 @@ unsigned int msp430_mcu_run_insn()
         case OP_AND:
 	  {
 	    int mask,msb,src,dst,result;
-	    msp430_type1_double_operands( insn );
+	    OPT1_DECODE( insn );
 	    mask = BIT_MASK(opt1.byte);
 	    src  = opt1.src_val    & mask;
 	    dst  = READ_OPT1_DST() & mask;
@@ -1463,7 +1967,7 @@ unsigned int msp430_mcu_run_insn()
 
         case OP_JNZ: /* OP_JNE */
 	  {
-	    int16_t offset = msp430_type3_offset(insn);
+	    int16_t offset = OPT3_DECODE(insn);
 	    if (! READ_Z)
 	      {
 		uint16_t next_pc = mcu_get_pc_next() + offset;
@@ -1477,7 +1981,7 @@ unsigned int msp430_mcu_run_insn()
 
         case OP_JZ: /* OP_JEQ */
 	  {
-	    int16_t offset = msp430_type3_offset(insn);
+	    int16_t offset = OPT3_DECODE(insn);
 	    if (READ_Z)
 	      {
 		uint16_t next_pc = mcu_get_pc_next() + offset;
@@ -1491,7 +1995,7 @@ unsigned int msp430_mcu_run_insn()
 
         case OP_JC: /* OP_JHS */
           {
-	    int16_t offset = msp430_type3_offset(insn);
+	    int16_t offset = OPT3_DECODE(insn);
 	    if (READ_C)
 	      {
 		uint16_t next_pc = mcu_get_pc_next() + offset;
@@ -1505,7 +2009,7 @@ unsigned int msp430_mcu_run_insn()
 
         case OP_JNC: /* OP_JLO */
           {
-	    int16_t offset = msp430_type3_offset(insn);
+	    int16_t offset = OPT3_DECODE(insn);
 	    if (! READ_C)
 	      {
 		uint16_t next_pc = mcu_get_pc_next() + offset;
@@ -1519,7 +2023,7 @@ unsigned int msp430_mcu_run_insn()
 
         case OP_JN:
           {
-	    int16_t offset = msp430_type3_offset(insn);
+	    int16_t offset = OPT3_DECODE(insn);
 	    if (READ_N)
 	      {
 		uint16_t next_pc = mcu_get_pc_next() + offset;
@@ -1533,7 +2037,7 @@ unsigned int msp430_mcu_run_insn()
 
         case OP_JGE:
           {
-	    int16_t offset = msp430_type3_offset(insn);
+	    int16_t offset = OPT3_DECODE(insn);
 	    if (!(READ_N^READ_V))
 	      {
 		uint16_t next_pc = mcu_get_pc_next() + offset;
@@ -1547,7 +2051,7 @@ unsigned int msp430_mcu_run_insn()
 
         case OP_JL:
           {
-	    int16_t offset = msp430_type3_offset(insn);
+	    int16_t offset = OPT3_DECODE(insn);
 	    if (READ_N^READ_V)
 	      {
 		uint16_t next_pc = mcu_get_pc_next() + offset;
@@ -1565,7 +2069,7 @@ unsigned int msp430_mcu_run_insn()
 	     * do NOT remove temporary offset variable unless you really
 	     * know what you are doing 
 	     */
-	    int16_t offset   = msp430_type3_offset(insn);
+	    int16_t offset   = OPT3_DECODE(insn);
 	    uint16_t next_pc = mcu_get_pc_next() + offset;
 	    mcu_set_pc_next(next_pc);
 	    ETRACER_BRANCH(ETRACER_BRANCH_JUMP);
@@ -1594,6 +2098,11 @@ unsigned int msp430_mcu_run_insn()
 #endif
       HW_DMSG_FD("msp430: -- Fetch end --------------------------------------------\n");
 
+      if (tcl != NULL)
+	{
+	  TCACHE_CHECK("cycles", tcl->cycles, msp430_instruction_cycles);
+	}
+
       /* statistics */
       MCU_INSN_CPT  += 1;
       MCU_CYCLE_CPT += msp430_instruction_cycles;
@@ -1611,7 +2120,8 @@ unsigned int msp430_mcu_run_insn()
 	}
 #endif
 
-#if defined(ETRACE)
+      MACHINE_FWPROF_INSN(MCU_ALU.curr_pc, msp430_instruction_cycles);
+
       etracer_slot_insn(MCU_ALU.curr_pc, /* WARNING : MSB problem when uin16_t -> uint32_t */
                         msp430_insn_class(opcode),
                         msp430_instruction_cycles,
@@ -1620,7 +2130,6 @@ unsigned int msp430_mcu_run_insn()
 			MCU_ALU.etracer_branch_type,
 			MCU_ALU.etracer_except,
 			MCU_ALU.etracer_reti);
-#endif
 
       return msp430_instruction_cycles;
 }
@@ -40,6 +40,7 @@
 
 static void msp430_basic_clock_adjust_lfxt1_freq();
 static void msp430_basic_clock_adjust_dco_freq();
+static void msp430_basic_clock_adjust_steps();
 static void msp430_basic_clock_printstate();
 
 /* ************************************************** */
@@ -75,7 +76,7 @@ msp430_basic_clock_create()
 void 
 msp430_basic_clock_reset()
 {
-  static int firsttime = 0;
+  static WSIM_TLS int firsttime = 0;
 
   /* 
    * dco initial state 0x60 = 0110 0000
@@ -110,6 +111,7 @@ msp430_basic_clock_reset()
 #else
   MCUBC.xt2_cycle_nanotime   = (MCUBC.xt2_freq   > 0) ? (NANO / MCUBC.xt2_freq)   : 0;
 #endif
+  msp430_basic_clock_adjust_steps();
 
   msp430_basic_clock_printstate();
   if (firsttime == 0)
@@ -123,58 +125,17 @@ msp430_basic_clock_reset()
 /* ************************************************** */
 /* ************************************************** */
 
-int 
-msp430_basic_clock_update(int clock_add)
+/**
+ * oscillators, ACLK and SMCLK after 'cycles' MCLK source cycles, the
+ * per instruction path has no division, periods are folded in the steps
+ * by msp430_basic_clock_adjust_steps()
+ **/
+static inline void
+msp430_basic_clock_run(uint32_t cycles)
 {
-#if defined(HIGH_RES_CLOCK)
-  float nano_add = 0;
-#else
-  int   nano_add = 0;
-#endif
-
-  /********************************************/
-  /* Update nano time                         */
-  /********************************************/
-
-  /* switch on MCLK source, compute other clocks */
-  /* compute the nano equivalent time            */
-  int clock_add_mul = clock_add << MCUBC.bcsctl2.b.divm;
-  switch (MCUBC.bcsctl2.b.selm)
-    {
-    case 0: /* DCOCLK */
-    case 1: /* DCOCLK */
-      nano_add = clock_add_mul * MCUBC.dco_cycle_nanotime;
-      break;
-    case 2: /* XT2CLK */
-      nano_add = clock_add_mul * MCUBC.xt2_cycle_nanotime;
-      break;
-    case 3: /* LFXT1CLK */
-      nano_add = clock_add_mul * MCUBC.lfxt1_cycle_nanotime;      
-      break;
-    }
-
   /********************************************/
   /* Update internals clocks                  */
   /********************************************/
-#if defined(HIGH_RES_CLOCK)
-#define CLOCK_DIVMOD_TEMP(inc,tmp,nanotime)   \
-  do {                                        \
-    if (nanotime > 0) {                       \
-      tmp += nano_add;			      \
-      inc  = tmp / nanotime;		      \
-      tmp  = tmp - (inc * nanotime);	      \
-    }					      \
-  } while (0)                     
-#else
-#define CLOCK_DIVMOD_TEMP(inc,tmp,nanotime)   \
-  do {                                        \
-    if (nanotime > 0) {	                      \
-      tmp += nano_add;			      \
-      inc = tmp / nanotime;		      \
-      tmp %= nanotime;			      \
-    }					      \
-  } while (0)                     
-#endif
 
   /* OSCOFF -> LFXT1 */
   /* Software can disable LFXT1 by setting OSCOFF, if this signal does not source */
@@ -182,7 +143,7 @@ msp430_basic_clock_update(int clock_add)
   /* so it runs if OSCOFF == 0 or it sources MCLK */
   if ((MCU_READ_OSCOFF == 0) || (MCUBC.bcsctl2.b.selm == 3 && MCU_READ_CPUOFF == 0)) 
     {
-      CLOCK_DIVMOD_TEMP(MCUBC.lfxt1_increment,MCUBC.lfxt1_temp,MCUBC.lfxt1_cycle_nanotime);
+      MCUBC.lfxt1_increment  = msp430_clock_src_ticks(&MCUBC.lfxt1_src, cycles);
       MCUBC.lfxt1_counter   += MCUBC.lfxt1_increment;
     }
   else
@@ -197,7 +158,7 @@ msp430_basic_clock_update(int clock_add)
       (MCUBC.bcsctl2.b.selm   == 2  && MCU_READ_CPUOFF == 0) || 
       (MCUBC.bcsctl2.b.sels   == 1))
     {
-      CLOCK_DIVMOD_TEMP(MCUBC.xt2_increment,MCUBC.xt2_temp,MCUBC.xt2_cycle_nanotime);
+      MCUBC.xt2_increment    = msp430_clock_src_ticks(&MCUBC.xt2_src, cycles);
       MCUBC.xt2_counter     += MCUBC.xt2_increment;
 #if defined(DEBUG_SRC_OFF)
       if (MCUBC.bcsctl1.b.xt2off == 1)
@@ -224,7 +185,7 @@ msp430_basic_clock_update(int clock_add)
       (MCUBC.bcsctl2.b.selm  < 2  && MCU_READ_CPUOFF == 0) || 
       (MCUBC.bcsctl2.b.sels == 0))
     {
-      CLOCK_DIVMOD_TEMP(MCUBC.dco_increment,MCUBC.dco_temp,MCUBC.dco_cycle_nanotime);
+      MCUBC.dco_increment    = msp430_clock_src_ticks(&MCUBC.dco_src, cycles);
       MCUBC.dco_counter     += MCUBC.dco_increment;
 #if defined(DEBUG_SRC_OFF)
       if (MCU_READ_SCG0 == 1)
@@ -247,18 +208,6 @@ msp430_basic_clock_update(int clock_add)
   /********************************************/
   /* Update external signals                  */
   /********************************************/
-  
-  /* MCLK */
-  /* clock_add is given in MCLK clock ticks from CPU */
-  if (MCU_READ_CPUOFF == 0)
-    {
-      MCUBC.MCLK_increment   = clock_add; 
-      MCUBC.MCLK_counter    += clock_add;
-    }
-  else
-    {
-      MCUBC.MCLK_increment   = 0;
-    }
 
   /* ACLK */
   MCUBC.ACLK_temp           += MCUBC.lfxt1_increment;
@@ -277,27 +226,38 @@ msp430_basic_clock_update(int clock_add)
   else
     {
       MCUBC.SMCLK_increment  = 0;
-      // #define RUNNING_MODE_FROM_REG(R) ((R >> 4) & 0x0fu)
-      //
-      // #define MCU_READ_GIE     ((uint16_t)(SR & MASK_GIE   ) >> 3)
-      // #define MCU_READ_CPUOFF  ((uint16_t)(SR & MASK_CPUOFF) >> 4) 
-      // #define MCU_READ_OSCOFF  ((uint16_t)(SR & MASK_OSCOFF) >> 5)
-      // #define MCU_READ_SCG0    ((uint16_t)(SR & MASK_SCG0  ) >> 6)
-      // #define MCU_READ_SCG1    ((uint16_t)(SR & MASK_SCG1  ) >> 7)
-      //
-      //      SCG1 SCG0 OSCOFF CPUOFF
-      //
-      // 13 1101  
-      //  4 0100
-      // 12 1100
-      //      WARNING("SCGA = 1 // ");
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int 
+msp430_basic_clock_update(int clock_add)
+{
+  /* clock_add is given in MCLK clock ticks from CPU */
+  uint32_t cycles   = clock_add << MCUBC.bcsctl2.b.divm;
+  int      nano_add = msp430_clock_nanotime(MCUBC.nano_step, cycles);
+
+  msp430_basic_clock_run(cycles);
+
+  /* MCLK */
+  if (MCU_READ_CPUOFF == 0)
+    {
+      MCUBC.MCLK_increment   = clock_add; 
+      MCUBC.MCLK_counter    += clock_add;
+    }
+  else
+    {
+      MCUBC.MCLK_increment   = 0;
     }
 
   /********************************************/
   /*                                          */
   /********************************************/
 #if defined(DEBUG_EACH_STEP)
-  HW_DMSG_CLOCK("msp430:basic_clock: cycles+%d = nano+%"HRCTYPE" / lfxt1+%d xt2+%d dco+%d / MCLK+%d ACLK+%d SMCLK+%d / %" PRId64 "ns\n",
+  HW_DMSG_CLOCK("msp430:basic_clock: cycles+%d = nano+%d / lfxt1+%d xt2+%d dco+%d / MCLK+%d ACLK+%d SMCLK+%d / %" PRId64 "ns\n",
 		clock_add,nano_add,
 		MCUBC.lfxt1_increment,MCUBC.xt2_increment,MCUBC.dco_increment,
 		MCUBC.MCLK_increment,MCUBC.ACLK_increment,MCUBC.SMCLK_increment,
@@ -326,6 +286,101 @@ void msp430_basic_clock_update_done()
 /* ************************************************** */
 /* ************************************************** */
 
+/**
+ * run n clock slices of clock_add cycles. Phases and dividers are
+ * integer, a single run of n slices gives the same remainders as n
+ * single updates, the returned time is n times the truncated slice
+ * time. Increments are accumulated for the peripherals that are
+ * updated once.
+ **/
+int
+msp430_basic_clock_update_slices(int clock_add, int n)
+{
+  uint32_t slice = clock_add << MCUBC.bcsctl2.b.divm;
+  int      chunk = (slice > 0) ? (int)(UINT32_MAX / slice) : n;
+  int      nano  = n * msp430_clock_nanotime(MCUBC.nano_step, slice);
+  int      lfxt1 = 0, xt2 = 0, dco = 0;
+  int      MCLK  = 0, ACLK  = 0, SMCLK = 0;
+
+  while (n > 0)
+    {
+      int k = (n < chunk) ? n : chunk;
+      msp430_basic_clock_run(slice * k);
+      lfxt1 += MCUBC.lfxt1_increment;
+      xt2   += MCUBC.xt2_increment;
+      dco   += MCUBC.dco_increment;
+      ACLK  += MCUBC.ACLK_increment;
+      SMCLK += MCUBC.SMCLK_increment;
+      msp430_basic_clock_update_done();
+      if (MCU_READ_CPUOFF == 0)
+	{
+	  MCUBC.MCLK_counter += (uint64_t)clock_add * k;
+	  MCLK               += clock_add * k;
+	}
+      n -= k;
+    }
+
+  MCUBC.lfxt1_increment = lfxt1;
+  MCUBC.xt2_increment   = xt2;
+  MCUBC.dco_increment   = dco;
+  MCUBC.MCLK_increment  = MCLK;
+  MCUBC.ACLK_increment  = ACLK;
+  MCUBC.SMCLK_increment = SMCLK;
+  return nano;
+}
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * time (ns) needed by a source oscillator to produce (ticks << div) - temp
+ * periods from its current phase
+ **/
+static wsimtime_t 
+msp430_basic_clock_src_horizon(uint32_t ticks, int div, int temp, struct msp430_clock_src_t *src, double period)
+{
+  return msp430_clock_src_horizon(src, period, ((int64_t)ticks << div) - temp);
+}
+
+wsimtime_t msp430_basic_clock_horizon(int clk, uint32_t ticks)
+{
+  switch (clk)
+    {
+    case HORIZON_ACLK:
+      if ((MCU_READ_OSCOFF == 1) && ((MCUBC.bcsctl2.b.selm != 3) || (MCU_READ_CPUOFF == 1)))
+	return WSIM_HORIZON_INF;
+      return msp430_basic_clock_src_horizon(ticks, MCUBC.bcsctl1.b.diva, MCUBC.ACLK_temp,
+					    &MCUBC.lfxt1_src, MCUBC.lfxt1_cycle_nanotime);
+
+    case HORIZON_SMCLK:
+      if (MCU_READ_SCG1 == 1)
+	return WSIM_HORIZON_INF;
+      /* the SMCLK source oscillator is always running */
+      if (MCUBC.bcsctl2.b.sels == 0)
+	return msp430_basic_clock_src_horizon(ticks, MCUBC.bcsctl2.b.divs, MCUBC.SMCLK_temp,
+					      &MCUBC.dco_src, MCUBC.dco_cycle_nanotime);
+      return msp430_basic_clock_src_horizon(ticks, MCUBC.bcsctl2.b.divs, MCUBC.SMCLK_temp,
+					    &MCUBC.xt2_src, MCUBC.xt2_cycle_nanotime);
+
+    default:
+      return 0;
+    }
+}
+
+/**
+ * duration of a clock update of n MCLK cycles, rounded up
+ **/
+wsimtime_t msp430_basic_clock_cycles_nanotime(int cycles)
+{
+  uint64_t frac = 0;
+  uint64_t nano = msp430_clock_fx_mul(MCUBC.nano_step, cycles << MCUBC.bcsctl2.b.divm, &frac);
+  return nano + ((frac > 0) ? 1 : 0);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 int8_t msp430_basic_clock_read (uint16_t addr)
 {
   HW_DMSG_CLOCK("msp430:basic_clock: read : [0x%04x]\n",addr);
@@ -373,6 +428,7 @@ void msp430_basic_clock_write(uint16_t addr, int8_t val)
 	}
 	MCUBC.dco.s = val;
 	msp430_basic_clock_adjust_dco_freq();
+	msp430_basic_clock_adjust_steps();
 	msp430_basic_clock_printstate();
 	msp430_basic_clock_speed_tracer_update();
       }
@@ -416,6 +472,7 @@ void msp430_basic_clock_write(uint16_t addr, int8_t val)
 	MCUBC.ACLK_bitmask  = BITMASK(MCUBC.bcsctl1.b.diva);
 	msp430_basic_clock_adjust_lfxt1_freq();	
 	msp430_basic_clock_adjust_dco_freq();
+	msp430_basic_clock_adjust_steps();
 	msp430_basic_clock_printstate();
 	msp430_basic_clock_speed_tracer_update();
       }
@@ -456,6 +513,7 @@ void msp430_basic_clock_write(uint16_t addr, int8_t val)
 	MCUBC.bcsctl2.s = val;
 	MCUBC.MCLK_bitmask  = BITMASK(MCUBC.bcsctl2.b.divm);
 	MCUBC.SMCLK_bitmask = BITMASK(MCUBC.bcsctl2.b.divs);
+	msp430_basic_clock_adjust_steps();
 	msp430_basic_clock_printstate();
 	msp430_basic_clock_speed_tracer_update();
       }
@@ -538,6 +596,39 @@ msp430_basic_clock_adjust_dco_freq()
 /* ************************************************** */
 /* ************************************************** */
 
+/**
+ * fixed point steps of the oscillators and of the time, called when an
+ * oscillator period or the MCLK source is modified
+ **/
+static void
+msp430_basic_clock_adjust_steps()
+{
+  double mclk_period = 0;
+
+  switch (MCUBC.bcsctl2.b.selm)
+    {
+    case 0: /* DCOCLK */
+    case 1: /* DCOCLK */
+      mclk_period = MCUBC.dco_cycle_nanotime;
+      break;
+    case 2: /* XT2CLK */
+      mclk_period = MCUBC.xt2_cycle_nanotime;
+      break;
+    case 3: /* LFXT1CLK */
+      mclk_period = MCUBC.lfxt1_cycle_nanotime;
+      break;
+    }
+
+  MCUBC.nano_step = msp430_clock_fx(mclk_period);
+  msp430_clock_src_set(&MCUBC.lfxt1_src, MCUBC.lfxt1_cycle_nanotime, mclk_period);
+  msp430_clock_src_set(&MCUBC.xt2_src,   MCUBC.xt2_cycle_nanotime,   mclk_period);
+  msp430_clock_src_set(&MCUBC.dco_src,   MCUBC.dco_cycle_nanotime,   mclk_period);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 static void
 msp430_basic_clock_printstate()
 {
@@ -154,21 +154,20 @@ struct msp430_basic_clock_t
   uint64_t dco_counter;
   int      dco_increment;
 
-  /* external clock temporary variables */
+  /* external clock phases, steps are in MCLK source cycles */
+
+  struct msp430_clock_src_t lfxt1_src;
+  struct msp430_clock_src_t xt2_src;
+  struct msp430_clock_src_t dco_src;
+  uint64_t nano_step;         /* MCLK source period, ns 32.32 */
 
 #if defined(HIGH_RES_CLOCK)
-  float    lfxt1_temp;
   float    lfxt1_cycle_nanotime;
-  float    xt2_temp;
   float    xt2_cycle_nanotime;
-  float    dco_temp;
   float    dco_cycle_nanotime;
 #else
-  int      lfxt1_temp;
   uint32_t lfxt1_cycle_nanotime;
-  int      xt2_temp;
   uint32_t xt2_cycle_nanotime;
-  int      dco_temp;
   uint32_t dco_cycle_nanotime;
 #endif
 };
@@ -196,7 +195,14 @@ void    msp430_basic_clock_speed_tracer_update();
 
 #define MCU_CLOCK_SYSTEM_UPDATE(n)       msp430_basic_clock_update(n)
 #define MCU_CLOCK_SYSTEM_UPDATE_DONE()   msp430_basic_clock_update_done()
+#define MCU_CLOCK_SYSTEM_UPDATE_SLICES(n,s) msp430_basic_clock_update_slices(n,s)
+int     msp430_basic_clock_update_slices(int clock_add, int n);
+wsimtime_t msp430_basic_clock_horizon(int clk, uint32_t ticks);
+wsimtime_t msp430_basic_clock_cycles_nanotime(int cycles);
+
 #define MCU_CLOCK_SYSTEM_SPEED_TRACER()  msp430_basic_clock_speed_tracer_update()
+#define MCU_CLOCK_HORIZON(clk,ticks)     msp430_basic_clock_horizon(clk,ticks)
+#define MCU_CLOCK_CYCLES_NANOTIME(n)     msp430_basic_clock_cycles_nanotime(n)
 
 /* ************************************************** */
 /* ************************************************** */
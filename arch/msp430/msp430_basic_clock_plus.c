@@ -44,6 +44,7 @@
 static void msp430_basic_clock_plus_adjust_lfxt1_freq();
 static void msp430_basic_clock_plus_adjust_dco_freq();
 static void msp430_basic_clock_plus_adjust_vlo_freq();
+static void msp430_basic_clock_plus_adjust_steps();
 static void msp430_basic_clock_plus_printstate();
 
 /* ************************************************** */
@@ -82,7 +83,7 @@ void
 msp430_basic_clock_plus_reset()
 {
 
-  static int firsttime = 0;
+  static WSIM_TLS int firsttime = 0;
 
   /* 
    * dco initial state 0x60 = 0110 0000
@@ -112,6 +113,7 @@ msp430_basic_clock_plus_reset()
   msp430_basic_clock_plus_adjust_lfxt1_freq();
   msp430_basic_clock_plus_adjust_dco_freq();
   msp430_basic_clock_plus_adjust_vlo_freq();
+  msp430_basic_clock_plus_adjust_steps();
 
   msp430_basic_clock_plus_printstate();
   if (firsttime == 0)
@@ -129,72 +131,14 @@ msp430_basic_clock_plus_reset()
 int 
 msp430_basic_clock_plus_update(int clock_add)
 {
-#if defined(HIGH_RES_CLOCK)
-  float nano_add = 0;
-#else
-  int   nano_add = 0;
-#endif
-
-  /********************************************/
-  /* Update nano time                         */
-  /********************************************/
-
-  /* switch on MCLK source, compute other clocks */
-  /* compute the nano equivalent time            */
-  int clock_add_mul = clock_add << MCUBCP.bcsctl2.b.divm;
-  switch (MCUBCP.bcsctl2.b.selm)
-  {
-    case 0: /* DCOCLK */
-    case 1: /* DCOCLK */
-      nano_add = clock_add_mul * MCUBCP.dco_cycle_nanotime;
-      break;
-
-    case 2: /* LFXT1CLK or VLOCLK */
-#if defined(__msp430_have_xt2)
-     nano_add = clock_add_mul * MCUBCP.xt2_cycle_nanotime;
-     break;
-#endif
-      
-    case 3: /* LFXT1CLK or VLOCLK : 10 = VLOCKL ; else = LFXT1CLK*/
-      
-         switch(MCUBCP.bcsctl3.b.lfxt1s) /* LFXT1CLK or VLOCLK : 10 = VLOCKL ; else = LFXT1CLK*/
-      {
-	case 0: /* 32768 Hz Crystal on LFXT1 */
-	case 1: /* Reserved */
-	  nano_add = clock_add_mul * MCUBCP.lfxt1_cycle_nanotime;
-	  break;
-	case 2: /* VLOCKL */
-	  nano_add = clock_add_mul * MCUBCP.vlo_cycle_nanotime;
-	  break;
-	case 3: /* Digital external clock source */
-	  nano_add = clock_add_mul * MCUBCP.lfxt1_cycle_nanotime;
-	  break;
-      }   
-	break;
-    }
+  /* clock_add is given in MCLK clock ticks from CPU, the per instruction */
+  /* path has no division, periods are folded in the fixed point steps    */
+  uint32_t cycles   = clock_add << MCUBCP.bcsctl2.b.divm;
+  int      nano_add = msp430_clock_nanotime(MCUBCP.nano_step, cycles);
 
   /********************************************/
   /* Update internals clocks                  */
   /********************************************/
-#if defined(HIGH_RES_CLOCK)
-#define CLOCK_DIVMOD_TEMP(inc,tmp,nanotime)   \
-  do {                                        \
-    if (nanotime > 0) {                       \
-      tmp += nano_add;			      \
-      inc  = tmp / nanotime;		      \
-      tmp  = tmp - (inc * nanotime);	      \
-    }					      \
-  } while (0)                     
-#else
-#define CLOCK_DIVMOD_TEMP(inc,tmp,nanotime)   \
-  do {                                        \
-    if (nanotime > 0) {                       \
-      tmp += nano_add;			      \
-      inc = tmp / nanotime;		      \
-      tmp %= nanotime;			      \
-    }					      \
-  } while (0)                     
-#endif
 
   /* OSCOFF -> LFXT1 */
   /* Software can disable LFXT1 by setting OSCOFF, if this signal does not source */
@@ -202,7 +146,7 @@ msp430_basic_clock_plus_update(int clock_add)
   /* so it runs if OSCOFF == 0 or it sources MCLK */
   if ((MCU_READ_OSCOFF == 0) || (MCUBCP.bcsctl2.b.selm == 3 && MCU_READ_CPUOFF == 0)) 
     {
-      CLOCK_DIVMOD_TEMP(MCUBCP.lfxt1_increment,MCUBCP.lfxt1_temp,MCUBCP.lfxt1_cycle_nanotime);
+      MCUBCP.lfxt1_increment = msp430_clock_src_ticks(&MCUBCP.lfxt1_src, cycles);
       MCUBCP.lfxt1_counter   += MCUBCP.lfxt1_increment;
     }
   else
@@ -212,7 +156,7 @@ msp430_basic_clock_plus_update(int clock_add)
 
   /* VLOCLK */
   /* TODO: check if VLOCLK is on when not selected by lfxt1s MCUBCP.bcsctl3.b.lfxt1s == 2 */
-  CLOCK_DIVMOD_TEMP(MCUBCP.vlo_increment,MCUBCP.vlo_temp,MCUBCP.vlo_cycle_nanotime);
+  MCUBCP.vlo_increment = msp430_clock_src_ticks(&MCUBCP.vlo_src, cycles);
   MCUBCP.vlo_counter   += MCUBCP.vlo_increment;
 
 
@@ -224,7 +168,7 @@ msp430_basic_clock_plus_update(int clock_add)
       (MCUBCP.bcsctl2.b.selm   == 2  && MCU_READ_CPUOFF == 0) || 
       (MCUBCP.bcsctl2.b.sels   == 1))
     {
-      CLOCK_DIVMOD_TEMP(MCUBCP.xt2_increment,MCUBCP.xt2_temp,MCUBCP.xt2_cycle_nanotime);
+      MCUBCP.xt2_increment = msp430_clock_src_ticks(&MCUBCP.xt2_src, cycles);
       MCUBCP.xt2_counter     += MCUBCP.xt2_increment;
 #if defined(DEBUG_SRC_OFF)
       if (MCUBCP.bcsctl1.b.xt2off == 1)
@@ -254,7 +198,7 @@ msp430_basic_clock_plus_update(int clock_add)
       (MCUBCP.bcsctl2.b.selm  < 2  && MCU_READ_CPUOFF == 0) || 
       (MCUBCP.bcsctl2.b.sels == 0))
     {
-      CLOCK_DIVMOD_TEMP(MCUBCP.dco_increment,MCUBCP.dco_temp,MCUBCP.dco_cycle_nanotime);
+      MCUBCP.dco_increment = msp430_clock_src_ticks(&MCUBCP.dco_src, cycles);
       MCUBCP.dco_counter     += MCUBCP.dco_increment;
 #if defined(DEBUG_SRC_OFF)
       if (MCU_READ_SCG0 == 1)
@@ -340,7 +284,7 @@ msp430_basic_clock_plus_update(int clock_add)
   /*                                          */
   /********************************************/
 #if DEBUG_EACH_STEP != 0
-  HW_DMSG_CLOCK("msp430:basic_clock_plus: cycles+%d = nano+%"HRCTYPE" / lfxt1+%d vlo+%d dco+%d / MCLK+%d ACLK+%d SMCLK+%d / %" PRId64 "ns\n",
+  HW_DMSG_CLOCK("msp430:basic_clock_plus: cycles+%d = nano+%d / lfxt1+%d vlo+%d dco+%d / MCLK+%d ACLK+%d SMCLK+%d / %" PRId64 "ns\n",
 		clock_add,nano_add,
 		MCUBCP.lfxt1_increment,MCUBCP.vlo_increment,MCUBCP.dco_increment,
 		MCUBCP.MCLK_increment,MCUBCP.ACLK_increment,MCUBCP.SMCLK_increment,
@@ -421,6 +365,7 @@ void msp430_basic_clock_plus_write(uint16_t addr, int8_t val)
 	}
 	MCUBCP.dco.s = val;
 	msp430_basic_clock_plus_adjust_dco_freq();
+	msp430_basic_clock_plus_adjust_steps();
 	msp430_basic_clock_plus_printstate();
 	msp430_basic_clock_plus_speed_tracer_update();
       }
@@ -460,6 +405,7 @@ void msp430_basic_clock_plus_write(uint16_t addr, int8_t val)
 	MCUBCP.ACLK_bitmask  = BITMASK(MCUBCP.bcsctl1.b.diva);
 	msp430_basic_clock_plus_adjust_lfxt1_freq();	
 	msp430_basic_clock_plus_adjust_dco_freq();
+	msp430_basic_clock_plus_adjust_steps();
 	msp430_basic_clock_plus_printstate();
 	msp430_basic_clock_plus_speed_tracer_update();
       }
@@ -500,6 +446,7 @@ void msp430_basic_clock_plus_write(uint16_t addr, int8_t val)
 	MCUBCP.bcsctl2.s = val;
 	MCUBCP.MCLK_bitmask  = BITMASK(MCUBCP.bcsctl2.b.divm);
 	MCUBCP.SMCLK_bitmask = BITMASK(MCUBCP.bcsctl2.b.divs);
+	msp430_basic_clock_plus_adjust_steps();
 	msp430_basic_clock_plus_printstate();
 	msp430_basic_clock_plus_speed_tracer_update();
       }
@@ -536,6 +483,7 @@ void msp430_basic_clock_plus_write(uint16_t addr, int8_t val)
 	  }
 	
 	MCUBCP.bcsctl3.s = val;
+	msp430_basic_clock_plus_adjust_steps();
 	msp430_basic_clock_plus_printstate();
 	msp430_basic_clock_plus_speed_tracer_update();
       }
@@ -639,6 +587,42 @@ msp430_basic_clock_plus_adjust_vlo_freq()
 /* ************************************************** */
 /* ************************************************** */
 
+/**
+ * fixed point steps of the oscillators and of the time, called when an
+ * oscillator period or the MCLK source is modified
+ **/
+static void
+msp430_basic_clock_plus_adjust_steps()
+{
+  double mclk_period = 0;
+
+  switch (MCUBCP.bcsctl2.b.selm)
+    {
+    case 0: /* DCOCLK */
+    case 1: /* DCOCLK */
+      mclk_period = MCUBCP.dco_cycle_nanotime;
+      break;
+    case 2: /* LFXT1CLK or VLOCLK */
+#if defined(__msp430_have_xt2)
+      mclk_period = MCUBCP.xt2_cycle_nanotime;
+      break;
+#endif
+    case 3: /* LFXT1CLK or VLOCLK : 10 = VLOCKL ; else = LFXT1CLK*/
+      mclk_period = (MCUBCP.bcsctl3.b.lfxt1s == 2) ? MCUBCP.vlo_cycle_nanotime : MCUBCP.lfxt1_cycle_nanotime;
+      break;
+    }
+
+  MCUBCP.nano_step = msp430_clock_fx(mclk_period);
+  msp430_clock_src_set(&MCUBCP.lfxt1_src, MCUBCP.lfxt1_cycle_nanotime, mclk_period);
+  msp430_clock_src_set(&MCUBCP.xt2_src,   MCUBCP.xt2_cycle_nanotime,   mclk_period);
+  msp430_clock_src_set(&MCUBCP.dco_src,   MCUBCP.dco_cycle_nanotime,   mclk_period);
+  msp430_clock_src_set(&MCUBCP.vlo_src,   MCUBCP.vlo_cycle_nanotime,   mclk_period);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 static void
 msp430_basic_clock_plus_printstate()
 {
@@ -187,28 +187,24 @@ struct msp430_basic_clock_plus_t
   uint64_t vlo_counter;
   int      vlo_increment;
 
-  /* external clock temporary variables */
+  /* external clock phases, steps are in MCLK source cycles */
+
+  struct msp430_clock_src_t lfxt1_src;
+  struct msp430_clock_src_t xt2_src;
+  struct msp430_clock_src_t dco_src;
+  struct msp430_clock_src_t vlo_src;
+  uint64_t nano_step;         /* MCLK source period, ns 32.32 */
 
 #if defined(HIGH_RES_CLOCK)
-  float    lfxt1_temp;
   float    lfxt1_cycle_nanotime;
-  float    xt2_temp;
   float    xt2_cycle_nanotime;
-  float    dco_temp;
   float    dco_cycle_nanotime;
-  float    vlo_temp;
   float    vlo_cycle_nanotime;
-  
 #else
-  int      lfxt1_temp;
   uint32_t lfxt1_cycle_nanotime;
-  int      xt2_temp;
   uint32_t xt2_cycle_nanotime;
-  int      dco_temp;
   uint32_t dco_cycle_nanotime;
-  int      vlo_temp;
   uint32_t vlo_cycle_nanotime;
-  
 #endif
 };
 
@@ -236,6 +232,10 @@ void    msp430_basic_clock_plus_speed_tracer_update();
 #define MCU_CLOCK_SYSTEM_UPDATE(n)       msp430_basic_clock_plus_update(n)
 #define MCU_CLOCK_SYSTEM_UPDATE_DONE()   msp430_basic_clock_plus_update_done()
 #define MCU_CLOCK_SYSTEM_SPEED_TRACER()  msp430_basic_clock_plus_speed_tracer_update()
+/* no event horizon, LPM slices are never merged */
+#define MCU_CLOCK_HORIZON(clk,ticks)     0
+#define MCU_CLOCK_CYCLES_NANOTIME(n)     0
+#define MCU_CLOCK_SYSTEM_UPDATE_SLICES(n,s) msp430_basic_clock_plus_update(n)
 
 /* ************************************************** */
 /* ************************************************** */
@@ -0,0 +1,94 @@
+/**
+ *  \file   msp430_clock.h
+ *  \brief  MSP430 clock modules, fixed point oscillator phases
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef MSP430_CLOCK_H
+#define MSP430_CLOCK_H
+
+/**
+ * Clock modules advance every oscillator after each instruction. The
+ * number of oscillator periods elapsed during an update was the update
+ * time divided by the oscillator period, with a remainder kept in ns.
+ *
+ * Oscillators are now counted in MCLK source cycles. The ratio of the
+ * MCLK source period to the oscillator period is a 32.32 fixed point
+ * step computed when the clock registers or frequencies change. The
+ * phase is the elapsed fraction of the current oscillator period, in
+ * 2^-32 units. An update multiplies the cycle count by the step, the
+ * integer part gives the oscillator ticks and the fraction is the new
+ * phase. The update time uses the same representation for the MCLK
+ * source period in ns and is truncated to the ns as before.
+ *
+ * Integer arithmetic is exact and additive: an update of n*k cycles
+ * gives the same ticks and the same phase as n updates of k cycles.
+ * The step rounding error is 2^-33 source period per MCLK cycle.
+ **/
+
+#define CLOCK_FX_SHIFT  32
+#define CLOCK_FX_ONE    (1ull << CLOCK_FX_SHIFT)
+#define CLOCK_FX_MASK   (CLOCK_FX_ONE - 1)
+
+struct msp430_clock_src_t {
+  uint64_t step;      /* periods per MCLK source cycle, 32.32, 0 when stopped */
+  uint64_t phase;     /* elapsed part of the current period, 0.32            */
+};
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/* fixed point value of v >= 0 */
+static inline uint64_t msp430_clock_fx(double v)
+{
+  return (v > 0) ? (uint64_t)(v * (double)CLOCK_FX_ONE + 0.5) : 0;
+}
+
+/* src period ratio, 0 if the src or the MCLK source has no frequency */
+static inline void msp430_clock_src_set(struct msp430_clock_src_t *src, double period, double mclk_period)
+{
+  src->step = (period > 0) ? msp430_clock_fx(mclk_period / period) : 0;
+}
+
+/**
+ * (cycles * fx) >> 32 without overflow for any 32 bits cycle count,
+ * the fraction is returned in frac
+ **/
+static inline uint64_t msp430_clock_fx_mul(uint64_t fx, uint32_t cycles, uint64_t *frac)
+{
+  uint64_t lo = (uint64_t)cycles * (fx & CLOCK_FX_MASK) + *frac;
+  *frac = lo & CLOCK_FX_MASK;
+  return (uint64_t)cycles * (fx >> CLOCK_FX_SHIFT) + (lo >> CLOCK_FX_SHIFT);
+}
+
+/* oscillator periods completed during 'cycles' MCLK source cycles */
+static inline int msp430_clock_src_ticks(struct msp430_clock_src_t *src, uint32_t cycles)
+{
+  return (int)msp430_clock_fx_mul(src->step, cycles, &src->phase);
+}
+
+/* time of 'cycles' MCLK source cycles, nano_step is the source period in ns, 32.32 */
+static inline uint64_t msp430_clock_nanotime(uint64_t nano_step, uint32_t cycles)
+{
+  uint64_t frac = 0;
+  return msp430_clock_fx_mul(nano_step, cycles, &frac);
+}
+
+/**
+ * time (ns) until the oscillator completes 'ticks' more periods,
+ * ticks = 1 gives the next edge
+ **/
+static inline wsimtime_t msp430_clock_src_horizon(struct msp430_clock_src_t *src, double period, int64_t ticks)
+{
+  double ns;
+
+  if (period <= 0)
+    return WSIM_HORIZON_INF;
+
+  ns = ((double)ticks - (double)src->phase / (double)CLOCK_FX_ONE) * period;
+  return (ns > 0) ? (wsimtime_t)ns : 0;
+}
+
+#endif
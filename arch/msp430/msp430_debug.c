@@ -49,7 +49,7 @@
 
 char* msp430_debug_opcode(unsigned short opcode, int b)
 {
-  static char buff[60];
+  static WSIM_TLS char buff[60];
   buff[0] = 0;
 
   switch (opcode)
@@ -0,0 +1,87 @@
+/**
+ *  \file   msp430_devnet.c
+ *  \brief  MSP430 nets for the platform devices interconnect
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arch/common/hardware.h"
+#include "devices/devices_net.h"
+#include "msp430.h"
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#define USART_PENDING(USART,NUM)					\
+  if (MCU.USART.uxtx_shift_ready == 1)					\
+    {									\
+      if (MCU.USART.mode == USART_MODE_SPI)				\
+	pending |= DEVNET_MCU_BIT(DEVNET_SPI(NUM));			\
+      else if (MCU.USART.mode == USART_MODE_UART)			\
+	pending |= DEVNET_MCU_BIT(DEVNET_UART(NUM));			\
+    }
+
+uint32_t msp430_devnet_pending(void)
+{
+  uint32_t pending = MCU.digiIO.out_changed;
+#if defined(__msp430_have_usart0)
+  USART_PENDING(usart0,0)
+#endif
+#if defined(__msp430_have_usart1)
+  USART_PENDING(usart1,1)
+#endif
+  return pending;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int msp430_devnet_read(int net, uint32_t *mask, uint32_t *value)
+{
+  uint8_t val8 = 0;
+  int     ret  = 0;
+
+  switch (net)
+    {
+#if defined(__msp430_have_usart0)
+    case DEVNET_SPI(0):
+      ret = msp430_usart0_dev_read_spi(&val8);
+      break;
+    case DEVNET_UART(0):
+      ret = msp430_usart0_dev_read_uart(&val8);
+      break;
+#endif
+#if defined(__msp430_have_usart1)
+    case DEVNET_SPI(1):
+      ret = msp430_usart1_dev_read_spi(&val8);
+      break;
+    case DEVNET_UART(1):
+      ret = msp430_usart1_dev_read_uart(&val8);
+      break;
+#endif
+    default:
+      if (net < 9)
+	{
+	  msp430_digiIO_dev_read(net, &val8);
+	  *mask  = MCU.digiIO.out_updated[net];
+	  *value = val8;
+	  return *mask != 0;
+	}
+      ERROR("msp430:devnet: unknown net %d\n",net);
+      return 0;
+    }
+
+  *mask  = 0xff;
+  *value = val8;
+  return ret;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
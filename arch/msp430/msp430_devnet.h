@@ -0,0 +1,20 @@
+/**
+ *  \file   msp430_devnet.h
+ *  \brief  MSP430 nets for the platform devices interconnect
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef MSP430_DEVNET_H
+#define MSP430_DEVNET_H
+
+/**
+ * mcu side of devices/devices_net.h: port outputs are flagged by the
+ * digital IO module when they change, usart nets are flagged when a
+ * byte is waiting in the tx shift register.
+ **/
+
+uint32_t msp430_devnet_pending (void);
+int      msp430_devnet_read    (int net, uint32_t *mask, uint32_t *value);
+
+#endif
@@ -207,15 +207,15 @@
 /* ************************************************** */
 /* ************************************************** */
 
-tracer_id_t MSP430_TRACER_PORT1;
-tracer_id_t MSP430_TRACER_PORT2;
-tracer_id_t MSP430_TRACER_PORT3;
-tracer_id_t MSP430_TRACER_PORT4;
-tracer_id_t MSP430_TRACER_PORT5;
-tracer_id_t MSP430_TRACER_PORT6;
-tracer_id_t MSP430_TRACER_PORT7;
-tracer_id_t MSP430_TRACER_PORT8;
-tracer_id_t MSP430_TRACER_PORTJ;
+WSIM_TLS tracer_id_t MSP430_TRACER_PORT1;
+WSIM_TLS tracer_id_t MSP430_TRACER_PORT2;
+WSIM_TLS tracer_id_t MSP430_TRACER_PORT3;
+WSIM_TLS tracer_id_t MSP430_TRACER_PORT4;
+WSIM_TLS tracer_id_t MSP430_TRACER_PORT5;
+WSIM_TLS tracer_id_t MSP430_TRACER_PORT6;
+WSIM_TLS tracer_id_t MSP430_TRACER_PORT7;
+WSIM_TLS tracer_id_t MSP430_TRACER_PORT8;
+WSIM_TLS tracer_id_t MSP430_TRACER_PORTJ;
 
 #define TRACER_TRACE_PORT1(v)   tracer_event_record(MSP430_TRACER_PORT1,v)
 #define TRACER_TRACE_PORT2(v)   tracer_event_record(MSP430_TRACER_PORT2,v)
@@ -354,6 +354,17 @@ char* msp430_digiIO_portname(uint16_t addr)
  */
 #define DIGIIO_OUT(p)    MCU.digiIO.out[p]
 
+/**
+ * output change, out_changed keeps one bit per port so that the
+ * platform interconnect does not have to poll every port
+ */
+#define DIGIIO_OUT_UPDATED(p,oldval)                            \
+  do {                                                          \
+    MCU.digiIO.out_updated[p] = oldval ^ DIGIIO_OUT(p);         \
+    if (MCU.digiIO.out_updated[p] != 0)                         \
+      MCU.digiIO.out_changed |= (1 << p);                       \
+  } while (0)
+
 /** 
  * direction register 
  * PxDIR : 0 = input direction, 1 = output direction
@@ -545,7 +556,7 @@ void msp430_digiIO_mcu_write(uint16_t addr, int8_t val)
     case P1OUT: 
       oldval = DIGIIO_OUT(0);
       DIGIIO_OUT(0) = val & DIGIIO_MCU_WOK(0); 
-      MCU.digiIO.out_updated[0] = oldval ^ DIGIIO_OUT(0); 
+      DIGIIO_OUT_UPDATED(0,oldval); 
       TRACER_TRACE_PORT1(DIGIIO_OUT(0));
       break; 
     case P1DIR: DIGIIO_DIR(0) = val; break;
@@ -568,7 +579,7 @@ void msp430_digiIO_mcu_write(uint16_t addr, int8_t val)
     case P2OUT:
       oldval = DIGIIO_OUT(1); 
       DIGIIO_OUT(1) = val & DIGIIO_MCU_WOK(1); 
-      MCU.digiIO.out_updated[1] = oldval ^ DIGIIO_OUT(1); 
+      DIGIIO_OUT_UPDATED(1,oldval); 
       TRACER_TRACE_PORT2(DIGIIO_OUT(1));
       break; 
     case P2DIR: DIGIIO_DIR(1) = val; break; 
@@ -592,7 +603,7 @@ void msp430_digiIO_mcu_write(uint16_t addr, int8_t val)
     case P3OUT:
       oldval = DIGIIO_OUT(2); 
       DIGIIO_OUT(2) = val & DIGIIO_MCU_WOK(2);  
-      MCU.digiIO.out_updated[2] = oldval ^ DIGIIO_OUT(2); 
+      DIGIIO_OUT_UPDATED(2,oldval); 
       TRACER_TRACE_PORT3(DIGIIO_OUT(2));
       break; 
     case P3DIR: DIGIIO_DIR(2) = val; break;
@@ -607,7 +618,7 @@ void msp430_digiIO_mcu_write(uint16_t addr, int8_t val)
     case P4OUT: 
       oldval = DIGIIO_OUT(3); 
       DIGIIO_OUT(3) = val & DIGIIO_MCU_WOK(3);  
-      MCU.digiIO.out_updated[3] = oldval ^ DIGIIO_OUT(3); 
+      DIGIIO_OUT_UPDATED(3,oldval); 
       TRACER_TRACE_PORT4(DIGIIO_OUT(3));
       break;
     case P4DIR: DIGIIO_DIR(3) = val; break;
@@ -622,7 +633,7 @@ void msp430_digiIO_mcu_write(uint16_t addr, int8_t val)
     case P5OUT: 
       oldval = DIGIIO_OUT(4); 
       DIGIIO_OUT(4) = val & DIGIIO_MCU_WOK(4);  
-      MCU.digiIO.out_updated[4] = oldval ^ DIGIIO_OUT(4); 
+      DIGIIO_OUT_UPDATED(4,oldval); 
       TRACER_TRACE_PORT5(DIGIIO_OUT(4));
       break;
     case P5DIR: DIGIIO_DIR(4) = val; break;
@@ -637,7 +648,7 @@ void msp430_digiIO_mcu_write(uint16_t addr, int8_t val)
     case P6OUT: 
       oldval = DIGIIO_OUT(5); 
       DIGIIO_OUT(5) = val & DIGIIO_MCU_WOK(5);  
-      MCU.digiIO.out_updated[5] = oldval ^ DIGIIO_OUT(5); 
+      DIGIIO_OUT_UPDATED(5,oldval); 
       TRACER_TRACE_PORT6(DIGIIO_OUT(5));
       break;
     case P6DIR: DIGIIO_DIR(5) = val; break;
@@ -652,7 +663,7 @@ void msp430_digiIO_mcu_write(uint16_t addr, int8_t val)
     case P7OUT: 
       oldval = DIGIIO_OUT(6); 
       DIGIIO_OUT(6) = val & DIGIIO_MCU_WOK(6);  
-      MCU.digiIO.out_updated[6] = oldval ^ DIGIIO_OUT(6); 
+      DIGIIO_OUT_UPDATED(6,oldval); 
       TRACER_TRACE_PORT7(DIGIIO_OUT(6));
       break;
     case P7DIR: DIGIIO_DIR(6) = val; break;
@@ -667,7 +678,7 @@ void msp430_digiIO_mcu_write(uint16_t addr, int8_t val)
     case P8OUT: 
       oldval = DIGIIO_OUT(7); 
       DIGIIO_OUT(7) = val & DIGIIO_MCU_WOK(7);  
-      MCU.digiIO.out_updated[7] = oldval ^ DIGIIO_OUT(7); 
+      DIGIIO_OUT_UPDATED(7,oldval); 
       TRACER_TRACE_PORT8(DIGIIO_OUT(7));
       break;
     case P8DIR: DIGIIO_DIR(7) = val; break;
@@ -682,7 +693,7 @@ void msp430_digiIO_mcu_write(uint16_t addr, int8_t val)
     case PJOUT:
       oldval = DIGIIO_OUT(8);
       DIGIIO_OUT(8) = val & DIGIIO_MCU_WOK(8);
-      MCU.digiIO.out_updated[8] = oldval ^ DIGIIO_OUT(8);
+      DIGIIO_OUT_UPDATED(8,oldval);
       TRACER_TRACE_PORT8(DIGIIO_OUT(8));
       break;
     case PJDIR: DIGIIO_DIR(8) = val; break;
@@ -801,6 +812,7 @@ void msp430_digiIO_update_done(void)
       MCU.digiIO.in_updated[i]  = 0;
       MCU.digiIO.out_updated[i] = 0;
     }
+  MCU.digiIO.out_changed = 0;
 }
 
 /* ************************************************** */
@@ -31,6 +31,7 @@ struct msp430_digiIO_t
 
   uint8_t out            [9];
   uint8_t out_updated    [9];
+  uint16_t out_changed;           /* bit n set if out_updated[n] != 0 */
 
   uint8_t direction      [9];
   uint8_t selection      [9];
@@ -499,6 +499,22 @@ void msp430_dma_write (uint16_t addr, int16_t val)
 /* ************************************************** */
 /* ************************************************** */
 
+wsimtime_t msp430_dma_horizon()
+{
+  int chann;
+  for(chann=0; chann < DMA_CHANNELS; chann++)
+    {
+      if ((MCU_DMA.channel[ chann ].state != DMA_RESET) ||
+	  (MCU_DMA.channel[ chann ].dmaXctl.b.en == 1))
+	return 0;
+    }
+  return WSIM_HORIZON_INF;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 int msp430_dma_chkifg()
 {
   int i;
@@ -163,6 +163,7 @@ void    msp430_dma_update(void);
 int16_t msp430_dma_read  (uint16_t addr);
 void    msp430_dma_write (uint16_t addr, int16_t val);
 int     msp430_dma_chkifg(void);
+wsimtime_t msp430_dma_horizon(void);
 
 /* ************************************************** */
 /* ************************************************** */
@@ -262,6 +263,7 @@ int     msp430_dma_chkifg(void);
 #define msp430_dma_create()     do { } while (0)
 #define msp430_dma_reset()      do { } while (0)
 #define msp430_dma_update()     do { } while (0)
+#define msp430_dma_horizon()    WSIM_HORIZON_INF
 
 #define DMA_SET_REQ()           do { } while (0)
 #define DMA_SET_TACCR2()        do { } while (0)
@@ -40,7 +40,7 @@
 #define MCUFLASH MCU.flash
 
 void   msp430_flash_update_wait (void);
-void (*msp430_flash_update_ptr) (void);
+WSIM_TLS void (*msp430_flash_update_ptr) (void);
 
 /* ************************************************** */
 /* ************************************************** */
@@ -120,12 +120,14 @@ struct msp430_flash_t {
 void    msp430_flash_create      (void);
 void    msp430_flash_reset       (void);
 
-extern void (*msp430_flash_update_ptr)(void);
+extern WSIM_TLS void (*msp430_flash_update_ptr)(void);
 #define msp430_flash_update()			\
   do {						\
     if (msp430_flash_update_ptr != NULL)	\
       msp430_flash_update_ptr();		\
   } while (0)
+#define msp430_flash_horizon()			\
+  ((msp430_flash_update_ptr != NULL) ? 0 : WSIM_HORIZON_INF)
 
 int16_t msp430_flash_read        (uint16_t addr);
 void    msp430_flash_write       (uint16_t addr, int16_t val);
@@ -138,5 +140,6 @@ void    msp430_flash_start_erase (uint16_t addr, int size, uint32_t val);
 #else
 #define msp430_flash_create() do { } while (0)
 #define msp430_flash_reset()  do { } while (0)
+#define msp430_flash_horizon() WSIM_HORIZON_INF
 #endif /* have_flash */
 #endif
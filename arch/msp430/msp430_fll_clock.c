@@ -29,6 +29,7 @@
 
 static void msp430_fll_clock_adjust_lfxt1_freq();
 static void msp430_fll_clock_adjust_dcoclk_freq();
+static void msp430_fll_clock_adjust_steps();
 static void msp430_fll_clock_printstate();
 
 /* ************************************************** */
@@ -62,6 +63,7 @@ void msp430_fll_clock_puc()
   MCUFLL.lfxt1_cycle_nanotime  = NANO / MCUFLL.lfxt1_freq;
   MCUFLL.xt2_cycle_nanotime    = NANO / MCUFLL.xt2_freq;
   MCUFLL.dcoclk_cycle_nanotime = NANO / MCUFLL.dcoclk_freq;
+  msp430_fll_clock_adjust_steps();
 
   msp430_fll_clock_printstate();
 }
@@ -104,45 +106,19 @@ void msp430_fll_clock_reset()
 
 int msp430_fll_clock_update(int clock_add)
 {
-  int nano_add = 0;
-
-  /********************************************/
-  /* Update nano time                         */
-  /********************************************/
-
-  /* switch on MCLK source, compute other clocks */
-  /* compute the nano equivalent time            */
-  switch (MCUFLL.ctl1.b.selm)
-    {
-    case 0: /* DCOCLK */
-    case 1:
-      nano_add = clock_add * MCUFLL.dcoclk_cycle_nanotime;
-      break;
-    case 2: /* XT2CLK */
-      nano_add = clock_add * MCUFLL.xt2_cycle_nanotime;
-      break;
-    case 3: /* LFXT1CLK */
-      nano_add = clock_add * MCUFLL.lfxt1_cycle_nanotime;
-      break;
-    }
+  /* clock_add is given for MCLK, the per instruction path has no */
+  /* division, periods are folded in the fixed point steps         */
+  int nano_add = msp430_clock_nanotime(MCUFLL.nano_step, clock_add);
 
   /********************************************/
   /* Update internals clocks                  */
   /********************************************/
 
-#define CLOCK_DIVMOD_TEMP(inc,tmp,nanotime)   \
-  do {                                        \
-    tmp += nano_add;                          \
-    inc  = tmp / nanotime;                    \
-    tmp %= nanotime;                          \
-  } while (0)                     
-
-
   /* Software can disable LFXT1 by setting OSCOFF if this signal does not source */
   /* MCLK (SELM != 3 or CPUOFF = 1 ). */
   if ((MCU_READ_OSCOFF == 0) || (MCUFLL.ctl1.b.selm == 3 && MCU_READ_CPUOFF == 0))
     {
-      CLOCK_DIVMOD_TEMP(MCUFLL.lfxt1_increment,MCUFLL.lfxt1_temp,MCUFLL.lfxt1_cycle_nanotime);
+      MCUFLL.lfxt1_increment = msp430_clock_src_ticks(&MCUFLL.lfxt1_src, clock_add);
       MCUFLL.lfxt1_counter   += MCUFLL.lfxt1_increment;
     }
   else
@@ -156,7 +132,7 @@ int msp430_fll_clock_update(int clock_add)
       (MCUFLL.ctl1.b.selm   == 2 && MCU_READ_CPUOFF == 0) || 
       (MCUFLL.ctl1.b.sels   == 1 && MCUFLL.ctl1.b.smclkoff == 0))
     {
-      CLOCK_DIVMOD_TEMP(MCUFLL.xt2_increment,MCUFLL.xt2_temp,MCUFLL.xt2_cycle_nanotime);
+      MCUFLL.xt2_increment = msp430_clock_src_ticks(&MCUFLL.xt2_src, clock_add);
       MCUFLL.xt2_counter     += MCUFLL.xt2_increment;
 #if defined(DEBUG_SRC_OFF)
       if (MCUFLL.ctl1.b.xt2off == 1)
@@ -177,7 +153,7 @@ int msp430_fll_clock_update(int clock_add)
       (MCUFLL.ctl1.b.selm  < 2 && MCU_READ_CPUOFF == 0) || 
       (MCUFLL.ctl1.b.sels == 0 && MCUFLL.ctl1.b.smclkoff == 0))
     {
-      CLOCK_DIVMOD_TEMP(MCUFLL.dcoclk_increment,MCUFLL.dcoclk_temp,MCUFLL.dcoclk_cycle_nanotime);
+      MCUFLL.dcoclk_increment = msp430_clock_src_ticks(&MCUFLL.dcoclk_src, clock_add);
       MCUFLL.dcoclk_counter     += MCUFLL.dcoclk_increment;
 #if defined(DEBUG_SRC_OFF)
       if (MCU_READ_SCG0 == 1)
@@ -347,6 +323,7 @@ void msp430_fll_clock_write(uint16_t addr, int8_t val)
 #endif
 	MCUFLL.ctl1.s = val;
 	MCUFLL.ACLKn_bitmask = BITMASK(MCUFLL.ctl1.b.fll_div);
+	msp430_fll_clock_adjust_steps();
       }
       break;
     default:
@@ -382,6 +359,39 @@ static void msp430_fll_clock_adjust_dcoclk_freq()
       MCUFLL.dcoclk_freq      = MCUFLL.scfi0.b.flld * (MCUFLL.scfqctl.b.N + 1) * MCUFLL.lfxt1_freq; 
     }
   MCUFLL.dcoclk_cycle_nanotime   = NANO / MCUFLL.dcoclk_freq;
+  msp430_fll_clock_adjust_steps();
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * fixed point steps of the oscillators and of the time, called when an
+ * oscillator period or the MCLK source is modified
+ **/
+static void msp430_fll_clock_adjust_steps()
+{
+  uint32_t mclk_period = 0;
+
+  switch (MCUFLL.ctl1.b.selm)
+    {
+    case 0: /* DCOCLK */
+    case 1:
+      mclk_period = MCUFLL.dcoclk_cycle_nanotime;
+      break;
+    case 2: /* XT2CLK */
+      mclk_period = MCUFLL.xt2_cycle_nanotime;
+      break;
+    case 3: /* LFXT1CLK */
+      mclk_period = MCUFLL.lfxt1_cycle_nanotime;
+      break;
+    }
+
+  MCUFLL.nano_step = (uint64_t)mclk_period << CLOCK_FX_SHIFT;
+  msp430_clock_src_set(&MCUFLL.lfxt1_src,  MCUFLL.lfxt1_cycle_nanotime,  mclk_period);
+  msp430_clock_src_set(&MCUFLL.xt2_src,    MCUFLL.xt2_cycle_nanotime,    mclk_period);
+  msp430_clock_src_set(&MCUFLL.dcoclk_src, MCUFLL.dcoclk_cycle_nanotime, mclk_period);
 }
 
 /* ************************************************** */
@@ -157,20 +157,22 @@ struct msp430_fll_clock_t
   uint32_t lfxt1_freq;
   uint32_t lfxt1_cycle_nanotime;
   uint64_t lfxt1_counter;
-  int      lfxt1_temp;
+  struct msp430_clock_src_t lfxt1_src;
   int      lfxt1_increment;
 
   uint32_t xt2_freq;
   uint32_t xt2_cycle_nanotime;
   uint64_t xt2_counter;
-  int      xt2_temp;
+  struct msp430_clock_src_t xt2_src;
   int      xt2_increment;
 
   uint32_t dcoclk_freq;
   uint32_t dcoclk_cycle_nanotime;
   uint64_t dcoclk_counter;
-  int      dcoclk_temp;
+  struct msp430_clock_src_t dcoclk_src;
   int      dcoclk_increment;
+
+  uint64_t nano_step;         /* MCLK source period, ns 32.32 */
 };
 
 /* ************************************************** */
@@ -189,6 +191,10 @@ void    msp430_fll_clock_write(uint16_t addr, int8_t val);
 #define MCU_CLOCK_SYSTEM_UPDATE(n)       msp430_fll_clock_update(n)
 #define MCU_CLOCK_SYSTEM_UPDATE_DONE()   msp430_fll_clock_update_done()
 #define MCU_CLOCK_SYSTEM_SPEED_TRACER()  do { } while (0)
+/* no event horizon, LPM slices are never merged */
+#define MCU_CLOCK_HORIZON(clk,ticks)     0
+#define MCU_CLOCK_CYCLES_NANOTIME(n)     0
+#define MCU_CLOCK_SYSTEM_UPDATE_SLICES(n,s) msp430_fll_clock_update(n)
 
 /* ************************************************** */
 /* ************************************************** */
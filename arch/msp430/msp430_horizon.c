@@ -0,0 +1,166 @@
+/**
+ *  \file   msp430_horizon.c
+ *  \brief  MSP430 low power mode fast-forward
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arch/common/hardware.h"
+#include "machine/machine.h"
+#include "msp430.h"
+#include "src/options.h"
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/*
+ * upper bound for a single jump, the clock and device update
+ * paths use int nanosecond increments
+ */
+#define HORIZON_MAX_JUMP_NS (100*1000*1000)
+
+/*
+ * slices kept before the horizon, covers float rounding when
+ * clocks are computed with HIGH_RES_CLOCK
+ */
+#define HORIZON_MARGIN_SLICES 2
+
+WSIM_TLS struct msp430_horizon_t msp430_horizon;
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static struct moption_t lpm_skip_opt = {
+  .longname    = "msp430_lpm_skip",
+  .type        = no_argument,
+  .helpstring  = "fast-forward low power modes to the next event",
+  .value       = NULL
+};
+
+int msp430_horizon_option_add(void)
+{
+  options_add( &lpm_skip_opt );
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void msp430_horizon_create(void)
+{
+  memset(&msp430_horizon, 0, sizeof(struct msp430_horizon_t));
+  msp430_horizon.enabled = lpm_skip_opt.isset;
+  if (msp430_horizon.enabled)
+    {
+      HW_DMSG_LPM("msp430:lpm: low power mode fast-forward enabled\n");
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#define HORIZON_MIN(h,dev)			\
+  do {						\
+    wsimtime_t d = dev;				\
+    if (d < h)					\
+      h = d;					\
+  } while (0)
+
+wsimtime_t msp430_devices_horizon(void)
+{
+  wsimtime_t UNUSED h = WSIM_HORIZON_INF;
+
+  /* 
+   * peripherals that do not report a horizon. sfr, svs, hwmul, digiIO,
+   * dac12, cmpa, lcd, lcdb, pmm, portmap and basic_timer updates are
+   * empty or do not depend on elapsed time.
+   */
+#if defined(__msp430_have_rtc)       || \
+    defined(__msp430_have_uscia0)    || defined(__msp430_have_uscib0)  || \
+    defined(__msp430_have_adc10)     || \
+    defined(__msp430_have_timerTA0)  || defined(__msp430_have_timerTA1)
+  return 0;
+#else
+  // serial interfaces
+  HORIZON_MIN(h, msp430_usart0_horizon());
+  HORIZON_MIN(h, msp430_usart1_horizon());
+  // timers
+  HORIZON_MIN(h, msp430_watchdog_horizon());
+  HORIZON_MIN(h, msp430_timerA_horizon());
+  HORIZON_MIN(h, msp430_timerB_horizon());
+  // analog
+  HORIZON_MIN(h, msp430_adc12_horizon());
+  // misc
+  HORIZON_MIN(h, msp430_dma_horizon());
+  HORIZON_MIN(h, msp430_flash_horizon());
+  return h;
+#endif
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+unsigned int msp430_horizon_lpm_slices(unsigned int cycles)
+{
+  wsimtime_t slice;
+  wsimtime_t h;
+  unsigned int n;
+
+  if ((msp430_horizon.enabled == 0) || (MCU_IV != 0) || etracer_is_enabled())
+    {
+      return 1;
+    }
+
+  slice = MCU_CLOCK_CYCLES_NANOTIME(cycles);
+  if (slice == 0)
+    {
+      return 1;
+    }
+
+  /* cheap internal test first, platform devices next */
+  h = msp430_devices_horizon();
+  if (h > (2 + HORIZON_MARGIN_SLICES) * slice)
+    {
+      HORIZON_MIN(h, machine_horizon());
+    }
+  if (h <= (2 + HORIZON_MARGIN_SLICES) * slice)
+    {
+      return 1;
+    }
+  if (h > HORIZON_MAX_JUMP_NS)
+    {
+      h = HORIZON_MAX_JUMP_NS;
+    }
+
+  /* the event must not be reached within the merged slices */
+  n = (h - 1) / slice - HORIZON_MARGIN_SLICES;
+
+  msp430_horizon.lpm_jumps  ++;
+  msp430_horizon.lpm_slices += n;
+  return n;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void msp430_horizon_dump_stats(void)
+{
+  if (msp430_horizon.enabled == 0)
+    return;
+
+  OUTPUT_STATS("  lpm fast-forward jumps        : %"PRIu64"\n",msp430_horizon.lpm_jumps);
+  OUTPUT_STATS("  lpm fast-forward slices       : %"PRIu64"\n",msp430_horizon.lpm_slices);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
@@ -0,0 +1,58 @@
+/**
+ *  \file   msp430_horizon.h
+ *  \brief  MSP430 low power mode fast-forward
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef MSP430_HORIZON_H
+#define MSP430_HORIZON_H
+
+/**
+ * While the cpu is off the simulation loop runs in slices of a few MCLK
+ * cycles. Each internal peripheral and each platform device reports an
+ * event horizon: the delay during which its state cannot change (a timer
+ * compare, a watchdog interval, a radio timer, a wsnet rendez-vous, ...).
+ * When all horizons are far enough, consecutive LPM slices are merged in
+ * a single update. Clocks, dividers and timer counters are integer and
+ * linear as long as no event is crossed, so merged slices give the same
+ * state and the same interrupt timings as the step by step loop.
+ *
+ * A horizon of 0 means that the peripheral cannot predict its next state
+ * change and that slices are not merged.
+ **/
+
+/* clock sources used by peripheral horizons */
+#define HORIZON_ACLK   0
+#define HORIZON_SMCLK  1
+
+struct msp430_horizon_t {
+  int      enabled;
+
+  uint64_t lpm_jumps;    /* merged updates                     */
+  uint64_t lpm_slices;   /* LPM slices covered by merged jumps */
+};
+
+extern WSIM_TLS struct msp430_horizon_t msp430_horizon;
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int        msp430_horizon_option_add (void);
+void       msp430_horizon_create     (void);
+
+/**
+ * min of internal peripheral horizons
+ **/
+wsimtime_t msp430_devices_horizon    (void);
+
+/**
+ * number of LPM slices of 'cycles' MCLK cycles that can be run in a
+ * single update, returns 1 when nothing can be merged
+ **/
+unsigned int msp430_horizon_lpm_slices (unsigned int cycles);
+
+void       msp430_horizon_dump_stats (void);
+
+#endif
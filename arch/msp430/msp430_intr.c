@@ -40,6 +40,23 @@ void msp430_interrupt_set(int intr_num)
 /* ************************************************** */
 /* ************************************************** */
 
+/**
+ * MCU_IV is the pending interrupt bitmap, the vector number is the
+ * priority. The highest pending interrupt is found with a count leading
+ * zeros instead of a walk from bit 63. iv must not be 0.
+ **/
+static inline int msp430_interrupt_highest(uint64_t iv)
+{
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(iv);
+#else
+  int inum = 63;
+  while ((iv & ((uint64_t)1 << inum)) == 0)
+    inum--;
+  return inum;
+#endif
+}
+
 int msp430_interrupt_start_if_any(void)
 {
   /**
@@ -94,161 +111,150 @@ int msp430_interrupt_start_if_any(void)
 
   if (MCU_IV && ((SR & MASK_GIE) || (MCU_IV & (1 << 14)) || (MCU_IV & (1 << 15))))
     {
-      /* get ISR address with biggest priority */
-#if defined(__msp430_have_16_interrupts)
-      uint16_t ibit,inum;
-      for(ibit=0x8000u, inum=15; ibit; ibit >>= 1, inum--)
-#elif defined(__msp430_have_32_interrupts)
-      uint32_t ibit,inum;
-      for(ibit=0x80000000u, inum=31; ibit; ibit >>= 1, inum--)
-#elif defined(__msp430_have_64_interrupts)
-      uint64_t ibit,inum;
-      for(ibit=0x8000000000000000u, inum=63; ibit; ibit >>= 1, inum--)
-#endif
-	{
-	  if (MCU_IV & ibit)
-	    {
-	      ivector = INTR_BASE_IV_ADDR + inum * 2;
-	      next_pc = msp430_read_short(ivector);
+      /* get ISR address with biggest priority, the highest pending bit */
+      int      inum = msp430_interrupt_highest(MCU_IV);
+      uint64_t ibit = (uint64_t)1 << inum;
+
+      ivector = INTR_BASE_IV_ADDR + inum * 2;
+      next_pc = msp430_read_short(ivector);
 	      
-	      HW_DMSG_INTR("msp430:intr: IRQ %d [%"PRId64"] PC [0x%04x] jumps to [0x%04x], IV=0x%04x, SR=0x%04x\n",
-			   inum,MACHINE_TIME_GET_NANO(),mcu_get_pc(),next_pc,MCU_IV,SR);
-	      TRACER_TRACE_INTR(inum);
-	      /* push pc*/
-	      SP -= 2;
-	      /* we are executed at the end of an instruction. As this instruction is
-	       * done we have to push what should be the next instruction (resume insn)
-	       */
-	      msp430_write_short(SP,mcu_get_pc_next()); 
-	      /* push sr */
-	      SP -= 2;
-	      msp430_write_short(SP,SR);
-	      /* load pc : substitutes next instruction */
-	      mcu_set_pc_next( next_pc );
+      HW_DMSG_INTR("msp430:intr: IRQ %d [%"PRId64"] PC [0x%04x] jumps to [0x%04x], IV=0x%04x, SR=0x%04x\n",
+		   inum,MACHINE_TIME_GET_NANO(),mcu_get_pc(),next_pc,MCU_IV,SR);
+      TRACER_TRACE_INTR(inum);
+      /* push pc*/
+      SP -= 2;
+      /* we are executed at the end of an instruction. As this instruction is
+       * done we have to push what should be the next instruction (resume insn)
+       */
+      msp430_write_short(SP,mcu_get_pc_next()); 
+      /* push sr */
+      SP -= 2;
+      msp430_write_short(SP,SR);
+      MACHINE_FWPROF_IRQ(mcu_get_pc_next(), next_pc, SP);
+      /* load pc : substitutes next instruction */
+      mcu_set_pc_next( next_pc );
 
-	      if (RUNNING_MODE() != RUNNING_AM)
-		{
-		  uint16_t UNUSED nsr;
-		  HW_DMSG_LPM("msp430:intr: IRQ %d, LPM changed, going to AM\n",inum);
-		  HW_DMSG_LPM("msp430:intr:     from (SCG1:%d,SCG0:%d,OSCOFF:%d,CPUOFF:%d)\n",
-			      (SR>>SHIFT_SCG1)&1,(SR>>SHIFT_SCG0)&1,(SR>>SHIFT_OSCOFF)&1,(SR>>SHIFT_CPUOFF)&1);
-		  nsr = SR & MASK_SCG0;
-		  HW_DMSG_LPM("msp430:intr:     to   (SCG1:%d,SCG0:%d,OSCOFF:%d,CPUOFF:%d)\n",
-			      (nsr>>SHIFT_SCG1)&1,(nsr>>SHIFT_SCG0)&1,(nsr>>SHIFT_OSCOFF)&1,(nsr>>SHIFT_CPUOFF)&1);
-		  mcu_signal_add(SIG_MCU_LPM_CHANGE);
-		}
+      if (RUNNING_MODE() != RUNNING_AM)
+	{
+	  uint16_t UNUSED nsr;
+	  HW_DMSG_LPM("msp430:intr: IRQ %d, LPM changed, going to AM\n",inum);
+	  HW_DMSG_LPM("msp430:intr:     from (SCG1:%d,SCG0:%d,OSCOFF:%d,CPUOFF:%d)\n",
+		      (SR>>SHIFT_SCG1)&1,(SR>>SHIFT_SCG0)&1,(SR>>SHIFT_OSCOFF)&1,(SR>>SHIFT_CPUOFF)&1);
+	  nsr = SR & MASK_SCG0;
+	  HW_DMSG_LPM("msp430:intr:     to   (SCG1:%d,SCG0:%d,OSCOFF:%d,CPUOFF:%d)\n",
+		      (nsr>>SHIFT_SCG1)&1,(nsr>>SHIFT_SCG0)&1,(nsr>>SHIFT_OSCOFF)&1,(nsr>>SHIFT_CPUOFF)&1);
+	  mcu_signal_add(SIG_MCU_LPM_CHANGE);
+	}
 
-	      /* says SCG0 is not cleared on interrupt */
-	      SR = SR & MASK_SCG0; // reset SR, except SCG0
+      /* says SCG0 is not cleared on interrupt */
+      SR = SR & MASK_SCG0; // reset SR, except SCG0
 
-	      MCU_ALU.irq_counter += 1;
+      MCU_ALU.irq_counter += 1;
 
-	      /*****************************************/
-	      /* reset IFG for single-source interrupt */
-	      /*****************************************/
-	      switch (inum)
-		{
-		  /* NMI interrupt flag must be reset by software */
+      /*****************************************/
+      /* reset IFG for single-source interrupt */
+      /*****************************************/
+      switch (inum)
+	{
+	  /* NMI interrupt flag must be reset by software */
 
-		case INTR_WATCHDOG:
-		  if (msp430_watchdog_getmode() == WDT_MODE_INTERVAL)
-		    {
-		      HW_DMSG_INTR("msp430:intr:   Watchdog interval mode reset IFG flag\n");
-		      MCU.sfr.ifg1.b.wdtifg = 0;
-		    }
-		  break;
+	case INTR_WATCHDOG:
+	  if (msp430_watchdog_getmode() == WDT_MODE_INTERVAL)
+	    {
+	      HW_DMSG_INTR("msp430:intr:   Watchdog interval mode reset IFG flag\n");
+	      MCU.sfr.ifg1.b.wdtifg = 0;
+	    }
+	  break;
 
 #if defined(__msp430_have_timera3)
-		case INTR_TIMERA_0:
-		  HW_DMSG_INTR("msp430:intr:   Reset timerA taccr0 IFG flag\n");
-		  MCU.timerA.tacctl[0].b.ccifg = 0;
+	case INTR_TIMERA_0:
+	  HW_DMSG_INTR("msp430:intr:   Reset timerA taccr0 IFG flag\n");
+	  MCU.timerA.tacctl[0].b.ccifg = 0;
 #if defined(SOFT_INTR)
-		  MCU.soft_intr         = 1;
-		  MCU.soft_intr_timeend = MACHINE_TIME_GET_NANO() + SOFT_INTR_DUR;
-		  etracer_slot_event(SOFT_INTR_EVT, ETRACER_PER_EVT_MODE_CHANGED, 2, 0);
+	  MCU.soft_intr         = 1;
+	  MCU.soft_intr_timeend = MACHINE_TIME_GET_NANO() + SOFT_INTR_DUR;
+	  etracer_slot_event(SOFT_INTR_EVT, ETRACER_PER_EVT_MODE_CHANGED, 2, 0);
 #endif
-		  break;
+	  break;
 #endif
 
 #if defined(__msp430_have_timerb3) || defined(__msp430_have_timerb7)
-		case INTR_TIMERB_0:
-		  HW_DMSG_INTR("msp430:intr:   Reset timerB IFG flag\n");
-		  MCU.timerB.tbcctl[0].b.ccifg = 0;
-		  break;
+	case INTR_TIMERB_0:
+	  HW_DMSG_INTR("msp430:intr:   Reset timerB IFG flag\n");
+	  MCU.timerB.tbcctl[0].b.ccifg = 0;
+	  break;
 #endif
 
 #if defined(__msp430_have_timerTA0)
-		case INTR_TIMERTA0_0:
-		  HW_DMSG_INTR("msp430:intr:   Reset timerTA0 taccr0 IFG flag\n");
-		  MCU.timerTA0.ta0cctl[0].b.ccifg = 0;
+	case INTR_TIMERTA0_0:
+	  HW_DMSG_INTR("msp430:intr:   Reset timerTA0 taccr0 IFG flag\n");
+	  MCU.timerTA0.ta0cctl[0].b.ccifg = 0;
 #if defined(SOFT_INTR)
-		  MCU.soft_intr         = 1;
-		  MCU.soft_intr_timeend = MACHINE_TIME_GET_NANO() + SOFT_INTR_DUR;
-		  etracer_slot_event(SOFT_INTR_EVT, ETRACER_PER_EVT_MODE_CHANGED, 2, 0);
+	  MCU.soft_intr         = 1;
+	  MCU.soft_intr_timeend = MACHINE_TIME_GET_NANO() + SOFT_INTR_DUR;
+	  etracer_slot_event(SOFT_INTR_EVT, ETRACER_PER_EVT_MODE_CHANGED, 2, 0);
 #endif
-		  break;
+	  break;
 #endif
 
 #if defined(__msp430_have_timerTA1)
- 		case INTR_TIMERTA1_0:
-		  HW_DMSG_INTR("msp430:intr:   Reset timerTA1 taccr1 IFG flag\n");
-		  MCU.timerTA1.ta1cctl[0].b.ccifg = 0;
+	case INTR_TIMERTA1_0:
+	  HW_DMSG_INTR("msp430:intr:   Reset timerTA1 taccr1 IFG flag\n");
+	  MCU.timerTA1.ta1cctl[0].b.ccifg = 0;
 #if defined(SOFT_INTR)
-		  MCU.soft_intr         = 1;
-		  MCU.soft_intr_timeend = MACHINE_TIME_GET_NANO() + SOFT_INTR_DUR;
-		  etracer_slot_event(SOFT_INTR_EVT, ETRACER_PER_EVT_MODE_CHANGED, 2, 0);
+	  MCU.soft_intr         = 1;
+	  MCU.soft_intr_timeend = MACHINE_TIME_GET_NANO() + SOFT_INTR_DUR;
+	  etracer_slot_event(SOFT_INTR_EVT, ETRACER_PER_EVT_MODE_CHANGED, 2, 0);
 #endif
-		  break;
+	  break;
 #endif
 
 #if ( defined(__msp430_have_uscia0) || defined(__msp430_have_uscib0) ) && !defined(__msp430_have_new_sfr)
-		case INTR_USCIX0_RX:
+	case INTR_USCIX0_RX:
 		  #if defined(__msp430_have_uscia0)
-		    HW_DMSG_INTR("msp430:intr:   Reset USCIA0 rx IFG flag\n");
-		    MCU.sfr.ifg2.b.uca0rxifg = 0;
+	    HW_DMSG_INTR("msp430:intr:   Reset USCIA0 rx IFG flag\n");
+	    MCU.sfr.ifg2.b.uca0rxifg = 0;
 		  #else
-		    HW_DMSG_INTR("msp430:intr:   Reset USCIB0 rx IFG flag\n");
-		    MCU.sfr.ifg2.b.ucb0rxifg = 0;
+	    HW_DMSG_INTR("msp430:intr:   Reset USCIB0 rx IFG flag\n");
+	    MCU.sfr.ifg2.b.ucb0rxifg = 0;
 		  #endif
-		  break;
-		case INTR_USCIX0_TX:
+	  break;
+	case INTR_USCIX0_TX:
 		  #if defined(__msp430_have_uscia0)
-		    HW_DMSG_INTR("msp430:intr:   Reset USCIA0 tx IFG flag\n");
-		    MCU.sfr.ifg2.b.uca0txifg = 0;
+	    HW_DMSG_INTR("msp430:intr:   Reset USCIA0 tx IFG flag\n");
+	    MCU.sfr.ifg2.b.uca0txifg = 0;
 		  #else
-		    HW_DMSG_INTR("msp430:intr:   Reset USCIB0 tx IFG flag\n");
-		    MCU.sfr.ifg2.b.ucb0txifg = 0;
+	    HW_DMSG_INTR("msp430:intr:   Reset USCIB0 tx IFG flag\n");
+	    MCU.sfr.ifg2.b.ucb0txifg = 0;
 		  #endif
-		  break;
+	  break;
 #endif
 		  	  
 #if defined(__msp430_have_usart0) && !defined(__msp430_have_new_sfr)
-		case INTR_USART0_RX:
-		  HW_DMSG_INTR("msp430:intr:   Reset USART0 rx IFG flag\n");
-		  MCU.sfr.ifg1.b.urxifg0 = 0;
-		  break;
-		case INTR_USART0_TX:
-		  HW_DMSG_INTR("msp430:intr:   Reset USART0 tx IFG flag\n");
-		  MCU.sfr.ifg1.b.utxifg0 = 0;
-		  break;
+	case INTR_USART0_RX:
+	  HW_DMSG_INTR("msp430:intr:   Reset USART0 rx IFG flag\n");
+	  MCU.sfr.ifg1.b.urxifg0 = 0;
+	  break;
+	case INTR_USART0_TX:
+	  HW_DMSG_INTR("msp430:intr:   Reset USART0 tx IFG flag\n");
+	  MCU.sfr.ifg1.b.utxifg0 = 0;
+	  break;
 #endif
 		
 #if defined(__msp430_have_usart1) && !defined(__msp430_have_new_sfr)
-		case INTR_USART1_RX:
-		  HW_DMSG_INTR("msp430:intr:   Reset USART1 rx IFG flag\n");
-		  MCU.sfr.ifg2.b.urxifg1 = 0;
-		  break;
-		case INTR_USART1_TX:
-		  HW_DMSG_INTR("msp430:intr:   Reset USART1 tx IFG flag\n");
-		  MCU.sfr.ifg2.b.utxifg1 = 0;
-		  break;
+	case INTR_USART1_RX:
+	  HW_DMSG_INTR("msp430:intr:   Reset USART1 rx IFG flag\n");
+	  MCU.sfr.ifg2.b.urxifg1 = 0;
+	  break;
+	case INTR_USART1_TX:
+	  HW_DMSG_INTR("msp430:intr:   Reset USART1 tx IFG flag\n");
+	  MCU.sfr.ifg2.b.utxifg1 = 0;
+	  break;
 #endif
-		}
-	      
-	      MCU_IV &= ~ibit;
-	      return 1;
-	    }
 	}
+	      
+      MCU_IV &= ~ibit;
+      return 1;
     }
   return 0;
 }
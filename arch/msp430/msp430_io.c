@@ -19,11 +19,11 @@
 
 #define ADDR64K 0x10000
 
-static addr_map_read8_t   pread8  [ADDR64K];
-static addr_map_write8_t  pwrite8 [ADDR64K];   
+static WSIM_TLS addr_map_read8_t   pread8  [ADDR64K];
+static WSIM_TLS addr_map_write8_t  pwrite8 [ADDR64K];   
  
-static addr_map_read16_t  pread16 [ADDR64K];
-static addr_map_write16_t pwrite16[ADDR64K];
+static WSIM_TLS addr_map_read16_t  pread16 [ADDR64K];
+static WSIM_TLS addr_map_write16_t pwrite16[ADDR64K];
 
 static int8_t  msp430_read8_sigbus   (uint16_t addr);
 static int16_t msp430_read16_sigbus  (uint16_t addr);
@@ -144,6 +144,7 @@ static MEM_INLINE void msp430_write8_ram(uint16_t addr, int8_t val)
 {
   addr &= 0xffffu;  /* broken 16<>32 code with gcc, need to test later */
   mcu_ramctl_write(addr);
+  MCU_RAM_DIRTY_SET(addr);
   MCU_RAM[addr] = val;
 }
 
@@ -153,8 +154,10 @@ static MEM_INLINE void msp430_write16_ram(uint16_t addr, int16_t val)
 
   addr &= 0xffffu;  /* broken 16<>32 code with gcc, need to test later */
   mcu_ramctl_write(addr);
+  MCU_RAM_DIRTY_SET(addr);
   MCU_RAM[addr++] =  val       & 0xff;
   mcu_ramctl_write(addr);
+  MCU_RAM_DIRTY_SET(addr);
   MCU_RAM[addr  ] = (val >> 8) & 0xff;
 }
 
@@ -309,6 +312,7 @@ void msp430_io_set_flash_read_jump_pc(uint16_t start, uint16_t stop)
     {
       msp430_set_readptr16 (msp430_read16_flash_jump_pc, addr);
     }
+  msp430_tcache_set_bypass(1);
 }
 
 void msp430_io_set_flash_read_normal (uint16_t start, uint16_t stop)
@@ -318,6 +322,7 @@ void msp430_io_set_flash_read_normal (uint16_t start, uint16_t stop)
     {
       msp430_set_readptr16 (msp430_read16_flash, addr);
     }
+  msp430_tcache_set_bypass(0);
 }
 
 /* ************************************************** */
@@ -451,6 +456,33 @@ uint16_t msp430_fetch_short(uint16_t loc)
 /* ************************************************** */
 /* ************************************************** */
 
+/**
+ * memory side effects of msp430_fetch_short() and msp430_read_short()
+ * on a flash location, the value is already known by the caller
+ * (predecoded instructions from the translation cache)
+ **/
+
+void msp430_fetch_short_access(uint16_t loc)
+{
+  etracer_slot_access(loc, 1, ETRACER_ACCESS_READ, ETRACER_ACCESS_HWORD, ETRACER_ACCESS_LVL_BUS, 0);
+  mcu_ramctl_read(loc);
+  mcu_ramctl_read(loc + 1);
+  mcu_ramctl_tst_fetch(loc);
+}
+
+void msp430_read_short_access(uint16_t loc)
+{
+  etracer_slot_access(loc, 1, ETRACER_ACCESS_READ, ETRACER_ACCESS_HWORD, ETRACER_ACCESS_LVL_BUS, 0);
+  mcu_ramctl_read(loc);
+  mcu_ramctl_read(loc + 1);
+  mcu_ramctl_tst_read(loc);
+  mcu_ramctl_tst_read(loc + 1);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 void msp430_write_byte(uint16_t loc, int8_t val)
 {
   HW_DMSG_IO("msp430:io: write_byte [0x%04x] = 0x%02x\n",loc,val);
@@ -17,6 +17,9 @@ uint16_t msp430_fetch_short (uint16_t loc);
 void     msp430_write_byte  (uint16_t loc, int8_t  val);
 void     msp430_write_short (uint16_t loc, int16_t val);
 
+void     msp430_fetch_short_access (uint16_t loc);
+void     msp430_read_short_access  (uint16_t loc);
+
 void     msp430_io_set_flash_write_start_erase (uint16_t start, uint16_t end);
 void     msp430_io_set_flash_write_normal      (uint16_t start, uint16_t end);
 void     msp430_io_set_flash_read_jump_pc      (uint16_t start, uint16_t end);
@@ -0,0 +1,263 @@
+/**
+ *  \file   msp430_tcache.c
+ *  \brief  MSP430 predecoded instruction translation cache
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "arch/common/hardware.h"
+#include "msp430.h"
+#include "src/options.h"
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#define TCACHE_ENTRIES     (((ADDR_FLASH_STOP - ADDR_FLASH_START) + 1) / 2)
+#define TCACHE_INDEX(pc)   (((pc) - ADDR_FLASH_START) >> 1)
+
+WSIM_TLS struct msp430_tcache_t msp430_tcache;
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static struct moption_t tcache_opt = {
+  .longname    = "msp430_tcache",
+  .type        = optional_argument,
+  .helpstring  = "msp430 predecoded instruction cache\n\
+\t\t\t\t--msp430_tcache[=on | lockstep]\n\
+\t\t\t\t\ton       : use predecoded instructions (default)\n\
+\t\t\t\t\tlockstep : interpreter checked against the cache",
+  .value       = NULL
+};
+
+int msp430_tcache_option_add(void)
+{
+  options_add( &tcache_opt );
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void msp430_tcache_create(void)
+{
+  memset(&msp430_tcache, 0, sizeof(struct msp430_tcache_t));
+  msp430_tcache.mode = TCACHE_OFF;
+
+  if (tcache_opt.isset == 0)
+    {
+      return;
+    }
+
+  if ((tcache_opt.value == NULL) || (strcmp(tcache_opt.value, "on") == 0))
+    {
+      msp430_tcache.mode = TCACHE_ON;
+    }
+  else if (strcmp(tcache_opt.value, "lockstep") == 0)
+    {
+      msp430_tcache.mode = TCACHE_LOCKSTEP;
+    }
+  else
+    {
+      ERROR("msp430:tcache: unknown mode \"%s\"\n", tcache_opt.value);
+      machine_exit_error();
+    }
+
+#if DEBUG_DISASSEMBLE != 0
+  if (msp430_tcache.mode == TCACHE_ON)
+    {
+      WARNING("msp430:tcache: disassembler is on, using lockstep mode\n");
+      msp430_tcache.mode = TCACHE_LOCKSTEP;
+    }
+#endif
+
+  msp430_tcache.table = (struct msp430_tcache_insn_t*)
+    calloc(TCACHE_ENTRIES, sizeof(struct msp430_tcache_insn_t));
+  if (msp430_tcache.table == NULL)
+    {
+      ERROR("msp430:tcache: cannot allocate cache (%d entries)\n", TCACHE_ENTRIES);
+      machine_exit_error();
+    }
+
+  HW_DMSG_MSP("msp430:tcache: %s mode, %d entries [0x%04x-0x%04x]\n",
+	      (msp430_tcache.mode == TCACHE_ON) ? "on" : "lockstep",
+	      TCACHE_ENTRIES, ADDR_FLASH_START, ADDR_FLASH_STOP);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void msp430_tcache_flush(void)
+{
+  if (msp430_tcache.table == NULL)
+    return;
+
+  memset(msp430_tcache.table, 0, TCACHE_ENTRIES * sizeof(struct msp430_tcache_insn_t));
+  msp430_tcache.flushes ++;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * translate a basic block starting at pc. Translation stops on a
+ * control flow instruction, on an already translated record, at the end
+ * of the flash or when the block reaches TCACHE_BLOCK_MAX instructions
+ **/
+
+static struct msp430_tcache_insn_t* msp430_tcache_translate(uint16_t pc)
+{
+  struct msp430_tcache_insn_t *tc;
+  uint32_t addr = pc;
+  int      n    = 0;
+
+  do {
+    tc = &msp430_tcache.table[TCACHE_INDEX(addr)];
+    if (tc->valid)
+      break;
+    if (msp430_alu_predecode((uint16_t)addr, tc) != 0)
+      break;
+    n    ++;
+    addr += tc->size;
+  } while ((tc->eob == 0) && (n < TCACHE_BLOCK_MAX) && (addr <= ADDR_FLASH_STOP));
+
+  if (n == 0)
+    {
+      /* instruction cannot be predecoded */
+      return NULL;
+    }
+
+  HW_DMSG_FD("msp430:tcache: block 0x%04x-0x%04x, %d insn\n", pc, (uint16_t)(addr - 1), n);
+  msp430_tcache.blocks       ++;
+  msp430_tcache.translations += n;
+  return &msp430_tcache.table[TCACHE_INDEX(pc)];
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+struct msp430_tcache_insn_t* msp430_tcache_get(uint16_t pc)
+{
+  struct msp430_tcache_insn_t *tc;
+
+  if ((pc & 1) || (msp430_tcache.table == NULL))
+    return NULL;
+
+  tc = &msp430_tcache.table[TCACHE_INDEX(pc)];
+  if (tc->valid)
+    {
+      msp430_tcache.hits ++;
+      return tc;
+    }
+
+  return msp430_tcache_translate(pc);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void msp430_tcache_invalidate(uint16_t addr, int size)
+{
+  int32_t start, stop, a;
+
+  if (msp430_tcache.table == NULL)
+    return;
+
+  /* a record is at most 3 words long */
+  start = (int32_t)addr - 4;
+  stop  = (int32_t)addr + size - 1;
+
+  if (start < (int32_t)ADDR_FLASH_START)
+    start = ADDR_FLASH_START;
+  if (stop  > (int32_t)ADDR_FLASH_STOP)
+    stop  = ADDR_FLASH_STOP;
+
+  for(a = start & ~1; a <= stop; a += 2)
+    {
+      struct msp430_tcache_insn_t *tc = &msp430_tcache.table[TCACHE_INDEX(a)];
+      if (tc->valid && ((a + tc->size) > addr))
+	{
+	  tc->valid = 0;
+	  msp430_tcache.invalidations ++;
+	  msp430_tcache.dirty = 1;
+	}
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void msp430_tcache_set_bypass(int bypass)
+{
+  msp430_tcache.bypass = bypass;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void msp430_tcache_state_save(void)
+{
+  msp430_tcache.dirty = 0;
+}
+
+void msp430_tcache_state_restore(void)
+{
+  /* flash content may have changed since the last save */
+  if (msp430_tcache.dirty)
+    {
+      msp430_tcache_flush();
+      msp430_tcache.dirty = 0;
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void msp430_tcache_lockstep_error(uint16_t pc, const char *field, int cached, int interp)
+{
+  ERROR("msp430:tcache: lockstep error at PC 0x%04x, %s cache 0x%04x != interpreter 0x%04x\n",
+	pc, field, cached & 0xffff, interp & 0xffff);
+  msp430_tcache.lockstep_errors ++;
+  mcu_signal_add(SIG_MCU | SIG_MCU_ILL);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void msp430_tcache_dump_stats(void)
+{
+  if (msp430_tcache.mode == TCACHE_OFF)
+    return;
+
+  OUTPUT_STATS("  tcache mode                   : %s\n",
+	       (msp430_tcache.mode == TCACHE_ON) ? "on" : "lockstep");
+  OUTPUT_STATS("  tcache hits                   : %"PRIu64"\n",msp430_tcache.hits);
+  OUTPUT_STATS("  tcache translated insn        : %"PRIu64"\n",msp430_tcache.translations);
+  OUTPUT_STATS("  tcache translated blocks      : %"PRIu64"\n",msp430_tcache.blocks);
+  OUTPUT_STATS("  tcache invalidations          : %"PRIu64"\n",msp430_tcache.invalidations);
+  OUTPUT_STATS("  tcache flushes                : %"PRIu64"\n",msp430_tcache.flushes);
+  if (msp430_tcache.mode == TCACHE_LOCKSTEP)
+    {
+      OUTPUT_STATS("  tcache lockstep checks        : %"PRIu64"\n",msp430_tcache.lockstep_checks);
+      OUTPUT_STATS("  tcache lockstep errors        : %"PRIu64"\n",msp430_tcache.lockstep_errors);
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
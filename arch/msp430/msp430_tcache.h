@@ -0,0 +1,142 @@
+/**
+ *  \file   msp430_tcache.h
+ *  \brief  MSP430 predecoded instruction translation cache
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef MSP430_TCACHE_H
+#define MSP430_TCACHE_H
+
+/**
+ * The translation cache holds predecoded instruction records for code
+ * located in the main flash. Records are built one basic block at a time
+ * on the first execution of a block leader and are used by
+ * msp430_mcu_run_insn() in place of the fetch / extract_opcode() / nested
+ * addressing mode decode. Execution is still done one instruction at a time
+ * so that peripherals and devices are updated with the same timings.
+ *
+ * Records are invalidated by any write to the flash area (flash controller
+ * write/erase, JTAG, ELF and hex loading, GDB) and the cache is bypassed
+ * while the flash controller is busy (flash reads return "jmp $").
+ *
+ * lockstep mode: the interpreter is used to run the instruction and its
+ * decode results are compared against the cached record.
+ **/
+
+enum msp430_tcache_mode_t {
+  TCACHE_OFF       = 0,
+  TCACHE_ON        = 1,
+  TCACHE_LOCKSTEP  = 2
+};
+
+/**
+ * Operand access kinds, this is a flattened version of the
+ * (as|ad, register) decode tree found in msp430_alu.c
+ **/
+enum msp430_tcache_opd_kind_t {
+  TC_OPD_NONE      = 0,
+  TC_OPD_REG       = 1,  /* Rn                                  */
+  TC_OPD_CONST     = 2,  /* constant generators, PC value       */
+  TC_OPD_IMM       = 3,  /* #N word immediate                   */
+  TC_OPD_ADDR      = 4,  /* &EDE, @PC, #N.b : read at address k */
+  TC_OPD_ADDR16    = 5,  /* EDE : word read at address k        */
+  TC_OPD_INDEX     = 6,  /* X(Rn)                               */
+  TC_OPD_INDIR     = 7,  /* @Rn                                 */
+  TC_OPD_INDINC    = 8   /* @Rn+                                */
+};
+
+struct msp430_tcache_opd_t {
+  uint8_t  kind;      /* TC_OPD_xxx                              */
+  uint8_t  reg;       /* register                                */
+  uint8_t  ext;       /* an extension word is read at ext_addr   */
+  uint16_t ext_addr;  /* extension word address                  */
+  uint16_t k;         /* constant, immediate, offset or address  */
+};
+
+struct msp430_tcache_insn_t {
+  uint16_t insn;      /* instruction word                        */
+  uint16_t opcode;    /* extract_opcode() result                 */
+  uint8_t  valid;
+  uint8_t  eob;       /* end of basic block                      */
+  uint8_t  size;      /* instruction size in bytes               */
+  uint8_t  cycles;    /* cycles from the timing classes          */
+  uint8_t  byte;      /* operand size                            */
+  uint8_t  mode;      /* type 1 dst mode or type 2 operand mode  */
+  uint8_t  src_t_mode;
+  uint8_t  dst_t_mode;
+  int16_t  offset;    /* type 3 jump offset                      */
+  struct msp430_tcache_opd_t src;  /* type 1 source, type 2 operand */
+  struct msp430_tcache_opd_t dst;  /* type 1 destination           */
+};
+
+struct msp430_tcache_t {
+  int      mode;
+  int      bypass;
+  struct msp430_tcache_insn_t *table;
+
+  uint64_t hits;
+  uint64_t translations;
+  uint64_t blocks;
+  uint64_t invalidations;
+  uint64_t flushes;
+  uint64_t lockstep_checks;
+  uint64_t lockstep_errors;
+
+  int      dirty;     /* invalidation done since last state save */
+};
+
+extern WSIM_TLS struct msp430_tcache_t msp430_tcache;
+
+#define TCACHE_BLOCK_MAX 64
+
+#define TCACHE_IN_FLASH(pc) (((pc) >= ADDR_FLASH_START) && ((pc) <= ADDR_FLASH_STOP))
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int   msp430_tcache_option_add (void);
+void  msp430_tcache_create     (void);
+void  msp430_tcache_flush      (void);
+
+/**
+ * returns the predecoded record for pc, translates the basic block
+ * starting at pc on a miss. Returns NULL if pc cannot be cached.
+ **/
+struct msp430_tcache_insn_t* msp430_tcache_get (uint16_t pc);
+
+#define msp430_tcache_usable(pc)					\
+  ((msp430_tcache.mode != TCACHE_OFF) && (msp430_tcache.bypass == 0) && TCACHE_IN_FLASH(pc))
+
+/**
+ * invalidate records that overlap [addr, addr+size[
+ **/
+void  msp430_tcache_invalidate (uint16_t addr, int size);
+
+/**
+ * flash controller access mode, records are not used while the
+ * flash is busy
+ **/
+void  msp430_tcache_set_bypass (int bypass);
+
+/**
+ * backtrack support
+ **/
+void  msp430_tcache_state_save    (void);
+void  msp430_tcache_state_restore (void);
+
+/**
+ * lockstep check, called by the ALU after an interpreted instruction
+ **/
+void  msp430_tcache_lockstep_error (uint16_t pc, const char *field, int cached, int interp);
+
+void  msp430_tcache_dump_stats (void);
+
+/**
+ * defined in msp430_alu.c, fills a record from the instruction at pc
+ * returns 0 on success
+ **/
+int   msp430_alu_predecode     (uint16_t pc, struct msp430_tcache_insn_t *tc);
+
+#endif
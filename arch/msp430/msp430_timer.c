@@ -480,6 +480,46 @@ char* timerB_tiv_to_str(int val)
     MCU.TIMER.b_##CCR [NUM] = MAX;					\
   } while (0)
 
+/****************************************************/
+/* event horizon                                    */
+/****************************************************/
+
+/* number of counter increments before compare NUM is reached */
+#define TIMER_HORIZON_COMPARE(TIMER,TR,CCR,TCCTL,NUM,dist)		\
+  do {									\
+    if ((MCU.TIMER.TCCTL[NUM].b.cap   == 0) &&				\
+	(MCU.TIMER.TCCTL[NUM].b.ccifg == 0) &&				\
+	(MCU.TIMER.b_##CCR[NUM] != COMPARE_UNREACHABLE))		\
+      {									\
+	int d = (MCU.TIMER.CCR[NUM] > MCU.TIMER.TR) ?			\
+	  (MCU.TIMER.CCR[NUM] - MCU.TIMER.TR) : 1;			\
+	if (d < dist)							\
+	  dist = d;							\
+      }									\
+  } while (0)
+
+#if defined(__msp430_have_timera3) || defined(__msp430_have_timera5) || \
+    defined(__msp430_have_timerb3) || defined(__msp430_have_timerb7)
+/* counter increments are converted to source clock ticks */
+#define TIMER_SOURCE_TICKS(dist,id,divbuffer) (((uint32_t)(dist) << (id)) - (divbuffer))
+
+static wsimtime_t msp430_timer_horizon_ticks(int ssel, int id, unsigned int divbuffer, int dist)
+{
+  if (dist <= 0)
+    return 0;
+
+  switch (ssel)
+    {
+    case TIMER_SOURCE_ACLK:
+      return MCU_CLOCK_HORIZON(HORIZON_ACLK,  TIMER_SOURCE_TICKS(dist,id,divbuffer));
+    case TIMER_SOURCE_SMCLK:
+      return MCU_CLOCK_HORIZON(HORIZON_SMCLK, TIMER_SOURCE_TICKS(dist,id,divbuffer));
+    default:
+      return 0;
+    }
+}
+#endif
+
 
 
 /***********/
@@ -1216,6 +1256,55 @@ int16_t msp430_timerA_read(uint16_t addr)
 /* ************************************************** */
 /* ************************************************** */
 
+/**
+ * time before the next timerA compare or wrap event
+ */
+wsimtime_t msp430_timerA_horizon(void)
+{
+  int i;
+  int dist;
+
+  if (MCU.timerA.tactl.b.mc == TIMER_STOP)
+    return WSIM_HORIZON_INF;
+
+  for(i=0; i < TIMERA_COMPARATOR; i++)
+    {
+      /* captures depend on external signals */
+      if ((MCU.timerA.tacctl[i].b.cap == 1) && (MCU.timerA.tacctl[i].b.cm != 0))
+	return 0;
+    }
+
+  switch (MCU.timerA.tactl.b.mc)
+    {
+    case TIMER_UP:
+      if (MCU.timerA.taccr[0] == 0)
+	return WSIM_HORIZON_INF;
+      dist = (MCU.timerA.taccr[0] > MCU.timerA.tar) ? (MCU.timerA.taccr[0] - MCU.timerA.tar) : 1;
+      for(i=1; i < TIMERA_COMPARATOR; i++)
+	{
+	  TIMER_HORIZON_COMPARE(timerA,tar,taccr,tacctl,i,dist);
+	}
+      break;
+    case TIMER_CONT:
+      dist = (TAR_MAX_LIMIT > MCU.timerA.tar) ? (TAR_MAX_LIMIT - MCU.timerA.tar) : 1;
+      for(i=0; i < TIMERA_COMPARATOR; i++)
+	{
+	  TIMER_HORIZON_COMPARE(timerA,tar,taccr,tacctl,i,dist);
+	}
+      break;
+    default:
+      /* up/down mode is not fast-forwarded */
+      return 0;
+    }
+
+  return msp430_timer_horizon_ticks(MCU.timerA.tactl.b.tassel, MCU.timerA.tactl.b.id,
+				    MCU.timerA.divbuffer, dist);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 int msp430_timerA_chkifg(void)
 {
   int ret = 0;
@@ -1925,6 +2014,55 @@ msp430_timerB_read  (uint16_t addr)
 /* ************************************************** */
 /* ************************************************** */
 
+/**
+ * time before the next timerB compare or wrap event
+ */
+wsimtime_t msp430_timerB_horizon(void)
+{
+  int i;
+  int dist;
+
+  if (MCU.timerB.tbctl.b.mc == TIMER_STOP)
+    return WSIM_HORIZON_INF;
+
+  for(i=0; i < TIMERB_COMPARATOR; i++)
+    {
+      /* captures depend on external signals */
+      if ((MCU.timerB.tbcctl[i].b.cap == 1) && (MCU.timerB.tbcctl[i].b.cm != 0))
+	return 0;
+    }
+
+  switch (MCU.timerB.tbctl.b.mc)
+    {
+    case TIMER_UP:
+      if (MCU.timerB.tbccr[0] == 0)
+	return WSIM_HORIZON_INF;
+      dist = (MCU.timerB.tbccr[0] > MCU.timerB.tbr) ? (MCU.timerB.tbccr[0] - MCU.timerB.tbr) : 1;
+      for(i=1; i < TIMERB_COMPARATOR; i++)
+	{
+	  TIMER_HORIZON_COMPARE(timerB,tbr,tbcl,tbcctl,i,dist);
+	}
+      break;
+    case TIMER_CONT:
+      dist = (MCU.timerB.tbr_limit > MCU.timerB.tbr) ? (MCU.timerB.tbr_limit - MCU.timerB.tbr) : 1;
+      for(i=0; i < TIMERB_COMPARATOR; i++)
+	{
+	  TIMER_HORIZON_COMPARE(timerB,tbr,tbcl,tbcctl,i,dist);
+	}
+      break;
+    default:
+      /* up/down mode is not fast-forwarded */
+      return 0;
+    }
+
+  return msp430_timer_horizon_ticks(MCU.timerB.tbctl.b.tbssel, MCU.timerB.tbctl.b.id,
+				    MCU.timerB.divbuffer, dist);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 int msp430_timerB_chkifg(void)
 {
   int ret = 0;
@@ -175,6 +175,7 @@ void    msp430_timerA_write  (uint16_t addr, int16_t val);
 int8_t  msp430_timerA_read8  (uint16_t addr);
 void    msp430_timerA_write8 (uint16_t addr, int8_t val);
 int     msp430_timerA_chkifg ();
+wsimtime_t msp430_timerA_horizon(void);
 
 #else
 #define msp430_timerA_create()  do { } while (0)
@@ -182,6 +183,7 @@ int     msp430_timerA_chkifg ();
 #define msp430_timerA_update()  do { } while (0)
 #define msp430_timerA_capture() do { } while (0)
 #define msp430_timerA_chkifg()  0
+#define msp430_timerA_horizon() WSIM_HORIZON_INF
 #endif
 
 /***************************************************/
@@ -311,6 +313,7 @@ void    msp430_timerB_capture(void);
 int16_t msp430_timerB_read   (uint16_t addr);
 void    msp430_timerB_write  (uint16_t addr, int16_t val);
 int     msp430_timerB_chkifg (void);
+wsimtime_t msp430_timerB_horizon(void);
 
 #else
 #define msp430_timerB_create()  do { } while (0)
@@ -318,6 +321,7 @@ int     msp430_timerB_chkifg (void);
 #define msp430_timerB_update()  do { } while (0)
 #define msp430_timerB_capture() do { } while (0)
 #define msp430_timerB_chkifg()  0
+#define msp430_timerB_horizon() WSIM_HORIZON_INF
 #endif /* have_timerb */
 
 /***************************************************/
@@ -19,6 +19,7 @@
 
 static void msp430_ucs_adjust_lfxt1_freq();
 static void msp430_ucs_adjust_dcoclk_freq();
+static void msp430_ucs_adjust_steps();
 static void msp430_ucs_printstate();
 
 /* ************************************************** */
@@ -58,6 +59,7 @@ void msp430_ucs_puc()
   MCUUCS.vlo_cycle_nanotime = NANO / MCUUCS.vlo_freq;
   MCUUCS.refo_cycle_nanotime = NANO / MCUUCS.refo_freq;
   MCUUCS.dcoclk_cycle_nanotime = NANO / MCUUCS.dcoclk_freq;
+  msp430_ucs_adjust_steps();
 
   msp430_ucs_printstate();
 }
@@ -116,54 +118,21 @@ void msp430_ucs_reset()
 
 int msp430_ucs_update(int clock_add)
 {
-  int nano_add = 0;
-
-  /********************************************/
-  /* Update nano time                         */
-  /********************************************/
-
-  /* switch on MCLK source, compute other clocks */
-  /* compute the nano equivalent time            */
-  switch (MCUUCS.ucsctl4.b.selm) {
-  case 0: /* XT1CLK */
-    nano_add = clock_add * MCUUCS.lfxt1_cycle_nanotime;
-    break;
-  case 1: /* VLOCLK */
-    nano_add = clock_add * MCUUCS.vlo_cycle_nanotime;
-    break;
-  case 2: /* REFOCLK*/
-    nano_add = clock_add * MCUUCS.refo_cycle_nanotime;
-    break;
-  case 3: /* DCOCLK */
-    nano_add = (clock_add << MCUUCS.ucsctl2.b.flld) * MCUUCS.dcoclk_cycle_nanotime;
-    break;
-  case 4: /* DCOCLKDIV */
-    nano_add = clock_add * MCUUCS.dcoclk_cycle_nanotime;
-    break;
-  case 5: /* XT2CLK */
-  case 6:
-  case 7:
-    nano_add = clock_add * MCUUCS.xt2_cycle_nanotime;
-    break;
-  }
+  /* MCLK source cycles, the per instruction path has no division, */
+  /* periods are folded in the fixed point steps                   */
+  uint32_t cycles = (MCUUCS.ucsctl4.b.selm == 3) ? (clock_add << MCUUCS.ucsctl2.b.flld) : clock_add;
+  int nano_add = msp430_clock_nanotime(MCUUCS.nano_step, cycles);
 
   /********************************************/
   /* Update internals clocks                  */
   /********************************************/
 
-#define CLOCK_DIVMOD_TEMP(inc,tmp,nanotime)   \
-  do {                                        \
-    tmp += nano_add;                          \
-    inc  = tmp / nanotime;                    \
-    tmp %= nanotime;                          \
-  } while (0)
-
   /*
    * The VLO is enabled when it is used to source ACLK, MCLK, or SMCLK (SELA = {1} or SELM = {1} or
    * SELS = {1}).
    */
   if (MCUUCS.ucsctl4.b.sela == 4 || MCUUCS.ucsctl4.b.selm == 1 || MCUUCS.ucsctl4.b.sels == 1) {
-    CLOCK_DIVMOD_TEMP(MCUUCS.vlo_increment, MCUUCS.vlo_temp, MCUUCS.vlo_cycle_nanotime);
+    MCUUCS.vlo_increment = msp430_clock_src_ticks(&MCUUCS.vlo_src, cycles);
     MCUUCS.vlo_counter += MCUUCS.vlo_increment;
   } else {
     HW_DMSG_CLOCK("msp430:ucs: vlo not updated\n");
@@ -189,7 +158,7 @@ int msp430_ucs_update(int clock_add)
     || (MCUUCS.ucsctl3.b.selref == 0 && (MCUUCS.ucsctl4.b.selm == 3 || MCUUCS.ucsctl4.b.selm == 4) && MCU_READ_CPUOFF)
     || (MCUUCS.ucsctl3.b.selref == 0 && (MCUUCS.ucsctl4.b.sels == 3 || MCUUCS.ucsctl4.b.sels == 4) && MCUUCS.ucsctl6.b.smclkoff == 0)
     ) {
-    CLOCK_DIVMOD_TEMP(MCUUCS.lfxt1_increment, MCUUCS.lfxt1_temp, MCUUCS.lfxt1_cycle_nanotime);
+    MCUUCS.lfxt1_increment = msp430_clock_src_ticks(&MCUUCS.lfxt1_src, cycles);
     MCUUCS.lfxt1_counter += MCUUCS.lfxt1_increment;
   } else {
     HW_DMSG_CLOCK("msp430:ucs: xt1 not updated\n");
@@ -214,18 +183,18 @@ int msp430_ucs_update(int clock_add)
     || (MCUUCS.ucsctl3.b.selref == 2 && (MCUUCS.ucsctl4.b.selm == 3 || MCUUCS.ucsctl4.b.selm == 4) && MCU_READ_CPUOFF)
     || (MCUUCS.ucsctl3.b.selref == 2 && (MCUUCS.ucsctl4.b.sels == 3 || MCUUCS.ucsctl4.b.sels == 4) && MCUUCS.ucsctl6.b.smclkoff == 0)
     ) {
-    CLOCK_DIVMOD_TEMP(MCUUCS.refo_increment, MCUUCS.refo_temp, MCUUCS.refo_cycle_nanotime);
+    MCUUCS.refo_increment = msp430_clock_src_ticks(&MCUUCS.refo_src, cycles);
     MCUUCS.refo_counter += MCUUCS.refo_increment;
   } else {
     HW_DMSG_CLOCK("msp430:ucs: refo not updated\n");
   }
 
   //XT2 TODO: update only if radio is running (on CC430) or on dependencies (in MSP430x5xx/x6xx)
-  CLOCK_DIVMOD_TEMP(MCUUCS.xt2_increment, MCUUCS.xt2_temp, MCUUCS.xt2_cycle_nanotime);
+  MCUUCS.xt2_increment = msp430_clock_src_ticks(&MCUUCS.xt2_src, cycles);
   MCUUCS.xt2_counter += MCUUCS.xt2_increment;
 
   //DCO TODO: find out, when DCO is not updated
-  CLOCK_DIVMOD_TEMP(MCUUCS.dcoclk_increment, MCUUCS.dcoclk_temp, MCUUCS.dcoclk_cycle_nanotime);
+  MCUUCS.dcoclk_increment = msp430_clock_src_ticks(&MCUUCS.dcoclk_src, cycles);
   MCUUCS.dcoclk_counter += MCUUCS.dcoclk_increment;
 
   /********************************************/
@@ -493,6 +462,48 @@ static void msp430_ucs_adjust_dcoclk_freq()
   }
   MCUUCS.dcoclk_freq = D * (MCUUCS.ucsctl2.b.flln + 1) * (fllref_freq / n);
   MCUUCS.dcoclk_cycle_nanotime = NANO / MCUUCS.dcoclk_freq;
+  msp430_ucs_adjust_steps();
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * fixed point steps of the oscillators and of the time, called when an
+ * oscillator period or the MCLK source is modified
+ **/
+static void msp430_ucs_adjust_steps()
+{
+  uint32_t mclk_period = 0;
+
+  switch (MCUUCS.ucsctl4.b.selm) {
+  case 0: /* XT1CLK */
+    mclk_period = MCUUCS.lfxt1_cycle_nanotime;
+    break;
+  case 1: /* VLOCLK */
+    mclk_period = MCUUCS.vlo_cycle_nanotime;
+    break;
+  case 2: /* REFOCLK*/
+    mclk_period = MCUUCS.refo_cycle_nanotime;
+    break;
+  case 3: /* DCOCLK, cycles are shifted by flld */
+  case 4: /* DCOCLKDIV */
+    mclk_period = MCUUCS.dcoclk_cycle_nanotime;
+    break;
+  case 5: /* XT2CLK */
+  case 6:
+  case 7:
+    mclk_period = MCUUCS.xt2_cycle_nanotime;
+    break;
+  }
+
+  MCUUCS.nano_step = (uint64_t) mclk_period << CLOCK_FX_SHIFT;
+  msp430_clock_src_set(&MCUUCS.lfxt1_src, MCUUCS.lfxt1_cycle_nanotime, mclk_period);
+  msp430_clock_src_set(&MCUUCS.xt2_src, MCUUCS.xt2_cycle_nanotime, mclk_period);
+  msp430_clock_src_set(&MCUUCS.vlo_src, MCUUCS.vlo_cycle_nanotime, mclk_period);
+  msp430_clock_src_set(&MCUUCS.refo_src, MCUUCS.refo_cycle_nanotime, mclk_period);
+  msp430_clock_src_set(&MCUUCS.dcoclk_src, MCUUCS.dcoclk_cycle_nanotime, mclk_period);
 }
 
 /* ************************************************** */
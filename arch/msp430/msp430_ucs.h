@@ -323,33 +323,34 @@ struct msp430_ucs_t {
   uint32_t lfxt1_freq;
   uint32_t lfxt1_cycle_nanotime;
   uint64_t lfxt1_counter;
-  int lfxt1_temp;
+  struct msp430_clock_src_t lfxt1_src;
   int lfxt1_increment;
 
   uint32_t xt2_freq;
   uint32_t xt2_cycle_nanotime;
   uint64_t xt2_counter;
-  int xt2_temp;
+  struct msp430_clock_src_t xt2_src;
   int xt2_increment;
 
   uint32_t vlo_freq;
   uint32_t vlo_cycle_nanotime;
   uint64_t vlo_counter;
-  int vlo_temp;
+  struct msp430_clock_src_t vlo_src;
   int vlo_increment;
 
   uint32_t refo_freq;
   uint32_t refo_cycle_nanotime;
   uint64_t refo_counter;
-  int refo_temp;
+  struct msp430_clock_src_t refo_src;
   int refo_increment;
 
   uint32_t dcoclk_freq;
   uint32_t dcoclk_cycle_nanotime;
   uint64_t dcoclk_counter;
-  int dcoclk_temp;
+  struct msp430_clock_src_t dcoclk_src;
   int dcoclk_increment;
 
+  uint64_t nano_step; /* MCLK source period, ns 32.32 */
 };
 
 /* ************************************************** */
@@ -368,6 +369,10 @@ void msp430_ucs_write(uint16_t addr, int16_t val);
 #define MCU_CLOCK_SYSTEM_UPDATE(n)       msp430_ucs_update(n)
 #define MCU_CLOCK_SYSTEM_UPDATE_DONE()   msp430_ucs_update_done()
 #define MCU_CLOCK_SYSTEM_SPEED_TRACER()  do { } while (0)
+/* no event horizon, LPM slices are never merged */
+#define MCU_CLOCK_HORIZON(clk,ticks)     0
+#define MCU_CLOCK_CYCLES_NANOTIME(n)     0
+#define MCU_CLOCK_SYSTEM_UPDATE_SLICES(n,s) msp430_ucs_update(n)
 
 /* ************************************************** */
 /* ************************************************** */
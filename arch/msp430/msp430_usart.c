@@ -897,6 +897,21 @@ do {                                                                          \
 /* ************************************************** */
 /* ************************************************** */
 
+/* an idle usart does not change state until a device writes to it */
+#define USART_HORIZON(USART)                                                  \
+  if ((MCU.USART.uxtxbuf_full     == 0) &&                                    \
+      (MCU.USART.uxtx_shift_empty == 1) &&                                    \
+      (MCU.USART.uxrx_shift_empty == 1) &&                                    \
+      (MCU.USART.uxrx_shift_ready == 0))                                      \
+    {                                                                         \
+      return WSIM_HORIZON_INF;                                                \
+    }                                                                         \
+  return 0;
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 #if defined(__msp430_have_usart0)
 
 void msp430_usart0_create()
@@ -926,6 +941,12 @@ void msp430_usart0_update()
   USART_UPDATE(usart0,0,me1,ie1,ifg1)
 }
 
+/* time before the usart can change state */
+wsimtime_t msp430_usart0_horizon()
+{
+  USART_HORIZON(usart0)
+}
+
 void msp430_usart0_update_done()
 {
   if (MCU.usart0.uxrx_shift_ready == 1)
@@ -1024,6 +1045,12 @@ void msp430_usart1_update()
   USART_UPDATE(usart1,1,me2,ie2,ifg2)
 }
 
+/* time before the usart can change state */
+wsimtime_t msp430_usart1_horizon()
+{
+  USART_HORIZON(usart1)
+}
+
 void msp430_usart1_update_done()
 {
   if (MCU.usart1.uxrx_shift_ready == 1)
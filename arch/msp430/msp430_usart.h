@@ -257,6 +257,7 @@ void   msp430_usart0_create();
 void   msp430_usart0_reset();
 void   msp430_usart0_update();
 void   msp430_usart0_update_done();
+wsimtime_t msp430_usart0_horizon();
 int8_t msp430_usart0_read (uint16_t addr);
 void   msp430_usart0_write(uint16_t addr, int8_t val);
 int    msp430_usart0_chkifg();
@@ -273,6 +274,7 @@ int    msp430_usart0_dev_write_uart_ok ();
 #define msp430_usart0_reset()       do { } while (0)
 #define msp430_usart0_update()      do { } while (0)
 #define msp430_usart0_update_done() do { } while (0)
+#define msp430_usart0_horizon()     WSIM_HORIZON_INF
 #endif
 
 /* ************************************************** */
@@ -296,6 +298,7 @@ void   msp430_usart1_create();
 void   msp430_usart1_reset();
 void   msp430_usart1_update();
 void   msp430_usart1_update_done();
+wsimtime_t msp430_usart1_horizon();
 int8_t msp430_usart1_read (uint16_t addr);
 void   msp430_usart1_write(uint16_t addr, int8_t val);
 int    msp430_usart1_chkifg();
@@ -313,6 +316,7 @@ int    msp430_usart1_dev_write_uart_ok ();
 #define msp430_usart1_reset()       do { } while (0)
 #define msp430_usart1_update()      do { } while (0)
 #define msp430_usart1_update_done() do { } while (0)
+#define msp430_usart1_horizon()     WSIM_HORIZON_INF
 #endif
 
 /* ************************************************** */
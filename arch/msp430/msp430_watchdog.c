@@ -106,6 +106,33 @@ msp430_watchdog_update(void)
 /* ************************************************** */
 /* ************************************************** */
 
+wsimtime_t
+msp430_watchdog_horizon(void)
+{
+  int ticks;
+
+  if (MCU.watchdog.wdtctl.b.wdthold)
+    return WSIM_HORIZON_INF;
+
+  /* interval wraps when wdtcnt > wdtinterval */
+  ticks = MCU.watchdog.wdtinterval - MCU.watchdog.wdtcnt + 1;
+  if (ticks <= 0)
+    return 0;
+
+  switch (MCU.watchdog.wdtctl.b.wdtssel)
+    {
+    case WDT_SSEL_SMCLK:
+      return MCU_CLOCK_HORIZON(HORIZON_SMCLK, ticks);
+    case WDT_SSEL_ACLK:
+      return MCU_CLOCK_HORIZON(HORIZON_ACLK, ticks);
+    }
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 int16_t 
 msp430_watchdog_read (uint16_t addr)
 {
@@ -74,9 +74,11 @@ void    msp430_watchdog_write  (uint16_t addr, int16_t val);
 
 enum watchdog_mode_t msp430_watchdog_getmode(void);
 int     msp430_watchdog_chkifg ();
+wsimtime_t msp430_watchdog_horizon(void);
 
 #else
 #define msp430_watchdog_create() do { } while (0)
 #define msp430_watchdog_reset()  do { } while (0)
+#define msp430_watchdog_horizon() WSIM_HORIZON_INF
 #endif /* defined */
 #endif /* header */
@@ -11,6 +11,7 @@
 #include <string.h>
 
 #include "arch/common/hardware.h"
+#include "devices/devices.h"
 #include "devices/at45db/at45db_dev.h"
 #include "src/options.h"
 
@@ -354,10 +355,9 @@ struct at45db_t
   uint8_t buffer1[AT45_PAGE_SIZE];
   uint8_t buffer2[AT45_PAGE_SIZE];
 
-  union {
-    uint8_t raw   [AT45_FLASH_SIZE];
-    uint8_t page  [AT45_PAGE_MAX][AT45_PAGE_SIZE];
-  } mem;
+  /* flash array, mapped outside of the machine state */
+  int      image;
+  uint8_t *mem;
 
   enum at45_opcode_t   command;  /* current command */
   int                  command_next;
@@ -392,9 +392,9 @@ struct at45db_t
 
 #define AT45_DATA        ((struct at45db_t*)(machine.device[dev].data))
 #define AT45_SR          (AT45_DATA->status_register)
-#define AT45_MEMRAW      (AT45_DATA->mem.raw   )
-#define AT45_MEMSECTOR   (AT45_DATA->mem.sector)
-#define AT45_MEMPAGE     (AT45_DATA->mem.page  )
+#define AT45_IMAGE       (AT45_DATA->image     )
+#define AT45_MEMRAW      (AT45_DATA->mem       )
+#define AT45_MEMPAGE(p)  (AT45_DATA->mem + (p) * AT45_PAGE_SIZE)
 #define AT45_INIT        (AT45_DATA->file_init )
 #define AT45_DUMP        (AT45_DATA->file_dump )
 
@@ -440,7 +440,14 @@ static struct moption_t flash_dump_opt = {
   .value       = NULL
 };
 
-tracer_id_t TRACER_AT45DB_STATE;
+static struct moption_t flash_image_opt = {
+  .longname    = "flash_image",
+  .type        = required_argument,
+  .helpstring  = "Flash image, written in place",
+  .value       = NULL
+};
+
+WSIM_TLS tracer_id_t TRACER_AT45DB_STATE;
 
 int at45db_add_options(int UNUSED dev_num, int dev_id, const char UNUSED *dev_name)
 {
@@ -452,6 +459,7 @@ int at45db_add_options(int UNUSED dev_num, int dev_id, const char UNUSED *dev_na
 
   options_add( &flash_init_opt  );
   options_add( &flash_dump_opt  );
+  options_add( &flash_image_opt );
   return 0;
 }
 
@@ -468,34 +476,6 @@ int at45db_device_size()
 /***************************************************/
 /***************************************************/
 
-int at45db_flash_load(int dev, const char *name)
-{
-  FILE *f;
-
-  if ((f = fopen(name, "rb")) == NULL)
-    {
-      return 1;
-    }
-  
-  HW_DMSG_AT45("at45db: loading file %s into flash\n",name);
-
-  if (fread(AT45_MEMRAW,1,AT45_FLASH_SIZE,f) != AT45_FLASH_SIZE)
-    {
-      HW_DMSG_AT45("at45db: error while loading file %s to flash\n",name);
-      ERROR      ("at45db: error while loading file %s to flash\n",name);
-      return 2;
-    }
-
-  HW_DMSG_AT45("at45db: loading file %s into flash -- ok\n",name);
-
-  fclose(f);
-  return 0;
-}
-
-/***************************************************/
-/***************************************************/
-/***************************************************/
-
 int at45db_flash_dump(int dev, const char *name)
 {
   FILE *f;
@@ -544,12 +524,27 @@ int at45db_device_create(int dev, int UNUSED id)
 
   AT45_INIT = flash_init_opt.value;
   AT45_DUMP = flash_dump_opt.value;
-  
-  if (AT45_INIT == NULL || at45db_flash_load(dev, AT45_INIT))
+
+  /* unknown or short init files give a flash filled with 0xff */
+  if (flash_image_opt.value)
     {
-      HW_DMSG_AT45("at45db: flash memory init to 0xff\n");
-      memset(AT45_MEMRAW,0xff,AT45_FLASH_SIZE);
+      if (AT45_INIT != NULL)
+	{
+	  ERROR("at45db: flash_init and flash_image cannot be used together\n");
+	  return 1;
+	}
+      OUTPUT("at45db: flash image %s is written in place\n",flash_image_opt.value);
+      AT45_IMAGE = devimg_open("at45db", flash_image_opt.value, AT45_FLASH_SIZE, DEVIMG_SHARED, 0xff);
+    }
+  else
+    {
+      AT45_IMAGE = devimg_open("at45db", AT45_INIT, AT45_FLASH_SIZE, DEVIMG_PRIVATE, 0xff);
+    }
+  if (AT45_IMAGE == -1)
+    {
+      return 1;
     }
+  AT45_MEMRAW = devimg_mem(AT45_IMAGE);
 
   //  TRACER_AT45DB_STATE = tracer_event_add_id(8, "state" , "at45db");
 
@@ -595,6 +590,7 @@ int at45db_delete(int dev)
     {
       at45db_flash_dump(dev,AT45_DUMP);
     }
+  devimg_close(AT45_IMAGE);
 
   return 0;
 }
@@ -854,9 +850,10 @@ void at45db_write_buffer_without_erase(int dev, uint8_t *buffer)
       AT45_DATA->command_start = 0;
     }
   HW_DMSG_AT45("at45db: %s at page 0x%04x\n", str_cmd(AT45_DATA->command), AT45_DATA->command_page_addr);
+  devimg_write(AT45_IMAGE, AT45_DATA->command_page_addr * AT45_PAGE_SIZE, AT45_PAGE_SIZE);
   for(AT45_DATA->command_addr=0; AT45_DATA->command_addr < AT45_PAGE_SIZE; AT45_DATA->command_addr++)
     { /* we write 0 */
-      AT45_DATA->mem.page[AT45_DATA->command_page_addr][AT45_DATA->command_addr] &= 
+      AT45_MEMPAGE(AT45_DATA->command_page_addr)[AT45_DATA->command_addr] &= 
 	buffer[AT45_DATA->command_addr];
     }
   at45db_set_busy_time(dev,at45db_busy_time(AT45_DATA->command));
@@ -877,7 +874,8 @@ void at45db_write_buffer_with_erase(int dev, uint8_t *buffer)
       AT45_DATA->command_start = 0;
     }
   HW_DMSG_AT45("at45db: %s at page 0x%04x\n", str_cmd(AT45_DATA->command), AT45_DATA->command_page_addr);
-  memcpy(AT45_DATA->mem.page[AT45_DATA->command_page_addr], buffer ,AT45_PAGE_SIZE);
+  devimg_write(AT45_IMAGE, AT45_DATA->command_page_addr * AT45_PAGE_SIZE, AT45_PAGE_SIZE);
+  memcpy(AT45_MEMPAGE(AT45_DATA->command_page_addr), buffer ,AT45_PAGE_SIZE);
   at45db_set_busy_time(dev,at45db_busy_time(AT45_DATA->command));
   AT45_DATA->command_need_to_complete = 1;
   AT45_READ_MASK = AT45DB_D;
@@ -916,9 +914,12 @@ void at45db_block_erase(int dev)
       AT45_DATA->command_start = 0;
     }
 
+  /* command_page_addr is a block number */
+  devimg_write(AT45_IMAGE, AT45_DATA->command_page_addr * AT45_PAGE_PER_BLOCK * AT45_PAGE_SIZE,
+	       AT45_PAGE_PER_BLOCK * AT45_PAGE_SIZE);
   for(i=0; i < AT45_PAGE_PER_BLOCK; i++)
     {
-      memset(AT45_DATA->mem.page[AT45_DATA->command_page_addr + i], 1, AT45_FLASH_SIZE);
+      memset(AT45_MEMPAGE(AT45_DATA->command_page_addr * AT45_PAGE_PER_BLOCK + i), 0xff, AT45_PAGE_SIZE);
     }
 
   at45db_set_busy_time(dev,at45db_busy_time(AT45_DATA->command));
@@ -939,7 +940,7 @@ void at45db_copy_page_to_buffer(int dev, uint8_t *buffer)
       AT45_DATA->command_start = 0;
     }
   HW_DMSG_AT45("at45db: %s for page 0x%04x\n", str_cmd(AT45_DATA->command), AT45_DATA->command_page_addr);
-  memcpy(buffer, AT45_DATA->mem.page[AT45_DATA->command_page_addr], AT45_PAGE_SIZE);
+  memcpy(buffer, AT45_MEMPAGE(AT45_DATA->command_page_addr), AT45_PAGE_SIZE);
   at45db_set_busy_time(dev,at45db_busy_time(AT45_DATA->command));
   AT45_DATA->command_need_to_complete = 1;
   AT45_READ_MASK = AT45DB_D;
@@ -958,7 +959,7 @@ void at45db_copy_page_to_buffer_and_back(int dev, uint8_t *buffer)
       AT45_DATA->command_start = 0;
     }
   HW_DMSG_AT45("at45db: %s for page 0x%04x\n", str_cmd(AT45_DATA->command), AT45_DATA->command_page_addr);
-  memcpy(buffer, AT45_DATA->mem.page[AT45_DATA->command_page_addr], AT45_PAGE_SIZE);
+  memcpy(buffer, AT45_MEMPAGE(AT45_DATA->command_page_addr), AT45_PAGE_SIZE);
   at45db_set_busy_time(dev,at45db_busy_time(AT45_DATA->command));
   /* back is a null operation here */
   AT45_DATA->command_need_to_complete = 1;
@@ -983,7 +984,7 @@ void at45db_compare_page_to_buffer(int dev, uint8_t *buffer)
 
   for(AT45_DATA->command_addr=0; AT45_DATA->command_addr < AT45_PAGE_SIZE; AT45_DATA->command_addr++)
     { /* we write 0 */
-      if (AT45_DATA->mem.page[AT45_DATA->command_page_addr][AT45_DATA->command_addr] !=
+      if (AT45_MEMPAGE(AT45_DATA->command_page_addr)[AT45_DATA->command_addr] !=
 	  buffer[AT45_DATA->command_addr])
 	cmp ++;
     }
@@ -1056,7 +1057,7 @@ int at45db_update(int dev)
 	}
       HW_DMSG_AT45("at45db: %s at address 0x%04x\n",str_cmd(AT45_DATA->command),AT45_DATA->command_addr);
       AT45_READ_MASK = AT45DB_D; 
-      AT45_READ_DATA = AT45_DATA->mem.raw[AT45_DATA->command_addr];
+      AT45_READ_DATA = AT45_MEMRAW[AT45_DATA->command_addr];
       AT45_DATA->command_addr = (AT45_DATA->command_addr + 1) % AT45_FLASH_SIZE; 
       break;
 
@@ -1069,10 +1070,10 @@ int at45db_update(int dev)
 	  AT45_DATA->command_start = 0;
 	}
       AT45_READ_MASK = AT45DB_D; 
-      AT45_READ_DATA = AT45_DATA->mem.page[AT45_DATA->command_page_addr][AT45_DATA->command_addr];
+      AT45_READ_DATA = AT45_MEMPAGE(AT45_DATA->command_page_addr)[AT45_DATA->command_addr];
       HW_DMSG_AT45("at45db: %s at page 0x%04x addr 0x%04x = 0x%02x\n",str_cmd(AT45_DATA->command),
 		   AT45_DATA->command_page_addr,AT45_DATA->command_addr,
-		   AT45_DATA->mem.page[AT45_DATA->command_page_addr][AT45_DATA->command_addr]);
+		   AT45_MEMPAGE(AT45_DATA->command_page_addr)[AT45_DATA->command_addr]);
       AT45_DATA->command_addr = (AT45_DATA->command_addr + 1) % AT45_PAGE_SIZE; 
       break;
 
@@ -1126,7 +1127,7 @@ int at45db_update(int dev)
 	  READ_PAGE_ADDRESS(dev);
 	  AT45_DATA->command_start = 0;
 	}
-      memset(AT45_DATA->mem.page[AT45_DATA->command_page_addr], 0, AT45_PAGE_SIZE);
+      memset(AT45_MEMPAGE(AT45_DATA->command_page_addr), 0, AT45_PAGE_SIZE);
       at45db_set_busy_time(dev,at45db_busy_time(AT45_DATA->command));
       AT45_DATA->command_need_to_complete = 1;
       break;
@@ -28,17 +28,17 @@
 /***************************************************/
 
 /* Global Variables (not backtracked) */
-int  CC1100_XOSC_FREQ_MHz;
-int  CC1100_XOSC_PERIOD_NS;
-int  CC1100_RCOSC_FREQ_KHz;
-int  CC1100_RCOSC_PERIOD_NS;
+WSIM_TLS int  CC1100_XOSC_FREQ_MHz;
+WSIM_TLS int  CC1100_XOSC_PERIOD_NS;
+WSIM_TLS int  CC1100_RCOSC_FREQ_KHz;
+WSIM_TLS int  CC1100_RCOSC_PERIOD_NS;
 
-tracer_id_t TRACER_CC1100_STATE;
-tracer_id_t TRACER_CC1100_STROBE;
-tracer_id_t TRACER_CC1100_CS;
-tracer_id_t TRACER_CC1100_SO;
-tracer_id_t TRACER_CC1100_GDO0;
-tracer_id_t TRACER_CC1100_GDO2;
+WSIM_TLS tracer_id_t TRACER_CC1100_STATE;
+WSIM_TLS tracer_id_t TRACER_CC1100_STROBE;
+WSIM_TLS tracer_id_t TRACER_CC1100_CS;
+WSIM_TLS tracer_id_t TRACER_CC1100_SO;
+WSIM_TLS tracer_id_t TRACER_CC1100_GDO0;
+WSIM_TLS tracer_id_t TRACER_CC1100_GDO2;
 
 /***************************************************/
 /***************************************************/
@@ -228,6 +228,17 @@ void cc1100_read(int dev_num, uint32_t  *mask, uint32_t  *value)
 
 #if defined(CC1100)
 
+/* energy accounting, typical currents at 3V indexed by ETRACER_CC1100_* */
+static const uint32_t cc1100_energy_nA[ENERGY_MAX_STATES] = {
+  0,
+  1700000,  /* IDLE    */
+  400,      /* SLEEP   */
+  160000,   /* XOFF    */
+  8400000,  /* STARTUP */
+  15600000, /* RX      */
+  16900000  /* TX 0dBm */
+};
+
 int cc1100_device_create (int dev_num, int fxosc_mhz, char *antenna)
 {	
   struct _cc1100_t *cc1100 = (struct _cc1100_t *) machine.device[dev_num].data;
@@ -239,6 +250,8 @@ int cc1100_device_create (int dev_num, int fxosc_mhz, char *antenna)
   machine.device[dev_num].power_down    = cc1100_power_down;
   
   machine.device[dev_num].update        = cc1100_update;
+  machine.device[dev_num].horizon       = cc1100_horizon;
+  machine.device[dev_num].tx_lookahead  = cc1100_tx_lookahead;
   
   machine.device[dev_num].read          = cc1100_read;
   machine.device[dev_num].write         = cc1100_write;
@@ -264,12 +277,24 @@ int cc1100_device_create (int dev_num, int fxosc_mhz, char *antenna)
  
   /* init packets log */
   logpkt_init_interface(cc1100->worldsens_radio_id, "cc1100", PCAP_DLT_USER0);
+  energy_register(ETRACER_PER_ID_CC1100, "cc1100", cc1100_energy_nA);
 
   return 0;
 }
 
 #elif defined(CC2500)
 
+/* energy accounting, typical currents at 3V indexed by ETRACER_CC1100_* */
+static const uint32_t cc2500_energy_nA[ENERGY_MAX_STATES] = {
+  0,
+  1500000,  /* IDLE    */
+  400,      /* SLEEP   */
+  160000,   /* XOFF    */
+  7400000,  /* STARTUP */
+  13300000, /* RX      */
+  21200000  /* TX 0dBm */
+};
+
 int cc2500_device_create (int dev_num, int fxosc_mhz, char *antenna)
 {	
   struct _cc1100_t *cc1100 = (struct _cc1100_t *) machine.device[dev_num].data;
@@ -281,6 +306,8 @@ int cc2500_device_create (int dev_num, int fxosc_mhz, char *antenna)
   machine.device[dev_num].power_down    = cc1100_power_down;
   
   machine.device[dev_num].update        = cc1100_update;
+  machine.device[dev_num].horizon       = cc1100_horizon;
+  machine.device[dev_num].tx_lookahead  = cc1100_tx_lookahead;
   
   machine.device[dev_num].read          = cc1100_read;
   machine.device[dev_num].write         = cc1100_write;
@@ -306,6 +333,7 @@ int cc2500_device_create (int dev_num, int fxosc_mhz, char *antenna)
 
   /* init packets log */
   logpkt_init_interface(cc1100->worldsens_radio_id, "cc2500", PCAP_DLT_USER0);
+  energy_register(ETRACER_PER_ID_CC1100, "cc2500", cc2500_energy_nA);
 
   return 0;
 }
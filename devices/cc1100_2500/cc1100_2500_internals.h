@@ -35,14 +35,14 @@
 // #define CC1100_INTERNAL_XOSC_FREQ         26 /* MHz      */
 // #define CC1100_INTERNAL_XOSC_PERIOD       38 /* 1/26 MHz */
 
-extern int CC1100_XOSC_FREQ_MHz;
-extern int CC1100_XOSC_PERIOD_NS;
-extern tracer_id_t TRACER_CC1100_STATE;
-extern tracer_id_t TRACER_CC1100_STROBE;
-extern tracer_id_t TRACER_CC1100_CS;
-extern tracer_id_t TRACER_CC1100_SO;
-extern tracer_id_t TRACER_CC1100_GDO0;
-extern tracer_id_t TRACER_CC1100_GDO2;
+extern WSIM_TLS int CC1100_XOSC_FREQ_MHz;
+extern WSIM_TLS int CC1100_XOSC_PERIOD_NS;
+extern WSIM_TLS tracer_id_t TRACER_CC1100_STATE;
+extern WSIM_TLS tracer_id_t TRACER_CC1100_STROBE;
+extern WSIM_TLS tracer_id_t TRACER_CC1100_CS;
+extern WSIM_TLS tracer_id_t TRACER_CC1100_SO;
+extern WSIM_TLS tracer_id_t TRACER_CC1100_GDO0;
+extern WSIM_TLS tracer_id_t TRACER_CC1100_GDO2;
 
 /***************************************************/
 /***************************************************/
@@ -181,6 +181,8 @@ int	 cc1100_power_up                (int dev_num);
 int	 cc1100_power_down		(int dev_num);
 int	 cc1100_delete		        (int dev_num);
 int	 cc1100_update			(int dev_num);
+wsimtime_t cc1100_horizon		(int dev_num);
+wsimtime_t cc1100_tx_lookahead	(int dev_num);
 int	 cc1100_reset                   (int dev_num);
 void	 cc1100_reset_internal          (struct _cc1100_t *cc1100);
 int	 cc1100_io_pins	                (struct _cc1100_t *cc1100);
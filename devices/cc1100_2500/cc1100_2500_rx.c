@@ -146,7 +146,7 @@ int cc1100_rx_filter(struct _cc1100_t *cc1100, double frequency, int modulation,
 
 void cc1100_rx_sfd(struct _cc1100_t *cc1100, uint8_t rx) {
 	uint8_t sfd;
-	static int quality = 0;
+	static WSIM_TLS int quality = 0;
 	
 	if (cc1100->ioOffset == 0) {
 		quality = 0;
@@ -455,7 +455,7 @@ void cc1100_rx_data(struct _cc1100_t *cc1100, uint8_t rx,  double snr) {
 /***************************************************/
 
 void cc1100_rx_crc(struct _cc1100_t *cc1100, uint8_t rx) {
-	static uint16_t crc = 0;
+	static WSIM_TLS uint16_t crc = 0;
 	
 	if (cc1100->ioOffset == 0) {
 		crc = rx;
@@ -453,3 +453,90 @@ int cc1100_update (int dev_num)
 /***************************************************/
 /***************************************************/
 /***************************************************/
+
+#define CC1100_DELAY_TO(t) (((t) > MACHINE_TIME_GET_NANO()) ? ((t) - MACHINE_TIME_GET_NANO()) : 0)
+
+wsimtime_t cc1100_horizon (int dev_num)
+{
+  struct _cc1100_t *cc1100 = (struct _cc1100_t *) machine.device[dev_num].data;
+
+  /* CLK_XOSC/192 on a gdo pin, cc1100_update_xosc() must run at each step */
+  if (((cc1100->registers[CC1100_REG_IOCFG0] & 0x3F) == 0x3F) ||
+      ((cc1100->registers[CC1100_REG_IOCFG1] & 0x3F) == 0x3F) ||
+      ((cc1100->registers[CC1100_REG_IOCFG2] & 0x3F) == 0x3F))
+    {
+      return 0;
+    }
+
+  switch (cc1100->fsm_state) 
+    {
+    case CC1100_STATE_IDLE:
+      return (cc1100->wor) ? 0 : WSIM_HORIZON_INF;
+    case CC1100_STATE_SLEEP:
+      return (cc1100->wor) ? CC1100_DELAY_TO(cc1100->wor_timer_event0) : WSIM_HORIZON_INF;
+    case CC1100_STATE_XOFF:
+      return WSIM_HORIZON_INF;
+    case CC1100_STATE_MANCAL:
+    case CC1100_STATE_CALIBRATE:
+      return CC1100_DELAY_TO(cc1100->fsm_timer);
+    default:
+      break;
+    }
+
+  /* rx/tx and transitions are run step by step */
+  return 0;
+}
+
+/***************************************************/
+/***************************************************/
+/***************************************************/
+
+wsimtime_t cc1100_tx_lookahead (int dev_num)
+{
+  struct _cc1100_t *cc1100 = (struct _cc1100_t *) machine.device[dev_num].data;
+  wsimtime_t idle_bound;
+  wsimtime_t bound;
+
+  /* STX strobe in IDLE: FS_WAKEUP [-> FS_CALIBRATE] -> SETTLING -> TX */
+  idle_bound = CC1100_FS_WAKEUP_DELAY_NS + CC1100_SETTLING_DELAY_NS;
+  if (((cc1100->registers[CC1100_REG_MCSM0] >> 4) & 0x03) == 0x01)
+    {
+      idle_bound += CC1100_CALIBRATE_DELAY_NS;
+    }
+
+  switch (cc1100->fsm_state) 
+    {
+    case CC1100_STATE_RX:
+    case CC1100_STATE_RXTX_SETTLING:
+      return CC1100_RX_TX_DELAY_NS;
+    case CC1100_STATE_IDLE:
+    case CC1100_STATE_TX_UNDERFLOW:
+    case CC1100_STATE_RX_OVERFLOW:
+      return idle_bound;
+    case CC1100_STATE_SLEEP:
+    case CC1100_STATE_XOFF:
+      if (cc1100->wor)
+	{
+	  bound = CC1100_DELAY_TO(cc1100->wor_timer_event0) + CC1100_RX_TX_DELAY_NS;
+	  return (bound < idle_bound) ? bound : idle_bound;
+	}
+      return idle_bound;
+    case CC1100_STATE_MANCAL:
+    case CC1100_STATE_CALIBRATE:
+    case CC1100_STATE_FS_WAKEUP:
+    case CC1100_STATE_FS_CALIBRATE:
+    case CC1100_STATE_SETTLING:
+    case CC1100_STATE_TXRX_SETTLING:
+      bound = CC1100_DELAY_TO(cc1100->fsm_timer);
+      return (bound < idle_bound) ? bound : idle_bound;
+    default:
+      break;
+    }
+
+  /* FSTXON, TX */
+  return 0;
+}
+
+/***************************************************/
+/***************************************************/
+/***************************************************/
@@ -519,6 +519,85 @@ uint8_t cc1100_tx_crc (struct _cc1100_t *cc1100)
 /***************************************************/
 /***************************************************/
 
+/*
+ * Announce the whole frame to libwsnet when it is complete in the TX
+ * FIFO, called before the first preamble byte. The bytes are the ones
+ * sent by the preamble, sfd, data and crc micro states.
+ */
+static void cc1100_tx_frame (struct _cc1100_t *cc1100, uint64_t duration) 
+{
+  uint8_t  data[256];
+  uint16_t crc = 0;
+  int      sync = (cc1100->registers[CC1100_REG_MDMCFG2]) & 0x07;
+  int      length;
+  int      len = 0;
+  int      i;
+  struct wsnet_tx_info tx;
+
+  if (worldsens_c_tx_frame == NULL)
+    {
+      return;
+    }
+
+  if (CC1100_FIXED_PKTLENGTH(cc1100))
+    {
+      length = CC1100_PKTLENGTH(cc1100);
+    }
+  else if (CC1100_VAR_PKTLENGTH(cc1100))
+    {
+      length = cc1100->txfifo[cc1100->txOffset] + 1;
+    }
+  else
+    {
+      return;
+    }
+  if ((length < 1) || (length > cc1100->txBytes))
+    {
+      return;
+    }
+
+  for (i = 0; i < cc1100_get_preamble_length(cc1100); i++)
+    {
+      data[len++] = CC1100_PREAMBLE_PATTERN;
+    }
+  if ((sync != 0) && (sync != 4))
+    {
+      data[len++] = cc1100->registers[CC1100_REG_SYNC1];
+      data[len++] = cc1100->registers[CC1100_REG_SYNC0];
+      if ((sync == 3) || (sync == 7))
+	{
+	  data[len++] = cc1100->registers[CC1100_REG_SYNC1];
+	  data[len++] = cc1100->registers[CC1100_REG_SYNC0];
+	}
+    }
+  for (i = 0; i < length; i++)
+    {
+      data[len] = cc1100->txfifo[(cc1100->txOffset + i) % CC1100_TXFIFO_LENGTH];
+      crc += data[len++];
+    }
+  if (CC1100_COMPUTE_CRC(cc1100))
+    {
+      data[len++] = (uint8_t) ((crc >> 8) & 0x00FF);
+      data[len++] = (uint8_t) (crc & 0x00FF);
+    }
+
+  tx.data       = 0;
+  tx.freq_mhz   = cc1100_get_frequency_mhz(cc1100);
+  tx.modulation = cc1100_get_modulation(cc1100);
+  tx.power_dbm  = cc1100_get_power_dbm(cc1100, tx.freq_mhz);
+  tx.duration   = duration;
+  tx.radio_id   = cc1100->worldsens_radio_id;
+
+  if (worldsens_c_tx_frame(&tx, data, len) == 0)
+    {
+      CC1100_DBG_TX("cc1100:tx: frame of %d bytes announced\n", len);
+    }
+}
+
+/***************************************************/
+/***************************************************/
+/***************************************************/
+
 void cc1100_tx (struct _cc1100_t *cc1100) 
 {
   char     data;
@@ -544,6 +623,10 @@ void cc1100_tx (struct _cc1100_t *cc1100)
 	  /* TX fifo empty, do nothing */
 	  return;
 	}
+      if (cc1100->ioOffset == 0)
+	{
+	  cc1100_tx_frame(cc1100, cc1100_get_tx_byte_duration(cc1100));
+	}
       data = cc1100_tx_preamble(cc1100);
       break;
     case 2:
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "arch/common/hardware.h"
 #include "cc2420_macros.h"
 #include "cc2420_crc_ccitt.h"
 
@@ -65,8 +66,8 @@ unsigned short cc2420_icrc1(unsigned short crc, unsigned char onech) {
 
 unsigned short cc2420_icrc(unsigned char *bufptr, unsigned long len) {
 
-    static unsigned short icrctb[256],init=0;
-    static unsigned char rchr[256];
+    static WSIM_TLS unsigned short icrctb[256],init=0;
+    static WSIM_TLS unsigned char rchr[256];
     unsigned short j,cword=0;
     static unsigned char it[16]={0,8,4,12,2,10,6,14,1,9,5,13,3,11,7,15};
     
@@ -40,18 +40,18 @@
 /***************************************************/
 
 /* Global Variables (not backtracked) */
-int  CC2420_XOSC_FREQ_MHz;
-int  CC2420_XOSC_PERIOD_NS;
+WSIM_TLS int  CC2420_XOSC_FREQ_MHz;
+WSIM_TLS int  CC2420_XOSC_PERIOD_NS;
 
-tracer_id_t TRACER_CC2420_STATE;
-tracer_id_t TRACER_CC2420_STROBE;
-tracer_id_t TRACER_CC2420_CS;
-tracer_id_t TRACER_CC2420_FIFOP;
-tracer_id_t TRACER_CC2420_FIFO;
-tracer_id_t TRACER_CC2420_CCA;
-tracer_id_t TRACER_CC2420_SFD;
-tracer_id_t TRACER_CC2420_VREG_EN;
-tracer_id_t TRACER_CC2420_RESET;
+WSIM_TLS tracer_id_t TRACER_CC2420_STATE;
+WSIM_TLS tracer_id_t TRACER_CC2420_STROBE;
+WSIM_TLS tracer_id_t TRACER_CC2420_CS;
+WSIM_TLS tracer_id_t TRACER_CC2420_FIFOP;
+WSIM_TLS tracer_id_t TRACER_CC2420_FIFO;
+WSIM_TLS tracer_id_t TRACER_CC2420_CCA;
+WSIM_TLS tracer_id_t TRACER_CC2420_SFD;
+WSIM_TLS tracer_id_t TRACER_CC2420_VREG_EN;
+WSIM_TLS tracer_id_t TRACER_CC2420_RESET;
 
 /***************************************************/
 /***************************************************/
@@ -88,6 +88,17 @@ uint8_t cc2420_read_pin(struct _cc2420_t * cc2420, uint8_t pin)
 /***************************************************/
 /***************************************************/
 
+/* energy accounting, typical currents at 3V indexed by ETRACER_CC2420_* */
+static const uint32_t cc2420_energy_nA[ENERGY_MAX_STATES] = {
+  0,
+  426000,   /* IDLE     */
+  20000,    /* SLEEP    */
+  20,       /* VREG_OFF */
+  426000,   /* STARTUP  */
+  18800000, /* RX       */
+  17400000  /* TX 0dBm  */
+};
+
 int cc2420_device_create (int dev_num, int fxosc_mhz, char *antenna)
 {
   struct _cc2420_t *cc2420 = (struct _cc2420_t *) machine.device[dev_num].data;
@@ -99,6 +110,7 @@ int cc2420_device_create (int dev_num, int fxosc_mhz, char *antenna)
   machine.device[dev_num].power_down    = cc2420_power_down;
 
   machine.device[dev_num].update        = cc2420_update;
+  machine.device[dev_num].tx_lookahead  = cc2420_tx_lookahead;
   
   machine.device[dev_num].read          = cc2420_read;
   machine.device[dev_num].write         = cc2420_write; 
@@ -125,6 +137,7 @@ int cc2420_device_create (int dev_num, int fxosc_mhz, char *antenna)
 
   /* init packets log */
   logpkt_init_interface(cc2420->worldsens_radio_id, "cc2420", PCAP_DLT_802154);
+  energy_register(ETRACER_PER_ID_CC2420, "cc2420", cc2420_energy_nA);
 
   return 0;
 }
@@ -34,15 +34,15 @@
 #define CC2420_REG_SIZE   0x40   /* last register is 0x3F */
 #define CC2420_RAM_SIZE   0x16F
 
-extern tracer_id_t TRACER_CC2420_STATE;
-extern tracer_id_t TRACER_CC2420_STROBE;
-extern tracer_id_t TRACER_CC2420_CS;
-extern tracer_id_t TRACER_CC2420_FIFOP;
-extern tracer_id_t TRACER_CC2420_FIFO;
-extern tracer_id_t TRACER_CC2420_CCA;
-extern tracer_id_t TRACER_CC2420_SFD;
-extern tracer_id_t TRACER_CC2420_VREG_EN;
-extern tracer_id_t TRACER_CC2420_RESET;
+extern WSIM_TLS tracer_id_t TRACER_CC2420_STATE;
+extern WSIM_TLS tracer_id_t TRACER_CC2420_STROBE;
+extern WSIM_TLS tracer_id_t TRACER_CC2420_CS;
+extern WSIM_TLS tracer_id_t TRACER_CC2420_FIFOP;
+extern WSIM_TLS tracer_id_t TRACER_CC2420_FIFO;
+extern WSIM_TLS tracer_id_t TRACER_CC2420_CCA;
+extern WSIM_TLS tracer_id_t TRACER_CC2420_SFD;
+extern WSIM_TLS tracer_id_t TRACER_CC2420_VREG_EN;
+extern WSIM_TLS tracer_id_t TRACER_CC2420_RESET;
 
 /***************************************************/
 /***************************************************/
@@ -354,6 +354,7 @@ int      cc2420_io_pins        (struct _cc2420_t * cc2420);
 int      cc2420_reset          (int dev_num);
 int      cc2420_delete         (int dev_num);
 int      cc2420_update         (int dev_num);
+wsimtime_t cc2420_tx_lookahead (int dev_num);
 int      cc2420_power_up       (int dev_num);
 int      cc2420_power_down     (int dev_num);
 
@@ -367,8 +367,6 @@ void cc2420_update_state_tx_ack_preamble(struct _cc2420_t * cc2420 UNUSED) {
 
     uint8_t preamble_bytes;
     uint8_t tx_byte;
-    uint8_t low_symbol;
-    uint8_t high_symbol;
 
     /* if VREG_EN is low, go back to VREG_OFF state */
     if (cc2420->VREG_EN_set) {
@@ -403,15 +401,7 @@ void cc2420_update_state_tx_ack_preamble(struct _cc2420_t * cc2420 UNUSED) {
     }
     /* first byte of sync word */
     else if (cc2420->tx_bytes == preamble_bytes) {
-	tx_byte = cc2420->registers[CC2420_REG_SYNCWORD];
-	/* check if 1st 4 bits are 1, then this part to 0 (cf [1], p. 37) */
-	low_symbol = CC2420_LOBYTE(cc2420->registers[CC2420_REG_SYNCWORD]) & 0x0F;
-	if (low_symbol == 0x0F)
-	    low_symbol = 0;
-	high_symbol = CC2420_LOBYTE(cc2420->registers[CC2420_REG_SYNCWORD]) & 0xF0;
-	if (high_symbol == 0xF0)
-	    high_symbol = 0;
-	tx_byte = high_symbol | low_symbol;
+	tx_byte = cc2420_tx_syncword_low(cc2420);
 	cc2420_tx_byte(cc2420, tx_byte);
 	cc2420->tx_bytes ++;
 	cc2420->fsm_timer += MACHINE_TIME_GET_NANO();
@@ -638,8 +628,6 @@ void cc2420_update_state_tx_preamble(struct _cc2420_t * cc2420 UNUSED) {
 
     uint8_t preamble_bytes;
     uint8_t tx_byte;
-    uint8_t low_symbol;
-    uint8_t high_symbol;
 
     /* if VREG_EN is low, go back to VREG_OFF state */
     if (cc2420->VREG_EN_set) {
@@ -667,6 +655,9 @@ void cc2420_update_state_tx_preamble(struct _cc2420_t * cc2420 UNUSED) {
 
     /* preamble symbols */
     if (cc2420->tx_bytes < preamble_bytes) {
+	if (cc2420->tx_bytes == 0) {
+	    cc2420_tx_frame(cc2420);
+	}
 	/* send a 0 for synchronisation */
 	cc2420_tx_byte(cc2420, 0);
 	cc2420->tx_bytes ++;
@@ -674,15 +665,7 @@ void cc2420_update_state_tx_preamble(struct _cc2420_t * cc2420 UNUSED) {
     }
     /* first byte of sync word */
     else if (cc2420->tx_bytes == preamble_bytes) {
-	tx_byte = cc2420->registers[CC2420_REG_SYNCWORD];
-	/* check if 1st 4 bits are 1, then this part to 0 (cf [1], p. 37) */
-	low_symbol = CC2420_LOBYTE(cc2420->registers[CC2420_REG_SYNCWORD]) & 0x0F;
-	if (low_symbol == 0x0F)
-	    low_symbol = 0;
-	high_symbol = CC2420_LOBYTE(cc2420->registers[CC2420_REG_SYNCWORD]) & 0xF0;
-	if (high_symbol == 0xF0)
-	    high_symbol = 0;
-	tx_byte = high_symbol | low_symbol;
+	tx_byte = cc2420_tx_syncword_low(cc2420);
 	cc2420_tx_byte(cc2420, tx_byte);
 	cc2420->tx_bytes ++;
 	cc2420->fsm_timer += MACHINE_TIME_GET_NANO();
@@ -913,5 +896,53 @@ int cc2420_update(int dev_num)
     return 0;
 }
 
+/***************************************************/
+/***************************************************/
+/***************************************************/
+
+/**
+ * minimum delay before a byte can be sent, STXON goes through 12 symbols
+ * of tx calibration whatever the state is
+ */
+
+#define CC2420_DELAY_TO(t) (((t) > MACHINE_TIME_GET_NANO()) ? ((t) - MACHINE_TIME_GET_NANO()) : 0)
+
+wsimtime_t cc2420_tx_lookahead(int dev_num)
+{
+    struct _cc2420_t * cc2420 = (struct _cc2420_t *)machine.device[dev_num].data;
+    wsimtime_t sym12 = 12 * CC2420_SYMBOL_PERIOD;
+
+    switch (cc2420->fsm_state) {
+
+    case CC2420_STATE_IDLE :
+    case CC2420_STATE_RX_CALIBRATE :
+    case CC2420_STATE_RX_SFD_SEARCH :
+    case CC2420_STATE_RX_FRAME :
+    case CC2420_STATE_RX_WAIT :
+    case CC2420_STATE_RX_OVERFLOW :
+	return sym12;
+
+    case CC2420_STATE_POWER_DOWN :
+    case CC2420_STATE_RESET :
+	return CC2420_XOSC_STARTUP_TIME + sym12;
+
+    case CC2420_STATE_XOSC_STARTING :
+	return CC2420_DELAY_TO(cc2420->fsm_timer) + sym12;
+
+    case CC2420_STATE_VREG_STARTING :
+	return CC2420_DELAY_TO(cc2420->fsm_timer) + CC2420_XOSC_STARTUP_TIME + sym12;
+
+    case CC2420_STATE_VREG_OFF :
+	return CC2420_VREG_STARTUP_TIME + CC2420_XOSC_STARTUP_TIME + sym12;
+
+    case CC2420_STATE_TX_CALIBRATE :
+    case CC2420_STATE_TX_ACK_CALIBRATE :
+	return CC2420_DELAY_TO(cc2420->fsm_timer);
 
+    default :
+	break;
+    }
 
+    /* preamble, frame, ack and underflow */
+    return 0;
+}
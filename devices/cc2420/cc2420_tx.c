@@ -112,6 +112,75 @@ void cc2420_tx_byte(struct _cc2420_t *cc2420, uint8_t tx_byte)
   cc2420->tx_timer  = MACHINE_TIME_GET_NANO() + 2 * CC2420_SYMBOL_PERIOD;
 }
 
+
+/**
+ * first byte of the sync word, 1st 4 bits set to 1 are sent as 0 (cf [1], p. 37)
+ */
+
+uint8_t cc2420_tx_syncword_low(struct _cc2420_t * cc2420) {
+    uint8_t low_symbol;
+    uint8_t high_symbol;
+
+    low_symbol = CC2420_LOBYTE(cc2420->registers[CC2420_REG_SYNCWORD]) & 0x0F;
+    if (low_symbol == 0x0F)
+	low_symbol = 0;
+    high_symbol = CC2420_LOBYTE(cc2420->registers[CC2420_REG_SYNCWORD]) & 0xF0;
+    if (high_symbol == 0xF0)
+	high_symbol = 0;
+    return high_symbol | low_symbol;
+}
+
+
+/**
+ * announce the whole frame to libwsnet when it is complete in the TX
+ * FIFO, called before the first preamble byte. The bytes are the ones
+ * sent by the tx_preamble and tx_frame states.
+ */
+
+void cc2420_tx_frame(struct _cc2420_t * cc2420) {
+    uint8_t  data[256];
+    uint16_t autocrc = CC2420_REG_MDMCTRL0_AUTOCRC(cc2420->registers[CC2420_REG_MDMCTRL0]);
+    int preamble_bytes = cc2420_tx_preamble_symbols(cc2420) / 2;
+    int fifo_bytes;
+    int len = 0;
+    int i;
+    struct wsnet_tx_info tx;
+
+    if (worldsens_c_tx_frame == NULL) {
+	return;
+    }
+
+    fifo_bytes = autocrc ? cc2420->tx_frame_len - 1 : cc2420->tx_frame_len + 1;
+    if (fifo_bytes <= 0 || fifo_bytes > cc2420->tx_fifo_len) {
+	return;
+    }
+
+    for (i = 0; i < preamble_bytes; i++) {
+	data[len++] = 0;
+    }
+    data[len++] = cc2420_tx_syncword_low(cc2420);
+    data[len++] = CC2420_HIBYTE(cc2420->registers[CC2420_REG_SYNCWORD]);
+    for (i = 0; i < fifo_bytes; i++) {
+	data[len++] = cc2420->ram[CC2420_RAM_TXFIFO_START + i];
+    }
+    if (autocrc) {
+	uint16_t fcs = cc2420_icrc(&cc2420->ram[CC2420_RAM_TXFIFO_START] + 1, cc2420->tx_frame_len - 2);
+	data[len++] = CC2420_LOBYTE(fcs);
+	data[len++] = CC2420_HIBYTE(fcs);
+    }
+
+    tx.data        = 0;
+    tx.freq_mhz    = cc2420_get_frequency_mhz(cc2420);
+    tx.modulation  = cc2420_get_modulation(cc2420);
+    tx.power_dbm   = cc2420_get_power_dbm(cc2420);
+    tx.duration    = 2 * CC2420_SYMBOL_PERIOD;
+    tx.radio_id    = cc2420->worldsens_radio_id;
+
+    if (worldsens_c_tx_frame(&tx, data, len) == 0) {
+	CC2420_DBG_TX("cc2420:tx: frame of %d bytes announced\n", len);
+    }
+}
+
 /**
  * calculate the number of 0 symbols in preamble
  */
@@ -32,6 +32,8 @@
 #define CC2420_TX_LEN_FIELD(x)  (x & 0x7F)
 
 void     cc2420_tx_byte            (struct _cc2420_t * cc2420, uint8_t tx_byte);
+void     cc2420_tx_frame           (struct _cc2420_t * cc2420);
+uint8_t  cc2420_tx_syncword_low    (struct _cc2420_t * cc2420);
 uint64_t cc2420_tx_preamble_time   (struct _cc2420_t * cc2420);
 uint8_t  cc2420_tx_preamble_symbols(struct _cc2420_t * cc2420);
 void     cc2420_tx                 (struct _cc2420_t * cc2420);
@@ -19,8 +19,8 @@
 
 #define NAME      "cma3000_spi"
 
-tracer_id_t TRACER_CMA3000_SPI_STATE;
-tracer_id_t TRACER_CMA3000_SPI_STROBE;
+WSIM_TLS tracer_id_t TRACER_CMA3000_SPI_STATE;
+WSIM_TLS tracer_id_t TRACER_CMA3000_SPI_STROBE;
 
 /***************************************************/
 /***************************************************/
@@ -67,6 +67,9 @@ int devices_reset(void)
   /* reset all devices */
   MAP_OVER_DEVICES(reset);
 
+  /* all devices are awake */
+  devnet_reset();
+
   /* post reset to init interconnect           */
   /* defined in platform dependant description */
   res += devices_reset_post();
@@ -109,6 +112,61 @@ void devices_dump_stats(int64_t user_nanotime)
 	    }
 	}
     }
+  devnet_dump_stats();
+  devimg_dump_stats();
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+wsimtime_t devices_horizon(void)
+{
+  int i;
+  wsimtime_t h;
+  wsimtime_t horizon = WSIM_HORIZON_INF;
+
+  for(i=0; i < machine.device_max; i++)
+    {
+      if (machine.device[i].horizon != NULL)
+	{
+	  h = machine.device[i].horizon(i);
+	  if (h < horizon)
+	    {
+	      horizon = h;
+	    }
+	}
+      else if (machine.device[i].update != NULL)
+	{
+	  /* no horizon: device is updated at each step */
+	  return 0;
+	}
+    }
+  return horizon;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+wsimtime_t devices_lookahead(void)
+{
+  int i;
+  wsimtime_t l;
+  wsimtime_t lookahead = WSIM_HORIZON_INF;
+
+  for(i=0; i < machine.device_max; i++)
+    {
+      if (machine.device[i].tx_lookahead != NULL)
+	{
+	  l = machine.device[i].tx_lookahead(i);
+	  if (l < lookahead)
+	    {
+	      lookahead = l;
+	    }
+	}
+    }
+  return lookahead;
 }
 
 /* ************************************************** */
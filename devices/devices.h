@@ -22,14 +22,14 @@
         }                                        \
   }
 
-#define UPDATE(d)  machine.device[ d ].update( d )
+#define UPDATE(d)  MACHINE_PROF(MPROF_DEVICE + (d), machine.device[ d ].update( d ))
 
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
 
 #if defined(GUI)
-#  define REFRESH(d) do { refresh |= machine.device[ d ].ui_draw( d ); } while (0)
+#  define REFRESH(d) MACHINE_PROF(MPROF_DEVICE + (d), refresh |= machine.device[ d ].ui_draw( d ))
 #else
 #  define REFRESH(d) do { } while (0)
 #endif
@@ -86,4 +86,21 @@ void devices_print(void);
  */
 void devices_dump_stats(int64_t user_time);
 
+/**
+ * devices_horizon
+ * minimum delay (ns) before one of the devices can change its
+ * state or its outputs without an access from the mcu
+ */
+wsimtime_t devices_horizon(void);
+
+/**
+ * devices_lookahead
+ * minimum delay (ns) before one of the radio devices can send a byte,
+ * whatever the mcu does, WSIM_HORIZON_INF without radio
+ */
+wsimtime_t devices_lookahead(void);
+
+#include "devices/devices_net.h"
+#include "devices/devices_image.h"
+
 #endif
@@ -33,6 +33,12 @@ struct device_t
   void (*ui_get_size)   (int self, int *width, int *height);
 
   void (*statdump)      (int self, wsimtime_t user_nanotime);
+  /* delay (ns) before the device can change state on its own, */
+  /* NULL if the device must be updated at each step           */
+  wsimtime_t (*horizon) (int self);
+  /* delay (ns) before the device can send a byte on the radio  */
+  /* medium, NULL if the device has no radio                    */
+  wsimtime_t (*tx_lookahead) (int self);
 
   int state_size;
   int dev_num;
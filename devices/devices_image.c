@@ -0,0 +1,623 @@
+/**
+ *  \file   devices_image.c
+ *  \brief  Devices memory images, mapped outside of the machine state
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arch/common/hardware.h"
+#include "devices/devices.h"
+#include "src/options.h"
+
+#if defined(HAVE_SYS_MMAN_H)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#define DEVIMG_JOURNALS  2
+#define J_INDEX(j)       ((j) >> 1)   /* journal bit to index */
+
+struct devimg_journal_t {
+  uint32_t *block;     /* journaled blocks                        */
+  uint8_t  *data;      /* block contents when the journal started */
+  uint32_t  count;
+  uint32_t  max;
+};
+
+struct devimg_t {
+  const char *name;
+  uint8_t    *mem;
+  uint32_t    size;
+  uint32_t    blocks;
+  int         mapped;  /* mmap'ed, malloc'ed otherwise */
+  int         shared;  /* written in place in its file */
+  uint8_t    *dirty;   /* journals holding each block  */
+  struct devimg_journal_t journal[DEVIMG_JOURNALS];
+};
+
+static WSIM_TLS struct devimg_t devimg[DEVIMG_MAX];
+static WSIM_TLS int             devimg_active;   /* active journals */
+static WSIM_TLS int             devimg_failed;   /* incomplete journals */
+
+/* multinode, shared image files are suffixed per node */
+static WSIM_TLS char            devimg_file_suffix[16];
+
+/* statistics */
+static WSIM_TLS uint64_t        devimg_journaled;
+static WSIM_TLS uint64_t        devimg_restored;
+
+#define DEVIMG_BLEN(img,b) \
+  ((((b) + 1) * DEVIMG_BLOCK <= (img)->size) ? DEVIMG_BLOCK : (img)->size - (b) * DEVIMG_BLOCK)
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void devimg_init(int ws_mode)
+{
+  memset(devimg, 0, sizeof(devimg));
+  devimg_active    = WS_MODE_BACKTRACK(ws_mode) ? DEVIMG_JOURNAL_SAVE : 0;
+  devimg_failed    = 0;
+  devimg_journaled = 0;
+  devimg_restored  = 0;
+}
+
+void devimg_suffix(const char *suffix)
+{
+  strncpyz(devimg_file_suffix, suffix, sizeof(devimg_file_suffix));
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#if defined(HAVE_SYS_MMAN_H)
+static int devimg_map(struct devimg_t *img, const char *file, int mode, uint8_t fill)
+{
+  int         fd;
+  struct stat st;
+  uint32_t    filled = 0;
+  void       *mem;
+
+  if (file == NULL)
+    {
+      mem = mmap(NULL, img->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (mem == MAP_FAILED)
+	{
+	  return 1;
+	}
+      img->mem = (uint8_t*)mem;
+      memset(img->mem, fill, img->size);
+      return 0;
+    }
+
+  if (mode == DEVIMG_SHARED)
+    {
+      if ((fd = open(file, O_RDWR | O_CREAT, 0644)) == -1)
+	{
+	  ERROR("%s: cannot open image file %s\n", img->name, file);
+	  return 1;
+	}
+      if ((fstat(fd, &st) == 0) && (st.st_size < (off_t)img->size))
+	{
+	  /* new or short image, the end is erased */
+	  filled = st.st_size;
+	  if (ftruncate(fd, img->size) == -1)
+	    {
+	      ERROR("%s: cannot resize image file %s\n", img->name, file);
+	      close(fd);
+	      return 1;
+	    }
+	}
+      else
+	{
+	  filled = img->size;
+	}
+      mem = mmap(NULL, img->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+  else
+    {
+      if ((fd = open(file, O_RDONLY)) == -1)
+	{
+	  return devimg_map(img, NULL, mode, fill);
+	}
+      if ((fstat(fd, &st) != 0) || (st.st_size < (off_t)img->size))
+	{
+	  ERROR("%s: error while loading file %s to flash\n", img->name, file);
+	  close(fd);
+	  return devimg_map(img, NULL, mode, fill);
+	}
+      filled = img->size;
+      mem = mmap(NULL, img->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+
+  /* the mapping keeps its own reference on the file */
+  close(fd);
+  if (mem == MAP_FAILED)
+    {
+      ERROR("%s: cannot map image file %s\n", img->name, file);
+      return 1;
+    }
+
+  img->mem = (uint8_t*)mem;
+  if (filled < img->size)
+    {
+      memset(img->mem + filled, fill, img->size - filled);
+    }
+  return 0;
+}
+#endif
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static int devimg_load(struct devimg_t *img, const char *file, uint8_t fill)
+{
+  FILE *f;
+
+  if ((img->mem = (uint8_t*)malloc(img->size)) == NULL)
+    {
+      return 1;
+    }
+
+  if ((file != NULL) && ((f = fopen(file, "rb")) != NULL))
+    {
+      if (fread(img->mem, 1, img->size, f) == img->size)
+	{
+	  fclose(f);
+	  return 0;
+	}
+      ERROR("%s: error while loading file %s to flash\n", img->name, file);
+      fclose(f);
+    }
+
+  memset(img->mem, fill, img->size);
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int devimg_open(const char *name, const char *file, uint32_t size, int mode, uint8_t fill)
+{
+  int id;
+  struct devimg_t *img;
+  char shared_file[MAX_FILENAME];
+
+  /* nodes of a multinode simulation do not share their image file */
+  if ((file != NULL) && (mode == DEVIMG_SHARED) && (devimg_file_suffix[0] != '\0'))
+    {
+      options_filename(shared_file, file, devimg_file_suffix);
+      file = shared_file;
+      OUTPUT("%s: node image file %s\n", name, file);
+    }
+
+  for(id=0; (id < DEVIMG_MAX) && (devimg[id].mem != NULL); id++)
+    ;
+
+  if (id == DEVIMG_MAX)
+    {
+      ERROR("%s: too many device images, max is %d\n", name, DEVIMG_MAX);
+      return -1;
+    }
+
+  img = &devimg[id];
+  memset(img, 0, sizeof(struct devimg_t));
+  img->name   = name;
+  img->size   = size;
+  img->blocks = (size + DEVIMG_BLOCK - 1) / DEVIMG_BLOCK;
+
+  if ((img->dirty = (uint8_t*)calloc(img->blocks, 1)) == NULL)
+    {
+      ERROR("%s: cannot allocate image journal\n", name);
+      return -1;
+    }
+
+#if defined(HAVE_SYS_MMAN_H)
+  if (devimg_map(img, file, mode, fill) == 0)
+    {
+      img->mapped = 1;
+      img->shared = (file != NULL) && (mode == DEVIMG_SHARED);
+      return id;
+    }
+  if (mode == DEVIMG_SHARED)
+    {
+      free(img->dirty);
+      img->dirty = NULL;
+      return -1;
+    }
+#else
+  if (mode == DEVIMG_SHARED)
+    {
+      ERROR("%s: shared images are not supported on this system\n", name);
+      free(img->dirty);
+      img->dirty = NULL;
+      return -1;
+    }
+#endif
+
+  if (devimg_load(img, file, fill) != 0)
+    {
+      ERROR("%s: cannot allocate image of %d bytes\n", name, size);
+      free(img->dirty);
+      img->dirty = NULL;
+      return -1;
+    }
+  return id;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int devimg_shared(void)
+{
+  int id;
+  int n = 0;
+  for(id=0; id < DEVIMG_MAX; id++)
+    {
+      if ((devimg[id].mem != NULL) && devimg[id].shared)
+	n++;
+    }
+  return n;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void devimg_close(int id)
+{
+  int j;
+  struct devimg_t *img;
+
+  if ((id < 0) || (id >= DEVIMG_MAX) || (devimg[id].mem == NULL))
+    return;
+
+  img = &devimg[id];
+#if defined(HAVE_SYS_MMAN_H)
+  if (img->mapped)
+    {
+      munmap(img->mem, img->size);
+    }
+  else
+#endif
+    {
+      free(img->mem);
+    }
+
+  for(j=0; j < DEVIMG_JOURNALS; j++)
+    {
+      free(img->journal[j].block);
+      free(img->journal[j].data);
+    }
+  free(img->dirty);
+  memset(img, 0, sizeof(struct devimg_t));
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+uint8_t* devimg_mem(int id)
+{
+  return devimg[id].mem;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/*
+ * a block that cannot be journaled makes the journal incomplete, it
+ * cannot be undone anymore and the failure is returned to the owner
+ * of the journal when it takes or restores it
+ */
+static void devimg_journal_block(struct devimg_t *img, uint32_t b, int journals)
+{
+  int j;
+
+  for(j=DEVIMG_JOURNAL_SAVE; j <= DEVIMG_JOURNAL_CHECKPOINT; j <<= 1)
+    {
+      struct devimg_journal_t *jl = &img->journal[J_INDEX(j)];
+
+      if (((journals & j) == 0) || (img->dirty[b] & j))
+	continue;
+
+      if (jl->count == jl->max)
+	{
+	  uint32_t  max   = (jl->max == 0) ? 64 : jl->max * 2;
+	  uint32_t *block;
+	  uint8_t  *data;
+	  if (max > img->blocks)
+	    max = img->blocks;
+	  block = (uint32_t*)realloc(jl->block, max * sizeof(uint32_t));
+	  if (block != NULL)
+	    jl->block = block;
+	  data  = (uint8_t*) realloc(jl->data,  max * DEVIMG_BLOCK);
+	  if (data != NULL)
+	    jl->data  = data;
+	  if ((block == NULL) || (data == NULL))
+	    {
+	      if ((devimg_failed & j) == 0)
+		{
+		  ERROR("%s: cannot allocate image journal\n", img->name);
+		}
+	      devimg_failed |= j;
+	      continue;
+	    }
+	  jl->max = max;
+	}
+
+      jl->block[jl->count] = b;
+      memcpy(jl->data + jl->count * DEVIMG_BLOCK, img->mem + b * DEVIMG_BLOCK, DEVIMG_BLEN(img,b));
+      jl->count ++;
+      img->dirty[b] |= j;
+      devimg_journaled ++;
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void devimg_write(int id, uint32_t offset, uint32_t len)
+{
+  struct devimg_t *img = &devimg[id];
+  uint32_t b, last;
+
+  if ((devimg_active == 0) || (len == 0) || (offset >= img->size))
+    return;
+
+  if (len > img->size - offset)
+    len = img->size - offset;
+
+  last = (offset + len - 1) / DEVIMG_BLOCK;
+  for(b = offset / DEVIMG_BLOCK; b <= last; b++)
+    {
+      if ((img->dirty[b] & devimg_active) != devimg_active)
+	{
+	  devimg_journal_block(img, b, devimg_active);
+	}
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void devimg_journal_clear(struct devimg_t *img, int j)
+{
+  uint32_t i;
+  struct devimg_journal_t *jl = &img->journal[J_INDEX(j)];
+
+  for(i=0; i < jl->count; i++)
+    {
+      img->dirty[ jl->block[i] ] &= ~j;
+    }
+  jl->count = 0;
+}
+
+/*
+ * copy back the blocks of journal j, the other journals see these
+ * copies as writes
+ */
+static int devimg_journal_undo(struct devimg_t *img, int j)
+{
+  uint32_t i;
+  int      bytes = 0;
+  struct devimg_journal_t *jl = &img->journal[J_INDEX(j)];
+
+  for(i=0; i < jl->count; i++)
+    {
+      uint32_t b = jl->block[i];
+      devimg_journal_block(img, b, devimg_active & ~j);
+      memcpy(img->mem + b * DEVIMG_BLOCK, jl->data + i * DEVIMG_BLOCK, DEVIMG_BLEN(img,b));
+      img->dirty[b] &= ~j;
+      bytes += DEVIMG_BLEN(img,b);
+    }
+  jl->count = 0;
+  devimg_restored += bytes;
+  return bytes;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void devimg_state_save(void)
+{
+  int id;
+
+  if ((devimg_active & DEVIMG_JOURNAL_SAVE) == 0)
+    return;
+
+  for(id=0; id < DEVIMG_MAX; id++)
+    {
+      if (devimg[id].mem != NULL)
+	devimg_journal_clear(&devimg[id], DEVIMG_JOURNAL_SAVE);
+    }
+  /* the new journal starts complete */
+  devimg_failed &= ~DEVIMG_JOURNAL_SAVE;
+}
+
+int devimg_state_restore(void)
+{
+  int id;
+  int bytes = 0;
+
+  if ((devimg_active & DEVIMG_JOURNAL_SAVE) == 0)
+    return 0;
+
+  if (devimg_failed & DEVIMG_JOURNAL_SAVE)
+    {
+      return -1;
+    }
+
+  for(id=0; id < DEVIMG_MAX; id++)
+    {
+      if (devimg[id].mem != NULL)
+	bytes += devimg_journal_undo(&devimg[id], DEVIMG_JOURNAL_SAVE);
+    }
+  return bytes;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * undo records are the image id and block number followed by the
+ * block content
+ **/
+#define DEVIMG_RECORD (2 * sizeof(uint32_t) + DEVIMG_BLOCK)
+
+int devimg_checkpoint_take(uint8_t **undo)
+{
+  int      id;
+  uint32_t i;
+  int      size = 0;
+  uint8_t *ptr;
+
+  *undo = NULL;
+  if ((devimg_active & DEVIMG_JOURNAL_CHECKPOINT) == 0)
+    {
+      /* first checkpoint, start journaling */
+      devimg_active |= DEVIMG_JOURNAL_CHECKPOINT;
+      return 0;
+    }
+
+  if (devimg_failed & DEVIMG_JOURNAL_CHECKPOINT)
+    {
+      /* blocks are missing, the checkpoint journal is stopped */
+      for(id=0; id < DEVIMG_MAX; id++)
+	{
+	  if (devimg[id].mem != NULL)
+	    devimg_journal_clear(&devimg[id], DEVIMG_JOURNAL_CHECKPOINT);
+	}
+      devimg_active &= ~DEVIMG_JOURNAL_CHECKPOINT;
+      devimg_failed &= ~DEVIMG_JOURNAL_CHECKPOINT;
+      return -1;
+    }
+
+  for(id=0; id < DEVIMG_MAX; id++)
+    {
+      if (devimg[id].mem != NULL)
+	size += devimg[id].journal[J_INDEX(DEVIMG_JOURNAL_CHECKPOINT)].count * DEVIMG_RECORD;
+    }
+
+  if ((size > 0) && ((*undo = (uint8_t*)malloc(size)) == NULL))
+    {
+      ERROR("wsim:images: cannot allocate checkpoint record of %d bytes\n", size);
+      size = -1;
+    }
+
+  ptr = *undo;
+  for(id=0; id < DEVIMG_MAX; id++)
+    {
+      struct devimg_t *img = &devimg[id];
+      struct devimg_journal_t *jl = &img->journal[J_INDEX(DEVIMG_JOURNAL_CHECKPOINT)];
+      if (img->mem == NULL)
+	continue;
+      for(i=0; (ptr != NULL) && (i < jl->count); i++)
+	{
+	  uint32_t rec[2] = { id, jl->block[i] };
+	  memcpy(ptr, rec, sizeof(rec));
+	  memcpy(ptr + sizeof(rec), jl->data + i * DEVIMG_BLOCK, DEVIMG_BLOCK);
+	  ptr += DEVIMG_RECORD;
+	}
+      devimg_journal_clear(img, DEVIMG_JOURNAL_CHECKPOINT);
+    }
+  if (size < 0)
+    {
+      devimg_active &= ~DEVIMG_JOURNAL_CHECKPOINT;
+    }
+  return size;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int devimg_checkpoint_rewind(void)
+{
+  int id;
+  int bytes = 0;
+
+  if (devimg_failed & DEVIMG_JOURNAL_CHECKPOINT)
+    {
+      return -1;
+    }
+
+  for(id=0; id < DEVIMG_MAX; id++)
+    {
+      if (devimg[id].mem != NULL)
+	bytes += devimg_journal_undo(&devimg[id], DEVIMG_JOURNAL_CHECKPOINT);
+    }
+  return bytes;
+}
+
+int devimg_checkpoint_apply(uint8_t *undo, int size)
+{
+  int pos;
+  int bytes = 0;
+
+  for(pos = 0; pos + (int)DEVIMG_RECORD <= size; pos += DEVIMG_RECORD)
+    {
+      uint32_t rec[2];
+      struct devimg_t *img;
+      memcpy(rec, undo + pos, sizeof(rec));
+      img = &devimg[ rec[0] ];
+      devimg_journal_block(img, rec[1], devimg_active & ~DEVIMG_JOURNAL_CHECKPOINT);
+      memcpy(img->mem + rec[1] * DEVIMG_BLOCK, undo + pos + sizeof(rec), DEVIMG_BLEN(img,rec[1]));
+      bytes += DEVIMG_BLEN(img,rec[1]);
+    }
+  devimg_restored += bytes;
+  return bytes;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void devimg_dump_stats(void)
+{
+  int id;
+  int count = 0;
+  uint64_t size = 0;
+
+  for(id=0; id < DEVIMG_MAX; id++)
+    {
+      if (devimg[id].mem != NULL)
+	{
+	  count ++;
+	  size += devimg[id].size;
+	}
+    }
+
+  if (count == 0)
+    return;
+
+  OUTPUT_STATS("  devices images                : %d (%"PRIu64" bytes)\n", count, size);
+  OUTPUT_STATS("  devices images journal        : %"PRIu64" blocks (%"PRIu64" bytes restored)\n",
+	       devimg_journaled, devimg_restored);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
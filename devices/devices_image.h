@@ -0,0 +1,96 @@
+/**
+ *  \file   devices_image.h
+ *  \brief  Devices memory images, mapped outside of the machine state
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef DEVICES_IMAGE_H
+#define DEVICES_IMAGE_H
+
+/**
+ * Large device memories (external flash) are not part of machine.state,
+ * they are mapped from their image file and only the blocks written by
+ * the device are tracked:
+ *
+ *  - private images are copy-on-write mappings of the init file, the
+ *    file is never modified and an image without init file is an
+ *    anonymous mapping. This is the behaviour of --flash_init.
+ *  - shared images are mapped in place, writes go to the file which is
+ *    created if needed. This is --flash_image.
+ *
+ * Devices must call devimg_write() before modifying a range of their
+ * image. The first write to a block since the last save copies the
+ * block to an undo journal. machine_state_save() drops the journal and
+ * machine_state_restore() copies the journaled blocks back, the cost of
+ * a rendez-vous depends on the written blocks, not on the image size.
+ * The checkpoint ring uses a second journal, see machine_checkpoint.c.
+ **/
+
+#define DEVIMG_MAX            4
+#define DEVIMG_BLOCK          256   /* journal granularity */
+
+enum devimg_mode_t {
+  DEVIMG_PRIVATE = 0,
+  DEVIMG_SHARED  = 1
+};
+
+/* journals */
+#define DEVIMG_JOURNAL_SAVE        0x01
+#define DEVIMG_JOURNAL_CHECKPOINT  0x02
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * called before devices creation
+ **/
+void     devimg_init             (int ws_mode);
+
+/* shared image files are opened as file-suffix.ext, multinode */
+void     devimg_suffix           (const char *suffix);
+
+/**
+ * map an image of size bytes, filled with fill when there is no file
+ * or when the file is too short. returns an image id or -1.
+ **/
+int      devimg_open             (const char *name, const char *file, uint32_t size,
+				  int mode, uint8_t fill);
+void     devimg_close            (int id);
+uint8_t* devimg_mem              (int id);
+
+/* number of open images written in place in their file */
+int      devimg_shared           (void);
+
+/**
+ * journal the [offset, offset+len[ range before it is modified
+ **/
+void     devimg_write            (int id, uint32_t offset, uint32_t len);
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * rendez-vous save and restore, restore returns the copied bytes or -1
+ * when the journal could not record every block since the save
+ **/
+void     devimg_state_save       (void);
+int      devimg_state_restore    (void);
+
+/**
+ * checkpoint ring: take returns in undo the blocks written since the
+ * previous checkpoint with their previous content (malloc'ed, NULL if
+ * empty), rewind goes back to the last checkpoint and apply goes back
+ * one more checkpoint using an undo record. take and rewind return -1
+ * when the journal could not record every block, the checkpoint
+ * journal is then stopped.
+ **/
+int      devimg_checkpoint_take  (uint8_t **undo);
+int      devimg_checkpoint_rewind(void);
+int      devimg_checkpoint_apply (uint8_t *undo, int size);
+
+void     devimg_dump_stats       (void);
+
+#endif
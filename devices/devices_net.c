@@ -0,0 +1,361 @@
+/**
+ *  \file   devices_net.c
+ *  \brief  Platform devices interconnect, change driven
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arch/common/hardware.h"
+#include "machine/machine.h"
+#include "devices/devices.h"
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#define DEVNET_WIRE_MAX 64
+
+struct devnet_t {
+  struct devnet_wire_t *wiring;
+  devnet_mcu_pending_t  mcu_pending;
+  devnet_mcu_read_t     mcu_read;
+
+  /* wire index for each phase, in table order */
+  int                   mcu   [DEVNET_WIRE_MAX];
+  int                   mcu_n;
+  int                   dev   [DEVNET_WIRE_MAX];
+  int                   dev_n;
+  int                   hook  [DEVNET_WIRE_MAX];
+  int                   hook_n;
+  int                   upd   [DEVNET_WIRE_MAX];
+  int                   upd_n;
+
+  uint32_t              mcu_wired; /* mcu nets with subscribers         */
+  uint32_t              managed;   /* devices that can sleep            */
+  uint32_t              touched;   /* written or read during this step  */
+
+  /* statistics */
+  uint64_t              steps;
+  uint64_t              mcu_steps;
+  uint64_t              reads;
+  uint64_t              reads_skipped;
+  uint64_t              updates;
+  uint64_t              updates_skipped;
+  uint64_t              wakeups;
+};
+
+static WSIM_TLS struct devnet_t devnet;
+
+#define DEVNET_DEV_BIT(d)  (1u << (d))
+#define DEVNET_SLEEP       (machine.state->devnet_sleep)
+#define DEVNET_QUIET       (machine.state->devnet_quiet)
+#define DEVNET_WAKE(d)     (machine.state->devnet_wake[d])
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int devnet_create(struct devnet_wire_t *wiring, devnet_mcu_pending_t pending, devnet_mcu_read_t read)
+{
+  int i, d, n;
+
+  memset(&devnet, 0, sizeof(devnet));
+  devnet.wiring      = wiring;
+  devnet.mcu_pending = pending;
+  devnet.mcu_read    = read;
+
+  for(i=0; wiring[i].net != DEVNET_END; i++)
+    {
+      n = wiring[i].net;
+      if (i >= DEVNET_WIRE_MAX)
+	{
+	  ERROR("devices:net: too many wires, max is %d\n",DEVNET_WIRE_MAX);
+	  return 1;
+	}
+
+      if (n < DEVNET_MCU_MAX)
+	{
+	  if ((pending == NULL) || (read == NULL) || (wiring[i].handler == NULL))
+	    {
+	      ERROR("devices:net: mcu net %d wired without mcu functions or handler\n",n);
+	      return 1;
+	    }
+	  devnet.mcu[devnet.mcu_n++] = i;
+	  devnet.mcu_wired |= DEVNET_MCU_BIT(n);
+	}
+      else if (n < DEVNET_DEV(machine.device_max))
+	{
+	  if (wiring[i].handler == NULL)
+	    {
+	      ERROR("devices:net: device net %d wired without handler\n",n - DEVNET_DEV(0));
+	      return 1;
+	    }
+	  devnet.dev[devnet.dev_n++] = i;
+	}
+      else if ((n >= DEVNET_UPDATE(0)) && (n < DEVNET_UPDATE(machine.device_max)))
+	{
+	  d = n - DEVNET_UPDATE(0);
+	  devnet.upd[devnet.upd_n++] = i;
+	  if (machine.device[d].horizon != NULL)
+	    {
+	      devnet.managed |= DEVNET_DEV_BIT(d);
+	    }
+	}
+      else if (n == DEVNET_HOOK)
+	{
+	  if (wiring[i].handler == NULL)
+	    {
+	      ERROR("devices:net: hook wired without handler\n");
+	      return 1;
+	    }
+	  devnet.hook[devnet.hook_n++] = i;
+	}
+      else
+	{
+	  ERROR("devices:net: unknown net %d in wiring table\n",n);
+	  return 1;
+	}
+    }
+
+  devnet_reset();
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void devnet_reset(void)
+{
+  if (machine.state != NULL)
+    {
+      DEVNET_SLEEP = 0;
+      DEVNET_QUIET = 0;
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static inline int devnet_awake(int d)
+{
+  uint32_t bit = DEVNET_DEV_BIT(d);
+
+  if ((DEVNET_SLEEP & bit) == 0)
+    {
+      return 1;
+    }
+  if (MACHINE_TIME_GET_NANO() < DEVNET_WAKE(d))
+    {
+      return 0;
+    }
+  DEVNET_SLEEP &= ~bit;
+  DEVNET_QUIET &= ~bit;
+  devnet.wakeups ++;
+  return 1;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void devnet_write(int dev, uint32_t mask, uint32_t value)
+{
+  uint32_t bit = DEVNET_DEV_BIT(dev);
+
+  machine.device[dev].write(dev, mask, value);
+  devnet.touched |= bit;
+  if (DEVNET_SLEEP & bit)
+    {
+      DEVNET_SLEEP &= ~bit;
+      DEVNET_QUIET &= ~bit;
+      devnet.wakeups ++;
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static inline void devnet_device_update(int d)
+{
+  uint32_t   bit = DEVNET_DEV_BIT(d);
+  wsimtime_t h;
+
+  if ((devnet.managed & bit) == 0)
+    {
+      devnet.updates ++;
+      UPDATE(d);
+      return;
+    }
+
+  if (devnet_awake(d) == 0)
+    {
+      devnet.updates_skipped ++;
+      return;
+    }
+
+  /* quiet during the previous step, nothing written, nothing read */
+  if ((DEVNET_QUIET & bit) &&
+      ((devnet.touched & bit) == 0) &&
+      (MACHINE_TIME_GET_NANO() < DEVNET_WAKE(d)))
+    {
+      DEVNET_SLEEP |= bit;
+      devnet.updates_skipped ++;
+      return;
+    }
+
+  devnet.updates ++;
+  UPDATE(d);
+
+  h = machine.device[d].horizon(d);
+  if (h > 0)
+    {
+      DEVNET_QUIET |= bit;
+      DEVNET_WAKE(d) = (h == WSIM_HORIZON_INF) ? WSIM_HORIZON_INF : MACHINE_TIME_GET_NANO() + h;
+    }
+  else
+    {
+      DEVNET_QUIET &= ~bit;
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int devnet_update(void)
+{
+  int      i;
+  int      refresh = 0;
+  uint32_t pending;
+  uint32_t done;
+  uint32_t valid;
+  uint32_t mask [DEVICE_MAX > DEVNET_MCU_MAX ? DEVICE_MAX : DEVNET_MCU_MAX];
+  uint32_t value[DEVICE_MAX > DEVNET_MCU_MAX ? DEVICE_MAX : DEVNET_MCU_MAX];
+  struct devnet_wire_t *w;
+
+  devnet.touched = 0;
+  devnet.steps  ++;
+
+  /* mcu -> devices */
+  if ((devnet.mcu_n > 0) && ((pending = devnet.mcu_pending() & devnet.mcu_wired) != 0))
+    {
+      devnet.mcu_steps ++;
+      done  = 0;
+      valid = 0;
+      for(i=0; i < devnet.mcu_n; i++)
+	{
+	  uint32_t bit;
+	  w   = & devnet.wiring[ devnet.mcu[i] ];
+	  bit = DEVNET_MCU_BIT(w->net);
+	  if ((pending & bit) == 0)
+	    continue;
+	  /* mcu nets are read once, spi and uart reads consume the byte */
+	  if ((done & bit) == 0)
+	    {
+	      done |= bit;
+	      if (devnet.mcu_read(w->net, &mask[w->net], &value[w->net]))
+		valid |= bit;
+	    }
+	  if (valid & bit)
+	    {
+	      refresh |= w->handler(w->net, mask[w->net], value[w->net]);
+	    }
+	}
+    }
+
+  /* devices -> mcu */
+  done  = 0;
+  valid = 0;
+  for(i=0; i < devnet.dev_n; i++)
+    {
+      int      d;
+      uint32_t bit;
+      w   = & devnet.wiring[ devnet.dev[i] ];
+      d   = w->net - DEVNET_DEV(0);
+      bit = DEVNET_DEV_BIT(d);
+      if ((done & bit) == 0)
+	{
+	  if (devnet_awake(d) == 0)
+	    {
+	      devnet.reads_skipped ++;
+	      continue;
+	    }
+	  if ((w->guard != NULL) && (w->guard() == 0))
+	    continue;
+	  done |= bit;
+	  devnet.reads ++;
+	  mask[d]  = 0;
+	  value[d] = 0;
+	  MACHINE_PROF(MPROF_DEVICE + d, machine.device[d].read(d, &mask[d], &value[d]));
+	  if (mask[d] != 0)
+	    {
+	      valid          |= bit;
+	      devnet.touched |= bit;
+	    }
+	}
+      if (valid & bit)
+	{
+	  refresh |= w->handler(w->net, mask[d], value[d]);
+	}
+    }
+
+  /* hooks */
+  for(i=0; i < devnet.hook_n; i++)
+    {
+      w = & devnet.wiring[ devnet.hook[i] ];
+      refresh |= w->handler(DEVNET_HOOK, 0, 0);
+    }
+
+  /* updates */
+  for(i=0; i < devnet.upd_n; i++)
+    {
+      devnet_device_update(devnet.wiring[ devnet.upd[i] ].net - DEVNET_UPDATE(0));
+    }
+
+  ui_refresh(refresh);
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int devnet_hook_libselect(int UNUSED net, uint32_t UNUSED mask, uint32_t UNUSED value)
+{
+  LIBSELECT_UPDATE();
+  return 0;
+}
+
+int devnet_hook_libwsnet(int UNUSED net, uint32_t UNUSED mask, uint32_t UNUSED value)
+{
+  LIBWSNET_UPDATE();
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void devnet_dump_stats(void)
+{
+  if (devnet.wiring == NULL)
+    return;
+
+  OUTPUT_STATS("  devices interconnect steps    : %"PRIu64" (%"PRIu64" with mcu changes)\n",
+	       devnet.steps, devnet.mcu_steps);
+  OUTPUT_STATS("  devices reads                 : %"PRIu64" (%"PRIu64" skipped)\n",
+	       devnet.reads, devnet.reads_skipped);
+  OUTPUT_STATS("  devices updates               : %"PRIu64" (%"PRIu64" skipped, %"PRIu64" wakeups)\n",
+	       devnet.updates, devnet.updates_skipped, devnet.wakeups);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
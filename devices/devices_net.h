@@ -0,0 +1,106 @@
+/**
+ *  \file   devices_net.h
+ *  \brief  Platform devices interconnect, change driven
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef DEVICES_NET_H
+#define DEVICES_NET_H
+
+/**
+ * A net is a source of signals between the mcu and the platform
+ * devices: the output register of an mcu port, the bytes sent by an
+ * mcu usart in spi or uart mode, or the outputs of a device (its read
+ * function). A platform describes its wiring as a table of wires, a
+ * wire subscribes a handler to a net. At each step only the handlers of
+ * the nets that changed are called:
+ *
+ *  - mcu nets are flagged by the mcu pending() function given at
+ *    creation, nothing is read when no mcu net changed.
+ *  - device nets are read for awake devices only.
+ *
+ * Managed devices are the devices with a DEVNET_UPDATE wire and a
+ * horizon function. A managed device falls asleep when it reported a
+ * horizon > 0 during the previous step, has not been written and has
+ * nothing to output. Its read and update functions are then skipped
+ * until its horizon is reached or a handler writes to it using
+ * devnet_write(). Managed devices must only be written through
+ * devnet_write().
+ *
+ * The table is run in four phases, in table order within a phase:
+ * mcu nets, device nets, hooks, device updates. This is the order of
+ * the hand written devices_update() functions. Sleep state is part of
+ * the machine state and follows backtracks.
+ **/
+
+/* net identifiers */
+#define DEVNET_PORT(n)       (n)                   /* mcu port n output, n < 16       */
+#define DEVNET_SPI(n)        (16 + (n))            /* byte sent by usart n, spi mode  */
+#define DEVNET_UART(n)       (20 + (n))            /* byte sent by usart n, uart mode */
+#define DEVNET_MCU_MAX       24
+#define DEVNET_DEV(d)        (DEVNET_MCU_MAX + (d))              /* device d outputs */
+#define DEVNET_UPDATE(d)     (DEVNET_MCU_MAX + DEVICE_MAX + (d)) /* device d update  */
+#define DEVNET_HOOK          (DEVNET_MCU_MAX + 2*DEVICE_MAX)     /* each step        */
+#define DEVNET_END           -1
+
+#define DEVNET_MCU_BIT(net)  (1u << (net))
+
+/**
+ * handler called with the net value, returns a ui refresh flag
+ *   port : mask = changed bits, value = port output register
+ *   usart: mask = 0xff        , value = byte
+ *   dev  : mask and value from the device read function
+ *   hook : mask = value = 0
+ **/
+typedef int (*devnet_handler_t)(int net, uint32_t mask, uint32_t value);
+
+/* optional guard, a device net is read only if guard() != 0 */
+typedef int (*devnet_guard_t)(void);
+
+struct devnet_wire_t {
+  int               net;
+  devnet_guard_t    guard;
+  devnet_handler_t  handler;
+};
+
+/* bitmask of changed mcu nets */
+typedef uint32_t (*devnet_mcu_pending_t)(void);
+/* read mcu net, returns 0 if there is nothing to read */
+typedef int      (*devnet_mcu_read_t)   (int net, uint32_t *mask, uint32_t *value);
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * install a wiring table terminated by a DEVNET_END wire, called by
+ * devices_create() once devices are created
+ **/
+int  devnet_create     (struct devnet_wire_t *wiring,
+			devnet_mcu_pending_t pending, devnet_mcu_read_t read);
+
+/**
+ * run the wiring, this is the body of devices_update()
+ **/
+int  devnet_update     (void);
+
+/**
+ * write to a device from a handler, wakes the device up
+ **/
+void devnet_write      (int dev, uint32_t mask, uint32_t value);
+
+/**
+ * wake all devices, called on devices reset
+ **/
+void devnet_reset      (void);
+
+void devnet_dump_stats (void);
+
+/**
+ * hooks shared by platforms, libselect and libwsnet updates
+ **/
+int  devnet_hook_libselect (int net, uint32_t mask, uint32_t value);
+int  devnet_hook_libwsnet  (int net, uint32_t mask, uint32_t value);
+
+#endif
@@ -17,8 +17,8 @@
 /***************************************************/
 /***************************************************/
 
-tracer_id_t TRACER_DS1722_STATE;
-tracer_id_t TRACER_DS1722_STROBE;
+WSIM_TLS tracer_id_t TRACER_DS1722_STATE;
+WSIM_TLS tracer_id_t TRACER_DS1722_STROBE;
 
 /***************************************************/
 /***************************************************/
@@ -364,7 +364,7 @@ void ds1722_write_conf(int dev, uint8_t data)
 
 static void WARN_MODEL_INCOMPLETE()
 {
-  static int done = 0;
+  static WSIM_TLS int done = 0;
   if (!done)
     {
       WARNING("==============================================\n");
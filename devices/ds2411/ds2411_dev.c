@@ -88,7 +88,7 @@ do {
 /* Global variables        */
 /***************************/
 
-tracer_id_t TRACER_DS2411;
+WSIM_TLS tracer_id_t TRACER_DS2411;
 
 /***************************/
 /* Time unit factors       */
@@ -410,7 +410,7 @@ static int ds2411_check_crc(ds2411_serial_number_t *id)
 
 char* ds2411_id_to_str(ds2411_serial_number_t *id)
 {
-  static char idstr[] = SERIAL_MASK_STR;
+  static WSIM_TLS char idstr[] = SERIAL_MASK_STR;
   sprintf(idstr,SERIAL_ID_STR,
 	  id->fields.crc, 
 	  id->fields.serial5, id->fields.serial4,
@@ -1076,6 +1076,19 @@ int ds2411_update(int dev)
   return 0;
 }
 
+wsimtime_t ds2411_horizon(int dev)
+{
+  /* waiting for a reset pulse from the mcu */
+  if (DS2411_WRITE_VALID == 0 &&
+      DS2411_LVL0_STATE  == ONEWIRE_LVL0_RESET && 
+      DS2411_RESET_STATE == ONEWIRE_RESET_WAIT)
+    {
+      return WSIM_HORIZON_INF;
+    }
+  /* 1-wire timings are short, run step by step */
+  return 0;
+}
+
 /***************************************************/
 /***************************************************/
 /***************************************************/
@@ -1125,6 +1138,7 @@ ds2411_device_create(int dev, char *serial)
   machine.device[dev].write        = ds2411_write;
 
   machine.device[dev].update       = ds2411_update;
+  machine.device[dev].horizon      = ds2411_horizon;
 
   machine.device[dev].ui_draw      = ds2411_ui_draw;
   machine.device[dev].ui_get_size  = ds2411_ui_get_size;
@@ -35,6 +35,7 @@ int  led_reset       (int dev);
 int  led_delete      (int dev);
 void led_write       (int dev, uint32_t addr, uint32_t val);
 int  led_update      (int dev);
+wsimtime_t led_horizon (int dev);
 int  led_ui_draw     (int dev);
 void led_ui_get_size (int dev, int *w, int *h);
 void led_ui_set_pos  (int dev, int x, int y);
@@ -68,6 +69,7 @@ int led_device_create(int dev_num, uint32_t on, uint32_t off, uint32_t bg, char*
 
   machine.device[dev_num].write         = led_write;
   machine.device[dev_num].update        = led_update;
+  machine.device[dev_num].horizon       = led_horizon;
 
   machine.device[dev_num].ui_draw       = led_ui_draw;
   machine.device[dev_num].ui_get_size   = led_ui_get_size;
@@ -112,6 +114,11 @@ int led_update(int UNUSED dev)
   return 0;
 }
 
+wsimtime_t led_horizon(int UNUSED dev)
+{
+  return WSIM_HORIZON_INF;
+}
+
 /***************************************************/
 /***************************************************/
 /***************************************************/
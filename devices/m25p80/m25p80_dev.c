@@ -11,6 +11,7 @@
 #include <string.h>
 
 #include "arch/common/hardware.h"
+#include "devices/devices.h"
 #include "devices/m25p80/m25p80_dev.h"
 #include "src/options.h"
 
@@ -27,8 +28,8 @@
 #  error "you must define a specific M25P model"
 #endif
 
-tracer_id_t TRACER_M25P_STATE;
-tracer_id_t TRACER_M25P_STROBE;
+WSIM_TLS tracer_id_t TRACER_M25P_STATE;
+WSIM_TLS tracer_id_t TRACER_M25P_STROBE;
 
 /***************************************************/
 /***************************************************/
@@ -232,11 +233,9 @@ struct m25p_t
   uint8_t hold_bit;             /* hold          */
   uint8_t write_protect_bit;    /* write protect */
 
-  union {
-    uint8_t raw   [M25P_FLASH_SIZE];
-    uint8_t sector[M25P_SECTOR_MAX][M25P_SECTOR_SIZE];
-    uint8_t page  [M25P_PAGE_MAX][M25P_PAGE_SIZE];
-  } mem;
+  /* flash array, mapped outside of the machine state */
+  int      image;
+  uint8_t *mem;
 
   enum m25p_power_state_t   power_mode;
   enum m25p_opcode_t        command;
@@ -269,9 +268,10 @@ struct m25p_t
 };
 
 #define M25P_DATA        ((struct m25p_t*)(machine.device[dev].data))
-#define M25P_MEMRAW      (M25P_DATA->mem.raw   )
-#define M25P_MEMSECTOR   (M25P_DATA->mem.sector)
-#define M25P_MEMPAGE     (M25P_DATA->mem.page  )
+#define M25P_IMAGE       (M25P_DATA->image     )
+#define M25P_MEMRAW      (M25P_DATA->mem       )
+#define M25P_MEMSECTOR(s)(M25P_DATA->mem + (s) * M25P_SECTOR_SIZE)
+#define M25P_MEMPAGE(p)  (M25P_DATA->mem + (p) * M25P_PAGE_SIZE)
 #define M25P_INIT        (M25P_DATA->file_init )
 #define M25P_DUMP        (M25P_DATA->file_dump )
 
@@ -286,6 +286,7 @@ int  m25p_power_down  (int dev);
 void m25p_read        (int dev, uint32_t *mask, uint32_t *value);
 void m25p_write       (int dev, uint32_t  mask, uint32_t  value);
 int  m25p_update      (int dev);
+wsimtime_t m25p_horizon (int dev);
 int  m25p_ui_draw     (int dev);
 void m25p_ui_get_size (int dev, int *w, int *h);
 void m25p_ui_set_pos  (int dev, int  x, int  y);
@@ -311,6 +312,13 @@ static struct moption_t flash_dump_opt = {
   .value       = NULL
 };
 
+static struct moption_t flash_image_opt = {
+  .longname    = "flash_image",
+  .type        = required_argument,
+  .helpstring  = "Flash image, written in place",
+  .value       = NULL
+};
+
 
 int m25p_add_options(int UNUSED dev_num, int dev_id, const char UNUSED *dev_name)
 {
@@ -322,6 +330,7 @@ int m25p_add_options(int UNUSED dev_num, int dev_id, const char UNUSED *dev_name
 
   options_add( &flash_init_opt  );
   options_add( &flash_dump_opt  );
+  options_add( &flash_image_opt );
   return 0;
 }
 
@@ -338,34 +347,6 @@ int m25p_device_size()
 /***************************************************/
 /***************************************************/
 
-int m25p_flash_load(int dev, const char *name)
-{
-  FILE *f;
-
-  if ((f = fopen(name, "rb")) == NULL)
-    {
-      return 1;
-    }
-  
-  HW_DMSG_M25(M25PNAME ": loading file %s into flash\n",name);
-
-  if (fread(M25P_MEMRAW,1,M25P_FLASH_SIZE,f) != M25P_FLASH_SIZE)
-    {
-      HW_DMSG_M25(M25PNAME ": error while loading file %s to flash\n",name);
-      ERROR      (M25PNAME ": error while loading file %s to flash\n",name);
-      return 2;
-    }
-
-  HW_DMSG_M25(M25PNAME ": loading file %s into flash -- ok\n",name);
-
-  fclose(f);
-  return 0;
-}
-
-/***************************************************/
-/***************************************************/
-/***************************************************/
-
 int m25p_flash_dump(int dev, const char *name)
 {
   FILE *f;
@@ -394,6 +375,16 @@ int m25p_flash_dump(int dev, const char *name)
 /***************************************************/
 /***************************************************/
 
+/* energy accounting, typical currents indexed by ETRACER_M25P_POWER_* */
+static const uint32_t m25p_energy_nA[ENERGY_MAX_STATES] = {
+  0,
+  1000,     /* DEEP_DOWN */
+  50000,    /* STANDBY   */
+  4000000,  /* ACTIVE    */
+  4000000,  /* READ      */
+  15000000  /* WRITE     */
+};
+
 int m25p_device_create(int dev, int UNUSED id)
 {
   machine.device[dev].reset         = m25p_reset;
@@ -404,6 +395,7 @@ int m25p_device_create(int dev, int UNUSED id)
   machine.device[dev].read          = m25p_read;
   machine.device[dev].write         = m25p_write;
   machine.device[dev].update        = m25p_update;
+  machine.device[dev].horizon       = m25p_horizon;
 
   machine.device[dev].ui_draw       = m25p_ui_draw;
   machine.device[dev].ui_get_size   = m25p_ui_get_size;
@@ -413,6 +405,15 @@ int m25p_device_create(int dev, int UNUSED id)
   machine.device[dev].name          = M25PNAME " flash memory";
 
   M25P_INIT = flash_init_opt.value;
+  if (flash_image_opt.value)
+    {
+      if (M25P_INIT != NULL)
+	{
+	  ERROR("wsim:m25p80: flash_init and flash_image cannot be used together\n");
+	  return 1;
+	}
+      OUTPUT("wsim:m25p80: flash image %s is written in place\n",flash_image_opt.value);
+    }
   if (flash_dump_opt.value)
     {
       OUTPUT("wsim:m25p80: will dump flash in %s\n",flash_dump_opt.value);
@@ -430,15 +431,26 @@ int m25p_device_create(int dev, int UNUSED id)
   HW_DMSG_M25(M25PNAME ": =================================== \n");
 #endif
 
-  if (M25P_INIT == NULL || m25p_flash_load(dev, M25P_INIT))
+  /* unknown or short init files give a flash filled with 0xff */
+  if (flash_image_opt.value)
+    {
+      M25P_IMAGE = devimg_open(M25PNAME, flash_image_opt.value, M25P_FLASH_SIZE, DEVIMG_SHARED, 0xff);
+    }
+  else
     {
-      HW_DMSG_M25(M25PNAME ": flash memory init to 0xff\n");
-      memset(M25P_MEMRAW,0xff,M25P_FLASH_SIZE);
+      M25P_IMAGE = devimg_open(M25PNAME, M25P_INIT, M25P_FLASH_SIZE, DEVIMG_PRIVATE, 0xff);
     }
+  if (M25P_IMAGE == -1)
+    {
+      return 1;
+    }
+  M25P_MEMRAW = devimg_mem(M25P_IMAGE);
 
   TRACER_M25P_STATE  = tracer_event_add_id(8, "state"    , M25PNAME);
   TRACER_M25P_STROBE = tracer_event_add_id(8, "function" , M25PNAME);
 
+  energy_register(ETRACER_PER_ID_M25P, M25PNAME, m25p_energy_nA);
+
   return 0;
 }
 
@@ -472,6 +484,7 @@ int m25p_delete(int dev)
     {
       m25p_flash_dump(dev,M25P_DUMP);
     }
+  devimg_close(M25P_IMAGE);
 
   return 0;
 }
@@ -562,7 +575,8 @@ static void m25p_erase_sector(int dev, uint32_t address)
       HW_DMSG_M25(M25PNAME ": protection error : sector %d protected by bpx bits\n",sector);
     }
 
-  memset(M25P_MEMSECTOR[address / M25P_SECTOR_SIZE],0xff,M25P_SECTOR_SIZE);
+  devimg_write(M25P_IMAGE, sector * M25P_SECTOR_SIZE, M25P_SECTOR_SIZE);
+  memset(M25P_MEMSECTOR(sector),0xff,M25P_SECTOR_SIZE);
 }
 
 /***************************************************/
@@ -584,6 +598,7 @@ static void m25p_erase_bulk(int dev)
       ERROR(M25PNAME ": protection error = bulk erase with bp0|bp1|bp2 > 0\n");
       HW_DMSG_M25(M25PNAME ": protection error = bulk erase with bp0|bp1|bp2 > 0\n");
     }
+  devimg_write(M25P_IMAGE, 0, M25P_FLASH_SIZE);
   memset(M25P_MEMRAW,0xff,M25P_FLASH_SIZE);
 }
 
@@ -958,9 +973,9 @@ void m25p_write_spidata(int dev, uint32_t UNUSED mask, uint32_t value)
 		  if (M25P_DATA->command_needed_data == 0)
 		    {
 		      M25P_DATA->command_pointer = 
-			(M25P_DATA->command_stored_data[0] << 16) | 
-			(M25P_DATA->command_stored_data[1] <<  8) |
-			(M25P_DATA->command_stored_data[2]      );
+			((M25P_DATA->command_stored_data[0] << 16) | 
+			 (M25P_DATA->command_stored_data[1] <<  8) |
+			 (M25P_DATA->command_stored_data[2]      )) % M25P_FLASH_SIZE;
 		      HW_DMSG_M25(M25PNAME ":    read ready at address 0x%06x (page 0x%04x)\n",
 				  M25P_DATA->command_pointer,M25P_DATA->command_pointer >> 8);
 		    }
@@ -983,9 +998,9 @@ void m25p_write_spidata(int dev, uint32_t UNUSED mask, uint32_t value)
 		  if (M25P_DATA->command_needed_data == 0)
 		    {
 		      M25P_DATA->command_pointer = 
-			(M25P_DATA->command_stored_data[0] << 16) | 
-			(M25P_DATA->command_stored_data[1] <<  8) |
-			(M25P_DATA->command_stored_data[2]      );
+			((M25P_DATA->command_stored_data[0] << 16) | 
+			 (M25P_DATA->command_stored_data[1] <<  8) |
+			 (M25P_DATA->command_stored_data[2]      )) % M25P_FLASH_SIZE;
 		      HW_DMSG_M25(M25PNAME ":    FAST Read ready at address 0x%06x (page 0x%04x)\n",
 				  M25P_DATA->command_pointer,M25P_DATA->command_pointer >> 8);
 		    }
@@ -1009,9 +1024,9 @@ void m25p_write_spidata(int dev, uint32_t UNUSED mask, uint32_t value)
 	      else 
 		{
 		  M25P_DATA->command_pointer = 
-		    (M25P_DATA->command_stored_data[0] << 16) | 
-		    (M25P_DATA->command_stored_data[1] <<  8) |
-		    (M25P_DATA->command_stored_data[2]      );
+		    ((M25P_DATA->command_stored_data[0] << 16) | 
+		     (M25P_DATA->command_stored_data[1] <<  8) |
+		     (M25P_DATA->command_stored_data[2]      )) % M25P_FLASH_SIZE;
 		  HW_DMSG_M25(M25PNAME ":    sector erase (linear=%x, sector %x)\n",
 			      M25P_DATA->command_pointer, (M25P_DATA->command_pointer >> 16) & 0xff);
 		  M25P_DATA->command_need_to_complete = 1;
@@ -1027,9 +1042,9 @@ void m25p_write_spidata(int dev, uint32_t UNUSED mask, uint32_t value)
 		  if (M25P_DATA->command_needed_data == 0)
 		    {
 		      M25P_DATA->command_pointer = 
-			(M25P_DATA->command_stored_data[0] << 16) | 
-			(M25P_DATA->command_stored_data[1] <<  8) |
-			(M25P_DATA->command_stored_data[2]      );
+			((M25P_DATA->command_stored_data[0] << 16) | 
+			 (M25P_DATA->command_stored_data[1] <<  8) |
+			 (M25P_DATA->command_stored_data[2]      )) % M25P_FLASH_SIZE;
 		    }
 		} 
 	      else 
@@ -1041,7 +1056,8 @@ void m25p_write_spidata(int dev, uint32_t UNUSED mask, uint32_t value)
 		  page_offset = M25P_DATA->command_pointer % M25P_PAGE_SIZE;
 		  HW_DMSG_M25(M25PNAME ":    page program (linear=%x, page %x, offset %x) = 0x%x\n",
 			      M25P_DATA->command_pointer, page_index, page_offset, M25P_DATA->data_buffer & 0xff);
-		  M25P_MEMPAGE[page_index][page_offset] &= M25P_DATA->data_buffer;
+		  devimg_write(M25P_IMAGE, page_index * M25P_PAGE_SIZE + page_offset, 1);
+		  M25P_MEMPAGE(page_index)[page_offset] &= M25P_DATA->data_buffer;
 		  page_offset ++;
 		  if (page_offset == M25P_PAGE_SIZE)
 		    {
@@ -1449,6 +1465,22 @@ int m25p_update(int dev)
 /***************************************************/
 /***************************************************/
 
+wsimtime_t m25p_horizon(int dev)
+{
+  /* the only autonomous transition is the end of a write/erase */
+  if ((M25P_DATA->power_mode == M25P_POWER_ACTIVE) && (M25P_DATA->status_register.b.wip == 1))
+    {
+      if (MACHINE_TIME_GET_NANO() >= M25P_DATA->end_of_busy_time)
+	return 0;
+      return M25P_DATA->end_of_busy_time - MACHINE_TIME_GET_NANO();
+    }
+  return WSIM_HORIZON_INF;
+}
+
+/***************************************************/
+/***************************************************/
+/***************************************************/
+
 int m25p_ui_draw      (int UNUSED dev)
 {
   return 0;
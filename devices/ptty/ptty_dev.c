@@ -58,6 +58,7 @@ void ptty_skt_read    (int dev, uint32_t *mask, uint32_t *value);
 void ptty_skt_write   (int dev, uint32_t  mask, uint32_t  value);
 
 int  ptty_update      (int dev);
+wsimtime_t ptty_horizon (int dev);
 int  ptty_ui_draw     (int dev);
 void ptty_ui_get_size (int dev, int *w, int *h);
 void ptty_ui_set_pos  (int dev, int  x, int  y);
@@ -165,6 +166,7 @@ int ptty_device_create(int dev, int id)
   machine.device[dev].power_up      = ptty_power_up;
   machine.device[dev].power_down    = ptty_power_down;
   machine.device[dev].update        = ptty_update;
+  machine.device[dev].horizon       = ptty_horizon;
   machine.device[dev].ui_draw       = ptty_ui_draw;
   machine.device[dev].ui_get_size   = ptty_ui_get_size;
   machine.device[dev].ui_set_pos    = ptty_ui_set_pos;
@@ -220,11 +222,14 @@ int ptty_delete(int dev)
 {
   libselect_id_close(PTTY_IO);
 
+  /* options are shared by multinode nodes, first delete frees them */
   if (opt_array[PTTY_SERID].io.longname)
     free(opt_array[PTTY_SERID].io.longname);
+  opt_array[PTTY_SERID].io.longname = NULL;
 
   if (opt_array[PTTY_SERID].io.helpstring)
     free(opt_array[PTTY_SERID].io.helpstring);
+  opt_array[PTTY_SERID].io.helpstring = NULL;
 
   return 0;
 }
@@ -313,6 +318,16 @@ int  ptty_update      (int UNUSED dev)
   return 0;       
 }
 
+wsimtime_t ptty_horizon (int dev)
+{
+  /* input can be read at any time from the outside world */
+  if (libselect_id_is_valid(PTTY_IO) && libselect_id_is_input(PTTY_IO))
+    {
+      return 0;
+    }
+  return WSIM_HORIZON_INF;
+}
+
 int  ptty_ui_draw     (int UNUSED dev)
 { 
   return 0;       
@@ -19,8 +19,8 @@
 
 #define NAME      "spidev"
 
-tracer_id_t TRACER_SPIDEV_STATE;
-tracer_id_t TRACER_SPIDEV_STROBE;
+WSIM_TLS tracer_id_t TRACER_SPIDEV_STATE;
+WSIM_TLS tracer_id_t TRACER_SPIDEV_STROBE;
 
 /***************************************************/
 /***************************************************/
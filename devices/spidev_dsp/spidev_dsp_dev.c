@@ -87,8 +87,8 @@ struct spidev_dsp_t
 /***************************************************/
 /***************************************************/
 
-tracer_id_t TRACER_SPIDEV_DSP_STATE;
-tracer_id_t TRACER_SPIDEV_DSP_STROBE;
+WSIM_TLS tracer_id_t TRACER_SPIDEV_DSP_STATE;
+WSIM_TLS tracer_id_t TRACER_SPIDEV_DSP_STROBE;
 
 /***************************************************/
 /** DSP external entry points **********************/
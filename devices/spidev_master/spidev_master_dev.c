@@ -49,8 +49,8 @@
 
 #define NAME      "spidevmaster"
 
-tracer_id_t TRACER_SPIDEV_STATE;
-tracer_id_t TRACER_SPIDEV_STROBE;
+WSIM_TLS tracer_id_t TRACER_SPIDEV_STATE;
+WSIM_TLS tracer_id_t TRACER_SPIDEV_STROBE;
 
 /***************************************************/
 /***************************************************/
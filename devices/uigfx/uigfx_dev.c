@@ -31,6 +31,7 @@ int  uigfx_reset       (int dev);
 int  uigfx_delete      (int dev);
 void uigfx_write       (int dev, uint32_t addr, uint32_t val);
 int  uigfx_update      (int dev);
+wsimtime_t uigfx_horizon (int dev);
 int  uigfx_ui_draw     (int dev);
 void uigfx_ui_get_size (int dev, int *w, int *h);
 void uigfx_ui_set_pos  (int dev, int x, int y);
@@ -58,6 +59,7 @@ int uigfx_device_create(int dev_num, char** xpm)
 
   machine.device[dev_num].write         = uigfx_write;
   machine.device[dev_num].update        = uigfx_update;
+  machine.device[dev_num].horizon       = uigfx_horizon;
 
   machine.device[dev_num].ui_draw       = uigfx_ui_draw;
   machine.device[dev_num].ui_get_size   = uigfx_ui_get_size;
@@ -98,6 +100,11 @@ int uigfx_update(int UNUSED dev)
   return 0;
 }
 
+wsimtime_t uigfx_horizon(int UNUSED dev)
+{
+  return WSIM_HORIZON_INF;
+}
+
 /***************************************************/
 /***************************************************/
 /***************************************************/
@@ -223,7 +223,7 @@ void uigfx_img_draw(struct uigfx_img_t *img)
 {
   int i,j;
   int pixel;
-  static int warn_only_once = 1;
+  static WSIM_TLS int warn_only_once = 1;
 
   if ((img == NULL) && (warn_only_once == 1))
     {
@@ -105,7 +105,7 @@ struct section_info_t {
   int  size;
 };
 
-static struct section_info_t secinfo[SECTION_NUMBER];
+static WSIM_TLS struct section_info_t secinfo[SECTION_NUMBER];
 
 
 int libelf_set_section_info(int i,char *name, int addr, int offset, int size)
@@ -27,6 +27,10 @@ int      libelf_close              (elf32_t elf);
 uint32_t libelf_symtab_find_addr_by_name(elf32_t elf, const char* name);
 int      libelf_symtab_find_size_by_name(elf32_t elf, const char* name);
 
+/* calls f for each named symbol, func is set for function symbols */
+typedef void (*libelf_symtab_fn_t)(void *data, const char* name, uint32_t addr, uint32_t size, int func);
+int      libelf_symtab_foreach     (elf32_t elf, libelf_symtab_fn_t f, void *data);
+
 
 /* ************************************************** */
 /* ************************************************** */
@@ -768,7 +768,7 @@ char* stvis_chr(int n)
 char* stshn_chr(int n)
 {
 # define BUF_MAX 200
-  static char numvalue[BUF_MAX];
+  static WSIM_TLS char numvalue[BUF_MAX];
   switch (n)
     {
     case SHN_UNDEF     : return "UND";
@@ -874,6 +874,41 @@ int libelf_symtab_find_size_by_name(elf32_t elf, const char *name)
   return -1;
 }
 
+int libelf_symtab_foreach(elf32_t elf, libelf_symtab_fn_t f, void *data)
+{
+  uint32_t        i;
+  int             n = 0;
+  int             symtab_n = libelf_find_section_by_name(elf,".symtab");
+  int             strtab_n = libelf_find_section_by_name(elf,".strtab");
+  elf32_sh_t     *symtab_s;
+  elf32_symtab_t *symtab_p;
+  elf32_sh_t     *strtab_s;
+  char*           strtab_p;
+
+  if ((symtab_n == -1) || (strtab_n == -1))
+    {
+      DMSG_LIB_ELF("libelf:symtab:foreach no symbol table\n");
+      return 0;
+    }
+
+  symtab_s = &(elf->elf_section[ symtab_n ]);
+  symtab_p = (elf32_symtab_t *)((char*)(elf->file_raw) + symtab_s->sh_offset);
+  strtab_s = &(elf->elf_section[ strtab_n ]);
+  strtab_p = (char*)(elf->file_raw) + strtab_s->sh_offset;
+
+  for(i=0; i < (symtab_s->sh_size / sizeof(elf32_symtab_t)); i++)
+    {
+      if ( (symtab_p[i].st_name > 0) && (symtab_p[i].st_name < strtab_s->sh_size) &&
+	   (symtab_p[i].st_shndx != SHN_UNDEF) )
+	{
+	  f(data, strtab_p + symtab_p[i].st_name, symtab_p[i].st_value, symtab_p[i].st_size,
+	    ELF32_ST_TYPE(symtab_p[i].st_info) == STT_FUNC);
+	  n++;
+	}
+    }
+  return n;
+}
+
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
@@ -884,7 +919,7 @@ static void libelf_load_section(elf32_t elf, int n, int UNUSED verbose_level)
 {
   elf32_sh_t *s = &(elf->elf_section[n]);
 #if defined(MSP430_DATA_INIT_WORKAROUND)
-  static uint16_t text_end    = 0; /* section text end in ram adress */
+  static WSIM_TLS uint16_t text_end    = 0; /* section text end in ram adress */
 #endif
 
   switch (s->sh_type)
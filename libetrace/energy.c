@@ -0,0 +1,325 @@
+/**
+ *  \file   energy.c
+ *  \brief  WSim built-in energy accountant
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "arch/common/hardware.h"
+#include "src/options.h"
+#include "energy.h"
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#define DEBUG_ENERGY 0
+
+#if DEBUG_ENERGY != 0
+#define ENERGY_DBG(x...) HW_DMSG(x)
+#else
+#define ENERGY_DBG(x...) do { } while (0)
+#endif
+
+#undef UNUSED
+#define UNUSED __attribute__((unused))
+
+#define ENERGY_MAX_COMPONENTS 16  /* indexed by ETRACER_PER_ID_* */
+#define ENERGY_NAME_LENGTH    20
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/*
+ * Energies are accumulated in nJ. Per component tables are converted
+ * at registration: W per state (nJ per ns) and nJ per cycle.
+ */
+
+struct energy_component_t {
+  int          registered;
+  char         name[ENERGY_NAME_LENGTH];
+  double       state_W[ENERGY_MAX_STATES];
+  tracer_id_t  trc;
+};
+
+struct energy_cpu_t {
+  double       cycle_nJ;                     /* per active mode cycle */
+};
+
+/* backtracked state */
+struct energy_state_t {
+  double       nJ    [ENERGY_MAX_COMPONENTS];
+  int          state [ENERGY_MAX_COMPONENTS];
+  wsimtime_t   since [ENERGY_MAX_COMPONENTS]; /* time of the last state change */
+
+  /* current slot */
+  uint32_t     slot_cycles;
+
+  /* active mode slots without instruction use the last instruction power */
+  double       last_insn_nJ;
+  int          last_insn_ns;
+
+  wsimtime_t   next_record;
+};
+
+static WSIM_TLS int                        energy_enabled = 0;
+static WSIM_TLS int                        energy_voltage = ENERGY_DEFAULT_VOLTAGE;
+static WSIM_TLS struct energy_component_t  energy_comp[ENERGY_MAX_COMPONENTS];
+static WSIM_TLS struct energy_cpu_t        energy_cpu;
+static WSIM_TLS struct energy_state_t      energy_current;
+static WSIM_TLS struct energy_state_t      energy_backup;
+
+#define CPU ETRACER_PER_ID_MCU_CPU
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void energy_slot_insn   (uint32_t pc, uint8_t class, uint16_t cycles, uint8_t non_seq, uint16_t ret_addr, uint8_t b_type, uint8_t except, uint8_t reti);
+static void energy_slot_event  (uint8_t periph_id, uint8_t event_id, uint8_t arg, uint8_t skew);
+static void energy_slot_end    (int timing);
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void energy_init(int enable, int voltage, int UNUSED ws_mode)
+{
+  memset(energy_comp,     0, sizeof(energy_comp));
+  memset(&energy_current, 0, sizeof(energy_current));
+  memset(&energy_backup,  0, sizeof(energy_backup));
+
+  if (! enable)
+    {
+      energy_enabled = 0;
+      return;
+    }
+
+  energy_enabled = 1;
+  energy_voltage = voltage;
+  energy_current.next_record = ENERGY_TRACE_PERIOD;
+
+  etracer_slot_insn_ptr  = energy_slot_insn;
+  etracer_slot_event_ptr = energy_slot_event;
+  etracer_slot_end_ptr   = energy_slot_end;
+  ENERGY_DBG("energy: init ok, %d mV\n", voltage);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void energy_component_init(int id, const char *name)
+{
+  strncpyz(energy_comp[id].name, name, ENERGY_NAME_LENGTH);
+  energy_comp[id].registered = 1;
+  energy_comp[id].trc        = tracer_event_add_id(64, "energy_uJ", name);
+  energy_current.nJ   [id]   = 0;
+  energy_current.state[id]   = 0;
+  energy_current.since[id]   = 0;   /* models are created before time starts */
+}
+
+/* nA x mV = pW */
+#define ENERGY_WATT(nA) ((double)(nA) * (double)energy_voltage * 1e-12)
+
+void energy_cpu_register(const char *name, uint32_t active_nA_MHz,
+			 const uint32_t mode_nA[ENERGY_MAX_STATES])
+{
+  int i;
+
+  if (! energy_enabled)
+    return;
+
+  energy_component_init(CPU, name);
+  /* nA/MHz x mV = 1e-18 J per cycle */
+  energy_cpu.cycle_nJ = (double)active_nA_MHz * (double)energy_voltage * 1e-9;
+  for(i=0; i<ENERGY_MAX_STATES; i++)
+    {
+      energy_comp[CPU].state_W[i] = ENERGY_WATT(mode_nA[i]);
+    }
+}
+
+void energy_register(int periph_id, const char *name, const uint32_t state_nA[ENERGY_MAX_STATES])
+{
+  int i;
+
+  if (! energy_enabled)
+    return;
+
+  if (periph_id <= CPU || periph_id >= ENERGY_MAX_COMPONENTS)
+    {
+      ERROR("energy: wrong peripheral id %d for %s\n", periph_id, name);
+      return;
+    }
+
+  energy_component_init(periph_id, name);
+  for(i=0; i<ENERGY_MAX_STATES; i++)
+    {
+      energy_comp[periph_id].state_W[i] = ENERGY_WATT(state_nA[i]);
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/* peripheral energy up to time now, the component state is not modified */
+static inline double energy_component_nJ(int id, wsimtime_t now)
+{
+  return energy_current.nJ[id] +
+    energy_comp[id].state_W[energy_current.state[id]] * (double)(now - energy_current.since[id]);
+}
+
+static void energy_record(wsimtime_t now)
+{
+  int id;
+  for(id = 0; id < ENERGY_MAX_COMPONENTS; id++)
+    {
+      if (energy_comp[id].registered)
+	{
+	  double nJ = (id == CPU) ? energy_current.nJ[CPU] : energy_component_nJ(id, now);
+	  tracer_event_record(energy_comp[id].trc, (tracer_val_t)(nJ / 1000.0));
+	}
+    }
+  energy_current.next_record = now - (now % ENERGY_TRACE_PERIOD) + ENERGY_TRACE_PERIOD;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void energy_slot_insn(uint32_t UNUSED pc, uint8_t UNUSED class, uint16_t cycles,
+			     uint8_t UNUSED non_seq, uint16_t UNUSED ret_addr,
+			     uint8_t UNUSED b_type, uint8_t UNUSED except, uint8_t UNUSED reti)
+{
+  energy_current.slot_cycles = cycles;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void energy_slot_event(uint8_t periph_id, uint8_t event_id, uint8_t arg, uint8_t UNUSED skew)
+{
+  wsimtime_t now;
+
+  if ((event_id != ETRACER_PER_EVT_MODE_CHANGED) || (periph_id >= ENERGY_MAX_COMPONENTS))
+    {
+      return;
+    }
+
+  if (periph_id == CPU)
+    {
+      /* cpu modes are given by energy_cpu_mode() */
+      return;
+    }
+
+  arg &= (ENERGY_MAX_STATES - 1);
+  now = MACHINE_TIME_GET_NANO();
+  energy_current.nJ   [periph_id] = energy_component_nJ(periph_id, now);
+  energy_current.state[periph_id] = arg;
+  energy_current.since[periph_id] = now;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void energy_cpu_mode(int mode)
+{
+  /* cpu low power modes are charged per slot */
+  energy_current.state[CPU] = mode & (ENERGY_MAX_STATES - 1);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void energy_slot_end(int timing)
+{
+  if (energy_current.slot_cycles)
+    {
+      /* instruction: cycles x energy per active cycle */
+      double nJ = energy_current.slot_cycles * energy_cpu.cycle_nJ;
+      energy_current.nJ[CPU]      += nJ;
+      energy_current.last_insn_nJ  = nJ;
+      energy_current.last_insn_ns  = timing;
+      energy_current.slot_cycles   = 0;
+    }
+  else if (energy_current.state[CPU] != 0)
+    {
+      /* low power mode */
+      energy_current.nJ[CPU] += energy_comp[CPU].state_W[energy_current.state[CPU]] * timing;
+    }
+  else if (energy_current.last_insn_ns > 0)
+    {
+      /* active mode without instruction (interrupt entry) */
+      energy_current.nJ[CPU] += energy_current.last_insn_nJ * timing / energy_current.last_insn_ns;
+    }
+
+  if (MACHINE_TIME_GET_NANO() >= energy_current.next_record)
+    {
+      energy_record(MACHINE_TIME_GET_NANO());
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void energy_state_save(void)
+{
+  if (energy_enabled)
+    {
+      memcpy(&energy_backup, &energy_current, sizeof(struct energy_state_t));
+    }
+}
+
+void energy_state_restore(void)
+{
+  if (energy_enabled)
+    {
+      memcpy(&energy_current, &energy_backup, sizeof(struct energy_state_t));
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void energy_dump_stats(void)
+{
+  int id;
+  double total = 0;
+  wsimtime_t now;
+
+  if (! energy_enabled)
+    return;
+
+  now = MACHINE_TIME_GET_NANO();
+  OUTPUT_STATS("  energy supply voltage         : %d.%03d V\n", energy_voltage / 1000, energy_voltage % 1000);
+  for(id = 0; id < ENERGY_MAX_COMPONENTS; id++)
+    {
+      if (energy_comp[id].registered)
+	{
+	  double nJ = (id == CPU) ? energy_current.nJ[CPU] : energy_component_nJ(id, now);
+	  OUTPUT_STATS("  energy %-22s : %.6f mJ\n", energy_comp[id].name, nJ * 1e-6);
+	  total += nJ;
+	}
+    }
+  OUTPUT_STATS("  energy total                  : %.6f mJ\n", total * 1e-6);
+  if (now > 0)
+    {
+      /* nJ / ns = W */
+      OUTPUT_STATS("  energy average power          : %.6f mW\n", total / (double)now * 1e3);
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
@@ -0,0 +1,54 @@
+/**
+ *  \file   energy.h
+ *  \brief  WSim built-in energy accountant
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef _WSIM_ENERGY_H_
+#define _WSIM_ENERGY_H_
+
+/**
+ * The energy accountant consumes the etracer slot stream online:
+ *
+ *  - mcu instructions are charged cycles x energy per active mode
+ *    cycle,
+ *  - slots without instruction are charged with the current of the
+ *    mcu low power mode, given by energy_cpu_mode(),
+ *  - peripherals are charged with the current of their power state,
+ *    given by ETRACER_PER_EVT_MODE_CHANGED events, over simulated time.
+ *
+ * Models register their current tables at creation, tables are given
+ * in nA (nA/MHz for the mcu active mode) and are indexed by the
+ * ETRACER_* state value found in the mode events. Periph ids that are
+ * shared by several models (CC1100/CC2420, M25P/AT45DB) are accounted
+ * with the table of the model that registered last.
+ *
+ * Cumulative energy is printed with the machine statistics and is
+ * recorded in the event tracer every ENERGY_TRACE_PERIOD.
+ **/
+
+#define ENERGY_MAX_STATES       16
+#define ENERGY_TRACE_PERIOD     (1000*1000)   /* ns, 1 ms */
+#define ENERGY_DEFAULT_VOLTAGE  3000          /* mV         */
+
+/* enable != 0 starts the accountant, voltage is the supply in mV */
+void energy_init          (int enable, int voltage, int ws_mode);
+
+/* active_nA_MHz is the active mode current, mode_nA is indexed by the mcu low power mode */
+void energy_cpu_register  (const char* name, uint32_t active_nA_MHz,
+			   const uint32_t mode_nA[ENERGY_MAX_STATES]);
+
+/* mcu low power mode, 0 is the active mode */
+void energy_cpu_mode      (int mode);
+
+/* state_nA is indexed by the ETRACER_<periph>_* state */
+void energy_register      (int periph_id, const char* name,
+			   const uint32_t state_nA[ENERGY_MAX_STATES]);
+
+void energy_state_save    (void);
+void energy_state_restore (void);
+
+void energy_dump_stats    (void);
+
+#endif
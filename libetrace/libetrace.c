@@ -14,6 +14,18 @@
 #include "libetrace.h"
 #include "src/options.h"
 
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/* slot stream consumers, NULL when no consumer is running on this node */
+WSIM_TLS void (*etracer_slot_insn_ptr)   (uint32_t pc, uint8_t class, uint16_t cycles, uint8_t non_seq, uint16_t ret_addr, uint8_t b_type, uint8_t except, uint8_t reti) = NULL;
+WSIM_TLS void (*etracer_slot_access_ptr) (uint32_t addr, uint8_t burst_size, uint8_t type, uint8_t width, uint8_t level, uint16_t timing) = NULL;
+WSIM_TLS void (*etracer_slot_event_ptr)  (uint8_t periph_id, uint8_t event_id, uint8_t arg, uint8_t skew) = NULL;
+WSIM_TLS void (*etracer_slot_set_pc_ptr) (uint32_t pc) = NULL;
+WSIM_TLS void (*etracer_slot_set_ns_ptr) () = NULL;
+WSIM_TLS void (*etracer_slot_end_ptr)    (int timing) = NULL;
+
 #if defined(ETRACE)
 
 #include "etrace.h"
@@ -73,37 +85,33 @@ struct libetracer_data_t {
  int                  next_must_be_NS;
 };
 
-static int                         libetracer_init = 0;
+static WSIM_TLS int                         libetracer_init = 0;
+
+static WSIM_TLS trace_config_t              libetracer_conf;
+static WSIM_TLS etrace_t                    libetracer_handler;
+static WSIM_TLS trace_slot_t               *libetracer_slot;
+static WSIM_TLS trace_slot_t               *libetracer_slot_bkp;
+static WSIM_TLS struct libetracer_data_t    libetracer_current;
+static WSIM_TLS struct libetracer_data_t    libetracer_backup;
 
-static trace_config_t              libetracer_conf;
-static etrace_t                    libetracer_handler;
-static trace_slot_t               *libetracer_slot;
-static trace_slot_t               *libetracer_slot_bkp;
-static struct libetracer_data_t    libetracer_current;
-static struct libetracer_data_t    libetracer_backup;
+static WSIM_TLS enum wsens_mode_t           libtracer_ws_mode;
 
-static enum wsens_mode_t           libtracer_ws_mode;
+WSIM_TLS int etracer_running = 0;
 
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
 
-       void (*etracer_slot_insn_ptr)    (uint32_t pc, uint8_t class, uint16_t cycles, uint8_t non_seq, uint16_t ret_addr, uint8_t b_type, uint8_t except, uint8_t reti);
 static void etracer_slot_insn_internal  (uint32_t pc, uint8_t class, uint16_t cycles, uint8_t non_seq, uint16_t ret_addr, uint8_t b_type, uint8_t except, uint8_t reti);
 
-       void (*etracer_slot_access_ptr)  (uint32_t addr, uint8_t burst_size, uint8_t type, uint8_t width, uint8_t level, uint16_t timing);
 static void etracer_slot_access_internal(uint32_t addr, uint8_t burst_size, uint8_t type, uint8_t width, uint8_t level, uint16_t timing);
 
-       void (*etracer_slot_event_ptr)   (uint8_t periph_id, uint8_t event_id, uint8_t arg, uint8_t skew);
 static void etracer_slot_event_internal (uint8_t periph_id, uint8_t event_id, uint8_t arg, uint8_t skew);
 
-       void (*etracer_slot_set_pc_ptr)  (uint32_t pc);
 static void etracer_slot_set_pc_internal(uint32_t pc);
 
-       void (*etracer_slot_set_ns_ptr)  ();
 static void etracer_slot_set_ns_internal();
 
-       void (*etracer_slot_end_ptr)     (int timing);
 static void etracer_slot_end_internal   (int timing);
 
 /* ************************************************** */
@@ -138,8 +146,8 @@ void etracer_init(char *filename, int ws_mode)
 /* ************************************************** */
 /* ************************************************** */
 
-static uint64_t cumul = 0;
-static uint64_t slots = 0;
+static WSIM_TLS uint64_t cumul = 0;
+static WSIM_TLS uint64_t slots = 0;
 
 void etracer_close(void)
 {
@@ -168,6 +176,7 @@ void etracer_start(void)
 
       libetracer_current.stopped         = 0;
       libetracer_current.next_must_be_NS = 1;
+      etracer_running                    = 1;
       DMSG_ETRACER ("etracer: start ok\n");
     }
   else
@@ -195,6 +204,7 @@ void etracer_stop(void)
 
       libetracer_current.stopped         = 1;
       libetracer_current.next_must_be_NS = 1;
+      etracer_running                    = 0;
       DMSG_ETRACER ("etracer: stopped ok\n");
       WARNING("etracer: etracer_stop()\n");
     }
@@ -353,12 +363,4 @@ void etracer_state_restore(void)
 /* ************************************************** */
 /* ************************************************** */
 
-#else /* defined(ETRACE) */
-
-/* this function is left so that libetrace.a is not empty */
-int libetrace_empty_stub(int a)
-{
-  return a*a+1;
-}
-
-#endif
+#endif /* defined(ETRACE) */
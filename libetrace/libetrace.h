@@ -11,8 +11,14 @@
 
 #include <stdint.h>
 #include "config.h"
+#include "arch/common/debug.h"
+
+/**
+ * The slot stream is produced by the mcu and devices models. It is
+ * consumed either by the eSimu tracer when built with --enable-etrace
+ * or by the built-in energy accountant, see energy.h
+ **/
 
-#if defined(ETRACE)
 /* ************************************************** */
 /* ************************************************** */
 
@@ -123,19 +129,6 @@
 /* ************************************************** */
 /* ************************************************** */
 
-/**
- * etracer creation
- */
-void etracer_init          (char* filename, int ws_mode);
-void etracer_close         (void);
-
-/**
- *
- */
-void etracer_start         (void);
-void etracer_stop          (void);
-
-
 /*
  * pc         : current pc
  * class      : insn class 
@@ -144,7 +137,7 @@ void etracer_stop          (void);
  * ret_addr   : next pc 
  * b_type     : branch type (BRANCH_JUMP / BRANCH_CALL)
  */
-extern void (*etracer_slot_insn_ptr)(uint32_t pc, uint8_t class, uint16_t cycles, 
+extern WSIM_TLS void (*etracer_slot_insn_ptr)(uint32_t pc, uint8_t class, uint16_t cycles, 
 				     uint8_t non_seq, uint16_t ret_addr, 
 				     uint8_t b_type, uint8_t except, uint8_t reti);
 #define etracer_slot_insn(pc,class,cycles,non_seq,ret_addr,b_type,except,reti)  \
@@ -161,7 +154,7 @@ do {
  * level      : 1
  * timing     : 0 for Flash & RAM
  */
-extern void (*etracer_slot_access_ptr)(uint32_t addr, uint8_t burst_size, uint8_t type, 
+extern WSIM_TLS void (*etracer_slot_access_ptr)(uint32_t addr, uint8_t burst_size, uint8_t type, 
 				       uint8_t width, uint8_t level, uint16_t timing);
 #define etracer_slot_access(addr,burst_size,type,width,level,timing)  \
 do {                                                                  \
@@ -175,7 +168,7 @@ do {                                                                  \
  * event_id   : 
  * skew       : time shift from beginning of slot
  */
-extern void (*etracer_slot_event_ptr)(uint8_t periph_id, uint8_t event_id, uint8_t arg, uint8_t skew);
+extern WSIM_TLS void (*etracer_slot_event_ptr)(uint8_t periph_id, uint8_t event_id, uint8_t arg, uint8_t skew);
 #define etracer_slot_event(periph_id,event_id,arg,skew)               \
 do {                                                                  \
   if (etracer_slot_event_ptr != NULL)                                 \
@@ -188,14 +181,14 @@ do {                                                                  \
  * event_id   : 
  * skew       : time shift from beginning of slot
  */
-extern void (*etracer_slot_set_pc_ptr)(uint32_t pc);
+extern WSIM_TLS void (*etracer_slot_set_pc_ptr)(uint32_t pc);
 #define etracer_slot_set_pc(pc)                                       \
 do {                                                                  \
   if (etracer_slot_set_pc_ptr != NULL)                                \
     etracer_slot_set_pc_ptr(pc);                                      \
 } while(0)
 
-extern void (*etracer_slot_set_ns_ptr)();
+extern WSIM_TLS void (*etracer_slot_set_ns_ptr)();
 #define etracer_slot_set_ns()                                         \
 do {                                                                  \
   if (etracer_slot_set_ns_ptr != NULL)                                \
@@ -206,13 +199,39 @@ do {                                                                  \
 /*
  * end slot 
  */
-extern void (*etracer_slot_end_ptr)(int timing);
+extern WSIM_TLS void (*etracer_slot_end_ptr)(int timing);
 #define etracer_slot_end(timing)                                      \
 do {                                                                  \
   if (etracer_slot_end_ptr != NULL)                                   \
     etracer_slot_end_ptr(timing);                                     \
 } while(0)
 
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#if defined(ETRACE)
+
+/**
+ * etracer creation
+ */
+void etracer_init          (char* filename, int ws_mode);
+void etracer_close         (void);
+
+/**
+ *
+ */
+void etracer_start         (void);
+void etracer_stop          (void);
+
+
+/*
+ * eSimu needs one slot per instruction, lpm fast-forward is disabled
+ * while it is running
+ */
+extern WSIM_TLS int etracer_running;
+#define etracer_is_enabled() (etracer_running)
+
 
 /* 
  * state save/restore for machine backtracks
@@ -228,13 +247,7 @@ void etracer_state_restore (void);
 
 #define etracer_init(x...)        NOOP
 #define etracer_close()           NOOP
-
-#define etracer_slot_insn(x...)   NOOP
-#define etracer_slot_access(x...) NOOP
-#define etracer_slot_event(x...)  NOOP
-#define etracer_slot_set_pc(x...) NOOP
-#define etracer_slot_set_ns()     NOOP
-#define etracer_slot_end(x...)    NOOP
+#define etracer_is_enabled()      0
 
 #define etracer_start()           NOOP
 #define etracer_stop()            NOOP
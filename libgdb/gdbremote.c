@@ -298,6 +298,18 @@ gdbremote_general_query_packet(struct gdbremote_t *gdb, char* buffer, int UNUSED
     {
       DONT_SUPPORT;
     }
+  else if (strcmp(token,"Supported") == 0)
+    {
+      /* reverse execution uses the checkpoint ring */
+      if (machine_checkpoint.max > 0)
+	{
+	  gdbremote_putpacket(gdb,"ReverseStep+;ReverseContinue+");
+	}
+      else
+	{
+	  DONT_SUPPORT;
+	}
+    }
   else if (strcmp(token,"fThreadInfo") == 0)
     {
       /* thread list */
@@ -397,6 +409,7 @@ gdbremote_write_memory(struct gdbremote_t *gdb, char *buffer, int UNUSED size)
       hexb[1] = *token++;
       byte = strtol(hexb,NULL,16);
       mcu_jtag_write_byte(addr + i, byte);
+      machine_checkpoint_debug_write(addr + i);
     }
   gdbremote_putpacket(gdb,"OK");
 }
@@ -713,6 +726,56 @@ gdbremote_single_step(struct gdbremote_t *gdb, char *buffer, int UNUSED size)
 /* ************************************************** */
 /* ************************************************** */
 
+static void
+gdbremote_reverse(struct gdbremote_t *gdb, char *buffer, int UNUSED size)
+{
+  int ret;
+
+  if (machine_checkpoint.max == 0)
+    {
+      DONT_SUPPORT;
+      return;
+    }
+
+  switch (buffer[1])
+    {
+    case 's': /* reverse step */
+      DMSG_LIB_GDB("gdbremote: reverse step at PC 0x%04x\n",mcu_get_pc());
+      ret = (mcu_get_insn() > 0) ? machine_checkpoint_goto_insn(mcu_get_insn() - 1) : -1;
+      break;
+    case 'c': /* reverse continue */
+      DMSG_LIB_GDB("gdbremote: reverse continue at PC 0x%04x\n",mcu_get_pc());
+      ret = machine_checkpoint_reverse_continue();
+      break;
+    default:
+      DONT_SUPPORT;
+      return;
+    }
+
+  DMSG_LIB_GDB("gdbremote: exit reverse at 0x%04x with signal = 0x%x (%s)\n",
+	   mcu_get_pc(),mcu_signal_get(),mcu_signal_str());
+
+  mcu_signal_remove(SIG_MCU_ALL);
+  mcu_signal_remove(SIG_MCU    );
+  mcu_signal_remove(SIG_MAC    );
+  mcu_signal_remove(MAC_TO_SIG(MAC_ALL));
+  gdb->last_signal = SIG_MCU_TRAP;
+
+  if (ret == -1)
+    {
+      /* start of the recorded history */
+      gdbremote_putpacket(gdb,"T05replaylog:begin;");
+    }
+  else
+    {
+      gdbremote_stop_reply_packet(gdb);
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 static void
 gdbremote_step_with_signal(struct gdbremote_t *gdb, char UNUSED *buffer, int UNUSED size)
 {
@@ -928,6 +991,11 @@ gdbremote_getcmd(struct gdbremote_t *gdb)
       gdbremote_single_step(gdb,buffer,size);
       break;
 
+    case 'b': /* bs, bc : reverse step and continue */
+      DMSG_LIB_GDB_CMD("GDB:     ** reverse execution **\n");
+      gdbremote_reverse(gdb,buffer,size);
+      break;
+
     case 'g': /* read general registers */
       DMSG_LIB_GDB_CMD("GDB:     read general registers\n");
       gdbremote_read_registers(gdb);
@@ -48,7 +48,8 @@ void ui_backend_delete(void UNUSED *ptr)
 /**************************************************/
 /**************************************************/
  
-int ui_backend_framebuffer_blit(void UNUSED *ptr, uint8_t UNUSED *fb)
+int ui_backend_framebuffer_blit(void UNUSED *ptr, uint8_t UNUSED *fb,
+				int UNUSED x, int UNUSED y, int UNUSED w, int UNUSED h)
 {
   return UI_OK;
 }
@@ -75,7 +76,7 @@ int ui_backend_unlock(void UNUSED *ptr)
 /**************************************************/
 /**************************************************/
 
-int ui_backend_update(void UNUSED *ptr)
+int ui_backend_update(void UNUSED *ptr, int UNUSED x, int UNUSED y, int UNUSED w, int UNUSED h)
 {
   return 0;
 }
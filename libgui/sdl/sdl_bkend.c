@@ -146,7 +146,7 @@ void ui_backend_delete(void* sdl_screen)
 /**************************************************/
 /**************************************************/
  
-int ui_backend_framebuffer_blit(void *sdl_ptr, uint8_t *fb)
+int ui_backend_framebuffer_blit(void *sdl_ptr, uint8_t *fb, int x, int y, int width, int height)
 {
   int w, h, idx_pixl, idx_buff;
   Uint8 *buffer;
@@ -155,12 +155,12 @@ int ui_backend_framebuffer_blit(void *sdl_ptr, uint8_t *fb)
   sdl_screen = (SDL_Surface*)sdl_ptr;
   buffer=(Uint8 *)sdl_screen->pixels;
 
-  for(h=0; h < sdl_screen->h; h++)
+  for(h=y; h < y + height; h++)
     {
-      idx_pixl =  h * sdl_screen->pitch;
-      idx_buff =  h * sdl_screen->w * 3;
+      idx_pixl =  h * sdl_screen->pitch + x * 3;
+      idx_buff = (h * sdl_screen->w + x) * 3;
       
-      for(w=0; w < sdl_screen->w; w++)
+      for(w=x; w < x + width; w++)
 	{
 	  /* idx_buff = (h * GUI_DATA_BKTRK.width + w) * 3 ;     */
 	  /* idx_pixl =  h * GUI_DATA.sdl_screen->pitch + w * 3; */
@@ -203,11 +203,11 @@ int ui_backend_unlock(void* sdl_ptr)
 /**************************************************/
 /**************************************************/
 
-int ui_backend_update(void* sdl_ptr)
+int ui_backend_update(void* sdl_ptr, int x, int y, int w, int h)
 {
   SDL_Surface *sdl_screen;
   sdl_screen = (SDL_Surface*)sdl_ptr;
-  SDL_UpdateRect(sdl_screen, 0, 0, 0, 0);
+  SDL_UpdateRect(sdl_screen, x, y, w, h);
   return 0;
 }
 
@@ -17,6 +17,21 @@
 #include "ui.h"
 #include "ui_bkend.h"
 
+/*
+ * The X11 backend is driven by a render thread. Win32 and SDL windows
+ * must be serviced by the thread that created them, these backends are
+ * updated from the simulation loop.
+ */
+#if defined(HAVE_PTHREAD_H) && (defined(GUI_X11) || defined(GUI_NONE))
+#define UI_RENDER_THREAD 1
+#endif
+
+#if defined(UI_RENDER_THREAD)
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#endif
+
 /**************************************************/
 /**************************************************/
 /**************************************************/
@@ -27,6 +42,59 @@
 #define EVENT_FIFO_SIZE    0xff
 #define LOOP_SKIP_COUNTER 50000
 
+#define UI_FPS_DEFAULT        30
+#define UI_EVENTS_PER_FRAME   16
+
+#if defined(UI_RENDER_THREAD)
+
+/*
+ * The simulation draws in machine.ui.framebuffer. Once per frame the
+ * render thread sets UI_RENDER_REQUEST, the next ui_refresh() copies
+ * the rectangle that changed since the previous frame to the front
+ * buffer. The render thread blits this rectangle to the backend and
+ * polls backend events, events go back to the simulation through a
+ * single producer / single consumer ring.
+ */
+
+#define UI_RENDER_REQUEST  0x1
+#define UI_RENDER_QUIT     0x2
+
+#define UI_RING_SIZE       64
+
+struct ui_event_t {
+  int           evt;
+  uint32_t      b_up;
+  uint32_t      b_down;
+};
+
+struct ui_render_t {
+  pthread_t         thread;
+  pthread_mutex_t   lock;
+  pthread_cond_t    wake;        /* signaled on stop             */
+  void             *backend;
+  int               mustlock;
+  int               width;
+  int               height;
+  long              period;      /* ns */
+
+  /* front buffer and pending rectangle, protected by lock */
+  uint8_t          *front;
+  int               x0, y0, x1, y1;
+
+  uint32_t          flags;       /* UI_RENDER_ flags, atomic     */
+  int               stop;        /* atomic                       */
+
+  struct ui_event_t ring[UI_RING_SIZE];
+  uint32_t          head;        /* written by the render thread */
+  uint32_t          tail;        /* written by the simulation    */
+
+  /* statistics */
+  uint32_t          frames;
+  uint32_t          publishes;
+  uint32_t          dropped;
+};
+#endif
+
 struct ui_internal_t {
   void *        backend;
   int           mustlock;
@@ -36,9 +104,14 @@ struct ui_internal_t {
   int           e_rptr;
   int           e_wptr;
   int           e_state;
+
+#if defined(UI_RENDER_THREAD)
+  struct ui_render_t *render;
+  int                 dirty;
+#endif
 };
 
-static struct ui_internal_t ui;
+static WSIM_TLS struct ui_internal_t ui;
 
 #define GUI_DATA_INTERNAL  ui
 #define GUI_DATA_MACHINE   machine.ui
@@ -61,6 +134,13 @@ static struct moption_t title_opt = {
   .value       = NULL
 };
 
+static struct moption_t fps_opt = {
+  .longname    = "ui_fps",
+  .type        = required_argument,
+  .helpstring  = "GUI refresh rate (frames/s)",
+  .value       = NULL
+};
+
 /**************************************************/
 /**************************************************/
 /**************************************************/
@@ -69,16 +149,33 @@ int ui_options_add(void)
 {
   options_add(& gui_opt            );
   options_add(& title_opt          );
+  options_add(& fps_opt            );
   return 0;
 }
 
+int ui_options_display(void)
+{
+  return gui_opt.isset;
+}
+
 /**************************************************/
 /**************************************************/
 /**************************************************/
 
+static int ui_fps = UI_FPS_DEFAULT;
+
 static int ui_option_validate(void)
 {
   GUI_DATA_INTERNAL.display_on = gui_opt.isset;
+  if (fps_opt.isset && (fps_opt.value != NULL))
+    {
+      ui_fps = atoi(fps_opt.value);
+      if ((ui_fps <= 0) || (ui_fps > 1000))
+	{
+	  ERROR("wsim:ui: --ui_fps must be in [1,1000], using %d\n",UI_FPS_DEFAULT);
+	  ui_fps = UI_FPS_DEFAULT;
+	}
+    }
   return UI_OK;
 }
 
@@ -86,6 +183,218 @@ static int ui_option_validate(void)
 /**************************************************/
 /**************************************************/
 
+#if defined(UI_RENDER_THREAD)
+
+static void ui_render_frame(struct ui_render_t *r)
+{
+  int x = 0, y = 0, w = 0, h = 0;
+
+  pthread_mutex_lock(&r->lock);
+  if (r->x1 > r->x0)
+    {
+      x = r->x0;
+      y = r->y0;
+      w = r->x1 - r->x0;
+      h = r->y1 - r->y0;
+      if ((r->mustlock == 0) || (ui_backend_lock(r->backend) >= 0))
+	{
+	  ui_backend_framebuffer_blit(r->backend, r->front, x, y, w, h);
+	  if (r->mustlock)
+	    {
+	      ui_backend_unlock(r->backend);
+	    }
+	}
+      r->x0 = r->width;
+      r->y0 = r->height;
+      r->x1 = 0;
+      r->y1 = 0;
+    }
+  pthread_mutex_unlock(&r->lock);
+
+  if (w > 0)
+    {
+      ui_backend_update(r->backend, x, y, w, h);
+      r->frames ++;
+    }
+}
+
+/**************************************************/
+/**************************************************/
+/**************************************************/
+
+static void ui_render_events(struct ui_render_t *r)
+{
+  int i;
+  for(i=0; i < UI_EVENTS_PER_FRAME; i++)
+    {
+      uint32_t head;
+      struct ui_event_t e;
+
+      e.b_up   = 0;
+      e.b_down = 0;
+      e.evt    = ui_backend_getevent(r->backend, &e.b_up, &e.b_down);
+      if (e.evt == UI_EVENT_NONE)
+	continue;
+
+      if (e.evt == UI_EVENT_QUIT)
+	{
+	  __atomic_or_fetch(&r->flags, UI_RENDER_QUIT, __ATOMIC_RELEASE);
+	}
+
+      head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+      if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == UI_RING_SIZE)
+	{
+	  r->dropped ++;
+	  continue;
+	}
+      r->ring[head % UI_RING_SIZE] = e;
+      __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+    }
+}
+
+/**************************************************/
+/**************************************************/
+/**************************************************/
+
+static void* ui_render_main(void *ptr)
+{
+  struct ui_render_t *r = (struct ui_render_t*)ptr;
+  struct timespec next;
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  while (__atomic_load_n(&r->stop, __ATOMIC_ACQUIRE) == 0)
+    {
+      ui_render_frame(r);
+      __atomic_or_fetch(&r->flags, UI_RENDER_REQUEST, __ATOMIC_RELEASE);
+      ui_render_events(r);
+
+      next.tv_nsec += r->period;
+      while (next.tv_nsec >= 1000*1000*1000)
+	{
+	  next.tv_nsec -= 1000*1000*1000;
+	  next.tv_sec  += 1;
+	}
+      pthread_mutex_lock(&r->lock);
+      while ((__atomic_load_n(&r->stop, __ATOMIC_ACQUIRE) == 0) &&
+	     (pthread_cond_timedwait(&r->wake, &r->lock, &next) != ETIMEDOUT))
+	;
+      pthread_mutex_unlock(&r->lock);
+    }
+  return NULL;
+}
+
+/**************************************************/
+/**************************************************/
+/**************************************************/
+
+static struct ui_render_t* ui_render_start(void *backend, int mustlock, int w, int h)
+{
+  struct ui_render_t *r;
+  pthread_condattr_t  attr;
+
+  if ((r = (struct ui_render_t*)calloc(1, sizeof(struct ui_render_t))) == NULL)
+    {
+      return NULL;
+    }
+  if ((r->front = (uint8_t*)calloc(1, w * h * 3)) == NULL)
+    {
+      free(r);
+      return NULL;
+    }
+
+  r->backend  = backend;
+  r->mustlock = mustlock;
+  r->width    = w;
+  r->height   = h;
+  r->period   = 1000*1000*1000 / ui_fps;
+  /* the first frame is a full blit */
+  r->x0       = 0;
+  r->y0       = 0;
+  r->x1       = w;
+  r->y1       = h;
+  pthread_mutex_init(&r->lock, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&r->wake, &attr);
+  pthread_condattr_destroy(&attr);
+
+  if (pthread_create(&r->thread, NULL, ui_render_main, r) != 0)
+    {
+      pthread_cond_destroy(&r->wake);
+      pthread_mutex_destroy(&r->lock);
+      free(r->front);
+      free(r);
+      return NULL;
+    }
+  return r;
+}
+
+/**************************************************/
+/**************************************************/
+/**************************************************/
+
+static void ui_render_stop(struct ui_render_t *r)
+{
+  pthread_mutex_lock(&r->lock);
+  __atomic_store_n(&r->stop, 1, __ATOMIC_RELEASE);
+  pthread_cond_signal(&r->wake);
+  pthread_mutex_unlock(&r->lock);
+  pthread_join(r->thread, NULL);
+  DMSG_LIB_UI("wsim:ui: %d frames, %d publishes, %d events dropped\n",
+	      r->frames, r->publishes, r->dropped);
+  pthread_cond_destroy(&r->wake);
+  pthread_mutex_destroy(&r->lock);
+  free(r->front);
+  free(r);
+}
+
+/**************************************************/
+/**************************************************/
+/**************************************************/
+
+/**
+ * copy the rectangle that changed since the last publish to the front
+ * buffer, called from the simulation when the render thread asks for a
+ * frame
+ **/
+static void ui_render_publish(struct ui_render_t *r, uint8_t *fb)
+{
+  int y;
+  int stride = r->width * 3;
+
+  pthread_mutex_lock(&r->lock);
+  for(y=0; y < r->height; y++)
+    {
+      int first, last;
+      uint8_t *src = fb       + y * stride;
+      uint8_t *dst = r->front + y * stride;
+
+      if (memcmp(src, dst, stride) == 0)
+	continue;
+
+      for(first = 0; src[first] == dst[first]; first ++)
+	;
+      for(last = stride - 1; src[last] == dst[last]; last --)
+	;
+      first = first / 3;
+      last  = last  / 3 + 1;
+      memcpy(dst + first * 3, src + first * 3, (last - first) * 3);
+
+      if (first < r->x0) r->x0 = first;
+      if (last  > r->x1) r->x1 = last;
+      if (y     < r->y0) r->y0 = y;
+      if (y + 1 > r->y1) r->y1 = y + 1;
+    }
+  pthread_mutex_unlock(&r->lock);
+  r->publishes ++;
+}
+
+#endif /* UI_RENDER_THREAD */
+
+/**************************************************/
+/**************************************************/
+/**************************************************/
+
 int ui_create(int w, int h, int id)
 {
   GUI_DATA_INTERNAL.backend     = NULL;
@@ -133,6 +442,15 @@ int ui_create(int w, int h, int id)
   GUI_DATA_INTERNAL.e_wptr  = 0;
   GUI_DATA_INTERNAL.e_state = 0;
 
+#if defined(UI_RENDER_THREAD)
+  GUI_DATA_INTERNAL.dirty   = 1;
+  GUI_DATA_INTERNAL.render  = ui_render_start(GUI_DATA_INTERNAL.backend, GUI_DATA_INTERNAL.mustlock, w, h);
+  if (GUI_DATA_INTERNAL.render == NULL)
+    {
+      WARNING("wsim:ui: cannot start render thread, refresh from simulation\n");
+    }
+#endif
+
   return UI_OK;
 }
 
@@ -143,6 +461,13 @@ int ui_create(int w, int h, int id)
 
 void ui_delete(void)
 {
+#if defined(UI_RENDER_THREAD)
+  if (GUI_DATA_INTERNAL.render != NULL)
+    {
+      ui_render_stop(GUI_DATA_INTERNAL.render);
+      GUI_DATA_INTERNAL.render = NULL;
+    }
+#endif
   if (GUI_DATA_INTERNAL.backend != NULL)
     {
       ui_backend_delete(GUI_DATA_INTERNAL.backend);
@@ -156,29 +481,59 @@ void ui_delete(void)
 int ui_refresh(int modified)
 {
   uint8_t *fb;
-  static int loop = 0;
+  static WSIM_TLS int loop = 0;
 
   if (GUI_DATA_INTERNAL.display_on == 0)
     {
       return UI_OK;
     }
 
+#if defined(UI_RENDER_THREAD)
+  if (GUI_DATA_INTERNAL.render != NULL)
+    {
+      struct ui_render_t *r = GUI_DATA_INTERNAL.render;
+      uint32_t flags;
+
+      GUI_DATA_INTERNAL.dirty |= modified;
+      flags = __atomic_load_n(&r->flags, __ATOMIC_ACQUIRE);
+      if (flags == 0)
+	{
+	  return UI_OK;
+	}
+      if (flags & UI_RENDER_QUIT)
+	{
+	  __atomic_and_fetch(&r->flags, ~UI_RENDER_QUIT, __ATOMIC_RELAXED);
+	  mcu_signal_add(SIG_HOST | SIGTERM);
+	}
+      if ((flags & UI_RENDER_REQUEST) && GUI_DATA_INTERNAL.dirty)
+	{
+	  __atomic_and_fetch(&r->flags, ~UI_RENDER_REQUEST, __ATOMIC_RELAXED);
+	  ui_render_publish(r, GUI_DATA_MACHINE.framebuffer);
+	  GUI_DATA_INTERNAL.dirty = 0;
+	}
+      return UI_OK;
+    }
+#endif
+
   if (modified)
     {
+      int w = GUI_DATA_MACHINE.width;
+      int h = GUI_DATA_MACHINE.height;
+
       if (GUI_DATA_INTERNAL.mustlock &&  ui_backend_lock(GUI_DATA_INTERNAL.backend) < 0)
 	{
 	  return UI_ERROR;
 	}
       
       fb = GUI_DATA_MACHINE.framebuffer;
-      ui_backend_framebuffer_blit(GUI_DATA_INTERNAL.backend, fb);
+      ui_backend_framebuffer_blit(GUI_DATA_INTERNAL.backend, fb, 0, 0, w, h);
 
       if (GUI_DATA_INTERNAL.mustlock)
 	{
 	  ui_backend_unlock(GUI_DATA_INTERNAL.backend);
 	}
 
-      ui_backend_update(GUI_DATA_INTERNAL.backend);
+      ui_backend_update(GUI_DATA_INTERNAL.backend, 0, 0, w, h);
     }
 
   if (loop == LOOP_SKIP_COUNTER)
@@ -198,10 +553,24 @@ int ui_refresh(int modified)
 int ui_event_process(void)
 {
   int evt;
+
+#if defined(UI_RENDER_THREAD)
+  /* backend events are polled by the render thread */
+  if (GUI_DATA_INTERNAL.render != NULL)
+    {
+      return UI_OK;
+    }
+#endif
+
   evt = ui_backend_getevent(GUI_DATA_INTERNAL.backend,
 			    &GUI_DATA_MACHINE.b_up,
 			    &GUI_DATA_MACHINE.b_down);
 
+  if (evt == UI_EVENT_QUIT)
+    {
+      mcu_signal_add(SIG_HOST | SIGTERM);
+    }
+
   if (evt != UI_EVENT_NONE)
     {
       if (GUI_DATA_INTERNAL.e_wptr != EVENT_FIFO_SIZE)
@@ -228,6 +597,24 @@ int ui_getevent(void)
       return UI_EVENT_NONE;
     }
 
+#if defined(UI_RENDER_THREAD)
+  if (GUI_DATA_INTERNAL.render != NULL)
+    {
+      struct ui_render_t *r = GUI_DATA_INTERNAL.render;
+      uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+
+      if (tail != __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))
+	{
+	  struct ui_event_t *e = & r->ring[tail % UI_RING_SIZE];
+	  ret = e->evt;
+	  GUI_DATA_MACHINE.b_up   = e->b_up;
+	  GUI_DATA_MACHINE.b_down = e->b_down;
+	  __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+	}
+      return ret;
+    }
+#endif
+
   if (GUI_DATA_INTERNAL.e_state)
     {
       ret = GUI_DATA_INTERNAL.e_fifo[ GUI_DATA_INTERNAL.e_rptr ];
@@ -90,6 +90,7 @@ struct ui_t
 #if defined(GUI)
 
 int  ui_options_add   (void);
+int  ui_options_display (void);
 int  ui_create        (int w, int h, int id);
 void ui_delete        (void);
 int  ui_refresh       (int modified);
@@ -107,6 +108,7 @@ void ui_default_input (char* name);
 #define UNUSED __attribute__((unused))
 
 static inline int  ui_options_add (void) { return 0;             }
+static inline int  ui_options_display (void) { return 0;         }
 static inline int  ui_create      (int UNUSED w, int UNUSED h, int UNUSED id) { return UI_OK; }
 static inline void ui_delete      (void) { return ;              }
 static inline int  ui_refresh     (int UNUSED r) { return UI_OK;         }
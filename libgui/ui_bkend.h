@@ -15,8 +15,9 @@ void  ui_backend_delete           (void*);
 int   ui_backend_lock             (void*);
 int   ui_backend_unlock           (void*);
 
-int   ui_backend_framebuffer_blit (void*, uint8_t* fb);
-int   ui_backend_update           (void*);
+/* fb is the whole framebuffer, only the (x,y,w,h) rectangle is copied or shown */
+int   ui_backend_framebuffer_blit (void*, uint8_t* fb, int x, int y, int w, int h);
+int   ui_backend_update           (void*, int x, int y, int w, int h);
 
 int   ui_backend_getevent         (void*, uint32_t *b_up, uint32_t* b_down);
 #endif
@@ -33,6 +33,7 @@ struct win_display_t {
   HBITMAP     hbitmap;
   HDC         MemDC;
   int         width,height,depth;
+  int         quit;    /* window closed, reported by getevent */
 };
 
 static struct win_display_t win_display;
@@ -171,16 +172,16 @@ void ui_backend_delete(void *ptr)
 /**************************************************/
 /**************************************************/
  
-int ui_backend_framebuffer_blit(void *ptr, uint8_t *fb)
+int ui_backend_framebuffer_blit(void *ptr, uint8_t *fb, int x, int y, int width, int height)
 {
   int w,h;
   int idx_buff;
   struct win_display_t *win = (struct win_display_t*)ptr;
 
-  for(h=0; h < win->height; h++)
+  for(h=y; h < y + height; h++)
     {
-      idx_buff =  h * win->width * 3;
-      for(w=0; w < win->width; w++)
+      idx_buff = (h * win->width + x) * 3;
+      for(w=x; w < x + width; w++)
 	{
 	  COLORREF rgbval = RGB(
 			    (fb[idx_buff + 2]),
@@ -219,11 +220,16 @@ int ui_backend_unlock(void UNUSED *ptr)
 /**************************************************/
 /**************************************************/
 
-int ui_backend_update(void *ptr)
+int ui_backend_update(void *ptr, int x, int y, int w, int h)
 {
   struct win_display_t *win = (struct win_display_t*)ptr;
+  RECT rect;
 
-  InvalidateRect (win->hWnd,0,0);
+  rect.left   = x;
+  rect.top    = y;
+  rect.right  = x + w;
+  rect.bottom = y + h;
+  InvalidateRect (win->hWnd,&rect,0);
   UpdateWindow   (win->hWnd    );
   return 0;
 }
@@ -298,6 +304,12 @@ int ui_backend_getevent(void *ptr, uint32_t *b_up, uint32_t* b_down)
 	}
     }
 
+  /* close messages are handled by the window procedure */
+  if (win->quit)
+    {
+      win->quit = 0;
+      ret = UI_EVENT_QUIT;
+    }
   return ret;
 }
 
@@ -321,12 +333,13 @@ LRESULT CALLBACK WndProcedure(HWND hWnd, UINT Msg, WPARAM wParam, LPARAM lParam)
       }
       break;
 
+    /* events are read by the render thread, ui.c stops the simulation */
     case WM_CLOSE:
-      mcu_signal_add(SIG_HOST | SIGTERM);
+      win_display.quit = 1;
       break;
 
     case WM_DESTROY:
-      mcu_signal_add(SIG_HOST | SIGTERM);
+      win_display.quit = 1;
       break;
 
     default:
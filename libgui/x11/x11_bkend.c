@@ -180,17 +180,17 @@ void ui_backend_delete(void *ptr)
 /**************************************************/
 /**************************************************/
  
-int ui_backend_framebuffer_blit(void *ptr, uint8_t *fb)
+int ui_backend_framebuffer_blit(void *ptr, uint8_t *fb, int x, int y, int width, int height)
 {
   int w,h;
   int idx_buff;
   struct x11_display_t *x11 = (struct x11_display_t*)ptr;
   
-  for(h=0; h < x11->height; h++)
+  for(h=y; h < y + height; h++)
     {
-      idx_buff =  h * x11->width * 3;
+      idx_buff = (h * x11->width + x) * 3;
       
-      for(w=0; w < x11->width; w++)
+      for(w=x; w < x + width; w++)
 	{
 	  unsigned int color = 
 	    (fb[idx_buff + 2] << 16) | 
@@ -229,13 +229,14 @@ int ui_backend_unlock(void UNUSED *ptr)
 /**************************************************/
 /**************************************************/
 
-int ui_backend_update(void *ptr)
+int ui_backend_update(void *ptr, int x, int y, int w, int h)
 {
   struct x11_display_t *x11 = (struct x11_display_t*)ptr;
   XPutImage(x11->display, x11->window, x11->gc, x11->ximage, 
-	    0, 0,                     // src
-	    0, 0,                     // dst
-	    x11->width, x11->height); // size
+	    x, y,                     // src
+	    x, y,                     // dst
+	    w, h);                    // size
+  XFlush(x11->display);
   return 0;
 }
 
@@ -326,16 +327,15 @@ int ui_backend_getevent(void *ptr, uint32_t *b_up, uint32_t* b_down)
       }
       break;
 
+    /* events are read by the render thread, ui.c stops the simulation */
     case ClientMessage:
       if ((unsigned)(event.xclient.data.l[0]) == x11->wmDeleteMessage)
 	{
-	  mcu_signal_add(SIG_HOST | SIGTERM);
 	  ret = UI_EVENT_QUIT;
 	}
       break;
 	    
     case DestroyNotify:
-      mcu_signal_add(SIG_HOST | SIGTERM);
       ret = UI_EVENT_QUIT;
       break;
 
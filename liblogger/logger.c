@@ -11,6 +11,10 @@
 #include <unistd.h>
 #include <string.h>
 
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+#include "arch/common/debug.h"
 #include "logger.h"
 
 #define DEFAULT_LOGFILE      stdout
@@ -18,8 +22,8 @@
 
 #define MAXFILENAME 500
 
-static char  logger_filename[MAXFILENAME];
-static FILE* logger_logfile;
+static WSIM_TLS char  logger_filename[MAXFILENAME];
+static WSIM_TLS FILE* logger_logfile;
 int logger_verbose_level = -1;
 
 #define UNUSED __attribute__((unused))
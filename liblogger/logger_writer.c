@@ -0,0 +1,425 @@
+/**
+ *  \file   logger_writer.c
+ *  \brief  Output buffers and background writer for simulation logs
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <signal.h>
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+#include "arch/common/debug.h"
+#include "logger.h"
+#include "logger_writer.h"
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_SEMAPHORE_H)
+#define LOGGER_WRITER_THREAD 1
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+/* ************************************************** */
+/* ************************************************** */
+
+#define DEBUG_LOGGER_WRITER 0
+
+#if DEBUG_LOGGER_WRITER != 0
+#define WRITER_DBG(x...) DMSG_LIB(x)
+#else
+#define WRITER_DBG(x...) do { } while (0)
+#endif
+
+#define LOGGER_BUFFER_MIN 4096
+
+/* ************************************************** */
+/* ************************************************** */
+
+int logger_buffer_alloc(struct logger_buffer_t *buf, uint32_t size)
+{
+  uint32_t max = buf->max ? buf->max : LOGGER_BUFFER_MIN;
+  uint8_t *data;
+
+  if (size <= buf->max)
+    return 0;
+
+  while (max < size)
+    max *= 2;
+
+  if ((data = (uint8_t*)realloc(buf->data, max)) == NULL)
+    {
+      ERROR("logger:buffer: cannot allocate %d bytes, output is truncated\n", max);
+      return -1;
+    }
+  buf->data = data;
+  buf->max  = max;
+  return 0;
+}
+
+void logger_buffer_write(struct logger_buffer_t *buf, const void *data, uint32_t size)
+{
+  if (buf->size + size > buf->max && logger_buffer_alloc(buf, buf->size + size) != 0)
+    {
+      return;
+    }
+  memcpy(buf->data + buf->size, data, size);
+  buf->size += size;
+}
+
+void logger_buffer_printf(struct logger_buffer_t *buf, const char *fmt, ...)
+{
+  va_list ap;
+  int n;
+
+  va_start(ap, fmt);
+  n = vsnprintf((char*)buf->data + buf->size, buf->max - buf->size, fmt, ap);
+  va_end(ap);
+
+  if (n < 0)
+    return;
+
+  /* vsnprintf needs room for the final '\0' that is not kept */
+  if (buf->size + n + 1 > buf->max)
+    {
+      if (logger_buffer_alloc(buf, buf->size + n + 1) != 0)
+	return;
+      va_start(ap, fmt);
+      vsnprintf((char*)buf->data + buf->size, buf->max - buf->size, fmt, ap);
+      va_end(ap);
+    }
+  buf->size += n;
+}
+
+void logger_buffer_free(struct logger_buffer_t *buf)
+{
+  free(buf->data);
+  buf->data = NULL;
+  buf->size = 0;
+  buf->max  = 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+
+/*
+ * head and tail are free running buffer counters, head is only written
+ * by the simulation and tail by the writer thread. items counts queued
+ * buffers, slots counts free buffers.
+ */
+
+struct logger_writer_t {
+  logger_output_t         output;
+  void                   *arg;
+  int                     broken;   /* set by the writer     */
+  int                     error;    /* errno of the failure  */
+  int                     reported; /* set by the simulation */
+
+#if defined(LOGGER_WRITER_THREAD)
+  pthread_t               thread;
+  int                     threaded;
+  struct logger_buffer_t  ring[LOGGER_WRITER_BUFFERS];
+  uint32_t                head;
+  uint32_t                tail;
+  int                     stop;
+  sem_t                   items;
+  sem_t                   slots;
+#endif
+
+  /* statistics, simulation side */
+  struct logger_writer_stats_t stats;
+};
+
+/* ************************************************** */
+/* ************************************************** */
+
+static void logger_writer_output(struct logger_writer_t *w, struct logger_buffer_t *buf)
+{
+  int err;
+
+  if (__atomic_load_n(&w->broken, __ATOMIC_RELAXED))
+    return;
+
+  /* the reader of a pipe has gone, the simulation keeps running */
+  if ((err = w->output(w->arg, buf->data, buf->size)) != 0)
+    {
+      w->error = err;
+      __atomic_store_n(&w->broken, 1, __ATOMIC_RELEASE);
+    }
+}
+
+#if defined(SIGPIPE)
+static void logger_writer_sigmask(int how, const sigset_t *set, sigset_t *old)
+{
+#if defined(LOGGER_WRITER_THREAD)
+  pthread_sigmask(how, set, old);
+#else
+  sigprocmask(how, set, old);
+#endif
+}
+#endif
+
+/*
+ * synchronous write from the simulation thread, a closed pipe must be
+ * reported by the output function and not by the process SIGPIPE handler
+ */
+static void logger_writer_output_sync(struct logger_writer_t *w, struct logger_buffer_t *buf)
+{
+#if defined(SIGPIPE)
+  sigset_t set, old, pending;
+  int      was_pending, sig;
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  logger_writer_sigmask(SIG_BLOCK, &set, &old);
+  sigpending(&pending);
+  was_pending = sigismember(&pending, SIGPIPE);
+
+  logger_writer_output(w, buf);
+
+  /* discard the SIGPIPE raised by this write before unblocking */
+  sigpending(&pending);
+  if (! was_pending && sigismember(&pending, SIGPIPE))
+    {
+      sigwait(&set, &sig);
+    }
+  logger_writer_sigmask(SIG_SETMASK, &old, NULL);
+#else
+  logger_writer_output(w, buf);
+#endif
+}
+
+/* ************************************************** */
+/* ************************************************** */
+
+#if defined(LOGGER_WRITER_THREAD)
+
+static uint64_t logger_writer_nanotime(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000 * 1000 * 1000 + t.tv_nsec;
+}
+
+static void* logger_writer_main(void *ptr)
+{
+  struct logger_writer_t *w = (struct logger_writer_t*)ptr;
+  struct logger_buffer_t *buf;
+  uint32_t tail;
+
+#if defined(SIGPIPE)
+  /* a closed pipe is reported by the output function and not by a signal */
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &set, NULL);
+#endif
+
+  for(;;)
+    {
+      while (sem_wait(&w->items) == -1 && errno == EINTR)
+	;
+
+      tail = __atomic_load_n(&w->tail, __ATOMIC_RELAXED);
+      if (tail == __atomic_load_n(&w->head, __ATOMIC_ACQUIRE))
+	{
+	  /* woken up without a buffer, this is the stop request */
+	  if (__atomic_load_n(&w->stop, __ATOMIC_ACQUIRE))
+	    break;
+	  continue;
+	}
+
+      buf = &w->ring[tail % LOGGER_WRITER_BUFFERS];
+      logger_writer_output(w, buf);
+      buf->size = 0;
+      __atomic_store_n(&w->tail, tail + 1, __ATOMIC_RELEASE);
+      sem_post(&w->slots);
+    }
+  return NULL;
+}
+
+#endif
+
+/* ************************************************** */
+/* ************************************************** */
+
+struct logger_writer_t* logger_writer_start(logger_output_t output, void *arg, int threaded, uint32_t bufsize)
+{
+  struct logger_writer_t *w;
+
+  if ((w = (struct logger_writer_t*)calloc(1, sizeof(struct logger_writer_t))) == NULL)
+    {
+      return NULL;
+    }
+  w->output = output;
+  w->arg    = arg;
+
+#if defined(LOGGER_WRITER_THREAD)
+  if (threaded)
+    {
+      int i;
+      for(i=0; i < LOGGER_WRITER_BUFFERS; i++)
+	{
+	  if (logger_buffer_alloc(&w->ring[i], bufsize) != 0)
+	    {
+	      goto err_ring;
+	    }
+	}
+      if (sem_init(&w->items, 0, 0) == -1)
+	{
+	  goto err_ring;
+	}
+      if (sem_init(&w->slots, 0, LOGGER_WRITER_BUFFERS) == -1)
+	{
+	  goto err_items;
+	}
+      if (pthread_create(&w->thread, NULL, logger_writer_main, w) != 0)
+	{
+	  goto err_slots;
+	}
+      w->threaded = 1;
+      WRITER_DBG("logger:writer: started with %d buffers\n",LOGGER_WRITER_BUFFERS);
+    }
+  return w;
+
+  /* fall back to synchronous writes */
+ err_slots:
+  sem_destroy(&w->slots);
+ err_items:
+  sem_destroy(&w->items);
+ err_ring:
+  {
+    int i;
+    for(i=0; i < LOGGER_WRITER_BUFFERS; i++)
+      {
+	logger_buffer_free(&w->ring[i]);
+      }
+  }
+  return w;
+#else
+  (void)threaded;
+  (void)bufsize;
+  return w;
+#endif
+}
+
+/* ************************************************** */
+/* ************************************************** */
+
+int logger_writer_threaded(struct logger_writer_t *w)
+{
+#if defined(LOGGER_WRITER_THREAD)
+  return w->threaded;
+#else
+  (void)w;
+  return 0;
+#endif
+}
+
+/* ************************************************** */
+/* ************************************************** */
+
+void logger_writer_push(struct logger_writer_t *w, struct logger_buffer_t *buf)
+{
+  if (buf->size == 0)
+    {
+      return;
+    }
+
+  w->stats.buffers += 1;
+  w->stats.bytes   += buf->size;
+
+#if defined(LOGGER_WRITER_THREAD)
+  if (w->threaded)
+    {
+      struct logger_buffer_t  tmp;
+      struct logger_buffer_t *slot;
+      uint32_t head = w->head;
+
+      /* wait for the writer if all buffers are queued */
+      if (sem_trywait(&w->slots) == -1)
+	{
+	  uint64_t start = logger_writer_nanotime();
+	  while (sem_wait(&w->slots) == -1 && errno == EINTR)
+	    ;
+	  w->stats.stalls     += 1;
+	  w->stats.stall_time += logger_writer_nanotime() - start;
+	}
+
+      /* swap buffers, no data copy */
+      slot  = &w->ring[head % LOGGER_WRITER_BUFFERS];
+      tmp   = *slot;
+      *slot = *buf;
+      *buf  = tmp;
+      buf->size = 0;
+
+      __atomic_store_n(&w->head, head + 1, __ATOMIC_RELEASE);
+      sem_post(&w->items);
+      return;
+    }
+#endif
+
+  logger_writer_output_sync(w, buf);
+  buf->size = 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+
+int logger_writer_error(struct logger_writer_t *w)
+{
+  if (__atomic_load_n(&w->broken, __ATOMIC_ACQUIRE) && w->reported == 0)
+    {
+      w->reported = 1;
+      return w->error;
+    }
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+
+int logger_writer_stop(struct logger_writer_t *w)
+{
+  int err;
+
+#if defined(LOGGER_WRITER_THREAD)
+  if (w->threaded)
+    {
+      int i;
+      __atomic_store_n(&w->stop, 1, __ATOMIC_RELEASE);
+      sem_post(&w->items);
+      pthread_join(w->thread, NULL);
+
+      sem_destroy(&w->slots);
+      sem_destroy(&w->items);
+      for(i=0; i < LOGGER_WRITER_BUFFERS; i++)
+	{
+	  logger_buffer_free(&w->ring[i]);
+	}
+    }
+#endif
+
+  err = logger_writer_error(w);
+  free(w);
+  WRITER_DBG("logger:writer: stopped\n");
+  return err;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+
+void logger_writer_stats(struct logger_writer_t *w, struct logger_writer_stats_t *s)
+{
+  *s = w->stats;
+}
+
+/* ************************************************** */
+/* ************************************************** */
@@ -0,0 +1,80 @@
+/**
+ *  \file   logger_writer.h
+ *  \brief  Output buffers and background writer for simulation logs
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef _LOGGER_WRITER_H_
+#define _LOGGER_WRITER_H_
+
+#include <stdint.h>
+
+/**
+ * Log modules (tracer, packet log) fill a memory buffer and hand it to
+ * a writer when it is full or when it must reach the output. The writer
+ * swaps the buffer with an empty one of its ring, the simulation never
+ * copies data and only waits when every buffer of the ring is queued.
+ * These stalls are counted.
+ *
+ * When threads are available and asked for, buffers are written by a
+ * background thread. Otherwise, or when the thread cannot be started,
+ * buffers are written synchronously by push. SIGPIPE is blocked during
+ * writes in both cases, a closed pipe is an output error: the writer
+ * stops writing and the simulation keeps running.
+ **/
+
+/* buffers that can be queued, the caller fills one more */
+#define LOGGER_WRITER_BUFFERS 2
+
+struct logger_buffer_t {
+  uint8_t  *data;
+  uint32_t  size;
+  uint32_t  max;
+};
+
+void logger_buffer_write  (struct logger_buffer_t *buf, const void *data, uint32_t size);
+void logger_buffer_printf (struct logger_buffer_t *buf, const char *fmt, ...)
+  __attribute__ ((format (printf, 2, 3)));
+void logger_buffer_free   (struct logger_buffer_t *buf);
+
+/* buf holds at least size bytes, returns 0 or -1 on allocation error */
+int  logger_buffer_alloc  (struct logger_buffer_t *buf, uint32_t size);
+
+/* writes size bytes, returns 0 or an errno value */
+typedef int (*logger_output_t)(void *arg, const uint8_t *data, uint32_t size);
+
+struct logger_writer_t;
+
+struct logger_writer_stats_t {
+  uint32_t buffers;
+  uint64_t bytes;
+  uint32_t stalls;
+  uint64_t stall_time;  /* ns */
+};
+
+/**
+ * threaded != 0 asks for a background writer. Buffers given back by
+ * push hold at least bufsize bytes. returns NULL on allocation error.
+ **/
+struct logger_writer_t* logger_writer_start (logger_output_t output, void *arg, int threaded, uint32_t bufsize);
+
+/* 1 when buffers are written by a background thread */
+int  logger_writer_threaded (struct logger_writer_t *w);
+
+/* hand the content of buf to the writer, buf is given back empty */
+void logger_writer_push     (struct logger_writer_t *w, struct logger_buffer_t *buf);
+
+/**
+ * wait for queued buffers and release the writer, the output is not
+ * closed. returns the errno of an output failure that has not been
+ * returned by logger_writer_error, 0 otherwise.
+ **/
+int  logger_writer_stop     (struct logger_writer_t *w);
+
+/* errno of an output failure the first time it is asked for, 0 otherwise */
+int  logger_writer_error    (struct logger_writer_t *w);
+
+void logger_writer_stats    (struct logger_writer_t *w, struct logger_writer_stats_t *s);
+
+#endif
@@ -9,8 +9,12 @@
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 #include "arch/common/hardware.h"
+#include "src/options.h"
+#include "liblogger/logger_writer.h"
 #include "pcap.h"
 #include "logpkt.h"
 
@@ -33,7 +37,7 @@
 #define UNUSED __attribute__((unused))
 
 #define MAX_PKT_LENGTH 1300  /* maximum size of a packet           */
-#define MAX_INTERFACES 1     /* maximum number of radio interfaces */
+#define MAX_INTERFACES 4     /* maximum number of radio interfaces */
 
 #define MAXINTERFACENAME 30
 #define MAXERRORLENGTH   50
@@ -45,61 +49,151 @@
 #define LOG_TX_ONLY   1
 #define LOG_RX_AND_TX 2
 #define LOG_PCAP      3
+#define LOG_PCAPNG    4
 
 #define DEFAULT_LOG_MODE LOG_RX_AND_TX
 
 #define MAXFILENAME 500
 
+/* output buffer size that is handed to the writer */
+#define LOGPKT_FLUSH_SIZE (64*1024)
+
+#define LOGPKT_LOG_FRAMES 4  /* initial frames per log */
+
 /* ************************************************** */
 /* ************************************************** */
-struct _logpkt_state_t {
-  uint8_t  current_rx_pkt[MAX_PKT_LENGTH];
-  uint8_t  current_tx_pkt[MAX_PKT_LENGTH];
-  int      rx_pkt_offset;
-  int      tx_pkt_offset;
-  int      rx_pkt_completed;
-  int      tx_pkt_completed;
-  char     rx_error_log[MAXERRORLENGTH];
-  char     tx_error_log[MAXERRORLENGTH];
-  uint64_t rx_start_time;
-  uint64_t rx_end_time;
-  uint64_t tx_start_time;
-  uint64_t tx_end_time;
+
+/*
+ * Each direction of an interface has an append only log of the frames
+ * received or sent since the last rendez-vous, only the last frame can
+ * be ongoing. Frames that are completed at state save cannot be
+ * backtracked anymore, they are dumped to the output buffer and the
+ * log restarts with the ongoing frame. As bytes are only appended
+ * between two saves, restoring the log is restoring its counters and
+ * the ongoing frame descriptor, frame bytes are never copied.
+ */
+
+struct _logpkt_frame_t {
+  uint64_t start_time;
+  uint64_t end_time;
+  uint32_t offset;                      /* first byte in the log bytes */
+  uint32_t length;
+  int      completed;
+  char     error_log[MAXERRORLENGTH];
 };
 
-struct _logpkt_state_no_bk_t {
+struct _logpkt_log_t {
+  struct _logpkt_frame_t *frames;
+  uint32_t                frames_count;
+  uint32_t                frames_max;
+  uint8_t                *bytes;
+  uint32_t                bytes_size;
+  uint32_t                bytes_max;
+
+  /* saved for backtrack */
+  uint32_t                saved_frames_count;
+  uint32_t                saved_bytes_size;
+  struct _logpkt_frame_t  saved_frame;  /* first frame, ongoing at save */
+};
+
+struct _logpkt_state_t {
+  struct _logpkt_log_t rx;
+  struct _logpkt_log_t tx;
+
+  /* not backtracked */
   char     interface_name[MAXINTERFACENAME];
   int      interface_dlt;
   uint32_t rx_pkt_count;
   uint32_t tx_pkt_count;
 };
 
-static struct _logpkt_state_t logpkt_tab          [MAX_INTERFACES]; /* current logpkt table                      */
-static struct _logpkt_state_t logpkt_tab_saved    [MAX_INTERFACES]; /* saved logpkt table for backtrack          */
-static struct _logpkt_state_t logpkt_tab_buf      [MAX_INTERFACES]; /* buffered logpkt table                     */
-static struct _logpkt_state_t logpkt_tab_buf_saved[MAX_INTERFACES]; /* saved buffered logpkt table for backtrack */
-
-/* not buffered, not backtracked */
-static struct _logpkt_state_no_bk_t logpkt_no_bk_tab[MAX_INTERFACES];
+static WSIM_TLS struct _logpkt_state_t logpkt_tab[MAX_INTERFACES];
 
-static char  logpkt_filename[MAXFILENAME];
-static FILE* logpkt_logfile;
+static WSIM_TLS char  logpkt_filename[MAXFILENAME];
+static WSIM_TLS FILE* logpkt_logfile;
+static WSIM_TLS int   logpkt_live = 0;           /* stream to a terminal or a pipe */
+static WSIM_TLS int   logpkt_backtrack = 0;      /* frames wait for rendez-vous   */
+static WSIM_TLS struct logger_buffer_t logpkt_out;  /* formatted committed frames  */
+static WSIM_TLS struct logger_writer_t *logpkt_writer = NULL;
 
-static int nb_interfaces = 0;  /* number of different radio interfaces */
+static WSIM_TLS int nb_interfaces = 0;  /* number of different radio interfaces */
 
-static int log_mode     = DEFAULT_LOG_MODE;
+static WSIM_TLS int log_mode     = DEFAULT_LOG_MODE;
+static WSIM_TLS int log_nano     = 0;
 
 #define DLT_NO_INIT -1
-static int log_pcap_dlt = DLT_NO_INIT;
+static WSIM_TLS int log_pcap_dlt = DLT_NO_INIT;
+
+/* ************************************************** */
+/* ************************************************** */
+
+static int logpkt_writer_output(void *arg, const uint8_t *data, uint32_t size)
+{
+  FILE *out = (FILE*)arg;
+
+  /* live streams are flushed so that the reader sees every buffer */
+  if (fwrite(data, 1, size, out) != size || fflush(out) != 0)
+    {
+      return errno ? errno : EIO;
+    }
+  return 0;
+}
+
+/* the logger belongs to the simulation thread, errors are reported from there */
+static void logpkt_writer_report(int err)
+{
+  if (err != 0)
+    {
+      WARNING("logpkt:writer: cannot write packet log (%s), log is stopped\n", strerror(err));
+    }
+}
+
+static struct logger_writer_t* logpkt_writer_start(void)
+{
+  int threaded = (logpkt_logfile != stdout) && (logpkt_logfile != stderr);
+  struct logger_writer_t *w;
+
+  if ((w = logger_writer_start(logpkt_writer_output, logpkt_logfile, threaded, LOGPKT_FLUSH_SIZE)) == NULL)
+    {
+      ERROR("logpkt:writer: cannot allocate the packet log writer\n");
+    }
+  else if (threaded && ! logger_writer_threaded(w))
+    {
+      WARNING("logpkt:writer: cannot start writer thread, packets are written synchronously\n");
+    }
+  return w;
+}
+
+static void logpkt_writer_push(void)
+{
+  if (logpkt_writer != NULL)
+    {
+      logger_writer_push(logpkt_writer, &logpkt_out);
+      logpkt_writer_report(logger_writer_error(logpkt_writer));
+    }
+}
+
+static void logpkt_writer_stop(void)
+{
+  if (logpkt_writer != NULL)
+    {
+      logger_writer_push(logpkt_writer, &logpkt_out);
+      logpkt_writer_report(logger_writer_stop(logpkt_writer));
+      logpkt_writer = NULL;
+    }
+}
 
 /* ************************************************** */
 /* ************************************************** */
 static int logpkt_open_logfile(const char* filename)
 {
+  struct stat st;
+
   if (strcmp(filename, "stdout") == 0)
     {
       /* REAL_STDOUT("wsim:log:pipe:stdout\n"); */
       logpkt_logfile = stdout;
+      logpkt_live    = 1;
       return 0;
     }
 
@@ -107,8 +201,16 @@ static int logpkt_open_logfile(const char* filename)
     {
       /* REAL_STDOUT("wsim:log:pipe:stderr\n"); */
       logpkt_logfile = stderr;
+      logpkt_live    = 1;
       return 0;
     }
+
+  /* a named pipe is a live stream, e.g. for wireshark -k -i fifo */
+  if (stat(filename, &st) == 0 && S_ISFIFO(st.st_mode))
+    {
+      INFO("wsim:logpkt: waiting for a reader on %s\n", filename);
+      logpkt_live = 1;
+    }
   
   /* REAL_STDOUT("wsim:log:file:%s\n",filename); */
   return (logpkt_logfile = fopen(filename,"wb")) == NULL ;
@@ -117,7 +219,55 @@ static int logpkt_open_logfile(const char* filename)
 
 /* ************************************************** */
 /* ************************************************** */
-void logpkt_init(int do_log_pkt, char* logpkt, const char* logpktfilename)
+static void logpkt_parse_mode(char* logpkt)
+{
+  char *c;
+
+  if (!strcmp(logpkt, "rx"))
+    {
+      log_mode = LOG_RX_ONLY;
+      LOGPKT_DBG("liblogpkt:mode: set to RX only\n");
+    }
+  else if (!strcmp(logpkt, "tx"))
+    {
+      log_mode = LOG_TX_ONLY;
+      LOGPKT_DBG("liblogpkt:mode: set to TX only\n");
+    }
+  else if (!strcmp(logpkt, "rxtx") || !strcmp(logpkt, "txrx"))
+    {
+      log_mode = LOG_RX_AND_TX;
+      LOGPKT_DBG("liblogpkt:mode: set to RX and TX\n");
+    }
+  else if (strstr(logpkt,"pcap") == logpkt)
+    {
+      log_mode = (strstr(logpkt,"pcapng") == logpkt) ? LOG_PCAPNG : LOG_PCAP;
+      /* pcap[ng][:type][:ns] */
+      for(c = strchr(logpkt,':'); c != NULL; c = strchr(c+1,':'))
+	{
+	  if (strncmp(c+1,"ns",2) == 0)
+	    {
+	      log_nano = 1;
+	      LOGPKT_DBG("liblogpkt:mode: nanosecond timestamps\n");
+	    }
+	  else
+	    {
+	      log_pcap_dlt = atoi(c+1);
+	      LOGPKT_DBG("liblogpkt:mode: force pcap dlt type to %d\n", log_pcap_dlt);
+	    }
+	}
+    }
+  else
+    {
+      ERROR("pktlog: wrong option, should be '--logpkt=[tx|rx|rxtx|pcap[:id][:ns]|pcapng[:id][:ns]]'\n");
+      ERROR("pktlog: log mode set to RX and TX\n");
+      log_mode = LOG_RX_AND_TX;
+    }
+}
+
+
+/* ************************************************** */
+/* ************************************************** */
+void logpkt_init(int do_log_pkt, char* logpkt, const char* logpktfilename, int ws_mode)
 {
   LOGPKT_DBG("liblogpkt:init\n");
 
@@ -134,6 +284,7 @@ void logpkt_init(int do_log_pkt, char* logpkt, const char* logpktfilename)
       logpkt_tx_abort_pkt    = logpkt_tx_abort_pkt_op;
       logpkt_state_save      = logpkt_state_save_op;
       logpkt_state_restore   = logpkt_state_restore_op;
+      logpkt_dump_stats      = logpkt_dump_stats_op;
     }
   else
     {
@@ -148,50 +299,24 @@ void logpkt_init(int do_log_pkt, char* logpkt, const char* logpktfilename)
       logpkt_tx_abort_pkt    = logpkt_tx_abort_pkt_nop;
       logpkt_state_save      = logpkt_state_save_nop;
       logpkt_state_restore   = logpkt_state_restore_nop;
+      logpkt_dump_stats      = logpkt_dump_stats_nop;
 
       return;
     }
 
   if (logpkt)
     {
-      if (!strcmp(logpkt, "rx"))
-	{
-	  log_mode = LOG_RX_ONLY;
-	  LOGPKT_DBG("liblogpkt:mode: set to RX only\n");
-	}
-      else if (!strcmp(logpkt, "tx"))
-	{
-	  log_mode = LOG_TX_ONLY;
-	  LOGPKT_DBG("liblogpkt:mode: set to TX only\n");
-	}
-      else if (!strcmp(logpkt, "rxtx") || !strcmp(logpkt, "txrx"))
-	{
-	  log_mode = LOG_RX_AND_TX;
-	  LOGPKT_DBG("liblogpkt:mode: set to RX and TX\n");
-	}
-      else if (strstr(logpkt,"pcap") == logpkt)
-	{
-	  char *c;
-	  log_mode = LOG_PCAP;
-	  if ((c = strchr(logpkt,':')) != NULL)
-	    {
-	      int id = atoi(c+1);
-	      log_pcap_dlt = id;
-	      LOGPKT_DBG("liblogpkt:mode: force pcap dlt type to %d\n", log_pcap_dlt);
-	    }
-	}
-      else
-	{
-	  ERROR("pktlog: wrong option, should be '--logpkt=[tx|rx|rxtx|pcap[:id]]'\n");
-	  ERROR("pktlog: log mode set to RX and TX\n");
-	  log_mode = LOG_RX_AND_TX;
-	}
+      logpkt_parse_mode(logpkt);
     }
 
+  /* without backtrack frames are written as soon as they are completed */
+  logpkt_backtrack = WS_MODE_BACKTRACK(ws_mode);
+
   if (logpkt_open_logfile(logpktfilename))
     {
       ERROR(" ** Cannot open logpktfile, defaulting to %s\n", DEFAULT_LOGPKTFILENAME);
       logpkt_logfile = DEFAULT_LOGPKTFILE;
+      logpkt_live    = 1;
       strcpy(logpkt_filename, DEFAULT_LOGPKTFILENAME);
     }
   else
@@ -200,30 +325,41 @@ void logpkt_init(int do_log_pkt, char* logpkt, const char* logpktfilename)
       LOGPKT_DBG("wsim:liblogpkt:%s\n",logpkt_filename);
     }
 
-  if (log_mode != LOG_PCAP)
+  /* stdout and stderr are shared with the simulation messages */
+  logpkt_writer = logpkt_writer_start();
+
+  switch (log_mode)
     {
-      fprintf(logpkt_logfile, "\n");
-      fprintf(logpkt_logfile, "========================\n");
-      fprintf(logpkt_logfile, "== Radios packets log ==\n");
-      fprintf(logpkt_logfile, "========================\n");
-      fprintf(logpkt_logfile, "\n");
-      fprintf(logpkt_logfile, "Note : rx and tx packets contains preamble, sync word and data\n");
-      fprintf(logpkt_logfile, "Note : rx packets are logged before crc replacement\n");
-      fprintf(logpkt_logfile, "Note : time interval syntax -> [tx or rx start; tx or rx end]\n");
-      fprintf(logpkt_logfile, "\n");
+    case LOG_PCAP:
+      /* header is written with the first interface link type */
+      break;
+    case LOG_PCAPNG:
+      logpkt_pcapng_start(&logpkt_out, log_nano);
+      break;
+    default:
+      logger_buffer_printf(&logpkt_out, "\n");
+      logger_buffer_printf(&logpkt_out, "========================\n");
+      logger_buffer_printf(&logpkt_out, "== Radios packets log ==\n");
+      logger_buffer_printf(&logpkt_out, "========================\n");
+      logger_buffer_printf(&logpkt_out, "\n");
+      logger_buffer_printf(&logpkt_out, "Note : rx and tx packets contains preamble, sync word and data\n");
+      logger_buffer_printf(&logpkt_out, "Note : rx packets are logged before crc replacement\n");
+      logger_buffer_printf(&logpkt_out, "Note : time interval syntax -> [tx or rx start; tx or rx end]\n");
+      logger_buffer_printf(&logpkt_out, "\n");
 
       switch(log_mode)
 	{
 	case LOG_RX_ONLY:
-	  fprintf(logpkt_logfile, "Log mode: RX only\n");
+	  logger_buffer_printf(&logpkt_out, "Log mode: RX only\n");
 	  break;
 	case LOG_TX_ONLY:
-	  fprintf(logpkt_logfile, "Log mode: TX only\n");
+	  logger_buffer_printf(&logpkt_out, "Log mode: TX only\n");
 	  break;
 	case LOG_RX_AND_TX:
-	  fprintf(logpkt_logfile, "Log mode: RX and TX\n");
+	  logger_buffer_printf(&logpkt_out, "Log mode: RX and TX\n");
 	  break;
 	}
+      break;
     }
 }
 
@@ -232,6 +368,8 @@ void logpkt_init(int do_log_pkt, char* logpkt, const char* logpktfilename)
 /* ************************************************** */
 void logpkt_init_interface_op(int interface_id, const char* interface_name, int pcap_dlt)
 {
+  struct _logpkt_state_t *itf;
+
   LOGPKT_DBG("liblogpkt:init interface %s\n", interface_name);
 
   if (interface_id >= MAX_INTERFACES)
@@ -241,53 +379,35 @@ void logpkt_init_interface_op(int interface_id, const char* interface_name, int
     }
 
   /* init variables */
-  logpkt_tab[interface_id].rx_pkt_offset     = 0;
-  logpkt_tab[interface_id].tx_pkt_offset     = 0;
-  logpkt_tab[interface_id].rx_pkt_completed  = 0;
-  logpkt_tab[interface_id].tx_pkt_completed  = 0;
-  strcpy(logpkt_tab[interface_id].tx_error_log, "");
-
-  logpkt_tab_saved[interface_id].rx_pkt_offset    = 0;
-  logpkt_tab_saved[interface_id].tx_pkt_offset    = 0;
-  logpkt_tab_saved[interface_id].rx_pkt_completed = 0;
-  logpkt_tab_saved[interface_id].tx_pkt_completed = 0;
-  strcpy(logpkt_tab_saved[interface_id].tx_error_log, "");
-
-  logpkt_tab_buf[interface_id].rx_pkt_offset    = 0;
-  logpkt_tab_buf[interface_id].tx_pkt_offset    = 0;
-  logpkt_tab_buf[interface_id].rx_pkt_completed = 0;
-  logpkt_tab_buf[interface_id].tx_pkt_completed = 0;
-  strcpy(logpkt_tab_buf[interface_id].tx_error_log, "");
-
-  logpkt_tab_buf_saved[interface_id].rx_pkt_offset    = 0;
-  logpkt_tab_buf_saved[interface_id].tx_pkt_offset    = 0;
-  logpkt_tab_buf_saved[interface_id].rx_pkt_completed = 0;
-  logpkt_tab_buf_saved[interface_id].tx_pkt_completed = 0;
-  strcpy(logpkt_tab_buf_saved[interface_id].tx_error_log, "");
-
-  logpkt_no_bk_tab[interface_id].rx_pkt_count = 0;
-  logpkt_no_bk_tab[interface_id].tx_pkt_count = 0;
-  strncpyz(logpkt_no_bk_tab[interface_id].interface_name, interface_name, MAXINTERFACENAME);
+  itf = &logpkt_tab[interface_id];
+  memset(itf, 0, sizeof(struct _logpkt_state_t));
+  strncpyz(itf->interface_name, interface_name, MAXINTERFACENAME);
   
   if (log_pcap_dlt == DLT_NO_INIT) /* not forced */
     {
-      logpkt_no_bk_tab[interface_id].interface_dlt = pcap_dlt;
+      itf->interface_dlt = pcap_dlt;
     }
   else
     {
-      logpkt_no_bk_tab[interface_id].interface_dlt = log_pcap_dlt;
+      itf->interface_dlt = log_pcap_dlt;
     }
 
-  nb_interfaces++;
+  if (interface_id >= nb_interfaces)
+    {
+      nb_interfaces = interface_id + 1;
+    }
 
   LOGPKT_DBG("Interface %s registered\n", interface_name);
   switch (log_mode)
     {
     case LOG_PCAP:
-      logpkt_pcap_start(logpkt_logfile, logpkt_no_bk_tab[interface_id].interface_dlt);
+      logpkt_pcap_start(&logpkt_out, itf->interface_dlt, log_nano);
+      break;
+    case LOG_PCAPNG:
+      logpkt_pcapng_interface(&logpkt_out, interface_id, interface_name, itf->interface_dlt);
       break;
     default:
-      fprintf(logpkt_logfile, "Interface %s registered\n", interface_name);
+      logger_buffer_printf(&logpkt_out, "Interface %s registered\n", interface_name);
       break;
     }
 }
@@ -295,14 +415,43 @@ void logpkt_init_interface_op(int interface_id, const char* interface_name, int
 /* ************************************************** */
 /* ************************************************** */
 
+static void logpkt_commit(void);
+static void logpkt_flush(void);
+
+/* ************************************************** */
+/* ************************************************** */
+
+static void logpkt_log_free(struct _logpkt_log_t *log)
+{
+  free(log->frames);
+  free(log->bytes);
+  memset(log, 0, sizeof(struct _logpkt_log_t));
+}
+
 void logpkt_close_op(void)
 {
+  int i;
+
+  /* the simulation is over, completed frames are final */
+  logpkt_commit();
   if ((logpkt_logfile != stdout) && (logpkt_logfile != stderr))
     {
-      if (log_mode == LOG_PCAP)
+      if (log_mode == LOG_PCAP || log_mode == LOG_PCAPNG)
 	{
-	  logpkt_pcap_close(logpkt_logfile);
+	  logpkt_pcap_close(&logpkt_out);
 	}
+    }
+  logpkt_writer_stop();
+  logger_buffer_free(&logpkt_out);
+
+  for (i = 0; i < nb_interfaces; i++)
+    {
+      logpkt_log_free(&logpkt_tab[i].rx);
+      logpkt_log_free(&logpkt_tab[i].tx);
+    }
+
+  if ((logpkt_logfile != stdout) && (logpkt_logfile != stderr))
+    {
       fclose(logpkt_logfile);
     }
 }
@@ -310,340 +459,380 @@ void logpkt_close_op(void)
 /* ************************************************** */
 /* ************************************************** */
 
-void logpkt_rx_byte_op(int interface_id, uint8_t val)
+/* returns the ongoing frame of log, a new one is started if needed */
+static struct _logpkt_frame_t* logpkt_log_frame(struct _logpkt_log_t *log)
 {
-  if (!logpkt_tab[interface_id].rx_pkt_completed)
+  struct _logpkt_frame_t *frame;
+
+  if (log->frames_count > 0 && !log->frames[log->frames_count - 1].completed)
     {
-      if (logpkt_tab[interface_id].rx_pkt_offset == 0)
+      return &log->frames[log->frames_count - 1];
+    }
+
+  if (log->frames_count == log->frames_max)
+    {
+      uint32_t max = log->frames_max ? 2 * log->frames_max : LOGPKT_LOG_FRAMES;
+      if ((frame = realloc(log->frames, max * sizeof(struct _logpkt_frame_t))) == NULL)
 	{
-	  logpkt_tab[interface_id].rx_start_time = MACHINE_TIME_GET_NANO();
+	  return NULL;
 	}
-      LOGPKT_DBG("liblogpkt:log rx byte: 0x%02x\n", val);
-      logpkt_tab[interface_id].rx_end_time = MACHINE_TIME_GET_NANO();
-      logpkt_tab[interface_id].current_rx_pkt[logpkt_tab[interface_id].rx_pkt_offset] = val;
-      logpkt_tab[interface_id].rx_pkt_offset++;
+      log->frames     = frame;
+      log->frames_max = max;
     }
-  else
-    { /* put data in buffer as previous packet is completed but not dumped yet */
-      if (logpkt_tab_buf[interface_id].rx_pkt_offset == 0)
+
+  frame = &log->frames[log->frames_count++];
+  frame->start_time   = MACHINE_TIME_GET_NANO();
+  frame->offset       = log->bytes_size;
+  frame->length       = 0;
+  frame->completed    = 0;
+  frame->error_log[0] = '\0';
+  return frame;
+}
+
+static void logpkt_log_byte(struct _logpkt_log_t *log, uint8_t val)
+{
+  struct _logpkt_frame_t *frame;
+
+  if ((frame = logpkt_log_frame(log)) == NULL || frame->length >= MAX_PKT_LENGTH)
+    {
+      return;
+    }
+
+  if (log->bytes_size == log->bytes_max)
+    {
+      uint32_t max = log->bytes_max ? 2 * log->bytes_max : LOGPKT_LOG_FRAMES * MAX_PKT_LENGTH;
+      uint8_t *bytes;
+      if ((bytes = realloc(log->bytes, max)) == NULL)
 	{
-	  logpkt_tab_buf[interface_id].rx_start_time = MACHINE_TIME_GET_NANO();
+	  return;
 	}
-      LOGPKT_DBG("liblogpkt:log rx byte in buffer: 0x%02x\n", val);
-      logpkt_tab_buf[interface_id].rx_end_time = MACHINE_TIME_GET_NANO();
-      logpkt_tab_buf[interface_id].current_rx_pkt[logpkt_tab_buf[interface_id].rx_pkt_offset] = val;
-      logpkt_tab_buf[interface_id].rx_pkt_offset++;
+      log->bytes     = bytes;
+      log->bytes_max = max;
     }
+
+  frame->end_time = MACHINE_TIME_GET_NANO();
+  frame->length  += 1;
+  log->bytes[log->bytes_size++] = val;
+}
+
+void logpkt_rx_byte_op(int interface_id, uint8_t val)
+{
+  LOGPKT_DBG("liblogpkt:log rx byte: 0x%02x\n", val);
+  logpkt_log_byte(&logpkt_tab[interface_id].rx, val);
 }
 
 
 void logpkt_tx_byte_op(int interface_id, uint8_t val)
 {
   LOGPKT_DBG("liblogpkt:log tx byte : 0x%02x\n", val);
+  logpkt_log_byte(&logpkt_tab[interface_id].tx, val);
+}
+
+
+/* ************************************************** */
+/* ************************************************** */
+
+static void logpkt_log_complete(struct _logpkt_log_t *log, const char *dir, const char *error)
+{
+  struct _logpkt_frame_t *frame;
 
-  if (!logpkt_tab[interface_id].rx_pkt_completed)
+  if (log->frames_count == 0)
     {
-      if (logpkt_tab[interface_id].tx_pkt_offset == 0)
+      return;
+    }
+
+  frame = &log->frames[log->frames_count - 1];
+  if (!frame->completed && frame->length)
+    {
+      frame->completed = 1;
+      if (error)
 	{
-	  logpkt_tab[interface_id].tx_start_time = MACHINE_TIME_GET_NANO();
+	  snprintf(frame->error_log, MAXERRORLENGTH, " -> %s aborted: %s", dir, error);
 	}
-      LOGPKT_DBG("liblogpkt:log tx byte : 0x%02x\n", val);
-      logpkt_tab[interface_id].tx_end_time = MACHINE_TIME_GET_NANO();
-      logpkt_tab[interface_id].current_tx_pkt[logpkt_tab[interface_id].tx_pkt_offset] = val;
-      logpkt_tab[interface_id].tx_pkt_offset++;
-    }
-  else
-    { /* put data in buffer as previous packet is completed but not dumped yet */
-      if (logpkt_tab_buf[interface_id].tx_pkt_offset == 0)
+      if (! logpkt_backtrack)
 	{
-	  logpkt_tab_buf[interface_id].tx_start_time = MACHINE_TIME_GET_NANO();
+	  logpkt_commit();
+	  logpkt_flush();
 	}
-      LOGPKT_DBG("liblogpkt:log tx byte in buffer: 0x%02x\n", val);
-      logpkt_tab_buf[interface_id].tx_end_time = MACHINE_TIME_GET_NANO();
-      logpkt_tab_buf[interface_id].current_tx_pkt[logpkt_tab_buf[interface_id].tx_pkt_offset] = val;
-      logpkt_tab_buf[interface_id].tx_pkt_offset++;
     }
 }
 
+void logpkt_rx_complete_pkt_op(int interface_id)
+{
+  LOGPKT_DBG("liblogpkt:rx complete pkt\n");
+  logpkt_log_complete(&logpkt_tab[interface_id].rx, "rx", NULL);
+}
+
+
+void logpkt_tx_complete_pkt_op(int interface_id)
+{
+  LOGPKT_DBG("liblogpkt:tx complete pkt\n");
+  logpkt_log_complete(&logpkt_tab[interface_id].tx, "tx", NULL);
+}
+
 
 /* ************************************************** */
 /* ************************************************** */
 
-void logpkt_rx_complete_pkt_op(int interface_id)
+void logpkt_rx_abort_pkt_op(int interface_id, const char* error)
 {
-  if (!logpkt_tab[interface_id].rx_pkt_completed && logpkt_tab[interface_id].rx_pkt_offset)
-    {
-      LOGPKT_DBG("liblogpkt:rx complete pkt\n");
-      logpkt_tab[interface_id].rx_pkt_completed = 1;
-    }
-  else if (logpkt_tab_buf[interface_id].rx_pkt_offset)
-    {
-      LOGPKT_DBG("liblogpkt:rx complete pkt buf\n");
-      logpkt_tab_buf[interface_id].rx_pkt_completed = 1;
-    }
+  LOGPKT_DBG("liblogpkt:rx abort pkt\n");
+  logpkt_log_complete(&logpkt_tab[interface_id].rx, "rx", error);
 }
 
 
-void logpkt_tx_complete_pkt_op(int interface_id)
+void logpkt_tx_abort_pkt_op(int interface_id, const char* error)
 {
-  if (!logpkt_tab[interface_id].tx_pkt_completed && logpkt_tab[interface_id].tx_pkt_offset)
+  LOGPKT_DBG("liblogpkt:tx abort pkt\n");
+  logpkt_log_complete(&logpkt_tab[interface_id].tx, "tx", error);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+
+static void logpkt_dump_text(struct _logpkt_state_t *itf, const char *dir, uint32_t count,
+			     struct _logpkt_frame_t *frame, uint8_t *pkt)
+{
+  uint32_t i;
+  char c;
+
+  logger_buffer_printf(&logpkt_out,"\n");
+  logger_buffer_printf(&logpkt_out,"******* %s: %s packet (n°%d) [%"PRIu64"ns; %"PRIu64"ns] *******\n",
+		       itf->interface_name, dir, count,
+		       frame->start_time, frame->end_time);
+	  
+  /* hex */
+  for (i = 0; i < frame->length - 1; i++)
     {
-      LOGPKT_DBG("liblogpkt:tx complete pkt\n");
-      logpkt_tab[interface_id].tx_pkt_completed = 1;
+      logger_buffer_printf(&logpkt_out,"%02x:", pkt[i]);
     }
-  else if (logpkt_tab_buf[interface_id].tx_pkt_offset)
+  logger_buffer_printf(&logpkt_out,"%02x", pkt[frame->length - 1]);
+  logger_buffer_printf(&logpkt_out,"%s\n", frame->error_log);
+	  
+  /* ascii */
+  for (i = 0; i < frame->length - 1; i++)
     {
-      LOGPKT_DBG("liblogpkt:tx complete pkt buf\n");
-      logpkt_tab_buf[interface_id].tx_pkt_completed = 1;
+      c = pkt[i];
+      logger_buffer_printf(&logpkt_out," %c:", isprint((unsigned char)c) ? c : '.');
     }
+  c = pkt[frame->length - 1];
+  logger_buffer_printf(&logpkt_out," %c", isprint((unsigned char)c) ? c : '.');
+  logger_buffer_printf(&logpkt_out,"%s\n", frame->error_log);
 }
 
-
-void logpkt_rx_abort_pkt_op(int interface_id, const char* error)
+static void logpkt_rx_dump_pkt(struct _logpkt_state_t *itf, int interface_id, struct _logpkt_frame_t *frame)
 {
-  char error_str[MAXERRORLENGTH + 20] = " -> rx aborted: ";
-
-  LOGPKT_DBG("liblogpkt:rx abort pkt\n");
+  uint8_t *pkt = itf->rx.bytes + frame->offset;
 
-  if (!logpkt_tab[interface_id].rx_pkt_completed && logpkt_tab[interface_id].rx_pkt_offset)
+  switch (log_mode) 
     {
-      /* current rx frame not empty */
-      if (logpkt_tab[interface_id].rx_pkt_offset)
+    case LOG_PCAP:
+      if (frame->error_log[0] == '\0')
 	{
-	  logpkt_tab[interface_id].rx_pkt_completed = 1;
-	  strcpy(logpkt_tab[interface_id].rx_error_log, strcat(error_str, error));
+	  logpkt_pcap_logrx(&logpkt_out, pkt, frame->length, frame->start_time, frame->end_time);
 	}
-    }
-  else if (logpkt_tab_buf[interface_id].rx_pkt_offset)
-    {
-      /* current buffered rx frame not empty */
-      if (logpkt_tab_buf[interface_id].rx_pkt_offset)
+      itf->rx_pkt_count++;
+      break;
+    case LOG_PCAPNG:
+      if (frame->error_log[0] == '\0')
 	{
-	  logpkt_tab_buf[interface_id].rx_pkt_completed = 1;
-	  strcpy(logpkt_tab_buf[interface_id].rx_error_log, strcat(error_str, error));
+	  logpkt_pcapng_logrx(&logpkt_out, interface_id, pkt, frame->length, 
+			      frame->start_time, frame->end_time);
 	}
+      itf->rx_pkt_count++;
+      break;
+    case LOG_TX_ONLY:
+      break;
+    default:
+      logpkt_dump_text(itf, "RX", itf->rx_pkt_count, frame, pkt);
+      itf->rx_pkt_count++;
+      break;
     }
 }
 
 
-void logpkt_tx_abort_pkt_op(int interface_id, const char* error)
+static void logpkt_tx_dump_pkt(struct _logpkt_state_t *itf, int interface_id, struct _logpkt_frame_t *frame)
 {
-  char error_str[MAXERRORLENGTH + 20] = " -> tx aborted: ";
+  uint8_t *pkt = itf->tx.bytes + frame->offset;
 
-  LOGPKT_DBG("liblogpkt:tx abort pkt\n");
-
-  if (!logpkt_tab[interface_id].rx_pkt_completed && logpkt_tab[interface_id].rx_pkt_offset)
+  switch (log_mode)
     {
-      /* current tx frame not empty */
-      if (logpkt_tab[interface_id].tx_pkt_offset)
+    case LOG_PCAP:
+      if (frame->error_log[0] == '\0')
 	{
-	  logpkt_tab[interface_id].tx_pkt_completed = 1;
-	  strcpy(logpkt_tab[interface_id].tx_error_log, strcat(error_str, error));
+	  logpkt_pcap_logtx(&logpkt_out, pkt, frame->length, frame->start_time, frame->end_time);
 	}
-    }
-  else if (logpkt_tab_buf[interface_id].tx_pkt_offset)
-    {
-      /* current buffered tx frame not empty */
-      if (logpkt_tab_buf[interface_id].tx_pkt_offset)
+      itf->tx_pkt_count++;
+      break;
+    case LOG_PCAPNG:
+      if (frame->error_log[0] == '\0')
 	{
-	  logpkt_tab_buf[interface_id].tx_pkt_completed = 1;
-	  strcpy(logpkt_tab_buf[interface_id].tx_error_log, strcat(error_str, error));
+	  logpkt_pcapng_logtx(&logpkt_out, interface_id, pkt, frame->length, 
+			      frame->start_time, frame->end_time);
 	}
+      itf->tx_pkt_count++;
+      break;
+    case LOG_RX_ONLY:
+      break;
+    default:
+      logpkt_dump_text(itf, "TX", itf->tx_pkt_count, frame, pkt);
+      itf->tx_pkt_count++;
+      break;
     }
 }
 
 /* ************************************************** */
 /* ************************************************** */
 
-static void logpkt_rx_dump_pkt(struct _logpkt_state_t *logpkt, int interface_id)
+static uint32_t logpkt_log_completed(struct _logpkt_log_t *log)
 {
-  int i;
-  char c;
+  if (log->frames_count > 0 && !log->frames[log->frames_count - 1].completed)
+    {
+      return log->frames_count - 1;
+    }
+  return log->frames_count;
+}
 
-  /* current rx frame not empty */
-  if (logpkt->rx_pkt_offset)
+/* drop the completed frames, the ongoing one is moved at the start of the log */
+static void logpkt_log_compact(struct _logpkt_log_t *log)
+{
+  uint32_t done = logpkt_log_completed(log);
+
+  if (done < log->frames_count)
     {
-      switch (log_mode) 
+      struct _logpkt_frame_t *frame = &log->frames[done];
+      if (frame->offset > 0)
 	{
-	case LOG_PCAP:
-	  if (strcmp(logpkt->rx_error_log,"") == 0)
-	    {
-	      logpkt_pcap_logrx(logpkt_logfile,
-	                        logpkt->current_rx_pkt,logpkt->rx_pkt_offset,
-	                        logpkt->rx_start_time,logpkt->rx_end_time);
-	    }
-	  logpkt_no_bk_tab[interface_id].rx_pkt_count++;
-	  break;
-	case LOG_TX_ONLY:
-	  break;
-	default:
-	  fprintf(logpkt_logfile,"\n");
-	  fprintf(logpkt_logfile,"******* %s: RX packet (n°%d) [%"PRIu64"ns; %"PRIu64"ns] *******\n",
-	          logpkt_no_bk_tab[interface_id].interface_name,
-	          logpkt_no_bk_tab[interface_id].rx_pkt_count,
-	          logpkt->rx_start_time,
-	          logpkt->rx_end_time);
-	  
-	  /* hex */
-	  for (i = 0; i < logpkt->rx_pkt_offset - 1; i++)
-	    {
-	      fprintf(logpkt_logfile,"%02x:", logpkt->current_rx_pkt[i]);
-	    }
-	  fprintf(logpkt_logfile,"%02x", logpkt->current_rx_pkt[logpkt->rx_pkt_offset - 1]);
-	  fprintf(logpkt_logfile,"%s\n", logpkt->rx_error_log);
-	  
-	  /* ascii */
-	  for (i = 0; i < logpkt->rx_pkt_offset - 1; i++)
-	    {
-	      c = logpkt->current_rx_pkt[i];
-	      fprintf(logpkt_logfile," %c:", isprint(c) ? c : '.');
-	    }
-	  c = logpkt->current_rx_pkt[logpkt->rx_pkt_offset - 1];
-	  fprintf(logpkt_logfile," %c", isprint(c) ? c : '.');
-	  fprintf(logpkt_logfile,"%s\n", logpkt->rx_error_log);
-	  
-	  logpkt_no_bk_tab[interface_id].rx_pkt_count++;
-	  break;
+	  memmove(log->bytes, log->bytes + frame->offset, frame->length);
+	  frame->offset = 0;
 	}
+      log->frames[0]   = *frame;
+      log->frames_count = 1;
+      log->bytes_size   = frame->length;
+    }
+  else
+    {
+      log->frames_count = 0;
+      log->bytes_size   = 0;
     }
 }
 
-
-static void logpkt_tx_dump_pkt(struct _logpkt_state_t *logpkt, int interface_id)
+/* dump completed frames of all interfaces, rx and tx by start time */
+static void logpkt_commit(void)
 {
   int i;
-  char c;
+  
+  for (i = 0; i < nb_interfaces; i++)
+    { 
+      struct _logpkt_state_t *itf = &logpkt_tab[i];
+      uint32_t rx_done = logpkt_log_completed(&itf->rx);
+      uint32_t tx_done = logpkt_log_completed(&itf->tx);
+      uint32_t r = 0, t = 0;
 
-  /* current tx frame not empty */
-  if (logpkt->tx_pkt_offset)
-    {
-      switch (log_mode)
+      while (r < rx_done || t < tx_done)
 	{
-	case LOG_PCAP:
-	  if (strcmp(logpkt->tx_error_log,"") == 0)
+	  if (t == tx_done || 
+	      (r < rx_done && itf->rx.frames[r].start_time <= itf->tx.frames[t].start_time))
 	    {
-	      logpkt_pcap_logtx(logpkt_logfile,
-	                        logpkt->current_tx_pkt,logpkt->tx_pkt_offset,
-	                        logpkt->tx_start_time,logpkt->tx_end_time);
+	      LOGPKT_DBG("liblogpkt: dump rx pkt\n");
+	      logpkt_rx_dump_pkt(itf, i, &itf->rx.frames[r++]);
 	    }
-	  logpkt_no_bk_tab[interface_id].tx_pkt_count++;
-	  break;
-	case LOG_RX_ONLY:
-	  break;
-	default:
-	  fprintf(logpkt_logfile,"\n");
-	  fprintf(logpkt_logfile,"******* %s: TX packet (n°%d) [%"PRIu64"ns; %"PRIu64"ns] *******\n",
-	          logpkt_no_bk_tab[interface_id].interface_name,
-	          logpkt_no_bk_tab[interface_id].tx_pkt_count,
-	          logpkt->tx_start_time,
-	          logpkt->tx_end_time);
-	  
-	  /* hex */
-	  for (i = 0; i < logpkt->tx_pkt_offset - 1; i++)
-	    {
-	      fprintf(logpkt_logfile,"%02x:", logpkt->current_tx_pkt[i]);
-	    }
-	  fprintf(logpkt_logfile,"%02x", logpkt->current_tx_pkt[logpkt->tx_pkt_offset - 1]);
-	  fprintf(logpkt_logfile,"%s\n", logpkt->tx_error_log);
-	  
-	  /* ascii */
-	  for (i = 0; i < logpkt->tx_pkt_offset - 1; i++)
+	  else
 	    {
-	      c = logpkt->current_tx_pkt[i];
-	      fprintf(logpkt_logfile," %c:", isprint(c) ? c : '.');
+	      LOGPKT_DBG("liblogpkt: dump tx pkt\n");
+	      logpkt_tx_dump_pkt(itf, i, &itf->tx.frames[t++]);
 	    }
-	  c = logpkt->current_tx_pkt[logpkt->tx_pkt_offset - 1];
-	  fprintf(logpkt_logfile," %c", isprint(c) ? c : '.');
-	  fprintf(logpkt_logfile,"%s\n", logpkt->tx_error_log);
-	  
-	  logpkt_no_bk_tab[interface_id].tx_pkt_count++;
 	}
+
+      logpkt_log_compact(&itf->rx);
+      logpkt_log_compact(&itf->tx);
     }
 }
 
 /* ************************************************** */
 /* ************************************************** */
 
+static void logpkt_log_save(struct _logpkt_log_t *log)
+{
+  log->saved_frames_count = log->frames_count;
+  log->saved_bytes_size   = log->bytes_size;
+  if (log->frames_count)
+    {
+      log->saved_frame = log->frames[0];
+    }
+}
+
+static void logpkt_log_restore(struct _logpkt_log_t *log)
+{
+  log->frames_count = log->saved_frames_count;
+  log->bytes_size   = log->saved_bytes_size;
+  if (log->frames_count)
+    {
+      log->frames[0] = log->saved_frame;
+    }
+}
+
+/* committed frames cannot be backtracked, they can be written */
+static void logpkt_flush(void)
+{
+  if (logpkt_out.size >= LOGPKT_FLUSH_SIZE || (logpkt_live && logpkt_out.size > 0))
+    {
+      logpkt_writer_push();
+    }
+}
+
+void logpkt_set_backtrack(int on)
+{
+  logpkt_backtrack = on;
+}
+
 void logpkt_state_save_op(void)
 {
   int i;
-  
-  for (i = 0; i < nb_interfaces; i++)
-    { 
-      /* rx packet */
-      if (logpkt_tab[i].rx_pkt_completed)
-	{
-	  LOGPKT_DBG("liblogpkt: dump tx pkt\n");
-	  logpkt_rx_dump_pkt(&logpkt_tab[i], i);
-	  logpkt_tab[i].rx_pkt_completed = 0;
-	  logpkt_tab[i].rx_pkt_offset    = 0;
-	  strcpy(logpkt_tab[i].rx_error_log, "");
-	  
-	  if (logpkt_tab_buf[i].rx_pkt_offset)
-	    { /* data is buffered */
-	      if (logpkt_tab_buf[i].rx_pkt_completed)
-		{ /* new frame is completed */
-		  LOGPKT_DBG("liblogpkt: dump tx pkt buf\n");
-		  logpkt_rx_dump_pkt(&logpkt_tab_buf[i], i);
-		}
-	      else
-		{ /* new frame ongoing: move it to logpkt_tab */
-		  LOGPKT_DBG("liblogpkt: copy tx pkt buf to current tx pkt\n");
-		  memcpy(logpkt_tab[i].current_rx_pkt, logpkt_tab_buf[i].current_rx_pkt,
-			 sizeof(uint8_t) * logpkt_tab_buf[i].rx_pkt_offset);
-		  logpkt_tab[i].rx_pkt_offset = logpkt_tab_buf[i].rx_pkt_offset;
-		  logpkt_tab[i].rx_start_time = logpkt_tab_buf[i].rx_start_time;
-		  logpkt_tab[i].rx_end_time   = logpkt_tab_buf[i].rx_end_time;
-		}
-	      /* delete buffered data */
-	      logpkt_tab_buf[i].rx_pkt_completed = 0;
-	      logpkt_tab_buf[i].rx_pkt_offset    = 0;
-	      strcpy(logpkt_tab_buf[i].rx_error_log, "");
-	    }
-	}
 
-      /* tx packet */
-      if (logpkt_tab[i].tx_pkt_completed)
-	{
-	  LOGPKT_DBG("liblogpkt: dump rx pkt\n");
-	  logpkt_tx_dump_pkt(&logpkt_tab[i], i);
-	  logpkt_tab[i].tx_pkt_completed = 0;
-	  logpkt_tab[i].tx_pkt_offset    = 0;
-	  strcpy(logpkt_tab[i].tx_error_log, "");
-
-	  if (logpkt_tab_buf[i].tx_pkt_offset)
-	    { /* data is buffered */
-	      if (logpkt_tab_buf[i].tx_pkt_completed)
-		{ /* new frame is completed */
-		  LOGPKT_DBG("liblogpkt: dump rx pkt buf\n");
-		  logpkt_tx_dump_pkt(&logpkt_tab_buf[i], i);
-		}
-	      else
-		{ /* new frame ongoing: move it to logpkt_tab */
-		  LOGPKT_DBG("liblogpkt: copy rx pkt buf to current rx pkt\n");
-		  memcpy(logpkt_tab[i].current_tx_pkt, logpkt_tab_buf[i].current_tx_pkt,
-			 sizeof(uint8_t) * logpkt_tab_buf[i].tx_pkt_offset);
-		  logpkt_tab[i].tx_pkt_offset = logpkt_tab_buf[i].tx_pkt_offset;
-		  logpkt_tab[i].tx_start_time = logpkt_tab_buf[i].tx_start_time;
-		  logpkt_tab[i].tx_end_time   = logpkt_tab_buf[i].tx_end_time;
-		}
-	      /* delete buffered data */
-	      logpkt_tab_buf[i].tx_pkt_completed = 0;
-	      logpkt_tab_buf[i].tx_pkt_offset    = 0;
-	      strcpy(logpkt_tab_buf[i].tx_error_log, "");
-	    }
-	}
+  logpkt_commit();
+  for (i = 0; i < nb_interfaces; i++)
+    {
+      logpkt_log_save(&logpkt_tab[i].rx);
+      logpkt_log_save(&logpkt_tab[i].tx);
     }
-
-  memcpy(logpkt_tab_saved, logpkt_tab, nb_interfaces * sizeof(struct _logpkt_state_t));
-  memcpy(logpkt_tab_buf_saved, logpkt_tab_buf, nb_interfaces * sizeof(struct _logpkt_state_t));
+  logpkt_flush();
 }
 
 
 void logpkt_state_restore_op(void)
 {
-  memcpy(logpkt_tab, logpkt_tab_saved, nb_interfaces * sizeof(struct _logpkt_state_t));
-  memcpy(logpkt_tab_buf, logpkt_tab_buf_saved, nb_interfaces * sizeof(struct _logpkt_state_t));
+  int i;
+
+  for (i = 0; i < nb_interfaces; i++)
+    {
+      logpkt_log_restore(&logpkt_tab[i].rx);
+      logpkt_log_restore(&logpkt_tab[i].tx);
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+
+void logpkt_dump_stats_op(void)
+{
+  int i;
+  uint32_t rx = 0, tx = 0;
+
+  for (i = 0; i < nb_interfaces; i++)
+    {
+      rx += logpkt_tab[i].rx_pkt_count;
+      tx += logpkt_tab[i].tx_pkt_count;
+    }
+
+  OUTPUT_STATS("  packet log frames             : %d rx, %d tx\n", rx, tx);
+  if (logpkt_writer != NULL)
+    {
+      struct logger_writer_stats_t st;
+      logger_writer_stats(logpkt_writer, &st);
+      OUTPUT_STATS("  packet log buffers written    : %d (%"PRIu64" bytes)\n", st.buffers, st.bytes);
+      OUTPUT_STATS("  packet log writer stalls      : %d (%"PRIu64" ms)\n", st.stalls, st.stall_time / (1000*1000));
+    }
 }
 
 
@@ -664,6 +853,13 @@ void logpkt_close_nop(void)
 }
 
 
+/* ************************************************** */
+/* ************************************************** */
+void logpkt_dump_stats_nop(void)
+{
+}
+
+
 /* ************************************************** */
 /* ************************************************** */
 void logpkt_rx_byte_nop(int UNUSED interface_id, uint8_t UNUSED val)
@@ -19,7 +19,9 @@ Overview
 
 It enables to log into a custom file (by default wsim-pkt.log) full frames received
 and sent by the platform interfaces. It takes care about backtrack, so the log
-reflects exactly real RX and TX.
+reflects exactly real RX and TX: with WSNet frames are only written once they are
+completed before a rendez-vous save, otherwise as soon as they are completed. The output is buffered and written by a background
+thread when available.
 
 
 Usage
@@ -30,17 +32,20 @@ User
 2 options refer to this functionality, --logpkt and --logpktfile.
 Setting one on command line, enables packets log.
 
---logpkt=[rx | tx | rxtx | pcap[:type] ]
-rx          : only RX are logged
-tx          : only TX are logged
-rxtx        : both RX and TX are logged (by default)
-pcap[:type] : pcap file format, optional Data Link Type identifier (default 802.15.4)
+--logpkt=[rx | tx | rxtx | pcap[:type][:ns] | pcapng[:type][:ns] ]
+rx            : only RX are logged
+tx            : only TX are logged
+rxtx          : both RX and TX are logged (by default)
+pcap[:type]   : pcap file format, optional Data Link Type identifier (default 802.15.4)
+pcapng[:type] : pcapng file format, one interface block per radio, RX/TX direction flags
+:ns           : nanosecond timestamps for pcap and pcapng
 
 Parameters are optional.
 
 --logpktfile=filename
 Name of file where packets log will be stored.
-Parameter is mandatory.
+Parameter is mandatory. When filename is a named pipe (mkfifo), frames are
+streamed at each rendez-vous, e.g. for "wireshark -k -i filename".
 
 To use packets log with all default parameters, just put --logpkt on command line.
 Without any of these 2 options, packet log is disabled.
@@ -59,7 +64,10 @@ at the end of the byte stream of the aborted frame in the log file.
 
 ***************************************************************************************/
 
-void logpkt_init               (int do_log_pkt, char* logpkt, const char* logpktfilename);
+void logpkt_init               (int do_log_pkt, char* logpkt, const char* logpktfilename, int ws_mode);
+
+/* frames are only written at state saves, set at init for the wsnet modes */
+void logpkt_set_backtrack      (int on);
 
 /* public encapsulation functions */
 void (*logpkt_init_interface)  (int interface_id, const char* interface_name, int pcap_dlt);
@@ -72,6 +80,7 @@ void (*logpkt_rx_abort_pkt)    (int interface_id, const char* error);
 void (*logpkt_tx_abort_pkt)    (int interface_id, const char* error);
 void (*logpkt_state_save)      (void);
 void (*logpkt_state_restore)   (void);
+void (*logpkt_dump_stats)      (void);
 
 /* public real functions */
 void logpkt_init_interface_op  (int interface_id, const char* interface_name, int pcap_dlt);
@@ -84,6 +93,7 @@ void logpkt_rx_abort_pkt_op    (int interface_id, const char* error);
 void logpkt_tx_abort_pkt_op    (int interface_id, const char* error);
 void logpkt_state_save_op      (void);
 void logpkt_state_restore_op   (void);
+void logpkt_dump_stats_op      (void);
 
 /* public nop functions */
 void logpkt_init_interface_nop (int interface_id, const char* interface_name, int pcap_dlt);
@@ -96,6 +106,7 @@ void logpkt_rx_abort_pkt_nop   (int interface_id, const char* error);
 void logpkt_tx_abort_pkt_nop   (int interface_id, const char* error);
 void logpkt_state_save_nop     (void);
 void logpkt_state_restore_nop  (void);
+void logpkt_dump_stats_nop     (void);
 
 
 #endif //_LOGPKT_H_
@@ -6,9 +6,16 @@
  **/
 
 /**
- * This file uses a global variable to store the linktype, only one packet
- * capture type is available at this time. 
- * Use of multiple interface types will need to modify pcap.c
+ * Standard pcap files have a single link type in their header, only one
+ * packet capture type per node is available with this format.
+ *
+ * pcapng files start with a Section Header Block, each radio interface
+ * is described by its own Interface Description Block and frames are
+ * written as Enhanced Packet Blocks that carry the interface and the
+ * inbound/outbound direction. Both formats can use nanosecond
+ * timestamps.
+ *
+ * Records are appended to the logpkt output buffer, see liblogger/logger_writer.h
  **/
 
 #include <stdlib.h>
@@ -17,6 +24,7 @@
 #include <ctype.h>
 
 #include "arch/common/hardware.h"
+#include "liblogger/logger_writer.h"
 #include "pcap.h"
 
 
@@ -47,39 +55,125 @@ struct pcap_file_header {
 struct pcap_pkthdr {
   //struct timeval ts;     /* time stamp */
   uint32_t tv_sec;       /* pcap uses 32 bits timeval */
-  uint32_t tv_usec;
+  uint32_t tv_usec;      /* or tv_nsec for PCAP_MAGIC_NS */
   uint32_t caplen;       /* length of portion present */
   uint32_t len;          /* length this packet (off wire) */
 };
 
 #define PCAP_MAGIC    0xa1b2c3d4
+#define PCAP_MAGIC_NS 0xa1b23c4d
 #define PCAP_MAJOR    2
 #define PCAP_MINOR    4
 #define PCAP_THISZONE 0
 #define PCAP_SIGFIGS  0
 #define PCAP_SNAPLEN  65536
 
+struct pcapng_block_header {
+  uint32_t type;
+  uint32_t length;       /* total block length, repeated after the body */
+};
+
+struct pcapng_shb {
+  uint32_t magic;        /* byte order magic */
+  uint16_t version_major;
+  uint16_t version_minor;
+  int64_t  section_length;
+};
+
+struct pcapng_idb {
+  uint16_t linktype;
+  uint16_t reserved;
+  uint32_t snaplen;
+};
+
+struct pcapng_epb {
+  uint32_t interface_id;
+  uint32_t ts_high;
+  uint32_t ts_low;
+  uint32_t caplen;
+  uint32_t len;
+};
+
+#define PCAPNG_SHB_TYPE      0x0a0d0d0a
+#define PCAPNG_IDB_TYPE      0x00000001
+#define PCAPNG_EPB_TYPE      0x00000006
+#define PCAPNG_MAGIC         0x1a2b3c4d
+#define PCAPNG_MAJOR         1
+#define PCAPNG_MINOR         0
+
+#define PCAPNG_OPT_ENDOFOPT  0
+#define PCAPNG_OPT_SHB_APPL  4
+#define PCAPNG_OPT_IF_NAME   2
+#define PCAPNG_OPT_IF_TSRES  9
+#define PCAPNG_OPT_EPB_FLAGS 2
+
+#define PCAPNG_EPB_INBOUND   1
+#define PCAPNG_EPB_OUTBOUND  2
+
+#define PCAPNG_MAX_INTERFACES 8
+
+#define PCAP_ALIGN4(x) (((x) + 3) & ~3)
+
+/* ************************************************** */
+/* ************************************************** */
+
+static WSIM_TLS int pcap_dlt  = -1;
+static WSIM_TLS int pcap_nano = 0;
+
+/* pcapng interface index and link type, by logpkt interface id */
+static WSIM_TLS int pcapng_interfaces = 0;
+static WSIM_TLS int pcapng_if_index [PCAPNG_MAX_INTERFACES];
+static WSIM_TLS int pcapng_if_dlt   [PCAPNG_MAX_INTERFACES];
+
 /* ************************************************** */
 /* ************************************************** */
 
-static int pcap_dlt = -1;
+/* frame bytes that are kept in the capture for a given link type */
+static int logpkt_pcap_payload(int linktype, uint8_t *pkt, int size, uint8_t **data, 
+			       uint32_t *caplen, uint32_t *len)
+{
+  int keep;
+
+  switch (linktype) 
+    {
+    case PCAP_DLT_802154:
+      *data        = pkt + 6;
+      keep         = (size - 8);     // remove PREAMB (4) + SFD (1) + LEN (1) + [data] + FCS (2)
+      *len         = (size - 8) + 2; // Including the FCS fields
+      break;
+    default:
+      *data        = pkt;
+      keep         = size;
+      *len         = size;
+      break;
+    }
+
+  if (keep <= 1)
+    {
+      PCAP_DBG("logpkt:pcap:write: packet cancel too short (size %d)\n",size);
+      return 1;
+    }
+  *caplen = keep;
+  return 0;
+}
 
 /* ************************************************** */
 /* ************************************************** */
 
-void logpkt_pcap_start(FILE *logfile, int linktype)
+void logpkt_pcap_start(struct logger_buffer_t *out, int linktype, int nano)
 {
-  size_t shdr;
   struct pcap_file_header hdr; 
 
   if (pcap_dlt != -1)
     {
-      ERROR("logpkt:pcap: only one packet type per node is allowed at this time\n");
+      ERROR("logpkt:pcap: only one packet type per node is allowed with pcap, use pcapng\n");
+      return;
     }
 
-  pcap_dlt = linktype;
+  pcap_dlt  = linktype;
+  pcap_nano = nano;
   
-  hdr.magic         = PCAP_MAGIC; 
+  hdr.magic         = nano ? PCAP_MAGIC_NS : PCAP_MAGIC; 
   hdr.version_major = PCAP_MAJOR;
   hdr.version_minor = PCAP_MINOR;
   hdr.thiszone      = PCAP_THISZONE;
@@ -87,77 +181,183 @@ void logpkt_pcap_start(FILE *logfile, int linktype)
   hdr.snaplen       = PCAP_SNAPLEN;
   hdr.linktype      = pcap_dlt; 
 
-  shdr = sizeof(hdr);
-  if (fwrite(&hdr, shdr, 1, logfile) != 1)
-    {
-      ERROR("wsim:pcap:start: cannot create header\n");
-    }
+  logger_buffer_write(out, &hdr, sizeof(hdr));
   PCAP_DBG("logpkt:pcap:start: header ok, data link type %d\n",linktype);
 }
 
 /* ************************************************** */
 /* ************************************************** */
 
-void logpkt_pcap_close(FILE UNUSED *logfile)
+void logpkt_pcap_close(struct logger_buffer_t UNUSED *out)
 {
-  /* nothing to do for standard pcap files */
+  /* nothing to do for pcap and pcapng files */
 }
 
 /* ************************************************** */
 /* ************************************************** */
 
-void logpkt_pcap_logtx(FILE *logfile, uint8_t *pkt, int size, wsimtime_t start, wsimtime_t UNUSED stop)
+void logpkt_pcap_logtx(struct logger_buffer_t *out, uint8_t *pkt, int size, wsimtime_t start, wsimtime_t UNUSED stop)
 {
   struct pcap_pkthdr hdr;
   uint8_t *pktdata;
-  size_t sw;
-  size_t shdr = sizeof(hdr);
-  wsimtime_t usec = start / 1000;
 
-  hdr.tv_sec     = usec / 1000000;
-  hdr.tv_usec    = usec % 1000000;
-
-  switch (pcap_dlt) 
+  if (logpkt_pcap_payload(pcap_dlt, pkt, size, &pktdata, &hdr.caplen, &hdr.len))
     {
-    case PCAP_DLT_802154:
-      pktdata        = pkt + 6;
-      hdr.caplen     = (size - 8);     // remove PREAMB (4) + SFD (1) + LEN (1) + [data] + FCS (2)
-      hdr.len        = (size - 8) + 2; // Including the FCS fields
-      break;
-    default:
-      pktdata        = pkt;
-      hdr.caplen     = size;
-      hdr.len        = size;
-      break;
+      return;
     }
 
-  if (hdr.caplen <= 1)
+  if (pcap_nano)
     {
-      PCAP_DBG("logpkt:pcap:write: packet cancel too short (size %d)\n",size);
-      return;
+      hdr.tv_sec   = start / 1000000000;
+      hdr.tv_usec  = start % 1000000000;
     }
-
-  if (fwrite(&hdr, shdr, 1, logfile) != 1)
+  else
     {
-      ERROR("logpkt:pcap:write: cannot write packet header\n");
+      wsimtime_t usec = start / 1000;
+      hdr.tv_sec   = usec / 1000000;
+      hdr.tv_usec  = usec % 1000000;
     }
 
-  if ((sw = fwrite(pktdata,1,hdr.caplen,logfile)) != hdr.caplen)
+  logger_buffer_write(out, &hdr, sizeof(hdr));
+  logger_buffer_write(out, pktdata, hdr.caplen);
+  PCAP_DBG("logpkt:pcap:write: pkt size=%d, start=%"PRIu64"\n",hdr.caplen,start);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+
+void logpkt_pcap_logrx(struct logger_buffer_t *out, uint8_t *pkt, int size, wsimtime_t start, wsimtime_t stop)
+{
+  /* standard pcap files do not contain RX/TX indicators */
+  logpkt_pcap_logtx(out,pkt,size,start,stop);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+
+static void logpkt_pcapng_option(struct logger_buffer_t *out, uint16_t code, const void *value, uint16_t length)
+{
+  static const uint8_t pad[4] = { 0, 0, 0, 0 };
+
+  logger_buffer_write(out, &code,   sizeof(code));
+  logger_buffer_write(out, &length, sizeof(length));
+  if (length)
     {
-      ERROR("logpkt:pcap:write: cannot write packet (%d < %d)\n", sw, hdr.caplen);
+      logger_buffer_write(out, value, length);
+      logger_buffer_write(out, pad, PCAP_ALIGN4(length) - length);
     }
-  PCAP_DBG("logpkt:pcap:write: hdr size=%d, pkt size=%d, start=%"PRIu64"\n",shdr,hdr.caplen,start);
+}
+
+#define PCAPNG_OPTION_SIZE(length) (4 + PCAP_ALIGN4(length))
+
+/* ************************************************** */
+/* ************************************************** */
+
+void logpkt_pcapng_start(struct logger_buffer_t *out, int nano)
+{
+  static const char appl[] = "wsim";
+  struct pcapng_block_header bh;
+  struct pcapng_shb shb;
+
+  pcap_nano = nano;
+
+  bh.type               = PCAPNG_SHB_TYPE;
+  bh.length             = sizeof(bh) + sizeof(shb) + 
+                          PCAPNG_OPTION_SIZE(sizeof(appl) - 1) + PCAPNG_OPTION_SIZE(0) + 4;
+  shb.magic             = PCAPNG_MAGIC;
+  shb.version_major     = PCAPNG_MAJOR;
+  shb.version_minor     = PCAPNG_MINOR;
+  shb.section_length    = -1; /* streamed, not known */
+
+  logger_buffer_write(out, &bh,  sizeof(bh));
+  logger_buffer_write(out, &shb, sizeof(shb));
+  logpkt_pcapng_option(out, PCAPNG_OPT_SHB_APPL, appl, sizeof(appl) - 1);
+  logpkt_pcapng_option(out, PCAPNG_OPT_ENDOFOPT, NULL, 0);
+  logger_buffer_write(out, &bh.length, sizeof(bh.length));
+  PCAP_DBG("logpkt:pcapng:start: section header ok\n");
 }
 
 /* ************************************************** */
 /* ************************************************** */
 
-void logpkt_pcap_logrx(FILE *logfile, uint8_t *pkt, int size, wsimtime_t start, wsimtime_t stop)
+void logpkt_pcapng_interface(struct logger_buffer_t *out, int interface_id, const char *name, int linktype)
 {
-  /* standard pcap files do not contain RX/TX indicators */
-  logpkt_pcap_logtx(logfile,pkt,size,start,stop);
+  struct pcapng_block_header bh;
+  struct pcapng_idb idb;
+  uint8_t  tsresol = pcap_nano ? 9 : 6;
+  uint16_t lname   = strlen(name);
+
+  if (interface_id >= PCAPNG_MAX_INTERFACES)
+    {
+      ERROR("logpkt:pcapng: radio interface id (%d) too high\n", interface_id);
+      return;
+    }
+
+  pcapng_if_index[interface_id] = pcapng_interfaces++;
+  pcapng_if_dlt  [interface_id] = linktype;
+
+  bh.type      = PCAPNG_IDB_TYPE;
+  bh.length    = sizeof(bh) + sizeof(idb) + 
+                 PCAPNG_OPTION_SIZE(lname) + PCAPNG_OPTION_SIZE(1) + PCAPNG_OPTION_SIZE(0) + 4;
+  idb.linktype = linktype;
+  idb.reserved = 0;
+  idb.snaplen  = PCAP_SNAPLEN;
+
+  logger_buffer_write(out, &bh,  sizeof(bh));
+  logger_buffer_write(out, &idb, sizeof(idb));
+  logpkt_pcapng_option(out, PCAPNG_OPT_IF_NAME,  name, lname);
+  logpkt_pcapng_option(out, PCAPNG_OPT_IF_TSRES, &tsresol, 1);
+  logpkt_pcapng_option(out, PCAPNG_OPT_ENDOFOPT, NULL, 0);
+  logger_buffer_write(out, &bh.length, sizeof(bh.length));
+  PCAP_DBG("logpkt:pcapng:interface: %s, data link type %d\n",name,linktype);
 }
 
 /* ************************************************** */
 /* ************************************************** */
 
+static void logpkt_pcapng_log(struct logger_buffer_t *out, int interface_id, uint32_t flags,
+			      uint8_t *pkt, int size, wsimtime_t start)
+{
+  static const uint8_t pad[4] = { 0, 0, 0, 0 };
+  struct pcapng_block_header bh;
+  struct pcapng_epb epb;
+  uint8_t *pktdata;
+  uint64_t ts = pcap_nano ? start : start / 1000;
+
+  if (logpkt_pcap_payload(pcapng_if_dlt[interface_id], pkt, size, &pktdata, &epb.caplen, &epb.len))
+    {
+      return;
+    }
+
+  epb.interface_id = pcapng_if_index[interface_id];
+  epb.ts_high      = ts >> 32;
+  epb.ts_low       = ts & 0xffffffff;
+
+  bh.type          = PCAPNG_EPB_TYPE;
+  bh.length        = sizeof(bh) + sizeof(epb) + PCAP_ALIGN4(epb.caplen) +
+                     PCAPNG_OPTION_SIZE(sizeof(flags)) + PCAPNG_OPTION_SIZE(0) + 4;
+
+  logger_buffer_write(out, &bh,  sizeof(bh));
+  logger_buffer_write(out, &epb, sizeof(epb));
+  logger_buffer_write(out, pktdata, epb.caplen);
+  logger_buffer_write(out, pad, PCAP_ALIGN4(epb.caplen) - epb.caplen);
+  logpkt_pcapng_option(out, PCAPNG_OPT_EPB_FLAGS, &flags, sizeof(flags));
+  logpkt_pcapng_option(out, PCAPNG_OPT_ENDOFOPT, NULL, 0);
+  logger_buffer_write(out, &bh.length, sizeof(bh.length));
+  PCAP_DBG("logpkt:pcapng:write: if %d, pkt size=%d, start=%"PRIu64"\n",interface_id,epb.caplen,start);
+}
+
+void logpkt_pcapng_logtx(struct logger_buffer_t *out, int interface_id, uint8_t *pkt, int size, 
+			 wsimtime_t start, wsimtime_t UNUSED stop)
+{
+  logpkt_pcapng_log(out, interface_id, PCAPNG_EPB_OUTBOUND, pkt, size, start);
+}
+
+void logpkt_pcapng_logrx(struct logger_buffer_t *out, int interface_id, uint8_t *pkt, int size, 
+			 wsimtime_t start, wsimtime_t UNUSED stop)
+{
+  logpkt_pcapng_log(out, interface_id, PCAPNG_EPB_INBOUND, pkt, size, start);
+}
+
+/* ************************************************** */
+/* ************************************************** */
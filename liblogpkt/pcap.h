@@ -21,10 +21,21 @@
 
 #define DEFAULT_PCAP_DLT PCAP_DLT_USER0
 
-void logpkt_pcap_start(FILE* logfile, int linktype);
-void logpkt_pcap_close(FILE* logfile);
+struct logger_buffer_t;
 
-void logpkt_pcap_logtx(FILE* logfile, uint8_t *pkt, int size, wsimtime_t start, wsimtime_t stop);
-void logpkt_pcap_logrx(FILE* logfile, uint8_t *pkt, int size, wsimtime_t start, wsimtime_t stop);
+/* nano != 0 selects nanosecond timestamps */
+void logpkt_pcap_start      (struct logger_buffer_t *out, int linktype, int nano);
+void logpkt_pcap_close      (struct logger_buffer_t *out);
+
+void logpkt_pcap_logtx      (struct logger_buffer_t *out, uint8_t *pkt, int size, wsimtime_t start, wsimtime_t stop);
+void logpkt_pcap_logrx      (struct logger_buffer_t *out, uint8_t *pkt, int size, wsimtime_t start, wsimtime_t stop);
+
+void logpkt_pcapng_start    (struct logger_buffer_t *out, int nano);
+void logpkt_pcapng_interface(struct logger_buffer_t *out, int interface_id, const char *name, int linktype);
+
+void logpkt_pcapng_logtx    (struct logger_buffer_t *out, int interface_id, uint8_t *pkt, int size, 
+			     wsimtime_t start, wsimtime_t stop);
+void logpkt_pcapng_logrx    (struct logger_buffer_t *out, int interface_id, uint8_t *pkt, int size, 
+			     wsimtime_t start, wsimtime_t stop);
 
 #endif
@@ -41,11 +41,16 @@
 
 #include "arch/common/hardware.h"
 #include "liblogger/logger.h"
+#include "src/options.h"
 #include "libselect_fifomem.h"
 #include "libselect_socket.h"
 #include "libselect_file.h"
 #include "libselect.h"
 
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
 
 /****************************************
  * For performance purpose and because this
@@ -53,15 +58,8 @@
  * dimensions are fixed
  ****************************************/
 
-#define SELECT_SKIP_UPDATES       0
-
-#if SELECT_SKIP_UPDATES != 0
-#define LIBSELECT_UPDATE_SKIP     200
-#endif
-
 #define DEFAULT_FIFO_SIZE         5120
 #define LIBSELECT_MAX_ENTRY       20
-#define BUFFER_MAX                DEFAULT_FIFO_SIZE /* max 64ko == IP datagram max size */
 
 #define BACKTRACK_DEFAULT_SETTING 1 /* on */
 /****************************************
@@ -108,6 +106,7 @@ struct libselect_entry_t {
   unsigned int              signal;        /* signal associated with fifo events */
 
   int                       backtrack;     /* should we commit on save           */
+  int                       watched;       /* in the epoll interest set          */
 };
 
 struct libselect_t {
@@ -115,29 +114,127 @@ struct libselect_t {
   int state;   /* number of id                    */
 };
 
-static struct libselect_t libselect;
-static int                libselect_init_done = 0;
-static int                libselect_ws_mode   = WS_MODE_WSNET0;
+static WSIM_TLS struct libselect_t libselect;
+static WSIM_TLS int                libselect_init_done = 0;
+static WSIM_TLS int                libselect_backtrack = 0;
+
+/****************************************
+ * polling backend
+ *
+ * select : the fd set is built and polled on each update
+ * epoll  : entries are added to a persistent interest set when they are
+ *          registered, an update is a single epoll_wait() call. Regular
+ *          files cannot be watched by epoll and are polled on each update
+ *          (select reports them as always readable)
+ ****************************************/
+
+enum libselect_backend_t {
+  LIBSELECT_BACKEND_SELECT = 0,
+  LIBSELECT_BACKEND_EPOLL  = 1
+};
+
+static WSIM_TLS int                libselect_backend   = LIBSELECT_BACKEND_SELECT;
+static WSIM_TLS int                libselect_epoll_fd  = -1;
+static WSIM_TLS int                libselect_files     = 0;  /* regular files polled by epoll backend */
+static WSIM_TLS wsimtime_t         libselect_period    = 0;  /* simulated ns between polls, 0 = each update */
+static WSIM_TLS wsimtime_t         libselect_next_poll = 0;
+static WSIM_TLS wsimtime_t         libselect_saved_poll = 0;  /* next poll at state save */
 
 /*****************************************
  * libselect update function pointer
  *
  *****************************************/
 
-int (*libselect_update_ptr)      () = NULL;
+WSIM_TLS int (*libselect_update_ptr)      () = NULL;
 int libselect_update_registered  ();
 
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
 
+static struct moption_t libselect_opt = {
+  .longname    = "libselect",
+  .type        = required_argument,
+  .helpstring  = "i/o polling backend [select|epoll]",
+  .value       = NULL
+};
+
+static struct moption_t libselect_period_opt = {
+  .longname    = "libselect_period",
+  .type        = required_argument,
+  .helpstring  = "i/o polling period in simulated ns (default: every step)",
+  .value       = NULL
+};
+
+int libselect_options_add(void)
+{
+  options_add( &libselect_opt        );
+  options_add( &libselect_period_opt );
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static int libselect_backend_init(void)
+{
+  libselect_backend   = LIBSELECT_BACKEND_SELECT;
+  libselect_epoll_fd  = -1;
+  libselect_files     = 0;
+  libselect_period    = 0;
+  libselect_next_poll = 0;
+  libselect_saved_poll = 0;
+
+  if (libselect_period_opt.isset && libselect_period_opt.value)
+    {
+      libselect_period = strtoull(libselect_period_opt.value, NULL, 10);
+    }
+
+  if (libselect_opt.isset && libselect_opt.value)
+    {
+      if (strcmp(libselect_opt.value, "epoll") == 0)
+	{
+#if defined(HAVE_SYS_EPOLL_H)
+	  if ((libselect_epoll_fd = epoll_create(LIBSELECT_MAX_ENTRY)) == -1)
+	    {
+	      ERROR("wsim:libselect: cannot create epoll descriptor: %s\n", strerror(errno));
+	      return -1;
+	    }
+	  fcntl(libselect_epoll_fd, F_SETFD, FD_CLOEXEC);
+	  libselect_backend = LIBSELECT_BACKEND_EPOLL;
+#else
+	  WARNING("wsim:libselect: epoll is not available, using select\n");
+#endif
+	}
+      else if (strcmp(libselect_opt.value, "select") != 0)
+	{
+	  ERROR("wsim:libselect: unknown backend %s, must be select or epoll\n",libselect_opt.value);
+	  return -1;
+	}
+    }
+
+  DMSG("wsim:libselect: %s backend, poll period %"PRIu64" ns\n",
+       (libselect_backend == LIBSELECT_BACKEND_EPOLL) ? "epoll" : "select", libselect_period);
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 int libselect_init(int ws_mode)
 {
   int id;
   memset(&libselect, 0, sizeof(struct libselect_t));
   libselect_init_done  = 1;
   libselect_update_ptr = NULL;
-  libselect_ws_mode    = ws_mode;
+  libselect_backtrack  = WS_MODE_BACKTRACK(ws_mode);
+
+  if (libselect_backend_init())
+    {
+      return 1;
+    }
 
   for(id=0; id < LIBSELECT_MAX_ENTRY; id++)
     {
@@ -167,6 +264,11 @@ int libselect_close (void)
 	  libselect_id_close(id);
 	}
     }
+  if (libselect_epoll_fd != -1)
+    {
+      close(libselect_epoll_fd);
+      libselect_epoll_fd = -1;
+    }
   return 0;
 }
 
@@ -196,24 +298,187 @@ char* entry_type_str(int type)
 
 static inline int libselect_max(int a, int b) { return ((a)<(b) ? (b):(a)); }
 
-int libselect_update_registered()
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/*
+ * epoll interest set. Entries are added when registered and removed when
+ * unregistered or closed. fd_in changes on TCP_SRV entries (accept and
+ * client close) go through libselect_entry_set_fd_in().
+ */
+
+static void libselect_watch_add(libselect_id_t UNUSED id)
 {
-  int res;
-  int id, n = 0;
-  int fd_max;
-  fd_set readfds;
-  struct timeval timeout;
-  unsigned char buffer[BUFFER_MAX];
+#if defined(HAVE_SYS_EPOLL_H)
+  struct epoll_event ev;
+
+  if (libselect_epoll_fd == -1 || libselect.entry[id].fd_in == -1)
+    return;
 
-#if SELECT_SKIP_UPDATES != 0
-  static int skippy = 0;
-  if (skippy < LIBSELECT_UPDATE_SKIP)
+  memset(&ev, 0, sizeof(ev));
+  ev.events   = EPOLLIN;
+  ev.data.u32 = id;
+  if (epoll_ctl(libselect_epoll_fd, EPOLL_CTL_ADD, libselect.entry[id].fd_in, &ev) == 0)
     {
-      skippy++;
-      return 0;
+      libselect.entry[id].watched = 1;
+    }
+  else if (errno == EPERM)
+    {
+      /* regular file, always readable */
+      libselect.entry[id].watched = 2;
+      libselect_files ++;
+    }
+  else
+    {
+      ERROR("wsim:libselect: cannot watch id %d (fd %d): %s\n",id,
+	    libselect.entry[id].fd_in, strerror(errno));
     }
-  skippy = 0;
 #endif
+}
+
+static void libselect_watch_del(libselect_id_t UNUSED id)
+{
+#if defined(HAVE_SYS_EPOLL_H)
+  struct epoll_event ev;
+
+  switch (libselect.entry[id].watched)
+    {
+    case 1:
+      epoll_ctl(libselect_epoll_fd, EPOLL_CTL_DEL, libselect.entry[id].fd_in, &ev);
+      break;
+    case 2:
+      libselect_files --;
+      break;
+    }
+  libselect.entry[id].watched = 0;
+#endif
+}
+
+static void libselect_entry_set_fd_in(libselect_id_t id, int fd)
+{
+  int watched = libselect.entry[id].watched;
+  libselect_watch_del(id);
+  libselect.entry[id].fd_in = fd;
+  if (watched)
+    {
+      libselect_watch_add(id);
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void libselect_entry_input(libselect_id_t id)
+{
+  int n, lost;
+  int fd_in = libselect.entry[id].fd_in;
+
+  switch (libselect.entry[id].entry_type)
+    {
+    case ENTRY_NONE:
+      ERROR("wsim:libselect:update: select returns on fd entry type NONE (id=%d)\n",id);
+      break;
+      
+    case ENTRY_FILE:
+    case ENTRY_UDP:
+    case ENTRY_TCP:
+    case ENTRY_STDIO:
+      if (libselect.entry[id].entry_type == ENTRY_UDP)
+	n = libselect_fifo_input_recvfd(libselect.entry[id].fifo_input,fd_in,&lost);
+      else
+	n = libselect_fifo_input_readfd(libselect.entry[id].fifo_input,fd_in,&lost);
+      switch (n) 
+	{
+	case -1:
+	  ERROR("wsim:libselect:update: error on descriptor (id=%d:%d) type %s\n",id,fd_in,
+		entry_type_str(libselect.entry[id].entry_type) );
+	case 0:
+	  if (libselect.entry[id].callback)
+	    {
+	      WARNING("wsim:libselect:update: fifo id %d has been closed\n",id);
+	      libselect.entry[id].callback(id,LIBSELECT_EVT_CLOSE,libselect.entry[id].cb_ptr);
+	    }
+	  libselect_id_unregister(id);
+	  break;
+	default:
+	  DMSG("wsim:libselect:update: something to read on id %d = %d bytes\n",id,n);
+	  if (lost > 0)
+	    {
+	      ERROR("wsim: ===========================================\n");
+	      ERROR("wsim: Overrun error on input %d (type %s)\n",id,
+		    entry_type_str(libselect.entry[id].entry_type));
+	      ERROR("wsim: - data have been lost during simulation\n");
+	      ERROR("wsim: - the sender does not set its sending speed according to \n");
+	      ERROR("wsim:   the target capabilities\n");
+	      ERROR("wsim: ===========================================\n");
+	    }
+	  break;
+	}
+      break;
+      
+    case ENTRY_TCP_SRV: /* accept() -> create an open ENTRY_TCP */
+      if (fd_in == libselect.entry[id].skt.socket_listen)
+	{
+	  if (libselect_skt_accept( & libselect.entry[id].skt )) 
+	    {
+	      libselect.entry[id].skt.socket = -1;
+	      libselect_entry_set_fd_in(id, libselect.entry[id].skt.socket_listen);
+	      libselect.entry[id].fd_out     = -1;
+	    }
+	  else
+	    {
+	      DMSG("wsim:libselect:update:accepted connection on port %d\n",libselect.entry[id].skt.port);
+	      libselect_entry_set_fd_in(id, libselect.entry[id].skt.socket);
+	      libselect.entry[id].fd_out = libselect.entry[id].skt.socket;
+	    }
+	}
+      else 
+	{
+	  if ((n = libselect_fifo_input_readfd(libselect.entry[id].fifo_input,fd_in,&lost)) > 0)
+	    {
+	      DMSG("wsim:libselect:update: something to read on id %d = %d bytes\n",id,n);
+	      if (lost > 0)
+		{
+		  ERROR("wsim:libselect:update: fifo overrun on descriptor %d\n",id);
+		}
+	    }
+	  else
+	    {
+	      libselect.entry[id].skt.socket = -1;
+	      libselect_entry_set_fd_in(id, libselect.entry[id].skt.socket_listen);
+	      libselect.entry[id].fd_out     = -1;
+	      DMSG("wsim:libselect:update: read id %d returned %d\n",id,n);
+	      if (libselect.entry[id].callback)
+		{
+		  WARNING("wsim:libselect:update: fifo id %d has been closed\n",id);
+		  libselect.entry[id].callback(id,LIBSELECT_EVT_CLOSE,libselect.entry[id].cb_ptr);
+		}
+	    }
+	}
+      break;
+
+    case ENTRY_WIN32_PIPE:
+      break;
+
+    case ENTRY_FD_ONLY:
+      mcu_signal_add(libselect.entry[id].signal);
+      DMSG("wsim:libselect: something to read on id %d (signal)\n",id);
+      break;
+    } /* switch */
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static int libselect_poll_select(int64_t micro)
+{
+  int id;
+  int fd_max;
+  fd_set readfds;
+  struct timeval timeout;
 
 #if defined(__MINGW32__) 
 	  /* comparison between signed and unsigned warning */
@@ -248,11 +513,15 @@ int libselect_update_registered()
 	}
     }
 
-  timeout.tv_sec = 0;
-  timeout.tv_usec = 0;
-  switch (res = select(fd_max + 1, &readfds, NULL, NULL, &timeout))
+  timeout.tv_sec  = micro / 1000000;
+  timeout.tv_usec = micro % 1000000;
+  switch (select(fd_max + 1, &readfds, NULL, NULL, &timeout))
     {
     case -1: /* error */
+      if (errno == EINTR)
+	{
+	  return 0;
+	}
       perror("wsim:libselect:update: error during select(), host interrupt\n");
       mcu_signal_set(SIG_HOST);
       return 1;
@@ -265,102 +534,133 @@ int libselect_update_registered()
 
   for(id=0; id < LIBSELECT_MAX_ENTRY; id++)
     {
-      int fd_in = libselect.entry[id].fd_in;
-      if (libselect.entry[id].registered && FD_ISSET(fd_in,&readfds))
+      if (libselect.entry[id].registered && FD_ISSET(libselect.entry[id].fd_in,&readfds))
+	{
+	  libselect_entry_input(id);
+	}
+    }
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#if defined(HAVE_SYS_EPOLL_H)
+static int libselect_poll_epoll(void)
+{
+  int i, n;
+  struct epoll_event ev[LIBSELECT_MAX_ENTRY];
+
+  if (libselect_files > 0)
+    {
+      int id;
+      for(id=0; id < LIBSELECT_MAX_ENTRY; id++)
 	{
-	  switch (libselect.entry[id].entry_type)
+	  if (libselect.entry[id].watched == 2)
 	    {
-	    case ENTRY_NONE:
-	      ERROR("wsim:libselect:update: select returns on fd entry type NONE (id=%d)\n",id);
-	      break;
-	      
-	    case ENTRY_FILE:
-	    case ENTRY_UDP:
-	    case ENTRY_TCP:
-	    case ENTRY_STDIO:
-	      switch (n = read(fd_in,buffer,BUFFER_MAX)) 
-		{
-		case -1:
-		  ERROR("wsim:libselect:update: error on descriptor (id=%d:%d) type %s\n",id,fd_in,
-			entry_type_str(libselect.entry[id].entry_type) );
-		case 0:
-		  if (libselect.entry[id].callback)
-		    {
-		      WARNING("wsim:libselect:update: fifo id %d has been closed\n",id);
-		      libselect.entry[id].callback(id,LIBSELECT_EVT_CLOSE,libselect.entry[id].cb_ptr);
-		    }
-		  libselect_id_unregister(id);
-		  break;
-		default:
-		  DMSG("wsim:libselect:update: something to read on id %d = %d bytes\n",id,n);
-		  if (libselect_fifo_input_putblock(libselect.entry[id].fifo_input,buffer,n) < n)
-		    {
-		      ERROR("wsim: ===========================================\n");
-		      ERROR("wsim: Overrun error on input %d (type %s)\n",id,
-		            entry_type_str(libselect.entry[id].entry_type));
-		      ERROR("wsim: - data have been lost during simulation\n");
-		      ERROR("wsim: - the sender does not set its sending speed according to \n");
-		      ERROR("wsim:   the target capabilities\n");
-		      ERROR("wsim: ===========================================\n");
-		    }
-		  break;
-		}
-	      break;
-	      
-	    case ENTRY_TCP_SRV: /* accept() -> create an open ENTRY_TCP */
-	      if (fd_in == libselect.entry[id].skt.socket_listen)
-		{
-		  if (libselect_skt_accept( & libselect.entry[id].skt )) 
-		    {
-		      libselect.entry[id].skt.socket = -1;
-		      libselect.entry[id].fd_in      = libselect.entry[id].skt.socket_listen;
-		      libselect.entry[id].fd_out     = -1;
-		    }
-		  else
-		    {
-		      DMSG("wsim:libselect:update:accepted connection on port %d\n",libselect.entry[id].skt.port);
-		      libselect.entry[id].fd_in  = libselect.entry[id].skt.socket;
-		      libselect.entry[id].fd_out = libselect.entry[id].skt.socket;
-		    }
-		}
-	      else 
-		{
-		  if ((n = read(fd_in,buffer,BUFFER_MAX)) > 0)
-		    {
-		      DMSG("wsim:libselect:update: something to read on id %d = %d bytes\n",id,n);
-		      if (libselect_fifo_input_putblock(libselect.entry[id].fifo_input,buffer,n) < n)
-			{
-			  ERROR("wsim:libselect:update: fifo overrun on descriptor %d\n",id);
-			}
-		    }
-		  else
-		    {
-		      libselect.entry[id].skt.socket = -1;
-		      libselect.entry[id].fd_in      = libselect.entry[id].skt.socket_listen;
-		      libselect.entry[id].fd_out     = -1;
-		      DMSG("wsim:libselect:update: read id %d returned %d\n",id,n);
-		      if (libselect.entry[id].callback)
-			{
-			  WARNING("wsim:libselect:update: fifo id %d has been closed\n",id);
-			  libselect.entry[id].callback(id,LIBSELECT_EVT_CLOSE,libselect.entry[id].cb_ptr);
-			}
-		    }
-		}
-	      break;
-
-	    case ENTRY_WIN32_PIPE:
-	      break;
-
-	    case ENTRY_FD_ONLY:
-	      mcu_signal_add(libselect.entry[id].signal);
-	      DMSG("wsim:libselect: something to read on id %d (signal)\n",id);
-	      break;
-	    } /* switch */
-	} /* if registered and isset */
-    } /* for (id) */
+	      libselect_entry_input(id);
+	    }
+	}
+    }
+
+  if ((n = epoll_wait(libselect_epoll_fd, ev, LIBSELECT_MAX_ENTRY, 0)) == -1)
+    {
+      if (errno == EINTR)
+	{
+	  return 0;
+	}
+      perror("wsim:libselect:update: error during epoll_wait(), host interrupt\n");
+      mcu_signal_set(SIG_HOST);
+      return 1;
+    }
+
+  for(i=0; i < n; i++)
+    {
+      libselect_id_t id = ev[i].data.u32;
+      /* a previous event in the same batch may have unregistered the entry */
+      if (libselect.entry[id].watched == 1)
+	{
+	  libselect_entry_input(id);
+	}
+    }
   return 0;
 }
 
+/*
+ * block on the epoll descriptor itself, select() keeps the microsecond
+ * resolution that epoll_wait() does not have. Input is moved to the
+ * fifos as it arrives, the wait always lasts micro microseconds.
+ */
+static int libselect_wait_epoll(int64_t micro)
+{
+  fd_set readfds;
+  struct timeval timeout;
+  struct timeval now;
+  int64_t end;
+
+  gettimeofday(&now, NULL);
+  end = (int64_t)now.tv_sec * 1000000 + now.tv_usec + micro;
+  while (micro > 0)
+    {
+      FD_ZERO(&readfds);
+      FD_SET(libselect_epoll_fd, &readfds);
+      timeout.tv_sec  = micro / 1000000;
+      timeout.tv_usec = micro % 1000000;
+      if (select(libselect_epoll_fd + 1, &readfds, NULL, NULL, &timeout) > 0)
+	{
+	  if (libselect_poll_epoll())
+	    {
+	      return 1;
+	    }
+	}
+      gettimeofday(&now, NULL);
+      micro = end - ((int64_t)now.tv_sec * 1000000 + now.tv_usec);
+    }
+  return 0;
+}
+#endif
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int libselect_update_registered()
+{
+  if (libselect_period > 0)
+    {
+      if (MACHINE_TIME_GET_NANO() < libselect_next_poll)
+	{
+	  return 0;
+	}
+      libselect_next_poll = MACHINE_TIME_GET_NANO() + libselect_period;
+    }
+
+#if defined(HAVE_SYS_EPOLL_H)
+  if (libselect_backend == LIBSELECT_BACKEND_EPOLL)
+    {
+      return libselect_poll_epoll();
+    }
+#endif
+  return libselect_poll_select(0);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void libselect_wait(int64_t micro)
+{
+#if defined(HAVE_SYS_EPOLL_H)
+  if (libselect_backend == LIBSELECT_BACKEND_EPOLL && libselect.state > 0 && libselect_files == 0)
+    {
+      libselect_wait_epoll(micro);
+      return;
+    }
+#endif
+  usleep(micro);
+}
+
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
@@ -642,6 +942,7 @@ inline int libselect_id_is_valid(libselect_id_t id)
 
 int libselect_id_close(libselect_id_t id)
 {
+  libselect_watch_del(id);
   switch (libselect.entry[id].entry_type)
     {
     case ENTRY_NONE:
@@ -730,6 +1031,7 @@ int libselect_id_register(libselect_id_t id)
   libselect.entry[id].registered = 1;
   libselect.state               += 1;
   libselect_update_ptr           = libselect_update_registered;
+  libselect_watch_add(id);
 
   return 0;
 }
@@ -758,6 +1060,7 @@ int libselect_id_unregister(libselect_id_t id)
       return 1;
     }
 
+  libselect_watch_del(id);
   libselect.entry[id].registered  = 0;
   libselect.state                -= 1;
   if (libselect.state == 0)
@@ -794,7 +1097,7 @@ uint32_t libselect_id_read(libselect_id_t id, uint8_t *data, uint32_t size)
   uint32_t ret = 0;
   if (libselect.entry[id].fifo_input)
     {
-      if (libselect.entry[id].backtrack && (libselect_ws_mode != WS_MODE_WSNET0))
+      if (libselect.entry[id].backtrack && libselect_backtrack)
 	{
 	  ret = libselect_fifo_input_readblock(libselect.entry[id].fifo_input,data,size);
 	  if (ret > 0)
@@ -827,7 +1130,7 @@ uint32_t libselect_id_write(libselect_id_t id, uint8_t *data, uint32_t size)
   uint32_t ret = -1;
   if (libselect.entry[id].fd_out != -1)
     {
-      if (libselect.entry[id].backtrack && (libselect_ws_mode != WS_MODE_WSNET0))
+      if (libselect.entry[id].backtrack && libselect_backtrack)
 	{
 	  ret = libselect_fifo_output_putblock (libselect.entry[id].fifo_output, data, size);
 	  DMSG_BK("wsim:libselect:bk: WRITE %d bytes to id=%d, fd=%d, fifo=%04d\n",
@@ -887,6 +1190,7 @@ int libselect_fd_register(int fd, unsigned int signal)
 	  libselect.entry[id].backtrack  = 0;
 	  libselect.state               += 1;
 	  libselect_update_ptr           = libselect_update_registered;
+	  libselect_watch_add(id);
 	  return id;
 	}
     }
@@ -906,6 +1210,7 @@ int libselect_fd_unregister(int fd)
 	  libselect.entry[id].fd_in      == fd            &&
 	  libselect.entry[id].registered == 1 )
 	{
+	  libselect_watch_del(id);
 	  libselect.entry[id].entry_type = ENTRY_NONE;
 	  libselect.entry[id].fd_in      = -1;
 	  libselect.entry[id].fd_out     = -1;
@@ -928,11 +1233,22 @@ int libselect_fd_unregister(int fd)
 /* ************************************************** */
 /* ************************************************** */
 
+void libselect_set_backtrack(int on)
+{
+  libselect_backtrack = on;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 void libselect_state_save(void)
 {
   int size;
-  uint8_t data[BUFFER_MAX];
   libselect_id_t id;
+
+  /* polls are scheduled in simulated time, they are replayed after a restore */
+  libselect_saved_poll = libselect_next_poll;
   for(id=0; id < LIBSELECT_MAX_ENTRY; id++)
     {
       if (libselect_id_is_valid(id) && 
@@ -949,14 +1265,13 @@ void libselect_state_save(void)
 	    }
 
 	  /* output 
-	   *   - write the whole fifo content  
+	   *   - write the whole fifo content, a single writev() per
+	   *     rendez-vous straight from the fifo memory
 	   */
 	  size = libselect_fifo_output_avail ( libselect.entry[id].fifo_output );
 	  if (size > 0)
 	    {
-	      libselect_fifo_output_getblock    ( libselect.entry[id].fifo_output, data, size );
-	      libselect_fifo_output_flush       ( libselect.entry[id].fifo_output) ;
-	      if (write(libselect.entry[id].fd_out, data, size) != size)
+	      if (libselect_fifo_output_writefd ( libselect.entry[id].fifo_output, libselect.entry[id].fd_out ) != size)
 		{
 		  ERROR("wsim:libselect:bk: error on write id=%d, fd=%d\n",
 			id,libselect.entry[id].fd_out);
@@ -984,6 +1299,8 @@ void libselect_state_restore(void)
 {
   int UNUSED size;
   libselect_id_t id;
+
+  libselect_next_poll = libselect_saved_poll;
   for(id=0; id < LIBSELECT_MAX_ENTRY; id++)
     {
       if (libselect_id_is_valid(id) &&
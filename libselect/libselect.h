@@ -9,6 +9,8 @@
 #ifndef LIBSELECT_H
 #define LIBSELECT_H
 
+#include "arch/common/debug.h"
+
 /***************************************************/
 /***************************************************/
 /***************************************************/
@@ -51,17 +53,32 @@ int libselect_init(int ws_mode);
  */
 int libselect_close(void);
 
+/**
+ * libselect_options_add is called from main() before option parsing.
+ * --libselect selects the polling backend (select or epoll) and
+ * --libselect_period the simulated time between two polls
+ */
+int libselect_options_add(void);
+
+/**
+ * libselect_wait is used by the realtime mode to wait for micro
+ * microseconds. The epoll backend blocks on registered descriptors and
+ * moves incoming data to the fifos during the wait
+ */
+void libselect_wait(int64_t micro);
+
 
 /**
  * libselect_update is called from main event loop, pointer is set to 
  * NULL when no handler has been registered.
  */
-extern int  (*libselect_update_ptr) (void);
+extern WSIM_TLS int  (*libselect_update_ptr) (void);
 
 #define LIBSELECT_UPDATE()                    \
 do {                                          \
   if (libselect_update_ptr != NULL)           \
-    libselect_update_ptr();                   \
+    MACHINE_PROF(MPROF_LIBSELECT,             \
+                 libselect_update_ptr());     \
 } while (0)
 
 
@@ -124,6 +141,9 @@ int libselect_fd_unregister  (int fd);
 void libselect_state_save    (void);
 void libselect_state_restore (void);
 
+/* fifos are read and written at state saves, set at init for the wsnet modes */
+void libselect_set_backtrack (int on);
+
 /***************************************************/
 /***************************************************/
 /***************************************************/
@@ -12,8 +12,16 @@
 #include <errno.h>
 #include <stdio.h>
 #include <assert.h>
+#include <unistd.h>
 
 #include "config.h"
+#if defined(HAVE_SYS_UIO_H)
+#include <sys/uio.h>
+#if !defined(__MINGW32__)
+#define LIBSELECT_FIFO_RECVMSG 1
+#include <sys/socket.h>
+#endif
+#endif
 #include "liblogger/logger.h"
 #include "libselect_fifomem.h"
 
@@ -51,12 +59,22 @@
 /* ************************************************** */     
 /* ************************************************** */     
 
+/* input dropped when the fifo is full, read by chunks of */
+#define LIBSELECT_FIFO_DROP 512
+
+/*
+ * fifo sizes are rounded up to a power of 2, pointers wrap with a mask.
+ * Descriptors are read and written straight from/to the fifo memory,
+ * the free or used area is at most 2 regions, [ptr,size[ and [0,ptr'[
+ */
+
 struct libselect_fifo_output_struct_t {
   unsigned char*  val;
   unsigned int    read_ptr;
   unsigned int    write_ptr;
   unsigned int    state;
   unsigned int    size;
+  unsigned int    mask;
   int             id;
 };
 
@@ -68,6 +86,7 @@ struct libselect_fifo_input_struct_t {
   unsigned int    state;
   unsigned int    state_virtual;
   unsigned int    size;
+  unsigned int    mask;
   int             id;
 };
 
@@ -75,6 +94,77 @@ struct libselect_fifo_input_struct_t {
 /* ************************************************** */     
 /* ************************************************** */     
 
+#if !defined(HAVE_SYS_UIO_H)
+struct iovec {
+  void   *iov_base;
+  size_t  iov_len;
+};
+#endif
+
+static unsigned int libselect_fifo_pow2(int size)
+{
+  unsigned int p = 1;
+  while (p < (unsigned int)size)
+    {
+      p <<= 1;
+    }
+  return p;
+}
+
+/* len bytes from ptr, returns the number of regions */
+static int libselect_fifo_iov(unsigned char *val, unsigned int size, unsigned int ptr, 
+			      unsigned int len, struct iovec *iov)
+{
+  unsigned int part1 = size - ptr;
+
+  iov[0].iov_base = val + ptr;
+  if (len <= part1)
+    {
+      iov[0].iov_len = len;
+      return 1;
+    }
+  iov[0].iov_len  = part1;
+  iov[1].iov_base = val;
+  iov[1].iov_len  = len - part1;
+  return 2;
+}
+
+static int libselect_fifo_readv(int fd, struct iovec *iov, int cnt)
+{
+#if defined(HAVE_SYS_UIO_H)
+  return readv(fd, iov, cnt);
+#else
+  /* the second region is read on the next call */
+  return read(fd, iov[0].iov_base, iov[0].iov_len);
+#endif
+}
+
+static int libselect_fifo_writev(int fd, struct iovec *iov, int cnt)
+{
+#if defined(HAVE_SYS_UIO_H)
+  return writev(fd, iov, cnt);
+#else
+  int i, n, total = 0;
+  for(i=0; i < cnt; i++)
+    {
+      if ((n = write(fd, iov[i].iov_base, iov[i].iov_len)) < 0)
+	{
+	  return -1;
+	}
+      total += n;
+      if ((size_t)n < iov[i].iov_len)
+	{
+	  break;
+	}
+    }
+  return total;
+#endif
+}
+
+/* ************************************************** */     
+/* ************************************************** */     
+/* ************************************************** */     
+
 libselect_fifo_output_t libselect_fifo_output_create(int id, int size)
 {
   struct libselect_fifo_output_struct_t *fifo = NULL;
@@ -87,15 +177,16 @@ libselect_fifo_output_t libselect_fifo_output_create(int id, int size)
 
   memset(fifo,0,sizeof(struct libselect_fifo_output_struct_t));
 
-  if ((fifo->val = (unsigned char*)malloc(sizeof(unsigned char)*size)) == NULL)
+  fifo->id   = id;
+  fifo->size = libselect_fifo_pow2(size);
+  fifo->mask = fifo->size - 1;
+
+  if ((fifo->val = (unsigned char*)malloc(sizeof(unsigned char)*fifo->size)) == NULL)
     {
       ERROR("libselect_fifo: malloc error [%s]\n",strerror(errno));
       free(fifo);
       return NULL;
     }
-
-  fifo->id   = id;
-  fifo->size = size;
   return fifo;
 }
 
@@ -178,7 +269,7 @@ int libselect_fifo_output_putblock(libselect_fifo_output_t fifo, unsigned char *
     }
 
   fifo->state     =  fifo->state     + size;
-  fifo->write_ptr = (fifo->write_ptr + size) % fifo->size;
+  fifo->write_ptr = (fifo->write_ptr + size) & fifo->mask;
   DEBUG_OUTPUT("putblock2");
   
   return size;
@@ -219,7 +310,7 @@ int libselect_fifo_output_getblock(libselect_fifo_output_t fifo, unsigned char *
     }
 
   fifo->state    =  fifo->state    - size;
-  fifo->read_ptr = (fifo->read_ptr + size) % fifo->size;
+  fifo->read_ptr = (fifo->read_ptr + size) & fifo->mask;
 
   DEBUG_OUTPUT("getblock2");
   return size;
@@ -229,6 +320,25 @@ int libselect_fifo_output_getblock(libselect_fifo_output_t fifo, unsigned char *
 /* ************************************************** */     
 /* ************************************************** */     
 
+int libselect_fifo_output_writefd(libselect_fifo_output_t fifo, int fd)
+{
+  struct iovec iov[2];
+  int n = 0;
+
+  if (fifo->state > 0)
+    {
+      DMSG("libselect_fifo:output:%02d: write fd %d, %d bytes\n",fifo->id,fd,fifo->state);
+      DEBUG_OUTPUT("writefd");
+      n = libselect_fifo_writev(fd, iov, libselect_fifo_iov(fifo->val, fifo->size, fifo->read_ptr, fifo->state, iov));
+    }
+  libselect_fifo_output_flush(fifo);
+  return n;
+}
+
+/* ************************************************** */     
+/* ************************************************** */     
+/* ************************************************** */     
+
 #define DEBUG_INPUT(msg)						\
   do {                                                                  \
     DMSG2("libselect_fifo:input:%02d:%-15s read %03d,%03d write %03d state=%03d,%03d/%3d\n", \
@@ -254,15 +364,16 @@ libselect_fifo_input_t libselect_fifo_input_create(int id, int size)
 
   memset(fifo,0,sizeof(struct libselect_fifo_input_struct_t));
 
-  if ((fifo->val = (unsigned char*)malloc(sizeof(unsigned char)*size)) == NULL)
+  fifo->id   = id;
+  fifo->size = libselect_fifo_pow2(size);
+  fifo->mask = fifo->size - 1;
+
+  if ((fifo->val = (unsigned char*)malloc(sizeof(unsigned char)*fifo->size)) == NULL)
     {
       ERROR("libselect_fifo: malloc error [%s]\n",strerror(errno));
       free(fifo);
       return NULL;
     }
-
-  fifo->id   = id;
-  fifo->size = size;
   return fifo;
 }
 
@@ -333,7 +444,7 @@ int libselect_fifo_input_putblock(libselect_fifo_input_t fifo, unsigned char *da
 
   fifo->state         =  fifo->state         + size;
   fifo->state_virtual =  fifo->state_virtual + size;
-  fifo->write_ptr     = (fifo->write_ptr + size) % fifo->size;
+  fifo->write_ptr     = (fifo->write_ptr + size) & fifo->mask;
   DEBUG_INPUT("putblock2");
   
   return size;
@@ -343,6 +454,105 @@ int libselect_fifo_input_putblock(libselect_fifo_input_t fifo, unsigned char *da
 /* ************************************************** */     
 /* ************************************************** */     
 
+int libselect_fifo_input_readfd(libselect_fifo_input_t fifo, int fd, int *lost)
+{
+  struct iovec iov[2];
+  unsigned int len = fifo->size - fifo->state;
+  int n;
+
+  *lost = 0;
+  if (len == 0)
+    {
+      unsigned char drop[LIBSELECT_FIFO_DROP];
+      if ((n = read(fd, drop, LIBSELECT_FIFO_DROP)) > 0)
+	{
+	  *lost = n;
+	}
+      return n;
+    }
+
+  DEBUG_INPUT("readfd1");
+  n = libselect_fifo_readv(fd, iov, libselect_fifo_iov(fifo->val, fifo->size, fifo->write_ptr, len, iov));
+  if (n > 0)
+    {
+      DMSG("libselect_fifo:input:%02d: read fd %d, %d bytes\n",fifo->id,fd,n);
+      fifo->state         =  fifo->state         + n;
+      fifo->state_virtual =  fifo->state_virtual + n;
+      fifo->write_ptr     = (fifo->write_ptr + n) & fifo->mask;
+      DEBUG_INPUT("readfd2");
+    }
+  return n;
+}
+
+/* ************************************************** */     
+/* ************************************************** */     
+/* ************************************************** */     
+
+/*
+ * a datagram larger than the free space is truncated by the read, the
+ * end of the datagram is counted as lost. MSG_TRUNC makes recvmsg()
+ * return the datagram length, hosts that return the copied length
+ * only set the flag and a single lost byte is counted.
+ */
+int libselect_fifo_input_recvfd(libselect_fifo_input_t fifo, int fd, int *lost)
+{
+#if defined(LIBSELECT_FIFO_RECVMSG)
+  struct iovec  iov[2];
+  struct msghdr msg;
+  unsigned char drop[LIBSELECT_FIFO_DROP];
+  unsigned int  len = fifo->size - fifo->state;
+  int n;
+
+  *lost = 0;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  if (len == 0)
+    {
+      iov[0].iov_base = drop;
+      iov[0].iov_len  = LIBSELECT_FIFO_DROP;
+      msg.msg_iovlen  = 1;
+    }
+  else
+    {
+      msg.msg_iovlen  = libselect_fifo_iov(fifo->val, fifo->size, fifo->write_ptr, len, iov);
+    }
+
+  if ((n = recvmsg(fd, &msg, MSG_TRUNC)) <= 0)
+    {
+      return n;
+    }
+
+  if (len == 0)
+    {
+      *lost = n;
+      return n;
+    }
+
+  if ((unsigned int)n > len)
+    {
+      *lost = n - len;
+      n     = len;
+    }
+  else if (msg.msg_flags & MSG_TRUNC)
+    {
+      *lost = 1;
+    }
+
+  DMSG("libselect_fifo:input:%02d: recv fd %d, %d bytes, %d lost\n",fifo->id,fd,n,*lost);
+  fifo->state         =  fifo->state         + n;
+  fifo->state_virtual =  fifo->state_virtual + n;
+  fifo->write_ptr     = (fifo->write_ptr + n) & fifo->mask;
+  DEBUG_INPUT("recvfd");
+  return n;
+#else
+  return libselect_fifo_input_readfd(fifo, fd, lost);
+#endif
+}
+
+/* ************************************************** */     
+/* ************************************************** */     
+/* ************************************************** */     
+
 int libselect_fifo_input_getblock(libselect_fifo_input_t fifo, unsigned char *data, unsigned int size)
 {
   int r1,r2;
@@ -393,7 +603,7 @@ int libselect_fifo_input_readblock(libselect_fifo_input_t fifo, unsigned char *d
     }
 
   fifo->state_virtual    =  fifo->state_virtual    - size;
-  fifo->read_ptr_virtual = (fifo->read_ptr_virtual + size) % fifo->size;
+  fifo->read_ptr_virtual = (fifo->read_ptr_virtual + size) & fifo->mask;
 
   DEBUG_INPUT("readblock2");
   DMSG("libselect_fifo:input:%02d:readblock stop\n",fifo->id);
@@ -21,6 +21,9 @@
  * input fifo 
  *    writes are coming from outside world
  *    read can be cancelled on backtracks
+ *
+ * readfd/writefd move data between a descriptor and the fifo memory
+ * with a single readv()/writev(), without intermediate buffer
  */
 
 typedef struct libselect_fifo_input_struct_t  *libselect_fifo_input_t;
@@ -37,6 +40,10 @@ int  libselect_fifo_input_getblock   (libselect_fifo_input_t fifo, unsigned char
 int  libselect_fifo_input_readblock  (libselect_fifo_input_t fifo, unsigned char *data, unsigned int size);
 int  libselect_fifo_input_readcommit (libselect_fifo_input_t fifo);
 int  libselect_fifo_input_readcancel (libselect_fifo_input_t fifo);
+/* returns the read() result, bytes dropped on a full fifo are in lost */
+int  libselect_fifo_input_readfd     (libselect_fifo_input_t fifo, int fd, int *lost);
+/* readfd for datagram sockets, the truncated end of a datagram is lost */
+int  libselect_fifo_input_recvfd     (libselect_fifo_input_t fifo, int fd, int *lost);
 
 libselect_fifo_output_t libselect_fifo_output_create (int id, int size);
 void                    libselect_fifo_output_delete (libselect_fifo_output_t fifo);
@@ -44,5 +51,7 @@ int  libselect_fifo_output_avail      (libselect_fifo_output_t fifo);
 int  libselect_fifo_output_putblock   (libselect_fifo_output_t fifo, unsigned char *data, unsigned int size);
 int  libselect_fifo_output_getblock   (libselect_fifo_output_t fifo, unsigned char *data, unsigned int size);
 int  libselect_fifo_output_flush      (libselect_fifo_output_t fifo);
+/* writes and flushes the whole fifo, returns the write() result */
+int  libselect_fifo_output_writefd    (libselect_fifo_output_t fifo, int fd);
 
 #endif
@@ -25,6 +25,9 @@
 #include "tracer_int.h"
 #include "tracer_bin.h"
 #include "tracer_vcd.h"
+#if defined(TRACER_WRITER)
+#include "liblogger/logger_writer.h"
+#endif
 
 void app_exit_error();
 
@@ -34,23 +37,27 @@ void app_exit_error();
 
 /* values that are not saved during a state_save */
 
-tracer_state_t tracer_current;
-
-int32_t                    tracer_node_id       = 0xFFFF;
-tracer_time_t              tracer_initial_time  = 0;
-char                       tracer_id_name        [TRACER_MAX_ID][TRACER_MAX_NAME_LENGTH];
-char                       tracer_id_module      [TRACER_MAX_ID][TRACER_MAX_NAME_LENGTH];
-uint8_t                    tracer_width          [TRACER_MAX_ID];
-tracer_sample_t            tracer_buffer         [TRACER_BLOCK_EV];
-unsigned int               TRACER_BLOCK_THRESHOLD;
-
-get_nanotime_function_t    tracer_get_nanotime  = NULL;
-
-static tracer_state_t      tracer_saved;
-static tracer_id_t         tracer_registered_id = 0; /* registered id from simulation */
-static char               *tracer_filename      = NULL;
-static int                 tracer_init_done     = 0;
-static enum wsens_mode_t   tracer_ws_mode;
+WSIM_TLS tracer_state_t tracer_current;
+
+WSIM_TLS int32_t                    tracer_node_id       = 0xFFFF;
+WSIM_TLS tracer_time_t              tracer_initial_time  = 0;
+WSIM_TLS char                       tracer_id_name        [TRACER_MAX_ID][TRACER_MAX_NAME_LENGTH];
+WSIM_TLS char                       tracer_id_module      [TRACER_MAX_ID][TRACER_MAX_NAME_LENGTH];
+WSIM_TLS uint8_t                    tracer_width          [TRACER_MAX_ID];
+WSIM_TLS tracer_sample_t           *tracer_buffer         = NULL;
+WSIM_TLS unsigned int               TRACER_BLOCK_THRESHOLD;
+
+WSIM_TLS get_nanotime_function_t    tracer_get_nanotime  = NULL;
+
+static WSIM_TLS tracer_state_t      tracer_saved;
+static WSIM_TLS tracer_id_t         tracer_registered_id = 0; /* registered id from simulation */
+static WSIM_TLS char               *tracer_filename      = NULL;
+static WSIM_TLS int                 tracer_init_done     = 0;
+static WSIM_TLS int                 tracer_backtrack     = 0; /* blocks are written at state saves */
+#if defined(TRACER_WRITER)
+static WSIM_TLS struct logger_writer_t *tracer_writer = NULL;
+static WSIM_TLS struct logger_buffer_t  tracer_block;         /* owns tracer_buffer */
+#endif
 
 /* block access macro */
 #define tracer_end_of_block(e)   ((e & TRACER_BLOCK_EV) == TRACER_BLOCK_EV)
@@ -60,9 +67,9 @@ static enum wsens_mode_t   tracer_ws_mode;
 /* ************************************************** */
 
 /* start/stop recording event */
-void  (*tracer_event_record_ptr)               (tracer_id_t id, tracer_val_t val);
-void  (*tracer_event_record_force_ptr)         (tracer_id_t id, tracer_val_t val);
-void  (*tracer_event_record_time_ptr)          (tracer_id_t id, tracer_val_t val, tracer_time_t time);
+WSIM_TLS void  (*tracer_event_record_ptr)               (tracer_id_t id, tracer_val_t val);
+WSIM_TLS void  (*tracer_event_record_force_ptr)         (tracer_id_t id, tracer_val_t val);
+WSIM_TLS void  (*tracer_event_record_time_ptr)          (tracer_id_t id, tracer_val_t val, tracer_time_t time);
 
 static void tracer_event_record_active         (tracer_id_t id, tracer_val_t val);
 static void tracer_event_record_active_ws      (tracer_id_t id, tracer_val_t val);
@@ -79,10 +86,11 @@ static void tracer_event_record_time_nocheck   (tracer_id_t id, tracer_val_t val
 /* ************************************************** */
 /* ************************************************** */
 
-void (*tracer_dump_data)      (void);
-void (*tracer_output_close)   (void);
-void (*tracer_start_internal) (void);
-void (*tracer_stop_internal)  (void);
+WSIM_TLS tracer_dump_function_t tracer_dump_data;
+WSIM_TLS void *tracer_dump_arg;
+WSIM_TLS void (*tracer_output_close)   (void);
+WSIM_TLS void (*tracer_start_internal) (void);
+WSIM_TLS void (*tracer_stop_internal)  (void);
 
 void
 tracer_output_open(char *filename)
@@ -105,7 +113,7 @@ tracer_output_open(char *filename)
 	  OUTPUT("wsim:tracer: write buffer threshold set to %d\n",TRACER_BLOCK_THRESHOLD);
 	  tptr[0] = 0;
 	}
-      tracer_vcd_open(fptr);
+      tracer_dump_arg        = tracer_vcd_open(fptr);
       tracer_dump_data       = tracer_vcd_dump_data;
       tracer_output_close    = tracer_vcd_close;
       tracer_start_internal  = tracer_vcd_start;
@@ -117,9 +125,9 @@ tracer_output_open(char *filename)
   else /* default */ 
     { 
       if (strstr(filename,"bin:") == filename)
-	tracer_binary_open(filename + 4);
+	tracer_dump_arg = tracer_binary_open(filename + 4);
       else
-	tracer_binary_open(filename);
+	tracer_dump_arg = tracer_binary_open(filename);
 
       tracer_dump_data       = tracer_binary_dump_data;
       tracer_output_close    = tracer_binary_close;
@@ -132,12 +140,59 @@ tracer_output_open(char *filename)
 /* ************************************************** */
 /* ************************************************** */
 
+#if defined(TRACER_WRITER)
+/*
+ * blocks are written by the logger writer thread, data dumps get their
+ * function and file from the writer argument and not from the
+ * simulation thread variables
+ */
+struct tracer_writer_arg_t {
+  tracer_dump_function_t  dump;
+  void                   *arg;
+};
+
+static WSIM_TLS struct tracer_writer_arg_t tracer_writer_arg;
+
+static int
+tracer_writer_output(void *arg, const uint8_t *data, uint32_t size)
+{
+  struct tracer_writer_arg_t *w = (struct tracer_writer_arg_t*)arg;
+  w->dump(w->arg, (tracer_sample_t*)data, size / sizeof(tracer_sample_t));
+  return 0;
+}
+#endif
+
+/*
+ * write the current block, the block is handed to the writer thread
+ * when it is running and recording goes on in a new block
+ */
+static void
+tracer_flush(void)
+{
+#if defined(TRACER_WRITER)
+  if (tracer_writer != NULL)
+    {
+      tracer_block.size = EVENT_TRACER.ev_count * sizeof(tracer_sample_t);
+      logger_writer_push(tracer_writer, &tracer_block);
+      tracer_buffer = (tracer_sample_t*)tracer_block.data;
+      EVENT_TRACER.ev_count = 0;
+      return;
+    }
+#endif
+  tracer_dump_data(tracer_dump_arg, tracer_buffer, EVENT_TRACER.ev_count);
+  EVENT_TRACER.ev_count = 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 void
 tracer_init(char *filename, int ws_mode)
 {
   int id;
 
-  tracer_ws_mode = ws_mode;
+  tracer_backtrack = WS_MODE_BACKTRACK(ws_mode);
 
   if (filename == NULL)
     return ;
@@ -156,6 +211,37 @@ tracer_init(char *filename, int ws_mode)
   EVENT_TRACER.ev_count_total = 0;;
   tracer_stop();
   tracer_output_open(filename);
+
+#if defined(TRACER_WRITER)
+  /* blocks are swapped with the writer ones */
+  tracer_writer_arg.dump = tracer_dump_data;
+  tracer_writer_arg.arg  = tracer_dump_arg;
+  if (logger_buffer_alloc(&tracer_block, sizeof(tracer_sample_t) * TRACER_BLOCK_EV) == 0 &&
+      (tracer_writer = logger_writer_start(tracer_writer_output, &tracer_writer_arg, 1,
+					   sizeof(tracer_sample_t) * TRACER_BLOCK_EV)) != NULL)
+    {
+      tracer_buffer = (tracer_sample_t*)tracer_block.data;
+      if (! logger_writer_threaded(tracer_writer))
+	{
+	  WARNING("tracer: cannot start the writer thread, trace is written by the simulation\n");
+	}
+    }
+  else
+    {
+      logger_buffer_free(&tracer_block);
+    }
+#endif
+
+  /* allocated here rather than in bss, one buffer per simulated node */
+  if (tracer_buffer == NULL)
+    {
+      tracer_buffer = (tracer_sample_t*)malloc(sizeof(tracer_sample_t) * TRACER_BLOCK_EV);
+    }
+  if (tracer_buffer == NULL)
+    {
+      ERROR("tracer: cannot allocate the event buffer\n");
+      return ;
+    }
   tracer_init_done = 1;
 }
 
@@ -175,9 +261,21 @@ void tracer_set_timeref(get_nanotime_function_t fun)
 void
 tracer_close(void)
 {
-  tracer_dump_data();
+  tracer_flush();
+#if defined(TRACER_WRITER)
+  if (tracer_writer != NULL)
+    {
+      /* dump functions do not report errors */
+      logger_writer_stop(tracer_writer);
+      logger_buffer_free(&tracer_block);
+      tracer_writer = NULL;
+      tracer_buffer = NULL;
+    }
+#endif
   tracer_stop_internal();
   tracer_output_close();
+  free(tracer_buffer);
+  tracer_buffer = NULL;
   DMSG_TRACER("tracer: close ok\n");
 }
 
@@ -188,7 +286,7 @@ tracer_close(void)
 void
 tracer_start(void)
 {
-  static char first_start = 1;
+  static WSIM_TLS char first_start = 1;
   if (tracer_init_done == 1)
     { 
       if (first_start == 1)
@@ -197,7 +295,7 @@ tracer_start(void)
 	  first_start = 0;
 	}
 
-      if (tracer_ws_mode == WS_MODE_WSNET0)
+      if (! tracer_backtrack)
 	{
 	  tracer_event_record_ptr       = tracer_event_record_active;
 	  tracer_event_record_force_ptr = tracer_event_record_active_force;
@@ -229,6 +327,19 @@ void tracer_stop(void)
 /* ************************************************** */
 /* ************************************************** */
 
+void tracer_set_backtrack(int on)
+{
+  tracer_backtrack = on;
+  if (tracer_event_record_ptr != NULL)
+    {
+      tracer_start();
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 tracer_id_t
 tracer_event_add_id(int width, const char* name, const char* module)
 {
@@ -273,7 +384,10 @@ tracer_event_add_id(int width, const char* name, const char* module)
   tracer_width[id] = width;
 
   DMSG_TRACER("tracer:add:id: %02d=%-10s module=%-10s\n",id,name,module);
-  tracer_event_record_time_nocheck(id,0,0);
+  if (tracer_buffer != NULL)
+    {
+      tracer_event_record_time_nocheck(id,0,0);
+    }
   return id;
 }
 
@@ -347,7 +461,7 @@ tracer_event_record_active_time(tracer_id_t id, tracer_val_t val, tracer_time_t
     }
   if (EVENT_TRACER.ev_count > TRACER_BLOCK_THRESHOLD)
     {
-      tracer_dump_data();
+      tracer_flush();
     }
 }
 
@@ -372,7 +486,7 @@ tracer_event_record_active(tracer_id_t id, tracer_val_t val)
     }
   if (EVENT_TRACER.ev_count > TRACER_BLOCK_THRESHOLD)
     {
-      tracer_dump_data();
+      tracer_flush();
     }
 }
 
@@ -401,7 +515,7 @@ tracer_event_record_active_force(tracer_id_t id, tracer_val_t val)
     }
   if (EVENT_TRACER.ev_count > TRACER_BLOCK_THRESHOLD)
     {
-      tracer_dump_data();
+      tracer_flush();
     }
 }
 
@@ -426,7 +540,7 @@ tracer_state_save(void)
 {
   if (EVENT_TRACER.ev_count > TRACER_BLOCK_THRESHOLD)
     {
-      tracer_dump_data();
+      tracer_flush();
     }
   memcpy(&tracer_saved, &tracer_current, sizeof(tracer_state_t));
 }
@@ -445,6 +559,25 @@ tracer_state_restore(void)
 /* ************************************************** */
 /* ************************************************** */
 
+void
+tracer_dump_stats(void)
+{
+#if defined(TRACER_WRITER)
+  if (tracer_writer != NULL)
+    {
+      struct logger_writer_stats_t st;
+      logger_writer_stats(tracer_writer, &st);
+      OUTPUT_STATS("  tracer blocks written         : %d (%"PRIu64" events)\n", 
+		   st.buffers, (uint64_t)(st.bytes / sizeof(tracer_sample_t)));
+      OUTPUT_STATS("  tracer writer stalls          : %d (%"PRIu64" ms)\n", st.stalls, st.stall_time / (1000*1000));
+    }
+#endif
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 void tracer_set_node_id(int id)
 {
   tracer_node_id = id;
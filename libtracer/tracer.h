@@ -9,6 +9,8 @@
 #ifndef TRACER_H
 #define TRACER_H
 
+#include "arch/common/debug.h"
+
 #define TRACER_MAX_ID                255
 #define TRACER_MAX_NAME_LENGTH       200
 
@@ -52,9 +54,9 @@ void  tracer_set_initial_time   (tracer_time_t time);
 /*
  * Record a value change for id
  */
-extern void  (*tracer_event_record_ptr)       (tracer_id_t id, tracer_val_t val);
-extern void  (*tracer_event_record_force_ptr) (tracer_id_t id, tracer_val_t val);
-extern void  (*tracer_event_record_time_ptr)  (tracer_id_t id, tracer_val_t val, tracer_time_t time);
+extern WSIM_TLS void  (*tracer_event_record_ptr)       (tracer_id_t id, tracer_val_t val);
+extern WSIM_TLS void  (*tracer_event_record_force_ptr) (tracer_id_t id, tracer_val_t val);
+extern WSIM_TLS void  (*tracer_event_record_time_ptr)  (tracer_id_t id, tracer_val_t val, tracer_time_t time);
 
 #define tracer_event_record(id,val)             \
   do {					        \
@@ -77,6 +79,17 @@ extern void  (*tracer_event_record_time_ptr)  (tracer_id_t id, tracer_val_t val,
 void  tracer_state_save         (void);
 void  tracer_state_restore      (void);
 
+/*
+ * blocks are only written at state saves, set at init for the wsnet
+ * modes and by the machine checkpoint ring
+ */
+void  tracer_set_backtrack      (int on);
+
+/*
+ * writer statistics
+ */
+void  tracer_dump_stats         (void);
+
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
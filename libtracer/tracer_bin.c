@@ -47,25 +47,96 @@
       magic_size == 26
    version 2:
       initial time
+   version 5:
+      samples are grouped in blocks of TRACER_BIN_BLOCK_EV samples,
+      blocks are delta encoded and indexed at the end of the file
 */
-#define TRACER_VERSION      4
+#define TRACER_VERSION      5
 
-static unsigned char           tracer_max_id        = TRACER_MAX_ID;
-static FILE*                   tracer_datafile      = NULL;
+/****************************************
+ * version 5 blocks
+ *
+ * each sample is encoded as
+ *   id   : 8 bits
+ *   time : zigzag varint, difference with the previous sample time
+ *   val  : varint, xor with the previous value of the same id
+ * the previous time and values are reset to 0 at the beginning of 
+ * each block, blocks can be decoded independently.
+ *
+ * the header ends with the block size, the number of blocks and
+ * the file offset of the index. The index is an array of
+ * tracer_bin_block_t, one for each block in file order.
+ *
+ * every block but the last one holds TRACER_BIN_BLOCK_EV samples,
+ * traces without index (0 blocks in the header, killed simulation)
+ * can be read by decoding the blocks from the end of the header.
+ ****************************************/
+
+#define TRACER_BIN_BLOCK_EV      8192
+#define TRACER_BIN_SAMPLE_MAX    (1 + 10 + 10)
+#define TRACER_BIN_INDEX_INIT    64
+
+struct PACKED tracer_bin_block_t {
+  uint64_t       offset;                  /* file offset             */
+  uint32_t       count;                   /* samples in block        */
+  uint32_t       size;                    /* encoded size            */
+  tracer_time_t  time_min;
+  tracer_time_t  time_max;
+  uint8_t        ids[(TRACER_MAX_ID + 8) / 8]; /* ids found in block */
+};
+
+struct tracer_binary_t {
+  FILE                      *file;
+  uint64_t                   offset;      /* end of data             */
+
+  /* current block */
+  struct tracer_bin_block_t  block;
+  uint8_t                   *data;
+  tracer_time_t              time;
+  tracer_val_t               val[TRACER_MAX_ID];
+
+  /* index */
+  struct tracer_bin_block_t *index;
+  uint32_t                   index_count;
+  uint32_t                   index_max;
+};
+
+static WSIM_TLS unsigned char           tracer_max_id        = TRACER_MAX_ID;
+static WSIM_TLS FILE*                   tracer_datafile      = NULL;
+static WSIM_TLS struct tracer_binary_t* tracer_binary        = NULL;
 
 
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
 
-void tracer_binary_open(char *filename)
+void* tracer_binary_open(char *filename)
 {
   if ((tracer_datafile = fopen(filename,"wb")) == NULL)
     {
       ERROR("tracer: ***********************************\n");
       ERROR("tracer: %s\n",strerror(errno));
       ERROR("tracer: ***********************************\n");
+      return NULL;
+    }
+
+  tracer_binary = (struct tracer_binary_t*)malloc(sizeof(struct tracer_binary_t));
+  if (tracer_binary != NULL)
+    {
+      memset(tracer_binary, 0, sizeof(struct tracer_binary_t));
+      tracer_binary->file      = tracer_datafile;
+      tracer_binary->data      = (uint8_t*)malloc(TRACER_BIN_BLOCK_EV * TRACER_BIN_SAMPLE_MAX);
+      tracer_binary->index_max = TRACER_BIN_INDEX_INIT;
+      tracer_binary->index     = (struct tracer_bin_block_t*)
+	malloc(TRACER_BIN_INDEX_INIT * sizeof(struct tracer_bin_block_t));
     }
+  if ((tracer_binary == NULL) || (tracer_binary->data == NULL) || (tracer_binary->index == NULL))
+    {
+      ERROR("tracer: cannot allocate trace blocks\n");
+      tracer_binary_close();
+      return NULL;
+    }
+  return tracer_binary;
 }
 
 /* ************************************************** */
@@ -77,6 +148,14 @@ void tracer_binary_close()
   if (tracer_datafile)
     {
       fclose(tracer_datafile);
+      tracer_datafile = NULL;
+    }
+  if (tracer_binary)
+    {
+      free(tracer_binary->data);
+      free(tracer_binary->index);
+      free(tracer_binary);
+      tracer_binary = NULL;
     }
 }
 
@@ -203,16 +282,106 @@ tracer_binary_start()
   size = sizeof(tracer_val_t) * TRACER_MAX_ID;
   i   += fwrite(EVENT_TRACER.id_val_max, 1, size, tracer_datafile);
 
+  /* blocks */
+  size = TRACER_BIN_BLOCK_EV;
+  i   += fwrite(&size, 1, sizeof(size), tracer_datafile);
+  i   += fwrite(&tracer_binary->index_count, 1, sizeof(tracer_binary->index_count), tracer_datafile);
+  i   += fwrite(&tracer_binary->offset, 1, sizeof(tracer_binary->offset), tracer_datafile);
+  DMSG_TRACER("tracer:hdr:blocks   : %d, index at %"PRIu64"\n",
+	      tracer_binary->index_count,tracer_binary->offset);
+
+  /* data starts after the first header */
+  if (tracer_binary->offset == 0)
+    {
+      tracer_binary->offset = ftell(tracer_datafile);
+    }
+
   DMSG_TRACER("tracer:header: total %d bytes\n",i);
 }
 
 
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void tracer_binary_write_block(struct tracer_binary_t *bin)
+{
+  struct tracer_bin_block_t *b = & bin->block;
+
+  if (b->count == 0)
+    return;
+
+  /* without index the trace is read by a sequential scan of the blocks */
+  if ((bin->index != NULL) && (bin->index_count == bin->index_max))
+    {
+      struct tracer_bin_block_t *index;
+      index = (struct tracer_bin_block_t*)
+	realloc(bin->index, 2 * bin->index_max * sizeof(struct tracer_bin_block_t));
+      if (index == NULL)
+	{
+	  ERROR("tracer: cannot grow the block index, trace is written without index\n");
+	  free(bin->index);
+	  bin->index       = NULL;
+	  bin->index_count = 0;
+	  bin->index_max   = 0;
+	}
+      else
+	{
+	  bin->index      = index;
+	  bin->index_max *= 2;
+	}
+    }
+
+  if (fwrite(bin->data, 1, b->size, bin->file) != b->size)
+    {
+      ERROR("tracer: write error, %s\n",strerror(errno));
+    }
+  b->offset    = bin->offset;
+  bin->offset += b->size;
+  if (bin->index != NULL)
+    {
+      bin->index[bin->index_count++] = *b;
+    }
+  DMSG_TRACER("tracer:data:block: %d ev = %d bytes\n",b->count,b->size);
+
+  memset(b, 0, sizeof(struct tracer_bin_block_t));
+  memset(bin->val, 0, sizeof(bin->val));
+  bin->time = 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static inline uint8_t* tracer_binary_varint(uint8_t *p, uint64_t v)
+{
+  while (v >= 0x80)
+    {
+      *p++ = (v & 0x7f) | 0x80;
+      v  >>= 7;
+    }
+  *p++ = v;
+  return p;
+}
+
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
 
 void tracer_binary_finish()
 {
+  if (tracer_datafile == NULL)
+    return;
+
+  /* last block and index, the header is written last */
+  tracer_binary_write_block(tracer_binary);
+  fseek(tracer_datafile, tracer_binary->offset, SEEK_SET);
+  if ((tracer_binary->index_count > 0) &&
+      (fwrite(tracer_binary->index, sizeof(struct tracer_bin_block_t), tracer_binary->index_count, 
+	      tracer_datafile) != tracer_binary->index_count))
+    {
+      ERROR("tracer: write error on block index, %s\n",strerror(errno));
+    }
   tracer_binary_start();
 }
 
@@ -220,16 +389,59 @@ void tracer_binary_finish()
 /* ************************************************** */
 /* ************************************************** */
 
-void tracer_binary_dump_data()
+/*
+ * called by the writer thread when it is running, the encoder state
+ * is reached through arg only
+ */
+void tracer_binary_dump_data(void *arg, tracer_sample_t *smpl, tracer_ev_t count)
 {
-  int written;
-  int32_t size;
-
-  size    = sizeof(tracer_sample_t)*EVENT_TRACER.ev_count;
-  written = fwrite(tracer_buffer, 1, size, tracer_datafile);
-  assert(written == size);
-  DMSG_TRACER("tracer:data:dump: write %d ev = %d bytes (%d requested)\n",EVENT_TRACER.ev_count,written,size);
-  EVENT_TRACER.ev_count = 0;
+  tracer_ev_t                ev;
+  struct tracer_binary_t    *bin = (struct tracer_binary_t*)arg;
+  struct tracer_bin_block_t *b;
+  uint8_t                   *p;
+
+  if (bin == NULL)
+    return;
+
+  b = & bin->block;
+  p = bin->data + b->size;
+  for(ev = 0; ev < count; ev++)
+    {
+      tracer_id_t   id   = smpl[ev].id;
+      tracer_time_t time = smpl[ev].time;
+      int64_t       dt   = (int64_t)(time - bin->time);
+
+      if (b->count == 0)
+	{
+	  b->time_min = time;
+	  b->time_max = time;
+	}
+      else if (time < b->time_min)
+	{
+	  b->time_min = time;
+	}
+      else if (time > b->time_max)
+	{
+	  b->time_max = time;
+	}
+      b->ids[id / 8] |= 1 << (id % 8);
+
+      *p++ = id;
+      p    = tracer_binary_varint(p, ((uint64_t)dt << 1) ^ (uint64_t)(dt >> 63));
+      p    = tracer_binary_varint(p, smpl[ev].val ^ bin->val[id]);
+      bin->time    = time;
+      bin->val[id] = smpl[ev].val;
+
+      b->count ++;
+      if (b->count == TRACER_BIN_BLOCK_EV)
+	{
+	  b->size = p - bin->data;
+	  tracer_binary_write_block(bin);
+	  p = bin->data;
+	}
+    }
+  b->size = p - bin->data;
+  DMSG_TRACER("tracer:data:dump: encoded %d ev\n",count);
 }
 
 /* ************************************************** */
@@ -9,11 +9,11 @@
 #ifndef WSIM_TRACER_BIN_H
 #define WSIM_TRACER_BIN_H
 
-void tracer_binary_open        ();
-void tracer_binary_start       ();
-void tracer_binary_dump_data   ();
-void tracer_binary_finish      ();
-void tracer_binary_close       ();
+void* tracer_binary_open       (char *filename);
+void  tracer_binary_start      ();
+void  tracer_binary_dump_data  (void *arg, tracer_sample_t *smpl, tracer_ev_t count);
+void  tracer_binary_finish     ();
+void  tracer_binary_close      ();
 
 #endif
 
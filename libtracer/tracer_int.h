@@ -107,7 +107,7 @@ enum wsens_mode_t {
 
 #define TRACER_BLOCK_EV              (256*1024)
 #define TRACER_BLOCK_THRESHOLD_INIT  (128*1024)
-extern unsigned int TRACER_BLOCK_THRESHOLD;
+extern WSIM_TLS unsigned int TRACER_BLOCK_THRESHOLD;
 
 /****************************************
  * struct _sample_t is the sample type
@@ -137,16 +137,24 @@ struct _tracer_state_t {
 };
 typedef struct _tracer_state_t tracer_state_t;
 
-extern tracer_state_t tracer_current;
+extern WSIM_TLS tracer_state_t tracer_current;
+
+/* write count samples to the output, arg is given by the output open */
+typedef void (*tracer_dump_function_t)(void *arg, tracer_sample_t *smpl, tracer_ev_t count);
+
+/* blocks are written by a background thread when threads are available */
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_SEMAPHORE_H) && !defined(WSNET1) && !defined(WSNET3)
+#define TRACER_WRITER 1
+#endif
 #define EVENT_TRACER tracer_current
 
-extern get_nanotime_function_t tracer_get_nanotime;
-extern int32_t                 tracer_node_id;
-extern tracer_time_t           tracer_initial_time;
-extern char                    tracer_id_name   [TRACER_MAX_ID][TRACER_MAX_NAME_LENGTH];
-extern char                    tracer_id_module [TRACER_MAX_ID][TRACER_MAX_NAME_LENGTH];
-extern uint8_t                 tracer_width     [TRACER_MAX_ID];
-extern tracer_sample_t         tracer_buffer    [TRACER_BLOCK_EV];
+extern WSIM_TLS get_nanotime_function_t tracer_get_nanotime;
+extern WSIM_TLS int32_t                 tracer_node_id;
+extern WSIM_TLS tracer_time_t           tracer_initial_time;
+extern WSIM_TLS char                    tracer_id_name   [TRACER_MAX_ID][TRACER_MAX_NAME_LENGTH];
+extern WSIM_TLS char                    tracer_id_module [TRACER_MAX_ID][TRACER_MAX_NAME_LENGTH];
+extern WSIM_TLS uint8_t                 tracer_width     [TRACER_MAX_ID];
+extern WSIM_TLS tracer_sample_t        *tracer_buffer;
 
 /* ************************************************** */
 /* ************************************************** */
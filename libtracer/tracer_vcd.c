@@ -34,14 +34,25 @@
 /* ************************************************** */
 /* ************************************************** */
 
-static FILE* tracer_datafile;
+static WSIM_TLS FILE* tracer_datafile;
 #define VCDOUT(x...)  fprintf(tracer_datafile,x)
 
+static WSIM_TLS char tracer_id_var [TRACER_MAX_ID][10];
+
+/* data dumps may run in the tracer writer thread, they get the file
+ * and the variable names of the node through this structure */
+struct tracer_vcd_output_t {
+  FILE  *datafile;
+  char (*id_var)[10];
+};
+
+static WSIM_TLS struct tracer_vcd_output_t tracer_vcd_output;
+
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
 
-void tracer_vcd_open(char* filename)
+void* tracer_vcd_open(char* filename)
 {
   if ((tracer_datafile = fopen(filename,"wb")) == NULL)
     {
@@ -49,6 +60,9 @@ void tracer_vcd_open(char* filename)
       ERROR("tracer: %s\n",strerror(errno));
       ERROR("tracer: ***********************************\n");
     }
+  tracer_vcd_output.datafile = tracer_datafile;
+  tracer_vcd_output.id_var   = tracer_id_var;
+  return &tracer_vcd_output;
 }
 
 /* ************************************************** */
@@ -72,7 +86,7 @@ char*
 tracer_lldbin(tracer_val_t v)
 {
   int i;
-  static char s[65];
+  static WSIM_TLS char s[65];
   
   memset(s,'0',sizeof(s));
   s[64] = '\0';
@@ -148,8 +162,7 @@ void numid_to_str(char *str, int num, int id)
 /* ************************************************** */
 /* ************************************************** */
 
-static char tracer_id_done[TRACER_MAX_ID];
-static char tracer_id_var [TRACER_MAX_ID][10];
+static WSIM_TLS char tracer_id_done[TRACER_MAX_ID];
 
 void vcd_dump_modules()
 {
@@ -239,25 +252,25 @@ void tracer_vcd_start()
 /* ************************************************** */
 /* ************************************************** */
 
-void tracer_vcd_dump_data()
+void tracer_vcd_dump_data(void *arg, tracer_sample_t *smpl, tracer_ev_t count)
 {
   tracer_ev_t      i;
   tracer_time_t    curr_time = 0;
   tracer_sample_t *curr_smpl;
+  struct tracer_vcd_output_t *out = (struct tracer_vcd_output_t*)arg;
 
-  curr_smpl = tracer_buffer;
-  for(i=0; i<EVENT_TRACER.ev_count; i++)
+  curr_smpl = smpl;
+  for(i=0; i<count; i++)
     {
       if (curr_time != curr_smpl->time)
 	{
-	  VCDOUT("\n#%" PRId64 "\n", curr_smpl->time);
+	  fprintf(out->datafile,"\n#%" PRId64 "\n", curr_smpl->time);
 	}
-      VCDOUT("b%s %s\n", tracer_lldbin(curr_smpl->val), tracer_id_var[curr_smpl->id]);
+      fprintf(out->datafile,"b%s %s\n", tracer_lldbin(curr_smpl->val), out->id_var[curr_smpl->id]);
       curr_time = curr_smpl->time;
       curr_smpl ++;
       // id_last_smpl[curr_smpl.id] = curr_smpl;
     }
-  EVENT_TRACER.ev_count = 0;
 }
 
 /* ************************************************** */
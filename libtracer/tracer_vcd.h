@@ -9,10 +9,10 @@
 #ifndef WSIM_TRACER_VCD_H
 #define WSIM_TRACER_VCD_H
 
-void tracer_vcd_open        (char *filename);
-void tracer_vcd_start       ();
-void tracer_vcd_dump_data   ();
-void tracer_vcd_finish      ();
-void tracer_vcd_close       ();
+void* tracer_vcd_open       (char *filename);
+void  tracer_vcd_start      ();
+void  tracer_vcd_dump_data  (void *arg, tracer_sample_t *smpl, tracer_ev_t count);
+void  tracer_vcd_finish     ();
+void  tracer_vcd_close      ();
 
 #endif
@@ -84,7 +84,17 @@ int  (*worldsens_c_close)         (void);
 int  (*worldsens_c_tx)            (struct wsnet_tx_info *);
 int  (*worldsens_c_update)        (void);
 
-#define LIBWSNET_UPDATE()  worldsens_c_update()
+/**
+ * Announces a whole frame of len bytes starting now, one byte every
+ * info->duration ns. The radio must still call worldsens_c_tx() for
+ * each byte, less than info->duration ns after its announced time. NULL or a non zero return when frames are not
+ * supported, bytes are then sent one by one.
+ **/
+int  (*worldsens_c_tx_frame)      (struct wsnet_tx_info *, uint8_t *, int);
+uint64_t (*worldsens_c_horizon)   (void);
+
+#define LIBWSNET_UPDATE()  MACHINE_PROF(MPROF_LIBWSNET, worldsens_c_update())
+#define LIBWSNET_HORIZON() worldsens_c_horizon()
 
 /**************************************************************************/
 /**************************************************************************/
@@ -101,6 +111,7 @@ int  worldsens0_c_connect       (char*, uint16_t, char*, uint16_t, uint32_t);
 int  worldsens0_c_close         (void);
 int  worldsens0_c_tx            (struct wsnet_tx_info *);
 int  worldsens0_c_update        (void);
+uint64_t worldsens0_c_horizon   (void);
 
 /**************************************************************************/
 /**************************************************************************/
@@ -117,12 +128,14 @@ int  worldsens1_c_connect       (char*, uint16_t, char*, uint16_t, uint32_t);
 int  worldsens1_c_close         (void);
 int  worldsens1_c_tx            (struct wsnet_tx_info *);
 int  worldsens1_c_update        (void);
+uint64_t worldsens1_c_horizon   (void);
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
 /* libwsnet2 public functions */
+int  worldsens2_c_options_add   (void);
 int  worldsens2_c_initialize    (void);
 
 void worldsens2_c_state_save    (void);
@@ -132,7 +145,28 @@ int  worldsens2_c_rx_register   (void*, wsnet_callback_rx_t, char*);
 int  worldsens2_c_connect       (char*, uint16_t, char*, uint16_t, uint32_t);
 int  worldsens2_c_close         (void);
 int  worldsens2_c_tx            (struct wsnet_tx_info *);
+int  worldsens2_c_tx_frame      (struct wsnet_tx_info *, uint8_t *, int);
 int  worldsens2_c_update        (void);
+uint64_t worldsens2_c_horizon   (void);
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/* libwsnet local medium public functions, multinode builds */
+#if defined(WSIM_MULTINODE)
+int  worldsensl_c_initialize    (void);
+
+void worldsensl_c_state_save    (void);
+void worldsensl_c_state_restore (void);
+int  worldsensl_c_get_node_id   (void);
+int  worldsensl_c_rx_register   (void*, wsnet_callback_rx_t, char*);
+int  worldsensl_c_connect       (char*, uint16_t, char*, uint16_t, uint32_t);
+int  worldsensl_c_close         (void);
+int  worldsensl_c_tx            (struct wsnet_tx_info *);
+int  worldsensl_c_update        (void);
+uint64_t worldsensl_c_horizon   (void);
+#endif
 
 /**************************************************************************/
 /**************************************************************************/
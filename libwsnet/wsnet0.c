@@ -19,7 +19,7 @@
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
-static int worldsens_nb_interfaces = 0; /* number of registered interfaces */
+static WSIM_TLS int worldsens_nb_interfaces = 0; /* number of registered interfaces */
 
 /**************************************************************************/
 /**************************************************************************/
@@ -61,6 +61,11 @@ int worldsens0_c_update(void)
   return 0;
 }
 
+uint64_t worldsens0_c_horizon(void)
+{
+  return WSIM_HORIZON_INF;
+}
+
 void worldsens0_c_state_save(void)
 {
 }
@@ -183,11 +183,11 @@ static void     worldsens1_packet_dump_send        (char *msg, int len);
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
-static int worldsens_nb_interfaces = 0; /* number of registered interfaces */
+static WSIM_TLS int worldsens_nb_interfaces = 0; /* number of registered interfaces */
 
-static struct _worldsens_c_nobacktrack  worldsens_nobacktrack;
-static struct _worldsens_c_backtrack    worldsens_backtracked;
-static struct _worldsens_c_backtrack    worldsens_backup;
+static WSIM_TLS struct _worldsens_c_nobacktrack  worldsens_nobacktrack;
+static WSIM_TLS struct _worldsens_c_backtrack    worldsens_backtracked;
+static WSIM_TLS struct _worldsens_c_backtrack    worldsens_backup;
 
 #define WSENS_UNICAST           worldsens_nobacktrack.u_fd
 #define WSENS_MULTICAST         worldsens_nobacktrack.m_fd
@@ -604,6 +604,34 @@ int worldsens1_c_update(void)
   return 0;
 }
 
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+/*
+ * delay before worldsens1_c_update() has something to do: end of the
+ * current event duration, pending packets or next rendez-vous point.
+ */
+uint64_t worldsens1_c_horizon(void)
+{
+  if ((mcu_signal_get() & SIG_WORLDSENS_IO) != 0)
+    {
+      return 0;
+    }
+
+  if (WSENS_TIME_TO_WAIT >= WSNET_TIME_PRECISION)
+    {
+      return WSENS_TIME_TO_WAIT - WSNET_TIME_PRECISION + 1;
+    }
+
+  if ((! pktlist_empty(& WSENS_PKT_LIST)) || (MACHINE_TIME_GET_NANO() >= WSENS_RDV_NEXT_TIME))
+    {
+      return 0;
+    }
+
+  return WSENS_RDV_NEXT_TIME - MACHINE_TIME_GET_NANO();
+}
+
 /***********************************************************************************************/
 /***********************************************************************************************/
 /***********************************************************************************************/
@@ -1075,8 +1103,9 @@ static int worldsens1_synched(int dmp)
   int len = sizeof(pkt);
 	
   /* Send */
-  pkt.type   = WORLDSENS_C_SYNCHED;
-  pkt.rp_seq = htonl(WSENS_SEQ_RDV);
+  pkt.type      = WORLDSENS_C_SYNCHED;
+  pkt.rp_seq    = htonl(WSENS_SEQ_RDV);
+  pkt.lookahead = htonll(devices_lookahead());
   if (worldsens1_packet_send(WSENS_UNICAST,(char*)(&pkt), len, 0, dmp) <= 0)
     {
       ERROR("WSNet:synched: error during packet send\n");
@@ -1205,6 +1234,7 @@ static void worldsens1_packet_dump_send(char *msg, int len)
 	struct _worldsens_c_synched_pkt *pkt = (struct _worldsens_c_synched_pkt *)msg;
 	DMSG_LIB_WSNET("WSNet:pkt:%s:   type       %s\n",          prfx, "WORLDSENS_C_SYNCHED");
 	DMSG_LIB_WSNET("WSNet:pkt:%s:   rp_seq     %d\n",          prfx, ntohl(pkt->rp_seq));
+	DMSG_LIB_WSNET("WSNet:pkt:%s:   lookahead  %"PRIu64"ns\n", prfx, ntohll(pkt->lookahead));
       }
       break;
     case WORLDSENS_C_TX:
@@ -80,6 +80,7 @@ struct PACKED _worldsens_c_synched_pkt
 {
   char            type;
   int             rp_seq;
+  uint64_t        lookahead;  /* ns before the node can send a byte, appended */
 };
 
 struct PACKED _worldsens_c_tx_pkt 
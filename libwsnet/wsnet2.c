@@ -18,6 +18,43 @@
 #include "wsnet2_dbg.h"
 
 
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+#if defined(WSNET2_SHM)
+static struct moption_t wsnet2_shm_opt = {
+  .longname    = "wsnet2-shm",
+  .type        = required_argument,
+  .helpstring  = "wsnet2 shared memory segment name (same host server)",
+  .value       = NULL
+};
+#endif
+
+static struct moption_t wsnet2_frames_opt = {
+  .longname    = "wsnet2-frames",
+  .type        = no_argument,
+  .helpstring  = "send whole radio frames to the wsnet2 server",
+  .value       = NULL
+};
+
+static struct moption_t wsnet2_lookahead_opt = {
+  .longname    = "wsnet2-lookahead",
+  .type        = no_argument,
+  .helpstring  = "send the radio lookahead to the wsnet2 server at rendez-vous",
+  .value       = NULL
+};
+
+int worldsens2_c_options_add(void)
+{
+#if defined(WSNET2_SHM)
+  options_add( &wsnet2_shm_opt );
+#endif
+  options_add( &wsnet2_frames_opt );
+  options_add( &wsnet2_lookahead_opt );
+  return 0;
+}
+
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
@@ -57,6 +94,20 @@ int worldsens2_c_initialize(void)
 
 int worldsens2_c_connect(char *srv_addr, uint16_t srv_port, char *mul_addr, uint16_t mul_port, uint32_t node_id)
 {
+  if (wsnet2_frames_opt.isset && wsnet2_frames_init())
+    {
+      return -1;
+    }
+  if (wsnet2_lookahead_opt.isset)
+    {
+      wsnet2_lookahead_init();
+    }
+#if defined(WSNET2_SHM)
+  if (wsnet2_shm_opt.isset)
+    {
+      return wsnet2_connect_shm(wsnet2_shm_opt.value, node_id);
+    }
+#endif
   return wsnet2_connect(srv_addr, srv_port, mul_addr, mul_port, node_id);
 }
 
@@ -92,6 +143,19 @@ int worldsens2_c_tx(struct wsnet_tx_info *info)
   return 0;
 }
 
+int worldsens2_c_tx_frame(struct wsnet_tx_info *info, uint8_t *data, int len)
+{
+  double frequency    = info->freq_mhz * 1000000;
+  int ret;
+
+  ret = wsnet2_tx_frame(data, len, frequency, info->modulation, info->power_dbm, info->duration, info->radio_id);
+  if (ret == -1)
+    {
+      ERROR("wsnet2:tx: error during frame send\n");
+    }
+  return ret;
+}
+
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
@@ -107,6 +171,11 @@ int worldsens2_c_update(void)
   return 0;
 }
 
+uint64_t worldsens2_c_horizon(void) 
+{
+  return wsnet2_horizon();
+}
+
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
@@ -75,6 +75,7 @@ int wsnet_mod_id_map[WSNET_MAX_MODULATIONS] =     {-1,                  /* WSNET
     wsens.l_rp  = MACHINE_TIME_GET_NANO();  \
     wsens.state = WORLDSENS_CLT_STATE_IDLE; \
     machine_state_save();                   \
+    wsnet2_frames_save();                   \
     WSNET2_DBG("libwsnet2:WORLDSENS_SAVE_STATE: Last restoration point sets at %"PRIu64"\n",wsens.l_rp);	\
 }   
 
@@ -94,12 +95,21 @@ static int      wsnet2_measure_rsp    (char *);
 static int      wsnet2_measure_sr_rsp (char *);
 static int      wsnet2_subscribe      (void);
 static int      wsnet2_kill_node      (char *);
+static int      wsnet2_frame_rx       (char *);
+static int      wsnet2_frame_cancel   (char *);
+static int      wsnet2_frame_abort    (int);
+static int      wsnet2_frames_update  (void);
+static void     wsnet2_frames_save    (void);
+static void     wsnet2_frames_restore (void);
 static void     wsnet2_finalize       (void);
+static int      wsnet2_net_send       (union _worldsens_pkt *, int);
+static int      wsnet2_net_recv       (int, char *);
+static int      wsnet2_net_pending    (void);
 
 /* ************************************************** */
 /* ************************************************** */
 
-struct _worldsens_clt wsens;
+WSIM_TLS struct _worldsens_clt wsens;
 
 
 void wsnet2_init(void) {
@@ -112,6 +122,13 @@ void wsnet2_init(void) {
     wsens.l_rp        =  0;
     wsens.nb_radios   =  0;
     wsens.nb_measures =  0;
+#if defined(WSNET2_SHM)
+    wsens.shm         = NULL;
+    wsens.shm_slot    = -1;
+#endif
+    wsens.frames       = NULL;
+    wsens.frames_saved = NULL;
+    wsens.lookahead    = 0;
 
     while (i--) {
         wsens.radio[i].callback   = NULL;
@@ -133,6 +150,18 @@ void wsnet2_close(void) {
 
     wsens.u_fd = -1;
     wsens.m_fd = -1;
+
+#if defined(WSNET2_SHM)
+    if (wsens.shm != NULL) {
+        wsnet2_shm_slot_leave(wsens.shm, wsens.shm_slot);
+        wsnet2_shm_close(wsens.shm);
+        wsens.shm = NULL;
+    }
+#endif
+    free(wsens.frames);
+    free(wsens.frames_saved);
+    wsens.frames       = NULL;
+    wsens.frames_saved = NULL;
     WSNET2_CNCT("libwsnet2:wsnet2_close: WSNet2 interface closed\n");
 }
 
@@ -145,6 +174,82 @@ void wsnet2_finalize(void) {
 }
 
 
+/* ************************************************** */
+/* ************************************************** */
+/**
+ * Transport. Packets use the udp sockets in network byte order or the
+ * shared memory rings in host byte order.
+ **/
+static int wsnet2_net_send(union _worldsens_pkt *pkt, int len) {
+#if defined(WSNET2_SHM)
+    if (wsens.shm != NULL) {
+        if (wsnet2_shm_send(wsens.shm, wsens.shm_slot, pkt, len) < 0) {
+	    WSNET2_EXC("libwsnet2:wsnet2_net_send: shared memory server is gone\n");
+	    return -1;
+	}
+	return 0;
+    }
+#endif
+    worldsens_packet_hton(pkt);
+    if (send(wsens.u_fd, (char *) pkt, len, 0) < 0) {
+        perror("(send)");
+        return -1;
+    }
+    return 0;
+}
+
+/* fd is the unicast socket while subscribing, the multicast one afterwards */
+static int wsnet2_net_recv(int fd, char *msg) {
+    int len;
+#if defined(WSNET2_SHM)
+    if (wsens.shm != NULL) {
+        if ((len = wsnet2_shm_recv(wsens.shm, wsens.shm_slot, msg, WORLDSENS_MAX_PKTLENGTH, 1)) <= 0) {
+	    WSNET2_EXC("libwsnet2:wsnet2_net_recv: shared memory server is gone\n");
+	    return -1;
+	}
+	return len;
+    }
+#endif
+    if ((len = recv(fd, msg, WORLDSENS_MAX_PKTLENGTH, 0)) <= 0) {
+        perror("(recv)");
+        return -1;
+    }
+    worldsens_packet_ntoh((union _worldsens_pkt *) msg);
+    return len;
+}
+
+/* packets available, does not block */
+static inline int wsnet2_net_ready(void) {
+#if defined(WSNET2_SHM)
+    if (wsens.shm != NULL)
+        return ! wsnet2_shm_empty(&wsens.shm->slot[wsens.shm_slot].down);
+#endif
+    return (mcu_signal_get() & SIG_WORLDSENS_IO) != 0;
+}
+
+/* remaining packets after a receive, returns -1 on error */
+static int wsnet2_net_pending(void) {
+    fd_set readfds;
+    struct timeval timeout;
+    int ret;
+
+#if defined(WSNET2_SHM)
+    if (wsens.shm != NULL)
+        return wsnet2_net_ready();
+#endif
+    FD_ZERO(&readfds);
+    FD_SET(wsens.m_fd, &readfds);
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+
+    if ((ret = select(wsens.m_fd+1, &readfds, NULL, NULL, &timeout)) < 0) {
+        perror("(select)");
+        return -1;
+    }
+    return ret != 0 && FD_ISSET(wsens.m_fd, &readfds);
+}
+
+
 /* ************************************************** */
 /* ************************************************** */
 uint32_t wsnet2_get_node_id(void)
@@ -168,7 +273,7 @@ int wsnet2_register_radio(char *antenna, wsnet_callback_rx_t callback, void *arg
  
     wsens.radio[i].callback   = callback;
     wsens.radio[i].arg        = arg;
-    wsens.radio[i].antenna    = malloc(strlen(antenna));
+    wsens.radio[i].antenna    = malloc(strlen(antenna) + 1);
     strcpy(wsens.radio[i].antenna, antenna);
 
     wsens.nb_radios++;
@@ -190,7 +295,7 @@ int wsnet2_register_measure(char *name, wsnet_callback_measure_t callback, void
         
     wsens.measure[i].callback = callback;
     wsens.measure[i].arg      = arg;
-    wsens.measure[i].name     = malloc(strlen(name));
+    wsens.measure[i].name     = malloc(strlen(name) + 1);
     strcpy(wsens.measure[i].name, name);
 
     wsens.nb_measures++;
@@ -320,6 +425,41 @@ int wsnet2_connect(char *srv_addr, uint16_t s_port, char *m_addr, uint16_t m_por
 }
 
 
+#if defined(WSNET2_SHM)
+/**
+ * Connects through the shared memory segment of a server running on
+ * the same host, replaces both sockets.
+ **/
+int wsnet2_connect_shm(char *name, uint32_t id) {
+
+    /* my id */
+    wsens.id = id;
+
+    if ((wsens.shm = wsnet2_shm_open(name)) == NULL) {
+        perror("(shm_open):");
+	WSNET2_EXC("libwsnet2:wsnet2_connect_shm: Error during shared memory segment mapping\n");
+        goto error;
+    }
+    if ((wsens.shm_slot = wsnet2_shm_slot_claim(wsens.shm, id)) < 0) {
+        perror("(shm slot):");
+	WSNET2_EXC("libwsnet2:wsnet2_connect_shm: No free slot in shared memory segment\n");
+        goto error;
+    }
+
+    return wsnet2_subscribe();
+
+ error:
+    if (wsens.shm != NULL) {
+        wsnet2_shm_close(wsens.shm);
+        wsens.shm = NULL;
+    }
+    wsnet2_finalize();
+    WSNET2_ERROR("libwsnet2:wsnet2_connect_shm: Error during connection to segment %s\n", name);
+    return -1;
+}
+#endif
+
+
 /* ************************************************** */
 /* ************************************************** */
 /**
@@ -334,12 +474,10 @@ int wsnet2_subscribe(void) {
     pkt.cnx_req.type    = WORLDSENS_C_CONNECT_REQ;
     pkt.cnx_req.node_id = wsens.id;
     worldsens_packet_dump(&pkt);
-    worldsens_packet_hton(&pkt);
 
 	
     /* send */
-    if (send(wsens.u_fd, (char *) (&pkt), sizeof(struct _worldsens_c_connect_req), 0)  < 0) {
-        perror("(send)");
+    if (wsnet2_net_send(&pkt, sizeof(struct _worldsens_c_connect_req)) < 0) {
         goto error;
     }
     WSNET2_CNCT("libwsnet2:wsnet2_subscribe: Attempting to connect with id %d...\n", wsens.id);
@@ -348,8 +486,7 @@ int wsnet2_subscribe(void) {
     wsens.state = WORLDSENS_CLT_STATE_CONNECTING;
     while (wsens.state != WORLDSENS_CLT_STATE_IDLE) {
         /* receive */
-        if ((len = recv(wsens.u_fd, msg, WORLDSENS_MAX_PKTLENGTH, 0)) < 0) {
-            perror("(recv)");
+        if ((len = wsnet2_net_recv(wsens.u_fd, msg)) < 0) {
             goto error;
         }
         if (wsnet2_parse(msg))
@@ -374,12 +511,9 @@ int wsnet2_unsubscribe(void) {
     pkt.disconnect.type    = WORLDSENS_C_DISCONNECT;
     pkt.disconnect.node_id = wsens.id;
     worldsens_packet_dump(&pkt);
-    worldsens_packet_hton(&pkt);
 
     /* send */
-    if (send(wsens.u_fd, (char *) (&pkt), sizeof(struct _worldsens_c_disconnect), 0) < 0) {
-        perror("(send)");
-	worldsens_packet_dump(&pkt);
+    if (wsnet2_net_send(&pkt, sizeof(struct _worldsens_c_disconnect)) < 0) {
         goto error;
     }
     WSNET2_CNCT("libwsnet2:wsnet2_unsubscribe: Disconnected id %d\n", wsens.id);
@@ -398,17 +532,14 @@ int wsnet2_unsubscribe(void) {
 int wsnet2_update(void) {
     char msg[WORLDSENS_MAX_PKTLENGTH];
     int len, ret;
-    fd_set readfds;
-    struct timeval timeout;
 
     /* handle received packets */
-    if ((mcu_signal_get() & SIG_WORLDSENS_IO) != 0) {
+    if (wsnet2_net_ready()) {
         mcu_signal_remove(SIG_WORLDSENS_IO);
         
         do {
             /* receive */
-            if ((len = recv(wsens.m_fd, msg, WORLDSENS_MAX_PKTLENGTH, 0)) <= 0) {
-                perror("(recv)");
+            if ((len = wsnet2_net_recv(wsens.m_fd, msg)) <= 0) {
                 goto error;
             }
             
@@ -417,16 +548,15 @@ int wsnet2_update(void) {
                 return -1;
             
             /* remaining packets ? */
-            FD_ZERO(&readfds);
-            FD_SET(wsens.m_fd, &readfds);
-            timeout.tv_sec = 0;
-            timeout.tv_usec = 0;
-            
-            if ((ret = select(wsens.m_fd+1, &readfds, NULL, NULL, &timeout)) < 0) {
-                perror("(select)");
+            if ((ret = wsnet2_net_pending()) < 0) {
                 goto error;
             }
-        } while (ret != 0 && FD_ISSET(wsens.m_fd, &readfds));    
+        } while (ret != 0);
+    }
+
+    /* frames not sent to the end, checked before a rendez-vous commits them */
+    if ((wsens.frames != NULL) && wsnet2_frames_update()) {
+        return -1;
     }
 
     /* synched */
@@ -434,6 +564,23 @@ int wsnet2_update(void) {
         wsnet2_sync();
     }
 
+    /* received frame bytes, after a cancel sent at this rendez-vous */
+    if (wsens.frames != NULL) {
+        struct _worldsens_frames_t *fr = wsens.frames;
+        while ((fr->rx_head < fr->rx_tail) && (fr->rx[fr->rx_head].time <= MACHINE_TIME_GET_NANO())) {
+            struct _worldsens_rx_byte_t *rx = &fr->rx[fr->rx_head++];
+            /* the radio takes no other byte during the time returned by its callback */
+            if (rx->time < fr->rx_busy[rx->radio]) {
+                WSNET2_RX("libwsnet2:wsnet2_update: radio busy, data 0x%02x from frame of node %d dropped\n",
+                          rx->info.data, rx->src);
+                continue;
+            }
+            WSNET2_RX("libwsnet2:wsnet2_update: rxing at time %"PRIu64" data 0x%02x on antenna %s from frame of node %d\n",
+                      MACHINE_TIME_GET_NANO(), rx->info.data, wsens.radio[rx->radio].antenna, rx->src);
+            fr->rx_busy[rx->radio] = rx->time + wsens.radio[rx->radio].callback(wsens.radio[rx->radio].arg, &rx->info);
+        }
+    }
+
     return 0;
 
  error:
@@ -443,6 +590,30 @@ int wsnet2_update(void) {
 }
 
 
+/* ************************************************** */
+/* ************************************************** */
+/**
+ * Delay before the next update that has something to do
+ **/
+uint64_t wsnet2_horizon(void) {
+    if (wsnet2_net_ready()) {
+        return 0;
+    }
+    if (MACHINE_TIME_GET_NANO() >= wsens.n_rp) {
+        return 0;
+    }
+    if (wsens.frames != NULL) {
+        struct _worldsens_frames_t *fr = wsens.frames;
+        uint64_t next = wsens.n_rp;
+        if ((fr->rx_head < fr->rx_tail) && (fr->rx[fr->rx_head].time < next)) {
+            next = fr->rx[fr->rx_head].time;
+        }
+        return (next > MACHINE_TIME_GET_NANO()) ? next - MACHINE_TIME_GET_NANO() : 0;
+    }
+    return wsens.n_rp - MACHINE_TIME_GET_NANO();
+}
+
+
 /* ************************************************** */
 /* ************************************************** */
 /**
@@ -454,15 +625,22 @@ static int wsnet2_sync(void) {
     int len;
 	
     /* format */
-    pkt.sync_ack.type        = WORLDSENS_C_SYNC_ACK;
-    pkt.sync_ack.node_id     = wsens.id;
-    pkt.sync_ack.rp_id       = wsens.rpseq;
+    if (wsens.lookahead) {
+        pkt.sync_ack_la.type      = WORLDSENS_C_SYNC_ACK_LOOKAHEAD;
+        pkt.sync_ack_la.node_id   = wsens.id;
+        pkt.sync_ack_la.rp_id     = wsens.rpseq;
+        pkt.sync_ack_la.lookahead = devices_lookahead();
+        len = sizeof(struct _worldsens_c_sync_ack_lookahead);
+    } else {
+        pkt.sync_ack.type         = WORLDSENS_C_SYNC_ACK;
+        pkt.sync_ack.node_id      = wsens.id;
+        pkt.sync_ack.rp_id        = wsens.rpseq;
+        len = sizeof(struct _worldsens_c_sync_ack);
+    }
     worldsens_packet_dump(&pkt);
-    worldsens_packet_hton(&pkt);
 
     /* send */
-    if (send(wsens.u_fd, (char *) (&pkt), sizeof(struct _worldsens_c_sync_ack), 0)  < 0) {
-        perror("(send)");
+    if (wsnet2_net_send(&pkt, len) < 0) {
         goto error;
     }
     WSNET2_DBG("libwsnet2:wsnet2_sync: synched on rp %d\n", wsens.rpseq);
@@ -474,8 +652,7 @@ static int wsnet2_sync(void) {
 	   wsens.state != WORLDSENS_CLT_STATE_KILLED) {
 		
         /* receive */
-        if ((len = recv(wsens.m_fd, msg, WORLDSENS_MAX_PKTLENGTH, 0)) <= 0) {
-            perror("(recvfrom)");
+        if ((len = wsnet2_net_recv(wsens.m_fd, msg)) <= 0) {
             goto error;
         }
 		
@@ -504,6 +681,25 @@ int wsnet2_tx(char data, double freq, int mod, double txdB, uint64_t delay, int
     union _worldsens_pkt pkt;
     int len;
 
+    /* byte of an announced frame, the server already has it */
+    if (wsens.frames != NULL && wsens.frames->tx[radio_id].active) {
+        struct _worldsens_tx_frame_t *tx = &wsens.frames->tx[radio_id];
+        uint64_t start = tx->start + tx->offset[tx->next];
+        uint64_t now   = MACHINE_TIME_GET_NANO();
+
+        if (((uint8_t) data == tx->data[tx->next]) && (now >= start) && (now < start + tx->duration)) {
+            if (++tx->next == tx->len) {
+                tx->active = 0;
+            }
+            return 0;
+        }
+        /* the radio diverged from the announce, go on byte per byte */
+        WSNET2_TX("libwsnet2:wsnet2_tx: frame %d diverges at byte %d\n", tx->id, tx->next);
+        if (wsnet2_frame_abort(radio_id)) {
+            return -1;
+        }
+    }
+
     /* put doubles into uint64_t variables for swap */
     // uint64_t *pfreq  = (uint64_t *) &freq;
     // uint64_t *ptxdB  = (uint64_t *) &txdB;
@@ -523,11 +719,9 @@ int wsnet2_tx(char data, double freq, int mod, double txdB, uint64_t delay, int
     pkt.byte_tx.duration          =  delay;
  
     worldsens_packet_dump(&pkt);
-    worldsens_packet_hton(&pkt);
 
     /* send */
-    if (send(wsens.u_fd, (char *) (&pkt), sizeof(struct _worldsens_c_byte_tx), 0)  < 0) {
-        perror("(send)");
+    if (wsnet2_net_send(&pkt, sizeof(struct _worldsens_c_byte_tx)) < 0) {
         goto error;
     }
  
@@ -541,8 +735,7 @@ int wsnet2_tx(char data, double freq, int mod, double txdB, uint64_t delay, int
     while (wsens.state != WORLDSENS_CLT_STATE_IDLE) {
 		
         /* receive */
-        if ((len = recv(wsens.m_fd, msg, WORLDSENS_MAX_PKTLENGTH, 0)) <= 0) {
-	    perror("(recv)");
+        if ((len = wsnet2_net_recv(wsens.m_fd, msg)) <= 0) {
 	    goto error;
 	}
 		
@@ -560,6 +753,300 @@ int wsnet2_tx(char data, double freq, int mod, double txdB, uint64_t delay, int
 }
 
 
+/* ************************************************** */
+/* ************************************************** */
+/**
+ * Frame messages. A radio that knows the whole frame it is about to
+ * send announces it with one packet and one wait for the server answer
+ * instead of one per byte. The radio still hands its bytes one by one,
+ * they are checked against the announce and are not sent again. A
+ * radio that diverges from the announce or stops before its end aborts
+ * the remainder of the frame and goes on byte per byte. Radios keep
+ * their own byte pacing, a byte is accepted during its announced slot
+ * and a radio that falls one byte behind the announce aborts it.
+ *
+ * Received frames are queued with the reception time of each byte and
+ * handed to the radio callbacks at that time, unless the radio is still
+ * busy with a previous byte for the time returned by its callback. The
+ * queue is saved and restored with the machine state at rendez-vous.
+ **/
+int wsnet2_frames_init(void) {
+    if ((wsens.frames       = calloc(1, sizeof(struct _worldsens_frames_t))) == NULL ||
+	(wsens.frames_saved = calloc(1, sizeof(struct _worldsens_frames_t))) == NULL) {
+        WSNET2_ERROR("libwsnet2:wsnet2_frames_init: out of memory\n");
+	return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * Sync acks give the delay before the radios can send a byte, the
+ * server may then release longer periods.
+ **/
+void wsnet2_lookahead_init(void) {
+    wsens.lookahead = 1;
+}
+
+
+static void wsnet2_frames_copy(struct _worldsens_frames_t *dst, struct _worldsens_frames_t *src) {
+    int n = src->rx_tail - src->rx_head;
+
+    dst->frame_id = src->frame_id;
+    memcpy(dst->rx_busy, src->rx_busy, sizeof(src->rx_busy));
+    memcpy(dst->tx, src->tx, sizeof(src->tx));
+    memcpy(dst->rx, src->rx + src->rx_head, n * sizeof(struct _worldsens_rx_byte_t));
+    dst->rx_head  = 0;
+    dst->rx_tail  = n;
+}
+
+static void wsnet2_frames_save(void) {
+    if (wsens.frames != NULL) {
+        wsnet2_frames_copy(wsens.frames_saved, wsens.frames);
+    }
+}
+
+static void wsnet2_frames_restore(void) {
+    if (wsens.frames != NULL) {
+        wsnet2_frames_copy(wsens.frames, wsens.frames_saved);
+    }
+}
+
+
+/**
+ * TX a frame announce, returns -2 when frame messages are disabled or
+ * the frame does not fit, the radio then sends its bytes one by one
+ **/
+int wsnet2_tx_frame(uint8_t *data, int n, double freq, int mod, double txdB, uint64_t duration, int radio_id) {
+    char msg[WORLDSENS_MAX_PKTLENGTH];
+    union _worldsens_pkt pkt;
+    struct _worldsens_tx_frame_t *tx;
+    int i, len;
+
+    if ((wsens.frames == NULL) || (n <= 0) || (n > WORLDSENS_MAX_FRAME)) {
+        return -2;
+    }
+
+    /* the previous frame of this radio was cut short */
+    tx = &wsens.frames->tx[radio_id];
+    if (tx->active && wsnet2_frame_abort(radio_id)) {
+        return -1;
+    }
+
+    tx->id       = ++wsens.frames->frame_id;
+    tx->start    = MACHINE_TIME_GET_NANO();
+    tx->duration = duration;
+    tx->len      = n;
+    tx->next     = 0;
+    for (i = 0; i < n; i++) {
+        tx->offset[i] = i * duration;
+        tx->data[i]   = data[i];
+    }
+
+    /* format */
+    pkt.frame_tx.type             =  WORLDSENS_C_FRAME_TX;
+    pkt.frame_tx.node_id          =  wsens.id;
+    pkt.frame_tx.period           =  MACHINE_TIME_GET_NANO() - wsens.l_rp;
+    memcpy(&pkt.frame_tx.freq, &freq, sizeof(freq));
+    pkt.frame_tx.antenna_id       =  wsens.radio[radio_id].antenna_id;
+    pkt.frame_tx.wsnet_mod_id     =  wsnet_mod_id_map[mod];
+    pkt.frame_tx.wsim_mod_id      =  mod;
+    memcpy(&pkt.frame_tx.power_dbm, &txdB, sizeof(txdB));
+    pkt.frame_tx.duration         =  duration;
+    pkt.frame_tx.frame_id         =  tx->id;
+    pkt.frame_tx.len              =  n;
+    for (i = 0; i < n; i++) {
+        pkt.frame_tx.byte[i].offset = tx->offset[i];
+        pkt.frame_tx.byte[i].data   = tx->data[i];
+    }
+    worldsens_packet_dump(&pkt);
+
+    /* send */
+    if (wsnet2_net_send(&pkt, WORLDSENS_FRAME_TX_LENGTH(n)) < 0) {
+        goto error;
+    }
+    tx->active = 1;
+    WSNET2_TX("libwsnet2:wsnet2_tx_frame: frame %d of %d bytes sent\n", tx->id, n);
+
+    /* wait either for backtrack or rp reminder */
+    wsens.state = WORLDSENS_CLT_STATE_TXING;
+
+    while (wsens.state != WORLDSENS_CLT_STATE_IDLE) {
+        if ((len = wsnet2_net_recv(wsens.m_fd, msg)) <= 0) {
+	    goto error;
+	}
+	if (wsnet2_parse(msg))
+	    return -1;
+    }
+
+    return 0;
+
+ error:
+    WSNET2_ERROR("libwsnet2:wsnet2_tx_frame: error during tx\n");
+    wsnet2_finalize();
+    return -1;
+}
+
+
+/**
+ * The radio does not send the end of its announced frame
+ **/
+static int wsnet2_frame_abort(int radio_id) {
+    char msg[WORLDSENS_MAX_PKTLENGTH];
+    union _worldsens_pkt pkt;
+    struct _worldsens_tx_frame_t *tx = &wsens.frames->tx[radio_id];
+    int len;
+
+    tx->active = 0;
+
+    pkt.frame_abort.type          =  WORLDSENS_C_FRAME_ABORT;
+    pkt.frame_abort.node_id       =  wsens.id;
+    pkt.frame_abort.period        =  MACHINE_TIME_GET_NANO() - wsens.l_rp;
+    pkt.frame_abort.frame_id      =  tx->id;
+    pkt.frame_abort.index         =  tx->next;
+    worldsens_packet_dump(&pkt);
+
+    if (wsnet2_net_send(&pkt, sizeof(struct _worldsens_c_frame_abort)) < 0) {
+        goto error;
+    }
+    WSNET2_TX("libwsnet2:wsnet2_frame_abort: frame %d aborted at byte %d\n", tx->id, tx->next);
+
+    /* the abort may move the next rp back */
+    wsens.state = WORLDSENS_CLT_STATE_TXING;
+
+    while (wsens.state != WORLDSENS_CLT_STATE_IDLE) {
+        if ((len = wsnet2_net_recv(wsens.m_fd, msg)) <= 0) {
+	    goto error;
+	}
+	if (wsnet2_parse(msg))
+	    return -1;
+    }
+
+    return 0;
+
+ error:
+    WSNET2_ERROR("libwsnet2:wsnet2_frame_abort: error during tx\n");
+    wsnet2_finalize();
+    return -1;
+}
+
+
+/**
+ * Radios update after libwsnet, a byte that is still missing at the end
+ * of its slot will not come
+ **/
+static int wsnet2_frames_update(void) {
+    int i;
+
+    for (i = 0; i < wsens.nb_radios; i++) {
+        struct _worldsens_tx_frame_t *tx = &wsens.frames->tx[i];
+        if (tx->active && (MACHINE_TIME_GET_NANO() >= tx->start + tx->offset[tx->next] + tx->duration)) {
+	    if (wsnet2_frame_abort(i)) {
+	        return -1;
+	    }
+	}
+    }
+    return 0;
+}
+
+
+/**
+ * RX frame, bytes are queued at their reception time.
+ **/
+static int wsnet2_frame_rx(char *msg) {
+    struct _worldsens_s_frame_rx *pkt = (struct _worldsens_s_frame_rx *) msg;
+    struct _worldsens_frames_t *fr = wsens.frames;
+    int ret = wsnet2_seq(msg);
+    int i, j, k;
+    double freq, power_dbm, sinr;
+
+    if (ret == -1)
+        return -1;
+    else if (ret == -2)
+        return 0;
+
+    if ((pkt->node_id != wsens.id) || (fr == NULL)) {
+        return 0;
+    }
+
+    memcpy(&freq,      &pkt->freq,      sizeof(freq));
+    memcpy(&power_dbm, &pkt->power_dbm, sizeof(power_dbm));
+    memcpy(&sinr,      &pkt->sinr,      sizeof(sinr));
+
+    for (i = 0; (i < MAX_CALLBACKS) && (wsens.radio[i].callback != NULL); i++) {
+        if (pkt->antenna_id != wsens.radio[i].antenna_id) {
+	    continue;
+	}
+
+	if (fr->rx_tail + pkt->len > WSNET2_RXQ_SIZE) {
+	    memmove(fr->rx, fr->rx + fr->rx_head, (fr->rx_tail - fr->rx_head) * sizeof(struct _worldsens_rx_byte_t));
+	    fr->rx_tail -= fr->rx_head;
+	    fr->rx_head  = 0;
+	    if (fr->rx_tail + pkt->len > WSNET2_RXQ_SIZE) {
+	        WSNET2_EXC("libwsnet2:wsnet2_frame_rx: receive queue is full\n");
+		return -1;
+	    }
+	}
+
+	for (j = 0; j < pkt->len; j++) {
+	    struct _worldsens_rx_byte_t rx;
+	    rx.time            = MACHINE_TIME_GET_NANO() + pkt->byte[j].offset;
+	    rx.src             = pkt->src_id;
+	    rx.radio           = i;
+	    rx.info.data       = pkt->byte[j].data;
+	    rx.info.freq_mhz   = freq / 1000000.0;
+	    rx.info.modulation = pkt->wsim_mod_id;
+	    rx.info.power_dbm  = power_dbm;
+	    rx.info.SiNR       = sinr;
+
+	    /* frames may overlap, keep the queue sorted */
+	    for (k = fr->rx_tail; (k > fr->rx_head) && (fr->rx[k - 1].time > rx.time); k--) {
+	        fr->rx[k] = fr->rx[k - 1];
+	    }
+	    fr->rx[k] = rx;
+	    fr->rx_tail ++;
+	}
+    }
+
+    return 0;
+}
+
+
+/**
+ * The sender aborted a frame, drop the bytes that are not received yet
+ **/
+static int wsnet2_frame_cancel(char *msg) {
+    struct _worldsens_s_frame_cancel *pkt = (struct _worldsens_s_frame_cancel *) msg;
+    struct _worldsens_frames_t *fr = wsens.frames;
+    uint64_t from;
+    int ret = wsnet2_seq(msg);
+    int i, n;
+
+    if (ret == -1)
+        return -1;
+    else if (ret == -2)
+        return 0;
+
+    if ((pkt->node_id != wsens.id) || (fr == NULL)) {
+        return 0;
+    }
+
+    from = MACHINE_TIME_GET_NANO() + pkt->offset;
+    for (i = fr->rx_head, n = fr->rx_head; i < fr->rx_tail; i++) {
+        struct _worldsens_rx_byte_t *rx = &fr->rx[i];
+        if ((rx->src == pkt->src_id) && (rx->time >= from) &&
+	    (wsens.radio[rx->radio].antenna_id == pkt->antenna_id)) {
+	    continue;
+	}
+	fr->rx[n++] = *rx;
+    }
+    WSNET2_RX("libwsnet2:wsnet2_frame_cancel: %d bytes from node %d dropped\n", fr->rx_tail - n, pkt->src_id);
+    fr->rx_tail = n;
+
+    return 0;
+}
+
+
 /* ************************************************** */
 /* ************************************************** */
 /**
@@ -577,11 +1064,9 @@ int wsnet2_tx_measure_req(int measure_pos_id) {
     pkt.measure_req.period     = MACHINE_TIME_GET_NANO() - wsens.l_rp;
 
     worldsens_packet_dump(&pkt);
-    worldsens_packet_hton(&pkt);
 
     /* send */
-    if (send(wsens.u_fd, (char *) (&pkt), sizeof(struct _worldsens_c_byte_tx), 0)  < 0) {
-        perror("(send)");
+    if (wsnet2_net_send(&pkt, sizeof(struct _worldsens_c_byte_tx)) < 0) {
         goto error;
     }
 
@@ -591,8 +1076,7 @@ int wsnet2_tx_measure_req(int measure_pos_id) {
     while (wsens.state != WORLDSENS_CLT_STATE_IDLE) {
 		
         /* receive */
-        if ((len = recv(wsens.m_fd, msg, WORLDSENS_MAX_PKTLENGTH, 0)) <= 0) {
-            perror("(recv)");
+        if ((len = wsnet2_net_recv(wsens.m_fd, msg)) <= 0) {
             goto error;
         }
 		
@@ -615,7 +1099,6 @@ int wsnet2_tx_measure_req(int measure_pos_id) {
 static int wsnet2_parse(char *msg) {
   union _worldsens_pkt *pkt = (union _worldsens_pkt *) msg;
 
-  worldsens_packet_ntoh(pkt);
   worldsens_packet_dump(pkt);
 
   switch (pkt->s_header.type) {
@@ -657,6 +1140,16 @@ static int wsnet2_parse(char *msg) {
       if (wsnet2_sr_rx((char *)pkt))
           goto error;
       break;
+  case WORLDSENS_S_FRAME_RX:
+      WSNET2_DBG("libwsnet2:wsnet2_parse: WORLDSENS_S_FRAME_RX packet type\n");
+      if (wsnet2_frame_rx((char *)pkt))
+          goto error;
+      break;
+  case WORLDSENS_S_FRAME_CANCEL:
+      WSNET2_DBG("libwsnet2:wsnet2_parse: WORLDSENS_S_FRAME_CANCEL packet type\n");
+      if (wsnet2_frame_cancel((char *)pkt))
+          goto error;
+      break;
   case WORLDSENS_S_MEASURE_RSP:
       WSNET2_DBG("libwsnet2:wsnet2_parse: WORLDSENS_S_MEASURE_RSP packet type\n");
       if (wsnet2_measure_rsp((char *)pkt))
@@ -834,6 +1327,7 @@ static int wsnet2_backtrack(char *msg) {
    if (MACHINE_TIME_GET_NANO() > (wsens.l_rp + pkt->rp_duration)) {
        WSNET2_BKTRK("libwsnet2:wsnet2_backtrack: Backtracking to time %"PRIu64"\n", wsens.l_rp);
        machine_state_restore();   
+       wsnet2_frames_restore();
    } else {
        WSNET2_BKTRK("libwsnet2:wsnet2_backtrack: No need to backtrack\n");
    }
@@ -9,6 +9,8 @@
 #define WSNET2_NET_H
 
 #include "libwsnet.h"
+#include "wsnet2_pkt.h"
+#include "wsnet2_shm.h"
 
 
 #define MAX_CALLBACKS 10
@@ -44,6 +46,37 @@ struct _worldsens_measure_t {
   uint32_t                       id;
 };
  
+/* frame announced by a radio, its bytes are not sent one by one */
+struct _worldsens_tx_frame_t {
+  int                            active;
+  uint32_t                       id;
+  uint64_t                       start;
+  uint64_t                       duration;
+  int                            len;
+  int                            next;                   /* next byte expected from the radio */
+  uint32_t                       offset [WORLDSENS_MAX_FRAME];
+  uint8_t                        data   [WORLDSENS_MAX_FRAME];
+};
+
+/* received frame byte, handed to the radio at its reception time */
+struct _worldsens_rx_byte_t {
+  uint64_t                       time;
+  uint32_t                       src;
+  int                            radio;
+  struct wsnet_rx_info           info;
+};
+
+#define WSNET2_RXQ_SIZE 1024
+
+struct _worldsens_frames_t {
+  uint32_t                       frame_id;               /* frames announced */
+  struct _worldsens_tx_frame_t   tx     [MAX_CALLBACKS];
+  int                            rx_head;
+  int                            rx_tail;
+  uint64_t                       rx_busy[MAX_CALLBACKS]; /* end of the last byte taken by the radio */
+  struct _worldsens_rx_byte_t    rx     [WSNET2_RXQ_SIZE];
+};
+
 struct _worldsens_clt {
   struct _worldsens_radio_t      radio  [MAX_CALLBACKS];
   struct _worldsens_measure_t    measure[MAX_CALLBACKS];
@@ -52,6 +85,13 @@ struct _worldsens_clt {
   uint32_t                       id;                     /* my address */
   int                            u_fd;                   /* unicast file descriptor */
   int                            m_fd;                   /* multicast file descriptor */
+#if defined(WSNET2_SHM)
+  struct wsnet2_shm_t            *shm;                   /* shared memory transport */
+  int                            shm_slot;               /* client slot in shm */
+#endif
+  struct _worldsens_frames_t     *frames;                /* frame messages, NULL when disabled */
+  struct _worldsens_frames_t     *frames_saved;          /* frame state at the last rendez-vous */
+  int                            lookahead;              /* sync acks carry the radio lookahead */
   uint64_t                       seq;                    /* receive packet sequence */
   uint64_t                       n_update;               /* next update time */
   uint64_t                       n_rp;                   /* next rendez-vous */
@@ -70,10 +110,17 @@ int             wsnet2_unsubscribe      (void);
 void            wsnet2_close            (void);
 uint32_t        wsnet2_get_node_id      (void);
 int             wsnet2_update           (void);
+uint64_t        wsnet2_horizon          (void);
 int             wsnet2_register_radio   (char *, wsnet_callback_rx_t, void *);
 int             wsnet2_register_measure (char *channel, wsnet_callback_measure_t callback, void *);
 int             wsnet2_connect          (char *, uint16_t, char *, uint16_t, uint32_t);
+#if defined(WSNET2_SHM)
+int             wsnet2_connect_shm      (char *, uint32_t);
+#endif
+int             wsnet2_frames_init      (void);
+void            wsnet2_lookahead_init   (void);
 int             wsnet2_tx               (char, double, int, double, uint64_t, int);
+int             wsnet2_tx_frame         (uint8_t *, int, double, int, double, uint64_t, int);
 int             wsnet2_tx_measure_req   (int);
 
 
@@ -121,7 +121,25 @@ static inline void swap8(uint64_t *v)
 /* ************************************************** */
 /* ************************************************** */
 
-static inline int worldsens_packet_swap(union _worldsens_pkt *pkt)
+/* frame lengths are read in host order, before or after their swap */
+static inline int worldsens_frame_swap(ws_frame_len *len, struct _worldsens_frame_byte *byte, int to_net)
+{
+  int i, n;
+
+  n = *len;
+  SWAPN (*len);
+  if (! to_net)
+    n = *len;
+  if (n > WORLDSENS_MAX_FRAME)
+    return -1;
+  for (i = 0; i < n; i++)
+    {
+      SWAPN (byte[i].offset);
+    }
+  return 0;
+}
+
+static inline int worldsens_packet_swap(union _worldsens_pkt *pkt, int to_net)
 {
   int ptype = *((ws_pkt_type*)pkt);
   /* int pkt_type = pkt->cnx_req.pkt_id; */ /* could be any struct ws_* */
@@ -139,6 +157,13 @@ static inline int worldsens_packet_swap(union _worldsens_pkt *pkt)
       SWAPN (pkt->sync_ack.rp_id);
       break;
 
+    case WORLDSENS_C_SYNC_ACK_LOOKAHEAD:
+      SWAPN (pkt->sync_ack_la.type);
+      SWAPN (pkt->sync_ack_la.node_id);
+      SWAPN (pkt->sync_ack_la.rp_id);
+      SWAPN (pkt->sync_ack_la.lookahead);
+      break;
+
     case WORLDSENS_C_BYTE_TX:
       SWAPN (pkt->byte_tx.type);
       SWAPN (pkt->byte_tx.node_id);
@@ -152,6 +177,29 @@ static inline int worldsens_packet_swap(union _worldsens_pkt *pkt)
       SWAPN (pkt->byte_tx.period);
       break;
 
+    case WORLDSENS_C_FRAME_TX:
+      SWAPN (pkt->frame_tx.type);
+      SWAPN (pkt->frame_tx.node_id);
+      SWAPN (pkt->frame_tx.antenna_id);
+      SWAPN (pkt->frame_tx.wsnet_mod_id);
+      SWAPN (pkt->frame_tx.wsim_mod_id);
+      SWAPN (pkt->frame_tx.freq);
+      SWAPN (pkt->frame_tx.power_dbm);
+      SWAPN (pkt->frame_tx.duration);
+      SWAPN (pkt->frame_tx.period);
+      SWAPN (pkt->frame_tx.frame_id);
+      if (worldsens_frame_swap(&pkt->frame_tx.len, pkt->frame_tx.byte, to_net))
+	ptype = WORLDSENS_UNKNOWN;
+      break;
+
+    case WORLDSENS_C_FRAME_ABORT:
+      SWAPN (pkt->frame_abort.type);
+      SWAPN (pkt->frame_abort.node_id);
+      SWAPN (pkt->frame_abort.period);
+      SWAPN (pkt->frame_abort.frame_id);
+      SWAPN (pkt->frame_abort.index);
+      break;
+
     case WORLDSENS_C_MEASURE_REQ:
       SWAPN (pkt->measure_req.type);
       SWAPN (pkt->measure_req.node_id);
@@ -226,6 +274,29 @@ static inline int worldsens_packet_swap(union _worldsens_pkt *pkt)
       SWAPN (pkt->byte_sr_rx.data);
       break;
 
+    case WORLDSENS_S_FRAME_RX:
+      SWAPN (pkt->frame_rx.type);
+      SWAPN (pkt->frame_rx.seq);
+      SWAPN (pkt->frame_rx.node_id);
+      SWAPN (pkt->frame_rx.src_id);
+      SWAPN (pkt->frame_rx.antenna_id);
+      SWAPN (pkt->frame_rx.wsim_mod_id);
+      SWAPN (pkt->frame_rx.freq);
+      SWAPN (pkt->frame_rx.power_dbm);
+      SWAPN (pkt->frame_rx.sinr);
+      if (worldsens_frame_swap(&pkt->frame_rx.len, pkt->frame_rx.byte, to_net))
+	ptype = WORLDSENS_UNKNOWN;
+      break;
+
+    case WORLDSENS_S_FRAME_CANCEL:
+      SWAPN (pkt->frame_cancel.type);
+      SWAPN (pkt->frame_cancel.seq);
+      SWAPN (pkt->frame_cancel.node_id);
+      SWAPN (pkt->frame_cancel.src_id);
+      SWAPN (pkt->frame_cancel.antenna_id);
+      SWAPN (pkt->frame_cancel.offset);
+      break;
+
     case WORLDSENS_S_MEASURE_RSP:
       SWAPN (pkt->measure_rsp.type);
       SWAPN (pkt->measure_rsp.seq);
@@ -269,12 +340,12 @@ static inline int worldsens_packet_swap(union _worldsens_pkt *pkt)
 
 int worldsens_packet_hton(union _worldsens_pkt *pkt)
 {
-  return worldsens_packet_swap(pkt);
+  return worldsens_packet_swap(pkt, 1);
 }
 
 int worldsens_packet_ntoh(union _worldsens_pkt *pkt)
 {
-  return worldsens_packet_swap(pkt);
+  return worldsens_packet_swap(pkt, 0);
 }
 
 /* ************************************************** */
@@ -304,6 +375,15 @@ int worldsens_packet_dump(union _worldsens_pkt *msg)
 	DMSG_LIB_WSNET("%s:%s:pkt:    rp_id %"PRIu64"\n",              SOFT, DIRECTION1, pkt->rp_id);
 	break;
       }
+    case WORLDSENS_C_SYNC_ACK_LOOKAHEAD:
+      {
+	UNUSED struct _worldsens_c_sync_ack_lookahead *pkt = (struct _worldsens_c_sync_ack_lookahead *)msg;
+	DMSG_LIB_WSNET("%s:%s:pkt:    type %s\n",                      SOFT, DIRECTION1, "WORLDSENS_C_SYNC_ACK_LOOKAHEAD");
+	DMSG_LIB_WSNET("%s:%s:pkt:    node %d\n",                      SOFT, DIRECTION1, pkt->node_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    rp_id %"PRIu64"\n",              SOFT, DIRECTION1, pkt->rp_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    lookahead %"PRIu64"\n",          SOFT, DIRECTION1, pkt->lookahead);
+	break;
+      }
     case WORLDSENS_C_BYTE_TX:
       {
 	UNUSED struct _worldsens_c_byte_tx *pkt = (struct _worldsens_c_byte_tx *)msg;
@@ -321,6 +401,33 @@ int worldsens_packet_dump(union _worldsens_pkt *msg)
 	DMSG_LIB_WSNET("%s:%s:pkt:    period %"PRIu64"\n",             SOFT, DIRECTION1, pkt->period);
 	break;
       }
+    case WORLDSENS_C_FRAME_TX:
+      {
+	UNUSED struct _worldsens_c_frame_tx *pkt = (struct _worldsens_c_frame_tx *)msg;
+	UNUSED double *power_dbm = (double *) &(pkt->power_dbm);
+	UNUSED double *freq      = (double *) &(pkt->freq);
+	DMSG_LIB_WSNET("%s:%s:pkt:    type %s\n",                      SOFT, DIRECTION1, "WORLDSENS_C_FRAME_TX");
+	DMSG_LIB_WSNET("%s:%s:pkt:    node %d\n",                      SOFT, DIRECTION1, pkt->node_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    antenna %"PRId64"\n",            SOFT, DIRECTION1, pkt->antenna_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    wsim modulation id %"PRId64"\n", SOFT, DIRECTION1, pkt->wsim_mod_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    frequence %g hz\n",              SOFT, DIRECTION1, *freq);
+	DMSG_LIB_WSNET("%s:%s:pkt:    power %g dbm\n",                 SOFT, DIRECTION1, *power_dbm);
+	DMSG_LIB_WSNET("%s:%s:pkt:    duration %"PRIu64"\n",           SOFT, DIRECTION1, pkt->duration);
+	DMSG_LIB_WSNET("%s:%s:pkt:    period %"PRIu64"\n",             SOFT, DIRECTION1, pkt->period);
+	DMSG_LIB_WSNET("%s:%s:pkt:    frame %d\n",                     SOFT, DIRECTION1, pkt->frame_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    length %d\n",                    SOFT, DIRECTION1, pkt->len);
+	break;
+      }
+    case WORLDSENS_C_FRAME_ABORT:
+      {
+	UNUSED struct _worldsens_c_frame_abort *pkt = (struct _worldsens_c_frame_abort *)msg;
+	DMSG_LIB_WSNET("%s:%s:pkt:    type %s\n",                      SOFT, DIRECTION1, "WORLDSENS_C_FRAME_ABORT");
+	DMSG_LIB_WSNET("%s:%s:pkt:    node %d\n",                      SOFT, DIRECTION1, pkt->node_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    period %"PRIu64"\n",             SOFT, DIRECTION1, pkt->period);
+	DMSG_LIB_WSNET("%s:%s:pkt:    frame %d\n",                     SOFT, DIRECTION1, pkt->frame_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    index %d\n",                     SOFT, DIRECTION1, pkt->index);
+	break;
+      }
     case WORLDSENS_C_MEASURE_REQ:
       {
 	UNUSED struct _worldsens_c_measure_req *pkt = (struct _worldsens_c_measure_req *)msg;
@@ -421,6 +528,31 @@ int worldsens_packet_dump(union _worldsens_pkt *msg)
 	DMSG_LIB_WSNET("%s:%s:pkt:    data 0x%02x\n",                  SOFT, DIRECTION2, pkt->data);
 	break;
       }
+    case WORLDSENS_S_FRAME_RX:
+      {
+	UNUSED struct _worldsens_s_frame_rx *pkt = (struct _worldsens_s_frame_rx *)msg;
+	UNUSED double *power_dbm = (double *) &(pkt->power_dbm);
+	UNUSED double *freq      = (double *) &(pkt->freq);
+	DMSG_LIB_WSNET("%s:%s:pkt:    type %s\n",                      SOFT, DIRECTION2, "WORLDSENS_S_FRAME_RX");
+	DMSG_LIB_WSNET("%s:%s:pkt:    seq %"PRIu64"\n",                SOFT, DIRECTION2, pkt->seq);
+	DMSG_LIB_WSNET("%s:%s:pkt:    node id %d\n",                   SOFT, DIRECTION2, pkt->node_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    src id %d\n",                    SOFT, DIRECTION2, pkt->src_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    antenna %"PRId64"\n",            SOFT, DIRECTION2, pkt->antenna_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    frequence %g hz\n",              SOFT, DIRECTION2, *freq);
+	DMSG_LIB_WSNET("%s:%s:pkt:    power %g dbm\n",                 SOFT, DIRECTION2, *power_dbm);
+	DMSG_LIB_WSNET("%s:%s:pkt:    length %d\n",                    SOFT, DIRECTION2, pkt->len);
+	break;
+      }
+    case WORLDSENS_S_FRAME_CANCEL:
+      {
+	UNUSED struct _worldsens_s_frame_cancel *pkt = (struct _worldsens_s_frame_cancel *)msg;
+	DMSG_LIB_WSNET("%s:%s:pkt:    type %s\n",                      SOFT, DIRECTION2, "WORLDSENS_S_FRAME_CANCEL");
+	DMSG_LIB_WSNET("%s:%s:pkt:    seq %"PRIu64"\n",                SOFT, DIRECTION2, pkt->seq);
+	DMSG_LIB_WSNET("%s:%s:pkt:    node id %d\n",                   SOFT, DIRECTION2, pkt->node_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    src id %d\n",                    SOFT, DIRECTION2, pkt->src_id);
+	DMSG_LIB_WSNET("%s:%s:pkt:    offset %d\n",                    SOFT, DIRECTION2, pkt->offset);
+	break;
+      }
     case WORLDSENS_S_MEASURE_RSP:
       {
 	UNUSED struct _worldsens_s_measure_rsp *pkt = (struct _worldsens_s_measure_rsp *)msg;
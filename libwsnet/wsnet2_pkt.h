@@ -42,6 +42,15 @@ enum woldsens_pkt_type {
   WORLDSENS_S_KILLSIM,         /* kill all nodes              */
   WORLDSENS_S_KILL,            /* kill one node               */
 
+  /* frame messages, appended to keep the v2 numbering */
+  WORLDSENS_C_FRAME_TX,        /* Tx of a whole frame         */
+  WORLDSENS_C_FRAME_ABORT,     /* end of frame is not sent    */
+  WORLDSENS_S_FRAME_RX,        /* Rx of a whole frame         */
+  WORLDSENS_S_FRAME_CANCEL,    /* drop pending frame Rx       */
+
+  /* appended */
+  WORLDSENS_C_SYNC_ACK_LOOKAHEAD, /* node synched, no Tx before */
+
   /* */
   WORLDSENS_LASTID
 };
@@ -67,6 +76,10 @@ typedef uint64_t                ws_sinr;       /* double */
 typedef uint64_t                ws_time;
 typedef uint8_t                 ws_data;
 
+typedef uint32_t                ws_id_frame;
+typedef uint16_t                ws_frame_len;
+typedef uint32_t                ws_offset;     /* ns, relative to the frame packet time */
+
 
 
 /* ************************************************** */
@@ -91,6 +104,17 @@ struct __PACKED__ _worldsens_c_sync_ack {
   ws_id_rp               rp_id;
 };
 
+/*
+ * Sync ack with the delay before the node radio can send a byte, only
+ * sent to servers that accept it (--wsnet2-lookahead).
+ */
+struct __PACKED__ _worldsens_c_sync_ack_lookahead {
+  ws_pkt_type            type;
+  ws_id_node             node_id;
+  ws_id_rp               rp_id;
+  ws_time                lookahead;
+};
+
 struct __PACKED__ _worldsens_c_byte_tx {
   ws_pkt_type            type;
   ws_id_node             node_id;
@@ -104,6 +128,42 @@ struct __PACKED__ _worldsens_c_byte_tx {
   ws_data                data;
 };
 
+/*
+ * A frame packet carries the whole byte sequence of a transmission,
+ * each byte with its start (Tx) or reception (Rx) time offset. Frame
+ * packets are only sent to servers that accept them (--wsnet2-frames),
+ * only the used part of the byte array is sent.
+ */
+#define WORLDSENS_MAX_FRAME          256
+
+struct __PACKED__ _worldsens_frame_byte {
+  ws_offset              offset;
+  ws_data                data;
+};
+
+struct __PACKED__ _worldsens_c_frame_tx {
+  ws_pkt_type            type;
+  ws_id_node             node_id;
+  ws_id_resource         antenna_id;
+  ws_id_resource         wsnet_mod_id;
+  ws_id_resource         wsim_mod_id;
+  ws_frequency           freq;
+  ws_power               power_dbm;
+  ws_time                duration;     /* of each byte         */
+  ws_time                period;       /* frame start          */
+  ws_id_frame            frame_id;     /* per node frame count */
+  ws_frame_len           len;
+  struct _worldsens_frame_byte byte[WORLDSENS_MAX_FRAME];
+};
+
+struct __PACKED__ _worldsens_c_frame_abort {
+  ws_pkt_type            type;
+  ws_id_node             node_id;
+  ws_time                period;
+  ws_id_frame            frame_id;
+  ws_frame_len           index;        /* first byte not sent  */
+};
+
 struct __PACKED__ _worldsens_c_measure_req {
   ws_pkt_type            type;
   ws_id_node             node_id;
@@ -212,6 +272,34 @@ struct __PACKED__ _worldsens_s_measure_sr_rsp {
   ws_time                rp_duration;
 };
 
+struct __PACKED__ _worldsens_s_frame_rx {
+  ws_pkt_type            type;
+  ws_id_seq              seq;
+  ws_id_node             node_id;
+  ws_id_node             src_id;
+  ws_id_resource         antenna_id;
+  ws_id_resource         wsim_mod_id;
+  ws_frequency           freq;
+  ws_power               power_dbm;
+  ws_sinr                sinr;
+  ws_frame_len           len;
+  struct _worldsens_frame_byte byte[WORLDSENS_MAX_FRAME];
+};
+
+struct __PACKED__ _worldsens_s_frame_cancel {
+  ws_pkt_type            type;
+  ws_id_seq              seq;
+  ws_id_node             node_id;
+  ws_id_node             src_id;
+  ws_id_resource         antenna_id;
+  ws_offset              offset;       /* bytes received from offset on are dropped */
+};
+
+#define WORLDSENS_FRAME_TX_LENGTH(n) (sizeof(struct _worldsens_c_frame_tx) - \
+                                      (WORLDSENS_MAX_FRAME - (n)) * sizeof(struct _worldsens_frame_byte))
+#define WORLDSENS_FRAME_RX_LENGTH(n) (sizeof(struct _worldsens_s_frame_rx) - \
+                                      (WORLDSENS_MAX_FRAME - (n)) * sizeof(struct _worldsens_frame_byte))
+
 struct __PACKED__ _worldsens_s_killsim {
   ws_pkt_type            type;
   ws_id_seq              seq;
@@ -240,6 +328,7 @@ union _worldsens_pkt {
   struct _worldsens_s_byte_sr_rx         byte_sr_rx;
 
   struct _worldsens_c_sync_ack           sync_ack;
+  struct _worldsens_c_sync_ack_lookahead sync_ack_la;
   struct _worldsens_s_sync_release       sync_release;
   struct _worldsens_s_sync_reminder      sync_reminder;
 
@@ -249,6 +338,11 @@ union _worldsens_pkt {
   struct _worldsens_s_measure_rsp        measure_rsp;
   struct _worldsens_s_measure_sr_rsp     measure_sr_rsp;
 
+  struct _worldsens_c_frame_tx           frame_tx;
+  struct _worldsens_c_frame_abort        frame_abort;
+  struct _worldsens_s_frame_rx           frame_rx;
+  struct _worldsens_s_frame_cancel       frame_cancel;
+
   struct _worldsens_c_disconnect         disconnect;
   struct _worldsens_s_killsim            killsim;
   struct _worldsens_s_kill               kill;
@@ -0,0 +1,370 @@
+/**
+ *  \file   wsnet2_shm.c
+ *  \brief  Worldsens client v2, shared memory transport
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include "wsnet2_shm.h"
+
+#if defined(WSNET2_SHM)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/* polls before sleeping on the futex */
+#define WSNET2_SHM_SPIN      200
+
+/* sleep period between two peer liveness checks */
+#define WSNET2_SHM_WAIT_MS   100
+
+/* 
+ * records are a 32 bits length, a 32 bits mark and the packet, 4 bytes
+ * aligned. The mark written by a client is the position it has read in
+ * its down ring, the server knows which of its packets the client had
+ * seen when it wrote the record.
+ */
+#define RECORD_HEADER        8
+#define RECORD_SIZE(len)     (RECORD_HEADER + (((len) + 3) & ~3u))
+#define RING_MASK            (WSNET2_SHM_RING_SIZE - 1)
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static int futex_wait(uint32_t *addr, uint32_t val, int timeout_ms)
+{
+  struct timespec ts;
+  ts.tv_sec  = timeout_ms / 1000;
+  ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+  return syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void futex_wake(uint32_t *addr)
+{
+  syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/*
+ * Wait until *word differs from seen. The waiter publishes its intent
+ * in *waiting before the last test, the other side stores the new word
+ * value before testing *waiting so one of the two always sees the
+ * other (both use sequentially consistent accesses).
+ * returns 1 on change, 0 on timeout
+ */
+static int shm_wait(uint32_t *word, uint32_t *waiting, uint32_t seen, int timeout_ms)
+{
+  int i;
+  int ret = 1;
+
+  for (i = 0; i < WSNET2_SHM_SPIN; i++)
+    {
+      if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != seen)
+	return 1;
+    }
+
+  __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(word, __ATOMIC_SEQ_CST) == seen)
+    {
+      futex_wait(word, seen, timeout_ms);
+      ret = (__atomic_load_n(word, __ATOMIC_ACQUIRE) != seen);
+    }
+  __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+  return ret;
+}
+
+static void shm_wake(uint32_t *word, uint32_t *waiting)
+{
+  if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST))
+    {
+      futex_wake(word);
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void ring_copy_in(struct wsnet2_shm_ring_t *ring, uint32_t pos, const void *src, uint32_t len)
+{
+  uint32_t off   = pos & RING_MASK;
+  uint32_t first = WSNET2_SHM_RING_SIZE - off;
+
+  if (first >= len)
+    {
+      memcpy(ring->data + off, src, len);
+    }
+  else
+    {
+      memcpy(ring->data + off, src, first);
+      memcpy(ring->data, (const uint8_t*)src + first, len - first);
+    }
+}
+
+static void ring_copy_out(struct wsnet2_shm_ring_t *ring, uint32_t pos, void *dst, uint32_t len)
+{
+  uint32_t off   = pos & RING_MASK;
+  uint32_t first = WSNET2_SHM_RING_SIZE - off;
+
+  if (first >= len)
+    {
+      memcpy(dst, ring->data + off, len);
+    }
+  else
+    {
+      memcpy(dst, ring->data + off, first);
+      memcpy((uint8_t*)dst + first, ring->data, len - first);
+    }
+}
+
+typedef int (*shm_alive_t)(struct wsnet2_shm_t*, int);
+
+static int ring_write(struct wsnet2_shm_t *shm, int slot, struct wsnet2_shm_ring_t *ring,
+		      const void *pkt, uint32_t len, uint32_t mark, shm_alive_t alive)
+{
+  uint32_t size = RECORD_SIZE(len);
+  uint32_t head = ring->head;
+  uint32_t tail;
+
+  if (size > WSNET2_SHM_RING_SIZE / 2)
+    {
+      return -1;
+    }
+
+  /* wait for room */
+  while ((head - (tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE))) + size > WSNET2_SHM_RING_SIZE)
+    {
+      if (shm_wait(&ring->tail, &ring->tail_wait, tail, WSNET2_SHM_WAIT_MS) == 0 && alive(shm, slot) == 0)
+	{
+	  return -1;
+	}
+    }
+
+  ring_copy_in(ring, head,     &len,  4);
+  ring_copy_in(ring, head + 4, &mark, 4);
+  ring_copy_in(ring, head + RECORD_HEADER, pkt, len);
+  __atomic_store_n(&ring->head, head + size, __ATOMIC_SEQ_CST);
+  shm_wake(&ring->head, &ring->head_wait);
+  return 0;
+}
+
+static int ring_read(struct wsnet2_shm_t *shm, int slot, struct wsnet2_shm_ring_t *ring,
+		     void *pkt, uint32_t maxlen, uint32_t *mark, int block, shm_alive_t alive)
+{
+  uint32_t tail = ring->tail;
+  uint32_t len;
+
+  while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail)
+    {
+      if (block == 0)
+	{
+	  return 0;
+	}
+      if (shm_wait(&ring->head, &ring->head_wait, tail, WSNET2_SHM_WAIT_MS) == 0 && alive(shm, slot) == 0)
+	{
+	  return -1;
+	}
+    }
+
+  ring_copy_out(ring, tail, &len, 4);
+  if (len > maxlen)
+    {
+      return -1;
+    }
+  ring_copy_out(ring, tail + 4, mark, 4);
+  ring_copy_out(ring, tail + RECORD_HEADER, pkt, len);
+  __atomic_store_n(&ring->tail, tail + RECORD_SIZE(len), __ATOMIC_SEQ_CST);
+  shm_wake(&ring->tail, &ring->tail_wait);
+  return len;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static int pid_alive(int32_t pid)
+{
+  return (pid <= 0) || (kill(pid, 0) == 0) || (errno != ESRCH);
+}
+
+int wsnet2_shm_server_alive(struct wsnet2_shm_t *shm, int __attribute__((unused)) slot)
+{
+  return (__atomic_load_n(&shm->closed, __ATOMIC_ACQUIRE) == 0) && pid_alive(shm->server_pid);
+}
+
+int wsnet2_shm_client_alive(struct wsnet2_shm_t *shm, int slot)
+{
+  struct wsnet2_shm_slot_t *s = &shm->slot[slot];
+  return (__atomic_load_n(&s->state, __ATOMIC_ACQUIRE) == WSNET2_SHM_SLOT_CLAIMED) && pid_alive(s->pid);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static struct wsnet2_shm_t* shm_map(const char *name, int flags)
+{
+  struct wsnet2_shm_t *shm;
+  int fd;
+
+  if ((fd = shm_open(name, flags, 0600)) == -1)
+    {
+      return NULL;
+    }
+  if ((flags & O_CREAT) && (ftruncate(fd, sizeof(struct wsnet2_shm_t)) == -1))
+    {
+      close(fd);
+      shm_unlink(name);
+      return NULL;
+    }
+  shm = mmap(NULL, sizeof(struct wsnet2_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  return (shm == MAP_FAILED) ? NULL : shm;
+}
+
+struct wsnet2_shm_t* wsnet2_shm_create(const char *name)
+{
+  struct wsnet2_shm_t *shm;
+
+  /* a stale segment left by a dead server is replaced */
+  shm_unlink(name);
+  if ((shm = shm_map(name, O_RDWR | O_CREAT | O_EXCL)) == NULL)
+    {
+      return NULL;
+    }
+  /* the new segment is zero filled, slots are free */
+  shm->version    = WSNET2_SHM_VERSION;
+  shm->server_pid = getpid();
+  __atomic_store_n(&shm->magic, WSNET2_SHM_MAGIC, __ATOMIC_RELEASE);
+  return shm;
+}
+
+void wsnet2_shm_destroy(struct wsnet2_shm_t *shm, const char *name)
+{
+  int i;
+  __atomic_store_n(&shm->closed, 1, __ATOMIC_SEQ_CST);
+  for (i = 0; i < WSNET2_SHM_SLOTS; i++)
+    {
+      futex_wake(&shm->slot[i].down.head);
+      futex_wake(&shm->slot[i].up.tail);
+    }
+  munmap(shm, sizeof(struct wsnet2_shm_t));
+  shm_unlink(name);
+}
+
+int wsnet2_shm_srv_send(struct wsnet2_shm_t *shm, int slot, const void *pkt, uint32_t len)
+{
+  return ring_write(shm, slot, &shm->slot[slot].down, pkt, len, 0, wsnet2_shm_client_alive);
+}
+
+int wsnet2_shm_srv_recv(struct wsnet2_shm_t *shm, int slot, void *pkt, uint32_t maxlen, uint32_t *mark)
+{
+  return ring_read(shm, slot, &shm->slot[slot].up, pkt, maxlen, mark, 0, wsnet2_shm_client_alive);
+}
+
+void wsnet2_shm_slot_free(struct wsnet2_shm_t *shm, int slot)
+{
+  struct wsnet2_shm_slot_t *s = &shm->slot[slot];
+  s->up.head   = s->up.tail   = 0;
+  s->down.head = s->down.tail = 0;
+  s->node_id   = 0;
+  s->pid       = 0;
+  __atomic_store_n(&s->state, WSNET2_SHM_SLOT_FREE, __ATOMIC_RELEASE);
+}
+
+int wsnet2_shm_doorbell_wait(struct wsnet2_shm_t *shm, uint32_t seen, int timeout_ms)
+{
+  return shm_wait(&shm->doorbell, &shm->doorbell_wait, seen, timeout_ms);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+struct wsnet2_shm_t* wsnet2_shm_open(const char *name)
+{
+  struct wsnet2_shm_t *shm;
+
+  if ((shm = shm_map(name, O_RDWR)) == NULL)
+    {
+      return NULL;
+    }
+  if ((__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != WSNET2_SHM_MAGIC) ||
+      (shm->version != WSNET2_SHM_VERSION))
+    {
+      munmap(shm, sizeof(struct wsnet2_shm_t));
+      errno = EPROTO;
+      return NULL;
+    }
+  return shm;
+}
+
+void wsnet2_shm_close(struct wsnet2_shm_t *shm)
+{
+  munmap(shm, sizeof(struct wsnet2_shm_t));
+}
+
+int wsnet2_shm_slot_claim(struct wsnet2_shm_t *shm, uint32_t node_id)
+{
+  int i;
+  for (i = 0; i < WSNET2_SHM_SLOTS; i++)
+    {
+      struct wsnet2_shm_slot_t *s = &shm->slot[i];
+      uint32_t state = WSNET2_SHM_SLOT_FREE;
+      if (__atomic_compare_exchange_n(&s->state, &state, WSNET2_SHM_SLOT_CLAIMED, 0,
+				      __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+	{
+	  /* rings of a free slot are empty, the server resets them on release */
+	  s->node_id = node_id;
+	  s->pid     = getpid();
+	  return i;
+	}
+    }
+  errno = EBUSY;
+  return -1;
+}
+
+void wsnet2_shm_slot_leave(struct wsnet2_shm_t *shm, int slot)
+{
+  __atomic_store_n(&shm->slot[slot].state, WSNET2_SHM_SLOT_CLOSED, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&shm->doorbell, 1, __ATOMIC_SEQ_CST);
+  shm_wake(&shm->doorbell, &shm->doorbell_wait);
+}
+
+int wsnet2_shm_send(struct wsnet2_shm_t *shm, int slot, const void *pkt, uint32_t len)
+{
+  struct wsnet2_shm_slot_t *s = &shm->slot[slot];
+  if (ring_write(shm, slot, &s->up, pkt, len, s->down.tail, wsnet2_shm_server_alive))
+    {
+      return -1;
+    }
+  __atomic_add_fetch(&shm->doorbell, 1, __ATOMIC_SEQ_CST);
+  shm_wake(&shm->doorbell, &shm->doorbell_wait);
+  return 0;
+}
+
+int wsnet2_shm_recv(struct wsnet2_shm_t *shm, int slot, void *pkt, uint32_t maxlen, int block)
+{
+  uint32_t mark;
+  return ring_read(shm, slot, &shm->slot[slot].down, pkt, maxlen, &mark, block, wsnet2_shm_server_alive);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#endif /* WSNET2_SHM */
@@ -0,0 +1,129 @@
+/**
+ *  \file   wsnet2_shm.h
+ *  \brief  Worldsens client v2, shared memory transport
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef WSNET2_SHM_H
+#define WSNET2_SHM_H
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <stdint.h>
+
+#if defined(HAVE_LINUX_FUTEX_H) && defined(HAVE_SHM_OPEN)
+#define WSNET2_SHM 1
+#endif
+
+#if defined(WSNET2_SHM)
+
+/**
+ * The shared memory transport replaces the unicast and multicast UDP
+ * sockets when wsim and the server run on the same host. The server
+ * creates a named POSIX shared memory segment holding a fixed number
+ * of client slots. A client claims a free slot and then exchanges
+ * packets with the server through two single producer / single
+ * consumer rings: "up" from client to server and "down" from server
+ * to client.
+ *
+ * Each slot has its own packet sequence, the server writes only the
+ * packets that concern a node in its down ring instead of multicasting
+ * every packet to every node. Packets are stored in host byte order.
+ *
+ * Rings are lock free, a reader spins for a short while and then
+ * sleeps on a futex on the producer index. The server sleeps on a
+ * single doorbell counter rung by clients after each write.
+ **/
+
+#define WSNET2_SHM_MAGIC      0x57534832   /* "WSH2" */
+#define WSNET2_SHM_VERSION    1
+#define WSNET2_SHM_SLOTS      64
+#define WSNET2_SHM_RING_SIZE  (64*1024)    /* power of 2 */
+
+#define WSNET2_SHM_SLOT_FREE      0
+#define WSNET2_SHM_SLOT_CLAIMED   1        /* owned by a client */
+#define WSNET2_SHM_SLOT_CLOSED    2        /* client is gone    */
+
+#define WSNET2_SHM_CACHELINE  64
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/* indexes are free running, producer and consumer are on separate lines */
+struct wsnet2_shm_ring_t {
+  uint32_t head;                                    /* producer index, futex word */
+  uint32_t head_wait;                               /* consumer sleeps on head    */
+  uint8_t  pad0[WSNET2_SHM_CACHELINE - 8];
+  uint32_t tail;                                    /* consumer index, futex word */
+  uint32_t tail_wait;                               /* producer sleeps on tail    */
+  uint8_t  pad1[WSNET2_SHM_CACHELINE - 8];
+  uint8_t  data[WSNET2_SHM_RING_SIZE];
+};
+
+struct wsnet2_shm_slot_t {
+  uint32_t state;
+  uint32_t node_id;
+  int32_t  pid;
+  uint8_t  pad[WSNET2_SHM_CACHELINE - 12];
+  struct wsnet2_shm_ring_t up;
+  struct wsnet2_shm_ring_t down;
+};
+
+struct wsnet2_shm_t {
+  uint32_t magic;
+  uint32_t version;
+  int32_t  server_pid;
+  uint32_t closed;                                  /* server is gone             */
+  uint8_t  pad0[WSNET2_SHM_CACHELINE - 16];
+  uint32_t doorbell;                                /* futex word                 */
+  uint32_t doorbell_wait;
+  uint8_t  pad1[WSNET2_SHM_CACHELINE - 8];
+  struct wsnet2_shm_slot_t slot[WSNET2_SHM_SLOTS];
+};
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/* server side */
+struct wsnet2_shm_t* wsnet2_shm_create        (const char *name);
+void                 wsnet2_shm_destroy       (struct wsnet2_shm_t *shm, const char *name);
+int                  wsnet2_shm_srv_send      (struct wsnet2_shm_t *shm, int slot, const void *pkt, uint32_t len);
+int                  wsnet2_shm_srv_recv      (struct wsnet2_shm_t *shm, int slot, void *pkt, uint32_t maxlen, uint32_t *mark);
+int                  wsnet2_shm_client_alive  (struct wsnet2_shm_t *shm, int slot);
+/* reset a closed or dead client slot */
+void                 wsnet2_shm_slot_free     (struct wsnet2_shm_t *shm, int slot);
+/* wait for a doorbell change from seen, returns 0 on timeout */
+int                  wsnet2_shm_doorbell_wait (struct wsnet2_shm_t *shm, uint32_t seen, int timeout_ms);
+
+/* client side */
+struct wsnet2_shm_t* wsnet2_shm_open          (const char *name);
+void                 wsnet2_shm_close         (struct wsnet2_shm_t *shm);
+int                  wsnet2_shm_slot_claim    (struct wsnet2_shm_t *shm, uint32_t node_id);
+void                 wsnet2_shm_slot_leave    (struct wsnet2_shm_t *shm, int slot);
+int                  wsnet2_shm_send          (struct wsnet2_shm_t *shm, int slot, const void *pkt, uint32_t len);
+int                  wsnet2_shm_recv          (struct wsnet2_shm_t *shm, int slot, void *pkt, uint32_t maxlen, int block);
+int                  wsnet2_shm_server_alive  (struct wsnet2_shm_t *shm, int slot);
+
+/*
+ * send functions block while the ring is full, recv functions return
+ * the packet length or 0 if the ring is empty and the call does not
+ * block. All return -1 on error or when the peer is gone.
+ *
+ * Records sent by a client are marked with the client read position in
+ * its down ring. Comparing the mark with the down ring head after a
+ * server packet tells whether the client had read this packet when it
+ * sent the record.
+ */
+
+static inline int wsnet2_shm_empty(struct wsnet2_shm_ring_t *ring)
+{
+  return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail;
+}
+
+#endif /* WSNET2_SHM */
+#endif
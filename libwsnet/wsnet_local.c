@@ -0,0 +1,476 @@
+/**
+ *  \file   wsnet_local.c
+ *  \brief  In-process radio medium for multinode simulations
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "machine/machine.h"
+#include "src/options.h"
+
+#include "libwsnet.h"
+#include "wsnet_local.h"
+
+#if defined(WSIM_MULTINODE)
+#include <pthread.h>
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+#define WSNET_LOCAL_DEFAULT_WINDOW   32000  /* 1 byte at 250 kbps */
+#define WSNET_LOCAL_SINR             100.0
+#define WSNET_LOCAL_BOX_INIT         64
+
+struct wsnet_local_frame_t {
+  wsimtime_t            time;    /* end of transmission */
+  uint64_t              window;  /* sender window      */
+  int                   src;     /* sender slot        */
+  int                   seq;     /* order in window    */
+  struct wsnet_tx_info  tx;
+};
+
+struct wsnet_local_box_t {
+  struct wsnet_local_frame_t *frame;
+  int                         count;
+  int                         size;
+};
+
+/* shared between the node threads */
+struct wsnet_local_medium_t {
+  pthread_mutex_t           lock;
+  pthread_cond_t            cond;
+  int                       nodes;
+  int                       running;    /* nodes still taking part in the barrier */
+  int                       arrived;
+  uint64_t                  generation; /* completed barriers */
+  int                       stop;
+  wsimtime_t                window;
+  struct wsnet_local_box_t *box[2];     /* [window parity][node slot] */
+};
+
+/* one per node thread */
+struct wsnet_local_node_t {
+  int                         index;
+  uint32_t                    node_id;
+  int                         joined;
+  int                         nb_interfaces;
+  void                       *cbrx_arg;
+  wsnet_callback_rx_t         cbrx;
+
+  uint64_t                    window;
+  wsimtime_t                  window_end;
+  wsimtime_t                  next;       /* next time update has work to do */
+  wsimtime_t                  busy;       /* rx callback wait */
+
+  struct wsnet_local_frame_t *inbox;      /* sorted by time */
+  int                         in_head;
+  int                         in_count;
+  int                         in_size;
+
+  uint64_t                    tx;
+  uint64_t                    rx;
+  uint64_t                    late;
+  uint64_t                    barriers;
+};
+
+static struct wsnet_local_medium_t        medium;
+static volatile sig_atomic_t              wsnet_local_stop_request = 0;
+static WSIM_TLS struct wsnet_local_node_t local;
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static struct moption_t window_opt = {
+  .longname    = "multinode_window",
+  .type        = required_argument,
+  .helpstring  = "multinode medium synchronisation window (ns)",
+  .value       = NULL
+};
+
+int wsnet_local_options_add(void)
+{
+  options_add( &window_opt );
+  return 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+int wsnet_local_create(int nodes)
+{
+  int p;
+
+  memset(&medium, 0, sizeof(struct wsnet_local_medium_t));
+  pthread_mutex_init(&medium.lock, NULL);
+  pthread_cond_init (&medium.cond, NULL);
+
+  medium.nodes   = nodes;
+  medium.running = nodes;
+  medium.window  = WSNET_LOCAL_DEFAULT_WINDOW;
+  if (window_opt.isset && (window_opt.value != NULL))
+    {
+      medium.window = atoll(window_opt.value);
+      if (medium.window == 0)
+	{
+	  ERROR("wsnet:local: wrong multinode_window value %s\n", window_opt.value);
+	  return 1;
+	}
+    }
+
+  for(p=0; p<2; p++)
+    {
+      medium.box[p] = (struct wsnet_local_box_t*)calloc(nodes, sizeof(struct wsnet_local_box_t));
+      if (medium.box[p] == NULL)
+	{
+	  ERROR("wsnet:local: cannot allocate medium\n");
+	  return 1;
+	}
+    }
+  return 0;
+}
+
+void wsnet_local_delete(void)
+{
+  int p, n;
+  for(p=0; p<2; p++)
+    {
+      if (medium.box[p] == NULL)
+	continue;
+      for(n=0; n<medium.nodes; n++)
+	{
+	  free(medium.box[p][n].frame);
+	}
+      free(medium.box[p]);
+      medium.box[p] = NULL;
+    }
+  pthread_cond_destroy (&medium.cond);
+  pthread_mutex_destroy(&medium.lock);
+}
+
+void wsnet_local_stop(void)
+{
+  wsnet_local_stop_request = 1;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void wsnet_local_node_set(int index, uint32_t node_id)
+{
+  memset(&local, 0, sizeof(struct wsnet_local_node_t));
+  local.index      = index;
+  local.node_id    = node_id;
+  local.joined     = 1;
+  local.window_end = medium.window;
+  local.next       = medium.window;
+}
+
+/* wake up the nodes waiting at the barrier, lock is held */
+static void wsnet_local_release(void)
+{
+  medium.arrived = 0;
+  medium.generation ++;
+  medium.stop = wsnet_local_stop_request;
+  pthread_cond_broadcast(&medium.cond);
+}
+
+void wsnet_local_node_leave(void)
+{
+  if (local.joined == 0)
+    return;
+
+  pthread_mutex_lock(&medium.lock);
+  medium.running --;
+  if ((medium.arrived > 0) && (medium.arrived == medium.running))
+    {
+      wsnet_local_release();
+    }
+  pthread_mutex_unlock(&medium.lock);
+  local.joined = 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static int wsnet_local_frame_cmp(const void *a, const void *b)
+{
+  const struct wsnet_local_frame_t *fa = a;
+  const struct wsnet_local_frame_t *fb = b;
+  if (fa->time   != fb->time)   return (fa->time   < fb->time)   ? -1 : 1;
+  if (fa->window != fb->window) return (fa->window < fb->window) ? -1 : 1;
+  if (fa->src    != fb->src)    return fa->src - fb->src;
+  return fa->seq - fb->seq;
+}
+
+/*
+ * read the bytes sent by the other nodes during window w, every node
+ * has reached the end of w and nobody writes the w parity boxes
+ */
+static int wsnet_local_ingest(uint64_t w)
+{
+  int n, i, added = 0;
+  int count;
+
+  /* drop delivered frames */
+  count = local.in_count - local.in_head;
+  if (local.in_head > 0)
+    {
+      memmove(local.inbox, local.inbox + local.in_head, count * sizeof(struct wsnet_local_frame_t));
+      local.in_head  = 0;
+      local.in_count = count;
+    }
+
+  for(n=0; n < medium.nodes; n++)
+    {
+      struct wsnet_local_box_t *box = & medium.box[w & 1][n];
+      if (n == local.index)
+	continue;
+      for(i=0; i < box->count; i++)
+	{
+	  /* boxes of stopped nodes are not cleared */
+	  if (box->frame[i].window != w)
+	    continue;
+	  if (local.in_count == local.in_size)
+	    {
+	      struct wsnet_local_frame_t *inbox;
+	      int size = (local.in_size == 0) ? WSNET_LOCAL_BOX_INIT : (local.in_size * 2);
+	      inbox = (struct wsnet_local_frame_t*)realloc(local.inbox,
+				      size * sizeof(struct wsnet_local_frame_t));
+	      if (inbox == NULL)
+		{
+		  ERROR("wsnet:local: node %d cannot grow its receive queue\n", local.node_id);
+		  return -1;
+		}
+	      local.inbox   = inbox;
+	      local.in_size = size;
+	    }
+	  local.inbox[local.in_count] = box->frame[i];
+	  if (local.inbox[local.in_count].time < local.window_end)
+	    {
+	      local.late ++;
+	    }
+	  local.in_count ++;
+	  added ++;
+	}
+    }
+
+  if (added > 0)
+    {
+      qsort(local.inbox, local.in_count, sizeof(struct wsnet_local_frame_t), wsnet_local_frame_cmp);
+    }
+  return 0;
+}
+
+/* end of the current window, returns 1 if the simulation must stop */
+static int wsnet_local_barrier(void)
+{
+  uint64_t w = local.window;
+  int stop;
+
+  pthread_mutex_lock(&medium.lock);
+  medium.arrived ++;
+  if (medium.arrived == medium.running)
+    {
+      wsnet_local_release();
+    }
+  else
+    {
+      uint64_t gen = medium.generation;
+      while (gen == medium.generation)
+	{
+	  pthread_cond_wait(&medium.cond, &medium.lock);
+	}
+    }
+  stop = medium.stop;
+  pthread_mutex_unlock(&medium.lock);
+
+  if (wsnet_local_ingest(w))
+    {
+      stop = 1;
+    }
+
+  /* everybody has read our window w-1 bytes, the box is reused for w+1 */
+  medium.box[(w + 1) & 1][local.index].count = 0;
+
+  local.window     ++;
+  local.window_end += medium.window;
+  local.barriers   ++;
+  return stop;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+int worldsensl_c_initialize(void)
+{
+  local.nb_interfaces = 0;
+  local.cbrx          = NULL;
+  local.cbrx_arg      = NULL;
+  return 0;
+}
+
+int worldsensl_c_connect(char UNUSED *srv_addr, uint16_t UNUSED srv_port,
+			 char UNUSED *mul_addr, uint16_t UNUSED mul_port, uint32_t UNUSED node_id)
+{
+  return 0;
+}
+
+int worldsensl_c_close(void)
+{
+  wsnet_local_node_leave();
+  free(local.inbox);
+  local.inbox    = NULL;
+  local.in_size  = 0;
+  local.in_count = 0;
+  local.in_head  = 0;
+  return 0;
+}
+
+int worldsensl_c_get_node_id(void)
+{
+  return local.node_id;
+}
+
+int worldsensl_c_rx_register(void* arg, wsnet_callback_rx_t cbrx, char UNUSED *antenna)
+{
+  local.cbrx_arg = arg;
+  local.cbrx     = cbrx;
+  return local.nb_interfaces++;
+}
+
+void worldsensl_c_state_save(void)
+{
+}
+
+void worldsensl_c_state_restore(void)
+{
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+int worldsensl_c_tx(struct wsnet_tx_info *tx)
+{
+  struct wsnet_local_box_t *box = & medium.box[local.window & 1][local.index];
+  struct wsnet_local_frame_t *f;
+
+  if (box->count == box->size)
+    {
+      struct wsnet_local_frame_t *frame;
+      int size = (box->size == 0) ? WSNET_LOCAL_BOX_INIT : (box->size * 2);
+      frame = (struct wsnet_local_frame_t*)realloc(box->frame,
+				size * sizeof(struct wsnet_local_frame_t));
+      if (frame == NULL)
+	{
+	  ERROR("wsnet:local: node %d cannot grow its send box\n", local.node_id);
+	  return -1;
+	}
+      box->frame = frame;
+      box->size  = size;
+    }
+
+  f = & box->frame[box->count];
+  f->time   = MACHINE_TIME_GET_NANO() + tx->duration;
+  f->window = local.window;
+  f->src    = local.index;
+  f->seq    = box->count;
+  f->tx     = *tx;
+  box->count ++;
+  local.tx  ++;
+  return 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static void wsnet_local_next(void)
+{
+  local.next = local.window_end;
+  if (local.in_head < local.in_count)
+    {
+      wsimtime_t t = local.inbox[local.in_head].time;
+      if (t < local.busy)
+	t = local.busy;
+      if (t < local.next)
+	local.next = t;
+    }
+}
+
+int worldsensl_c_update(void)
+{
+  wsimtime_t now = MACHINE_TIME_GET_NANO();
+
+  if (now < local.next)
+    return 0;
+
+  while (now >= local.window_end)
+    {
+      if (wsnet_local_barrier())
+	{
+	  mcu_signal_add(SIG_HOST | SIGINT);
+	  break;
+	}
+    }
+
+  while ((local.in_head < local.in_count) &&
+	 (local.inbox[local.in_head].time <= now) && (local.busy <= now))
+    {
+      struct wsnet_local_frame_t *f = & local.inbox[local.in_head];
+      struct wsnet_rx_info rx;
+
+      local.in_head ++;
+      if (local.cbrx == NULL)
+	continue;
+
+      memset(&rx, 0, sizeof(struct wsnet_rx_info));
+      rx.data       = f->tx.data;
+      rx.freq_mhz   = f->tx.freq_mhz;
+      rx.freq_width = f->tx.freq_width;
+      rx.modulation = f->tx.modulation;
+      rx.power_dbm  = f->tx.power_dbm;
+      rx.SiNR       = WSNET_LOCAL_SINR;
+
+      local.busy    = now + local.cbrx(local.cbrx_arg, &rx);
+      local.rx ++;
+    }
+
+  wsnet_local_next();
+  return 0;
+}
+
+uint64_t worldsensl_c_horizon(void)
+{
+  wsimtime_t now = MACHINE_TIME_GET_NANO();
+  return (local.next > now) ? (local.next - now) : 0;
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void wsnet_local_dump_stats(void)
+{
+  OUTPUT_STATS("  multinode window              : %"PRIu64" ns\n",medium.window);
+  OUTPUT_STATS("  multinode barriers            : %"PRIu64"\n",local.barriers);
+  OUTPUT_STATS("  multinode bytes sent          : %"PRIu64"\n",local.tx);
+  OUTPUT_STATS("  multinode bytes received      : %"PRIu64"\n",local.rx);
+  OUTPUT_STATS("  multinode late bytes          : %"PRIu64"\n",local.late);
+}
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+#endif /* WSIM_MULTINODE */
@@ -0,0 +1,57 @@
+/**
+ *  \file   wsnet_local.h
+ *  \brief  In-process radio medium for multinode simulations
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef WSNET_LOCAL_H
+#define WSNET_LOCAL_H
+
+#if defined(WSIM_MULTINODE)
+
+/**
+ * The local medium connects nodes running as threads of the same wsim
+ * process. Nodes run in lockstep windows of --multinode_window
+ * simulated nanoseconds. Bytes sent during a window are published in a
+ * per node outbox and read by the other nodes once every node has
+ * reached the end of the window. A byte is received at the end of its
+ * transmission, the window must thus be shorter than the shortest byte
+ * duration to keep the medium exact. Late bytes are received as soon
+ * as possible and counted.
+ *
+ * The medium is ideal: every node receives every byte with the
+ * transmission power, there is no propagation loss and no collision.
+ **/
+
+int  wsnet_local_options_add (void);
+
+/**
+ * create the medium for nodes slots, called by the main thread before
+ * the node threads are started
+ **/
+int  wsnet_local_create      (int nodes);
+void wsnet_local_delete      (void);
+
+/**
+ * bind the calling thread to the node slot index, must be called before
+ * worldsens_c_initialize()
+ **/
+void wsnet_local_node_set    (int index, uint32_t node_id);
+
+/**
+ * remove the calling node from the window barrier, called when the
+ * node stops or fails
+ **/
+void wsnet_local_node_leave  (void);
+
+/**
+ * stop all nodes at the end of the current window, can be called from
+ * a signal handler
+ **/
+void wsnet_local_stop        (void);
+
+void wsnet_local_dump_stats  (void);
+
+#endif /* WSIM_MULTINODE */
+#endif
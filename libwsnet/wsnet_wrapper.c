@@ -26,7 +26,9 @@ int  worldsens_c_initialize (int wsens_mode)
       worldsens_c_connect       = worldsens0_c_connect;
       worldsens_c_close         = worldsens0_c_close;
       worldsens_c_tx            = worldsens0_c_tx;
+      worldsens_c_tx_frame      = NULL;
       worldsens_c_update        = worldsens0_c_update;
+      worldsens_c_horizon       = worldsens0_c_horizon;
       return worldsens0_c_initialize();
 
     case WS_MODE_WSNET1 :
@@ -37,7 +39,9 @@ int  worldsens_c_initialize (int wsens_mode)
       worldsens_c_connect       = worldsens1_c_connect;
       worldsens_c_close         = worldsens1_c_close;
       worldsens_c_tx            = worldsens1_c_tx;
+      worldsens_c_tx_frame      = NULL;
       worldsens_c_update        = worldsens1_c_update;
+      worldsens_c_horizon       = worldsens1_c_horizon;
       return worldsens1_c_initialize();
 
     case WS_MODE_WSNET2 :
@@ -48,8 +52,25 @@ int  worldsens_c_initialize (int wsens_mode)
       worldsens_c_connect       = worldsens2_c_connect;
       worldsens_c_close         = worldsens2_c_close;
       worldsens_c_tx            = worldsens2_c_tx;
+      worldsens_c_tx_frame      = worldsens2_c_tx_frame;
       worldsens_c_update        = worldsens2_c_update;
+      worldsens_c_horizon       = worldsens2_c_horizon;
       return worldsens2_c_initialize();
+
+#if defined(WSIM_MULTINODE)
+    case WS_MODE_LOCAL :
+      worldsens_c_state_save    = worldsensl_c_state_save;
+      worldsens_c_state_restore = worldsensl_c_state_restore;
+      worldsens_c_get_node_id   = worldsensl_c_get_node_id;
+      worldsens_c_rx_register   = worldsensl_c_rx_register;
+      worldsens_c_connect       = worldsensl_c_connect;
+      worldsens_c_close         = worldsensl_c_close;
+      worldsens_c_tx            = worldsensl_c_tx;
+      worldsens_c_tx_frame      = NULL;
+      worldsens_c_update        = worldsensl_c_update;
+      worldsens_c_horizon       = worldsensl_c_horizon;
+      return worldsensl_c_initialize();
+#endif
     }
 
   return 0;
@@ -11,7 +11,9 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
+#include <signal.h>
 
 #include "arch/common/hardware.h"
 #include "devices/devices.h"
@@ -61,8 +63,8 @@
 /*
  * global variable and defines
  */
-struct machine_t  machine;
-static elf32_t    machine_elf  = NULL;
+WSIM_TLS struct machine_t  machine;
+static WSIM_TLS elf32_t    machine_elf  = NULL;
 
 /*
  * wsim run modes
@@ -95,6 +97,12 @@ int machine_options_add()
   res += mcu_options_add();
   /* add all devices options = Board + peripherals) */
   res += devices_options_add();
+  /* checkpoint ring                                */
+  res += machine_checkpoint_options_add();
+  /* host time profiler                             */
+  res += machine_prof_options_add();
+  /* firmware profiler                              */
+  res += machine_fwprof_options_add();
   return res;
 }
 
@@ -122,6 +130,11 @@ int machine_create()
   machine.run_time                    = 0;
   machine.run_insn                    = 0;
   machine.device_max                  = 0;
+  machine.state_saves                 = 0;
+  machine.state_save_bytes            = 0;
+  machine.state_save_time             = 0;
+  machine.state_restore_bytes         = 0;
+  machine.state_restore_time          = 0;
   memset(machine.device,      '\0',sizeof(struct device_t)*DEVICE_MAX);
   memset(machine.device_size, '\0',sizeof(int)*DEVICE_MAX);
 
@@ -137,6 +150,9 @@ int machine_create()
   /* create devices = mcu + peripherals */
   res += devices_create();
   machine_framebuffer_allocate();
+  res += machine_checkpoint_create();
+  res += machine_prof_create();
+  res += machine_fwprof_create();
 
   tracer_set_node_id(machine_get_node_id());
   return res;
@@ -151,6 +167,8 @@ int machine_delete()
   int ret = 0;
 
   ret +=  devices_delete();
+  machine_checkpoint_delete();
+  machine_fwprof_delete();
   machine_state_free();
   machine_framebuffer_free();
   libelf_close(machine_elf);
@@ -166,6 +184,7 @@ int machine_reset()
 {
   int res = 0;
   mcu_reset();
+  machine_fwprof_reset(mcu_get_pc_next());
   res += devices_reset();
   return res;
 }
@@ -267,7 +286,7 @@ static inline void system_waitmicro(int64_t micro)
   t.tv_nsec = micro * 1000;
   nanosleep(&t);
   */
-  usleep(micro);
+  libselect_wait(micro);
 }
 
 static inline uint32_t machine_run_internal(void)
@@ -284,8 +303,10 @@ static inline uint32_t machine_run_internal(void)
 
   do {
     /* run */
-    mcu_run();         // MCU step and devices
-    devices_update();  // call platform devices
+    MACHINE_CHECKPOINT_TICK();
+    MACHINE_PROF_TICK();
+    MACHINE_PROF(MPROF_MCU,     mcu_run());        // MCU step and devices
+    MACHINE_PROF(MPROF_DEVICES, devices_update()); // call platform devices
     mcu_update_done(); // MCU step done
     MACHINE_TIME_CLR_INCR();
     sig = mcu_signal_get();
@@ -409,7 +430,9 @@ void machine_run(struct machine_opt_t *m)
 	}
     }
 
+  machine_prof_run_start();
   sig = machine_run_internal();
+  machine_prof_run_stop();
   
   HW_DMSG_MISC("machine:run: stopped at 0x%04x with signal 0x%x=%s\n",mcu_get_pc(),sig,mcu_signal_str());
   /*
@@ -478,6 +501,43 @@ inline wsimtime_t machine_get_nanotime()
 /* ************************************************** */
 /* ************************************************** */
 
+wsimtime_t machine_horizon(void)
+{
+  wsimtime_t h, now;
+
+  now = MACHINE_TIME_GET_NANO();
+  h   = devices_horizon();
+
+  if (h > 0)
+    {
+      wsimtime_t w = LIBWSNET_HORIZON();
+      if (w < h)
+	h = w;
+    }
+
+  if ((h > 0) && (machine.run_limit & LIMIT_TIME))
+    {
+      wsimtime_t t = (machine.run_time > now) ? (machine.run_time - now) : 0;
+      if (t < h)
+	h = t;
+    }
+
+  if (h > 0)
+    {
+      /* keep TIMESTAMP records at the same place in traces */
+      wsimtime_t next = machine.state->timestamp + (wsimtime_t)WSIM_RECORD_INTERNAL_TIME_PREC + 1;
+      wsimtime_t t    = (next > now) ? (next - now) : 0;
+      if (t < h)
+	h = t;
+    }
+
+  return h;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 uint8_t* machine_state_allocate(int devices_size)
 {
   uint8_t *ptr;
@@ -528,22 +588,80 @@ void machine_state_free(void)
 /* ************************************************** */
 /* ************************************************** */
 
+/*
+ * Devices update their state through direct pointers in machine.state,
+ * writes cannot be tracked. Blocks are compared with the backup and only
+ * the modified ones are copied. Device states are small compared to the
+ * mcu and mostly unchanged between two rendez-vous.
+ */
+#define MACHINE_STATE_BLOCK 128
+
+static int machine_state_copy(uint8_t *dst, uint8_t *src, int size)
+{
+  int offset;
+  int copied = 0;
+
+  for(offset = 0; offset < size; offset += MACHINE_STATE_BLOCK)
+    {
+      int len = size - offset;
+      if (len > MACHINE_STATE_BLOCK)
+	len = MACHINE_STATE_BLOCK;
+      if (memcmp(dst + offset, src + offset, len) != 0)
+	{
+	  memcpy(dst + offset, src + offset, len);
+	  copied += len;
+	}
+    }
+  return copied;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static inline wsimtime_t system_gettime_nano()
+{
+#if defined(CLOCK_MONOTONIC)
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (wsimtime_t)t.tv_sec * 1000 * 1000 * 1000 + t.tv_nsec;
+#else
+  return system_gettime() * 1000;
+#endif
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 void machine_state_save()
 {
+  wsimtime_t start = system_gettime_nano();
+  MACHINE_PROF_ENTER();
   /* mcu              */
-  mcu_state_save();
+  machine.state_save_bytes += mcu_state_save();
   /* devices          */
-  memcpy(machine.state_backup, machine.state, machine.state_size);
+  machine.state_save_bytes += machine_state_copy((uint8_t*)machine.state_backup, 
+						 (uint8_t*)machine.state, machine.state_size);
+  devimg_state_save();
   /* libselect        */
   libselect_state_save();
   /* event tracer     */
   tracer_state_save();
   /* esimu tracer     */
   etracer_state_save();
+  /* energy accountant */
+  energy_state_save();
+  /* firmware profiler */
+  machine_fwprof_state_save();
   /* pkt logger       */
   logpkt_state_save();
   /* libwsnet         */
   worldsens_c_state_save();
+  /* statistics       */
+  machine.state_saves ++;
+  machine.state_save_time += system_gettime_nano() - start;
+  MACHINE_PROF_LEAVE(MPROF_STATE_SAVE);
 }
 
 /* ************************************************** */
@@ -552,23 +670,44 @@ void machine_state_save()
 
 void machine_state_restore()
 {
+  int bytes;
+  wsimtime_t start = system_gettime_nano();
+  MACHINE_PROF_ENTER();
   /* mcu              */
-  mcu_state_restore();
+  machine.state_restore_bytes += mcu_state_restore();
   /* devices          */
-  memcpy(machine.state, machine.state_backup, machine.state_size);
+  machine.state_restore_bytes += machine_state_copy((uint8_t*)machine.state, 
+						    (uint8_t*)machine.state_backup, machine.state_size);
+  if ((bytes = devimg_state_restore()) < 0)
+    {
+      ERROR("wsim: flash images cannot be restored, simulation is stopped\n");
+      mcu_signal_add(SIG_HOST | SIGABRT);
+    }
+  else
+    {
+      machine.state_restore_bytes += bytes;
+    }
   /* libselect        */
   libselect_state_restore();
   /* event tracer     */
   tracer_state_restore();
   /* esimu tracer     */
   etracer_state_restore();
+  /* energy accountant */
+  energy_state_restore();
+  /* firmware profiler */
+  machine_fwprof_state_restore();
   /* pkt logger       */
   logpkt_state_restore();
   /* libwsnet         */
   worldsens_c_state_restore();
   /* count backtracks */
   machine.backtrack ++;
+  machine.state_restore_time += system_gettime_nano() - start;
   MACHINE_TRC_BACKTRACK_RECORD();
+  /* host profiler    */
+  machine_prof_state_restore();
+  MACHINE_PROF_LEAVE(MPROF_STATE_RESTORE);
 }
 
 /* ************************************************** */
@@ -667,6 +806,13 @@ void machine_dump_stats(uint64_t user_nanotime)
       OUTPUT_STATS("  simulation speedup            : %2.2f\n",speedup);
     }
   OUTPUT_STATS("  machine exit with signal      : %s\n",mcu_signal_str());
+  OUTPUT_STATS("  state saves                   : %"PRIu64"\n",machine.state_saves);
+  OUTPUT_STATS("  state saved bytes             : %"PRIu64"\n",machine.state_save_bytes);
+  OUTPUT_STATS("  state save time               : %"PRIu64" us\n",machine.state_save_time / 1000);
+  OUTPUT_STATS("  state restores                : %u\n",machine.backtrack);
+  OUTPUT_STATS("  state restored bytes          : %"PRIu64"\n",machine.state_restore_bytes);
+  OUTPUT_STATS("  state restore time            : %"PRIu64" us\n",machine.state_restore_time / 1000);
+  machine_checkpoint_dump_stats();
   OUTPUT_STATS("\n");
   OUTPUT_STATS("MCU:\n");
   OUTPUT_STATS("----\n");
@@ -675,6 +821,21 @@ void machine_dump_stats(uint64_t user_nanotime)
   OUTPUT_STATS("DEVICES:\n");
   OUTPUT_STATS("--------\n");
   devices_dump_stats(user_nanotime);
+  energy_dump_stats();
+  if (machine_prof.enabled)
+    {
+      OUTPUT_STATS("\n");
+      OUTPUT_STATS("HOST PROFILE:\n");
+      OUTPUT_STATS("-------------\n");
+      machine_prof_dump_stats();
+    }
+  if (machine_fwprof.pc != NULL)
+    {
+      OUTPUT_STATS("\n");
+      OUTPUT_STATS("FIRMWARE PROFILE:\n");
+      OUTPUT_STATS("-----------------\n");
+      machine_fwprof_dump_stats(machine_elf);
+    }
 }
 
 /**************************************************/
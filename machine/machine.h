@@ -12,6 +12,7 @@
 #include "arch/common/hardware.h"
 #include "devices/devices.h"
 #include "libelf/libelf.h"
+#include "machine_checkpoint.h"
 
 
 struct machine_opt_t {
@@ -73,6 +74,12 @@ int machine_get_node_id(void);
  */
 wsimtime_t machine_get_nanotime(void);
 
+/**
+ * machine_horizon : delay (ns) during which no external device, network
+ * or run limit event is expected. WSIM_HORIZON_INF if none.
+ */
+wsimtime_t machine_horizon(void);
+
 /**
  * machine_run
  **/
@@ -0,0 +1,691 @@
+/**
+ *  \file   machine_checkpoint.c
+ *  \brief  Machine checkpoint ring
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arch/common/hardware.h"
+#include "devices/devices.h"
+#include "src/options.h"
+
+#include "machine.h"
+#include "machine_checkpoint.h"
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#define CHECKPOINT_DEFAULT_PERIOD  (10*1000*1000) /* 10 ms */
+#define CHECKPOINT_BLOCK           64
+#define CHECKPOINT_NO_HIT          ((uint64_t)-1)
+#define CHECKPOINT_DEBUG_MEM       0x10000
+
+#define RING_INDEX(i) (((i) + machine_checkpoint.max) % machine_checkpoint.max)
+
+struct checkpoint_t {
+  wsimtime_t  time;
+  uint64_t    insn;
+  uint8_t    *delta;        /* reverse delta to the next image, empty for the newest */
+  int         delta_size;
+  uint8_t    *images;       /* devices images undo to the next checkpoint            */
+  int         images_size;
+};
+
+WSIM_TLS struct machine_checkpoint_t machine_checkpoint;
+
+static WSIM_TLS struct checkpoint_t *ring      = NULL;
+static WSIM_TLS int                  ring_head = 0;
+static WSIM_TLS int                  ring_count= 0;
+
+static WSIM_TLS int                  mcu_size;
+static WSIM_TLS int                  image_size;
+static WSIM_TLS uint8_t             *image     = NULL; /* newest checkpoint    */
+static WSIM_TLS uint8_t             *scratch   = NULL; /* current state        */
+static WSIM_TLS uint8_t             *delta_buf = NULL; /* worst case delta     */
+
+/*
+ * memory written by the debugger (software breakpoints) is kept
+ * when a checkpoint is restored
+ */
+static WSIM_TLS uint8_t              debug_mem[CHECKPOINT_DEBUG_MEM / 8];
+static WSIM_TLS int                  debug_mem_used = 0;
+
+/*
+ * libselect, the event tracer and the packet logger are written at
+ * checkpoints. A restore rewinds them to the newest checkpoint, the run
+ * from an older checkpoint up to the newest one has already been written
+ * and its outputs are dropped.
+ */
+static WSIM_TLS int                  outputs        = 0;
+static WSIM_TLS int                  outputs_replay = 0;
+static WSIM_TLS wsimtime_t           outputs_time   = 0; /* end of the written outputs */
+static WSIM_TLS int                  outputs_tracer = 0; /* tracer stopped by the replay */
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static struct moption_t checkpoint_opt = {
+  .longname    = "checkpoint",
+  .type        = required_argument,
+  .helpstring  = "checkpoint ring size (reverse execution)",
+  .value       = NULL
+};
+
+static struct moption_t checkpoint_period_opt = {
+  .longname    = "checkpoint_period",
+  .type        = required_argument,
+  .helpstring  = "checkpoint period in ns (default 10ms)",
+  .value       = NULL
+};
+
+int machine_checkpoint_options_add(void)
+{
+  options_add( &checkpoint_opt        );
+  options_add( &checkpoint_period_opt );
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int machine_checkpoint_create(void)
+{
+  memset(&machine_checkpoint, 0, sizeof(struct machine_checkpoint_t));
+  machine_checkpoint.next   = WSIM_HORIZON_INF;
+  machine_checkpoint.period = CHECKPOINT_DEFAULT_PERIOD;
+
+  if (checkpoint_opt.value != NULL)
+    {
+      machine_checkpoint.max = atoi(checkpoint_opt.value);
+      if (machine_checkpoint.max < 0)
+	{
+	  ERROR("wsim:checkpoint: ring size must be positive\n");
+	  return 1;
+	}
+    }
+
+  if (checkpoint_period_opt.value != NULL)
+    {
+      machine_checkpoint.period = atoll(checkpoint_period_opt.value);
+      if (machine_checkpoint.period == 0)
+	{
+	  ERROR("wsim:checkpoint: period must be positive\n");
+	  return 1;
+	}
+    }
+
+  if (machine_checkpoint.max > 0)
+    {
+      /* first checkpoint when the machine starts */
+      machine_checkpoint.next = 0;
+      HW_DMSG_MISC("wsim:checkpoint: %d checkpoints every %"PRIu64" ns\n",
+		   machine_checkpoint.max, machine_checkpoint.period);
+    }
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void machine_checkpoint_delete(void)
+{
+  int i;
+  if (ring != NULL)
+    {
+      for(i=0; i < machine_checkpoint.max; i++)
+	{
+	  free(ring[i].delta);
+	  free(ring[i].images);
+	}
+      free(ring);
+      ring = NULL;
+    }
+  free(image);
+  free(scratch);
+  free(delta_buf);
+  image      = NULL;
+  scratch    = NULL;
+  delta_buf  = NULL;
+  ring_count = 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void checkpoint_outputs_save(void)
+{
+  if (outputs && !outputs_replay)
+    {
+      libselect_state_save();
+      tracer_state_save();
+      logpkt_state_save();
+    }
+}
+
+static void checkpoint_outputs_restore(void)
+{
+  libselect_state_restore();
+  tracer_state_restore();
+  logpkt_state_restore();
+}
+
+/* the replay reached the end of the written outputs */
+static void checkpoint_outputs_resume(void)
+{
+  checkpoint_outputs_restore();
+  outputs_replay = 0;
+  if (outputs_tracer)
+    {
+      tracer_start();
+      outputs_tracer = 0;
+    }
+}
+
+void machine_checkpoint_outputs_open(void)
+{
+  if (machine_checkpoint.max == 0)
+    return;
+
+  libselect_set_backtrack(1);
+  tracer_set_backtrack(1);
+  logpkt_set_backtrack(1);
+  outputs = 1;
+}
+
+void machine_checkpoint_outputs_close(void)
+{
+  if (outputs == 0)
+    return;
+
+  if (outputs_replay)
+    {
+      checkpoint_outputs_resume();
+    }
+  checkpoint_outputs_save();
+  libselect_set_backtrack(0);
+  tracer_set_backtrack(0);
+  logpkt_set_backtrack(0);
+  outputs = 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static int checkpoint_alloc(void)
+{
+  int blocks;
+
+  /* state size is known once devices are created */
+  mcu_size   = mcu_state_size();
+  image_size = mcu_size + machine.state_size;
+  blocks     = (image_size + CHECKPOINT_BLOCK - 1) / CHECKPOINT_BLOCK;
+
+  ring      = (struct checkpoint_t*)calloc(machine_checkpoint.max, sizeof(struct checkpoint_t));
+  image     = (uint8_t*)malloc(image_size);
+  scratch   = (uint8_t*)malloc(image_size);
+  delta_buf = (uint8_t*)malloc(blocks * (sizeof(uint32_t) + CHECKPOINT_BLOCK));
+
+  if ((ring == NULL) || (image == NULL) || (scratch == NULL) || (delta_buf == NULL))
+    {
+      ERROR("wsim:checkpoint: cannot allocate %d checkpoints of %d bytes\n",
+	    machine_checkpoint.max, image_size);
+      machine_checkpoint_delete();
+      return 1;
+    }
+
+  ring_head  = machine_checkpoint.max - 1;
+  ring_count = 0;
+  return 0;
+}
+
+/* the ring cannot be kept consistent, checkpoints are stopped */
+static void checkpoint_disable(void)
+{
+  machine_checkpoint_outputs_close();
+  machine_checkpoint_delete();
+  machine_checkpoint.max  = 0;
+  machine_checkpoint.next = WSIM_HORIZON_INF;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void checkpoint_export(uint8_t *dst)
+{
+  mcu_state_export(dst);
+  memcpy(dst + mcu_size, machine.state, machine.state_size);
+}
+
+static void checkpoint_import(uint8_t *src)
+{
+  mcu_state_import(src);
+  memcpy(machine.state, src + mcu_size, machine.state_size);
+  /* signals pending when the checkpoint was taken belong to the past */
+  mcu_signal_set(mcu_signal_get() & SIG_MCU_LPM_CHANGE);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * delta records are a block offset followed by the block content
+ * in the older image
+ **/
+
+static int checkpoint_delta_encode(uint8_t *newer, uint8_t *older)
+{
+  uint32_t offset;
+  int      size = 0;
+
+  for(offset = 0; offset < (uint32_t)image_size; offset += CHECKPOINT_BLOCK)
+    {
+      int len = image_size - offset;
+      if (len > CHECKPOINT_BLOCK)
+	len = CHECKPOINT_BLOCK;
+      if (memcmp(newer + offset, older + offset, len) != 0)
+	{
+	  memcpy(delta_buf + size, &offset, sizeof(uint32_t));
+	  size += sizeof(uint32_t);
+	  memcpy(delta_buf + size, older + offset, len);
+	  size += len;
+	}
+    }
+  return size;
+}
+
+static void checkpoint_delta_apply(uint8_t *img, uint8_t *delta, int size)
+{
+  int pos = 0;
+
+  while (pos < size)
+    {
+      uint32_t offset;
+      int      len;
+      memcpy(&offset, delta + pos, sizeof(uint32_t));
+      pos += sizeof(uint32_t);
+      len  = image_size - offset;
+      if (len > CHECKPOINT_BLOCK)
+	len = CHECKPOINT_BLOCK;
+      memcpy(img + offset, delta + pos, len);
+      pos += len;
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void machine_checkpoint_take(void)
+{
+  struct checkpoint_t *cp;
+  uint8_t *tmp;
+  uint8_t *images;
+  int      images_size;
+
+  if (machine_checkpoint.max == 0)
+    {
+      machine_checkpoint.next = WSIM_HORIZON_INF;
+      return;
+    }
+
+  if ((ring == NULL) && (checkpoint_alloc() != 0))
+    {
+      machine_checkpoint_outputs_close();
+      machine_checkpoint.max  = 0;
+      machine_checkpoint.next = WSIM_HORIZON_INF;
+      return;
+    }
+
+  /* drop the oldest checkpoint */
+  if (ring_count == machine_checkpoint.max)
+    {
+      cp = &ring[RING_INDEX(ring_head - ring_count + 1)];
+      free(cp->delta);
+      free(cp->images);
+      cp->delta       = NULL;
+      cp->delta_size  = 0;
+      cp->images      = NULL;
+      cp->images_size = 0;
+      ring_count --;
+      machine_checkpoint.dropped ++;
+    }
+
+  if (outputs_replay && (MACHINE_TIME_GET_NANO() >= outputs_time))
+    {
+      checkpoint_outputs_resume();
+    }
+
+  checkpoint_export(scratch);
+  if ((images_size = devimg_checkpoint_take(&images)) < 0)
+    {
+      ERROR("wsim:checkpoint: devices images cannot be recorded, checkpoints are disabled\n");
+      checkpoint_disable();
+      return;
+    }
+
+  /* previous newest checkpoint becomes a delta */
+  if (ring_count > 0)
+    {
+      int size;
+      cp   = &ring[ring_head];
+      size = checkpoint_delta_encode(scratch, image);
+      if ((cp->delta = (uint8_t*)malloc(size + 1)) == NULL)
+	{
+	  ERROR("wsim:checkpoint: cannot allocate delta of %d bytes\n", size);
+	  free(images);
+	  checkpoint_disable();
+	  return;
+	}
+      memcpy(cp->delta, delta_buf, size);
+      cp->delta_size  = size;
+      cp->images      = images;
+      cp->images_size = images_size;
+      machine_checkpoint.delta_bytes += size + images_size;
+    }
+  else
+    {
+      free(images);
+    }
+
+  tmp     = image;
+  image   = scratch;
+  scratch = tmp;
+
+  ring_head      = RING_INDEX(ring_head + 1);
+  cp             = &ring[ring_head];
+  cp->time       = MACHINE_TIME_GET_NANO();
+  cp->insn       = mcu_get_insn();
+  cp->delta       = NULL;
+  cp->delta_size  = 0;
+  cp->images      = NULL;
+  cp->images_size = 0;
+  ring_count ++;
+
+  checkpoint_outputs_save();
+
+  machine_checkpoint.taken ++;
+  machine_checkpoint.next = cp->time + machine_checkpoint.period;
+  HW_DMSG_MISC("wsim:checkpoint: take at %"PRIu64" ns, insn %"PRIu64", %d in ring\n",
+	       cp->time, cp->insn, ring_count);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * restore the checkpoint 'dist' steps before the newest one, newer
+ * checkpoints are dropped
+ **/
+
+static int checkpoint_restore(int dist)
+{
+  int i;
+  uint32_t addr;
+
+  /* devices images are not in the checkpoint image, back to the newest */
+  if (devimg_checkpoint_rewind() < 0)
+    {
+      ERROR("wsim:checkpoint: devices images cannot be restored, checkpoints are disabled\n");
+      checkpoint_disable();
+      return -1;
+    }
+
+  /* outputs are back to the newest checkpoint, or to the end of the replay */
+  if (outputs)
+    {
+      checkpoint_outputs_restore();
+      if ((dist > 0) && !outputs_replay)
+	{
+	  outputs_replay = 1;
+	  outputs_time   = ring[ring_head].time;
+	  outputs_tracer = (tracer_event_record_ptr != NULL);
+	  tracer_stop();
+	}
+    }
+
+  for(i=0; i < dist; i++)
+    {
+      struct checkpoint_t *cp;
+      ring_head = RING_INDEX(ring_head - 1);
+      cp        = &ring[ring_head];
+      checkpoint_delta_apply(image, cp->delta, cp->delta_size);
+      devimg_checkpoint_apply(cp->images, cp->images_size);
+      free(cp->delta);
+      free(cp->images);
+      cp->delta       = NULL;
+      cp->delta_size  = 0;
+      cp->images      = NULL;
+      cp->images_size = 0;
+      ring_count --;
+    }
+
+  if (debug_mem_used == 0)
+    {
+      checkpoint_import(image);
+    }
+  else
+    {
+      /* keep the debugger view of the memory, 0xffff included */
+      uint8_t *mem = (uint8_t*)malloc(CHECKPOINT_DEBUG_MEM);
+      for(addr = 0; (mem != NULL) && (addr < CHECKPOINT_DEBUG_MEM); addr++)
+	{
+	  if (debug_mem[addr >> 3] & (1 << (addr & 7)))
+	    {
+	      mem[addr] = mcu_jtag_read_byte(addr);
+	    }
+	}
+      checkpoint_import(image);
+      for(addr = 0; (mem != NULL) && (addr < CHECKPOINT_DEBUG_MEM); addr++)
+	{
+	  if (debug_mem[addr >> 3] & (1 << (addr & 7)))
+	    {
+	      mcu_jtag_write_byte(addr, mem[addr]);
+	    }
+	}
+      free(mem);
+    }
+
+  machine_checkpoint.restored ++;
+  machine_checkpoint.next = ring[ring_head].time + machine_checkpoint.period;
+  HW_DMSG_MISC("wsim:checkpoint: restore at %"PRIu64" ns, insn %"PRIu64"\n",
+	       ring[ring_head].time, ring[ring_head].insn);
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static int checkpoint_find_time(wsimtime_t time)
+{
+  int dist;
+  for(dist = 0; dist < ring_count; dist++)
+    {
+      if (ring[RING_INDEX(ring_head - dist)].time <= time)
+	return dist;
+    }
+  return -1;
+}
+
+/*
+ * several loop iterations can run at the same instruction count (LPM,
+ * interrupts), a checkpoint strictly before the target is used
+ */
+static int checkpoint_find_insn(uint64_t insn)
+{
+  int dist;
+  for(dist = 0; dist < ring_count; dist++)
+    {
+      uint64_t n = ring[RING_INDEX(ring_head - dist)].insn;
+      if ((n < insn) || (n == 0))
+	return dist;
+    }
+  return -1;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * run forward until time or insn is reached. Breakpoint and watchpoint
+ * hits before 'insn' (or at 'insn' if inclusive) are stored in 'hit'
+ **/
+
+static uint32_t checkpoint_replay(wsimtime_t time, uint64_t insn, uint64_t *hit, int inclusive)
+{
+  uint32_t sig   = 0;
+  uint64_t start = mcu_get_insn();
+
+  while ((MACHINE_TIME_GET_NANO() < time) && (mcu_get_insn() < insn))
+    {
+      MACHINE_CHECKPOINT_TICK();
+      mcu_run();
+      devices_update();
+      mcu_update_done();
+      MACHINE_TIME_CLR_INCR();
+      sig = mcu_signal_get();
+
+      if ((sig & SIG_MAC) || ((sig & SIG_MCU) && (sig & SIG_MCU_TRAP)))
+	{
+	  uint64_t n = mcu_get_insn();
+	  if ((hit != NULL) && ((n < insn) || (inclusive && (n == insn))))
+	    {
+	      *hit = n;
+	    }
+	  mcu_signal_remove(SIG_MAC | MAC_TO_SIG(MAC_ALL));
+	  if ((mcu_signal_get() & SIG_MCU_ALL) == SIG_MCU_TRAP)
+	    {
+	      mcu_signal_remove(SIG_MCU | SIG_MCU_TRAP);
+	    }
+	  sig = mcu_signal_get();
+	}
+
+      if (sig != 0)
+	{
+	  HW_DMSG_MISC("wsim:checkpoint: replay stopped with signal %s\n",mcu_signal_str());
+	  break;
+	}
+    }
+
+  machine_checkpoint.replayed_insn += mcu_get_insn() - start;
+  return sig;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int machine_checkpoint_goto_time(wsimtime_t time)
+{
+  int dist;
+
+  if (((dist = checkpoint_find_time(time)) == -1) || (checkpoint_restore(dist) != 0))
+    {
+      return -1;
+    }
+  checkpoint_replay(time, CHECKPOINT_NO_HIT, NULL, 0);
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int machine_checkpoint_goto_insn(uint64_t insn)
+{
+  int dist;
+
+  if ((insn > mcu_get_insn()) || ((dist = checkpoint_find_insn(insn)) == -1) ||
+      (checkpoint_restore(dist) != 0))
+    {
+      return -1;
+    }
+  checkpoint_replay(WSIM_HORIZON_INF, insn, NULL, 0);
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int machine_checkpoint_reverse_continue(void)
+{
+  uint64_t limit = mcu_get_insn();
+  int inclusive  = 0;
+  int dist;
+
+  /* search backward one checkpoint interval at a time */
+  while ((limit > 0) && ((dist = checkpoint_find_insn(limit)) != -1))
+    {
+      uint64_t hit   = CHECKPOINT_NO_HIT;
+      uint64_t start;
+
+      if (checkpoint_restore(dist) != 0)
+	{
+	  return -1;
+	}
+      start = mcu_get_insn();
+      checkpoint_replay(WSIM_HORIZON_INF, limit, &hit, inclusive);
+
+      if (hit != CHECKPOINT_NO_HIT)
+	{
+	  HW_DMSG_MISC("wsim:checkpoint: reverse continue hit at insn %"PRIu64"\n",hit);
+	  return machine_checkpoint_goto_insn(hit);
+	}
+
+      /* try the previous interval */
+      limit     = start;
+      inclusive = 1;
+    }
+
+  /* no hit, stop at the beginning of the recorded history */
+  if (ring_count > 0)
+    {
+      checkpoint_restore(ring_count - 1);
+    }
+  return -1;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void machine_checkpoint_debug_write(uint16_t addr)
+{
+  debug_mem[addr >> 3] |= 1 << (addr & 7);
+  debug_mem_used = 1;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void machine_checkpoint_dump_stats(void)
+{
+  if (machine_checkpoint.taken == 0)
+    return;
+
+  OUTPUT_STATS("  checkpoints taken             : %"PRIu64"\n",machine_checkpoint.taken);
+  OUTPUT_STATS("  checkpoints dropped           : %"PRIu64"\n",machine_checkpoint.dropped);
+  OUTPUT_STATS("  checkpoint restores           : %"PRIu64"\n",machine_checkpoint.restored);
+  OUTPUT_STATS("  checkpoint replayed insn      : %"PRIu64"\n",machine_checkpoint.replayed_insn);
+  OUTPUT_STATS("  checkpoint delta bytes        : %"PRIu64"\n",machine_checkpoint.delta_bytes);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
@@ -0,0 +1,105 @@
+/**
+ *  \file   machine_checkpoint.h
+ *  \brief  Machine checkpoint ring
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef MACHINE_CHECKPOINT_H
+#define MACHINE_CHECKPOINT_H
+
+/**
+ * The checkpoint ring keeps the last N machine states (mcu + devices)
+ * taken every checkpoint_period simulated nanoseconds. The newest
+ * checkpoint is stored as a full image, older ones are stored as reverse
+ * deltas: the blocks that must be changed in the next checkpoint image to
+ * get back to this one.
+ *
+ * A restore goes back to the nearest checkpoint before the requested
+ * time (or instruction) and runs the machine forward up to the target.
+ * Checkpoints newer than the restored one are dropped and taken again
+ * during the forward run.
+ *
+ * Devices memory images (external flash) are outside of the checkpoint
+ * image, each checkpoint keeps the image blocks written until the next
+ * one and they are copied back on restore.
+ *
+ * libselect, the event tracer and the packet logger are saved at each
+ * checkpoint as they are at a wsnet rendez-vous: their outputs are held
+ * until the checkpoint and a restore rewinds them to the newest one. The
+ * forward run from an older checkpoint does not write again what was
+ * written up to the newest checkpoint. Serial input read before the
+ * newest checkpoint is not replayed. The eSimu tracer, the energy
+ * accountant and the profilers are not rewound.
+ **/
+
+struct machine_checkpoint_t {
+  int         max;           /* ring size, 0 = disabled */
+  wsimtime_t  period;
+  wsimtime_t  next;          /* time of the next checkpoint */
+
+  /* statistics */
+  uint64_t    taken;
+  uint64_t    dropped;
+  uint64_t    restored;
+  uint64_t    replayed_insn;
+  uint64_t    delta_bytes;
+};
+
+extern WSIM_TLS struct machine_checkpoint_t machine_checkpoint;
+
+#define MACHINE_CHECKPOINT_TICK()			  \
+  do {							  \
+    if (MACHINE_TIME_GET_NANO() >= machine_checkpoint.next) \
+      MACHINE_PROF(MPROF_CHECKPOINT, machine_checkpoint_take()); \
+  } while (0)
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int  machine_checkpoint_options_add (void);
+int  machine_checkpoint_create      (void);
+void machine_checkpoint_delete      (void);
+
+/**
+ * outputs are written at checkpoints, open is called once the machine
+ * is created when wsnet does not save them already, close writes the
+ * pending outputs before the tracers are closed
+ **/
+void machine_checkpoint_outputs_open  (void);
+void machine_checkpoint_outputs_close (void);
+
+/**
+ * record the current machine state in the ring
+ **/
+void machine_checkpoint_take        (void);
+
+/**
+ * restore the nearest checkpoint before time and run up to time.
+ * returns -1 if there is no checkpoint before time
+ **/
+int  machine_checkpoint_goto_time   (wsimtime_t time);
+
+/**
+ * restore the nearest checkpoint before insn and run up to insn
+ * executed instructions. returns -1 if there is no checkpoint before insn
+ **/
+int  machine_checkpoint_goto_insn   (uint64_t insn);
+
+/**
+ * go back to the last breakpoint or watchpoint hit before the current
+ * instruction. returns -1 and stops at the oldest checkpoint if there is
+ * none in the recorded history
+ **/
+int  machine_checkpoint_reverse_continue (void);
+
+/**
+ * memory written by the debugger is kept across restores (software
+ * breakpoints inserted before a reverse continue)
+ **/
+void machine_checkpoint_debug_write (uint16_t addr);
+
+void machine_checkpoint_dump_stats  (void);
+
+#endif
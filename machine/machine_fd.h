@@ -47,6 +47,10 @@ struct machine_state_t {
   wsimtime_t    nanotime_incr;
   wsimtime_t    timestamp;
   char          watchpoint_modify_on_first_write[MONITOR_MAX_WATCHPOINT];
+  /* sleeping devices, see devices/devices_net.h */
+  uint32_t      devnet_sleep;
+  uint32_t      devnet_quiet;
+  wsimtime_t    devnet_wake[DEVICE_MAX];
   /* devices_state MUST be last */
   uint8_t       devices_state[0];
 };
@@ -83,6 +87,15 @@ struct machine_t
   wsimtime_t               run_time;
   uint64_t                 run_insn;
 
+  /**
+   * state save/restore statistics
+   **/
+  uint64_t                 state_saves;
+  uint64_t                 state_save_bytes;
+  wsimtime_t               state_save_time;
+  uint64_t                 state_restore_bytes;
+  wsimtime_t               state_restore_time;
+
   /**
    * trace log
    **/
@@ -105,7 +118,7 @@ struct machine_t
 /**
  * global variable storing the emulator machine state
  **/
-extern struct machine_t machine;
+extern WSIM_TLS struct machine_t machine;
 
 /* ************************************************** */
 /* ************************************************** */
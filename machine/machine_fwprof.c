@@ -0,0 +1,678 @@
+/**
+ *  \file   machine_fwprof.c
+ *  \brief  Firmware profiler, per pc cycle histogram and call graph
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arch/common/hardware.h"
+#include "libelf/libelf.h"
+#include "src/options.h"
+
+#include "machine.h"
+#include "machine_fwprof.h"
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#define DEBUG_FWPROF 0
+
+#if DEBUG_FWPROF != 0
+#define FWPROF_DBG(x...) HW_DMSG_MISC(x)
+#else
+#define FWPROF_DBG(x...) do { } while (0)
+#endif
+
+#define FWPROF_DEFAULT_FILE  "callgrind.out.wsim"
+#define FWPROF_ARCS_MIN      256
+#define FWPROF_NAME_LENGTH   8
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/* caller -> callee arc, interrupt handlers have no call site */
+struct fwprof_arc_t {
+  uint64_t   key;          /* irq:1 site:16 target:16, 0 is a free slot */
+  uint64_t   count;
+  uint64_t   cycles;       /* inclusive cost of all activations         */
+  uint64_t   insn;
+  uint64_t   outer_cycles; /* callee was not already on the call stack  */
+  uint64_t   outer_insn;
+};
+
+#define FWPROF_ARC_KEY(irq,site,target) ((1ull << 33) | ((uint64_t)(irq) << 32) | \
+					 ((uint64_t)(site) << 16) | (uint64_t)(target))
+/* fields are unsigned int, they are used as indexes and printed with %x */
+#define FWPROF_ARC_IRQ(key)    ((unsigned int)(((key) >> 32) & 1))
+#define FWPROF_ARC_SITE(key)   ((unsigned int)(((key) >> 16) & 0xffff))
+#define FWPROF_ARC_TARGET(key) ((unsigned int)((key) & 0xffff))
+
+/* function found in the elf symbols, at a call target or at an unknown pc */
+struct fwprof_fn_t {
+  uint32_t     addr;
+  uint32_t     size;       /* 0 : up to the next function */
+  const char  *name;       /* NULL : named by address  */
+  char         addr_name[FWPROF_NAME_LENGTH];
+  uint64_t     self_cycles;
+  uint64_t     self_insn;
+  uint64_t     incl_cycles;
+  uint64_t     incl_insn;
+  uint64_t     calls;
+};
+
+WSIM_TLS struct machine_fwprof_t machine_fwprof;
+
+static WSIM_TLS char                 fwprof_filename[MAX_FILENAME];
+static WSIM_TLS struct fwprof_arc_t *fwprof_arcs     = NULL;
+static WSIM_TLS uint32_t             fwprof_arcs_max = 0;
+static WSIM_TLS uint32_t             fwprof_arcs_n   = 0;
+
+/* backtrack, the pc table is not restored */
+static WSIM_TLS int                            fwprof_backup_depth;
+static WSIM_TLS int                            fwprof_backup_lost;
+static WSIM_TLS struct machine_fwprof_frame_t  fwprof_backup_stack[FWPROF_DEPTH];
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static struct moption_t profile_opt = {
+  .longname    = "profile",
+  .type        = optional_argument,
+  .helpstring  = "firmware profile per function, callgrind output file (default callgrind.out.wsim)",
+  .value       = NULL
+};
+
+int machine_fwprof_options_add(void)
+{
+  options_add( &profile_opt );
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int machine_fwprof_create(void)
+{
+  const char *filename;
+
+  memset(&machine_fwprof, 0, sizeof(struct machine_fwprof_t));
+  fwprof_arcs     = NULL;
+  fwprof_arcs_max = 0;
+  fwprof_arcs_n   = 0;
+
+  if (profile_opt.isset == 0)
+    {
+      return 0;
+    }
+
+  filename = (profile_opt.value != NULL) ? profile_opt.value : FWPROF_DEFAULT_FILE;
+#if defined(WSIM_MULTINODE)
+  /* nodes of a process share the option */
+  if (machine_get_node_id() >= 0)
+    {
+      snprintf(fwprof_filename, MAX_FILENAME, "%s-%d", filename, machine_get_node_id());
+    }
+  else
+#endif
+    {
+      strncpyz(fwprof_filename, filename, MAX_FILENAME);
+    }
+
+  machine_fwprof.pc = (struct machine_fwprof_pc_t*)calloc(FWPROF_PC_MAX, sizeof(struct machine_fwprof_pc_t));
+  fwprof_arcs       = (struct fwprof_arc_t*)calloc(FWPROF_ARCS_MIN, sizeof(struct fwprof_arc_t));
+  if (machine_fwprof.pc == NULL || fwprof_arcs == NULL)
+    {
+      ERROR("wsim:profile: cannot allocate profile tables\n");
+      machine_fwprof_delete();
+      return 1;
+    }
+  fwprof_arcs_max = FWPROF_ARCS_MIN;
+  FWPROF_DBG("wsim:profile: output in %s\n", fwprof_filename);
+  return 0;
+}
+
+int machine_fwprof_suffix(const char *suffix)
+{
+  char filename[MAX_FILENAME];
+  int  n;
+
+  if (machine_fwprof.pc == NULL)
+    {
+      return 0;
+    }
+
+  /* a truncated name could be shared with another process */
+  strncpyz(filename, fwprof_filename, MAX_FILENAME);
+  n = snprintf(fwprof_filename, MAX_FILENAME, "%s-%s", filename, suffix);
+  if ((n < 0) || (n >= MAX_FILENAME))
+    {
+      ERROR("wsim:profile: output file name %s-%s is too long\n", filename, suffix);
+      strncpyz(fwprof_filename, filename, MAX_FILENAME);
+      return 1;
+    }
+  FWPROF_DBG("wsim:profile: output in %s\n", fwprof_filename);
+  return 0;
+}
+
+void machine_fwprof_delete(void)
+{
+  free(machine_fwprof.pc);
+  free(fwprof_arcs);
+  machine_fwprof.pc = NULL;
+  fwprof_arcs       = NULL;
+  fwprof_arcs_max   = 0;
+  fwprof_arcs_n     = 0;
+}
+
+void machine_fwprof_reset(uint16_t pc)
+{
+  machine_fwprof.entry = pc;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static struct fwprof_arc_t* machine_fwprof_arc_slot(struct fwprof_arc_t *arcs, uint32_t max, uint64_t key)
+{
+  uint32_t h = (uint32_t)((key * 2654435761u) >> 8) & (max - 1);
+  while (arcs[h].key != 0 && arcs[h].key != key)
+    {
+      h = (h + 1) & (max - 1);
+    }
+  return &arcs[h];
+}
+
+static struct fwprof_arc_t* machine_fwprof_arc(uint64_t key)
+{
+  struct fwprof_arc_t *arc;
+
+  if ((fwprof_arcs_n + 1) * 4 > fwprof_arcs_max * 3)
+    {
+      uint32_t i;
+      uint32_t max = fwprof_arcs_max * 2;
+      struct fwprof_arc_t *arcs = (struct fwprof_arc_t*)calloc(max, sizeof(struct fwprof_arc_t));
+      if (arcs != NULL)
+	{
+	  for(i=0; i < fwprof_arcs_max; i++)
+	    {
+	      if (fwprof_arcs[i].key != 0)
+		*machine_fwprof_arc_slot(arcs, max, fwprof_arcs[i].key) = fwprof_arcs[i];
+	    }
+	  free(fwprof_arcs);
+	  fwprof_arcs     = arcs;
+	  fwprof_arcs_max = max;
+	}
+      else if (fwprof_arcs_n + 1 == fwprof_arcs_max)
+	{
+	  return NULL;
+	}
+    }
+
+  arc = machine_fwprof_arc_slot(fwprof_arcs, fwprof_arcs_max, key);
+  if (arc->key == 0)
+    {
+      arc->key = key;
+      fwprof_arcs_n ++;
+    }
+  return arc;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void machine_fwprof_push(uint16_t site, uint16_t target, uint16_t sp, int irq)
+{
+  struct machine_fwprof_frame_t *f;
+
+  if (machine_fwprof.depth == FWPROF_DEPTH)
+    {
+      machine_fwprof.lost ++;
+      return;
+    }
+
+  f = &machine_fwprof.stack[machine_fwprof.depth++];
+  f->site       = site;
+  f->target     = target;
+  f->sp         = sp;
+  f->irq        = irq;
+  f->cycles     = machine_fwprof.cycles;
+  f->insn       = machine_fwprof.insn;
+  f->irq_cycles = machine_fwprof.irq_cycles;
+  f->irq_insn   = machine_fwprof.irq_insn;
+}
+
+static void machine_fwprof_pop(void)
+{
+  int i, outer = 1;
+  uint64_t cycles, insn;
+  struct fwprof_arc_t *arc;
+  struct machine_fwprof_frame_t *f = &machine_fwprof.stack[--machine_fwprof.depth];
+
+  /* nested interrupt handlers are not part of the inclusive cost */
+  cycles = (machine_fwprof.cycles - f->cycles) - (machine_fwprof.irq_cycles - f->irq_cycles);
+  insn   = (machine_fwprof.insn   - f->insn  ) - (machine_fwprof.irq_insn   - f->irq_insn  );
+  if (f->irq)
+    {
+      machine_fwprof.irq_cycles += cycles;
+      machine_fwprof.irq_insn   += insn;
+    }
+
+  /* the callee is already running below, up to the interrupt entry */
+  for(i=machine_fwprof.depth - 1; i >= 0 && f->irq == 0; i--)
+    {
+      if (machine_fwprof.stack[i].target == f->target)
+	{
+	  outer = 0;
+	  break;
+	}
+      if (machine_fwprof.stack[i].irq)
+	break;
+    }
+
+  arc = machine_fwprof_arc(FWPROF_ARC_KEY(f->irq, f->irq ? 0 : f->site, f->target));
+  if (arc == NULL)
+    return;
+  arc->count  += 1;
+  arc->cycles += cycles;
+  arc->insn   += insn;
+  if (outer)
+    {
+      arc->outer_cycles += cycles;
+      arc->outer_insn   += insn;
+    }
+}
+
+/* return addresses are above sp after a return */
+static void machine_fwprof_return(uint16_t sp)
+{
+  if (machine_fwprof.lost > 0)
+    {
+      machine_fwprof.lost --;
+      return;
+    }
+  while (machine_fwprof.depth > 0 && machine_fwprof.stack[machine_fwprof.depth - 1].sp < sp)
+    {
+      machine_fwprof_pop();
+    }
+}
+
+void machine_fwprof_event(void)
+{
+  switch (machine_fwprof.event)
+    {
+    case FWPROF_EVENT_CALL:
+      machine_fwprof_push(machine_fwprof.event_site, machine_fwprof.event_target,
+			  machine_fwprof.event_sp, 0);
+      break;
+    case FWPROF_EVENT_RET:
+      machine_fwprof_return(machine_fwprof.event_sp);
+      break;
+    }
+  machine_fwprof.event = FWPROF_EVENT_NONE;
+}
+
+void machine_fwprof_irq(uint16_t site, uint16_t target, uint16_t sp)
+{
+  machine_fwprof_push(site, target, sp, 1);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void machine_fwprof_state_save(void)
+{
+  if (machine_fwprof.pc == NULL)
+    return;
+
+  fwprof_backup_depth = machine_fwprof.depth;
+  fwprof_backup_lost  = machine_fwprof.lost;
+  memcpy(fwprof_backup_stack, machine_fwprof.stack,
+	 machine_fwprof.depth * sizeof(struct machine_fwprof_frame_t));
+}
+
+void machine_fwprof_state_restore(void)
+{
+  if (machine_fwprof.pc == NULL)
+    return;
+
+  machine_fwprof.depth = fwprof_backup_depth;
+  machine_fwprof.lost  = fwprof_backup_lost;
+  machine_fwprof.event = FWPROF_EVENT_NONE;
+  memcpy(machine_fwprof.stack, fwprof_backup_stack,
+	 machine_fwprof.depth * sizeof(struct machine_fwprof_frame_t));
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+struct fwprof_fn_table_t {
+  struct fwprof_fn_t *fn;
+  int                 n;
+  int                 max;
+};
+
+static struct fwprof_fn_t* machine_fwprof_fn_add(struct fwprof_fn_table_t *t, uint32_t addr,
+						 uint32_t size, const char *name)
+{
+  struct fwprof_fn_t *fn;
+
+  if (t->n == t->max)
+    {
+      int max = t->max ? t->max * 2 : 64;
+      struct fwprof_fn_t *tab = (struct fwprof_fn_t*)realloc(t->fn, max * sizeof(struct fwprof_fn_t));
+      if (tab == NULL)
+	return NULL;
+      t->fn  = tab;
+      t->max = max;
+    }
+
+  fn = &t->fn[t->n++];
+  memset(fn, 0, sizeof(struct fwprof_fn_t));
+  fn->addr = addr;
+  fn->size = size;
+  fn->name = name;
+  snprintf(fn->addr_name, FWPROF_NAME_LENGTH, "0x%04x", addr);
+  return fn;
+}
+
+static const char* machine_fwprof_fn_name(struct fwprof_fn_t *fn)
+{
+  return (fn->name != NULL) ? fn->name : fn->addr_name;
+}
+
+static void machine_fwprof_fn_symbol(void *data, const char *name, uint32_t addr, uint32_t size, int func)
+{
+  if (func && addr < FWPROF_PC_MAX)
+    {
+      machine_fwprof_fn_add((struct fwprof_fn_table_t*)data, addr, size, name);
+    }
+}
+
+/* address order, symbols before address names, first symbol wins */
+static int machine_fwprof_fn_cmp(const void *a, const void *b)
+{
+  const struct fwprof_fn_t *fa = (const struct fwprof_fn_t*)a;
+  const struct fwprof_fn_t *fb = (const struct fwprof_fn_t*)b;
+  if (fa->addr != fb->addr)
+    return (fa->addr < fb->addr) ? -1 : 1;
+  if ((fa->name == NULL) != (fb->name == NULL))
+    return (fa->name == NULL) ? 1 : -1;
+  return (fa < fb) ? -1 : 1;
+}
+
+static void machine_fwprof_fn_sort(struct fwprof_fn_table_t *t)
+{
+  int i, n = 0;
+
+  qsort(t->fn, t->n, sizeof(struct fwprof_fn_t), machine_fwprof_fn_cmp);
+  for(i=0; i < t->n; i++)
+    {
+      if (n == 0 || t->fn[i].addr != t->fn[n - 1].addr)
+	{
+	  t->fn[n++] = t->fn[i];
+	}
+    }
+  t->n = n;
+}
+
+/* function that contains pc, -1 if none */
+static int machine_fwprof_fn_find(struct fwprof_fn_table_t *t, int n, uint32_t pc)
+{
+  int lo = 0, hi = n - 1, f = -1;
+
+  while (lo <= hi)
+    {
+      int mid = (lo + hi) / 2;
+      if (t->fn[mid].addr <= pc)
+	{
+	  f  = mid;
+	  lo = mid + 1;
+	}
+      else
+	{
+	  hi = mid - 1;
+	}
+    }
+  if (f != -1 && t->fn[f].size != 0 && pc >= t->fn[f].addr + t->fn[f].size)
+    return -1;
+  return f;
+}
+
+static void machine_fwprof_fn_build(struct fwprof_fn_table_t *t, struct elf32_struct_t *elf)
+{
+  uint32_t i, pc;
+  int nsym, added;
+
+  /* elf function symbols */
+  if (elf != NULL)
+    {
+      libelf_symtab_foreach(elf, machine_fwprof_fn_symbol, t);
+    }
+  machine_fwprof_fn_sort(t);
+  nsym = t->n;
+
+  /* entry point, call targets and interrupt handlers outside symbols */
+  if (machine_fwprof_fn_find(t, nsym, machine_fwprof.entry) == -1)
+    {
+      machine_fwprof_fn_add(t, machine_fwprof.entry, 0, NULL);
+    }
+  for(i=0; i < fwprof_arcs_max; i++)
+    {
+      uint32_t target = FWPROF_ARC_TARGET(fwprof_arcs[i].key);
+      if (fwprof_arcs[i].key != 0 && machine_fwprof_fn_find(t, nsym, target) == -1)
+	{
+	  machine_fwprof_fn_add(t, target, 0, NULL);
+	}
+    }
+  machine_fwprof_fn_sort(t);
+
+  /* executed code outside functions starts a function */
+  added = 0;
+  nsym  = t->n;
+  for(pc=0; pc < FWPROF_PC_MAX; pc++)
+    {
+      if (machine_fwprof_fn_find(t, nsym, pc) != -1)
+	{
+	  added = 0;
+	}
+      else if (machine_fwprof.pc[pc].insn && added == 0)
+	{
+	  machine_fwprof_fn_add(t, pc, 0, NULL);
+	  added = 1;
+	}
+    }
+  machine_fwprof_fn_sort(t);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/* exclusive cost of functions, fn_of_pc must be FWPROF_PC_MAX long */
+static void machine_fwprof_fn_cost(struct fwprof_fn_table_t *t, int *fn_of_pc)
+{
+  uint32_t pc, i;
+
+  for(pc=0; pc < FWPROF_PC_MAX; pc++)
+    {
+      int f = machine_fwprof_fn_find(t, t->n, pc);
+      fn_of_pc[pc] = f;
+      if (f != -1)
+	{
+	  t->fn[f].self_cycles += machine_fwprof.pc[pc].cycles;
+	  t->fn[f].self_insn   += machine_fwprof.pc[pc].insn;
+	}
+    }
+
+  for(i=0; i < (uint32_t)t->n; i++)
+    {
+      t->fn[i].incl_cycles = t->fn[i].self_cycles;
+      t->fn[i].incl_insn   = t->fn[i].self_insn;
+    }
+
+  /* a recursive call is already part of the caller */
+  for(i=0; i < fwprof_arcs_max; i++)
+    {
+      struct fwprof_arc_t *arc = &fwprof_arcs[i];
+      int callee, caller;
+      if (arc->key == 0)
+	continue;
+      callee = fn_of_pc[FWPROF_ARC_TARGET(arc->key)];
+      if (callee == -1)
+	continue;
+      t->fn[callee].calls += arc->count;
+      if (FWPROF_ARC_IRQ(arc->key))
+	continue;
+      caller = fn_of_pc[FWPROF_ARC_SITE(arc->key)];
+      if (caller != -1 && caller != callee)
+	{
+	  t->fn[caller].incl_cycles += arc->outer_cycles;
+	  t->fn[caller].incl_insn   += arc->outer_insn;
+	}
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void machine_fwprof_callgrind(struct fwprof_fn_table_t *t, int *fn_of_pc)
+{
+  FILE *out;
+  uint32_t pc, i;
+  int f;
+
+  if ((out = fopen(fwprof_filename, "w")) == NULL)
+    {
+      ERROR("wsim:profile: cannot open %s\n", fwprof_filename);
+      return;
+    }
+
+  fprintf(out, "# callgrind format\n");
+  fprintf(out, "version: 1\n");
+  fprintf(out, "creator: wsim\n");
+  fprintf(out, "positions: instr\n");
+  fprintf(out, "events: Cycles Instructions\n");
+  fprintf(out, "summary: %"PRIu64" %"PRIu64"\n\n", machine_fwprof.cycles, machine_fwprof.insn);
+  fprintf(out, "fl=???\n");
+
+  for(f=0; f < t->n; f++)
+    {
+      struct fwprof_fn_t *fn = &t->fn[f];
+      if (fn->self_insn == 0 && fn->incl_insn == 0)
+	continue;
+
+      fprintf(out, "fn=%s\n", machine_fwprof_fn_name(fn));
+      for(pc = fn->addr; pc < FWPROF_PC_MAX && fn_of_pc[pc] == f; pc++)
+	{
+	  if (machine_fwprof.pc[pc].insn)
+	    {
+	      fprintf(out, "0x%04x %"PRIu64" %"PRIu64"\n", pc,
+		      machine_fwprof.pc[pc].cycles, machine_fwprof.pc[pc].insn);
+	    }
+	}
+
+      for(i=0; i < fwprof_arcs_max; i++)
+	{
+	  struct fwprof_arc_t *arc = &fwprof_arcs[i];
+	  int callee;
+	  if (arc->key == 0 || FWPROF_ARC_IRQ(arc->key) || fn_of_pc[FWPROF_ARC_SITE(arc->key)] != f)
+	    continue;
+	  callee = fn_of_pc[FWPROF_ARC_TARGET(arc->key)];
+	  fprintf(out, "cfn=%s\n", callee != -1 ? machine_fwprof_fn_name(&t->fn[callee]) : "???");
+	  fprintf(out, "calls=%"PRIu64" 0x%04x\n", arc->count, FWPROF_ARC_TARGET(arc->key));
+	  fprintf(out, "0x%04x %"PRIu64" %"PRIu64"\n", FWPROF_ARC_SITE(arc->key), arc->cycles, arc->insn);
+	}
+      fprintf(out, "\n");
+    }
+  fclose(out);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static int machine_fwprof_self_cmp(const void *a, const void *b)
+{
+  const struct fwprof_fn_t *fa = *(const struct fwprof_fn_t* const*)a;
+  const struct fwprof_fn_t *fb = *(const struct fwprof_fn_t* const*)b;
+  if (fa->self_cycles != fb->self_cycles)
+    return (fa->self_cycles > fb->self_cycles) ? -1 : 1;
+  if (fa->incl_cycles != fb->incl_cycles)
+    return (fa->incl_cycles > fb->incl_cycles) ? -1 : 1;
+  return (fa->addr < fb->addr) ? -1 : 1;
+}
+
+void machine_fwprof_dump_stats(struct elf32_struct_t *elf)
+{
+  struct fwprof_fn_table_t   t = { NULL, 0, 0 };
+  struct fwprof_fn_t       **order;
+  int                       *fn_of_pc;
+  double                     total;
+  int                        f, n;
+
+  if (machine_fwprof.pc == NULL)
+    return;
+
+  /* functions still running at exit */
+  machine_fwprof.event = FWPROF_EVENT_NONE;
+  machine_fwprof.lost  = 0;
+  while (machine_fwprof.depth > 0)
+    {
+      machine_fwprof_pop();
+    }
+
+  OUTPUT_STATS("  profile cycles                : %"PRIu64"\n", machine_fwprof.cycles);
+  OUTPUT_STATS("  profile instructions          : %"PRIu64"\n", machine_fwprof.insn);
+  OUTPUT_STATS("  profile callgrind file        : %s\n", fwprof_filename);
+
+  if ((fn_of_pc = (int*)malloc(FWPROF_PC_MAX * sizeof(int))) == NULL)
+    {
+      ERROR("wsim:profile: cannot allocate function table\n");
+      return;
+    }
+  machine_fwprof_fn_build(&t, elf);
+  machine_fwprof_fn_cost(&t, fn_of_pc);
+  machine_fwprof_callgrind(&t, fn_of_pc);
+
+  if ((order = (struct fwprof_fn_t**)malloc((t.n + 1) * sizeof(struct fwprof_fn_t*))) != NULL)
+    {
+      for(f=0, n=0; f < t.n; f++)
+	{
+	  if (t.fn[f].self_insn || t.fn[f].incl_insn)
+	    order[n++] = &t.fn[f];
+	}
+      qsort(order, n, sizeof(struct fwprof_fn_t*), machine_fwprof_self_cmp);
+
+      total = machine_fwprof.cycles ? (double)machine_fwprof.cycles : 1.0;
+      OUTPUT_STATS("  %-29s : %12s %6s %12s %6s %8s\n", "function", "self cycles", "", "incl cycles", "", "calls");
+      for(f=0; f < n; f++)
+	{
+	  OUTPUT_STATS("  fn %-26s : %12"PRIu64" %5.1f%% %12"PRIu64" %5.1f%% %8"PRIu64"\n",
+		       machine_fwprof_fn_name(order[f]),
+		       order[f]->self_cycles, 100.0 * (double)order[f]->self_cycles / total,
+		       order[f]->incl_cycles, 100.0 * (double)order[f]->incl_cycles / total,
+		       order[f]->calls);
+	}
+      free(order);
+    }
+
+  free(fn_of_pc);
+  free(t.fn);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
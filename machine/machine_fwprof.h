@@ -0,0 +1,149 @@
+/**
+ *  \file   machine_fwprof.h
+ *  \brief  Firmware profiler, per pc cycle histogram and call graph
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef MACHINE_FWPROF_H
+#define MACHINE_FWPROF_H
+
+/**
+ * The firmware profiler counts the cycles and instructions executed at
+ * each pc of the simulated mcu in a flat table, the mcu calls
+ * machine_fwprof_insn() after each instruction.
+ *
+ * Calls and interrupt entries push a frame on a shadow call stack,
+ * frames are popped by returns when the stack pointer goes above the
+ * return address slot. Popped frames give the inclusive cost of the
+ * caller -> callee arcs. Interrupt handlers are roots of the call graph,
+ * their cost is not charged to the interrupted function.
+ *
+ * At exit, pcs are attributed to the ELF function symbols (or to call
+ * targets when the firmware has no symbols), exclusive and inclusive
+ * costs are printed with the machine statistics and the profile is
+ * written in the callgrind format.
+ *
+ * Instructions replayed after a backtrack are counted each time they
+ * are executed, only the shadow call stack is saved and restored.
+ **/
+
+#define FWPROF_PC_MAX   0x10000
+#define FWPROF_DEPTH    128
+
+struct machine_fwprof_pc_t {
+  uint64_t   cycles;
+  uint64_t   insn;
+};
+
+struct machine_fwprof_frame_t {
+  uint16_t   site;        /* call insn, interrupted pc for irqs    */
+  uint16_t   target;      /* callee entry                          */
+  uint16_t   sp;          /* return address slot                   */
+  uint16_t   irq;
+  uint64_t   cycles;      /* counters at entry                     */
+  uint64_t   insn;
+  uint64_t   irq_cycles;
+  uint64_t   irq_insn;
+};
+
+#define FWPROF_EVENT_NONE 0
+#define FWPROF_EVENT_CALL 1
+#define FWPROF_EVENT_RET  2
+
+struct machine_fwprof_t {
+  struct machine_fwprof_pc_t  *pc;     /* NULL when disabled */
+  uint64_t    cycles;
+  uint64_t    insn;
+  uint64_t    irq_cycles;              /* inclusive cost of interrupt handlers */
+  uint64_t    irq_insn;
+
+  /* call or return of the current instruction, done after its cost */
+  int         event;
+  uint16_t    event_site;
+  uint16_t    event_target;
+  uint16_t    event_sp;
+
+  uint16_t    entry;                   /* reset pc */
+
+  int         depth;
+  int         lost;                    /* frames above FWPROF_DEPTH */
+  struct machine_fwprof_frame_t  stack[FWPROF_DEPTH];
+};
+
+extern WSIM_TLS struct machine_fwprof_t machine_fwprof;
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void machine_fwprof_event(void);
+void machine_fwprof_irq  (uint16_t site, uint16_t target, uint16_t sp);
+
+static inline void machine_fwprof_insn(uint16_t pc, uint32_t cycles)
+{
+  machine_fwprof.pc[pc].cycles += cycles;
+  machine_fwprof.pc[pc].insn   += 1;
+  machine_fwprof.cycles        += cycles;
+  machine_fwprof.insn          += 1;
+  if (machine_fwprof.event != FWPROF_EVENT_NONE)
+    machine_fwprof_event();
+}
+
+#define MACHINE_FWPROF_INSN(addr,n)			\
+  do {							\
+    if (machine_fwprof.pc != NULL)			\
+      machine_fwprof_insn(addr,n);			\
+  } while (0)
+
+/* sp is the return address slot */
+#define MACHINE_FWPROF_CALL(site,target,sp)		\
+  do {							\
+    if (machine_fwprof.pc != NULL)			\
+      {							\
+	machine_fwprof.event        = FWPROF_EVENT_CALL; \
+	machine_fwprof.event_site   = site;		\
+	machine_fwprof.event_target = target;		\
+	machine_fwprof.event_sp     = sp;		\
+      }							\
+  } while (0)
+
+/* sp is the stack pointer after the return */
+#define MACHINE_FWPROF_RET(sp)				\
+  do {							\
+    if (machine_fwprof.pc != NULL)			\
+      {							\
+	machine_fwprof.event        = FWPROF_EVENT_RET;	\
+	machine_fwprof.event_sp     = sp;		\
+      }							\
+  } while (0)
+
+/* sp is the lowest slot pushed by the interrupt entry */
+#define MACHINE_FWPROF_IRQ(site,target,sp)		\
+  do {							\
+    if (machine_fwprof.pc != NULL)			\
+      machine_fwprof_irq(site,target,sp);		\
+  } while (0)
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int  machine_fwprof_options_add   (void);
+int  machine_fwprof_create        (void);
+void machine_fwprof_delete        (void);
+
+/* processes forked from a created machine write their own profile, 1 on error */
+int  machine_fwprof_suffix        (const char *suffix);
+
+/* firmware entry point, used when it is not an elf function symbol */
+void machine_fwprof_reset         (uint16_t pc);
+
+void machine_fwprof_state_save    (void);
+void machine_fwprof_state_restore (void);
+
+/* elf may be NULL, functions are then named by address */
+struct elf32_struct_t;
+void machine_fwprof_dump_stats    (struct elf32_struct_t *elf);
+
+#endif
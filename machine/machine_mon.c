@@ -20,8 +20,8 @@
 #include "machine.h"
 #include "machine_mon.h"
 
-static struct watchpoint_t watchpoint[MONITOR_MAX_WATCHPOINT];
-static int watchpoint_max;
+static WSIM_TLS struct watchpoint_t watchpoint[MONITOR_MAX_WATCHPOINT];
+static WSIM_TLS int watchpoint_max;
 
 /* ************************************************** */
 /* ************************************************** */
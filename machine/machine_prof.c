@@ -0,0 +1,361 @@
+/**
+ *  \file   machine_prof.c
+ *  \brief  Host time profiler for simulator stages
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "arch/common/hardware.h"
+#include "devices/devices.h"
+#include "src/options.h"
+
+#include "machine.h"
+#include "machine_prof.h"
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+WSIM_TLS struct machine_prof_t machine_prof;
+
+static const char *machine_prof_names[MPROF_DEVICE] = {
+  "machine loop",
+  "mcu",
+  "mcu alu",
+  "mcu peripherals",
+  "devices",
+  "libselect",
+  "libwsnet",
+  "tracer",
+  "state save",
+  "state restore",
+  "checkpoint"
+};
+
+/* tick to ns conversion, measured from create */
+static WSIM_TLS uint64_t      prof_ticks0;
+static WSIM_TLS uint64_t      prof_ns0;
+
+/* tracer output */
+static WSIM_TLS int           prof_trace = 0;
+static WSIM_TLS tracer_id_t   prof_trc   [MPROF_MAX];
+static WSIM_TLS uint64_t      prof_last  [MPROF_MAX];
+static WSIM_TLS wsimtime_t    prof_last_time;
+
+/* tracer record function while the tracer is profiled */
+static WSIM_TLS void        (*prof_tracer_record)(tracer_id_t id, tracer_val_t val) = NULL;
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static struct moption_t hostprof_opt = {
+  .longname    = "hostprof",
+  .type        = optional_argument,
+  .helpstring  = "host time profile of simulator stages and devices\n"
+                 "\t\t\t\t--hostprof[=trace]\n"
+                 "\t\t\t\t\ttrace : record host us per simulated s in the event tracer\n",
+  .value       = NULL
+};
+
+int machine_prof_options_add(void)
+{
+  options_add( &hostprof_opt );
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static uint64_t machine_prof_nanotime(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000 * 1000 * 1000 + t.tv_nsec;
+}
+
+/* cpu time stamp counter, the monotonic clock on other hosts */
+#if defined(__x86_64__) || defined(__i386__)
+#define MACHINE_PROF_TICKS() __rdtsc()
+#else
+#define MACHINE_PROF_TICKS() machine_prof_nanotime()
+#endif
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void machine_prof_enter(void)
+{
+  int d = machine_prof.depth++;
+  if (d < MPROF_DEPTH)
+    {
+      machine_prof.child[d] = 0;
+      machine_prof.start[d] = MACHINE_PROF_TICKS();
+    }
+}
+
+void machine_prof_leave(int stage)
+{
+  int d = --machine_prof.depth;
+  if (d < MPROF_DEPTH)
+    {
+      uint64_t t = MACHINE_PROF_TICKS() - machine_prof.start[d];
+      /* modulo 2^64, a stage shorter than the calibration is negative */
+      machine_prof.ticks[stage] += t - machine_prof.child[d] - machine_prof.inner;
+      machine_prof.calls[stage] += 1;
+      if (d > 0)
+	{
+	  machine_prof.child[d - 1] += t + machine_prof.outer;
+	}
+    }
+}
+
+static double machine_prof_ns_per_tick(void)
+{
+  uint64_t ticks = MACHINE_PROF_TICKS() - prof_ticks0;
+  uint64_t ns    = machine_prof_nanotime() - prof_ns0;
+  if (ticks == 0)
+    return 1.0;
+  return (double)ns / (double)ticks;
+}
+
+/* self time of a stage, short stages may be below the calibration */
+static uint64_t machine_prof_ticks(int stage)
+{
+  int64_t ticks = (int64_t)machine_prof.ticks[stage];
+  return (ticks > 0) ? (uint64_t)ticks : 0;
+}
+
+static const char* machine_prof_name(int stage)
+{
+  if (stage < MPROF_DEVICE)
+    return machine_prof_names[stage];
+  if (machine.device[stage - MPROF_DEVICE].name == NULL)
+    return "unnamed device";
+  return machine.device[stage - MPROF_DEVICE].name;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#define MPROF_CALIBRATE_LOOPS  1000
+#define MPROF_CALIBRATE_ROUNDS 10
+
+/* lowest cost of empty stages nested in a stage */
+static void machine_prof_calibrate(void)
+{
+  int round, i;
+  uint64_t inner = (uint64_t)-1;
+  uint64_t outer = (uint64_t)-1;
+
+  for(round = 0; round < MPROF_CALIBRATE_ROUNDS; round++)
+    {
+      machine_prof.ticks[MPROF_LOOP]   = 0;
+      machine_prof.ticks[MPROF_TRACER] = 0;
+      machine_prof_enter();
+      for(i = 0; i < MPROF_CALIBRATE_LOOPS; i++)
+	{
+	  machine_prof_enter();
+	  machine_prof_leave(MPROF_TRACER);
+	}
+      machine_prof_leave(MPROF_LOOP);
+      if (machine_prof.ticks[MPROF_TRACER] / MPROF_CALIBRATE_LOOPS < inner)
+	inner = machine_prof.ticks[MPROF_TRACER] / MPROF_CALIBRATE_LOOPS;
+      if (machine_prof.ticks[MPROF_LOOP] / MPROF_CALIBRATE_LOOPS < outer)
+	outer = machine_prof.ticks[MPROF_LOOP] / MPROF_CALIBRATE_LOOPS;
+    }
+
+  memset(machine_prof.ticks, 0, sizeof(machine_prof.ticks));
+  memset(machine_prof.calls, 0, sizeof(machine_prof.calls));
+  machine_prof.inner = inner;
+  machine_prof.outer = outer;
+  HW_DMSG_MISC("wsim:hostprof: stage cost %"PRIu64" + %"PRIu64" ticks\n", inner, outer);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int machine_prof_create(void)
+{
+  int stage;
+
+  memset(&machine_prof, 0, sizeof(struct machine_prof_t));
+  machine_prof.next = WSIM_HORIZON_INF;
+
+  if (hostprof_opt.isset == 0)
+    {
+      return 0;
+    }
+
+  if (hostprof_opt.value != NULL)
+    {
+      if (strcmp(hostprof_opt.value, "trace") != 0)
+	{
+	  ERROR("wsim:hostprof: unknown argument %s\n", hostprof_opt.value);
+	  return 1;
+	}
+      prof_trace = 1;
+      for(stage = 0; stage < MPROF_DEVICE + machine.device_max; stage++)
+	{
+	  char name[TRACER_MAX_NAME_LENGTH];
+	  char *c;
+	  strncpyz(name, machine_prof_name(stage), TRACER_MAX_NAME_LENGTH);
+	  for(c = name; *c; c++)
+	    {
+	      if (*c == ' ')
+		*c = '_';
+	    }
+	  prof_trc [stage] = tracer_event_add_id(32, name, "hostprof");
+	  prof_last[stage] = 0;
+	}
+      prof_last_time    = 0;
+      machine_prof.next = MPROF_TRACE_PERIOD;
+    }
+
+  machine_prof.enabled = 1;
+  machine_prof_calibrate();
+  prof_ticks0 = MACHINE_PROF_TICKS();
+  prof_ns0    = machine_prof_nanotime();
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void machine_prof_tracer_event_record(tracer_id_t id, tracer_val_t val)
+{
+  machine_prof_enter();
+  prof_tracer_record(id, val);
+  machine_prof_leave(MPROF_TRACER);
+}
+
+void machine_prof_run_start(void)
+{
+  if (machine_prof.enabled == 0)
+    return;
+
+  if ((tracer_event_record_ptr != NULL) && (tracer_event_record_ptr != machine_prof_tracer_event_record))
+    {
+      prof_tracer_record      = tracer_event_record_ptr;
+      tracer_event_record_ptr = machine_prof_tracer_event_record;
+    }
+  machine_prof_enter();
+}
+
+void machine_prof_run_stop(void)
+{
+  if (machine_prof.enabled == 0)
+    return;
+
+  machine_prof_leave(MPROF_LOOP);
+  /* the tracer may have been stopped or started by the simulation */
+  if (tracer_event_record_ptr == machine_prof_tracer_event_record)
+    {
+      tracer_event_record_ptr = prof_tracer_record;
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void machine_prof_record(void)
+{
+  int        stage;
+  double     ns_per_tick;
+  wsimtime_t now   = MACHINE_TIME_GET_NANO();
+  wsimtime_t delta = now - prof_last_time;
+
+  if (prof_trace == 0)
+    return;
+
+  /* a restore can go back to the last record, nothing to divide by */
+  if (delta == 0)
+    {
+      machine_prof.next = now - (now % MPROF_TRACE_PERIOD) + MPROF_TRACE_PERIOD;
+      return;
+    }
+
+  ns_per_tick = machine_prof_ns_per_tick();
+  for(stage = 0; stage < MPROF_DEVICE + machine.device_max; stage++)
+    {
+      /* host us per simulated s = host ns per simulated ms */
+      int64_t ticks = (int64_t)(machine_prof.ticks[stage] - prof_last[stage]);
+      double  ns    = (ticks > 0) ? (double)ticks * ns_per_tick : 0;
+      tracer_event_record(prof_trc[stage], (tracer_val_t)(ns * 1000.0 * 1000.0 / (double)delta));
+      prof_last[stage] = machine_prof.ticks[stage];
+    }
+  prof_last_time    = now;
+  machine_prof.next = now - (now % MPROF_TRACE_PERIOD) + MPROF_TRACE_PERIOD;
+}
+
+void machine_prof_state_restore(void)
+{
+  wsimtime_t now;
+
+  if (prof_trace == 0)
+    return;
+
+  /* records after the saved state are dropped by the tracer */
+  now = MACHINE_TIME_GET_NANO();
+  machine_prof.next = now - (now % MPROF_TRACE_PERIOD) + MPROF_TRACE_PERIOD;
+  if (prof_last_time > now)
+    {
+      prof_last_time = now - (now % MPROF_TRACE_PERIOD);
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+void machine_prof_dump_stats(void)
+{
+  int        stage;
+  uint64_t   total = 0;
+  double     ns_per_tick;
+  wsimtime_t simtime = MACHINE_TIME_GET_NANO();
+
+  if (machine_prof.enabled == 0)
+    return;
+
+  ns_per_tick = machine_prof_ns_per_tick();
+  for(stage = 0; stage < MPROF_MAX; stage++)
+    {
+      total += machine_prof_ticks(stage);
+    }
+
+  OUTPUT_STATS("  host time in simulation       : %"PRIu64" ms\n",
+	       (uint64_t)((double)total * ns_per_tick) / (1000*1000));
+  if (total == 0 || simtime == 0)
+    return;
+
+  for(stage = 0; stage < MPROF_DEVICE + machine.device_max; stage++)
+    {
+      double ns;
+      if (machine_prof.calls[stage] == 0)
+	continue;
+      ns = (double)machine_prof_ticks(stage) * ns_per_tick;
+      OUTPUT_STATS("  prof %-24s : %12.0f ns/s %5.1f%% (%"PRIu64" calls)\n",
+		   machine_prof_name(stage), ns * 1e9 / (double)simtime,
+		   100.0 * (double)machine_prof_ticks(stage) / (double)total,
+		   machine_prof.calls[stage]);
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
@@ -0,0 +1,119 @@
+/**
+ *  \file   machine_prof.h
+ *  \brief  Host time profiler for simulator stages
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef MACHINE_PROF_H
+#define MACHINE_PROF_H
+
+/**
+ * The profiler measures the host time spent in each stage of the
+ * simulation loop and in each device (read, update and ui draw).
+ * Stages are nested and a stage is only charged with its own time, the
+ * libwsnet stage does not include the state saves done at rendez-vous
+ * and the mcu stage does not include the alu.
+ *
+ * Host time is read from the cpu time stamp counter when available, it
+ * is converted to ns against the monotonic clock over the whole run.
+ * The cost of the measure itself is calibrated at start and removed
+ * from the stage and from its parent.
+ *
+ * The profiler is enabled with --hostprof. Otherwise MACHINE_PROF()
+ * costs a single test per stage, the MACHINE_PROF_ENTER/LEAVE pairs used
+ * around state saves and restores cost two. With --hostprof=trace the host us spent per simulated
+ * second in each stage are recorded in the event tracer every
+ * MPROF_TRACE_PERIOD.
+ **/
+
+#define MPROF_TRACE_PERIOD (10*1000*1000) /* ns, 10 ms */
+#define MPROF_DEPTH        16
+
+enum machine_prof_stage_t {
+  MPROF_LOOP = 0,        /* machine loop, limits and monitors   */
+  MPROF_MCU,             /* mcu_run() outside alu & peripherals */
+  MPROF_MCU_ALU,
+  MPROF_MCU_PERIPH,
+  MPROF_DEVICES,         /* devices_update() and wiring         */
+  MPROF_LIBSELECT,
+  MPROF_LIBWSNET,
+  MPROF_TRACER,
+  MPROF_STATE_SAVE,
+  MPROF_STATE_RESTORE,
+  MPROF_CHECKPOINT,
+  MPROF_DEVICE,          /* device d update is MPROF_DEVICE + d */
+  MPROF_MAX = MPROF_DEVICE + DEVICE_MAX
+};
+
+struct machine_prof_t {
+  int         enabled;
+  int         depth;
+  uint64_t    start [MPROF_DEPTH];
+  uint64_t    child [MPROF_DEPTH]; /* time of nested stages */
+  uint64_t    ticks [MPROF_MAX];   /* self time             */
+  uint64_t    calls [MPROF_MAX];
+  uint64_t    inner;               /* ticks measured by an empty stage      */
+  uint64_t    outer;               /* ticks added to the parent by a stage  */
+  wsimtime_t  next;                /* next tracer record    */
+};
+
+extern WSIM_TLS struct machine_prof_t machine_prof;
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/* stage boundaries, host ticks are read in machine_prof.c */
+void machine_prof_enter (void);
+void machine_prof_leave (int stage);
+
+#define MACHINE_PROF_ENTER()			\
+  do {						\
+    if (machine_prof.enabled)			\
+      machine_prof_enter();			\
+  } while (0)
+
+#define MACHINE_PROF_LEAVE(stage)		\
+  do {						\
+    if (machine_prof.enabled)			\
+      machine_prof_leave(stage);		\
+  } while (0)
+
+/* run a statement as a profiled stage */
+#define MACHINE_PROF(stage, statement)		\
+  do {						\
+    if (machine_prof.enabled)			\
+      {						\
+	machine_prof_enter();			\
+	statement;				\
+	machine_prof_leave(stage);		\
+      }						\
+    else					\
+      {						\
+	statement;				\
+      }						\
+  } while (0)
+
+#define MACHINE_PROF_TICK()					\
+  do {								\
+    if (MACHINE_TIME_GET_NANO() >= machine_prof.next)		\
+      machine_prof_record();					\
+  } while (0)
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int  machine_prof_options_add (void);
+int  machine_prof_create      (void);
+
+/* machine_run() boundaries, the tracer is profiled during runs */
+void machine_prof_run_start   (void);
+void machine_prof_run_stop    (void);
+
+void machine_prof_record      (void);
+void machine_prof_state_restore (void);
+void machine_prof_dump_stats  (void);
+
+#endif
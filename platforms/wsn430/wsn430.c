@@ -179,6 +179,260 @@ int system_create(int dev_num)
 /* ************************************************** */
 /* ************************************************** */
 
+/* *************************************************************************** */
+/* MCU -> devices                                                              */
+/* *************************************************************************** */
+
+/* port 1 :                          */
+/* ========                          */
+/*   P1.7 NC                         */
+/*   P1.6 NC                         */
+/*   P1.5 NC                         */
+/*   P1.4 cc1100 gd2                 */
+/*   P1.3 cc1100 gd0                 */
+/*   P1.2 P_Dvcc -> flash write      */
+/*   P1.1 NC                         */
+/*   P1.0 NC                         */
+static int wsn430_port1(int UNUSED net, uint32_t UNUSED mask, uint32_t value)
+{
+  devnet_write(FLASH, M25P_W, BIT(value,2) << M25P_W_SHIFT);
+  etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
+  return 0;
+}
+
+/* port 2 :                          */
+/* ========                          */
+/*   P2.7 NC                         */
+/*   P2.6 NC                         */
+/*   P2.5 NC                         */
+/*   P2.4 1wire                      */
+/*   P2.3 NC                         */
+/*   P2.3 NC                         */
+/*   P2.1 7seg selector 1            */
+/*   P2.0 7seg selector 0            */
+static int wsn430_port2(int UNUSED net, uint32_t UNUSED mask, uint32_t value)
+{
+  devnet_write(DS24, DS2411_D, BIT(value,4));
+  etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
+  return 0;
+}
+
+/* port 3 :                          */
+/* ========                          */
+/*   P3.7 urxd1 : serial             */
+/*   P3.6 utxd1 : serial             */
+/*   P3.5 urxd0                      */
+/*   P3.4 utxd0                      */ 
+/*   P3.3 SPI cc1100 UCLK            */
+/*   P3.2 SPI cc1100 SOMI            */
+/*   P3.1 SPI cc1100 SIMO            */
+/*   P3.0 NC                         */
+/* cc1100 is driven by spi, port 3 is not wired */
+
+/* port 4 :                          */
+/* ========                          */
+/*   P4.7 flash hold                 */
+/*   P4.6 NC                         */
+/*   P4.5 NC                         */
+/*   P4.4 CS flash                   */
+/*   P4.3 NC                         */
+/*   P4.2 CS cc1100                  */
+/*   P4.1 batt status                */
+/*   P4.0 NC                         */
+static int wsn430_port4(int UNUSED net, uint32_t UNUSED mask, uint32_t value)
+{
+  int CC1100_CSn;
+
+  devnet_write(FLASH, 
+	       M25P_H | M25P_S, 
+	       (BIT(value,7) << M25P_H_SHIFT) | 
+	       (BIT(value,4) << M25P_S_SHIFT));
+  /* waiting for flash update */
+  etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
+
+  CC1100_CSn = BIT(value,2);
+  devnet_write(RADIO, CC1100_CSn_MASK, CC1100_CSn << CC1100_CSn_SHIFT);
+  etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
+  return 0;
+}
+
+/* port 5 :                          */
+/* ========                          */
+/*   P5.7 NC                         */
+/*   P5.6 led 3 (Blue)               */
+/*   P5.5 led 2 (Green)              */
+/*   P5.4 led 1 (Red)                */
+/*   P5.3 SPI flash ram UCLK         */
+/*   P5.2 SPI flash ram SOMI         */
+/*   P5.1 SPI flash ram SIMO         */
+/*   P5.0 NC                         */
+static int wsn430_port5(int UNUSED net, uint32_t UNUSED mask, uint32_t value)
+{
+  int refresh = 0;
+
+  machine.device[LED1].write(LED1,LED_DATA, ! BIT(value,4));
+  etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
+  UPDATE(LED1);
+  REFRESH(LED1);
+
+  machine.device[LED2].write(LED2,LED_DATA, ! BIT(value,5));
+  etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
+  UPDATE(LED2);
+  REFRESH(LED2);
+
+  machine.device[LED3].write(LED3,LED_DATA, ! BIT(value,6));
+  etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
+  UPDATE(LED3);
+  REFRESH(LED3);
+  return refresh;
+}
+
+/* port 6 : NC                       */
+
+/* Usart SPI mode                    */
+/* ==============                    */
+/* SPI 0 : radio                     */
+/* SPI 1 : flash                     */
+/* Uart 1: serial I/O                */
+static int wsn430_spi0(int UNUSED net, uint32_t UNUSED mask, uint32_t value)
+{
+  devnet_write(RADIO, CC1100_DATA_MASK, value);
+  etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_SPI0, 0);
+  return 0;
+}
+
+static int wsn430_spi1(int UNUSED net, uint32_t UNUSED mask, uint32_t value)
+{
+  devnet_write(FLASH, M25P_D, value);
+  etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_SPI1, 0);
+  return 0;
+}
+
+static int wsn430_uart1(int UNUSED net, uint32_t UNUSED mask, uint32_t value)
+{
+  devnet_write(SERIAL, PTTY_D, value);
+  /* etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_OUT, 0); */
+  return 0;
+}
+
+/* *************************************************************************** */
+/* devices -> MCU                                                              */
+/* *************************************************************************** */
+
+/* input on ds2411 */
+static int wsn430_ds2411(int UNUSED net, uint32_t mask, uint32_t value)
+{
+  if (mask & DS2411_D)
+    {
+      msp430_digiIO_dev_write(PORT2,(value & DS2411_D) << 4, BIT4_MASK); // P2.4
+      etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
+    }
+  return 0;
+}
+
+/* input on radio */
+static int wsn430_radio(int UNUSED net, uint32_t mask, uint32_t value)
+{
+  if (mask & CC1100_DATA_MASK)
+    {
+      if (MCU.usart0.mode != USART_MODE_SPI)
+	{
+#if defined(DEBUG_ME_HARDER)
+	  ERROR("wsn430:devices: read data on radio while not in SPI mode ?\n");
+#endif
+	}
+      msp430_usart0_dev_write_spi(value & CC1100_DATA_MASK);
+      etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_SPI0, 0);
+    }
+
+  if (mask & CC1100_SO_MASK)   // SOMI -> P3.2
+    {
+      msp430_digiIO_dev_write(PORT3, (CC1100_SO_MASK & value) ? 0x04 : 0x00, 0x04);
+      /* no etracer */
+    }
+  if (mask & CC1100_GDO2_MASK) // GDO2 -> P1.4
+    { 
+      msp430_digiIO_dev_write(PORT1, (CC1100_GDO2_MASK & value) ? 0x10 : 0x00, 0x10);
+      etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
+    }
+  if (mask & CC1100_GDO0_MASK) // GDO0 -> P1.3
+    { 
+      msp430_digiIO_dev_write(PORT1, (CC1100_GDO0_MASK & value) ? 0x08 : 0x00, 0x08);
+      etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, 
+			  ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
+    }
+  return 0;
+}
+
+/* input on flash */
+static int wsn430_flash(int UNUSED net, uint32_t mask, uint32_t value)
+{
+  if ((mask & M25P_D) != 0)
+    {
+      if (MCU.usart1.mode != USART_MODE_SPI)
+	{
+	  ERROR("wsn430:devices: read data on flash while not in SPI mode ?\n");
+	}
+      msp430_usart1_dev_write_spi(value & 0x00FF);
+      etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, 
+			  ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_SPI1, 0);
+    }
+  return 0;
+}
+
+/* input on UART serial */
+static int wsn430_serial(int UNUSED net, uint32_t mask, uint32_t value)
+{
+  if ((mask & PTTY_D) != 0)
+    {
+      msp430_usart1_dev_write_uart(value & PTTY_D);
+      /* etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, 
+	 ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_OUT, 0); */
+    }
+  return 0;
+}
+
+/* input on GUI */
+static int wsn430_ui(int UNUSED net, uint32_t UNUSED mask, uint32_t UNUSED value)
+{
+  ui_default_input("wsn430:devices");
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static struct devnet_wire_t wsn430_wiring[] = {
+  /* MCU -> devices */
+  { DEVNET_PORT(PORT1),     NULL, wsn430_port1   },
+  { DEVNET_PORT(PORT2),     NULL, wsn430_port2   },
+  { DEVNET_PORT(PORT4),     NULL, wsn430_port4   },
+  { DEVNET_PORT(PORT5),     NULL, wsn430_port5   },
+  { DEVNET_SPI(0),          NULL, wsn430_spi0    },
+  { DEVNET_SPI(1),          NULL, wsn430_spi1    },
+  { DEVNET_UART(1),         NULL, wsn430_uart1   },
+  /* devices -> MCU */
+  { DEVNET_DEV(DS24),       NULL, wsn430_ds2411  },
+  { DEVNET_DEV(RADIO),      NULL, wsn430_radio   },
+  { DEVNET_DEV(FLASH),      NULL, wsn430_flash   },
+  { DEVNET_DEV(SERIAL),     msp430_usart1_dev_write_uart_ok, wsn430_serial },
+  /* each step */
+  { DEVNET_HOOK,            NULL, wsn430_ui      },
+  { DEVNET_HOOK,            NULL, devnet_hook_libselect },
+  { DEVNET_HOOK,            NULL, devnet_hook_libwsnet  },
+  /* update */
+  { DEVNET_UPDATE(RADIO),   NULL, NULL },
+  { DEVNET_UPDATE(FLASH),   NULL, NULL },
+  { DEVNET_UPDATE(DS24),    NULL, NULL },
+  { DEVNET_UPDATE(SERIAL),  NULL, NULL },
+  { DEVNET_END,             NULL, NULL }
+};
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 int devices_create(void)
 {
   int res = 0;
@@ -280,6 +534,12 @@ int devices_create(void)
 #endif
   }
 
+  /*********************************/
+  /* interconnect                  */
+  /*********************************/
+
+  res += devnet_create(wsn430_wiring, msp430_devnet_pending, msp430_devnet_read);
+
   /*********************************/
   /* end of platform specific part */
   /*********************************/
@@ -315,279 +575,7 @@ int devices_reset_post(void)
 
 int devices_update(void)
 {
-  int res        = 0;
-  int refresh    = 0;
-  int CC1100_CSn = 0;
-  uint8_t  val8;
-
-  /* *************************************************************************** */
-  /* MCU -> devices                                                              */
-  /* *************************************************************************** */
-
-  /* port 1 :                          */
-  /* ========                          */
-  /*   P1.7 NC                         */
-  /*   P1.6 NC                         */
-  /*   P1.5 NC                         */
-  /*   P1.4 cc1100 gd2                 */
-  /*   P1.3 cc1100 gd0                 */
-  /*   P1.2 P_Dvcc -> flash write      */
-  /*   P1.1 NC                         */
-  /*   P1.0 NC                         */
-  if (msp430_digiIO_dev_read(PORT1,&val8))
-    {
-      machine.device[FLASH].write(FLASH, M25P_W, BIT(val8,2) << M25P_W_SHIFT);
-      etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
-    }
-  
-  /* port 2 :                          */
-  /* ========                          */
-  /*   P2.7 NC                         */
-  /*   P2.6 NC                         */
-  /*   P2.5 NC                         */
-  /*   P2.4 1wire                      */
-  /*   P2.3 NC                         */
-  /*   P2.3 NC                         */
-  /*   P2.1 7seg selector 1            */
-  /*   P2.0 7seg selector 0            */
-  if (msp430_digiIO_dev_read(PORT2,&val8))
-    {
-      machine.device[DS24].write(DS24,DS2411_D,BIT(val8,4)); 
-      etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
-    }
-
-  /* port 3 :                          */
-  /* ========                          */
-  /*   P3.7 urxd1 : serial             */
-  /*   P3.6 utxd1 : serial             */
-  /*   P3.5 urxd0                      */
-  /*   P3.4 utxd0                      */ 
-  /*   P3.3 SPI cc1100 UCLK            */
-  /*   P3.2 SPI cc1100 SOMI            */
-  /*   P3.1 SPI cc1100 SIMO            */
-  /*   P3.0 NC                         */
-#if 0
-  if (msp430_digiIO_dev_read(PORT3,&val8))
-    {
-      /* cc1100 is driven by spi                          */
-      /* we could/should check here that the pins are not */
-      /* driven by the GPIO                               */
-    }
-#endif
-
-  /* port 4 :                          */
-  /* ========                          */
-  /*   P4.7 flash hold                 */
-  /*   P4.6 NC                         */
-  /*   P4.5 NC                         */
-  /*   P4.4 CS flash                   */
-  /*   P4.3 NC                         */
-  /*   P4.2 CS cc1100                  */
-  /*   P4.1 batt status                */
-  /*   P4.0 NC                         */
-  if (msp430_digiIO_dev_read(PORT4,&val8))
-    {
-      machine.device[FLASH].write(FLASH, 
-				  M25P_H | M25P_S, 
-				  (BIT(val8,7) << M25P_H_SHIFT) | 
-				  (BIT(val8,4) << M25P_S_SHIFT));
-      /* waiting for flash update */
-      etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
-
-      CC1100_CSn = BIT(val8,2);
-      machine.device[RADIO].write(RADIO, CC1100_CSn_MASK, CC1100_CSn << CC1100_CSn_SHIFT);
-      etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
-    }
-
-  /* port 5 :                          */
-  /* ========                          */
-  /*   P5.7 NC                         */
-  /*   P5.6 led 3 (Blue)               */
-  /*   P5.5 led 2 (Green)              */
-  /*   P5.4 led 1 (Red)                */
-  /*   P5.3 SPI flash ram UCLK         */
-  /*   P5.2 SPI flash ram SOMI         */
-  /*   P5.1 SPI flash ram SIMO         */
-  /*   P5.0 NC                         */
-  if (msp430_digiIO_dev_read(PORT5,&val8))
-    {
-      machine.device[LED1].write(LED1,LED_DATA, ! BIT(val8,4));
-      etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
-      UPDATE(LED1);
-      REFRESH(LED1);
-
-      machine.device[LED2].write(LED2,LED_DATA, !  BIT(val8,5));
-      etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
-      UPDATE(LED2);
-      REFRESH(LED2);
-
-      machine.device[LED3].write(LED3,LED_DATA, ! BIT(val8,6));
-      etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
-      UPDATE(LED3);
-      REFRESH(LED3);
-    }
-
-  /* port 6 :                          */
-  /* ========                          */
-  /*   P6.7 ...                        */
-  /*   P6.6 ...                        */
-  /*   P6.5 ...                        */
-  /*   P6.4 ...                        */
-  /*   P6.3 ...                        */
-  /*   P6.2 ...                        */
-  /*   P6.1 ...                        */
-  /*   P6.0 ...                        */
-  /*
-  if (msp430_digiIO_dev_read(PORT6,&val8))
-    {
-
-    }
-  */
-
-  /* Usart SPI mode                    */
-  /* ==============                    */
-  /* SPI 0 : radio                     */
-  /* SPI 1 : flash                     */
-  switch (MCU.usart0.mode)
-    {
-    case USART_MODE_SPI:
-      if (msp430_usart0_dev_read_spi(&val8))
-	{
-	  machine.device[RADIO].write(RADIO, CC1100_DATA_MASK, val8);
-	  etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_SPI0, 0);
-	}      
-      break; 
-    case USART_MODE_UART:
-      break;
-    default:
-      break;
-    }
-
-  /* Usart1                            */
-  /* SPI  : flash                      */
-  /* Uart : serial I/O                 */
-  switch (MCU.usart1.mode)
-    {
-    case USART_MODE_SPI:
-      if (msp430_usart1_dev_read_spi(&val8))
-	{
-	  machine.device[FLASH].write(FLASH, M25P_D, val8);
-	  etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_SPI1, 0);
-	}
-      break;
-    case USART_MODE_UART:
-      if (msp430_usart1_dev_read_uart(&val8))
-	{
-	  machine.device[SERIAL].write(SERIAL, PTTY_D, val8);
-	  /* etracer_slot_access(0x0, 1, ETRACER_ACCESS_WRITE, ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_OUT, 0); */
-	}
-      break;
-    default:
-      break;
-    }
-    
-  /* *************************************************************************** */
-  /* devices -> MCU                                                              */
-  /* *************************************************************************** */
-
-  /* input on ds2411 */
-  {
-    uint32_t mask;
-    uint32_t value;
-    machine.device[DS24].read(DS24,&mask,&value);
-    if (mask & DS2411_D)
-      {
-	msp430_digiIO_dev_write(PORT2,(value & DS2411_D) << 4, BIT4_MASK); // P2.4
-	etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
-      }
-  }
-
-
-  /* input on radio */
-  {
-    uint32_t mask  = 0;
-    uint32_t value = 0;
-    machine.device[ RADIO ].read( RADIO ,&mask,&value);
-    if (mask & CC1100_DATA_MASK)
-      {
-	if (MCU.usart0.mode != USART_MODE_SPI)
-	  {
-#if defined(DEBUG_ME_HARDER)
-	    ERROR("wsn430:devices: read data on radio while not in SPI mode ?\n");
-#endif
-	  }
-	msp430_usart0_dev_write_spi(value & CC1100_DATA_MASK);
-	etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_SPI0, 0);
-      }
-
-    if (mask & CC1100_SO_MASK)   // SOMI -> P3.2
-      {
-	msp430_digiIO_dev_write(PORT3, (CC1100_SO_MASK & value) ? 0x04 : 0x00, 0x04);
-	/* no etracer */
-      }
-    if (mask & CC1100_GDO2_MASK) // GDO2 -> P1.4
-      { 
-	msp430_digiIO_dev_write(PORT1, (CC1100_GDO2_MASK & value) ? 0x10 : 0x00, 0x10);
-	etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
-      }
-    if (mask & CC1100_GDO0_MASK) // GDO0 -> P1.3
-      { 
-	msp430_digiIO_dev_write(PORT1, (CC1100_GDO0_MASK & value) ? 0x08 : 0x00, 0x08);
-	etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, 
-			    ETRACER_ACCESS_BIT, ETRACER_ACCESS_LVL_GPIO, 0);
-      }
-  }
-
-
-  /* input on flash */
-  {
-    uint32_t mask  = 0;
-    uint32_t value = 0;
-    machine.device[ FLASH ].read( FLASH ,&mask,&value);
-    if ((mask & M25P_D) != 0)
-      {
-	if (MCU.usart1.mode != USART_MODE_SPI)
-	  {
-	    ERROR("wsn430:devices: read data on flash while not in SPI mode ?\n");
-	  }
-	msp430_usart1_dev_write_spi(value & 0x00FF);
-	etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, 
-			    ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_SPI1, 0);
-      }
-  }
-
-
-  /* input on UART serial */
-  if (msp430_usart1_dev_write_uart_ok())
-    {
-      uint32_t mask,value;
-      machine.device[SERIAL].read(SERIAL,&mask,&value);
-      if ((mask & PTTY_D) != 0)
-	{
-	  msp430_usart1_dev_write_uart(value & PTTY_D);
-	  /* etracer_slot_access(0x0, 1, ETRACER_ACCESS_READ, 
-	     ETRACER_ACCESS_BYTE, ETRACER_ACCESS_LVL_OUT, 0); */
-	}
-    }
-
-
-  /* input on GUI */
-  ui_default_input("wsn430:devices");
-
-  /* *************************************************************************** */
-  /* update                                                                      */
-  /* *************************************************************************** */
-  LIBSELECT_UPDATE();
-  LIBWSNET_UPDATE();
-
-  UPDATE(RADIO);
-  UPDATE(FLASH);
-  UPDATE(DS24);
-  UPDATE(SERIAL);
-
-  ui_refresh(refresh);
-
-  return res;
+  return devnet_update();
 }
 
 /* ************************************************** */
@@ -0,0 +1,767 @@
+/**
+ *  \file   batch.c
+ *  \brief  WSim batch runner, jobs forked from a loaded machine
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "arch/common/hardware.h"
+#include "options.h"
+#include "batch.h"
+
+#if defined(WSIM_BATCH)
+#include <sys/wait.h>
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#define BATCH_LINE_MAX  4096
+#define BATCH_NAME_MAX  64
+#define BATCH_DELIM     " \t\r\n"
+#define BATCH_DEFAULT_LOG "wsim.log"
+
+enum batch_status_t {
+  BATCH_WAIT = 0,
+  BATCH_RUN,
+  BATCH_OK,
+  BATCH_FAILED,    /* exit code != 0 */
+  BATCH_KILLED,    /* ended by a signal */
+  BATCH_TIMEOUT,   /* wall time limit */
+  BATCH_ERROR,     /* job line error or fork failure */
+  BATCH_SKIPPED,   /* batch stopped before the job start */
+  BATCH_STATUS_MAX
+};
+
+static const char *batch_status_names[BATCH_STATUS_MAX] = {
+  "waiting",
+  "running",
+  "ok",
+  "failed",
+  "killed",
+  "timeout",
+  "error",
+  "skipped"
+};
+
+struct batch_stat_t {
+  char                *key;       /* section/name */
+  char                *value;
+};
+
+struct batch_job_t {
+  char                 name[BATCH_NAME_MAX];
+  int                  line;
+  struct options_t     o;
+  int                  timeout;   /* wall time limit in s, 0 = none */
+
+  enum batch_status_t  status;
+  int                  code;      /* exit code or signal number */
+  pid_t                pid;
+  uint64_t             start;
+  uint64_t             wall;      /* ns */
+
+  int                  stats_max;
+  struct batch_stat_t *stats;
+};
+
+struct batch_t {
+  const char          *filename;
+  struct options_t    *base;
+  int                  jobs_max;
+  struct batch_job_t  *jobs;
+};
+
+static volatile sig_atomic_t batch_stop = 0;
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static uint64_t batch_nanotime(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000 * 1000 * 1000 + t.tv_nsec;
+}
+
+static void batch_signal(int signum)
+{
+  batch_stop = signum;
+}
+
+static char* batch_strdup(const char *s)
+{
+  char *d = strdup(s);
+  if (d == NULL)
+    {
+      ERROR("wsim:batch: out of memory\n");
+      exit( EXIT_FAILURE );
+    }
+  return d;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static int batch_name_check(const char *name)
+{
+  const char *c;
+  if (name[0] == '\0' || strlen(name) >= BATCH_NAME_MAX)
+    return 1;
+  for(c = name; *c; c++)
+    {
+      if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+	    (*c >= '0' && *c <= '9') || *c == '_' || *c == '-' || *c == '.'))
+	return 1;
+    }
+  return 0;
+}
+
+#define BATCH_JOB_ERROR(b,job,fmt,x...)					\
+  do {									\
+    ERROR("wsim:batch: %s:%d: " fmt, b->filename, job->line, ##x);	\
+    job->status = BATCH_ERROR;						\
+  } while (0)
+
+/* a job line is modified by the parse */
+static void batch_job_parse(struct batch_t *b, struct batch_job_t *job, char *line)
+{
+  char *saveptr;
+  char *token;
+  char *mode    = NULL;
+  char *modearg = NULL;
+
+  memcpy(&job->o, b->base, sizeof(struct options_t));
+
+  token = strtok_r(line, BATCH_DELIM, &saveptr);
+  if (token[0] != '-')
+    {
+      if (batch_name_check(token))
+	{
+	  BATCH_JOB_ERROR(b, job, "wrong job name %s\n", token);
+	  return;
+	}
+      strncpyz(job->name, token, BATCH_NAME_MAX);
+      token = strtok_r(NULL, BATCH_DELIM, &saveptr);
+    }
+
+  /* a job log is always a file, it is read for the summary */
+  if ((strcmp(b->base->logfilename,"stdout") == 0) || (strcmp(b->base->logfilename,"stderr") == 0))
+    options_filename(job->o.logfilename, BATCH_DEFAULT_LOG, job->name);
+  else
+    options_filename(job->o.logfilename, b->base->logfilename, job->name);
+
+  for( ; token != NULL; token = strtok_r(NULL, BATCH_DELIM, &saveptr))
+    {
+      char *value = strchr(token, '=');
+      if (value == NULL)
+	{
+	  BATCH_JOB_ERROR(b, job, "missing value for option %s\n", token);
+	  return;
+	}
+      *value++ = '\0';
+
+      if (strcmp(token, "--mode") == 0)
+	{
+	  mode = value;
+	}
+      else if (strcmp(token, "--modearg") == 0)
+	{
+	  modearg = value;
+	}
+      else if (strcmp(token, "--logfile") == 0)
+	{
+	  strncpyz(job->o.logfilename, value, MAX_FILENAME);
+	}
+      else if (strcmp(token, "--timeout") == 0)
+	{
+	  job->timeout = atoi(value);
+	  if (job->timeout <= 0)
+	    {
+	      BATCH_JOB_ERROR(b, job, "wrong timeout %s\n", value);
+	      return;
+	    }
+	}
+#if defined(ENABLE_RAM_CONTROL)
+      else if (strcmp(token, "--monitor") == 0)
+	{
+	  job->o.do_monitor = 1;
+	  job->o.monitor    = batch_strdup(value);
+	}
+      else if (strcmp(token, "--modify") == 0)
+	{
+	  job->o.do_modify  = 1;
+	  job->o.modify     = batch_strdup(value);
+	}
+#endif
+      else
+	{
+	  BATCH_JOB_ERROR(b, job, "option %s cannot be set by a batch job\n", token);
+	  return;
+	}
+    }
+
+  if ((mode != NULL || modearg != NULL) && options_mode_set(&job->o, mode, modearg) != 0)
+    {
+      BATCH_JOB_ERROR(b, job, "wrong mode %s %s\n", mode ? mode : "", modearg ? modearg : "");
+      return;
+    }
+
+  if ((job->o.sim_mode == SIM_MODE_GDB) || (job->o.sim_mode == SIM_MODE_CONS))
+    {
+      BATCH_JOB_ERROR(b, job, "gdb and console modes cannot be used with batch\n");
+      return;
+    }
+}
+
+static int batch_read(struct batch_t *b)
+{
+  FILE *f;
+  char  line[BATCH_LINE_MAX];
+  int   lineno = 0;
+  int   size   = 0;
+
+  if ((f = fopen(b->filename, "r")) == NULL)
+    {
+      ERROR("wsim:batch: cannot open batch file %s\n", b->filename);
+      return 1;
+    }
+
+  while (fgets(line, BATCH_LINE_MAX, f) != NULL)
+    {
+      struct batch_job_t *job;
+      char *c;
+
+      lineno++;
+      if ((c = strchr(line, '#')) != NULL)
+	*c = '\0';
+      if (line[strspn(line, BATCH_DELIM)] == '\0')
+	continue;
+
+      if (b->jobs_max == size)
+	{
+	  size    = (size == 0) ? 64 : size * 2;
+	  b->jobs = (struct batch_job_t*)realloc(b->jobs, size * sizeof(struct batch_job_t));
+	  if (b->jobs == NULL)
+	    {
+	      ERROR("wsim:batch: cannot allocate %d jobs\n", size);
+	      fclose(f);
+	      return 1;
+	    }
+	}
+
+      job = &b->jobs[b->jobs_max];
+      memset(job, 0, sizeof(struct batch_job_t));
+      job->line = lineno;
+      snprintf(job->name, BATCH_NAME_MAX, "job%d", b->jobs_max + 1);
+      batch_job_parse(b, job, line);
+      b->jobs_max ++;
+    }
+
+  fclose(f);
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void batch_job_start(struct batch_job_t *job, batch_run_t run)
+{
+  /* buffered log output must not be written again by the child */
+  fflush(NULL);
+
+  job->start = batch_nanotime();
+  job->pid   = fork();
+  switch (job->pid)
+    {
+    case -1:
+      ERROR("wsim:batch: cannot fork job %s: %s\n", job->name, strerror(errno));
+      job->status = BATCH_ERROR;
+      return;
+
+    case 0:
+      signal(SIGTERM, SIG_DFL);
+      if (job->timeout > 0)
+	{
+	  alarm(job->timeout);
+	}
+      run(&job->o, job->name);
+      _exit( EXIT_FAILURE );
+
+    default:
+      job->status = BATCH_RUN;
+      INFO("wsim:batch: job %s started, pid %d\n", job->name, job->pid);
+      break;
+    }
+}
+
+static void batch_job_end(struct batch_job_t *job, int status)
+{
+  job->wall = batch_nanotime() - job->start;
+  if (WIFEXITED(status))
+    {
+      job->code   = WEXITSTATUS(status);
+      job->status = (job->code == 0) ? BATCH_OK : BATCH_FAILED;
+      /* the wall time limit ends the simulation normally */
+      if ((job->status == BATCH_OK) && (job->timeout > 0) &&
+	  (job->wall >= (uint64_t)job->timeout * 1000 * 1000 * 1000))
+	{
+	  job->status = BATCH_TIMEOUT;
+	}
+    }
+  else
+    {
+      job->code   = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+      job->status = BATCH_KILLED;
+    }
+
+  OUTPUT("wsim:batch: job %s %s (%d) in %"PRIu64" ms\n", job->name,
+	 batch_status_names[job->status], job->code, job->wall / (1000*1000));
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static char* batch_trim(char *s)
+{
+  char *e;
+  s += strspn(s, BATCH_DELIM);
+  e  = s + strlen(s);
+  while ((e > s) && strchr(BATCH_DELIM, e[-1]))
+    *--e = '\0';
+  return s;
+}
+
+static void batch_job_stat_add(struct batch_job_t *job, const char *section, const char *key, const char *value)
+{
+  char name[BATCH_LINE_MAX];
+  int  i;
+
+  snprintf(name, BATCH_LINE_MAX, "%s/%s", section, key);
+  for(i = 0; i < job->stats_max; i++)
+    {
+      if (strcmp(job->stats[i].key, name) == 0)
+	{
+	  free(job->stats[i].value);
+	  job->stats[i].value = batch_strdup(value);
+	  return;
+	}
+    }
+
+  job->stats = (struct batch_stat_t*)realloc(job->stats, (job->stats_max + 1) * sizeof(struct batch_stat_t));
+  if (job->stats == NULL)
+    {
+      ERROR("wsim:batch: out of memory\n");
+      exit( EXIT_FAILURE );
+    }
+  job->stats[job->stats_max].key   = batch_strdup(name);
+  job->stats[job->stats_max].value = batch_strdup(value);
+  job->stats_max ++;
+}
+
+/*
+ * statistics are read back from the job log, in the box written by
+ * OUTPUT_STATS. Unindented lines ending with ':' are sections, indented
+ * "name : value" lines are the statistics.
+ */
+static void batch_job_stats(struct batch_job_t *job)
+{
+  FILE *f;
+  char  line[BATCH_LINE_MAX];
+  char  section[BATCH_LINE_MAX] = "";
+  int   inbox = 0;
+
+  if ((f = fopen(job->o.logfilename, "r")) == NULL)
+    {
+      WARNING("wsim:batch: cannot read log %s of job %s\n", job->o.logfilename, job->name);
+      return;
+    }
+
+  while (fgets(line, BATCH_LINE_MAX, f) != NULL)
+    {
+      char *c;
+      char *sep;
+
+      if (strncmp(line, ",----", 5) == 0)
+	{
+	  inbox = 1;
+	  continue;
+	}
+      if (strncmp(line, "`----", 5) == 0)
+	{
+	  inbox = 0;
+	  continue;
+	}
+      if ((inbox == 0) || (strncmp(line, "|  ", 3) != 0))
+	continue;
+
+      c = line + 3;
+      if ((c[0] != ' ') && ((sep = strrchr(c, ':')) != NULL) && (*batch_trim(sep + 1) == '\0'))
+	{
+	  *sep = '\0';
+	  strncpyz(section, batch_trim(c), BATCH_LINE_MAX);
+	}
+      else if ((c[0] == ' ') && ((sep = strstr(c, " : ")) != NULL))
+	{
+	  char *value;
+	  *sep  = '\0';
+	  value = batch_trim(sep + 3);
+	  c     = batch_trim(c);
+	  if ((*value != '\0') && (*c != '\0'))
+	    batch_job_stat_add(job, section, c, value);
+	}
+    }
+  fclose(f);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/* union of the statistics names, in first seen order */
+static const char** batch_keys(struct batch_t *b, int *keys_max)
+{
+  const char **keys = NULL;
+  int size = 0;
+  int j, i, k;
+
+  *keys_max = 0;
+  for(j = 0; j < b->jobs_max; j++)
+    {
+      for(i = 0; i < b->jobs[j].stats_max; i++)
+	{
+	  const char *key = b->jobs[j].stats[i].key;
+	  for(k = 0; k < *keys_max; k++)
+	    {
+	      if (strcmp(keys[k], key) == 0)
+		break;
+	    }
+	  if (k < *keys_max)
+	    continue;
+	  if (*keys_max == size)
+	    {
+	      size = (size == 0) ? 64 : size * 2;
+	      if ((keys = (const char**)realloc(keys, size * sizeof(char*))) == NULL)
+		{
+		  ERROR("wsim:batch: out of memory\n");
+		  exit( EXIT_FAILURE );
+		}
+	    }
+	  keys[(*keys_max)++] = key;
+	}
+    }
+  return keys;
+}
+
+static const char* batch_job_stat(struct batch_job_t *job, const char *key)
+{
+  int i;
+  for(i = 0; i < job->stats_max; i++)
+    {
+      if (strcmp(job->stats[i].key, key) == 0)
+	return job->stats[i].value;
+    }
+  return NULL;
+}
+
+static void batch_csv_string(FILE *f, const char *s)
+{
+  if (strpbrk(s, ",\"\r\n") == NULL)
+    {
+      fputs(s, f);
+      return;
+    }
+  fputc('"', f);
+  for( ; *s; s++)
+    {
+      if (*s == '"')
+	fputc('"', f);
+      fputc(*s, f);
+    }
+  fputc('"', f);
+}
+
+static void batch_json_string(FILE *f, const char *s)
+{
+  fputc('"', f);
+  for( ; *s; s++)
+    {
+      if (*s == '"' || *s == '\\')
+	fprintf(f, "\\%c", *s);
+      else if ((unsigned char)*s < 0x20)
+	fprintf(f, "\\u%04x", (unsigned char)*s);
+      else
+	fputc(*s, f);
+    }
+  fputc('"', f);
+}
+
+/* plain numbers are json numbers, other values are kept as strings */
+static void batch_json_value(FILE *f, const char *s)
+{
+  char *end;
+  strtod(s, &end);
+  if ((end != s) && (*end == '\0') && (strspn(s, "+-.0123456789eE") == strlen(s)))
+    fputs(s, f);
+  else
+    batch_json_string(f, s);
+}
+
+static void batch_write_csv(struct batch_t *b, FILE *f, const char **keys, int keys_max)
+{
+  int j, k;
+
+  fprintf(f, "job,status,code,wall_ms,logfile");
+  for(k = 0; k < keys_max; k++)
+    {
+      fputc(',', f);
+      batch_csv_string(f, keys[k]);
+    }
+  fputc('\n', f);
+
+  for(j = 0; j < b->jobs_max; j++)
+    {
+      struct batch_job_t *job = &b->jobs[j];
+      fprintf(f, "%s,%s,%d,%"PRIu64",", job->name, batch_status_names[job->status],
+	      job->code, job->wall / (1000*1000));
+      batch_csv_string(f, job->o.logfilename);
+      for(k = 0; k < keys_max; k++)
+	{
+	  const char *value = batch_job_stat(job, keys[k]);
+	  fputc(',', f);
+	  if (value != NULL)
+	    batch_csv_string(f, value);
+	}
+      fputc('\n', f);
+    }
+}
+
+static void batch_write_json(struct batch_t *b, FILE *f)
+{
+  int j, i;
+
+  fprintf(f, "[\n");
+  for(j = 0; j < b->jobs_max; j++)
+    {
+      struct batch_job_t *job = &b->jobs[j];
+      fprintf(f, "  {\n    \"job\": ");
+      batch_json_string(f, job->name);
+      fprintf(f, ",\n    \"status\": \"%s\",\n    \"code\": %d,\n    \"wall_ms\": %"PRIu64",\n    \"logfile\": ",
+	      batch_status_names[job->status], job->code, job->wall / (1000*1000));
+      batch_json_string(f, job->o.logfilename);
+      fprintf(f, ",\n    \"stats\": {");
+      for(i = 0; i < job->stats_max; i++)
+	{
+	  fprintf(f, "%s\n      ", (i == 0) ? "" : ",");
+	  batch_json_string(f, job->stats[i].key);
+	  fprintf(f, ": ");
+	  batch_json_value(f, job->stats[i].value);
+	}
+      fprintf(f, "%s}\n  }%s\n", (job->stats_max > 0) ? "\n    " : "", (j < b->jobs_max - 1) ? "," : "");
+    }
+  fprintf(f, "]\n");
+}
+
+static int batch_write(struct batch_t *b, const char *filename)
+{
+  FILE *f;
+  const char *ext = strrchr(filename, '.');
+
+  if ((f = fopen(filename, "w")) == NULL)
+    {
+      ERROR("wsim:batch: cannot open summary file %s\n", filename);
+      return 1;
+    }
+
+  if ((ext != NULL) && (strcmp(ext, ".json") == 0))
+    {
+      batch_write_json(b, f);
+    }
+  else
+    {
+      int keys_max;
+      const char **keys = batch_keys(b, &keys_max);
+      batch_write_csv(b, f, keys, keys_max);
+      free(keys);
+    }
+
+  fclose(f);
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void batch_dump_stats(struct batch_t *b, uint64_t wall)
+{
+  int      count[BATCH_STATUS_MAX];
+  uint64_t jobs_wall = 0;
+  int      j, s;
+
+  memset(count, 0, sizeof(count));
+  for(j = 0; j < b->jobs_max; j++)
+    {
+      count[b->jobs[j].status] ++;
+      jobs_wall += b->jobs[j].wall;
+    }
+
+  OUTPUT("\n");
+  OUTPUT_STATS_START("");
+  OUTPUT_STATS("Batch stats:\n");
+  OUTPUT_STATS("------------\n");
+  OUTPUT_STATS("  batch jobs                    : %d (%d in parallel)\n", b->jobs_max, b->base->batch_jobs);
+  for(s = BATCH_OK; s < BATCH_STATUS_MAX; s++)
+    {
+      if (count[s] > 0)
+	OUTPUT_STATS("  batch jobs %-18s : %d\n", batch_status_names[s], count[s]);
+    }
+  OUTPUT_STATS("  batch wall time               : %"PRIu64" ms\n", wall / (1000*1000));
+  OUTPUT_STATS("  batch jobs wall time          : %"PRIu64" ms\n", jobs_wall / (1000*1000));
+  OUTPUT_STATS("  batch summary                 : %s\n", b->base->batch_out);
+  OUTPUT_STATS_STOP("");
+}
+
+static void batch_delete(struct batch_t *b)
+{
+  int j, i;
+  for(j = 0; j < b->jobs_max; j++)
+    {
+      struct batch_job_t *job = &b->jobs[j];
+      for(i = 0; i < job->stats_max; i++)
+	{
+	  free(job->stats[i].key);
+	  free(job->stats[i].value);
+	}
+      free(job->stats);
+      if (job->o.monitor != b->base->monitor)
+	free(job->o.monitor);
+      if (job->o.modify != b->base->modify)
+	free(job->o.modify);
+    }
+  free(b->jobs);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+int batch_main(struct options_t *o, batch_run_t run)
+{
+  struct batch_t b;
+  struct sigaction sa;
+  struct sigaction old_int;
+  struct sigaction old_term;
+  uint64_t start;
+  int    next    = 0;
+  int    running = 0;
+  int    forward = 0;
+  int    res     = 0;
+  int    j;
+
+  memset(&b, 0, sizeof(b));
+  b.filename = o->batch;
+  b.base     = o;
+  if (batch_read(&b))
+    {
+      batch_delete(&b);
+      return 1;
+    }
+
+  OUTPUT("wsim:batch: %d jobs from %s, %d in parallel\n", b.jobs_max, b.filename, o->batch_jobs);
+
+  /* ^C also reaches the jobs, which stop and write their statistics */
+  /* no SA_RESTART, a signal interrupts waitpid()                     */
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = batch_signal;
+  sigemptyset(&sa.sa_mask);
+  batch_stop = 0;
+  sigaction(SIGINT,  &sa, &old_int);
+  sigaction(SIGTERM, &sa, &old_term);
+  start      = batch_nanotime();
+
+  for(;;)
+    {
+      int   status;
+      pid_t pid;
+
+      while ((batch_stop == 0) && (running < o->batch_jobs) && (next < b.jobs_max))
+	{
+	  struct batch_job_t *job = &b.jobs[next++];
+	  if (job->status != BATCH_WAIT)
+	    continue;
+	  batch_job_start(job, run);
+	  if (job->status == BATCH_RUN)
+	    running ++;
+	}
+
+      if (running == 0)
+	break;
+
+      /* SIGTERM is only sent to the batch process */
+      if ((batch_stop == SIGTERM) && (forward == 0))
+	{
+	  for(j = 0; j < b.jobs_max; j++)
+	    {
+	      if (b.jobs[j].status == BATCH_RUN)
+		kill(b.jobs[j].pid, SIGINT);
+	    }
+	  forward = 1;
+	}
+
+      if ((pid = waitpid(-1, &status, 0)) == -1)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  ERROR("wsim:batch: wait error %s\n", strerror(errno));
+	  break;
+	}
+
+      for(j = 0; j < b.jobs_max; j++)
+	{
+	  if ((b.jobs[j].status == BATCH_RUN) && (b.jobs[j].pid == pid))
+	    {
+	      batch_job_end(&b.jobs[j], status);
+	      batch_job_stats(&b.jobs[j]);
+	      running --;
+	      break;
+	    }
+	}
+    }
+
+  sigaction(SIGINT,  &old_int,  NULL);
+  sigaction(SIGTERM, &old_term, NULL);
+
+  for(j = 0; j < b.jobs_max; j++)
+    {
+      if (b.jobs[j].status == BATCH_WAIT)
+	b.jobs[j].status = BATCH_SKIPPED;
+      if (b.jobs[j].status != BATCH_OK)
+	res = 1;
+    }
+
+  if (batch_write(&b, o->batch_out))
+    res = 1;
+  batch_dump_stats(&b, batch_nanotime() - start);
+  batch_delete(&b);
+  return res;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#endif /* WSIM_BATCH */
@@ -0,0 +1,39 @@
+/**
+ *  \file   batch.h
+ *  \brief  WSim batch runner, jobs forked from a loaded machine
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#ifndef WSIM_BATCH_H
+#define WSIM_BATCH_H
+
+/**
+ * A batch file lists one job per line, an optional job name followed by
+ * the run time options of the job. Lines starting with # are comments.
+ *
+ *   # name    options
+ *   short     --mode=time --modearg=1s
+ *   long      --mode=time --modearg=60s --timeout=30
+ *   period10  --mode=time --modearg=10s --modify=period:10
+ *   period20  --mode=time --modearg=10s --modify=period:20
+ *
+ * The machine is created, loaded and reset once, each job is a forked
+ * copy of it and only the options below can change from one job to the
+ * other: --mode, --modearg, --monitor, --modify, --logfile, and
+ * --timeout for a host wall time limit in seconds. Jobs write their log
+ * to the base logfile with a -name suffix.
+ *
+ * The statistics of all job logs are gathered in a csv or json summary.
+ **/
+
+#if defined(HAVE_FORK) && defined(HAVE_SYS_WAIT_H)
+#define WSIM_BATCH 1
+#endif
+
+/* runs a job in the forked process, does not return */
+typedef void (*batch_run_t)(struct options_t *job, const char *name);
+
+int batch_main(struct options_t *o, batch_run_t run);
+
+#endif
@@ -23,6 +23,12 @@
 #include "libwsnet/libwsnet.h"
 #include "src/options.h"
 #include "src/revision.h"
+#include "src/batch.h"
+
+#if defined(WSIM_MULTINODE)
+#include <pthread.h>
+#include "libwsnet/wsnet_local.h"
+#endif
 
 
 /*
@@ -62,7 +68,7 @@ char* wsim_end_mode_str(enum wsim_end_mode_t mode)
   return "unknown";
 }
 
-static struct options_t o;
+static WSIM_TLS struct options_t o;
 static void main_end(enum wsim_end_mode_t mode);
 
 /* ************************************************** */
@@ -91,7 +97,11 @@ static void main_dump_stats()
 
 #if defined(FUNC_GETRUSAGE_DEFINED)
   struct rusage ru;
+#if defined(WSIM_MULTINODE) && defined(RUSAGE_THREAD)
+  getrusage(o.multinode ? RUSAGE_THREAD : RUSAGE_SELF,&ru);
+#else
   getrusage(RUSAGE_SELF,&ru);
+#endif
   /* explicit cast to prevent overflow */
   /* utime : user time                 */
   /* stime : system time               */
@@ -114,6 +124,20 @@ static void main_dump_stats()
        */
     }
   OUTPUT_STATS("  simulation backtracks         : %d\n",machine.backtrack); 
+  if (o.do_trace)
+    {
+      tracer_dump_stats();
+    }
+  if (o.do_logpkt)
+    {
+      logpkt_dump_stats();
+    }
+#if defined(WSIM_MULTINODE)
+  if (o.multinode)
+    {
+      wsnet_local_dump_stats();
+    }
+#endif
 
   OUTPUT_STATS("\n");
   machine_dump_stats(unanotime); /* system time */
@@ -124,21 +148,26 @@ static void main_dump_stats()
 /* ************************************************** */
 /* ************************************************** */
 
-static void  main_run_mode(struct options_t* o)
+static void  main_signals(struct options_t* o)
 {
 #if !defined(__MINGW32__)
-  signal(SIGINT ,signal_quit);
-  signal(SIGQUIT,signal_quit);
-  signal(SIGUSR1,signal_quit);
-  signal(SIGUSR2,signal_quit);
-  signal(SIGPIPE,signal_quit); 
+  /* multinode signals are handled by the main thread */
+  if (o->multinode == 0)
+    {
+      signal(SIGINT ,signal_quit);
+      signal(SIGQUIT,signal_quit);
+      signal(SIGUSR1,signal_quit);
+      signal(SIGUSR2,signal_quit);
+      signal(SIGPIPE,signal_quit); 
+      signal(SIGALRM,signal_quit); /* batch job wall time limit */
+    }
 #endif
-  
+}
+
+static void  main_run(struct options_t* o)
+{
   struct machine_opt_t m;
-  
-  machine_reset();
-  machine_state_save();
-  
+
   /* so far so good, run() */
   switch (o->sim_mode)
     {
@@ -164,6 +193,16 @@ static void  main_run_mode(struct options_t* o)
     }
 }
 
+static void  main_run_mode(struct options_t* o)
+{
+  main_signals(o);
+  
+  machine_reset();
+  machine_state_save();
+  
+  main_run(o);
+}
+
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
@@ -179,7 +218,7 @@ void app_exit_error()
 /* ************************************************** */
 /* ************************************************** */
 
-static void main_end(enum wsim_end_mode_t mode)
+static void main_node_end(enum wsim_end_mode_t mode)
 {
   OUTPUT("================\n");
   OUTPUT("== wsim stop  ==\n");
@@ -197,6 +236,9 @@ static void main_end(enum wsim_end_mode_t mode)
       machine_dump(o.dumpfile);
     }
 
+  /* outputs held until the next checkpoint */
+  machine_checkpoint_outputs_close();
+
   /* finishing traces */
   if (o.do_trace)
     {
@@ -213,9 +255,14 @@ static void main_end(enum wsim_end_mode_t mode)
   machine_delete();
   worldsens_c_close();
   libselect_close();
-  logger_close();
   logpkt_close();
+  logger_close();
   ui_delete();
+}
+
+static void main_end(enum wsim_end_mode_t mode)
+{
+  main_node_end(mode);
   exit( EXIT_SUCCESS );
 }
 
@@ -227,26 +274,13 @@ static void main_end(enum wsim_end_mode_t mode)
 #include <windows.h>
 #include <winsock.h>
 #endif
+#undef ERROR
 
 /**
- * main : program entry point
+ * node creation, from the logger to the loaded machine
  **/
-int main(int argc, char* argv[])
+static int main_node_create(void)
 {
-
-#ifdef _WIN32
-	{
-		WSADATA data;
-		WSAStartup(MAKEWORD(2,0), &data);
-	}
-#endif
-#undef ERROR
-  /* options */
-  options_start();
-  ui_options_add();
-  machine_options_add();
-  options_read_cmdline(&o,&argc,argv);
-
   /* logger creation                              */
   /* do not use logger functions before that line */
   logger_init(o.logfilename,o.verbose);
@@ -276,18 +310,32 @@ int main(int argc, char* argv[])
     }
 
 
-  /* event tracer */
-  tracer_init(o.tracefile, o.wsens_mode);
+  /* event tracer, batch jobs are forked and cannot share its writer */
+  tracer_init(o.do_batch ? NULL : o.tracefile, o.wsens_mode);
 
   /* packet logger */
-  logpkt_init(o.do_logpkt, o.logpkt, o.logpktfilename);
+  logpkt_init(o.do_logpkt, o.logpkt, o.logpktfilename, o.wsens_mode);
 
   /* libselect init  */
-  libselect_init(o.wsens_mode);
+  if (libselect_init(o.wsens_mode))
+    {
+      ERROR("wsim: ** error during libselect initialization **\n");
+      return 1;
+    }
 
   /* etrace */
   etracer_init(o.etracefile, o.wsens_mode);
 
+  /* energy accounting, shares the etracer slot stream with eSimu */
+  if (o.do_energy && o.do_etrace)
+    {
+      WARNING("wsim: --energy cannot be used with --esimu, energy accounting is disabled\n");
+    }
+  energy_init(o.do_energy && !o.do_etrace, o.energy_voltage, o.wsens_mode);
+
+  /* devices memory images */
+  devimg_init(o.wsens_mode);
+
   /* worldsens initialize */
   worldsens_c_initialize(o.wsens_mode);
 
@@ -303,6 +351,12 @@ int main(int argc, char* argv[])
   /* set timeref once the machine is created */
   tracer_set_timeref(machine_get_nanotime);
 
+  /* wsnet modes save the outputs at rendez-vous, otherwise at checkpoints */
+  if (! WS_MODE_BACKTRACK(o.wsens_mode))
+    {
+      machine_checkpoint_outputs_open();
+    }
+
   /* worldsens connect to wsnet server */
   worldsens_c_connect(o.server_ip, o.server_port, o.multicast_ip, o.multicast_port, o.node_id);
 
@@ -345,7 +399,14 @@ int main(int argc, char* argv[])
       ERROR("Cannot create display\n");
       return 3;
     }
+  return 0;
+}
 
+/**
+ * node start, run time options applied to the created machine
+ **/
+static void main_node_start(void)
+{
   if (o.do_etrace_at_begin)
     {
       INFO("wsim: starting eSimu tracer at wsim start\n");
@@ -377,6 +438,284 @@ int main(int argc, char* argv[])
       OUTPUT("\n");
       machine_print_description();
     }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#if defined(WSIM_MULTINODE)
+
+/*
+ * every node is a thread with its own copy of the machine, devices and
+ * libraries state (WSIM_TLS variables). Options structures and the
+ * libwsnet dispatch pointers are shared and are only written during the
+ * node creation and deletion, which are serialized.
+ */
+
+#define MAIN_NODE_STACK_SIZE (16*1024*1024)
+
+struct main_node_t {
+  pthread_t thread;
+  int       index;
+  int       result;
+};
+
+static struct options_t *main_node_options;
+static pthread_mutex_t   main_node_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void main_node_filename(char *dst, const char *src, uint32_t id)
+{
+  char suffix[16];
+  snprintf(suffix, sizeof(suffix), "%d", id);
+  options_filename(dst, src, suffix);
+}
+
+static void* main_node_thread(void *arg)
+{
+  struct main_node_t *node = (struct main_node_t*)arg;
+  char suffix[16];
+
+  o         = *main_node_options;
+  o.node_id = main_node_options->node_id + node->index;
+  snprintf(suffix, sizeof(suffix), "%d", o.node_id);
+  devimg_suffix(suffix);
+  main_node_filename(o.logfilename,    main_node_options->logfilename,    o.node_id);
+  main_node_filename(o.logpktfilename, main_node_options->logpktfilename, o.node_id);
+  main_node_filename(o.dumpfile,       main_node_options->dumpfile,       o.node_id);
+  main_node_filename(o.tracefile,      main_node_options->tracefile,      o.node_id);
+  main_node_filename(o.etracefile,     main_node_options->etracefile,     o.node_id);
+  wsnet_local_node_set(node->index, o.node_id);
+
+  pthread_mutex_lock(&main_node_lock);
+  node->result = main_node_create();
+  if (node->result != 0)
+    {
+      pthread_mutex_unlock(&main_node_lock);
+      wsnet_local_node_leave();
+      return NULL;
+    }
+  main_node_start();
+  pthread_mutex_unlock(&main_node_lock);
+
+  OUTPUT("\n");
+  OUTPUT("================\n");
+  OUTPUT("== wsim start ==\n");
+  OUTPUT("================\n");
+  main_run_mode(&o);
+
+  pthread_mutex_lock(&main_node_lock);
+  main_node_end((mcu_signal_get() & SIG_HOST) ? WSIM_END_SIGNAL : WSIM_END_NORMAL);
+  pthread_mutex_unlock(&main_node_lock);
+  return NULL;
+}
+
+static void signal_multinode_quit(int UNUSED signum)
+{
+  wsnet_local_stop();
+}
+
+static int main_multinode(void)
+{
+  struct main_node_t *nodes;
+  pthread_attr_t      attr;
+  sigset_t            sigs;
+  sigset_t            old;
+  int                 i;
+  int                 res = 0;
+
+  logger_init(o.logfilename,o.verbose);
+  OUTPUT("%s\n",VERSION_STRING());
+  OUTPUT("wsim: pid %d, %d nodes\n",getpid(),o.multinode);
+
+  if (ui_options_display())
+    {
+      ERROR("wsim: the GUI cannot be used with multinode\n");
+      return 1;
+    }
+
+  if (wsnet_local_create(o.multinode))
+    {
+      ERROR("wsim: ** error during multinode medium creation **\n");
+      return 1;
+    }
+
+  nodes = (struct main_node_t*)calloc(o.multinode, sizeof(struct main_node_t));
+  if (nodes == NULL)
+    {
+      ERROR("wsim: cannot allocate %d nodes\n",o.multinode);
+      return 1;
+    }
+  main_node_options = &o;
+
+  /* node threads inherit a blocked signal mask */
+  sigemptyset(&sigs);
+  sigaddset(&sigs, SIGINT);
+  sigaddset(&sigs, SIGQUIT);
+  sigaddset(&sigs, SIGUSR1);
+  sigaddset(&sigs, SIGUSR2);
+  sigaddset(&sigs, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &sigs, &old);
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, MAIN_NODE_STACK_SIZE);
+  for(i=0; i < o.multinode; i++)
+    {
+      nodes[i].index = i;
+      if (pthread_create(&nodes[i].thread, &attr, main_node_thread, &nodes[i]) != 0)
+	{
+	  ERROR("wsim: cannot start node %d\n",i);
+	  app_exit_error();
+	}
+    }
+  pthread_attr_destroy(&attr);
+
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  signal(SIGINT ,signal_multinode_quit);
+  signal(SIGQUIT,signal_multinode_quit);
+  signal(SIGUSR1,signal_multinode_quit);
+  signal(SIGUSR2,signal_multinode_quit);
+  signal(SIGPIPE,SIG_IGN);
+
+  for(i=0; i < o.multinode; i++)
+    {
+      pthread_join(nodes[i].thread, NULL);
+      if (nodes[i].result != 0)
+	{
+	  ERROR("wsim: node %d failed\n",i);
+	  res = nodes[i].result;
+	}
+    }
+
+  OUTPUT("wsim: %d nodes stopped\n",o.multinode);
+  free(nodes);
+  wsnet_local_delete();
+  logger_close();
+  return res;
+}
+#endif
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+#if defined(WSIM_BATCH)
+
+/*
+ * batch jobs are forked from the parent process once the machine is
+ * created, loaded and reset. Each job only changes run time options and
+ * writes its own log.
+ */
+
+static void main_batch_job(struct options_t *job, const char *name)
+{
+  o = *job;
+  logger_close();
+  logger_init(o.logfilename,o.verbose);
+  OUTPUT("%s\n",VERSION_STRING());
+  OUTPUT("wsim: pid %d, batch job %s\n",getpid(),name);
+
+  if (machine_fwprof_suffix(name) != 0)
+    {
+      /* the job is reported as failed */
+      logger_close();
+      return;
+    }
+  main_node_start();
+  main_signals(&o);
+  machine_state_save();
+
+  OUTPUT("\n");
+  OUTPUT("================\n");
+  OUTPUT("== wsim start ==\n");
+  OUTPUT("================\n");
+  main_run(&o);
+
+  main_end((mcu_signal_get() & SIG_HOST) ? WSIM_END_SIGNAL : WSIM_END_NORMAL);
+}
+
+static int main_batch(void)
+{
+  int res;
+
+  if (ui_options_display())
+    {
+      fprintf(stderr,"wsim: the GUI cannot be used with batch\n");
+      return 1;
+    }
+
+  if ((res = main_node_create()) != 0)
+    {
+      return res;
+    }
+
+  /* forked jobs would share the image mapping */
+  if (devimg_shared() > 0)
+    {
+      ERROR("wsim: flash images written in place cannot be used with batch\n");
+      machine_delete();
+      logger_close();
+      return 1;
+    }
+
+  machine_reset();
+  res = batch_main(&o, main_batch_job);
+
+  machine_delete();
+  libselect_close();
+  logger_close();
+  ui_delete();
+  return res;
+}
+#endif
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * main : program entry point
+ **/
+int main(int argc, char* argv[])
+{
+  int res;
+
+#ifdef _WIN32
+	{
+		WSADATA data;
+		WSAStartup(MAKEWORD(2,0), &data);
+	}
+#endif
+  /* options */
+  options_start();
+  ui_options_add();
+  libselect_options_add();
+  machine_options_add();
+  worldsens2_c_options_add();
+#if defined(WSIM_MULTINODE)
+  wsnet_local_options_add();
+#endif
+  options_read_cmdline(&o,&argc,argv);
+
+#if defined(WSIM_MULTINODE)
+  if (o.multinode > 0)
+    {
+      return main_multinode();
+    }
+#endif
+
+#if defined(WSIM_BATCH)
+  if (o.do_batch)
+    {
+      return main_batch();
+    }
+#endif
+
+  if ((res = main_node_create()) != 0)
+    {
+      return res;
+    }
+  main_node_start();
 
   /* go */
   OUTPUT("\n");
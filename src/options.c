@@ -20,6 +20,7 @@
 #include "config.h"
 #include "options.h"
 #include "mgetopt.h"
+#include "batch.h"
 #include "revision.h"
 
 #define DEFAULT_VERBOSE            0
@@ -32,6 +33,8 @@
 #define DEFAULT_DO_TRACE           0
 #define DEFAULT_DO_ETRACE          0
 #define DEFAULT_DO_ETRACE_AT_BEGIN 0
+#define DEFAULT_DO_ENERGY          0
+#define DEFAULT_ENERGY_VOLTAGE     3000
 #define DEFAULT_WSENS_MODE         WS_MODE_WSNET0
 #define DEFAULT_SERVER_IP          "127.0.0.1"
 #define DEFAULT_SERVER_PORT        9998
@@ -39,6 +42,7 @@
 #define DEFAULT_MULTICAST_PORT     9999
 #define DEFAULT_NODE_ID            1
 #define DEFAULT_REALTIME           0
+#define DEFAULT_BATCH_OUT          "wsim-batch.csv"
 
 /* ************************************************** */
 /* ************************************************** */
@@ -108,11 +112,13 @@ static struct moption_t logpkt_opt = {
   .longname    = "logpkt",
   .type        = optional_argument,
   .helpstring  = "enable radio packets log and set options\n\
-\t\t\t\t--logpkt=[rx | tx | rxtx | pcap[:type] ]\n\
-\t\t\t\t\trx          : only RX are logged\n\
-\t\t\t\t\ttx          : only TX are logged\n\
-\t\t\t\t\trxtx        : both RX and TX are logged (by default)\n\
-\t\t\t\t\tpcap[:type] : pcap file format, optional Data Link Type identifier (default 802.15.4)\n",
+\t\t\t\t--logpkt=[rx | tx | rxtx | pcap[:type][:ns] | pcapng[:type][:ns] ]\n\
+\t\t\t\t\trx            : only RX are logged\n\
+\t\t\t\t\ttx            : only TX are logged\n\
+\t\t\t\t\trxtx          : both RX and TX are logged (by default)\n\
+\t\t\t\t\tpcap[:type]   : pcap file format, optional Data Link Type identifier (default 802.15.4)\n\
+\t\t\t\t\tpcapng[:type] : pcapng file format, one interface per radio with RX/TX direction\n\
+\t\t\t\t\t:ns           : nanosecond timestamps for pcap and pcapng\n",
   .value       = NULL
 };
 
@@ -120,7 +126,7 @@ static struct moption_t logpkt_opt = {
 static struct moption_t logpktfile_opt = {
   .longname    = "logpktfile",
   .type        = required_argument,
-  .helpstring  = "set radio packets logfile",
+  .helpstring  = "set radio packets logfile, a named pipe is streamed at each rendez-vous",
   .value       = NULL
 };
 
@@ -159,6 +165,13 @@ static struct moption_t etrace_start_opt = {
   .value       = NULL
 };
 
+static struct moption_t energy_opt = {
+  .longname    = "energy",
+  .type        = optional_argument,
+  .helpstring  = "enable energy accounting, optional supply voltage in V (default 3.0)",
+  .value       = NULL
+};
+
 /* monitor is used in machine.c */
 static struct moption_t mem_monitor_opt = {
   .longname    = "monitor",
@@ -246,6 +259,38 @@ static struct moption_t wsnet2_mode_opt = {
   .value       = NULL
 };
 
+#if defined(WSIM_MULTINODE)
+static struct moption_t multinode_opt = {
+  .longname    = "multinode",
+  .type        = required_argument,
+  .helpstring  = "run n nodes in this process",
+  .value       = NULL
+};
+#endif
+
+#if defined(WSIM_BATCH)
+static struct moption_t batch_opt = {
+  .longname    = "batch",
+  .type        = required_argument,
+  .helpstring  = "run the jobs of a batch file, jobs are forked from the loaded machine",
+  .value       = NULL
+};
+
+static struct moption_t batch_jobs_opt = {
+  .longname    = "batch-jobs",
+  .type        = required_argument,
+  .helpstring  = "number of batch jobs run in parallel (default online cpus)",
+  .value       = NULL
+};
+
+static struct moption_t batch_out_opt = {
+  .longname    = "batch-out",
+  .type        = required_argument,
+  .helpstring  = "batch summary, json for a .json file, csv otherwise (default " DEFAULT_BATCH_OUT ")",
+  .value       = NULL
+};
+#endif
+
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
@@ -288,6 +333,7 @@ void options_start()
   options_add_base(& etrace_opt         );
   options_add_base(& etrace_start_opt   );
 #endif
+  options_add_base(& energy_opt         );
 #if defined(ENABLE_RAM_CONTROL)
   options_add_base(& mem_monitor_opt    );
   options_add_base(& mem_modify_opt     );
@@ -300,6 +346,14 @@ void options_start()
   options_add_base(& multicast_port_opt );
   options_add_base(& wsnet1_mode_opt    );
   options_add_base(& wsnet2_mode_opt    );
+#if defined(WSIM_MULTINODE)
+  options_add_base(& multinode_opt      );
+#endif
+#if defined(WSIM_BATCH)
+  options_add_base(& batch_opt          );
+  options_add_base(& batch_jobs_opt     );
+  options_add_base(& batch_out_opt      );
+#endif
 }
 
 /* ************************************************** */
@@ -386,6 +440,16 @@ void options_print_params(struct options_t* s)
       OPT_PRINT("  realtime mode set\n");
     }
 
+  if (s->multinode)
+    {
+      OPT_PRINT("  multinode     : %d nodes\n",s->multinode);
+    }
+
+  if (s->do_batch)
+    {
+      OPT_PRINT("  batch file    : %s, %d jobs in parallel\n",s->batch,s->batch_jobs);
+    }
+
   if ((s->do_elfload == 1) && (stat(s->progname, &fs) == -1))
     {
       fprintf(stdout," ** Cannot stat elf file\n");
@@ -398,6 +462,108 @@ void options_print_params(struct options_t* s)
 /* ************************************************** */
 /* ************************************************** */
 
+void options_filename(char *dst, const char *src, const char *suffix)
+{
+  const char *slash;
+  const char *dot;
+
+  if ((strcmp(src,"stdout") == 0) || (strcmp(src,"stderr") == 0))
+    {
+      strncpyz(dst, src, MAX_FILENAME);
+      return;
+    }
+
+  slash = strrchr(src,'/');
+  dot   = strrchr(src,'.');
+  if ((dot == NULL) || ((slash != NULL) && (dot < slash)))
+    {
+      snprintf(dst, MAX_FILENAME, "%s-%s", src, suffix);
+    }
+  else
+    {
+      snprintf(dst, MAX_FILENAME, "%.*s-%s%s", (int)(dot - src), src, suffix, dot);
+    }
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static uint64_t options_mode_value(const char *arg, const char *suffix, const uint64_t *mul)
+{
+  const char *c;
+  if (arg[0] == '\0' || (c = strchr(suffix, arg[strlen(arg) - 1])) == NULL)
+    return atoll(arg);
+  return atoll(arg) * mul[c - suffix];
+}
+
+int options_mode_set(struct options_t *s, const char *mode, const char *arg)
+{
+  static const uint64_t insn_mul[] = { 1000, 1000 * 1000 };
+  static const uint64_t time_mul[] = { 1000 * 1000 * 1000, 1000 * 1000, 1000 };
+
+  if (mode == NULL)
+    {
+      /* argument of the current mode */
+    }
+  else if (strcmp(mode,"run") == 0)
+    {
+      OPT_DMSG(" run\n");
+      s->sim_mode = SIM_MODE_RUN;
+    }
+  else if (strcmp(mode,"gdb") == 0)
+    {
+      OPT_DMSG(" gdb\n");
+      s->sim_mode = SIM_MODE_GDB;
+    }
+  else if (strcmp(mode,"insn") == 0)
+    {
+      OPT_DMSG(" insn\n");
+      s->sim_mode = SIM_MODE_INSN;
+    }
+  else if (strcmp(mode,"time") == 0)
+    {
+      OPT_DMSG(" time\n");
+      s->sim_mode = SIM_MODE_TIME;
+    }
+  else if (strcmp(mode,"console") == 0)
+    {
+      OPT_DMSG(" cons\n");
+      s->sim_mode = SIM_MODE_CONS;
+    }
+  else
+    {
+      return -1;
+    }
+
+  if (arg == NULL)
+    {
+      return 0;
+    }
+
+  switch (s->sim_mode)
+    {
+    case SIM_MODE_GDB:
+      s->gdb_port = atoi(arg);
+      break;
+    case SIM_MODE_INSN: /* k, M */
+      s->sim_insn = options_mode_value(arg, "kM", insn_mul);
+      break;
+    case SIM_MODE_TIME: /* s, ms, us */
+      s->sim_time = options_mode_value(arg, "smu", time_mul);
+      break;
+    default:
+      if (mode == NULL)
+	return -1;
+      break;
+    }
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 void options_read_cmdline(struct options_t *s, int *argc, char *argv[])
 {
   int   parseindex = 1;
@@ -441,10 +607,16 @@ void options_read_cmdline(struct options_t *s, int *argc, char *argv[])
   s->do_preload         = 0;
   s->do_elfload         = 1;
   s->do_etrace_at_begin = DEFAULT_DO_ETRACE_AT_BEGIN;
+  s->do_energy          = DEFAULT_DO_ENERGY;
+  s->energy_voltage     = DEFAULT_ENERGY_VOLTAGE;
   s->wsens_mode         = DEFAULT_WSENS_MODE; 
   s->server_port        = DEFAULT_SERVER_PORT;
   s->multicast_port     = DEFAULT_MULTICAST_PORT;
   s->node_id            = DEFAULT_NODE_ID;
+  s->multinode          = 0;
+  s->do_batch           = 0;
+  s->batch_jobs         = 0;
+  strcpy (s->batch_out,   DEFAULT_BATCH_OUT);
 
   /* parse all options */
   switch (mgetopt_long(&parseindex,*argc,argv, &wsim_options, &optindex))
@@ -483,74 +655,8 @@ void options_read_cmdline(struct options_t *s, int *argc, char *argv[])
   /* mode */
   if (mode_opt.isset)
     {
-      char *optarg = modearg_opt.value;
       OPT_DMSG("mode set : ");
-
-      if (strcmp(mode_opt.value,"run") == 0)
-	{
-	  OPT_DMSG(" run\n");
-	  s->sim_mode = SIM_MODE_RUN;
-	}
-      else if (strcmp(mode_opt.value,"gdb") == 0)
-	{
-	  OPT_DMSG(" gdb\n");
-	  s->sim_mode = SIM_MODE_GDB;
-	  if (optarg)
-	    s->gdb_port = atoi(optarg);
-	}
-      else if (strcmp(mode_opt.value,"insn") == 0)
-	{
-	  OPT_DMSG(" insn\n");
-	  s->sim_mode  = SIM_MODE_INSN;
-	  if (optarg)
-	    {
-	      uint32_t mul = 1;
-	      switch (optarg[strlen(optarg) - 1])
-		{
-		case 'k':
-		  mul = 1000;
-		  break;
-		case 'M':
-		  mul = 1000 * 1000;
-		  break;
-		default:
-		  mul = 1;
-		  break;
-		}	    
-	      s->sim_insn = atoll(optarg) * mul;
-	    }
-	}
-      else if (strcmp(mode_opt.value,"time") == 0)
-	{
-	  OPT_DMSG(" time\n");
-	  s->sim_mode  = SIM_MODE_TIME;
-	  if (optarg)
-	    {
-	      uint32_t mul = 1;
-	      switch (optarg[strlen(optarg) - 1])
-		{
-		case 's':
-		  mul = 1000 * 1000 * 1000;
-		  break;
-		case 'm':
-		  mul = 1000 * 1000;
-		  break;
-		case 'u':
-		  mul = 1000;
-		  break;
-		default:
-		  mul = 1;
-		  break;
-		}
-	      s->sim_time  = atoll(optarg) * mul;
-	    }
-	}
-      else if (strcmp(mode_opt.value,"console") == 0)
-	{
-	  OPT_DMSG(" cons\n");
-	  s->sim_mode  = SIM_MODE_CONS;
-	}
-      else
+      if (options_mode_set(s, mode_opt.value, modearg_opt.value) != 0)
 	{
 	  OPT_ERROR("mode must be set to gdb|console|run|insn|time\n");
 	  exit( EXIT_FAILURE );
@@ -601,6 +707,20 @@ void options_read_cmdline(struct options_t *s, int *argc, char *argv[])
       s->do_etrace_at_begin = 1;
     }
 
+  if (energy_opt.isset)
+    {
+      s->do_energy = 1;
+      if (energy_opt.value)
+	{
+	  s->energy_voltage = (int)(atof(energy_opt.value) * 1000.0 + 0.5);
+	  if (s->energy_voltage <= 0)
+	    {
+	      OPT_ERROR("energy supply voltage must be > 0\n");
+	      exit( EXIT_FAILURE );
+	    }
+	}
+    }
+
   if (logpktfile_opt.isset)
     {
       s->do_logpkt = 1;
@@ -696,6 +816,76 @@ void options_read_cmdline(struct options_t *s, int *argc, char *argv[])
       s->realtime = 0;
     }
 
+#if defined(WSIM_MULTINODE)
+  if (multinode_opt.isset)
+    {
+      s->multinode = atoi(multinode_opt.value);
+      if (s->multinode < 1)
+	{
+	  OPT_ERROR("\n ** wrong multinode value %s ** \n\n",multinode_opt.value);
+	  exit( EXIT_FAILURE );
+	}
+      if (wsnet1_mode_opt.isset || wsnet2_mode_opt.isset)
+	{
+	  OPT_ERROR("\n ** multinode uses its own medium, wsnet modes cannot be used ** \n\n");
+	  exit( EXIT_FAILURE );
+	}
+      if ((s->sim_mode == SIM_MODE_GDB) || (s->sim_mode == SIM_MODE_CONS))
+	{
+	  OPT_ERROR("\n ** gdb and console modes cannot be used with multinode ** \n\n");
+	  exit( EXIT_FAILURE );
+	}
+      if (s->realtime)
+	{
+	  OPT_WARNING("\n ** realtime mode is disabled in multinode ** \n\n");
+	  s->realtime = 0;
+	}
+      s->wsens_mode = WS_MODE_LOCAL;
+    }
+#endif
+
+#if defined(WSIM_BATCH)
+  if (batch_opt.isset)
+    {
+      s->do_batch = 1;
+      strncpyz(s->batch,batch_opt.value,MAX_FILENAME);
+      if (s->wsens_mode != WS_MODE_WSNET0)
+	{
+	  OPT_ERROR("\n ** batch jobs are standalone nodes, wsnet and multinode modes cannot be used ** \n\n");
+	  exit( EXIT_FAILURE );
+	}
+      if ((s->sim_mode == SIM_MODE_GDB) || (s->sim_mode == SIM_MODE_CONS))
+	{
+	  OPT_ERROR("\n ** gdb and console modes cannot be used with batch ** \n\n");
+	  exit( EXIT_FAILURE );
+	}
+      if (s->do_trace || s->do_etrace || s->do_logpkt)
+	{
+	  /* writer threads do not survive fork */
+	  OPT_ERROR("\n ** trace, esimu and logpkt cannot be used with batch ** \n\n");
+	  exit( EXIT_FAILURE );
+	}
+      s->batch_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+      if (s->batch_jobs < 1)
+	s->batch_jobs = 1;
+    }
+
+  if (batch_jobs_opt.isset)
+    {
+      s->batch_jobs = atoi(batch_jobs_opt.value);
+      if (s->batch_jobs < 1)
+	{
+	  OPT_ERROR("\n ** wrong batch-jobs value %s ** \n\n",batch_jobs_opt.value);
+	  exit( EXIT_FAILURE );
+	}
+    }
+
+  if (batch_out_opt.isset)
+    {
+      strncpyz(s->batch_out,batch_out_opt.value,MAX_FILENAME);
+    }
+#endif
+
   OPT_DMSG("parseindex = %d, argc = %d\n",parseindex,*argc);
   if (parseindex < *argc)
     {
@@ -22,9 +22,13 @@ enum sim_mode_t {
 enum wsens_mode_t {
   WS_MODE_WSNET0 = 0,
   WS_MODE_WSNET1 = 1,
-  WS_MODE_WSNET2 = 2
+  WS_MODE_WSNET2 = 2,
+  WS_MODE_LOCAL  = 3   /* in-process medium, multinode builds */
 };
 
+/* wsnet1/2 servers roll nodes back to the last rendez-vous point */
+#define WS_MODE_BACKTRACK(m) (((m) == WS_MODE_WSNET1) || ((m) == WS_MODE_WSNET2))
+
 #include "mgetopt.h"
 
 #define MAX_FILENAME  256
@@ -49,6 +53,8 @@ struct options_t {
   int                do_preload;
   int                do_elfload;
   int                do_etrace_at_begin;
+  int                do_energy;
+  int                energy_voltage; /* mV */
 
   int                do_logpkt;
   char              *logpkt;
@@ -73,6 +79,12 @@ struct options_t {
   uint64_t           sim_insn;
   uint64_t           sim_time;
   int                realtime;
+  int                multinode;   /* number of nodes in this process, 0 = single node */
+
+  int                do_batch;
+  char               batch       [MAX_FILENAME];
+  int                batch_jobs;  /* parallel jobs */
+  char               batch_out   [MAX_FILENAME];
 };
 
 
@@ -80,6 +92,10 @@ void options_start         ();
 void options_add           (struct moption_t *o);
 
 void options_read_cmdline  (struct options_t* s, int *argc, char *argv[]);
+/* mode NULL sets the argument of the current mode, returns -1 on error */
+int  options_mode_set      (struct options_t *s, const char *mode, const char *arg);
+/* file.ext becomes file-suffix.ext, stdout and stderr are kept */
+void options_filename      (char *dst, const char *src, const char *suffix);
 void options_print_params  (struct options_t *s);
 
 #endif
@@ -15,6 +15,8 @@
 /**************************************************************************/
 extern	int g_seed;
 extern	char g_config_repository [256];
+extern	char g_topology [256];
+extern	int g_max_nodes;
 
 
 /**************************************************************************/
@@ -37,6 +37,11 @@ extern uint64_t g_simend;
 /****************************/
 /****************************/
 /****************************/
+#define EVENT_HEAP_TIME      0   /* event queue, time order            */
+#define EVENT_HEAP_TX_FIRST  1   /* tx events, earliest tx_start first */
+#define EVENT_HEAP_TX_LAST   2   /* tx events, latest tx_start first   */
+#define EVENT_HEAP_NUM       3
+
 struct _event {
 
   char type;
@@ -48,17 +53,14 @@ struct _event {
   void * arg;
 	
   struct _packet * packet;
+
+  uint64_t seq;                    /* insertion order               */
+  int heap_pos[EVENT_HEAP_NUM];    /* position in each event heap   */
 	
-  struct _event *	 next;
+  struct _event *	 next;     /* free list                     */
 };
 
 
-/****************************/
-/****************************/
-/****************************/
-extern struct _event *g_events;
-
-
 /****************************/
 /****************************/
 /****************************/
@@ -0,0 +1,55 @@
+/*
+ *  medium_private.h
+ *
+ *
+ *  Radio medium: path loss, interference and SiNR per receiver.
+ *  Copyright 2011 __WorldSens__. All rights reserved.
+ *
+ */
+#ifndef _MEDIUM_PRIVATE_H
+#define _MEDIUM_PRIVATE_H
+
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+#include "public/types.h"
+#include "worldsens.h"
+
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+/*
+ * Without a topology file the medium is perfect: every active node
+ * receives every byte at the tx power with a 0 SiNR.
+ *
+ * The topology file gives node positions and the medium parameters,
+ * one item per line:
+ *
+ *   pathloss  <exponent> <reference distance m> <loss at reference dB>
+ *   shadowing <sigma dB>
+ *   noise     <dBm>
+ *   cutoff    <dBm>            receivers below are not sent the byte
+ *   node      <addr> <x> <y> <z>
+ *
+ * Nodes that are not listed are placed at random in the field. Link
+ * gains, log-distance path loss and log-normal shadowing drawn once per
+ * link, are precomputed in a node x node matrix. The SiNR of a byte is
+ * the received power over the noise and the power of all the other
+ * packets on the same channel that overlap it in time.
+ */
+extern int g_medium;
+
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+int  medium_init  (const char *topology);
+void medium_clean (void);
+
+/* fills data with the receivers of the packet byte, returns their number */
+int  medium_rx    (struct _packet *packet, struct _worldsens_data *data);
+
+
+#endif //_MEDIUM_PRIVATE_H
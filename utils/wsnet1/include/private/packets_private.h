@@ -22,6 +22,7 @@ extern struct _packet *  g_packets;
 /****************************/
 void packet_destroy (struct _packet * packet);
 struct _packet * packet_duplicate (struct _packet * packet);
+void packet_pool_clean (void);
 
 
 #endif //_PACKETS_H
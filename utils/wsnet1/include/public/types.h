@@ -141,7 +141,9 @@ struct _packet {
   double * SiNR;
   double rx_mW;
 
-  struct _packet * next;
+  struct _packet * next;        /* "in the air tonight" list */
+  struct _packet * prev;
+  struct _packet * rx_next;     /* delivered packets, tx_end order */
 };
 
 
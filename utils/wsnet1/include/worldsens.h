@@ -51,6 +51,12 @@
 /* One rp per second */
 extern  uint32_t WORLDSENS_SYNCH_PERIOD;
 
+/* Lower bound of the adaptive rp period */
+extern  uint32_t WORLDSENS_SYNCH_MIN_PERIOD;
+
+/* Clean rp before the period is doubled */
+#define WORLDSENS_SYNCH_CLEAN		4
+
 /* Client update frequency */
 #define WORLDSENS_UPDATE_PERIOD		1000000
 
@@ -130,8 +136,9 @@ struct PACKED _worldsens_c_disconnect_pkt
 
 struct PACKED _worldsens_c_synched_pkt 
 {
-  char type;
-  int  rp_seq;
+  char     type;
+  int      rp_seq;
+  uint64_t lookahead;   /* ns, absent from old clients */
 };
 
 
@@ -258,6 +265,12 @@ struct _worldsens_s
   uint64_t	     rp;           /* Rendez-vous point :: nanosecond           */
   int		     rp_seq;       /* Rendez-vous point :: index                */
   char		     synched;      /* number of synchronizes nodes on a barrier */
+  uint64_t	     period;       /* adaptive rp period :: nanosecond          */
+  int		     clean;        /* rp without backtrack since last change    */
+  uint64_t	     la_min;       /* min lookahead of the synched nodes        */
+  uint64_t	     lookahead;    /* no node sends a byte before :: nanosecond */
+  int		     rp_count;     /* stats                                     */
+  int		     backtracks;   /* stats                                     */
   tracer_id_t        trc_mcast_rx; /*                                           */
   tracer_id_t        trc_mcast_tx; /*                                           */
 };
@@ -314,14 +327,16 @@ int worldsens_s_disconnect              (struct _worldsens_s *worldsens,
 int worldsens_s_clean                   (struct _worldsens_s *worldsens);
 
 int worldsens_s_listen_to_next_rp       (struct _worldsens_s *worldsens);
+uint64_t worldsens_s_period             (struct _worldsens_s *worldsens, uint64_t period);
 int worldsens_s_backtrack_async         (struct _worldsens_s *worldsens, uint64_t period);
 int worldsens_s_save_release_request    (struct _worldsens_s *worldsens, uint64_t period);
 int worldsens_s_save_release_request_rx	(struct _worldsens_s *worldsens, int node,  
 					 int radio, int modulation,  
-					 struct _worldsens_data *data, uint64_t period);
+					 struct _worldsens_data *data, int count,
+					 uint64_t period);
 int worldsens_s_rx                      (struct _worldsens_s *worldsens, int node,
 					 int radio,  int modulation, 
-					 struct _worldsens_data *data);
+					 struct _worldsens_data *data, int count);
 
 /**************************************************************************/
 /**************************************************************************/
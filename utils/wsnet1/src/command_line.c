@@ -17,13 +17,15 @@
 /**************************************************************************/
 int g_seed = -1;
 char g_config_repository[256];
+char g_topology[256];
+int g_max_nodes = 0;
 
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 void usage(void) {
-  fprintf(stderr, "Usage: simulation [-S seed] [-l logfile] [-p local_port] [-P multicast_port] [-m multicast_addr] [-D synchro_period]\n");
+  fprintf(stderr, "Usage: simulation [-S seed] [-l logfile] [-p local_port] [-P multicast_port] [-m multicast_addr] [-D synchro_period] [-A min_synchro_period] [-N max_nodes] [-T topology_file]\n");
   return;
 }
 
@@ -34,7 +36,7 @@ void usage(void) {
 int command_line(int argc, char *argv[]) {
   int c;
 	
-  while ((c = getopt(argc, argv, "p:P:m:S:l:D:F:")) != -1) {
+  while ((c = getopt(argc, argv, "p:P:m:S:l:D:A:F:N:T:")) != -1) {
     switch (c) {
     case 'p': 
       g_lport = atoi(optarg);
@@ -51,8 +53,21 @@ int command_line(int argc, char *argv[]) {
     case 'D':
       WORLDSENS_SYNCH_PERIOD = atoi(optarg);
       break;
+    case 'A':
+      if (atoi(optarg) <= 0) {
+	usage();
+	return -1;
+      }
+      WORLDSENS_SYNCH_MIN_PERIOD = atoi(optarg);
+      break;
     case 'F':       /* Deprecated option: here to avoid errors */
       break;
+    case 'N':
+      g_max_nodes = atoi(optarg);
+      break;
+    case 'T':
+      strncpy(g_topology, optarg, sizeof(g_topology) - 1);
+      break;
     case 'l':
       if (init_log_sys(optarg)) {
 	usage();
@@ -12,6 +12,7 @@
 #include "private/nodes_private.h"
 #include "private/packets_private.h"
 #include "private/core_private.h"
+#include "private/medium_private.h"
 
 #include "public/log.h"
 #include "worldsens.h"
@@ -20,35 +21,162 @@
 /**************************************************************************/
 /**************************************************************************/
 
-struct _event *g_events = NULL;
-int g_events_card = 0;
+/*
+ * Events are kept in indexed binary heaps. EVENT_HEAP_TIME is the event
+ * queue, EVENT_HEAP_TX_FIRST and EVENT_HEAP_TX_LAST order pending tx
+ * events on their tx_start to update the "in the air" packet list and to
+ * cut the queue on backtrack. Each event records its position in every
+ * heap so that any event is removed in O(log n).
+ */
+struct _event_heap {
+  struct _event **elt;
+  int card;
+  int size;
+  int id;
+  int (*before) (struct _event *a, struct _event *b);
+};
+
+static int event_time_before     (struct _event *a, struct _event *b);
+static int event_tx_first_before (struct _event *a, struct _event *b);
+static int event_tx_last_before  (struct _event *a, struct _event *b);
+
+static struct _event_heap g_events[EVENT_HEAP_NUM] = {
+  { NULL, 0, 0, EVENT_HEAP_TIME,     event_time_before     },
+  { NULL, 0, 0, EVENT_HEAP_TX_FIRST, event_tx_first_before },
+  { NULL, 0, 0, EVENT_HEAP_TX_LAST,  event_tx_last_before  },
+};
+
+static uint64_t g_events_seq = 0;
+
+/* delivered packets still in the air, in tx_end order */
+static struct _packet *g_rx_head = NULL;
+static struct _packet *g_rx_tail = NULL;
+
 
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 
-void
-core_runtime_end (void)
+/* 
+ * We want callback events to be called after packet events (for protocol
+ * timeouts). At equal time the last added packet comes first and callbacks
+ * are called in insertion order.
+ */
+static int
+event_time_before (struct _event *a, struct _event *b)
 {
-  struct _packet *packet;
-  struct _event *event;
+  if (a->time != b->time)
+    return a->time < b->time;
+  if (a->type != b->type)
+    return a->type == TX_EVENT_TYPE;
+  if (a->type == TX_EVENT_TYPE)
+    return a->seq > b->seq;
+  return a->seq < b->seq;
+}
 
-  while (g_events)
+static int
+event_tx_first_before (struct _event *a, struct _event *b)
+{
+  return a->packet->tx_start < b->packet->tx_start;
+}
+
+static int
+event_tx_last_before (struct _event *a, struct _event *b)
+{
+  return a->packet->tx_start > b->packet->tx_start;
+}
+
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static inline void
+heap_set (struct _event_heap *heap, int i, struct _event *event)
+{
+  heap->elt[i] = event;
+  event->heap_pos[heap->id] = i;
+}
+
+static void
+heap_up (struct _event_heap *heap, int i)
+{
+  struct _event *event = heap->elt[i];
+
+  while (i > 0)
     {
-      event = g_events;
-      g_events = g_events->next;
-      free (event);
+      int parent = (i - 1) / 2;
+      if (!heap->before (event, heap->elt[parent]))
+	break;
+      heap_set (heap, i, heap->elt[parent]);
+      i = parent;
     }
+  heap_set (heap, i, event);
+}
 
-  while (g_packets)
+static void
+heap_down (struct _event_heap *heap, int i)
+{
+  struct _event *event = heap->elt[i];
+
+  while (1)
     {
-      packet = g_packets;
-      g_packets = g_packets->next;
-      packet_destroy (packet);
+      int child = 2 * i + 1;
+      if (child >= heap->card)
+	break;
+      if ((child + 1 < heap->card)
+	  && heap->before (heap->elt[child + 1], heap->elt[child]))
+	child++;
+      if (!heap->before (heap->elt[child], event))
+	break;
+      heap_set (heap, i, heap->elt[child]);
+      i = child;
     }
+  heap_set (heap, i, event);
+}
 
-  free (g_nodes);
-  return;
+static int
+heap_insert (struct _event_heap *heap, struct _event *event)
+{
+  if (heap->card == heap->size)
+    {
+      int size = heap->size ? 2 * heap->size : 256;
+      struct _event **elt;
+
+      if ((elt = (struct _event **) realloc (heap->elt, size * sizeof (struct _event *))) == NULL)
+	{
+	  fprintf (stderr, "\nEXCEPTION: MALLOC ERROC\n");
+	  return -1;
+	}
+      heap->elt  = elt;
+      heap->size = size;
+    }
+
+  heap_set (heap, heap->card++, event);
+  heap_up (heap, heap->card - 1);
+  return 0;
+}
+
+static void
+heap_remove (struct _event_heap *heap, struct _event *event)
+{
+  int i = event->heap_pos[heap->id];
+  struct _event *last = heap->elt[--heap->card];
+
+  if (last == event)
+    return;
+
+  heap_set (heap, i, last);
+  if ((i > 0) && heap->before (last, heap->elt[(i - 1) / 2]))
+    heap_up (heap, i);
+  else
+    heap_down (heap, i);
+}
+
+static inline struct _event *
+heap_top (struct _event_heap *heap)
+{
+  return heap->card ? heap->elt[0] : NULL;
 }
 
 
@@ -56,61 +184,124 @@ core_runtime_end (void)
 /**************************************************************************/
 /**************************************************************************/
 
-#if (BIG_ENDIAN == BYTE_ORDER)
-static uint64_t
-htonll (uint64_t v)
+/* event pool, events are allocated by chunks and never freed before exit */
+#define EVENT_POOL_CHUNK 256
+
+struct _event_chunk {
+  struct _event_chunk *next;
+  struct _event events[EVENT_POOL_CHUNK];
+};
+
+static struct _event_chunk *g_event_chunks = NULL;
+static struct _event *g_event_pool = NULL;
+
+static struct _event *
+event_alloc (void)
 {
-  return v;
+  struct _event *event;
+
+  if (g_event_pool == NULL)
+    {
+      struct _event_chunk *chunk;
+      int i;
+
+      if ((chunk = (struct _event_chunk *) malloc (sizeof (struct _event_chunk))) == NULL)
+	{
+	  fprintf (stderr, "\nEXCEPTION: MALLOC ERROC\n");
+	  return NULL;
+	}
+      chunk->next = g_event_chunks;
+      g_event_chunks = chunk;
+      for (i = 0; i < EVENT_POOL_CHUNK; i++)
+	{
+	  chunk->events[i].next = g_event_pool;
+	  g_event_pool = &chunk->events[i];
+	}
+    }
+
+  event = g_event_pool;
+  g_event_pool = event->next;
+  memset (event, 0, sizeof (struct _event));
+  event->seq = g_events_seq++;
+  return event;
+}
+
+static void
+event_free (struct _event *event)
+{
+  event->next = g_event_pool;
+  g_event_pool = event;
 }
 
-/* static */ double
-htondbl (double v)
+/* remove event from the queue, the event is not freed */
+static void
+event_remove (struct _event *event)
 {
-  return v;
+  heap_remove (&g_events[EVENT_HEAP_TIME], event);
+  if (event->type == TX_EVENT_TYPE)
+    {
+      heap_remove (&g_events[EVENT_HEAP_TX_FIRST], event);
+      heap_remove (&g_events[EVENT_HEAP_TX_LAST], event);
+    }
 }
 
-#else
-static uint64_t
-htonll (uint64_t v)
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static void
+packet_air_unlink (struct _packet *packet)
 {
-  uint64_t r;
-  uint8_t *pv, *pr;
-
-  pv = (uint8_t *) & v;
-  pr = (uint8_t *) & r;
-
-  pr[0] = pv[7];
-  pr[1] = pv[6];
-  pr[2] = pv[5];
-  pr[3] = pv[4];
-  pr[4] = pv[3];
-  pr[5] = pv[2];
-  pr[6] = pv[1];
-  pr[7] = pv[0];
-
-  return r;
+  if (packet->prev)
+    packet->prev->next = packet->next;
+  else
+    g_packets = packet->next;
+  if (packet->next)
+    packet->next->prev = packet->prev;
 }
 
-/* static */ double
-htondbl (double v)
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+void
+core_runtime_end (void)
 {
-  double r;
-  uint8_t *pv, *pr;
-
-  pv = (uint8_t *) & v;
-  pr = (uint8_t *) & r;
-
-  pr[0] = pv[7];
-  pr[1] = pv[6];
-  pr[2] = pv[5];
-  pr[3] = pv[4];
-  pr[4] = pv[3];
-  pr[5] = pv[2];
-  pr[6] = pv[1];
-  pr[7] = pv[0];
-  return r;
+  struct _packet *packet;
+  int i;
+
+  while (g_packets)
+    {
+      packet = g_packets;
+      g_packets = g_packets->next;
+      packet_destroy (packet);
+    }
+  g_rx_head = g_rx_tail = NULL;
+  packet_pool_clean ();
+
+  for (i = 0; i < EVENT_HEAP_NUM; i++)
+    {
+      free (g_events[i].elt);
+      g_events[i].elt  = NULL;
+      g_events[i].card = 0;
+      g_events[i].size = 0;
+    }
+
+  while (g_event_chunks)
+    {
+      struct _event_chunk *chunk = g_event_chunks;
+      g_event_chunks = chunk->next;
+      free (chunk);
+    }
+  g_event_pool = NULL;
+
+  medium_clean ();
+  free (g_nodes);
+  return;
 }
-#endif
+
 
 /**************************************************************************/
 /**************************************************************************/
@@ -120,38 +311,41 @@ int
 core_start (struct _worldsens_s *worldsens)
 {
   static int evt_nb = 0;
+  struct _event_heap *queue = &g_events[EVENT_HEAP_TIME];
 
   simulation_keeps_going = 1;
 
   while (simulation_keeps_going == 1)
     {
+      struct _event *next = heap_top (queue);
 
       /* If no event or if event in the future, wait at rp point */
-      if ((g_events == NULL) || (g_events->time > get_global_time()))
+      if ((next == NULL) || (next->time > get_global_time()))
 	{
 	  if (worldsens_s_listen_to_next_rp (worldsens) < 0)
 	    {
 	      return -1;
 	    }
+	  next = heap_top (queue);
 	}
 
-      if (g_events == NULL)
+      if (next == NULL)
 	{
 	  /* If no event, program rp point */
 	  if (worldsens_s_save_release_request
-	      (worldsens, WORLDSENS_SYNCH_PERIOD))
+	      (worldsens, worldsens_s_period (worldsens, worldsens->period)))
 	    return -1;
 	}
-      else if (get_global_time() < g_events->time)
+      else if (get_global_time() < next->time)
 	{
 	  /* If event, program event */
 	  if (worldsens_s_save_release_request
-	      (worldsens, g_events->time - get_global_time()))
+	      (worldsens, next->time - get_global_time()))
 	    return -1;
 	}
       else
 	{
-	  struct _event *event = g_events;
+	  struct _event *event = next;
 
 	  /* And time goes on... */
 	  if (get_global_time() != event->time)
@@ -167,57 +361,47 @@ core_start (struct _worldsens_s *worldsens)
 	    {
 	      struct _packet *packet = event->packet;
 	      struct _worldsens_data worldsens_data[g_c_nodes];
-	      int i = g_m_nodes;
-	      int c_node = 0;
+	      int c_node;
 
 	      /* Remove event */
-	      g_events = event->next;
-	      g_events_card--;
-	      free (event);
-
-	      while (i--)
-		{
-		  if (g_nodes[i].active)
-		    {
-		      struct _packet *rx_pkt = packet_duplicate (packet);
+	      event_remove (event);
+	      event_free (event);
 
-		      /* Update receiving node mobility */
-		      //mobility_update (&g_nodes[i]);
-
-		      /* Compute packet BER/SiNR */
-		      //propagation_compute_BER (&g_nodes[i], rx_pkt);
-
-		      /* Record reception and destroy packet */
-		      uint64_t *tx_mW = (uint64_t *) &(rx_pkt->tx_mW);  /* put double into uint64_t variable for swap */
-		      worldsens_data[c_node].node  = htonl (i);
-		      worldsens_data[c_node].data  = packet->data[0];
-		      worldsens_data[c_node].SiNR  = htonll (0.0);     /* perfect radio layer: no noise */
-		      worldsens_data[c_node].rx_mW = htonll (*tx_mW);  /* perfect radio layer: no energy dissipation... */
-		      packet_destroy (rx_pkt);	//TODO: optimize.... no need to creat and destroy packet...
+	      /* Packet is delivered, it stays in the air until tx_end */
+	      packet->rx_next = NULL;
+	      if (g_rx_tail)
+		g_rx_tail->rx_next = packet;
+	      else
+		g_rx_head = packet;
+	      g_rx_tail = packet;
 
-		      /* Update considered node */
-		      c_node++;
-		    }
-		}
+	      /* Record reception: rx power and SiNR of each receiver */
+	      c_node = medium_rx (packet, worldsens_data);
 
-	      if (g_events == NULL)
+	      next = heap_top (queue);
+	      if (next == NULL)
 		{
-		  /* If no more event, backup and program rp point */
+		  /* If no more event, backup and program rp point. A
+		   * reception is often answered soon (ack), the rp is at
+		   * most MAGIC_VALUE ns away to avoid backtracks and the
+		   * adaptive period still shortens it after backtracks */
 #define MAGIC_VALUE 31250
+		  uint64_t period = (worldsens->period < MAGIC_VALUE) ? worldsens->period : MAGIC_VALUE;
 		  if (worldsens_s_save_release_request_rx (worldsens, packet->node->addr, 
 							   packet->freq, packet->modulation, 
-							   worldsens_data, MAGIC_VALUE))	// ToCheck: optimization to avoir backtracks
+							   worldsens_data, c_node, 
+							   worldsens_s_period (worldsens, period)))
 		    return -1;
 		}
 	      else
 		{
 		  /* If future event, backup and program event */
-		  if (g_events->time > get_global_time())
+		  if (next->time > get_global_time())
 		    {
 		      if (worldsens_s_save_release_request_rx
 			  (worldsens, packet->node->addr, packet->freq,
-			   packet->modulation, worldsens_data,
-			   g_events->time - get_global_time()))
+			   packet->modulation, worldsens_data, c_node,
+			   next->time - get_global_time()))
 			return -1;
 		    }
 		  else
@@ -225,7 +409,7 @@ core_start (struct _worldsens_s *worldsens)
 		      /* If simultaneous events, do nothing */
 		      if (worldsens_s_rx (worldsens, packet->node->addr,
 					  packet->freq, packet->modulation,
-					  worldsens_data))
+					  worldsens_data, c_node))
 			return -1;
 		    }
 		}
@@ -236,6 +420,16 @@ core_start (struct _worldsens_s *worldsens)
 		  return -1;
 		}
 	    }
+	  else
+	    {
+	      /* Remove event and call back */
+	      event_remove (event);
+	      if (event->callback)
+		{
+		  event->callback (event->arg);
+		}
+	      event_free (event);
+	    }
 	}
     }				/* while */
 
@@ -250,12 +444,9 @@ int
 core_add_schedule (void (*callback) (void *), void *arg, uint64_t time)
 {
   struct _event *event;
-  struct _event *loop = NULL;
-  struct _event *tmp = NULL;
 
-  if ((event = (struct _event *) malloc (sizeof (struct _event))) == NULL)
+  if ((event = event_alloc ()) == NULL)
     {
-      fprintf (stderr, "\nEXCEPTION: MALLOC ERROC\n");
       return -1;
     }
 
@@ -264,40 +455,11 @@ core_add_schedule (void (*callback) (void *), void *arg, uint64_t time)
   event->callback = callback;
   event->arg = arg;
 
-  if (g_events == NULL)
-    {
-      g_events = event;
-      event->next = NULL;
-    }
-  else
+  if (heap_insert (&g_events[EVENT_HEAP_TIME], event))
     {
-      loop = g_events;
-
-      /* We want callback events to be called after packet events (for protocol timeouts) */
-      while ((loop != NULL) && (loop->time <= event->time))
-	{
-	  tmp = loop;
-	  loop = loop->next;
-	}
-
-      if (loop == NULL)
-	{
-	  tmp->next = event;
-	  event->next = NULL;
-	}
-      else if (tmp == NULL)
-	{
-	  g_events = event;
-	  event->next = loop;
-	}
-      else
-	{
-	  tmp->next = event;
-	  event->next = loop;
-	}
+      event_free (event);
+      return -1;
     }
-
-  g_events_card++;
   return 0;
 }
 
@@ -310,14 +472,9 @@ int
 core_add_packet (struct _packet *packet)
 {
   struct _event *event;
-  struct _event *loop = NULL;
-  struct _event *tmp = NULL;
-  struct _packet *p_loop = NULL;
-  struct _packet *p_tmp = NULL;
 
-  if ((event = (struct _event *) malloc (sizeof (struct _event))) == NULL)
+  if ((event = event_alloc ()) == NULL)
     {
-      fprintf (stderr, "\nEXCEPTION: MALLOC ERROC\n");
       return -1;
     }
 
@@ -326,71 +483,31 @@ core_add_packet (struct _packet *packet)
   event->time = packet->tx_end;
   event->packet = packet;
 
-  if (g_events == NULL)
+  if (heap_insert (&g_events[EVENT_HEAP_TIME], event))
     {
-      g_events = event;
-      event->next = NULL;
+      event_free (event);
+      return -1;
     }
-  else
+  if (heap_insert (&g_events[EVENT_HEAP_TX_FIRST], event))
     {
-      loop = g_events;
-
-      /* We want callback events to be called after packet events (for protocol timeouts) */
-      while ((loop != NULL) && (loop->time < event->time))
-	{
-	  tmp = loop;
-	  loop = loop->next;
-	}
-
-      if (loop == NULL)
-	{
-	  tmp->next = event;
-	  event->next = NULL;
-	}
-      else if (tmp == NULL)
-	{
-	  g_events = event;
-	  event->next = loop;
-	}
-      else
-	{
-	  tmp->next = event;
-	  event->next = loop;
-	}
+      heap_remove (&g_events[EVENT_HEAP_TIME], event);
+      event_free (event);
+      return -1;
     }
-
-  /* Update "in the air tonight" packet list */
-  if (g_packets == NULL)
+  if (heap_insert (&g_events[EVENT_HEAP_TX_LAST], event))
     {
-      g_packets = packet;
-      packet->next = NULL;
+      heap_remove (&g_events[EVENT_HEAP_TX_FIRST], event);
+      heap_remove (&g_events[EVENT_HEAP_TIME], event);
+      event_free (event);
+      return -1;
     }
-  else
-    {
-      p_loop = g_packets;
-
-      while ((p_loop != NULL) && (p_loop->tx_end < packet->tx_end))
-	{
-	  p_tmp = p_loop;
-	  p_loop = p_loop->next;
-	}
 
-      if (p_loop == NULL)
-	{
-	  p_tmp->next = packet;
-	  packet->next = NULL;
-	}
-      else if (p_tmp == NULL)
-	{
-	  g_packets = packet;
-	  packet->next = p_loop;
-	}
-      else
-	{
-	  p_tmp->next = packet;
-	  packet->next = p_loop;
-	}
-    }
+  /* Update "in the air tonight" packet list */
+  packet->prev = NULL;
+  packet->next = g_packets;
+  if (g_packets)
+    g_packets->prev = packet;
+  g_packets = packet;
 
   return 0;
 }
@@ -403,46 +520,28 @@ core_add_packet (struct _packet *packet)
 int
 core_update_packet_list (void)
 {
-  struct _packet *p_loop = g_packets;
-  struct _packet *p_tmp = NULL;
-  struct _event *event = g_events;
+  struct _event *event = heap_top (&g_events[EVENT_HEAP_TX_FIRST]);
   uint64_t tx_start;
 
   /* Get date of first "in the air tonight" packet */
   tx_start = get_global_time();
-  while (event)
+  if (event && (event->packet->tx_start < tx_start))
     {
-      if ((event->type == TX_EVENT_TYPE)
-	  && (event->packet->tx_start < tx_start))
-	{
-	  tx_start = event->packet->tx_start;
-	}
-      event = event->next;
+      tx_start = event->packet->tx_start;
     }
 
-  /* Remove anterior packets */
-  while (p_loop != NULL)
+  /* 
+   * Remove anterior packets. Pending packets end after the current time,
+   * only delivered packets can be removed and they are ordered by tx_end 
+   */
+  while (g_rx_head && (g_rx_head->tx_end <= tx_start))
     {
-      if (p_loop->tx_end <= tx_start)
-	{
-	  if (p_tmp != NULL)
-	    {
-	      p_tmp->next = p_loop->next;
-	      packet_destroy (p_loop);
-	      p_loop = p_tmp->next;
-	    }
-	  else
-	    {
-	      g_packets = p_loop->next;
-	      packet_destroy (p_loop);
-	      p_loop = g_packets;
-	    }
-	}
-      else
-	{
-	  p_tmp = p_loop;
-	  p_loop = p_loop->next;
-	}
+      struct _packet *packet = g_rx_head;
+      g_rx_head = packet->rx_next;
+      if (g_rx_head == NULL)
+	g_rx_tail = NULL;
+      packet_air_unlink (packet);
+      packet_destroy (packet);
     }
 
   return 0;
@@ -455,57 +554,19 @@ core_update_packet_list (void)
 int
 core_backtrack (uint64_t time)
 {
-  struct _packet *p_loop = g_packets;
-  struct _packet *p_tmp = NULL;
-  struct _event *e_loop = g_events;
-  struct _event *e_tmp = NULL;
-
-  while (e_loop != NULL)
-    {
-      if (e_loop->packet->tx_start > time)
-	{
-	  if (e_tmp != NULL)
-	    {
-	      e_tmp->next = e_loop->next;
-	      free (e_loop);
-	      e_loop = e_tmp->next;
-	    }
-	  else
-	    {
-	      g_events = e_loop->next;
-	      free (e_loop);
-	      e_loop = g_events;
-	    }
-	}
-      else
-	{
-	  e_tmp = e_loop;
-	  e_loop = e_loop->next;
-	}
-    }
+  struct _event_heap *last = &g_events[EVENT_HEAP_TX_LAST];
+  struct _event *event;
 
-  while (p_loop != NULL)
+  /* 
+   * Cut pending transmissions that start after time. The backtrack time
+   * is at least the current time, delivered packets are kept.
+   */
+  while (((event = heap_top (last)) != NULL) && (event->packet->tx_start > time))
     {
-      if (p_loop->tx_start > time)
-	{
-	  if (p_tmp != NULL)
-	    {
-	      p_tmp->next = p_loop->next;
-	      packet_destroy (p_loop);
-	      p_loop = p_tmp->next;
-	    }
-	  else
-	    {
-	      g_packets = p_loop->next;
-	      packet_destroy (p_loop);
-	      p_loop = g_packets;
-	    }
-	}
-      else
-	{
-	  p_tmp = p_loop;
-	  p_loop = p_loop->next;
-	}
+      event_remove (event);
+      packet_air_unlink (event->packet);
+      packet_destroy (event->packet);
+      event_free (event);
     }
 
   return 0;
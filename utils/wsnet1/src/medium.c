@@ -0,0 +1,400 @@
+/*
+ *  medium.c
+ *
+ *
+ *  Radio medium: path loss, interference and SiNR per receiver.
+ *  Copyright 2011 __WorldSens__. All rights reserved.
+ *
+ */
+#include "private/medium_private.h"
+#include "private/simulation_private.h"
+#include "private/nodes_private.h"
+#include "private/packets_private.h"
+
+#include "public/simulation.h"
+#include "public/types.h"
+
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+#define MEDIUM_DEFAULT_EXPONENT   2.0      /* free space                   */
+#define MEDIUM_DEFAULT_D0         1.0      /* m                            */
+#define MEDIUM_DEFAULT_PL0        40.0     /* dB at 1m, 2.4GHz free space  */
+#define MEDIUM_DEFAULT_SHADOWING  0.0      /* dB                           */
+#define MEDIUM_DEFAULT_NOISE      -105.0   /* dBm                          */
+#define MEDIUM_DEFAULT_CUTOFF     -110.0   /* dBm                          */
+
+#define MEDIUM_CHANNEL_WIDTH      1000000  /* Hz, same channel below       */
+#define MEDIUM_LINE_MAX           256
+
+/*
+ * Receivers are processed 4 at a time with the gcc vector extension,
+ * gain rows are padded and aligned on the vector size.
+ */
+#define MEDIUM_VEC                4
+typedef float medium_vec_t __attribute__ ((vector_size (MEDIUM_VEC * sizeof (float))));
+
+int g_medium = 0;
+
+static struct {
+  double exponent;
+  double d0;
+  double pl0;
+  double shadowing;
+  double noise_mW;
+  double cutoff_mW;
+
+  int    stride;          /* row length, multiple of MEDIUM_VEC            */
+  void  *block;           /* allocated memory                              */
+  float *gain;            /* gain[tx * stride + rx], linear                */
+  float *signal;          /* current byte, per receiver, mW                */
+  float *interf;          /* noise and interferences, per receiver, mW     */
+} medium;
+
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+#if (BIG_ENDIAN == BYTE_ORDER)
+static uint64_t
+htonll (uint64_t v)
+{
+  return v;
+}
+
+#else
+static uint64_t
+htonll (uint64_t v)
+{
+  uint64_t r;
+  uint8_t *pv, *pr;
+
+  pv = (uint8_t *) & v;
+  pr = (uint8_t *) & r;
+
+  pr[0] = pv[7];
+  pr[1] = pv[6];
+  pr[2] = pv[5];
+  pr[3] = pv[4];
+  pr[4] = pv[3];
+  pr[5] = pv[2];
+  pr[6] = pv[1];
+  pr[7] = pv[0];
+
+  return r;
+}
+#endif
+
+/* double in network order, stored into uint64_t variables */
+static inline uint64_t
+htondbl64 (double v)
+{
+  union { double d; uint64_t u; } x;
+  x.d = v;
+  return htonll (x.u);
+}
+
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static double
+medium_uniform (void)
+{
+#ifdef _WIN32
+  return (double) rand () / ((double) RAND_MAX + 1.0);
+#else
+  return drand48 ();
+#endif
+}
+
+/* standard normal, Box-Muller */
+static double
+medium_normal (void)
+{
+  double u1 = 1.0 - medium_uniform ();
+  double u2 = medium_uniform ();
+  return sqrt (-2.0 * log (u1)) * cos (2.0 * M_PI * u2);
+}
+
+static inline double
+medium_dBm2mW (double dBm)
+{
+  return pow (10.0, dBm / 10.0);
+}
+
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static int
+medium_topology (const char *topology, char *placed)
+{
+  FILE *file;
+  char line[MEDIUM_LINE_MAX];
+  int n = 0;
+
+  if ((file = fopen (topology, "r")) == NULL)
+    {
+      fprintf (stderr, "medium: cannot open topology file %s\n", topology);
+      return -1;
+    }
+
+  while (fgets (line, MEDIUM_LINE_MAX, file) != NULL)
+    {
+      char key[MEDIUM_LINE_MAX];
+      double a, b, c;
+      int addr;
+
+      n++;
+      if ((sscanf (line, "%s", key) != 1) || (key[0] == '#'))
+	continue;
+
+      if ((strcmp (key, "pathloss") == 0) && (sscanf (line, "%*s %lf %lf %lf", &a, &b, &c) == 3) && (b > 0))
+	{
+	  medium.exponent = a;
+	  medium.d0       = b;
+	  medium.pl0      = c;
+	}
+      else if ((strcmp (key, "shadowing") == 0) && (sscanf (line, "%*s %lf", &a) == 1))
+	{
+	  medium.shadowing = a;
+	}
+      else if ((strcmp (key, "noise") == 0) && (sscanf (line, "%*s %lf", &a) == 1))
+	{
+	  medium.noise_mW = medium_dBm2mW (a);
+	}
+      else if ((strcmp (key, "cutoff") == 0) && (sscanf (line, "%*s %lf", &a) == 1))
+	{
+	  medium.cutoff_mW = medium_dBm2mW (a);
+	}
+      else if ((strcmp (key, "node") == 0) && (sscanf (line, "%*s %d %lf %lf %lf", &addr, &a, &b, &c) == 4)
+	       && (addr >= 0) && (addr < g_m_nodes))
+	{
+	  g_nodes[addr].x = a;
+	  g_nodes[addr].y = b;
+	  g_nodes[addr].z = c;
+	  placed[addr]    = 1;
+	}
+      else
+	{
+	  fprintf (stderr, "medium: %s:%d: wrong line %s", topology, n, line);
+	  fclose (file);
+	  return -1;
+	}
+    }
+
+  fclose (file);
+  return 0;
+}
+
+/* gain between two nodes, log-distance path loss and shadowing */
+static double
+medium_link_gain (struct _node *a, struct _node *b)
+{
+  double dx = a->x - b->x;
+  double dy = a->y - b->y;
+  double dz = a->z - b->z;
+  double d  = sqrt (dx * dx + dy * dy + dz * dz);
+  double loss;
+
+  if (d < medium.d0)
+    d = medium.d0;
+
+  loss = medium.pl0 + 10.0 * medium.exponent * log10 (d / medium.d0);
+  if (medium.shadowing > 0)
+    loss += medium.shadowing * medium_normal ();
+
+  return pow (10.0, -loss / 10.0);
+}
+
+int
+medium_init (const char *topology)
+{
+  char *placed;
+  int placed_nodes = 0;
+  int tx, rx;
+
+  g_medium = 0;
+  if ((topology == NULL) || (topology[0] == '\0'))
+    {
+      fprintf (stdout, "Medium: perfect\n");
+      return 0;
+    }
+
+  medium.exponent  = MEDIUM_DEFAULT_EXPONENT;
+  medium.d0        = MEDIUM_DEFAULT_D0;
+  medium.pl0       = MEDIUM_DEFAULT_PL0;
+  medium.shadowing = MEDIUM_DEFAULT_SHADOWING;
+  medium.noise_mW  = medium_dBm2mW (MEDIUM_DEFAULT_NOISE);
+  medium.cutoff_mW = medium_dBm2mW (MEDIUM_DEFAULT_CUTOFF);
+
+  if ((placed = (char *) calloc (g_m_nodes, 1)) == NULL)
+    {
+      fprintf (stderr, "malloc error\n");
+      return -1;
+    }
+
+  if (medium_topology (topology, placed))
+    {
+      free (placed);
+      return -1;
+    }
+
+  /* nodes without position are placed at random in the field */
+  for (tx = 0; tx < g_m_nodes; tx++)
+    {
+      if (placed[tx])
+	{
+	  placed_nodes++;
+	  continue;
+	}
+      g_nodes[tx].x = medium_uniform () * g_x;
+      g_nodes[tx].y = medium_uniform () * g_y;
+      g_nodes[tx].z = medium_uniform () * g_z;
+    }
+  free (placed);
+
+  /* gain matrix and the 2 receiver vectors, aligned rows */
+  medium.stride = (g_m_nodes + MEDIUM_VEC - 1) / MEDIUM_VEC * MEDIUM_VEC;
+  if ((medium.block = malloc (sizeof (float) * medium.stride * (g_m_nodes + 2) + sizeof (medium_vec_t))) == NULL)
+    {
+      fprintf (stderr, "malloc error\n");
+      return -1;
+    }
+  medium.gain   = (float *) (((uintptr_t) medium.block + sizeof (medium_vec_t) - 1) & ~(uintptr_t) (sizeof (medium_vec_t) - 1));
+  medium.signal = medium.gain + medium.stride * g_m_nodes;
+  medium.interf = medium.signal + medium.stride;
+  memset (medium.gain, 0, sizeof (float) * medium.stride * (g_m_nodes + 2));
+
+  /* links are symmetric, shadowing is drawn once per link */
+  for (tx = 0; tx < g_m_nodes; tx++)
+    {
+      for (rx = tx; rx < g_m_nodes; rx++)
+	{
+	  float gain = (float) medium_link_gain (&g_nodes[tx], &g_nodes[rx]);
+	  medium.gain[tx * medium.stride + rx] = gain;
+	  medium.gain[rx * medium.stride + tx] = gain;
+	}
+    }
+
+  g_medium = 1;
+  fprintf (stdout, "Medium: %d placed nodes, path loss %.1fdB at %.1fm exponent %.2f, shadowing %.1fdB, noise %.1fdBm\n",
+	   placed_nodes, medium.pl0, medium.d0, medium.exponent, medium.shadowing,
+	   10.0 * log10 (medium.noise_mW));
+  return 0;
+}
+
+void
+medium_clean (void)
+{
+  free (medium.block);
+  medium.block = NULL;
+  g_medium = 0;
+}
+
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+
+static inline int
+medium_same_channel (struct _packet *a, struct _packet *b)
+{
+  int64_t delta = (int64_t) (unsigned) a->freq - (int64_t) (unsigned) b->freq;
+  return (delta < MEDIUM_CHANNEL_WIDTH) && (delta > -MEDIUM_CHANNEL_WIDTH);
+}
+
+/* perfect radio layer: no noise, no energy dissipation */
+static int
+medium_rx_perfect (struct _packet *packet, struct _worldsens_data *data)
+{
+  uint64_t rx_mW = htondbl64 (packet->tx_mW);
+  int c_node = 0;
+  int i = g_m_nodes;
+
+  while (i--)
+    {
+      if (g_nodes[i].active)
+	{
+	  data[c_node].node  = htonl (i);
+	  data[c_node].data  = packet->data[0];
+	  data[c_node].SiNR  = htonll (0);
+	  data[c_node].rx_mW = rx_mW;
+	  c_node++;
+	}
+    }
+  return c_node;
+}
+
+int
+medium_rx (struct _packet *packet, struct _worldsens_data *data)
+{
+  medium_vec_t *signal = (medium_vec_t *) medium.signal;
+  medium_vec_t *interf = (medium_vec_t *) medium.interf;
+  medium_vec_t *row;
+  medium_vec_t  v;
+  struct _packet *other;
+  int vecs = medium.stride / MEDIUM_VEC;
+  int c_node = 0;
+  int i;
+
+  if (g_medium == 0)
+    {
+      return medium_rx_perfect (packet, data);
+    }
+
+  /* received power */
+  row = (medium_vec_t *) (medium.gain + packet->node->addr * medium.stride);
+  v   = (medium_vec_t) { 0, 0, 0, 0 } + (float) packet->tx_mW;
+  for (i = 0; i < vecs; i++)
+    {
+      signal[i] = row[i] * v;
+    }
+
+  /* noise and overlapping packets on the same channel */
+  v = (medium_vec_t) { 0, 0, 0, 0 } + (float) medium.noise_mW;
+  for (i = 0; i < vecs; i++)
+    {
+      interf[i] = v;
+    }
+  for (other = g_packets; other != NULL; other = other->next)
+    {
+      if ((other == packet) ||
+	  (other->tx_start >= packet->tx_end) || (other->tx_end <= packet->tx_start) ||
+	  !medium_same_channel (other, packet))
+	continue;
+
+      row = (medium_vec_t *) (medium.gain + other->node->addr * medium.stride);
+      v   = (medium_vec_t) { 0, 0, 0, 0 } + (float) other->tx_mW;
+      for (i = 0; i < vecs; i++)
+	{
+	  interf[i] += row[i] * v;
+	}
+    }
+
+  /* receivers above the cutoff */
+  i = g_m_nodes;
+  while (i--)
+    {
+      if (g_nodes[i].active && (medium.signal[i] >= medium.cutoff_mW))
+	{
+	  data[c_node].node  = htonl (i);
+	  data[c_node].data  = packet->data[0];
+	  data[c_node].SiNR  = htondbl64 (10.0 * log10 (medium.signal[i] / medium.interf[i]));
+	  data[c_node].rx_mW = htondbl64 (medium.signal[i]);
+	  c_node++;
+	}
+    }
+  return c_node;
+}
+
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
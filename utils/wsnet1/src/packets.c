@@ -19,33 +19,59 @@ struct _packet *g_packets = NULL;
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
-struct _packet *packet_create(struct _node *node, int size) {
-  static int id = 0;
+/* 
+ * Packets are allocated as a single block: header, SiNR, BER and data.
+ * Blocks large enough for PACKET_POOL_SIZE bytes of data are recycled
+ * through a free list, worldsens clients send 1 byte packets.
+ */
+#define PACKET_POOL_SIZE 8
+
+static struct _packet *packet_pool = NULL;
+
+static inline size_t packet_block_size(int size) {
+  return sizeof(struct _packet) + 2 * sizeof(double) * size + size;
+}
+
+static struct _packet *packet_alloc(int size) {
   struct _packet *packet;
+  int capacity = size;
+
+  if (size <= PACKET_POOL_SIZE) {
+    capacity = PACKET_POOL_SIZE;
+    if (packet_pool != NULL) {
+      packet = packet_pool;
+      packet_pool = packet->next;
+      goto init;
+    }
+  }
 	
-  if ((packet = (struct _packet *) malloc(sizeof(struct _packet) + size)) == NULL) {
+  if ((packet = (struct _packet *) malloc(packet_block_size(capacity))) == NULL) {
     fprintf(stderr, "malloc error\n");
     return NULL;
   }
-  memset(packet, 0, sizeof(struct _packet) + size);
 
-  if ((packet->SiNR = (double *) malloc(sizeof(double)*size)) == NULL) {
-    fprintf(stderr, "malloc error\n");
-    free(packet);
-    return NULL;
-  }
-  if ((packet->BER = (double *) malloc(sizeof(double)*size)) == NULL) {
-    fprintf(stderr, "malloc error\n");
-    free(packet->SiNR);
-    free(packet);
+ init:
+  memset(packet, 0, packet_block_size(size));
+  packet->SiNR = (double *) (((char *) packet) + sizeof(struct _packet));
+  packet->BER  = packet->SiNR + size;
+  packet->data = (char *) (packet->BER + size);
+  packet->size = size;
+  return packet;
+}
+
+
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+struct _packet *packet_create(struct _node *node, int size) {
+  static int id = 0;
+  struct _packet *packet;
+	
+  if ((packet = packet_alloc(size)) == NULL) {
     return NULL;
   }
-	
-  memset(packet->BER, 0, sizeof(double)*size);
-  memset(packet->SiNR, 0, sizeof(double)*size);
-  packet->data = ((char *) packet) + sizeof(struct _packet);
+
   packet->id = id++;
-  packet->size = size;
   packet->node = node;
 	
   //  mobility_update(node);
@@ -61,39 +87,48 @@ struct _packet *packet_create(struct _node *node, int size) {
 /**************************************************************************/
 /**************************************************************************/
 void packet_destroy(struct _packet *packet) {	
-  free(packet->BER);
-  free(packet->SiNR);
+  if (packet->size <= PACKET_POOL_SIZE) {
+    packet->next = packet_pool;
+    packet_pool = packet;
+    return;
+  }
   free(packet);
 }
 
 
+/**************************************************************************/
+/**************************************************************************/
+/**************************************************************************/
+void packet_pool_clean(void) {
+  struct _packet *packet;
+
+  while (packet_pool) {
+    packet = packet_pool;
+    packet_pool = packet->next;
+    free(packet);
+  }
+}
+
+
 /**************************************************************************/
 /**************************************************************************/
 /**************************************************************************/
 struct _packet *packet_duplicate(struct _packet *packet) {
   struct _packet *dup;
+  double *SiNR, *BER;
+  char *data;
 	
-  if ((dup = (struct _packet *) malloc(sizeof(struct _packet) + packet->size)) == NULL) {
-    fprintf(stderr, "malloc error\n");
-    return NULL;
-  }
-  memcpy(dup, packet, sizeof(struct _packet) + packet->size);  
-  dup->data = ((char *) dup) + sizeof(struct _packet);
-
-  if ((dup->SiNR = (double *) malloc(sizeof(double)*dup->size)) == NULL) {
-    fprintf(stderr, "malloc error\n");
-    free(dup);
-    return NULL;
-  }
-  if ((dup->BER = (double *) malloc(sizeof(double)*dup->size)) == NULL) {
-    fprintf(stderr, "malloc error\n");
-    free(dup->SiNR);
-    free(dup);
+  if ((dup = packet_alloc(packet->size)) == NULL) {
     return NULL;
   }
-	
-  memset(dup->BER, 0, sizeof(double)*dup->size);
-  memset(dup->SiNR, 0, sizeof(double)*dup->size);
+  SiNR = dup->SiNR;
+  BER  = dup->BER;
+  data = dup->data;
+  memcpy(dup, packet, sizeof(struct _packet));  
+  memcpy(data, packet->data, packet->size);
+  dup->SiNR = SiNR;
+  dup->BER  = BER;
+  dup->data = data;
   return dup;
 }
 
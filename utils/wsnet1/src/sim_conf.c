@@ -11,6 +11,7 @@
 #include <private/sim_conf.h>
 #include <private/nodes_private.h>
 #include <private/command_line.h>
+#include <private/medium_private.h>
 
 
 #include <public/simulation.h>
@@ -58,7 +59,7 @@ int sim_config(void)
   /******************** Simulation parameters ************************/
 
  /* Set informations*/
-  g_m_nodes = MAX_NODES;
+  g_m_nodes = (g_max_nodes > 0) ? g_max_nodes : MAX_NODES;
   g_x       = X_LENGTH;
   g_y       = Y_LENGTH;
   g_z       = Z_LENGTH;
@@ -85,5 +86,10 @@ int sim_config(void)
   fprintf(stdout, "Simulation setup: %d nodes, (%lfm, %lfm, %lfm) field\n", 
 	  g_m_nodes, g_x, g_y, g_z);
 
+  /* Positions and link gains */
+  if (medium_init(g_topology)) {
+    return -1;
+  }
+
   return 0;
 }
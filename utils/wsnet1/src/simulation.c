@@ -149,6 +149,8 @@ int simulation_start(int argc, char* argv[])
     }
 
   core_start(&worldsens);
+  OUTPUT ("WSNET:: %d rendez-vous, %d backtracks, last period %"PRIu64"ns\n",
+	  worldsens.rp_count, worldsens.backtracks, worldsens.period);
 
   tracer_close(); 
   logger_close();
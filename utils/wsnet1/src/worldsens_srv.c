@@ -27,6 +27,7 @@ char     *g_maddr                  = "224.0.0.1";
 char     *g_saddr                  = "localhost";
 
 uint32_t  WORLDSENS_SYNCH_PERIOD   =   500000000; /* default to 0.5 second */
+uint32_t  WORLDSENS_SYNCH_MIN_PERIOD =    1000000; /* default to 1 ms       */
 
 uint32_t  pkt_seq                  = 0;
 int       simulation_keeps_going   = 1;
@@ -264,6 +265,17 @@ worldsens_s_initialize (struct _worldsens_s *worldsens)
   worldsens->rp_seq           = 1;
   worldsens->rp               = WORLDSENS_SYNCH_PERIOD;
   worldsens->synched          = 0;
+  worldsens->period           = WORLDSENS_SYNCH_PERIOD;
+  worldsens->clean            = 0;
+  worldsens->la_min           = UINT64_MAX;
+  worldsens->lookahead        = 0;
+  worldsens->rp_count         = 0;
+  worldsens->backtracks       = 0;
+
+  if (WORLDSENS_SYNCH_MIN_PERIOD > WORLDSENS_SYNCH_PERIOD)
+    {
+      WORLDSENS_SYNCH_MIN_PERIOD = WORLDSENS_SYNCH_PERIOD;
+    }
 
   /* Initialize tracer */
   worldsens->trc_mcast_rx     = tracer_event_add_id(16,"mcast_rx","wsnet1");
@@ -354,6 +366,67 @@ worldsens_s_disconnect (struct _worldsens_s UNUSED * worldsens,
 /**************************************************************************/
 /**************************************************************************/
 
+/*
+ * All the nodes are at the rendez-vous point: no byte can be sent before
+ * the smallest lookahead they have given.
+ */
+static void
+worldsens_s_synched (struct _worldsens_s *worldsens)
+{
+  set_global_time( worldsens->rp );
+
+  if (worldsens->la_min > UINT64_MAX - worldsens->rp)
+    {
+      worldsens->lookahead = UINT64_MAX;
+    }
+  else
+    {
+      worldsens->lookahead = worldsens->rp + worldsens->la_min;
+    }
+  worldsens->la_min = UINT64_MAX;
+
+  WSNET_S_DBG_SYNC ("WSNET:: synched (rp: %"PRId64", lookahead: %"PRId64")\n",
+		    worldsens->rp, worldsens->lookahead);
+}
+
+/*
+ * Period of the next rp, extended up to the lookahead of the nodes and
+ * cut at WORLDSENS_SYNCH_PERIOD.
+ */
+uint64_t
+worldsens_s_period (struct _worldsens_s *worldsens, uint64_t period)
+{
+  if (worldsens->lookahead > get_global_time() + period)
+    {
+      period = worldsens->lookahead - get_global_time();
+    }
+  if (period > WORLDSENS_SYNCH_PERIOD)
+    {
+      period = WORLDSENS_SYNCH_PERIOD;
+    }
+  return period;
+}
+
+/*
+ * Adaptive period: halved on backtracks, doubled after a few clean rp.
+ */
+static void
+worldsens_s_period_update (struct _worldsens_s *worldsens)
+{
+  worldsens->rp_count++;
+  if (++worldsens->clean >= WORLDSENS_SYNCH_CLEAN)
+    {
+      worldsens->clean  = 0;
+      worldsens->period = worldsens->period * 2;
+      if (worldsens->period > WORLDSENS_SYNCH_PERIOD)
+	{
+	  worldsens->period = WORLDSENS_SYNCH_PERIOD;
+	}
+    }
+}
+
+/**************************************************************************/
+
 int
 worldsens_s_listen_to_next_rp (struct _worldsens_s *worldsens)
 {
@@ -387,7 +460,7 @@ worldsens_s_listen_to_next_rp (struct _worldsens_s *worldsens)
 	  /* Synched */
 	  if (worldsens->synched == g_c_nodes)
 	    {
-	      set_global_time( worldsens->rp );
+	      worldsens_s_synched (worldsens);
 	      return 0;
 	    }
 	}
@@ -414,6 +487,16 @@ worldsens_s_listen_to_next_rp (struct _worldsens_s *worldsens)
 
 	  if (ntohl(c_pkt->rp_seq) == (unsigned) worldsens->rp_seq)
 	    {
+	      /* clients without lookahead cannot promise anything */
+	      uint64_t la = 0;
+	      if (len >= (int) sizeof (struct _worldsens_c_synched_pkt))
+		{
+		  la = ntohll (c_pkt->lookahead);
+		}
+	      if (la < worldsens->la_min)
+		{
+		  worldsens->la_min = la;
+		}
 	      worldsens->synched++;
 	    }
 	  else
@@ -427,7 +510,7 @@ worldsens_s_listen_to_next_rp (struct _worldsens_s *worldsens)
 	  /* Synched */
 	  if (worldsens->synched == g_c_nodes)
 	    {
-	      set_global_time( worldsens->rp );
+	      worldsens_s_synched (worldsens);
 	      return 0;
 	    }
 	}
@@ -562,6 +645,15 @@ worldsens_s_backtrack_async (struct _worldsens_s *worldsens, uint64_t period)
   worldsens->rp_seq++;
   worldsens->rp = get_global_time() + period;
   worldsens->synched = 0;
+  worldsens->la_min = UINT64_MAX;
+
+  worldsens->backtracks++;
+  worldsens->clean  = 0;
+  worldsens->period = worldsens->period / 2;
+  if (worldsens->period < WORLDSENS_SYNCH_MIN_PERIOD)
+    {
+      worldsens->period = WORLDSENS_SYNCH_MIN_PERIOD;
+    }
 
   tracer_state_restore();
 
@@ -618,6 +710,8 @@ worldsens_s_save_release_request (struct _worldsens_s *worldsens,
   /* Update */
   worldsens->rp = get_global_time() + period;
   worldsens->synched = 0;
+  worldsens->la_min = UINT64_MAX;
+  worldsens_s_period_update (worldsens);
 
   /* Forge */
   pkt.type = WORLDSENS_S_SYNCH_REQ;
@@ -645,24 +739,26 @@ worldsens_s_save_release_request (struct _worldsens_s *worldsens,
 int
 worldsens_s_save_release_request_rx (struct _worldsens_s *worldsens, int node,
 				     int freq, int modulation,
-				     struct _worldsens_data *data,
+				     struct _worldsens_data *data, int count,
 				     uint64_t period)
 {
   char reply[sizeof (struct _worldsens_s_srrx_pkt) +
-	     sizeof (struct _worldsens_data) * g_c_nodes];
+	     sizeof (struct _worldsens_data) * count];
   struct _worldsens_s_srrx_pkt *pkt = (struct _worldsens_s_srrx_pkt *) reply;
   int length =
     sizeof (struct _worldsens_s_srrx_pkt) +
-    sizeof (struct _worldsens_data) * g_c_nodes;
+    sizeof (struct _worldsens_data) * count;
 
 
   /* Update */
   worldsens->rp = get_global_time() + period;
   worldsens->synched = 0;
+  worldsens->la_min = UINT64_MAX;
+  worldsens_s_period_update (worldsens);
 
   /* Forge */
   memcpy (reply + sizeof (struct _worldsens_s_srrx_pkt), (char *) data,
-	  g_c_nodes * sizeof (struct _worldsens_data));
+	  count * sizeof (struct _worldsens_data));
   pkt->type       = WORLDSENS_S_SYNCH_REQ | WORLDSENS_S_RX;
   pkt->pkt_seq    = htonl  (pkt_seq++);
   pkt->c_rp_seq   = htonl  (worldsens->rp_seq);
@@ -699,18 +795,18 @@ worldsens_s_save_release_request_rx (struct _worldsens_s *worldsens, int node,
 
 int
 worldsens_s_rx (struct _worldsens_s *worldsens, int node, int freq,
-		int modulation, struct _worldsens_data *data)
+		int modulation, struct _worldsens_data *data, int count)
 {
   int length =
     sizeof (struct _worldsens_s_rx_pkt) +
-    sizeof (struct _worldsens_data) * g_c_nodes;
+    sizeof (struct _worldsens_data) * count;
   char reply[length];
 
   struct _worldsens_s_rx_pkt *pkt = (struct _worldsens_s_rx_pkt *) reply;
 
   /* Forge */
   memcpy (reply + sizeof (struct _worldsens_s_rx_pkt), (char *) data,
-	  g_c_nodes * sizeof (struct _worldsens_data));
+	  count * sizeof (struct _worldsens_data));
 
   pkt->type       = WORLDSENS_S_RX;
   pkt->pkt_seq    = htonl (pkt_seq++);
@@ -0,0 +1,849 @@
+/**
+ *  \file   main.c
+ *  \brief  WSNet2 loopback server over the shared memory transport
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "libwsnet/wsnet2_pkt.h"
+#include "libwsnet/wsnet2_shm.h"
+
+/***************************************************/
+/***************************************************/
+/***************************************************/
+
+/*
+ * Stand-in for a WSNet2 server running on the same host as the wsim
+ * nodes, used to test the shared memory transport. The radio medium
+ * is ideal: every byte is received by every other node with the
+ * transmission power, there is no propagation loss and no collision.
+ *
+ * Rendez-vous points are scheduled every period and at the end of each
+ * pending transmission. A byte that ends before the next rendez-vous
+ * moves it back with a backtrack, nodes that went past the new
+ * rendez-vous restore their state and run again. The period is halved
+ * on each backtrack and doubled back after a few clean rendez-vous.
+ * Nodes started with --wsnet2-lookahead give at each rendez-vous the
+ * delay before their radio can send a byte, the next rendez-vous is
+ * pushed up to the smallest one. Their replayed bytes
+ * are recognized by node and start time and dropped, bytes they sent
+ * before reading the backtrack are recognized with the ring mark.
+ *
+ * Frame packets are expanded in bytes. A frame is delivered to the
+ * other nodes in one packet at the end of its first byte, each node
+ * then receives the bytes at their time without rendez-vous. An abort
+ * of a delivered frame is sent as a cancel at a rendez-vous before the
+ * first aborted byte is received.
+ */
+
+#if !defined(WSNET2_SHM)
+int main(void)
+{
+  fprintf(stderr,"wsnet2-loopback: shared memory transport is not available on this host\n");
+  return 1;
+}
+#else
+
+#if defined(DEBUG)
+#   define DBG(x...)  fprintf(stderr,x)
+#else
+#   define DBG(x...)  do { } while (0)
+#endif
+
+#define DEFAULT_PERIOD_NS   (1000*1000)
+#define DEFAULT_MIN_PERIOD  (DEFAULT_PERIOD_NS/32)
+#define DEFAULT_LOOKAHEAD   (100*1000*1000)
+#define CLEAN_RP            4
+#define MAX_ANTENNAS        8
+
+/***************************************************/
+/***************************************************/
+/***************************************************/
+
+struct node_t {
+  int      connected;
+  uint32_t id;
+  uint64_t seq;          /* next packet sequence for this node */
+  uint64_t acked;        /* last rendez-vous reached           */
+  uint32_t bt_mark;      /* down ring position after the last backtrack */
+  uint64_t lookahead;    /* no tx before acked rendez-vous + lookahead  */
+};
+
+struct tx_t {
+  int      src;
+  uint64_t start;
+  uint64_t end;
+  uint64_t sent;         /* time of the packet that carried the byte */
+  uint32_t frame;        /* frame id, 0 for a byte packet            */
+  int      index;
+  int      delivered;    /* frame sent ahead to the other nodes      */
+  int      aborted;
+  uint64_t aborted_at;
+  struct _worldsens_c_byte_tx pkt;
+};
+
+struct server_t {
+  struct wsnet2_shm_t *shm;
+  struct node_t    node[WSNET2_SHM_SLOTS];
+  int              connected;
+  int              nodes;       /* nodes expected before the first release */
+  int              started;
+  uint64_t         period;      /* adaptive, between min_period and max_period */
+  uint64_t         min_period;
+  uint64_t         max_period;
+  uint64_t         max_lookahead;
+  int              clean;       /* rendez-vous since the last backtrack */
+  uint64_t         l_rp;
+  uint64_t         n_rp;
+  uint64_t         rpseq;
+
+  struct tx_t     *tx;
+  int              tx_count;
+  int              tx_size;
+
+  char            *antenna[MAX_ANTENNAS];
+  int              antennas;
+
+  /* stats */
+  uint64_t         rp_count;
+  uint64_t         rp_lookahead;   /* rendez-vous pushed by the lookahead */
+  uint64_t         tx_bytes;
+  uint64_t         tx_frames;
+  uint64_t         aborts;
+  uint64_t         rx_bytes;
+  uint64_t         backtracks;
+  uint64_t         dropped_bytes;
+};
+
+static struct server_t srv;
+static volatile sig_atomic_t srv_stop = 0;
+
+/***************************************************/
+/***************************************************/
+/***************************************************/
+
+static void srv_send(int slot, union _worldsens_pkt *pkt, int len)
+{
+  pkt->s_header.seq = srv.node[slot].seq++;
+  if (wsnet2_shm_srv_send(srv.shm, slot, pkt, len))
+    {
+      fprintf(stderr,"wsnet2-loopback: node %d is gone\n", srv.node[slot].id);
+    }
+}
+
+static int srv_names(char *buf, int offset, uint32_t id, const char *name)
+{
+  memcpy(buf + offset, &id, sizeof(uint32_t));
+  strcpy(buf + offset + sizeof(uint32_t), name);
+  return offset + sizeof(uint32_t) + strlen(name) + 1;
+}
+
+static void srv_connect(int slot, struct _worldsens_c_connect_req *req)
+{
+  union _worldsens_pkt pkt;
+  struct node_t *node = &srv.node[slot];
+  static const char *modulation[] = { "modulation_none", "modulation_fsk", "modulation_oqpsk" };
+  int offset = 0;
+  int i;
+
+  node->id  = req->node_id;
+  node->seq = 1;
+
+  if (srv.started)
+    {
+      /* nodes start at time 0, late joiners cannot be synchronized */
+      fprintf(stderr,"wsnet2-loopback: node %d refused, simulation already started\n", req->node_id);
+      pkt.cnx_rsp_nok.type = WORLDSENS_S_CONNECT_RSP_NOK;
+      srv_send(slot, &pkt, sizeof(struct _worldsens_s_connect_rsp_nok));
+      return;
+    }
+
+  memset(&pkt, 0, sizeof(pkt));
+  pkt.cnx_rsp_ok.type            = WORLDSENS_S_CONNECT_RSP_OK;
+  pkt.cnx_rsp_ok.rp_next         = srv.rpseq;
+  pkt.cnx_rsp_ok.rp_duration     = srv.n_rp - srv.l_rp;
+  pkt.cnx_rsp_ok.n_antenna_id    = srv.antennas;
+  pkt.cnx_rsp_ok.n_modulation_id = sizeof(modulation) / sizeof(modulation[0]);
+  pkt.cnx_rsp_ok.n_measure_id    = 0;
+  for (i = 0; i < srv.antennas; i++)
+    {
+      offset = srv_names(pkt.cnx_rsp_ok.names_and_ids, offset, i, srv.antenna[i]);
+    }
+  for (i = 0; i < pkt.cnx_rsp_ok.n_modulation_id; i++)
+    {
+      offset = srv_names(pkt.cnx_rsp_ok.names_and_ids, offset, i, modulation[i]);
+    }
+
+  /* the response carries the first expected sequence, it does not use one */
+  pkt.cnx_rsp_ok.seq = node->seq;
+  if (wsnet2_shm_srv_send(srv.shm, slot, &pkt, sizeof(struct _worldsens_s_connect_rsp_ok)))
+    {
+      return;
+    }
+
+  node->connected = 1;
+  node->acked     = 0;
+  srv.connected  ++;
+  DBG("wsnet2-loopback: node %d connected in slot %d\n", node->id, slot);
+}
+
+/***************************************************/
+/***************************************************/
+/***************************************************/
+
+static int srv_tx_cmp(const void *a, const void *b)
+{
+  const struct tx_t *ta = a;
+  const struct tx_t *tb = b;
+  if (ta->end   != tb->end)   return (ta->end   < tb->end)   ? -1 : 1;
+  if (ta->start != tb->start) return (ta->start < tb->start) ? -1 : 1;
+  return ta->src - tb->src;
+}
+
+static void srv_deliver(struct tx_t *tx)
+{
+  union _worldsens_pkt pkt;
+  int i;
+
+  memset(&pkt, 0, sizeof(pkt));
+  pkt.byte_rx.type         = WORLDSENS_S_BYTE_RX;
+  pkt.byte_rx.antenna_id   = tx->pkt.antenna_id;
+  pkt.byte_rx.wsim_mod_id  = tx->pkt.wsim_mod_id;
+  pkt.byte_rx.freq         = tx->pkt.freq;
+  pkt.byte_rx.power_dbm    = tx->pkt.power_dbm;
+  pkt.byte_rx.data         = tx->pkt.data;
+  {
+    double sinr = 100.0;
+    memcpy(&pkt.byte_rx.sinr, &sinr, sizeof(sinr));
+  }
+
+  for (i = 0; i < WSNET2_SHM_SLOTS; i++)
+    {
+      if (srv.node[i].connected && (i != tx->src))
+	{
+	  pkt.byte_rx.node_id = srv.node[i].id;
+	  srv_send(i, &pkt, sizeof(struct _worldsens_s_byte_rx));
+	  srv.rx_bytes ++;
+	}
+    }
+}
+
+static int srv_same_frame(struct tx_t *a, struct tx_t *b)
+{
+  return (a->frame != 0) && (a->src == b->src) && (a->frame == b->frame);
+}
+
+/* the frame bytes that are not aborted, received at their end */
+static void srv_deliver_frame(struct tx_t *first)
+{
+  union _worldsens_pkt pkt;
+  int i, n = 0;
+
+  memset(&pkt, 0, sizeof(pkt));
+  pkt.frame_rx.type         = WORLDSENS_S_FRAME_RX;
+  pkt.frame_rx.src_id       = srv.node[first->src].id;
+  pkt.frame_rx.antenna_id   = first->pkt.antenna_id;
+  pkt.frame_rx.wsim_mod_id  = first->pkt.wsim_mod_id;
+  pkt.frame_rx.freq         = first->pkt.freq;
+  pkt.frame_rx.power_dbm    = first->pkt.power_dbm;
+  {
+    double sinr = 100.0;
+    memcpy(&pkt.frame_rx.sinr, &sinr, sizeof(sinr));
+  }
+  for (i = 0; i < srv.tx_count; i++)
+    {
+      struct tx_t *tx = &srv.tx[i];
+      if (srv_same_frame(tx, first) && !tx->delivered && !tx->aborted)
+	{
+	  pkt.frame_rx.byte[n].offset = (tx->end > srv.n_rp) ? tx->end - srv.n_rp : 0;
+	  pkt.frame_rx.byte[n].data   = tx->pkt.data;
+	  tx->delivered = 1;
+	  n++;
+	}
+    }
+  pkt.frame_rx.len = n;
+
+  for (i = 0; i < WSNET2_SHM_SLOTS; i++)
+    {
+      if (srv.node[i].connected && (i != first->src))
+	{
+	  pkt.frame_rx.node_id = srv.node[i].id;
+	  srv_send(i, &pkt, WORLDSENS_FRAME_RX_LENGTH(n));
+	  srv.rx_bytes += n;
+	}
+    }
+}
+
+static void srv_cancel_frame(struct tx_t *first)
+{
+  union _worldsens_pkt pkt;
+  int i;
+
+  memset(&pkt, 0, sizeof(pkt));
+  pkt.frame_cancel.type       = WORLDSENS_S_FRAME_CANCEL;
+  pkt.frame_cancel.src_id     = srv.node[first->src].id;
+  pkt.frame_cancel.antenna_id = first->pkt.antenna_id;
+  pkt.frame_cancel.offset     = (first->end > srv.n_rp) ? first->end - srv.n_rp : 0;
+
+  for (i = 0; i < WSNET2_SHM_SLOTS; i++)
+    {
+      if (srv.node[i].connected && (i != first->src))
+	{
+	  pkt.frame_cancel.node_id = srv.node[i].id;
+	  srv_send(i, &pkt, sizeof(struct _worldsens_s_frame_cancel));
+	}
+    }
+}
+
+/*
+ * all connected nodes reached the rendez-vous, deliver the bytes that
+ * ended and schedule the next rendez-vous
+ */
+static void srv_release(void)
+{
+  union _worldsens_pkt pkt;
+  uint64_t lookahead;
+  int delivered = 0;
+  int i;
+
+  if ((srv.connected == 0) || (srv.connected < srv.nodes && srv.started == 0))
+    return;
+
+  for (i = 0; i < WSNET2_SHM_SLOTS; i++)
+    {
+      if (srv.node[i].connected && srv.node[i].acked != srv.rpseq)
+	return;
+    }
+
+  if (srv.tx_count > 1)
+    {
+      qsort(srv.tx, srv.tx_count, sizeof(struct tx_t), srv_tx_cmp);
+    }
+  for (i = 0; i < srv.tx_count; i++)
+    {
+      struct tx_t *tx = &srv.tx[i];
+      if (tx->aborted)
+	{
+	  /* committed abort, the first byte of a frame has the earliest end */
+	  if (tx->aborted_at <= srv.n_rp)
+	    {
+	      if (tx->delivered)
+		{
+		  int j;
+		  srv_cancel_frame(tx);
+		  for (j = i + 1; j < srv.tx_count; j++)
+		    {
+		      if (srv_same_frame(&srv.tx[j], tx) && srv.tx[j].aborted)
+			srv.tx[j].delivered = 0;
+		    }
+		}
+	      tx->src = -1;
+	    }
+	  continue;
+	}
+      if (tx->end <= srv.n_rp)
+	{
+	  if (tx->frame == 0)
+	    srv_deliver(tx);
+	  else if (! tx->delivered)
+	    srv_deliver_frame(tx);
+	  tx->src = -1;
+	}
+    }
+  for (i = 0; i < srv.tx_count; i++)
+    {
+      if (srv.tx[i].src != -1)
+	srv.tx[delivered++] = srv.tx[i];
+    }
+  srv.tx_count = delivered;
+
+  if (++srv.clean >= CLEAN_RP)
+    {
+      srv.clean  = 0;
+      srv.period = (2 * srv.period < srv.max_period) ? 2 * srv.period : srv.max_period;
+    }
+
+  lookahead = UINT64_MAX;
+  for (i = 0; i < WSNET2_SHM_SLOTS; i++)
+    {
+      if (srv.node[i].connected && (srv.node[i].lookahead < lookahead))
+	lookahead = srv.node[i].lookahead;
+    }
+  if (lookahead > srv.max_lookahead)
+    {
+      lookahead = srv.max_lookahead;
+    }
+
+  srv.l_rp   = srv.n_rp;
+  if (lookahead > srv.period)
+    {
+      srv.n_rp = srv.l_rp + lookahead;
+      srv.rp_lookahead ++;
+    }
+  else
+    {
+      srv.n_rp = srv.l_rp + srv.period;
+    }
+  for (i = 0; i < srv.tx_count; i++)
+    {
+      struct tx_t *tx = &srv.tx[i];
+      /* bytes that are still to be sent, or received bytes to cancel */
+      if (((tx->delivered != 0) == (tx->aborted != 0)) && (tx->end < srv.n_rp))
+	{
+	  srv.n_rp = tx->end;
+	}
+    }
+  srv.rpseq    ++;
+  srv.rp_count ++;
+  srv.started   = 1;
+
+  memset(&pkt, 0, sizeof(pkt));
+  pkt.sync_release.type        = WORLDSENS_S_SYNC_RELEASE;
+  pkt.sync_release.rp_next     = srv.rpseq;
+  pkt.sync_release.rp_duration = srv.n_rp - srv.l_rp;
+  for (i = 0; i < WSNET2_SHM_SLOTS; i++)
+    {
+      if (srv.node[i].connected)
+	{
+	  srv_send(i, &pkt, sizeof(struct _worldsens_s_sync_release));
+	}
+    }
+}
+
+/***************************************************/
+/***************************************************/
+/***************************************************/
+
+static void srv_reminder(int slot)
+{
+  union _worldsens_pkt pkt;
+  pkt.sync_reminder.type    = WORLDSENS_S_SYNC_REMINDER;
+  pkt.sync_reminder.rp_next = srv.rpseq;
+  srv_send(slot, &pkt, sizeof(struct _worldsens_s_sync_reminder));
+}
+
+static void srv_backtrack(uint64_t rp)
+{
+  union _worldsens_pkt pkt;
+  int i, n;
+
+  /* nodes that sent these bytes are past rp, they run again */
+  for (i = 0, n = 0; i < srv.tx_count; i++)
+    {
+      if (srv.tx[i].delivered || srv.tx[i].sent <= rp)
+	{
+	  if (srv.tx[i].aborted && srv.tx[i].aborted_at > rp)
+	    srv.tx[i].aborted = 0;
+	  srv.tx[n++] = srv.tx[i];
+	}
+      else
+	srv.dropped_bytes ++;
+    }
+  srv.tx_count = n;
+
+  srv.n_rp  = rp;
+  srv.rpseq ++;
+  srv.backtracks ++;
+
+  srv.clean  = 0;
+  srv.period = (srv.period / 2 > srv.min_period) ? srv.period / 2 : srv.min_period;
+
+  memset(&pkt, 0, sizeof(pkt));
+  pkt.bktrk.type        = WORLDSENS_S_BACKTRACK;
+  pkt.bktrk.rp_next     = srv.rpseq;
+  pkt.bktrk.rp_duration = srv.n_rp - srv.l_rp;
+  for (i = 0; i < WSNET2_SHM_SLOTS; i++)
+    {
+      if (srv.node[i].connected)
+	{
+	  srv_send(i, &pkt, sizeof(struct _worldsens_s_backtrack));
+	  srv.node[i].bt_mark = srv.shm->slot[i].down.head;
+	}
+    }
+}
+
+/* a byte sent again by a node that restored its state */
+static int srv_tx_replayed(int slot, uint64_t start)
+{
+  int i;
+  for (i = 0; i < srv.tx_count; i++)
+    {
+      if ((srv.tx[i].src == slot) && (srv.tx[i].frame == 0) && (srv.tx[i].start == start))
+	return 1;
+    }
+  return 0;
+}
+
+static struct tx_t *srv_tx_new(void)
+{
+  struct tx_t *tx;
+
+  if (srv.tx_count == srv.tx_size)
+    {
+      srv.tx_size = srv.tx_size ? 2 * srv.tx_size : 64;
+      if ((srv.tx = realloc(srv.tx, srv.tx_size * sizeof(struct tx_t))) == NULL)
+	{
+	  fprintf(stderr,"wsnet2-loopback: out of memory\n");
+	  exit(1);
+	}
+    }
+  tx = &srv.tx[srv.tx_count++];
+  memset(tx, 0, sizeof(struct tx_t));
+  return tx;
+}
+
+static void srv_tx(int slot, struct _worldsens_c_byte_tx *pkt, uint32_t mark)
+{
+  struct tx_t *tx;
+
+  if (((int32_t)(mark - srv.node[slot].bt_mark) < 0) && (srv.l_rp + pkt->period > srv.n_rp))
+    {
+      /* sent past the rendez-vous before the node read the backtrack, it restores */
+      srv.dropped_bytes ++;
+      return;
+    }
+  if (srv_tx_replayed(slot, srv.l_rp + pkt->period))
+    {
+      srv_reminder(slot);
+      return;
+    }
+
+  tx        = srv_tx_new();
+  tx->src   = slot;
+  tx->start = srv.l_rp + pkt->period;
+  tx->end   = tx->start + pkt->duration;
+  tx->sent  = tx->start;
+  tx->pkt   = *pkt;
+  srv.tx_bytes ++;
+
+  /* the sender waits for a backtrack or a reminder */
+  if (tx->end < srv.n_rp)
+    {
+      srv_backtrack(tx->end);
+    }
+  else
+    {
+      srv_reminder(slot);
+    }
+}
+
+static void srv_frame_tx(int slot, struct _worldsens_c_frame_tx *pkt, uint32_t mark)
+{
+  uint64_t sent = srv.l_rp + pkt->period;
+  uint64_t first_end;
+  int i;
+
+  if (pkt->len == 0)
+    {
+      srv_reminder(slot);
+      return;
+    }
+  if (((int32_t)(mark - srv.node[slot].bt_mark) < 0) && (sent > srv.n_rp))
+    {
+      srv.dropped_bytes += pkt->len;
+      return;
+    }
+  for (i = 0; i < srv.tx_count; i++)
+    {
+      if ((srv.tx[i].src == slot) && (srv.tx[i].frame == pkt->frame_id))
+	{
+	  srv_reminder(slot);
+	  return;
+	}
+    }
+
+  for (i = 0; i < pkt->len; i++)
+    {
+      struct tx_t *tx = srv_tx_new();
+      tx->src               = slot;
+      tx->start             = sent + pkt->byte[i].offset;
+      tx->end               = tx->start + pkt->duration;
+      tx->sent              = sent;
+      tx->frame             = pkt->frame_id;
+      tx->index             = i;
+      tx->pkt.antenna_id    = pkt->antenna_id;
+      tx->pkt.wsnet_mod_id  = pkt->wsnet_mod_id;
+      tx->pkt.wsim_mod_id   = pkt->wsim_mod_id;
+      tx->pkt.freq          = pkt->freq;
+      tx->pkt.power_dbm     = pkt->power_dbm;
+      tx->pkt.duration      = pkt->duration;
+      tx->pkt.data          = pkt->byte[i].data;
+    }
+  srv.tx_bytes  += pkt->len;
+  srv.tx_frames ++;
+
+  first_end = sent + pkt->byte[0].offset + pkt->duration;
+  if (first_end < srv.n_rp)
+    {
+      srv_backtrack(first_end);
+    }
+  else
+    {
+      srv_reminder(slot);
+    }
+}
+
+static void srv_frame_abort(int slot, struct _worldsens_c_frame_abort *pkt, uint32_t mark)
+{
+  uint64_t at = srv.l_rp + pkt->period;
+  uint64_t cutoff = UINT64_MAX;
+  int delivered = 0;
+  int i;
+
+  if (((int32_t)(mark - srv.node[slot].bt_mark) < 0) && (at > srv.n_rp))
+    {
+      return;
+    }
+
+  for (i = 0; i < srv.tx_count; i++)
+    {
+      struct tx_t *tx = &srv.tx[i];
+      if ((tx->src == slot) && (tx->frame == pkt->frame_id) && (tx->index >= pkt->index) && !tx->aborted)
+	{
+	  if (tx->end < cutoff)
+	    cutoff = tx->end;
+	  delivered |= tx->delivered;
+	}
+    }
+  if (cutoff == UINT64_MAX)
+    {
+      /* replayed abort */
+      srv_reminder(slot);
+      return;
+    }
+
+  /* the node stopped sending before the cutoff, it will stop again after a restore */
+  if (at > cutoff)
+    at = cutoff;
+  for (i = 0; i < srv.tx_count; i++)
+    {
+      struct tx_t *tx = &srv.tx[i];
+      if ((tx->src == slot) && (tx->frame == pkt->frame_id) && (tx->index >= pkt->index))
+	{
+	  tx->aborted    = 1;
+	  tx->aborted_at = at;
+	}
+    }
+  srv.aborts ++;
+
+  /* receivers must get the cancel before the first aborted byte */
+  if (delivered && (cutoff > srv.l_rp) && (cutoff < srv.n_rp))
+    {
+      srv_backtrack(cutoff);
+    }
+  else
+    {
+      if (delivered && (cutoff <= srv.l_rp))
+	fprintf(stderr,"wsnet2-loopback: node %d aborted a frame after its reception\n", srv.node[slot].id);
+      srv_reminder(slot);
+    }
+}
+
+static void srv_leave(int slot)
+{
+  if (srv.node[slot].connected)
+    {
+      DBG("wsnet2-loopback: node %d left\n", srv.node[slot].id);
+      srv.node[slot].connected = 0;
+      srv.connected --;
+      srv_release();
+    }
+  wsnet2_shm_slot_free(srv.shm, slot);
+}
+
+static void srv_parse(int slot, union _worldsens_pkt *pkt, uint32_t mark)
+{
+  switch (pkt->c_header.type)
+    {
+    case WORLDSENS_C_CONNECT_REQ:
+      srv_connect(slot, &pkt->cnx_req);
+      break;
+    case WORLDSENS_C_SYNC_ACK:
+      if (pkt->sync_ack.rp_id == srv.rpseq)
+	{
+	  srv.node[slot].acked     = pkt->sync_ack.rp_id;
+	  srv.node[slot].lookahead = 0;
+	  srv_release();
+	}
+      break;
+    case WORLDSENS_C_SYNC_ACK_LOOKAHEAD:
+      if (pkt->sync_ack_la.rp_id == srv.rpseq)
+	{
+	  srv.node[slot].acked     = pkt->sync_ack_la.rp_id;
+	  srv.node[slot].lookahead = pkt->sync_ack_la.lookahead;
+	  srv_release();
+	}
+      break;
+    case WORLDSENS_C_BYTE_TX:
+      srv_tx(slot, &pkt->byte_tx, mark);
+      break;
+    case WORLDSENS_C_FRAME_TX:
+      srv_frame_tx(slot, &pkt->frame_tx, mark);
+      break;
+    case WORLDSENS_C_FRAME_ABORT:
+      srv_frame_abort(slot, &pkt->frame_abort, mark);
+      break;
+    case WORLDSENS_C_MEASURE_REQ:
+      /* no measure is published */
+      srv_reminder(slot);
+      break;
+    case WORLDSENS_C_DISCONNECT:
+      if (srv.node[slot].connected)
+	{
+	  srv.node[slot].connected = 0;
+	  srv.connected --;
+	  srv_release();
+	}
+      break;
+    default:
+      fprintf(stderr,"wsnet2-loopback: unknown packet type %d from slot %d\n", pkt->c_header.type, slot);
+      break;
+    }
+}
+
+/***************************************************/
+/***************************************************/
+/***************************************************/
+
+static void srv_signal(int sig)
+{
+  (void)sig;
+  srv_stop = 1;
+}
+
+static void usage(void)
+{
+  fprintf(stderr,"usage: wsnet2-loopback [-n nodes] [-p period_ns] [-m min_period_ns] [-l lookahead_ns] [-a antenna] segment\n");
+  fprintf(stderr,"   -n : nodes connected before the simulation starts (default 1)\n");
+  fprintf(stderr,"   -p : rendez-vous period in ns (default %d)\n", DEFAULT_PERIOD_NS);
+  fprintf(stderr,"   -m : period after backtracks, lower bound in ns (default %d)\n", DEFAULT_MIN_PERIOD);
+  fprintf(stderr,"   -l : longest period given by the nodes lookahead in ns (default %d)\n", DEFAULT_LOOKAHEAD);
+  fprintf(stderr,"   -a : published antenna, can be repeated (default omnidirectionnal)\n");
+  fprintf(stderr,"   segment is the name given to wsim with --wsnet2-shm=segment\n");
+}
+
+int main(int argc, char *argv[])
+{
+  union _worldsens_pkt pkt;
+  char *name;
+  int c, i;
+
+  memset(&srv, 0, sizeof(srv));
+  srv.nodes         = 1;
+  srv.max_period    = DEFAULT_PERIOD_NS;
+  srv.min_period    = DEFAULT_MIN_PERIOD;
+  srv.max_lookahead = DEFAULT_LOOKAHEAD;
+  srv.rpseq         = 1;
+
+  while ((c = getopt(argc, argv, "n:p:m:l:a:h")) != -1)
+    {
+      switch (c)
+	{
+	case 'n': srv.nodes  = atoi(optarg);          break;
+	case 'p': srv.max_period    = strtoull(optarg,NULL,0); break;
+	case 'm': srv.min_period    = strtoull(optarg,NULL,0); break;
+	case 'l': srv.max_lookahead = strtoull(optarg,NULL,0); break;
+	case 'a':
+	  if (srv.antennas < MAX_ANTENNAS)
+	    srv.antenna[srv.antennas++] = optarg;
+	  break;
+	default:
+	  usage();
+	  return 1;
+	}
+    }
+  if ((optind != argc - 1) || (srv.nodes < 1) || (srv.max_period == 0))
+    {
+      usage();
+      return 1;
+    }
+  if ((srv.min_period == 0) || (srv.min_period > srv.max_period))
+    {
+      srv.min_period = srv.max_period;
+    }
+  srv.period = srv.max_period;
+  if (srv.antennas == 0)
+    {
+      srv.antenna[srv.antennas++] = "omnidirectionnal";
+    }
+  name     = argv[optind];
+  srv.n_rp = srv.period;
+
+  if ((srv.shm = wsnet2_shm_create(name)) == NULL)
+    {
+      perror("wsnet2-loopback: shm");
+      return 1;
+    }
+  signal(SIGINT,  srv_signal);
+  signal(SIGTERM, srv_signal);
+  printf("wsnet2-loopback: segment %s, waiting for %d node(s)\n", name, srv.nodes);
+  fflush(stdout);
+
+  while (srv_stop == 0)
+    {
+      uint32_t bell = __atomic_load_n(&srv.shm->doorbell, __ATOMIC_ACQUIRE);
+      uint32_t mark;
+      int work = 0;
+      int len;
+
+      for (i = 0; i < WSNET2_SHM_SLOTS; i++)
+	{
+	  switch (__atomic_load_n(&srv.shm->slot[i].state, __ATOMIC_ACQUIRE))
+	    {
+	    case WSNET2_SHM_SLOT_CLAIMED:
+	      while ((len = wsnet2_shm_srv_recv(srv.shm, i, &pkt, sizeof(pkt), &mark)) > 0)
+		{
+		  srv_parse(i, &pkt, mark);
+		  work = 1;
+		}
+	      break;
+	    case WSNET2_SHM_SLOT_CLOSED:
+	      srv_leave(i);
+	      work = 1;
+	      break;
+	    }
+	}
+
+      /* the simulation is over when the last node leaves */
+      if (srv.started && srv.connected == 0)
+	break;
+
+      if ((work == 0) && (wsnet2_shm_doorbell_wait(srv.shm, bell, 100) == 0))
+	{
+	  /* idle, look for crashed clients */
+	  for (i = 0; i < WSNET2_SHM_SLOTS; i++)
+	    {
+	      if ((srv.shm->slot[i].state == WSNET2_SHM_SLOT_CLAIMED) &&
+		  (wsnet2_shm_client_alive(srv.shm, i) == 0))
+		{
+		  fprintf(stderr,"wsnet2-loopback: node %d died\n", srv.node[i].id);
+		  srv_leave(i);
+		}
+	    }
+	}
+    }
+
+  wsnet2_shm_destroy(srv.shm, name);
+  free(srv.tx);
+
+  printf("wsnet2-loopback: %"PRIu64" rendez-vous, %"PRIu64" backtracks\n", srv.rp_count, srv.backtracks);
+  printf("wsnet2-loopback: %"PRIu64" rendez-vous pushed by the lookahead, last period %"PRIu64"ns\n",
+	 srv.rp_lookahead, srv.period);
+  printf("wsnet2-loopback: %"PRIu64" bytes sent, %"PRIu64" bytes received, %"PRIu64" bytes dropped\n",
+	 srv.tx_bytes, srv.rx_bytes, srv.dropped_bytes);
+  printf("wsnet2-loopback: %"PRIu64" frames sent, %"PRIu64" frames aborted\n", srv.tx_frames, srv.aborts);
+  return 0;
+}
+
+#endif /* WSNET2_SHM */
+
+/***************************************************/
+/***************************************************/
+/***************************************************/
@@ -0,0 +1,9 @@
+/**
+ *  \file   shm.c
+ *  \brief  WSNet2 loopback server, shared memory rings
+ *  \author Antoine Fraboulet
+ *  \date   2011
+ **/
+
+/* the ring code is shared with the wsim client */
+#include "libwsnet/wsnet2_shm.c"
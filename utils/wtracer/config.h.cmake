@@ -5,6 +5,8 @@
 #cmakedefine HAVE_INTTYPES_H 1
 #cmakedefine HAVE_STDINT_H 1
 #cmakedefine HAVE_SYS_MOUNT_H
+#cmakedefine HAVE_SYS_MMAN_H 1
+#cmakedefine HAVE_PTHREAD_H 1
 
 #cmakedefine FUNC_STRTOK_R_DEFINED 1
 
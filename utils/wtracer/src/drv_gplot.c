@@ -25,7 +25,8 @@ tracer_driver_t tracer_driver_gplot =
     .ext      = ".gp",
     .init     = drv_gplot_init,
     .process  = drv_gplot_process,
-    .finalize = drv_gplot_finalize
+    .finalize = drv_gplot_finalize,
+    .parallel = 1
   };
 
 inline tracer_time_t min(tracer_time_t t1, tracer_time_t t2)
@@ -60,8 +61,6 @@ tracer_dump_gplot_id(tracer_t *t, tracer_id_t id)
 
   tracer_val_t      val;
   tracer_ev_t       i;
-  tracer_ev_t       left  = 0;
-  tracer_ev_t       right = 0;
 
   tracer_sample_t   left_sample;
   tracer_sample_t   right_sample;
@@ -113,29 +112,20 @@ tracer_dump_gplot_id(tracer_t *t, tracer_id_t id)
     }
 
   
-  /* find first ref */
-  for(left = 0; left < t->hdr.ev_count_total; left++)
-    {
-      tracer_read_sample(t,&left_sample);
-      if (left_sample.id == id)
-	break;
-    }
+  /* find first ref, the reader only returns samples of id */
+  if (tracer_read_sample(t,&left_sample) == 0)
+    return;
 
   assert(left_sample.time == 0); // first event time should be 0
 
   /* outputs segment data */
-  for(right=left+1 ; right < t->hdr.ev_count_total; right++)
+  while (tracer_read_sample(t,&right_sample))
     {
-      tracer_read_sample(t,&right_sample);
-      if (right_sample.id == id)
-	{
-	  t1  = left_sample.time  / FACTOR;
-	  t2  = right_sample.time / FACTOR;
-	  val = left_sample.val;
-	  fprintf(t->out_fd,"%g %g\n%g %g\ne\n",(double)t1,(double)val,(double)t2,(double)val);
-	  left = right;
-	  left_sample = right_sample;
-	}
+      t1  = left_sample.time  / FACTOR;
+      t2  = right_sample.time / FACTOR;
+      val = left_sample.val;
+      fprintf(t->out_fd,"%g %g\n%g %g\ne\n",(double)t1,(double)val,(double)t2,(double)val);
+      left_sample = right_sample;
     }
 
   /* outputs last segment */
@@ -176,7 +166,7 @@ int drv_gplot_process(tracer_t *t)
 	  ((strcmp(t->out_signal_name,"all") == 0) || 
 	   (strcmp(t->out_signal_name,t->hdr.id_name[id]) == 0)))
 	{
-	  tracer_file_in_rewind(t);
+	  tracer_file_in_select(t,0,DEFAULT_STOP_TIME,id);
 	  tracer_dump_gplot_id(t,id);
 	}
     }
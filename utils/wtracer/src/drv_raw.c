@@ -24,7 +24,8 @@ tracer_driver_t tracer_driver_raw =
     .ext      = ".raw",
     .init     = drv_raw_init,
     .process  = drv_raw_process,
-    .finalize = drv_raw_finalize
+    .finalize = drv_raw_finalize,
+    .parallel = 1
   };
 
 /* ************************************************** */
@@ -49,7 +50,6 @@ uint64_t drv_raw_bitmask(int size)
 void drv_raw_dump_signal(tracer_t *t, tracer_id_t id)
 {
   uint64_t bitmask;
-  tracer_ev_t   ev;
   tracer_sample_t s;
 
   bitmask = drv_raw_bitmask(t->hdr.id_width[id]);
@@ -62,14 +62,10 @@ void drv_raw_dump_signal(tracer_t *t, tracer_id_t id)
   fprintf(t->out_fd,"max: %" PRIu64 "\n",t->hdr.id_val_max[id]);
   fprintf(t->out_fd,"\n");
 
-  for(ev=0; ev < t->hdr.ev_count_total; ev++)
+  while (tracer_read_sample(t,&s))
     {
-      tracer_read_sample(t,&s);
-      if (s.id == id)
-	{
-	  fprintf(t->out_fd,"%" PRIu64 ": %" PRIu64 "\n",
-		  s.time, s.val & bitmask);
-	}
+      fprintf(t->out_fd,"%" PRIu64 ": %" PRIu64 "\n",
+	      s.time, s.val & bitmask);
     }
   fprintf(t->out_fd,"\n");
 }
@@ -89,7 +85,7 @@ int drv_raw_process(tracer_t *t)
 	  ((strcmp(t->out_signal_name,"all") == 0) || 
 	   (strcmp(t->out_signal_name,t->hdr.id_name[id]) == 0)))
 	{
-	  tracer_file_in_rewind(t);
+	  tracer_file_in_select(t,0,DEFAULT_STOP_TIME,id);
 	  drv_raw_dump_signal(t,id);
 	  fprintf(t->out_fd,"# ============================\n");
 	}
@@ -42,21 +42,21 @@ tracer_driver_t tracer_driver_vcd =
     .ext      = ".vcd",
     .init     = drv_vcd_init,     /* init           */
     .process  = drv_vcd_process,  /* process 1 file */
-    .finalize = drv_vcd_finalize  /* finalize       */
+    .finalize = drv_vcd_finalize, /* finalize       */
+    .parallel = 1
   };
 
 /* ************************************************** */
 /* ************************************************** */
 /* ************************************************** */
 
-/* long long to char* binary representation */
+/* long long to char* binary representation, s is MAXWIDTH + 1 chars */
 static char*
-tracer_lldbin(tracer_val_t val, int width)
+tracer_lldbin(char *s, tracer_val_t val, int width)
 {
   int i;
-  static char s[ MAXWIDTH + 1 ];
   
-  memset(s,'\0',sizeof(s));
+  memset(s,'\0',MAXWIDTH + 1);
   for(i=0; i < width; i++)
     {
       s[width -i -1] = '0' +  ((val >> i) & 0x1);
@@ -87,10 +87,11 @@ static void vcd_dump_header(tracer_t *t)
   {
     char outstr[200];
     time_t time_value;
+    struct tm  tm;
     struct tm *tmp;
     
     time_value = time(NULL);
-    tmp = localtime(&time_value);
+    tmp = localtime_r(&time_value, &tm);
     if (tmp == NULL)
       {
 	strcpy(outstr,"   May 13, 2005\t14:25:30");
@@ -277,6 +278,7 @@ void vcd_dump_init_vars(tracer_t *t, tracer_t *trc[], int nb_trc_files)
 {
   int i;
   tracer_id_t     id;
+  char            bin[MAXWIDTH + 1];
 
   fprintf(t->out_fd,"$dumpvars\n");
   for(i=0; i < nb_trc_files; i++)
@@ -284,7 +286,7 @@ void vcd_dump_init_vars(tracer_t *t, tracer_t *trc[], int nb_trc_files)
       for(id = 0; id < TRACER_MAX_ID; id++)
 	{
 	  if (trc[i]->hdr.id_name[id][0] != '\0')
-	    fprintf(t->out_fd,"b%s %s\n",tracer_lldbin(0,trc[i]->hdr.id_width[id]),trc[i]->id_var[id]);
+	    fprintf(t->out_fd,"b%s %s\n",tracer_lldbin(bin,0,trc[i]->hdr.id_width[id]),trc[i]->id_var[id]);
 	}
     }
   fprintf(t->out_fd,"$end\n");
@@ -296,11 +298,11 @@ void vcd_dump_init_vars(tracer_t *t, tracer_t *trc[], int nb_trc_files)
 
 int drv_vcd_process_file(tracer_t *t)
 {
-  tracer_ev_t     ev;
   tracer_time_t   curr_time = 0;
   tracer_sample_t curr_smpl;
   tracer_sample_t id_last_smpl[TRACER_MAX_ID];
   int             is_first_sample;
+  char            bin[MAXWIDTH + 1];
 
   vcd_dump_header(t);                                              /* header             */
   vcd_dump_scopes(t,&t,1);                                         /* scopes             */
@@ -312,42 +314,35 @@ int drv_vcd_process_file(tracer_t *t)
   vcd_dump_init_vars(t,&t,1);                                      /* dumpvars init to 0 */
   fprintf(t->out_fd,"\n\n\n");                                     /* start data         */
 
-  /* data */
+  /* data, the reader skips the samples outside [start,stop] */
 
-  if (t->hdr.ev_count_total > 0)
+  memset(id_last_smpl, 0, sizeof(id_last_smpl));                   /* as dumpvars        */
+  tracer_file_in_select(t, t->start_time, t->stop_time, -1);
+  is_first_sample = 1;
+  while (tracer_read_sample(t,&curr_smpl))
     {
-      is_first_sample = 1;
-      
-      for(ev=1; ev < t->hdr.ev_count_total; ev++)
+      if (is_first_sample)
 	{
-	  tracer_read_sample(t,&curr_smpl);
-
-	  if ((t->start_time <= curr_smpl.time) && (curr_smpl.time <= t->stop_time))
+	  fprintf(t->out_fd,"\n#%" PRId64 "\n", curr_smpl.time);
+	  fprintf(t->out_fd,"b%s %s\n", tracer_lldbin(bin,curr_smpl.val,t->hdr.id_width[curr_smpl.id]), 
+		  t->id_var[curr_smpl.id]);
+	  id_last_smpl[curr_smpl.id] = curr_smpl;
+	  
+	  is_first_sample = 0;
+	}
+      else
+	{
+	  if (id_last_smpl[curr_smpl.id].val != curr_smpl.val)
 	    {
-	      if (is_first_sample)
-		{
-		  fprintf(t->out_fd,"\n#%" PRId64 "\n", curr_smpl.time);
-		  fprintf(t->out_fd,"b%s %s\n", tracer_lldbin(curr_smpl.val,t->hdr.id_width[curr_smpl.id]), 
-		          t->id_var[curr_smpl.id]);
-		  id_last_smpl[curr_smpl.id] = curr_smpl;
-		  
-		  is_first_sample = 0;
-		}
-	      else
-		{
-		  if (id_last_smpl[curr_smpl.id].val != curr_smpl.val)
-		    {
-		      if (curr_smpl.time != curr_time)
-			fprintf(t->out_fd,"\n#%" PRId64 "\n", curr_smpl.time);
-		      
-		      fprintf(t->out_fd,"b%s %s\n",tracer_lldbin(curr_smpl.val,t->hdr.id_width[curr_smpl.id]),
-		              t->id_var[curr_smpl.id]);
-		      id_last_smpl[curr_smpl.id] = curr_smpl;
-		    }
-		}
+	      if (curr_smpl.time != curr_time)
+		fprintf(t->out_fd,"\n#%" PRId64 "\n", curr_smpl.time);
+	      
+	      fprintf(t->out_fd,"b%s %s\n",tracer_lldbin(bin,curr_smpl.val,t->hdr.id_width[curr_smpl.id]),
+		      t->id_var[curr_smpl.id]);
+	      id_last_smpl[curr_smpl.id] = curr_smpl;
 	    }
-	  curr_time = curr_smpl.time;
 	}
+      curr_time = curr_smpl.time;
     }
   return 0;
 }
@@ -420,6 +415,7 @@ static int drv_vcd_dump_merge(tracer_t *t, tracer_t *trc[], int nbtrc)
   tracer_ev_t     ev_number   [VCD_TRC_MAX];                 /* current ev on file I     */
   tracer_sample_t ev_smpl     [VCD_TRC_MAX];                 /* current sample on file I */
   tracer_sample_t id_last_smpl[VCD_TRC_MAX][TRACER_MAX_ID];  /* last seen id value in I  */
+  char            bin[MAXWIDTH + 1];
 
   memset(ev_valid,     0, sizeof(ev_valid));
   memset(ev_number,    0, sizeof(ev_number));
@@ -447,7 +443,7 @@ static int drv_vcd_dump_merge(tracer_t *t, tracer_t *trc[], int nbtrc)
       if (ntotal == 0)
 	{
 	  fprintf(t->out_fd,"\n#%" PRId64 "\n", curr_smpl.time);
-	  fprintf(t->out_fd,"b%s %s\n", tracer_lldbin(curr_smpl.val,trc[itrc]->hdr.id_width[curr_smpl.id]), 
+	  fprintf(t->out_fd,"b%s %s\n", tracer_lldbin(bin,curr_smpl.val,trc[itrc]->hdr.id_width[curr_smpl.id]), 
 	          trc[itrc]->id_var[curr_smpl.id]);
 	  id_last_smpl[itrc][curr_smpl.id] = curr_smpl;
 	  curr_time = curr_smpl.time;
@@ -460,7 +456,7 @@ static int drv_vcd_dump_merge(tracer_t *t, tracer_t *trc[], int nbtrc)
 		{
 		  fprintf(t->out_fd,"\n#%" PRId64 "\n", curr_smpl.time);
 		}
-	      fprintf(t->out_fd,"b%s %s\n", tracer_lldbin(curr_smpl.val,trc[itrc]->hdr.id_width[curr_smpl.id]), 
+	      fprintf(t->out_fd,"b%s %s\n", tracer_lldbin(bin,curr_smpl.val,trc[itrc]->hdr.id_width[curr_smpl.id]), 
 	              trc[itrc]->id_var[curr_smpl.id]);
 	      id_last_smpl[itrc][curr_smpl.id] = curr_smpl;
 	      ntotal ++;
@@ -10,8 +10,14 @@
 #include <string.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
+#include "config.h"
+#if defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
+
 #include "log.h"
 #include "wsim_endian.h"
 #include "tracer.h"
@@ -45,6 +51,7 @@ void usage(char* prog)
   --end=time       default: max       \n\
   --debug          default: no        \n\
   --merge          default: no        \n\
+  --jobs=n         default: cpus      \n\
   --verbose        default: no        \n\
   --help                              \n\
 \n\
@@ -76,6 +83,10 @@ int options_parse(tracer_t *t, int argc, char* argv[])
   t->start_time      = 0;
   t->stop_time       = DEFAULT_STOP_TIME;
   t->merge           = 0;
+  t->jobs            = 1;
+#if defined(HAVE_PTHREAD_H) && defined(_SC_NPROCESSORS_ONLN)
+  t->jobs            = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
   t->verbose         = 0;
 #ifdef DEBUG
   t->debug           = 1;
@@ -96,6 +107,7 @@ int options_parse(tracer_t *t, int argc, char* argv[])
 	  {"format",  required_argument, 0, 'f'},
 	  {"help",    no_argument,       0, 'h'},   
 	  {"in",      required_argument, 0, 'i'},
+	  {"jobs",    required_argument, 0, 'j'},
 	  {"merge",   no_argument,       0, 'M'},
 	  {"multi",   no_argument,       0, 'm'},
 	  {"out",     required_argument, 0, 'o'},
@@ -104,7 +116,7 @@ int options_parse(tracer_t *t, int argc, char* argv[])
 	  {0, 0, 0, 0}
 	};
       
-      c = getopt_long (argc, argv, "i:o:d:f:s:b:e:Dmh",
+      c = getopt_long (argc, argv, "i:o:d:f:s:b:e:j:Dmh",
 		       long_options, &option_index);
       if (c == -1)
 	{
@@ -154,6 +166,9 @@ int options_parse(tracer_t *t, int argc, char* argv[])
 	case 'M':
 	  t->merge           = 1;
 	  break;
+	case 'j':
+	  t->jobs            = atoi(optarg);
+	  break;
 	case 'D':
 	  t->debug           = 1;
 	  break;
@@ -188,6 +203,7 @@ void options_print(tracer_t *t)
   DMSG(t,"tracer:opt: start time   : %"PRId64"\n",t->start_time);
   DMSG(t,"tracer:opt: stop time    : %"PRId64"\n",t->stop_time);
   DMSG(t,"tracer:opt: merge        : %d\n",t->merge);
+  DMSG(t,"tracer:opt: jobs         : %d\n",t->jobs);
   DMSG(t,"tracer:opt: debug        : %d\n",t->debug);
   DMSG(t,"tracer:opt: verbose      : %d\n",t->verbose);
 }
@@ -204,6 +220,12 @@ int options_validation(tracer_t *t)
       return 2;
     }
 
+  if (t->jobs < 1)
+    {
+      ERROR("tracer: jobs must be at least 1\n");
+      return 4;
+    }
+
   if (t->merge && (t->mode == TRC_FILE))
     {
       ERROR("tracer: must combine --merge with --dir or --multi\n");
@@ -217,6 +239,124 @@ int options_validation(tracer_t *t)
 /* ************************************************** */
 /* ************************************************** */
 
+/**
+ * when files are not merged each file is converted on its own by a
+ * pool of threads, each conversion works on a copy of the tracer
+ **/
+
+struct tracer_jobs_t {
+  tracer_t        *trc;
+  tracer_driver_t *drv;
+  char           **files;
+  int              count;
+  int              max;
+  int              next;
+#if defined(HAVE_PTHREAD_H)
+  pthread_mutex_t  lock;
+#endif
+};
+
+static void tracer_jobs_add(struct tracer_jobs_t *jobs, char *filename)
+{
+  if (jobs->count == jobs->max)
+    {
+      jobs->max   = (jobs->max == 0) ? 64 : 2 * jobs->max;
+      jobs->files = (char**)realloc(jobs->files, jobs->max * sizeof(char*));
+      if (jobs->files == NULL)
+	{
+	  ERROR("tracer: cannot allocate file list\n");
+	  exit( EXIT_FAILURE );
+	}
+    }
+  jobs->files[jobs->count++] = strdup(filename);
+}
+
+static void tracer_jobs_convert(struct tracer_jobs_t *jobs, int i)
+{
+  tracer_t *t = tracer_create();
+
+  memcpy(t, jobs->trc, sizeof(tracer_t));
+  t->dir = NULL;
+  strncpyz(t->in_filename, jobs->files[i], FILENAME_MAX);
+  snprintf(t->out_filename,FILENAME_MAX,"%s.%s", t->in_filename, jobs->drv->ext);
+  DMSG(t,"tracer: processing file %s\n",t->in_filename);
+
+  if (tracer_file_in_open(t) == 0)
+    {
+      if (tracer_file_out_open(t) == 0)
+	{
+	  jobs->drv->process(t);
+	  tracer_file_out_close(t);
+	}
+      tracer_file_in_close(t);
+    }
+  tracer_delete(t);
+}
+
+static void* tracer_jobs_main(void *arg)
+{
+  struct tracer_jobs_t *jobs = (struct tracer_jobs_t*)arg;
+  int i;
+
+  do {
+#if defined(HAVE_PTHREAD_H)
+    pthread_mutex_lock(&jobs->lock);
+#endif
+    i = jobs->next++;
+#if defined(HAVE_PTHREAD_H)
+    pthread_mutex_unlock(&jobs->lock);
+#endif
+    if (i < jobs->count)
+      {
+	tracer_jobs_convert(jobs, i);
+      }
+  } while (i < jobs->count);
+  return NULL;
+}
+
+static void tracer_jobs_run(struct tracer_jobs_t *jobs)
+{
+  int i;
+  int n = 0;
+#if defined(HAVE_PTHREAD_H)
+  pthread_t *threads;
+
+  n = (jobs->trc->jobs < jobs->count) ? jobs->trc->jobs : jobs->count;
+  threads = (pthread_t*)malloc(n * sizeof(pthread_t));
+  pthread_mutex_init(&jobs->lock, NULL);
+  for(i=0; (threads != NULL) && (n > 1) && (i < n); i++)
+    {
+      if (pthread_create(&threads[i], NULL, tracer_jobs_main, jobs) != 0)
+	{
+	  break;
+	}
+    }
+  n = i;
+#endif
+
+  /* the main thread takes part, it does all the work without threads */
+  tracer_jobs_main(jobs);
+
+#if defined(HAVE_PTHREAD_H)
+  for(i=0; i < n; i++)
+    {
+      pthread_join(threads[i], NULL);
+    }
+  pthread_mutex_destroy(&jobs->lock);
+  free(threads);
+#endif
+
+  for(i=0; i < jobs->count; i++)
+    {
+      free(jobs->files[i]);
+    }
+  free(jobs->files);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 #define ERR_EXIT(x...)				\
   do {						\
   ERROR(x);					\
@@ -256,7 +396,11 @@ int main(int argc, char* argv[])
 
 	case TRC_FILE:
 	  DMSG(trc,"tracer: file mode %s\n",trc->in_filename);
-	  tracer_file_in_open(trc);
+	  if (tracer_file_in_open(trc) != 0)
+	    {
+	      tracer_delete(trc);
+	      return 1;
+	    }
 	  tracer_file_out_open(trc);
 	  drv->init(trc);
 	  drv->process(trc);
@@ -277,6 +421,18 @@ int main(int argc, char* argv[])
 	      tracer_file_out_open(trc); 
 	    }
 
+	  if ((trc->merge == 0) && (drv->parallel))
+	    {
+	      struct tracer_jobs_t jobs = { trc, drv, NULL, 0, 0, 0 };
+	      tracer_dirmode_init(trc,".trc");
+	      while (tracer_dirmode_next(trc) == 0)
+		{
+		  tracer_jobs_add(&jobs, trc->in_filename);
+		}
+	      tracer_dirmode_close(trc);
+	      tracer_jobs_run(&jobs);
+	    }
+	  else
 	  {
 	    tracer_dirmode_init(trc,".trc");
 	    while (tracer_dirmode_next(trc) == 0)
@@ -287,9 +443,11 @@ int main(int argc, char* argv[])
 		    snprintf(trc->out_filename,FILENAME_MAX,"%s.%s", trc->in_filename, drv->ext);
 		    tracer_file_out_open(trc);
 		  }
-		tracer_file_in_open(trc);
-		drv->process(trc);
-		tracer_file_in_close(trc);
+		if (tracer_file_in_open(trc) == 0)
+		  {
+		    drv->process(trc);
+		    tracer_file_in_close(trc);
+		  }
 		if (trc->merge == 0)
 		  {
 		    tracer_file_out_close(trc);
@@ -316,6 +474,16 @@ int main(int argc, char* argv[])
 	      tracer_file_out_open(trc); 
 	    }
 	  
+	  if ((trc->merge == 0) && (drv->parallel))
+	    {
+	      struct tracer_jobs_t jobs = { trc, drv, NULL, 0, 0, 0 };
+	      for( ; next_arg < argc; next_arg++)
+		{
+		  tracer_jobs_add(&jobs, argv[next_arg]);
+		}
+	      tracer_jobs_run(&jobs);
+	    }
+	  else
 	  {
 	    while (next_arg < argc)
 	      {
@@ -326,9 +494,11 @@ int main(int argc, char* argv[])
 		    snprintf(trc->out_filename,FILENAME_MAX,"%s.%s", trc->in_filename, drv->ext);
 		    tracer_file_out_open(trc);
 		  }
-		tracer_file_in_open(trc);
-		drv->process(trc);
-		tracer_file_in_close(trc);
+		if (tracer_file_in_open(trc) == 0)
+		  {
+		    drv->process(trc);
+		    tracer_file_in_close(trc);
+		  }
 		if (trc->merge == 0)
 		  {
 		    tracer_file_out_close(trc);
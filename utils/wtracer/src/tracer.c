@@ -8,12 +8,19 @@
 #include <dirent.h>
 
 #include "config.h"
+#if defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#endif
 #include "log.h"
 #include "wsim_endian.h"
 
 #include "tracer.h"
 
 static int  tracer_load        (tracer_t *t);
+static int  tracer_map         (tracer_t *t);
+static void tracer_unmap       (tracer_t *t);
+static int  tracer_block_load  (tracer_t *t, int b);
+static int  tracer_scan        (tracer_t *t);
 static void tracer_swap_header (tracer_t *t);
 static void tracer_swap_sample (tracer_sample_t *s);
 
@@ -143,7 +150,17 @@ int tracer_file_in_open(tracer_t *t)
       ERROR("tracer:file: open error on input %s\n",t->in_filename);
       return 1;
     }
-  tracer_load(t);
+
+  t->sel_start = 0;
+  t->sel_stop  = DEFAULT_STOP_TIME;
+  t->sel_id    = -1;
+
+  if ((tracer_load(t) != 0) || 
+      ((t->hdr.version >= 5) && (tracer_map(t) != 0)))
+    {
+      tracer_file_in_close(t);
+      return 1;
+    }
   return 0;
 }
 
@@ -160,6 +177,7 @@ int tracer_file_in_close(tracer_t *t)
 	  fclose(t->in_fd);
 	  t->in_fd = NULL;
 	}
+      tracer_unmap(t);
     }
   else
     {
@@ -175,6 +193,13 @@ int tracer_file_in_close(tracer_t *t)
 int tracer_file_in_rewind(tracer_t *t)
 {
   TERROR(t->in_fd == NULL,"tracer:file: rewind error\n");
+  if (t->in_map != NULL)
+    {
+      t->in_block      = -1;
+      t->in_smpl_count = 0;
+      t->in_smpl_next  = 0;
+      return 0;
+    }
   fseek(t->in_fd,t->hdr.header_length,SEEK_SET);
   return 0;
 }
@@ -183,6 +208,320 @@ int tracer_file_in_rewind(tracer_t *t)
 /* ************************************************** */
 /* ************************************************** */
 
+int tracer_file_in_select(tracer_t *t, tracer_time_t start, tracer_time_t stop, int id)
+{
+  t->sel_start = start;
+  t->sel_stop  = stop;
+  t->sel_id    = id;
+  return tracer_file_in_rewind(t);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * version 5 files are mapped, the block index is copied and swapped
+ * (or rebuilt by tracer_scan when the file has none)
+ * and samples are decoded one block at a time in t->in_smpl
+ **/
+static int tracer_map(tracer_t *t)
+{
+  uint32_t b;
+  size_t   size;
+  long     pos;
+
+  pos = ftell(t->in_fd);
+  fseek(t->in_fd, 0, SEEK_END);
+  t->in_map_size = ftell(t->in_fd);
+  fseek(t->in_fd, pos, SEEK_SET);
+
+#if defined(HAVE_SYS_MMAN_H)
+  t->in_map = (uint8_t*)mmap(NULL, t->in_map_size, PROT_READ, MAP_PRIVATE, fileno(t->in_fd), 0);
+  if (t->in_map == MAP_FAILED)
+    {
+      t->in_map = NULL;
+    }
+#else
+  if ((t->in_map = (uint8_t*)malloc(t->in_map_size)) != NULL)
+    {
+      fseek(t->in_fd, 0, SEEK_SET);
+      if (fread(t->in_map, 1, t->in_map_size, t->in_fd) != t->in_map_size)
+	{
+	  free(t->in_map);
+	  t->in_map = NULL;
+	}
+      fseek(t->in_fd, pos, SEEK_SET);
+    }
+#endif
+  TERROR(t->in_map == NULL, "tracer:file: cannot map input file\n");
+
+  size = t->hdr.block_count * sizeof(tracer_block_t);
+  if ((t->hdr.block_ev == 0) || (t->hdr.block_ev > (1u << 24)) ||
+      ((t->hdr.index_scan == 0) && (t->hdr.index_offset + size > t->in_map_size)))
+    {
+      ERROR("tracer:file: block index error in %s\n",t->in_filename);
+      tracer_unmap(t);
+      return 1;
+    }
+
+  t->in_smpl  = (tracer_sample_t*)malloc(t->hdr.block_ev * sizeof(tracer_sample_t));
+  if (t->in_smpl == NULL)
+    {
+      ERROR("tracer:file: cannot allocate block buffer\n");
+      tracer_unmap(t);
+      return 1;
+    }
+
+  /* killed simulation or index write error */
+  if ((t->hdr.block_count == 0) || (t->hdr.index_scan))
+    {
+      return tracer_scan(t);
+    }
+
+  t->in_index = (tracer_block_t*)malloc(size + 1);
+  if (t->in_index == NULL)
+    {
+      ERROR("tracer:file: cannot allocate block index\n");
+      tracer_unmap(t);
+      return 1;
+    }
+  memcpy(t->in_index, t->in_map + t->hdr.index_offset, size);
+
+  for(b=0; b < t->hdr.block_count; b++)
+    {
+      tracer_block_t *blk = & t->in_index[b];
+      if (t->hdr.need_endian_swap)
+	{
+	  blk->offset   = endian_swap8(blk->offset);
+	  blk->count    = endian_swap4(blk->count);
+	  blk->size     = endian_swap4(blk->size);
+	  blk->time_min = endian_swap8(blk->time_min);
+	  blk->time_max = endian_swap8(blk->time_max);
+	}
+      if ((blk->count > t->hdr.block_ev) || (blk->offset + blk->size > t->hdr.index_offset))
+	{
+	  ERROR("tracer:file: block %d index error in %s\n",b,t->in_filename);
+	  tracer_unmap(t);
+	  return 1;
+	}
+    }
+
+  t->in_block      = -1;
+  t->in_smpl_count = 0;
+  t->in_smpl_next  = 0;
+  DMSG(t,"tracer:file: mapped %ld bytes, %d blocks\n",(long)t->in_map_size,t->hdr.block_count);
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static void tracer_unmap(tracer_t *t)
+{
+  if (t->in_map != NULL)
+    {
+#if defined(HAVE_SYS_MMAN_H)
+      munmap(t->in_map, t->in_map_size);
+#else
+      free(t->in_map);
+#endif
+    }
+  free(t->in_index);
+  free(t->in_smpl);
+  t->in_map        = NULL;
+  t->in_map_size   = 0;
+  t->in_index      = NULL;
+  t->in_smpl       = NULL;
+  t->in_smpl_count = 0;
+  t->in_smpl_next  = 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static inline uint8_t* tracer_varint(uint8_t *p, uint8_t *end, uint64_t *v)
+{
+  int shift = 0;
+  *v = 0;
+  while ((p < end) && (shift < 64))
+    {
+      *v    |= (uint64_t)(*p & 0x7f) << shift;
+      shift += 7;
+      if ((*p++ & 0x80) == 0)
+	return p;
+    }
+  return NULL;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+static int tracer_block_load(tracer_t *t, int b)
+{
+  uint32_t        i;
+  tracer_block_t *blk  = & t->in_index[b];
+  uint8_t        *p    = t->in_map + blk->offset;
+  uint8_t        *end  = p + blk->size;
+  tracer_time_t   time = 0;
+  tracer_val_t    val[TRACER_MAX_ID];
+
+  memset(val, 0, sizeof(val));
+  for(i=0; i < blk->count; i++)
+    {
+      uint64_t    dt, dv;
+      tracer_id_t id;
+
+      if ((p >= end) || ((id = *p++) >= TRACER_MAX_ID) ||
+	  ((p = tracer_varint(p, end, &dt)) == NULL) ||
+	  ((p = tracer_varint(p, end, &dv)) == NULL))
+	{
+	  ERROR("tracer:file: block %d decode error in %s\n",b,t->in_filename);
+	  return 1;
+	}
+      time    += (dt >> 1) ^ (~(dt & 1) + 1);
+      val[id] ^= dv;
+      t->in_smpl[i].id   = id;
+      t->in_smpl[i].time = time;
+      t->in_smpl[i].val  = val[id];
+    }
+
+  t->in_block      = b;
+  t->in_smpl_count = blk->count;
+  t->in_smpl_next  = 0;
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/**
+ * traces without index are scanned: blocks start after the header
+ * and hold block_ev samples, the last one may be shorter or truncated.
+ * Sample counts and total time are taken from the scan since the
+ * header of a killed simulation has not been updated.
+ **/
+static int tracer_scan(tracer_t *t)
+{
+  uint8_t       *p    = t->in_map + t->hdr.header_length;
+  uint8_t       *end  = t->in_map + t->in_map_size;
+  uint32_t       max  = 0;
+  int            done = 0;
+
+  if ((t->hdr.index_offset > (uint64_t)t->hdr.header_length) && 
+      (t->hdr.index_offset < t->in_map_size))
+    {
+      end = t->in_map + t->hdr.index_offset;
+    }
+
+  t->hdr.block_count    = 0;
+  t->hdr.ev_count_total = 0;
+  t->hdr.sim_time_total = 0;
+  memset(t->hdr.id_count, 0, sizeof(t->hdr.id_count));
+
+  while ((p < end) && (done == 0))
+    {
+      tracer_block_t *blk;
+      tracer_time_t   time = 0;
+      tracer_val_t    val[TRACER_MAX_ID];
+
+      if (t->hdr.block_count == max)
+	{
+	  tracer_block_t *index;
+	  max   = (max == 0) ? 64 : 2 * max;
+	  index = (tracer_block_t*)realloc(t->in_index, max * sizeof(tracer_block_t));
+	  if (index == NULL)
+	    {
+	      ERROR("tracer:file: cannot allocate block index\n");
+	      tracer_unmap(t);
+	      return 1;
+	    }
+	  t->in_index = index;
+	}
+
+      blk = & t->in_index[t->hdr.block_count];
+      memset(blk, 0, sizeof(tracer_block_t));
+      memset(val, 0, sizeof(val));
+      blk->offset = p - t->in_map;
+
+      while ((blk->count < t->hdr.block_ev) && (p < end))
+	{
+	  uint8_t    *q = p;
+	  uint64_t    dt, dv;
+	  tracer_id_t id;
+
+	  if (((id = *q++) >= TRACER_MAX_ID) ||
+	      ((q = tracer_varint(q, end, &dt)) == NULL) ||
+	      ((q = tracer_varint(q, end, &dv)) == NULL))
+	    {
+	      done = 1;
+	      break;
+	    }
+	  time    += (dt >> 1) ^ (~(dt & 1) + 1);
+	  val[id] ^= dv;
+	  if ((blk->count == 0) || (time < blk->time_min))
+	    blk->time_min = time;
+	  if ((blk->count == 0) || (time > blk->time_max))
+	    blk->time_max = time;
+	  blk->ids[id / 8] |= 1 << (id % 8);
+	  blk->count ++;
+	  t->hdr.id_count[id] ++;
+	  p = q;
+	}
+
+      if (blk->count == 0)
+	break;
+      blk->size = (p - t->in_map) - blk->offset;
+      t->hdr.block_count    ++;
+      t->hdr.ev_count_total += blk->count;
+      if (blk->time_max > t->hdr.sim_time_total)
+	t->hdr.sim_time_total = blk->time_max;
+    }
+
+  if (p < end)
+    {
+      ERROR("tracer:file: %s is truncated after %"PRIu64" samples\n",
+	    t->in_filename, (uint64_t)t->hdr.ev_count_total);
+    }
+
+  t->hdr.index_scan = 1;
+  t->in_block       = -1;
+  t->in_smpl_count  = 0;
+  t->in_smpl_next   = 0;
+  DMSG(t,"tracer:file: scanned %ld bytes, %d blocks\n",(long)t->in_map_size,t->hdr.block_count);
+  return 0;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
+/* next block that may hold selected samples */
+static int tracer_block_next(tracer_t *t)
+{
+  int b;
+  for(b = t->in_block + 1; b < (int)t->hdr.block_count; b++)
+    {
+      tracer_block_t *blk = & t->in_index[b];
+      if ((blk->count == 0) ||
+	  (blk->time_max < t->sel_start) || (blk->time_min > t->sel_stop))
+	continue;
+      if ((t->sel_id >= 0) && ((blk->ids[t->sel_id / 8] & (1 << (t->sel_id % 8))) == 0))
+	continue;
+      return tracer_block_load(t, b);
+    }
+  t->in_block = b;
+  return 1;
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
+
 static int tracer_load(tracer_t *t)
 {
   char version;
@@ -205,11 +544,13 @@ static int tracer_load(tracer_t *t)
   /* version */
   r += fread(&version,1,1,t->in_fd);
   DMSG(t,"tracer:hdr: version      : %d\n",version);
-  if (version != TRACER_VERSION)
+  if ((version < TRACER_VERSION_MIN) || (version > TRACER_VERSION))
     {
-      ERROR("tracer: version mismatch. reader version = %d, file version = %d\n",TRACER_VERSION,version);
+      ERROR("tracer: version mismatch. reader versions = %d to %d, file version = %d\n",
+	    TRACER_VERSION_MIN,TRACER_VERSION,version);
       return 1;
     }
+  t->hdr.version = version;
   
   /* endianess */
   r += fread(&e,1,1,t->in_fd);
@@ -283,13 +624,24 @@ static int tracer_load(tracer_t *t)
   r += fread(t->hdr.id_val_min,1,sizeof(tracer_val_t) * t->hdr.tracer_max_id,t->in_fd);
   r += fread(t->hdr.id_val_max,1,sizeof(tracer_val_t) * t->hdr.tracer_max_id,t->in_fd);
 
-  t->hdr.header_length = r;
-  DMSG(t,"tracer:hdr: bin size     : %d\n",t->hdr.header_length);
+  /* blocks */
+  if (t->hdr.version >= 5)
+    {
+      r += fread(&(t->hdr.block_ev),    1, sizeof(t->hdr.block_ev),    t->in_fd);
+      r += fread(&(t->hdr.block_count), 1, sizeof(t->hdr.block_count), t->in_fd);
+      r += fread(&(t->hdr.index_offset),1, sizeof(t->hdr.index_offset),t->in_fd);
+    }
+  t->hdr.index_scan = 0;
 
+  t->hdr.header_length = r;
   if (t->hdr.need_endian_swap)
     {
       tracer_swap_header(t);
     }
+
+  DMSG(t,"tracer:hdr: blocks       : %d x %d samples\n",t->hdr.block_count,t->hdr.block_ev);
+  DMSG(t,"tracer:hdr: index        : %"PRIu64"\n",t->hdr.index_offset);
+  DMSG(t,"tracer:hdr: bin size     : %d\n",t->hdr.header_length);
   
   if (t->debug || t->verbose)
     {
@@ -325,6 +677,9 @@ static void tracer_swap_header(tracer_t *t)
   t->hdr.tracer_max_id  = endian_swap4(t->hdr.tracer_max_id);
   t->hdr.ev_count_total = endian_swap4(t->hdr.ev_count_total);
   t->hdr.sim_time_total = endian_swap8(t->hdr.sim_time_total);
+  t->hdr.block_ev       = endian_swap4(t->hdr.block_ev);
+  t->hdr.block_count    = endian_swap4(t->hdr.block_count);
+  t->hdr.index_offset   = endian_swap8(t->hdr.index_offset);
   for(i=0; i < TRACER_MAX_ID; i++)
     {
       t->hdr.id_count  [i] = endian_swap4(t->hdr.id_count  [i]);
@@ -348,6 +703,24 @@ int tracer_dup(tracer_t *dest,tracer_t *source)
   dest->dir       = NULL;
 
   fseek(dest->in_fd, pos, SEEK_SET);
+
+  /* mapped files get their own mapping and block buffer */
+  dest->in_map    = NULL;
+  dest->in_index  = NULL;
+  dest->in_smpl   = NULL;
+  if (source->in_map != NULL)
+    {
+      if (tracer_map(dest) != 0)
+	{
+	  return 1;
+	}
+      if ((source->in_block >= 0) && (source->in_block < (int)source->hdr.block_count))
+	{
+	  tracer_block_load(dest, source->in_block);
+	  dest->in_smpl_next = source->in_smpl_next;
+	}
+      dest->in_block = source->in_block;
+    }
   return 0;
 }
 
@@ -362,6 +735,10 @@ void tracer_dump_header(tracer_t *t)
   OUTPUT("tracer:hdr: id max %d\n",t->hdr.tracer_max_id);
   OUTPUT("tracer:hdr: ev_count %d\n",t->hdr.ev_count_total);
   OUTPUT("tracer:hdr: simulation time %"PRId64"\n",t->hdr.sim_time_total);
+  if (t->hdr.version >= 5)
+    {
+      OUTPUT("tracer:hdr: blocks %d x %d samples\n",t->hdr.block_count,t->hdr.block_ev);
+    }
   for(i=0; i < TRACER_MAX_ID; i++)
     {
       if (t->hdr.id_name[i][0] != '\0')
@@ -380,6 +757,7 @@ void tracer_delete(tracer_t *t)
 {
   if (t)
     {
+      tracer_unmap(t);
       free(t);
     }
 }
@@ -409,16 +787,33 @@ tracer_id_t tracer_find_id_by_name (tracer_t *t, char* name)
 int tracer_read_sample(tracer_t *t, tracer_sample_t *s)
 {
   size_t size = sizeof(tracer_sample_t);
-  if (fread(s, 1, size, t->in_fd) != size)
-    {
-      DMSG(t,"tracer:sample: read error\n");
-      return 0;
-    }
 
-  if (t->hdr.need_endian_swap)
-    {
-      tracer_swap_sample(s);
-    }
+  do {
+    if (t->in_map != NULL)
+      {
+	while (t->in_smpl_next == t->in_smpl_count)
+	  {
+	    if (tracer_block_next(t) != 0)
+	      {
+		return 0;
+	      }
+	  }
+	*s = t->in_smpl[t->in_smpl_next++];
+      }
+    else
+      {
+	if (fread(s, 1, size, t->in_fd) != size)
+	  {
+	    DMSG(t,"tracer:sample: read error\n");
+	    return 0;
+	  }
+	if (t->hdr.need_endian_swap)
+	  {
+	    tracer_swap_sample(s);
+	  }
+      }
+  } while (((t->sel_id >= 0) && (s->id != (tracer_id_t)t->sel_id)) ||
+	   (s->time < t->sel_start) || (s->time > t->sel_stop));
 
   /* DMSG(t,"tracer:sample: id: %03x time: %010"PRIx64" val:%010"PRIx64"\n", s->id,s->time,s->val); */
 
@@ -57,8 +57,13 @@ typedef struct tracer_sample_struct_t tracer_sample_t;
       magic_size == 26
    version 2:
       ..
+   version 5:
+      samples are delta encoded in blocks, an index at the end
+      of the file gives the offset, time range and ids of each
+      block
 */
-#define TRACER_VERSION           4
+#define TRACER_VERSION           5
+#define TRACER_VERSION_MIN       4
 
 #define TRACER_MAX_ID            255
 #define TRACER_MAX_NAME_LENGTH   200
@@ -67,6 +72,7 @@ typedef struct tracer_sample_struct_t tracer_sample_t;
 struct _tracer_header_t {
   int32_t          need_endian_swap;
   int32_t          header_length;
+  int32_t          version;
   int32_t          node_id;
   uint64_t         initial_time;
 
@@ -87,9 +93,26 @@ struct _tracer_header_t {
   tracer_ev_t      id_count  [TRACER_MAX_ID];  /* count for each id      */
   tracer_val_t     id_val_min[TRACER_MAX_ID];  /* id_min                 */
   tracer_val_t     id_val_max[TRACER_MAX_ID];  /* id max                 */
+
+  /* version 5 */
+  uint32_t         block_ev;                   /* samples per block      */
+  uint32_t         block_count;
+  uint64_t         index_offset;
+  int32_t          index_scan;                 /* no index in file       */
 };
 typedef struct _tracer_header_t tracer_header_t;
 
+/* version 5 block index entry */
+struct PACKED tracer_block_struct_t {
+  uint64_t         offset;
+  uint32_t         count;
+  uint32_t         size;
+  tracer_time_t    time_min;
+  tracer_time_t    time_max;
+  uint8_t          ids[(TRACER_MAX_ID + 8) / 8];
+};
+typedef struct tracer_block_struct_t tracer_block_t;
+
 /******************************************************************************************/
 /******************************************************************************************/
 /******************************************************************************************/
@@ -107,6 +130,7 @@ struct tracer_struct_t {
   enum tracer_mode_t mode;
   int                merge;
   int                verbose;
+  int                jobs;
 
   char               in_filename[FILENAME_MAX];
   char               out_filename[FILENAME_MAX];
@@ -114,6 +138,20 @@ struct tracer_struct_t {
   FILE              *in_fd;
   FILE              *out_fd;
 
+  /* version 5 input, the file is mapped and read block by block */
+  uint8_t           *in_map;
+  size_t             in_map_size;
+  tracer_block_t    *in_index;
+  int                in_block;      /* current block              */
+  tracer_sample_t   *in_smpl;       /* current block samples      */
+  uint32_t           in_smpl_count;
+  uint32_t           in_smpl_next;
+
+  /* input selection, see tracer_file_in_select */
+  tracer_time_t      sel_start;
+  tracer_time_t      sel_stop;
+  int                sel_id;
+
   char               in_Dir[FILENAME_MAX];
   DIR               *dir;
   char               dir_pattern[FILENAME_MAX];
@@ -141,6 +179,8 @@ void            tracer_dump_header     (tracer_t *t);
 int             tracer_file_in_open    (tracer_t *t);
 int             tracer_file_in_close   (tracer_t *t);
 int             tracer_file_in_rewind  (tracer_t *t);
+/* rewind and only read samples of id (-1 for all) in [start,stop] */
+int             tracer_file_in_select  (tracer_t *t, tracer_time_t start, tracer_time_t stop, int id);
 
 int             tracer_file_out_name   (tracer_t *t, char *ext, int n);
 int             tracer_file_out_open   (tracer_t *t);
@@ -150,6 +190,7 @@ int             tracer_dirmode_init    (tracer_t *t, const char* patterm);
 int             tracer_dirmode_next    (tracer_t *t);
 int             tracer_dirmode_close   (tracer_t *t);
 
+/* returns 0 at the end of the selected samples */
 int             tracer_read_sample     (tracer_t *t, tracer_sample_t *s);
 tracer_id_t     tracer_find_id_by_name (tracer_t *t, char* name);
 
@@ -167,6 +208,7 @@ struct tracer_driver_struct_t {
   tracer_drv_function_t  init;     /* init process, called once per run     */
   tracer_drv_function_t  process;  /* process, called for each file         */
   tracer_drv_function_t  finalize; /* finalize process, called once per run */
+  int                    parallel; /* process can run on several files at once */
 };
 
 typedef struct tracer_driver_struct_t tracer_driver_t;